@@ -12,6 +12,7 @@ import csv
 import os
 import sys
 from basketball_mapping import *
+import tdoa
 pp = pprint.PrettyPrinter()
 pprint = pp.pprint
 
@@ -24,6 +25,7 @@ CALIBRATION_SAMPLES = 100
 ANCHORS = [(0,0), (0, footToMeter(COURT_HEIGHT_FEET)),
             (footToMeter(COURT_WIDTH_FEET), 0), (footToMeter(COURT_WIDTH_FEET), footToMeter(COURT_HEIGHT_FEET)),
             (footToMeter(COURT_WIDTH_FEET//2), 0), (footToMeter(COURT_WIDTH_FEET//2), footToMeter(COURT_HEIGHT_FEET))][:ANCHOR_COUNT]
+TDOA = tdoa.Solver(ANCHORS) if tdoa.lib else None # native solver, None to use numpy/scipy
 WITH_SMOOTHING = False
 SMOOTHING_FACTOR = 1.45
 P = 100
@@ -156,6 +158,10 @@ def pulseAndStamp(dataPoint):
 
 def linearLocalization(T, tau):
     v = SPEED_OF_LIGHT / (1e9) # meters per nanosecond
+    if TDOA is not None:
+        fix = TDOA.linear(tau, v)
+        if fix is not None:
+            return fix
     x = list(map(lambda x: x[0], ANCHORS))
     y = list(map(lambda x: x[1], ANCHORS))
     alpha = [None]*len(ANCHORS)
@@ -203,6 +209,12 @@ def nonLinearLocalization(T, tau):
             hs[m-1] = c-xTerm-yTerm-root
         return hs
     lastEstX, lastEstY = nonLinEstLocs[-1] if len(nonLinEstLocs)>0 else linEstLocs[-1]
+    if TDOA is not None:
+        # warm start from the EKF prediction, the filter has not seen this sample yet
+        pred = EKF.f.F.dot(EKF.f.x) if len(filterEstLocs)>0 else None
+        fix = TDOA.solveWarm(tau, v, (pred[0][0], pred[1][0]) if pred is not None else None)
+        if fix is not None:
+            return fix
     guess = np.array([lastEstX, lastEstY])
     estX, estY = spo.least_squares(hyperbolas, guess).x
     return (estX, estY)
@@ -12,6 +12,7 @@ import random
 import csv
 import os
 from basketball_mapping import *
+import tdoa
 pp = pprint.PrettyPrinter()
 pprint = pp.pprint
 ANCHORS = None 
@@ -73,6 +74,10 @@ def pulseAndStamp(app):
 
 def linearLocalization(app, T, tau):
     v = SPEED_OF_LIGHT / (10**9) # meters per nanosecond
+    if app.tdoa is not None:
+        fix = app.tdoa.linear(tau, v)
+        if fix is not None:
+            return fix
     x = app.xs
     y = app.ys        
     alpha = [None]*len(app.anchors)
@@ -120,6 +125,10 @@ def nonLinearLocalization(app, T, tau):
             hs[m-1] = c-xTerm-yTerm-root
         return hs
     lastEstX, lastEstY = app.nonLinEstLocs[-1] if len(app.nonLinEstLocs)>0 else gridToCoord(app.rows//2, app.cols//2)
+    if app.tdoa is not None:
+        fix = app.tdoa.solve(tau, v, (lastEstX, lastEstY))
+        if fix is not None:
+            return fix
     guess = np.array([lastEstX, lastEstY])
     estX, estY = spo.least_squares(hyperbolas, guess).x
     return (estX, estY)
@@ -222,6 +231,7 @@ def appStarted(app):
     app.rows = COURT_HEIGHT_FEET//FEET_IN_GRID  # 50 feet court height
     app.tag = Tag(footToMeter(COURT_WIDTH_FEET/2), footToMeter(COURT_HEIGHT_FEET/2), "Player 1")
     app.anchors = ANCHORS
+    app.tdoa = tdoa.Solver(app.anchors) if tdoa.lib else None # native solver, None to use numpy/scipy
     app.xs = [None]*len(app.anchors)
     app.ys = [None]*len(app.anchors)
     for anchid, anchor in enumerate(app.anchors):
@@ -0,0 +1,169 @@
+import ctypes
+import os
+
+# Binding of the native TDoA solver and tracker of the DWM1001 host API (include/dwm_tdoa.h,
+# include/dwm_track.h), built with "make lib" in tag_anchor/DWM1001_host_api/examples/ex7_tdoa,
+# or at $DWM_TDOA_LIB.
+# lib is None when the library is not built, the callers keep their numpy/scipy solvers then.
+
+LIB_PATH = os.environ.get("DWM_TDOA_LIB", os.path.join(os.path.dirname(os.path.abspath(__file__)),
+           "..", "tag_anchor", "DWM1001_host_api", "examples", "ex7_tdoa", "libdwm_tdoa.so"))
+ANCHOR_CNT_MAX = 16
+DIM_MAX = 3
+
+class _Tdoa(ctypes.Structure):
+    _fields_ = [("dim", ctypes.c_int),
+                ("cnt", ctypes.c_int),
+                ("a", (ctypes.c_double * DIM_MAX) * ANCHOR_CNT_MAX),
+                ("k", ctypes.c_double * ANCHOR_CNT_MAX)]
+
+class _TrackNoise(ctypes.Structure):
+    _fields_ = [(name, ctypes.c_double) for name in ("p0_pos", "p0_vel", "q_pos", "q_vel", "r_rd", "r_vel")]
+
+_dbl_p = ctypes.POINTER(ctypes.c_double)
+_u32_p = ctypes.POINTER(ctypes.c_uint32)
+
+class _Track(ctypes.Structure):
+    _fields_ = [("an", _Tdoa),
+                ("n", _TrackNoise),
+                ("cap", ctypes.c_uint32),
+                ("cnt", ctypes.c_uint32),
+                ("s", _dbl_p * 4),
+                ("p", _dbl_p * 10),
+                ("z", _dbl_p),
+                ("zv", _dbl_p * 2),
+                ("w", _dbl_p),
+                ("wv", _dbl_p),
+                ("h", _dbl_p),
+                ("hx", _dbl_p),
+                ("hy", _dbl_p),
+                ("sp", _dbl_p * 2),
+                ("slot_handle", _u32_p),
+                ("handle_slot", _u32_p),
+                ("free_handle", _u32_p),
+                ("free_cnt", ctypes.c_uint32),
+                ("pool", ctypes.c_void_p)]
+
+try:
+    lib = ctypes.CDLL(LIB_PATH)
+    lib.dwm_tdoa_init.argtypes = [ctypes.POINTER(_Tdoa), ctypes.c_int, ctypes.c_int, _dbl_p]
+    lib.dwm_tdoa_linear.argtypes = [ctypes.POINTER(_Tdoa), _dbl_p, _dbl_p]
+    lib.dwm_tdoa_solve.argtypes = [ctypes.POINTER(_Tdoa), _dbl_p, _dbl_p, _dbl_p, _dbl_p]
+    lib.dwm_tdoa_solve_warm.argtypes = [ctypes.POINTER(_Tdoa), _dbl_p, _dbl_p, ctypes.c_double, _dbl_p, _dbl_p,
+                                        ctypes.POINTER(ctypes.c_int)]
+    lib.dwm_track_init.argtypes = [ctypes.POINTER(_Track), ctypes.POINTER(_Tdoa), ctypes.POINTER(_TrackNoise), ctypes.c_uint32]
+    lib.dwm_track_free.argtypes = [ctypes.POINTER(_Track)]
+    lib.dwm_track_add.argtypes = [ctypes.POINTER(_Track), _dbl_p, _u32_p]
+    lib.dwm_track_remove.argtypes = [ctypes.POINTER(_Track), ctypes.c_uint32]
+    lib.dwm_track_meas.argtypes = [ctypes.POINTER(_Track), ctypes.c_uint32, _dbl_p, _dbl_p]
+    lib.dwm_track_step.argtypes = [ctypes.POINTER(_Track), ctypes.c_double]
+    lib.dwm_track_get.argtypes = [ctypes.POINTER(_Track), ctypes.c_uint32, _dbl_p]
+    lib.dwm_track_predict.argtypes = [ctypes.POINTER(_Track), ctypes.c_uint32, ctypes.c_double, _dbl_p]
+except OSError:
+    lib = None
+
+class Solver(object):
+    # anchors: list of (x, y) or (x, y, z) in meters, the range differences are to anchors[0]
+    def __init__(self, anchors):
+        self.dim = len(anchors[0])
+        self.cnt = len(anchors)
+        self.t = _Tdoa()
+        flat = (ctypes.c_double * (self.dim*self.cnt))(*[c for a in anchors for c in a])
+        if lib.dwm_tdoa_init(ctypes.byref(self.t), self.dim, self.cnt, flat) != 0:
+            raise ValueError("dwm_tdoa_init: %d anchors of %d coordinates" % (self.cnt, self.dim))
+        self.rd = (ctypes.c_double * self.cnt)()
+        self.p = (ctypes.c_double * self.dim)()
+        self.guess = (ctypes.c_double * self.dim)()
+        self.rms = ctypes.c_double()
+        self.iter = ctypes.c_int()
+        self.iterations = 0 # of solveWarm(), summed
+
+    def _setRangeDiffs(self, tau, v):
+        for i in range(self.cnt):
+            self.rd[i] = v*tau[i]
+
+    # tau: TDoA to anchors[0], v: speed in meters per unit of tau
+    # returns the fix, or None if the solve failed
+    def linear(self, tau, v):
+        self._setRangeDiffs(tau, v)
+        if lib.dwm_tdoa_linear(ctypes.byref(self.t), self.rd, self.p) != 0:
+            return None
+        return tuple(self.p)
+
+    def solve(self, tau, v, guess=None):
+        self._setRangeDiffs(tau, v)
+        g = None
+        if guess is not None:
+            for i in range(self.dim):
+                self.guess[i] = guess[i]
+            g = self.guess
+        if lib.dwm_tdoa_solve(ctypes.byref(self.t), self.rd, g, self.p, ctypes.byref(self.rms)) != 0:
+            return None
+        return tuple(self.p)
+
+    # solve from a prediction, e.g. the EKF or Tracker.predict(), solved again from the linear solve if the
+    # residual rms is above rmsMax meters
+    def solveWarm(self, tau, v, pred, rmsMax=1.0):
+        self._setRangeDiffs(tau, v)
+        g = None
+        if pred is not None:
+            for i in range(self.dim):
+                self.guess[i] = pred[i]
+            g = self.guess
+        rv = lib.dwm_tdoa_solve_warm(ctypes.byref(self.t), self.rd, g, rmsMax, self.p, ctypes.byref(self.rms),
+                                     ctypes.byref(self.iter))
+        self.iterations += self.iter.value
+        if rv != 0:
+            return None
+        return tuple(self.p)
+
+class Tracker(object):
+    # EKF of x, y, vx, vy for up to cap tags on the anchors of a 2D Solver, the noises are in
+    # meters and seconds: p0 initial variances, q process noise per second, r measurement variances
+    def __init__(self, solver, cap, p0Pos=1., p0Vel=1., qPos=0.01, qVel=0.5, rRd=0.2, rVel=1.):
+        self.solver = solver
+        self.t = _Track()
+        noise = _TrackNoise(p0Pos, p0Vel, qPos, qVel, rRd, rVel)
+        if lib.dwm_track_init(ctypes.byref(self.t), ctypes.byref(solver.t), ctypes.byref(noise), cap) != 0:
+            raise ValueError("dwm_track_init: %d tags" % cap)
+        self.handle = ctypes.c_uint32()
+        self.pos = (ctypes.c_double * 2)()
+        self.vel = (ctypes.c_double * 2)()
+        self.state = (ctypes.c_double * 4)()
+
+    def __del__(self):
+        if lib is not None and self.t.pool:
+            lib.dwm_track_free(ctypes.byref(self.t))
+
+    # returns the handle of the new tag, None if the tracker is full
+    def add(self, pos):
+        self.pos[0], self.pos[1] = pos[0], pos[1]
+        if lib.dwm_track_add(ctypes.byref(self.t), self.pos, ctypes.byref(self.handle)) != 0:
+            return None
+        return self.handle.value
+
+    def remove(self, handle):
+        lib.dwm_track_remove(ctypes.byref(self.t), handle)
+
+    # tau: TDoA to anchors[0], v: speed in meters per unit of tau, vel: measured (vx, vy) or None
+    def meas(self, handle, tau, v, vel=None):
+        self.solver._setRangeDiffs(tau, v)
+        vp = None
+        if vel is not None:
+            self.vel[0], self.vel[1] = vel[0], vel[1]
+            vp = self.vel
+        lib.dwm_track_meas(ctypes.byref(self.t), handle, self.solver.rd, vp)
+
+    # predicts all the tags by dt seconds and updates those measured since the last step
+    def step(self, dt):
+        lib.dwm_track_step(ctypes.byref(self.t), dt)
+
+    # returns (x, y, vx, vy)
+    def get(self, handle):
+        lib.dwm_track_get(ctypes.byref(self.t), handle, self.state)
+        return tuple(self.state)
+
+    # returns the (x, y) predicted dt seconds after the last step
+    def predict(self, handle, dt):
+        lib.dwm_track_predict(ctypes.byref(self.t), handle, dt, self.pos)
+        return (self.pos[0], self.pos[1])
@@ -12,6 +12,7 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "deca_types.h"
 #include "deca_param_types.h"
@@ -81,11 +82,44 @@ typedef struct
     dwt_cb_t    cbRxOk;             // Callback for RX good frame event
     dwt_cb_t    cbRxTo;             // Callback for RX timeout events
     dwt_cb_t    cbRxErr;            // Callback for RX error events
+    dwt_rxrecord_cb_t cbRxRecord;   // Callback for RX good frame event with the frame record (RX record path)
+    dwt_rxrecord_t rxRecord;        // RX record passed to cbRxRecord
 } dwt_local_data_t ;
 
 static dwt_local_data_t dw1000local[DWT_NUM_DW_DEV] ; // Static local device data, can be an array to support multiple DW1000 testing applications/platforms
 static dwt_local_data_t *pdw1000local = dw1000local ; // Static local data structure pointer
 
+// -------------------------------------------------------------------------------------------------------------------
+// Queue of the register writes between dwt_writebatchbegin() and dwt_writebatchend()
+#define DWT_WRBATCH_RUNS        (16)        // number of SPI transactions which can be queued
+#define DWT_WRBATCH_LEN         (96)        // total number of data bytes which can be queued
+// SYS_CFG bits set by dwt_configure(), the only ones a register image changes
+#define DWT_REGIMAGE_SYS_CFG    (SYS_CFG_RXM110K | SYS_CFG_PHR_MODE_11)
+
+typedef dwt_regrun_t dwt_wrrun_t ;
+
+typedef struct
+{
+    uint8       depth ;             // nesting of dwt_writebatchbegin() calls, 0 : writes are not queued
+    uint8       runs ;              // number of queued runs
+    uint16      used ;              // number of queued data bytes
+    decaIrqStatus_t stat ;          // interrupt state of the outermost dwt_writebatchbegin()
+    dwt_wrrun_t run[DWT_WRBATCH_RUNS] ;
+    uint8       data[DWT_WRBATCH_LEN] ;
+    dwt_regimage_t *capture ;       // register image filled instead of the device, see dwt_regimagebegin()
+    uint8       overflow ;          // the capture did not fit into its image
+    uint32      sysCFGreg ;         // local state of the device, restored at the end of the capture
+    uint32      txFCTRL ;
+    uint8       longFrames ;
+} dwt_wrbatch_t ;
+
+static dwt_wrbatch_t dwt_wrbatch ;
+
+static void _dwt_writespi(uint16 recordNumber, uint16 index, uint32 length, const uint8 *buffer) ;
+static void _dwt_writebatchflush(void) ;
+static int _dwt_queuewrite(dwt_wrrun_t *run, uint8 *runs, uint8 maxRuns, uint8 *data, uint16 *used, uint16 maxLen,
+                           uint16 recordNumber, uint16 index, uint32 length, const uint8 *buffer) ;
+
 
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn dwt_apiversion()
@@ -183,6 +217,7 @@ int dwt_initialise(int config)
     pdw1000local->cbRxOk = NULL;
     pdw1000local->cbRxTo = NULL;
     pdw1000local->cbRxErr = NULL;
+    pdw1000local->cbRxRecord = NULL;
 
 #if DWT_API_ERROR_CHECK
     pdw1000local->otp_mask = config ; // Save the READ_OTP config mask
@@ -571,6 +606,56 @@ uint32 dwt_getlotid(void)
     return pdw1000local->lotID;
 }
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_getotpvalues()
+ *
+ * @brief This is used to return the OTP values read by dwt_initialise(), so the host can store them and restore them
+ *        with dwt_setotpvalues() when it re-initialises a DW1000 which kept running (DWT_DW_WAKE_UP)
+ *
+ * NOTE: dwt_initialise() must be called prior to this function so that it can return relevant values.
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param otp - the part ID, lot ID, reference voltage/temperature and OTP revision
+ *
+ * no return value
+ */
+void dwt_getotpvalues(dwt_otpvalues_t *otp)
+{
+    otp->partID = pdw1000local->partID;
+    otp->lotID  = pdw1000local->lotID;
+    otp->vBatP  = pdw1000local->vBatP;
+    otp->tempP  = pdw1000local->tempP;
+    otp->otprev = pdw1000local->otprev;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_setotpvalues()
+ *
+ * @brief This is used to set the OTP values of the local data instead of reading them from OTP, i.e. after
+ *        dwt_initialise(DWT_DW_WAKE_UP) without the DWT_READ_OTP_xx options
+ *
+ * input parameters
+ * @param otp - values previously returned by dwt_getotpvalues() for this device
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_setotpvalues(const dwt_otpvalues_t *otp)
+{
+    pdw1000local->partID = otp->partID;
+    pdw1000local->lotID  = otp->lotID;
+    pdw1000local->vBatP  = otp->vBatP;
+    pdw1000local->tempP  = otp->tempP;
+    pdw1000local->otprev = otp->otprev;
+
+#if DWT_API_ERROR_CHECK
+    pdw1000local->otp_mask |= DWT_READ_OTP_TMP | DWT_READ_OTP_BAT | DWT_READ_OTP_LID | DWT_READ_OTP_PID;
+#endif
+}
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn dwt_readdevid()
  *
@@ -603,6 +688,7 @@ uint32 dwt_readdevid(void)
  */
 void dwt_configuretxrf(dwt_txconfig_t *config)
 {
+    dwt_writebatchbegin();
 
     // Configure RF TX PG_DELAY
     dwt_write8bitoffsetreg(TX_CAL_ID, TC_PGDELAY_OFFSET, config->PGdly);
@@ -610,6 +696,7 @@ void dwt_configuretxrf(dwt_txconfig_t *config)
     // Configure TX power
     dwt_write32bitreg(TX_POWER_ID, config->power);
 
+    dwt_writebatchend();
 }
 
 
@@ -629,6 +716,8 @@ void dwt_configuretxrf(dwt_txconfig_t *config)
  */
 void dwt_configurefor64plen(int prf)
 {
+    dwt_writebatchbegin();
+
     dwt_write8bitoffsetreg(CRTR_ID, CRTR_GEAR_OFFSET, DEMOD_GEAR_64L);
 
     if(prf == DWT_PRF_16M)
@@ -639,6 +728,35 @@ void dwt_configurefor64plen(int prf)
     {
         dwt_write8bitoffsetreg(DRX_CONF_ID, DRX_TUNE2_OFFSET+2, DRX_TUNE2_UNCONF_SFD_TH_PRF64);
     }
+
+    dwt_writebatchend();
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn _dwt_chanctrl()
+ *
+ * @brief  CHAN_CTRL register value of a configuration: channel, RX PRF, SFD type and preamble codes
+ *
+ * input parameters
+ * @param config    -   pointer to the configuration structure
+ *
+ * output parameters
+ *
+ * returns the register value
+ */
+static uint32 _dwt_chanctrl(const dwt_config_t *config)
+{
+    uint8 nsSfd_result = (config->nsSFD) ? 3 : 0 ;
+    uint8 useDWnsSFD = (config->nsSFD) ? 1 : 0 ;
+    uint8 chan = config->chan ;
+
+    return (CHAN_CTRL_TX_CHAN_MASK & (chan << CHAN_CTRL_TX_CHAN_SHIFT)) | // Transmit Channel
+           (CHAN_CTRL_RX_CHAN_MASK & (chan << CHAN_CTRL_RX_CHAN_SHIFT)) | // Receive Channel
+           (CHAN_CTRL_RXFPRF_MASK & ((uint32)config->prf << CHAN_CTRL_RXFPRF_SHIFT)) | // RX PRF
+           ((CHAN_CTRL_TNSSFD|CHAN_CTRL_RNSSFD) & ((uint32)nsSfd_result << CHAN_CTRL_TNSSFD_SHIFT)) | // nsSFD enable RX&TX
+           (CHAN_CTRL_DWSFD & ((uint32)useDWnsSFD << CHAN_CTRL_DWSFD_SHIFT)) | // Use DW nsSFD
+           (CHAN_CTRL_TX_PCOD_MASK & ((uint32)config->txCode << CHAN_CTRL_TX_PCOD_SHIFT)) | // TX Preamble Code
+           (CHAN_CTRL_RX_PCOD_MASK & ((uint32)config->rxCode << CHAN_CTRL_RX_PCOD_SHIFT)) ; // RX Preamble Code
 }
 
 
@@ -659,10 +777,7 @@ void dwt_configurefor64plen(int prf)
  */
 void dwt_configure(dwt_config_t *config)
 {
-    uint8 nsSfd_result  = 0;
-    uint8 useDWnsSFD = 0;
     uint8 chan = config->chan ;
-    uint32 regval ;
     uint16 reg16 = lde_replicaCoeff[config->rxCode];
     uint8 prfIndex = config->prf - DWT_PRF_16M;
     uint8 bw = ((chan == 4) || (chan == 7)) ? 1 : 0 ; // Select wide or narrow band
@@ -697,6 +812,9 @@ void dwt_configure(dwt_config_t *config)
     pdw1000local->sysCFGreg &= ~SYS_CFG_PHR_MODE_11;
     pdw1000local->sysCFGreg |= (SYS_CFG_PHR_MODE_11 & ((uint32)config->phrMode << SYS_CFG_PHR_MODE_SHFT));
 
+    // The writes below are queued, consecutive offsets of a register file go out in one SPI transaction
+    dwt_writebatchbegin();
+
     dwt_write32bitreg(SYS_CFG_ID,pdw1000local->sysCFGreg) ;
     // Set the lde_replicaCoeff
     dwt_write16bitoffsetreg(LDE_IF_ID, LDE_REPC_OFFSET, reg16) ;
@@ -715,6 +833,7 @@ void dwt_configure(dwt_config_t *config)
     dwt_write32bitoffsetreg(RF_CONF_ID, RF_TXCTRL_OFFSET, tx_config[chan_idx[chan]]);
 
     // Configure the baseband parameters (for specified PRF, bit rate, PAC, and SFD settings)
+    // DTUNE0, DTUNE1 and DTUNE2 are consecutive (DRX_TUNE0b_OFFSET to DRX_TUNE2_OFFSET + 3) and merge into one write
     // DTUNE0
     dwt_write16bitoffsetreg(DRX_CONF_ID, DRX_TUNE0b_OFFSET, sftsh[config->dataRate][config->nsSFD]);
 
@@ -725,18 +844,13 @@ void dwt_configure(dwt_config_t *config)
     {
         dwt_write16bitoffsetreg(DRX_CONF_ID, DRX_TUNE1b_OFFSET, DRX_TUNE1b_110K);
     }
+    else if(config->txPreambLength == DWT_PLEN_64)
+    {
+        dwt_write16bitoffsetreg(DRX_CONF_ID, DRX_TUNE1b_OFFSET, DRX_TUNE1b_6M8_PRE64);
+    }
     else
     {
-        if(config->txPreambLength == DWT_PLEN_64)
-        {
-            dwt_write16bitoffsetreg(DRX_CONF_ID, DRX_TUNE1b_OFFSET, DRX_TUNE1b_6M8_PRE64);
-            dwt_write8bitoffsetreg(DRX_CONF_ID, DRX_TUNE4H_OFFSET, DRX_TUNE4H_PRE64);
-        }
-        else
-        {
-            dwt_write16bitoffsetreg(DRX_CONF_ID, DRX_TUNE1b_OFFSET, DRX_TUNE1b_850K_6M8);
-            dwt_write8bitoffsetreg(DRX_CONF_ID, DRX_TUNE4H_OFFSET, DRX_TUNE4H_PRE128PLUS);
-        }
+        dwt_write16bitoffsetreg(DRX_CONF_ID, DRX_TUNE1b_OFFSET, DRX_TUNE1b_850K_6M8);
     }
 
     // DTUNE2
@@ -750,6 +864,19 @@ void dwt_configure(dwt_config_t *config)
     }
     dwt_write16bitoffsetreg(DRX_CONF_ID, DRX_SFDTOC_OFFSET, config->sfdTO);
 
+    // DTUNE4H
+    if(config->dataRate != DWT_BR_110K)
+    {
+        if(config->txPreambLength == DWT_PLEN_64)
+        {
+            dwt_write8bitoffsetreg(DRX_CONF_ID, DRX_TUNE4H_OFFSET, DRX_TUNE4H_PRE64);
+        }
+        else
+        {
+            dwt_write8bitoffsetreg(DRX_CONF_ID, DRX_TUNE4H_OFFSET, DRX_TUNE4H_PRE128PLUS);
+        }
+    }
+
     // Configure AGC parameters
     dwt_write32bitoffsetreg( AGC_CFG_STS_ID, 0xC, agc_config.lo32);
     dwt_write16bitoffsetreg( AGC_CFG_STS_ID, 0x4, agc_config.target[prfIndex]);
@@ -759,18 +886,9 @@ void dwt_configure(dwt_config_t *config)
     {
         // Write non standard (DW) SFD length
         dwt_write8bitoffsetreg(USR_SFD_ID, 0x00, dwnsSFDlen[config->dataRate]);
-        nsSfd_result = 3 ;
-        useDWnsSFD = 1 ;
     }
-    regval =  (CHAN_CTRL_TX_CHAN_MASK & (chan << CHAN_CTRL_TX_CHAN_SHIFT)) | // Transmit Channel
-              (CHAN_CTRL_RX_CHAN_MASK & (chan << CHAN_CTRL_RX_CHAN_SHIFT)) | // Receive Channel
-              (CHAN_CTRL_RXFPRF_MASK & ((uint32)config->prf << CHAN_CTRL_RXFPRF_SHIFT)) | // RX PRF
-              ((CHAN_CTRL_TNSSFD|CHAN_CTRL_RNSSFD) & ((uint32)nsSfd_result << CHAN_CTRL_TNSSFD_SHIFT)) | // nsSFD enable RX&TX
-              (CHAN_CTRL_DWSFD & ((uint32)useDWnsSFD << CHAN_CTRL_DWSFD_SHIFT)) | // Use DW nsSFD
-              (CHAN_CTRL_TX_PCOD_MASK & ((uint32)config->txCode << CHAN_CTRL_TX_PCOD_SHIFT)) | // TX Preamble Code
-              (CHAN_CTRL_RX_PCOD_MASK & ((uint32)config->rxCode << CHAN_CTRL_RX_PCOD_SHIFT)) ; // RX Preamble Code
 
-    dwt_write32bitreg(CHAN_CTRL_ID,regval) ;
+    dwt_write32bitreg(CHAN_CTRL_ID, _dwt_chanctrl(config)) ;
 
     // Set up TX Preamble Size, PRF and Data Rate
     pdw1000local->txFCTRL = ((uint32)(config->txPreambLength | config->prf) << TX_FCTRL_TXPRF_SHFT) | ((uint32)config->dataRate << TX_FCTRL_TXBR_SHFT);
@@ -781,8 +899,38 @@ void dwt_configure(dwt_config_t *config)
     // after its configuration or reconfiguration.
     // This issue is not documented at the time of writing this code. It should be in next release of DW1000 User Manual (v2.09, from July 2016).
     dwt_write8bitoffsetreg(SYS_CTRL_ID, SYS_CTRL_OFFSET, SYS_CTRL_TXSTRT | SYS_CTRL_TRXOFF); // Request TX start and TRX off at the same time
+
+    dwt_writebatchend();
 } // end dwt_configure()
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_configurepreamblecode()
+ *
+ * @brief  this function writes the TX and RX preamble codes of config (CHAN_CTRL and the LDE replica coefficient)
+ *         without the rest of dwt_configure(), the other settings of config must be those of the last dwt_configure()
+ *
+ * input parameters
+ * @param config    -   pointer to the configuration structure
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_configurepreamblecode(const dwt_config_t *config)
+{
+    uint16 reg16 = lde_replicaCoeff[config->rxCode];
+
+    if(DWT_BR_110K == config->dataRate)
+    {
+        reg16 >>= 3; // lde_replicaCoeff must be divided by 8
+    }
+
+    dwt_writebatchbegin();
+    dwt_write16bitoffsetreg(LDE_IF_ID, LDE_REPC_OFFSET, reg16) ;
+    dwt_write32bitreg(CHAN_CTRL_ID, _dwt_chanctrl(config)) ;
+    dwt_writebatchend();
+}
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn dwt_setrxantennadelay()
  *
@@ -1168,6 +1316,297 @@ void dwt_writetodevice
     uint32        length,
     const uint8   *buffer
 )
+{
+    dwt_regimage_t *img = dwt_wrbatch.capture ;
+
+    if (img != NULL)
+    {
+        if (!_dwt_queuewrite(img->run, &img->runs, DWT_REGIMAGE_RUNS, img->data, &img->used, DWT_REGIMAGE_LEN,
+                             recordNumber, index, length, buffer))
+        {
+            dwt_wrbatch.overflow = 1 ;
+        }
+        return;
+    }
+
+    if (dwt_wrbatch.depth == 0)
+    {
+        _dwt_writespi(recordNumber, index, length, buffer);
+        return;
+    }
+
+    if (length > DWT_WRBATCH_LEN) // Does not fit into the queue at all, keep the order and write it directly
+    {
+        _dwt_writebatchflush();
+        _dwt_writespi(recordNumber, index, length, buffer);
+        return;
+    }
+
+    if (!_dwt_queuewrite(dwt_wrbatch.run, &dwt_wrbatch.runs, DWT_WRBATCH_RUNS, dwt_wrbatch.data, &dwt_wrbatch.used,
+                         DWT_WRBATCH_LEN, recordNumber, index, length, buffer))
+    {
+        _dwt_writebatchflush();
+        (void)_dwt_queuewrite(dwt_wrbatch.run, &dwt_wrbatch.runs, DWT_WRBATCH_RUNS, dwt_wrbatch.data, &dwt_wrbatch.used,
+                              DWT_WRBATCH_LEN, recordNumber, index, length, buffer);
+    }
+} // end dwt_writetodevice()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn _dwt_queuewrite()
+ *
+ * @brief  this function appends a register write to a queue of runs, merged with the last run if it ends where the
+ *         write starts (the data of the last run is at the end of the queue)
+ *
+ * input parameters:
+ * @param run, runs, maxRuns - runs of the queue, number of queued runs and capacity
+ * @param data, used, maxLen - data of the queue, number of queued bytes and capacity
+ * @param recordNumber, index, length, buffer - the write, see dwt_writetodevice()
+ *
+ * output parameters
+ *
+ * returns 1 if the write was queued, 0 if it does not fit into the queue
+ */
+static int _dwt_queuewrite(dwt_wrrun_t *run, uint8 *runs, uint8 maxRuns, uint8 *data, uint16 *used, uint16 maxLen,
+                           uint16 recordNumber, uint16 index, uint32 length, const uint8 *buffer)
+{
+    dwt_wrrun_t *last = (*runs > 0) ? (&run[*runs - 1]) : (NULL) ;
+
+    if ((*used + length) > maxLen)
+    {
+        return 0;
+    }
+
+    if ((last != NULL) && (last->recordNumber == recordNumber) && ((last->index + last->length) == index)
+        && ((last->length + length) <= 0xFF))
+    {
+        last->length += (uint8)length ;
+    }
+    else
+    {
+        if (*runs == maxRuns)
+        {
+            return 0;
+        }
+        last = &run[(*runs)++] ;
+        last->recordNumber = (uint8)recordNumber ;
+        last->index = index ;
+        last->length = (uint8)length ;
+        last->data = *used ;
+    }
+
+    memcpy(&data[*used], buffer, length);
+    *used += (uint16)length ;
+
+    return 1;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_writebatchbegin()
+ *
+ * @brief  this function starts queueing the register writes, see dwt_writebatchend()
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_writebatchbegin(void)
+{
+    if (dwt_wrbatch.depth == 0)
+    {
+        // The ISR must not queue its writes behind the ones of the application
+        dwt_wrbatch.stat = decamutexon() ;
+    }
+    dwt_wrbatch.depth++ ;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_writebatchend()
+ *
+ * @brief  this function closes a batch of register writes, the outermost call writes the queue to the device
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_writebatchend(void)
+{
+#ifdef DWT_API_ERROR_CHECK
+    assert(dwt_wrbatch.depth > 0);
+#endif
+
+    if (--dwt_wrbatch.depth == 0)
+    {
+        _dwt_writebatchflush();
+        decamutexoff(dwt_wrbatch.stat) ;
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn _dwt_writebatchflush()
+ *
+ * @brief  this function writes the queued runs to the device, one SPI transaction per run, and empties the queue
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+static void _dwt_writebatchflush(void)
+{
+    int i ;
+
+    for (i = 0 ; i < dwt_wrbatch.runs ; i++)
+    {
+        dwt_wrrun_t *run = &dwt_wrbatch.run[i] ;
+
+        _dwt_writespi(run->recordNumber, run->index, run->length, &dwt_wrbatch.data[run->data]);
+    }
+
+    dwt_wrbatch.runs = 0 ;
+    dwt_wrbatch.used = 0 ;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_regimagebegin()
+ *
+ * @brief  this function starts the capture of a register image: until dwt_regimageend() the register writes are
+ *         recorded into img instead of being written to the DW1000, see dwt_regimageapply()
+ *
+ * input parameters
+ * @param img - the image to fill
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_regimagebegin(dwt_regimage_t *img)
+{
+    dwt_writebatchbegin();
+
+    // The writes queued before go to the device first
+    _dwt_writebatchflush();
+
+    img->runs = 0 ;
+    img->used = 0 ;
+    dwt_wrbatch.capture = img ;
+    dwt_wrbatch.overflow = 0 ;
+    dwt_wrbatch.sysCFGreg = pdw1000local->sysCFGreg ;
+    dwt_wrbatch.txFCTRL = pdw1000local->txFCTRL ;
+    dwt_wrbatch.longFrames = pdw1000local->longFrames ;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_regimageend()
+ *
+ * @brief  this function ends the capture of dwt_regimagebegin(), the local state of the device is left as it was
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS, or DWT_ERROR if the writes did not fit into the image (the image is left empty)
+ */
+int dwt_regimageend(void)
+{
+    dwt_regimage_t *img = dwt_wrbatch.capture ;
+    int result = DWT_SUCCESS ;
+
+#ifdef DWT_API_ERROR_CHECK
+    assert(img != NULL);
+#endif
+
+    img->sysCFGbits = pdw1000local->sysCFGreg & DWT_REGIMAGE_SYS_CFG ;
+    img->txFCTRL = pdw1000local->txFCTRL ;
+    img->longFrames = pdw1000local->longFrames ;
+
+    if (dwt_wrbatch.overflow)
+    {
+        img->runs = 0 ;
+        result = DWT_ERROR ;
+    }
+
+    pdw1000local->sysCFGreg = dwt_wrbatch.sysCFGreg ;
+    pdw1000local->txFCTRL = dwt_wrbatch.txFCTRL ;
+    pdw1000local->longFrames = dwt_wrbatch.longFrames ;
+    dwt_wrbatch.capture = NULL ;
+
+    dwt_writebatchend();
+
+    return result;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_regimageapply()
+ *
+ * @brief  this function writes a register image captured by dwt_regimagebegin()/dwt_regimageend(), one SPI
+ *         transaction per run. SYS_CFG is written from its local copy with the bits of the image, so the settings
+ *         made after the capture (e.g. the double buffering) are kept.
+ *
+ * input parameters
+ * @param img - the image
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_regimageapply(const dwt_regimage_t *img)
+{
+    uint8 sysCfg[4] ;
+    int   i, j ;
+
+    dwt_writebatchbegin();
+
+    // The writes queued before go to the device first
+    _dwt_writebatchflush();
+
+    pdw1000local->sysCFGreg = (pdw1000local->sysCFGreg & ~DWT_REGIMAGE_SYS_CFG) | img->sysCFGbits ;
+    pdw1000local->txFCTRL = img->txFCTRL ;
+    pdw1000local->longFrames = img->longFrames ;
+
+    for (j = 0 ; j < 4 ; j++)
+    {
+        sysCfg[j] = (uint8)(pdw1000local->sysCFGreg >> (j * 8)) ;
+    }
+
+    for (i = 0 ; i < img->runs ; i++)
+    {
+        const dwt_regrun_t *run = &img->run[i] ;
+
+        if ((run->recordNumber == SYS_CFG_ID) && (run->index == 0) && (run->length == 4))
+        {
+            _dwt_writespi(SYS_CFG_ID, 0, 4, sysCfg);
+        }
+        else
+        {
+            _dwt_writespi(run->recordNumber, run->index, run->length, &img->data[run->data]);
+        }
+    }
+
+    dwt_writebatchend();
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn _dwt_writespi()
+ *
+ * @brief  this function writes the header and the data of a register write in one SPI transaction,
+ *         see dwt_writetodevice()
+ *
+ * input parameters:
+ * @param recordNumber  - ID of register file or buffer being accessed
+ * @param index         - byte index into register file or buffer being accessed
+ * @param length        - number of bytes being written
+ * @param buffer        - pointer to buffer containing the 'length' bytes to be written
+ *
+ * output parameters
+ *
+ * no return value
+ */
+static void _dwt_writespi(uint16 recordNumber, uint16 index, uint32 length, const uint8 *buffer)
 {
     uint8 header[3] ; // Buffer to compose header in
     int   cnt = 0; // Counter for length of header
@@ -1200,7 +1639,7 @@ void dwt_writetodevice
 
     // Write it to the SPI
     writetospi(cnt,header,length,buffer);
-} // end dwt_writetodevice()
+} // end _dwt_writespi()
 
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn dwt_readfromdevice()
@@ -1239,6 +1678,12 @@ void dwt_readfromdevice
     assert(recordNumber <= 0x3F); // Record number is limited to 6-bits.
 #endif
 
+    // A read must see the queued writes
+    if (dwt_wrbatch.runs > 0)
+    {
+        _dwt_writebatchflush();
+    }
+
     // Write message header selecting READ operation and addresses as appropriate (this is one to three bytes long)
     if (index == 0) // For index of 0, no sub-index is required
     {
@@ -2136,6 +2581,8 @@ int dwt_spicswakeup(uint8 *buff, uint16 length)
  */
 void _dwt_configlde(int prfIndex)
 {
+    dwt_writebatchbegin();
+
     dwt_write8bitoffsetreg(LDE_IF_ID, LDE_CFG1_OFFSET, LDE_PARAM1); // 8-bit configuration register
 
     if(prfIndex)
@@ -2146,6 +2593,8 @@ void _dwt_configlde(int prfIndex)
     {
         dwt_write16bitoffsetreg( LDE_IF_ID, LDE_CFG2_OFFSET, (uint16) LDE_PARAM3_16);
     }
+
+    dwt_writebatchend();
 }
 
 
@@ -2336,6 +2785,102 @@ void dwt_setcallbacks(dwt_cb_t cbTxDone, dwt_cb_t cbRxOk, dwt_cb_t cbRxTo, dwt_c
     pdw1000local->cbRxErr = cbRxErr;
 }
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_setrxrecordcallback()
+ *
+ * @brief This function is used to register the RX record callback, see dwt_isr()
+ *
+ * input parameters
+ * @param cbRxRecord - the pointer to the RX record callback function, NULL to use cbRxOk
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_setrxrecordcallback(dwt_rxrecord_cb_t cbRxRecord)
+{
+    pdw1000local->cbRxRecord = cbRxRecord;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn _dwt_isrrxrecord()
+ *
+ * @brief This function handles the RXFCG event for dwt_isr() when the RX record callback is set. Frame information,
+ *        frame and RX timestamp are read in one burst each, the status bits (including a bogus AAT) are cleared with a
+ *        single write. In double buffer mode the status is cleared and the receiver re-enabled first.
+ *
+ * input parameters
+ * @param status - SYS_STATUS read on ISR entry
+ *
+ * output parameters
+ *
+ * no return value
+ */
+static void _dwt_isrrxrecord(uint32 status)
+{
+    dwt_rxrecord_t *rec = &pdw1000local->rxRecord;
+    uint32 clear = SYS_STATUS_ALL_RX_GOOD;
+    uint8 finfo[2];
+    uint16 len;
+
+    rec->cbData.status = status;
+    rec->cbData.rx_flags = 0;
+
+    if (pdw1000local->dblbuffon)
+    {
+        // The next frame goes into the other buffer: clear the events of this one before the receiver is re-enabled
+        // (without syncing the buffer pointers) so the events of the next frame are not cleared with them
+        dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_ALL_RX_GOOD);
+        dwt_write16bitoffsetreg(SYS_CTRL_ID, SYS_CTRL_OFFSET, SYS_CTRL_RXENAB);
+        clear = 0;
+    }
+
+    // Frame info - Only the first two bytes of the register are used here.
+    dwt_readfromdevice(RX_FINFO_ID, RX_FINFO_OFFSET, 2, finfo);
+
+    len = (((uint16)finfo[1] << 8) | finfo[0]) & RX_FINFO_RXFL_MASK_1023;
+    if(pdw1000local->longFrames == 0)
+    {
+        len &= RX_FINFO_RXFLEN_MASK;
+    }
+    rec->cbData.datalength = len;
+
+    if(finfo[1] & (RX_FINFO_RNG >> 8))
+    {
+        rec->cbData.rx_flags |= DWT_CB_DATA_RX_FLAG_RNG;
+    }
+
+    // The whole (short) frame, the frame control comes with it
+    rec->framelength = (len < DWT_RXRECORD_FRAME_LEN) ? (uint8)len : DWT_RXRECORD_FRAME_LEN;
+    dwt_readfromdevice(RX_BUFFER_ID, 0, rec->framelength, rec->frame);
+    rec->cbData.fctrl[0] = rec->frame[0];
+    rec->cbData.fctrl[1] = rec->frame[1];
+
+    // RX time stamp, first path index and first path amplitude 1
+    dwt_readfromdevice(RX_TIME_ID, RX_TIME_RX_STAMP_OFFSET, RX_TIME_FP_RAWST_OFFSET, rec->rxtime);
+
+    // See dwt_isr() for the AAT issue, the bit is cleared together with the RX status bits
+    if((status & SYS_STATUS_AAT) && ((rec->frame[0] & FCTRL_ACK_REQ_MASK) == 0))
+    {
+        clear |= SYS_STATUS_AAT;
+        rec->cbData.status &= ~SYS_STATUS_AAT;
+        pdw1000local->wait4resp = 0;
+    }
+
+    if (clear)
+    {
+        dwt_write32bitreg(SYS_STATUS_ID, clear);
+    }
+
+    pdw1000local->cbRxRecord(rec);
+
+    if (pdw1000local->dblbuffon)
+    {
+        // Toggle the Host side Receive Buffer Pointer
+        dwt_write8bitoffsetreg(SYS_CTRL_ID, SYS_CTRL_HRBT_OFFSET, 1);
+    }
+}
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn dwt_checkirq()
  *
@@ -2360,9 +2905,12 @@ uint8 dwt_checkirq(void)
  *          - TXFRS (through cbTxDone callback)
  *          - RXRFTO/RXPTO (through cbRxTo callback)
  *          - RXPHE/RXFCE/RXRFSL/RXSFDTO/AFFREJ/LDEERR (through cbRxTo cbRxErr)
+ *          - RXOVRR (through cbRxErr)
  *        For all events, corresponding interrupts are cleared and necessary resets are performed. In addition, in the RXFCG case,
  *        received frame information and frame control are read before calling the callback. If double buffering is activated, it
  *        will also toggle between reception buffers once the reception callback processing has ended.
+ *        When an RX record callback is set (dwt_setrxrecordcallback()), the RXFCG event reads the frame and the RX timestamp
+ *        as well and calls cbRxRecord instead of cbRxOk, see _dwt_isrrxrecord().
  *
  *        /!\ This version of the ISR supports double buffering but does not support automatic RX re-enabling!
  *
@@ -2380,8 +2928,13 @@ void dwt_isr(void)
 {
     uint32 status = pdw1000local->cbData.status = dwt_read32bitreg(SYS_STATUS_ID); // Read status register low 32bits
 
+    // Handle RX good frame event with the minimal transaction sequence
+    if((status & SYS_STATUS_RXFCG) && (pdw1000local->cbRxRecord != NULL))
+    {
+        _dwt_isrrxrecord(status);
+    }
     // Handle RX good frame event
-    if(status & SYS_STATUS_RXFCG)
+    else if(status & SYS_STATUS_RXFCG)
     {
         uint16 finfo16;
         uint16 len;
@@ -2477,6 +3030,24 @@ void dwt_isr(void)
         }
     }
 
+    // Handle RX overrun, both RX buffers were full in double buffer mode (the interrupt is only enabled by receivers using it)
+    if(status & SYS_STATUS_RXOVRR)
+    {
+        dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_RXOVRR | SYS_STATUS_ALL_RX_GOOD); // Clear overrun and the RX events
+
+        pdw1000local->wait4resp = 0;
+
+        // The receiver has to be reset and the buffer pointers synchronised (dwt_forcetrxoff()) after an overrun
+        dwt_forcetrxoff();
+        dwt_rxreset();
+
+        // Call the corresponding callback if present
+        if(pdw1000local->cbRxErr != NULL)
+        {
+            pdw1000local->cbRxErr(&pdw1000local->cbData);
+        }
+    }
+
     // Handle RX errors events
     if(status & SYS_STATUS_ALL_RX_ERR)
     {
@@ -221,6 +221,24 @@ typedef struct
 // Call-back type for all events
 typedef void (*dwt_cb_t)(const dwt_cb_data_t *);
 
+// Number of frame bytes read by the dwt_isr() RX record path, longer frames are truncated (datalength is not)
+#ifndef DWT_RXRECORD_FRAME_LEN
+#define DWT_RXRECORD_FRAME_LEN  (48)
+#endif
+
+// RX good frame record of the dwt_isr() RX record path
+typedef struct
+{
+    dwt_cb_data_t cbData;                       //status, length, frame control and flags as for the cbRxOk callback
+    uint8  rxtime[9];                           //RX_TIME_ID bytes 0 to 8, LSB first: adjusted 40 bit RX time stamp,
+                                                //first path index (16 bit) and first path amplitude 1 (16 bit)
+    uint8  framelength;                         //number of valid bytes in frame: MIN(datalength, DWT_RXRECORD_FRAME_LEN)
+    uint8  frame[DWT_RXRECORD_FRAME_LEN];       //received frame, starting with the frame control
+} dwt_rxrecord_t;
+
+// Call-back type of the RX record
+typedef void (*dwt_rxrecord_cb_t)(const dwt_rxrecord_t *);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * Structure typedef: dwt_config_t
  *
@@ -241,6 +259,34 @@ typedef struct
     uint16 sfdTO ;         //!< SFD timeout value (in symbols)
 } dwt_config_t ;
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Structure typedef: dwt_regimage_t
+ *
+ * Register writes recorded by dwt_regimagebegin()/dwt_regimageend(), written again by dwt_regimageapply()
+ *
+ */
+#define DWT_REGIMAGE_RUNS       (24)        // SPI transactions of an image
+#define DWT_REGIMAGE_LEN        (128)       // data bytes of an image
+
+typedef struct
+{
+    uint8  recordNumber ;   //!< register file ID
+    uint8  length ;         //!< number of bytes of the run
+    uint16 index ;          //!< byte index of the first byte into the register file
+    uint16 data ;           //!< index of the first byte in the data of the image
+} dwt_regrun_t ;
+
+typedef struct
+{
+    uint8  runs ;           //!< number of runs, 0 : empty
+    uint8  longFrames ;     //!< local state of the device after the captured writes
+    uint16 used ;           //!< number of data bytes
+    uint32 sysCFGbits ;
+    uint32 txFCTRL ;
+    dwt_regrun_t run[DWT_REGIMAGE_RUNS] ;
+    uint8  data[DWT_REGIMAGE_LEN] ;
+} dwt_regimage_t ;
+
 
 typedef struct
 {
@@ -255,6 +301,17 @@ typedef struct
 dwt_txconfig_t ;
 
 
+typedef struct
+{
+    uint32  partID ;            // IC Part ID
+    uint32  lotID ;             // IC Lot ID
+    uint8   vBatP ;             // IC V bat read during production and stored in OTP (Vmeas @ 3V3)
+    uint8   tempP ;             // IC V temp read during production and stored in OTP (Tmeas @ 23C)
+    uint8   otprev ;            // OTP revision number
+}
+dwt_otpvalues_t ;
+
+
 typedef struct
 {
 
@@ -409,6 +466,38 @@ uint32 dwt_getpartid(void);
  */
 uint32 dwt_getlotid(void);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_getotpvalues()
+ *
+ * @brief This is used to return the OTP values read by dwt_initialise(), so the host can store them and restore them
+ *        with dwt_setotpvalues() when it re-initialises a DW1000 which kept running (DWT_DW_WAKE_UP)
+ *
+ * NOTE: dwt_initialise() must be called prior to this function so that it can return relevant values.
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param otp - the part ID, lot ID, reference voltage/temperature and OTP revision
+ *
+ * no return value
+ */
+void dwt_getotpvalues(dwt_otpvalues_t *otp);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_setotpvalues()
+ *
+ * @brief This is used to set the OTP values of the local data instead of reading them from OTP, i.e. after
+ *        dwt_initialise(DWT_DW_WAKE_UP) without the DWT_READ_OTP_xx options
+ *
+ * input parameters
+ * @param otp - values previously returned by dwt_getotpvalues() for this device
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_setotpvalues(const dwt_otpvalues_t *otp);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn dwt_readdevid()
  *
@@ -596,6 +685,21 @@ void dwt_configurefor64plen(int prf);
  */
 void dwt_configure(dwt_config_t *config) ;
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_configurepreamblecode()
+ *
+ * @brief This function writes the TX and RX preamble codes of config (CHAN_CTRL and the LDE replica coefficient)
+ * without the rest of dwt_configure(). The other settings of config must be those of the last dwt_configure()
+ *
+ * input parameters
+ * @param config    -   pointer to the configuration structure
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_configurepreamblecode(const dwt_config_t *config) ;
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn dwt_configuretxrf()
  *
@@ -1144,6 +1248,27 @@ int dwt_spicswakeup(uint8 *buff, uint16 length);
  */
 void dwt_setcallbacks(dwt_cb_t cbTxDone, dwt_cb_t cbRxOk, dwt_cb_t cbRxTo, dwt_cb_t cbRxErr);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_setrxrecordcallback()
+ *
+ * @brief This function is used to register the RX record callback. When it is set, dwt_isr() handles a good frame
+ *        (RXFCG) with a fixed sequence of SPI bursts: frame information, frame (up to DWT_RXRECORD_FRAME_LEN bytes) and
+ *        RX timestamp with the first path index and amplitude, and one status clear. The record is passed to cbRxRecord
+ *        instead of calling cbRxOk, so the callback does not have to read the frame or the timestamp again.
+ *        In double buffer mode (dwt_setdblrxbuffmode()) the receiver is re-enabled before the frame is read, so a frame
+ *        arriving back to back is received into the other buffer (continuous RX).
+ *
+ * NOTE: the record is only valid during the callback.
+ *
+ * input parameters
+ * @param cbRxRecord - the pointer to the RX record callback function, NULL to use cbRxOk (default)
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_setrxrecordcallback(dwt_rxrecord_cb_t cbRxRecord);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn dwt_checkirq()
  *
@@ -1751,6 +1876,82 @@ uint32 dwt_calcpowertempadj(uint8 channel, uint32 ref_powerreg, int delta_temp);
  */
 uint16 dwt_calcpgcount(uint8 pgdly);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_writebatchbegin()
+ *
+ * @brief  this function starts a batch of register writes: until the matching dwt_writebatchend() the writes are
+ *         queued and a write which continues the previous one in the same register file (next offset) is merged
+ *         into the same SPI transaction. Calls can be nested, the DW1000 interrupt is disabled while the batch is open.
+ *
+ * NOTE: the writes are executed in the order they were made, a read flushes the queue first.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_writebatchbegin(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_writebatchend()
+ *
+ * @brief  this function closes a batch opened by dwt_writebatchbegin(), the outermost call writes the queued
+ *         registers to the DW1000
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_writebatchend(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_regimagebegin()
+ *
+ * @brief  this function starts the capture of a register image: until dwt_regimageend() the register writes, e.g. of
+ *         dwt_configure() and dwt_configuretxrf(), are recorded into img instead of being written to the DW1000.
+ *         The writes merge into runs as in a batch, dwt_regimageapply() writes them again without the derivation of
+ *         the register values. The DW1000 interrupt is disabled during the capture, there must be no register reads.
+ *
+ * input parameters
+ * @param img - the image to fill
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_regimagebegin(dwt_regimage_t *img);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_regimageend()
+ *
+ * @brief  this function ends the capture of dwt_regimagebegin()
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS, or DWT_ERROR if the writes did not fit into DWT_REGIMAGE_RUNS/DWT_REGIMAGE_LEN
+ */
+int dwt_regimageend(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_regimageapply()
+ *
+ * @brief  this function writes a register image to the DW1000, one SPI transaction per run, and updates the local
+ *         state of the device (SYS_CFG bits, TX_FCTRL, long frames) as the captured functions did
+ *
+ * input parameters
+ * @param img - image filled by dwt_regimagebegin()/dwt_regimageend()
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_regimageapply(const dwt_regimage_t *img);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn dwt_writetodevice()
  *
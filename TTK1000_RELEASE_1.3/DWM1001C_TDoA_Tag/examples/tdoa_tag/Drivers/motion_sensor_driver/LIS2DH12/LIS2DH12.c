@@ -35,6 +35,18 @@ typedef struct sFifoXYZelement tsFifoElement;
 // Storage for LIS2 FIFO samples
 static tsFifoElement atsFifo[MAX_FIFO_SIZE];
 
+// Size of one X,Y,Z sample in the output registers
+#define XYZ_BYTES   6
+
+// Non-blocking FIFO read in progress
+static int16_t (*pai16FifoDst)[3];
+static uint8_t u8FifoMax;
+static uint8_t u8FifoNum;
+static tpfLIS2_FifoDone pfFifoDone;
+
+// FIFO_SRC_REG, INT1_CFG, INT1_SRC, read in one burst
+static uint8_t au8FifoStat[3];
+
 // Seamphores for events
 static volatile bool boInterruptEvent = false;
 
@@ -57,6 +69,10 @@ enum AccelRES eRsolution;
 static void vInterruptInit(void);
 static void vThresholdConfigure(uint8_t u8Level, uint8_t u8Duration, uint8_t u8Mode);
 static void vDumpFifo(uint8_t u8Num);
+static uint8_t u8FifoCount(uint8_t u8Max);
+static void vRightJustify(int16_t *pi16Data, uint16_t u16Num);
+static void vFifoStatDone(bool boOk, void *pvContext);
+static void vFifoDataDone(bool boOk, void *pvContext);
 
 // Public interface functions
 
@@ -144,13 +160,20 @@ void vLIS2_EnableInactivityDetect (void)
     vThresholdConfigure (THS_FS2G_32mg, 30, (XLIE | YLIE | ZLIE));
 }
 
-void vLIS2_EnableFifoSampling (void)
+/*!
+* @brief Enable streaming of X,Y,Z samples into the FIFO.
+*
+* Inputs: u8Odr - sample rate, ODR_xx
+*         u8Watermark - number of samples (< MAX_FIFO_SIZE) which
+*         raise the INT1 watermark interrupt
+*/
+void vLIS2_EnableFifoSampling (uint8_t u8Odr, uint8_t u8Watermark)
 {
     // Set semaphore, no FIFO event yet
     boInterruptEvent = false;
 
-  // Enable X,Y,Z sensors and set a default sample rate
-    vTWI_Write(CTRL_REG1, (ODR_10Hz | X_EN | Y_EN | Z_EN));
+  // Enable X,Y,Z sensors and set the requested sample rate
+    vTWI_Write(CTRL_REG1, (u8Odr | X_EN | Y_EN | Z_EN));
 
     // Disable high-pass filtering
     vTWI_Write(CTRL_REG2, 0);
@@ -173,7 +196,7 @@ void vLIS2_EnableFifoSampling (void)
 
     // Set FIFO to streaming mode, set level of high watermark and
     // enable interrupt on reaching high watermark
-    vTWI_Write(FIFO_CTRL_REG, (STREAM_MODE | TR_INT1 | FIFO_WATERMARK_30));
+    vTWI_Write(FIFO_CTRL_REG, (STREAM_MODE | TR_INT1 | (u8Watermark & FSS_MASK)));
 }
 
 
@@ -204,6 +227,75 @@ uint8_t u8LIS2_EventStatus (void)
     return u8status;
 }
 
+/*!
+* @brief Read the current X,Y,Z acceleration from the output registers.
+*
+* Returned values are signed and right justified for the selected
+* resolution (1mg/digit in 12-bit mode at +/- 2g).
+* Note, in FIFO mode this reads (pops) the oldest FIFO sample.
+*/
+void vLIS2_ReadXYZ (int16_t *pi16X, int16_t *pi16Y, int16_t *pi16Z)
+{
+    int16_t ai16XYZ[3];
+
+    // X,Y,Z low and high bytes in a single transfer
+    vTWI_ReadBurst((OUT_X_LO | AUTO_INCREMENT), (uint8_t *)ai16XYZ, XYZ_BYTES);
+    vRightJustify(ai16XYZ, 3);
+
+    *pi16X = ai16XYZ[0];
+    *pi16Y = ai16XYZ[1];
+    *pi16Z = ai16XYZ[2];
+}
+
+/*!
+* @brief Copy the FIFO samples to the caller.
+*
+* Clears the latched watermark interrupt, then reads up to u8Max
+* samples, signed and right justified as by vLIS2_ReadXYZ().
+* Returns the number of samples read.
+*/
+uint8_t u8LIS2_ReadFifo (int16_t ai16XYZ[][3], uint8_t u8Max)
+{
+    uint8_t u8NumReadings;
+
+    // Find number of FIFO samples, reading INT1_SRC in the same
+    // burst clears the interrupt source
+    vTWI_ReadBurst((FIFO_SRC_REG | AUTO_INCREMENT), au8FifoStat, sizeof(au8FifoStat));
+    u8NumReadings = u8FifoCount(u8Max);
+
+    if (u8NumReadings > 0)
+    {
+        // All the samples in a single transfer
+        vTWI_ReadBurst((OUT_X_LO | AUTO_INCREMENT), (uint8_t *)ai16XYZ, u8NumReadings * XYZ_BYTES);
+        vRightJustify(&ai16XYZ[0][0], u8NumReadings * 3);
+    }
+
+    return u8NumReadings;
+}
+
+/*!
+* @brief Start copying the FIFO samples to the caller, without blocking.
+*
+* Same as u8LIS2_ReadFifo() but the two transfers run from the TWI
+* interrupt: pfDone is called with the number of samples once they are
+* in ai16XYZ (0 on a TWI error), the buffer must remain valid until then.
+* Returns false if a TWI transfer is already in progress.
+*/
+bool boLIS2_ReadFifoAsync (int16_t ai16XYZ[][3], uint8_t u8Max, tpfLIS2_FifoDone pfDone)
+{
+    if (boTWI_Busy())
+    {
+        return false;
+    }
+
+    pai16FifoDst = ai16XYZ;
+    u8FifoMax = u8Max;
+    pfFifoDone = pfDone;
+
+    return boTWI_ReadBurstAsync((FIFO_SRC_REG | AUTO_INCREMENT), au8FifoStat, sizeof(au8FifoStat),
+                                vFifoStatDone, NULL);
+}
+
 /*!
 * @brief Polled function call that checks for FIFO full events
 * and then copies the LIS2 internal FIFO to a local structure.
@@ -213,37 +305,16 @@ void vLIS2_Task (void)
 {
     if (boInterruptEvent)
     {
-        uint8_t u8FifoStat;
         uint8_t u8NumReadings;
 
-        // clear the interrupt source, ignore status reg contents
-        vTWI_Read(INT1_SRC, &u8FifoStat);
-
-        // Find number of FIFO samples
-        vTWI_Read(FIFO_SRC_REG, &u8FifoStat);
-        u8NumReadings = u8FifoStat & FSS_MASK;
+        // Find number of FIFO samples and clear the interrupt source
+        vTWI_ReadBurst((FIFO_SRC_REG | AUTO_INCREMENT), au8FifoStat, sizeof(au8FifoStat));
+        u8NumReadings = u8FifoCount(MAX_FIFO_SIZE);
 
         // Read all LIS2 FIFO samples to local structure
-        uint8_t u8Cnt, u8Reading, u8LoData;
-        for (u8Cnt=0; u8Cnt < u8NumReadings; u8Cnt++)
+        if (u8NumReadings > 0)
         {
-            // X-axis
-            vTWI_Read(OUT_X_LO, &u8Reading);
-            u8LoData = u8Reading;
-            vTWI_Read(OUT_X_HI, &u8Reading);
-            atsFifo[u8Cnt].u16_X = ( (u8Reading << 8) | u8LoData);
-
-            // Y-axis
-            vTWI_Read(OUT_Y_LO, &u8Reading);
-            u8LoData = u8Reading;
-            vTWI_Read(OUT_Y_HI, &u8Reading);
-            atsFifo[u8Cnt].u16_Y = ( (u8Reading << 8) | u8LoData);
-
-            // Z-axis
-            vTWI_Read(OUT_Z_LO, &u8Reading);
-            u8LoData = u8Reading;
-            vTWI_Read(OUT_Z_HI, &u8Reading);
-            atsFifo[u8Cnt].u16_Z = ( (u8Reading << 8) | u8LoData);
+            vTWI_ReadBurst((OUT_X_LO | AUTO_INCREMENT), (uint8_t *)atsFifo, u8NumReadings * XYZ_BYTES);
         }
 
         // Send samples to STDOUT
@@ -324,6 +395,68 @@ static void vThresholdConfigure (uint8_t u8Level, uint8_t u8Duration, uint8_t u8
     vTWI_Write(INT1_CFG, u8Mode);
 }
 
+/*!
+* @brief Number of FIFO samples from the FIFO_SRC_REG in au8FifoStat,
+* limited to u8Max.
+*/
+static uint8_t u8FifoCount(uint8_t u8Max)
+{
+    uint8_t u8Num = au8FifoStat[0] & FSS_MASK;
+
+    return (u8Num > u8Max) ? u8Max : u8Num;
+}
+
+/*!
+* @brief Convert samples read straight from the output registers into
+* signed, right justified values, in place. The registers hold each axis
+* low byte first, i.e. in the (little endian) int16_t layout of the MCU.
+*/
+static void vRightJustify(int16_t *pi16Data, uint16_t u16Num)
+{
+    uint16_t u16Cnt;
+
+    for (u16Cnt = 0; u16Cnt < u16Num; u16Cnt++)
+    {
+        pi16Data[u16Cnt] /= (1 << u8SignExtend);
+    }
+}
+
+/*!
+* @brief TWI callback of the FIFO status read started by
+* boLIS2_ReadFifoAsync(), starts the read of the samples.
+*/
+static void vFifoStatDone(bool boOk, void *pvContext)
+{
+    u8FifoNum = u8FifoCount(u8FifoMax);
+
+    if (boOk && (u8FifoNum > 0))
+    {
+        if (boTWI_ReadBurstAsync((OUT_X_LO | AUTO_INCREMENT), (uint8_t *)pai16FifoDst,
+                                 u8FifoNum * XYZ_BYTES, vFifoDataDone, NULL))
+        {
+            return;
+        }
+    }
+
+    vFifoDataDone(false, NULL);
+}
+
+/*!
+* @brief TWI callback of the FIFO samples read, completes
+* boLIS2_ReadFifoAsync().
+*/
+static void vFifoDataDone(bool boOk, void *pvContext)
+{
+    uint8_t u8Num = (boOk) ? u8FifoNum : 0;
+
+    vRightJustify(&pai16FifoDst[0][0], u8Num * 3);
+
+    if (pfFifoDone != NULL)
+    {
+        pfFifoDone(u8Num);
+    }
+}
+
 /*!
 * @brief Send the local copy of the LIS2DH12 FIFO samples to STDOUT.
 */
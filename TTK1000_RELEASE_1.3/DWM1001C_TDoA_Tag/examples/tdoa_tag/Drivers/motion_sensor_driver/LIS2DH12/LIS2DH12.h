@@ -16,6 +16,10 @@
 
 #include "nrf_drv_gpiote.h"
 
+// Completion callback of boLIS2_ReadFifoAsync(), called from the
+// TWI interrupt with the number of samples read
+typedef void (*tpfLIS2_FifoDone)(uint8_t u8Num);
+
 // Public interface functions
 void vLIS2_Init(void);
 uint8_t u8LIS2_TestRead(void);
@@ -23,10 +27,13 @@ void vLIS2_Task(void);
 void vLIS2_PowerDown(void);
 void vLIS2_EnableWakeUpDetect(void);
 void vLIS2_EnableInactivityDetect(void);
-void vLIS2_EnableFifoSampling(void);
+void vLIS2_EnableFifoSampling(uint8_t u8Odr, uint8_t u8Watermark);
 bool boLIS2_InterruptOccurred(void);
 void boLIS2_InterruptClear (void);
 uint8_t u8LIS2_EventStatus(void);
+void vLIS2_ReadXYZ(int16_t *pi16X, int16_t *pi16Y, int16_t *pi16Z);
+uint8_t u8LIS2_ReadFifo(int16_t ai16XYZ[][3], uint8_t u8Max);
+bool boLIS2_ReadFifoAsync(int16_t ai16XYZ[][3], uint8_t u8Max, tpfLIS2_FifoDone pfDone);
 void vInterruptHandler(void);
 
 // Threshold event status bits
@@ -13,6 +13,12 @@
 *  Author: Decawave, 2018
 */
 
+// Sub address MSB: increment the register address for each byte
+// of a multiple byte read. When the FIFO is enabled a read from
+// OUT_X_LO wraps around from OUT_Z_HI back to OUT_X_LO, so a single
+// burst drains several samples (AN5005).
+#define AUTO_INCREMENT  0x80
+
 // Registers, ordered by address
 #define WHO_AM_I    0x0f
 #define I_AM        0x33
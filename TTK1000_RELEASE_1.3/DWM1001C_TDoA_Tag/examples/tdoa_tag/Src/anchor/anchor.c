@@ -0,0 +1,237 @@
+/*
+ * @file       anchor.c
+ *
+ * @brief      TDoA anchor: continuous double buffered reception of the tag
+ *             blinks and their report to the host
+ *
+ *             The DW1000 receives in double buffer mode: the RX record path
+ *             of dwt_isr() re-enables the receiver into the other buffer
+ *             before it reads the frame, so a blink arriving right after
+ *             another one is not lost. The RX record callback keeps only the
+ *             IEEE EUI-64 blinks and stores them into the blink ring, the main
+ *             loop sends them in batches as binary frames (cmd_bin.h):
+ *
+ *             | SOF | LEN | CMD_BIN_BLINKS n x blink_rec_t | [CMD_BIN_DROPS] | CRC |
+ *
+ *             CMD_BIN_DROPS is added when the drop or error counters changed.
+ *             The RX events are passed on to cir_stream.c as well, which
+ *             sends CIR captures of some of the blinks in frames of their own.
+ *
+ * @author     Decawave Software
+ *
+ * @attention  Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *             All rights reserved.
+ */
+
+#include "port_platform.h"
+#include "deca_device_api.h"
+#include "pckt_ieee.h"
+#include "cmd_bin.h"
+#include "blink_ring.h"
+#include "cir_stream.h"
+#include "radio_stats.h"
+#include "anchor.h"
+
+/* records of one CMD_BIN_BLINKS TLV (8 bit TLV length) */
+#define ANCHOR_BATCH_MAX        (255 / BLINK_REC_LEN)
+/* longest time a blink waits for its batch to fill, in ms */
+#define ANCHOR_BATCH_MS         (10)
+
+#define ANCHOR_DROPS_LEN        (8)
+
+/* RX events handled by dwt_isr() */
+#define ANCHOR_RX_INTERRUPTS    (DWT_INT_RFCG | DWT_INT_RPHE | DWT_INT_RFCE | DWT_INT_RFSL | \
+                                 DWT_INT_SFDT | DWT_INT_ARFE | DWT_INT_RXOVRR)
+
+#ifndef MIN
+#define MIN(a,b)        (((a) < (b)) ? (a) : (b))
+#endif /* MIN */
+
+static uint8  anchor_frame[CMD_BIN_HDR_LEN + 2 + ANCHOR_BATCH_MAX * BLINK_REC_LEN \
+                           + 2 + ANCHOR_DROPS_LEN + CMD_BIN_CRC_LEN];
+
+static volatile uint32  anchor_rx_errors;   // written in IRQ context only
+static uint32           anchor_rep_dropped;
+static uint32           anchor_rep_errors;
+static uint32           anchor_batch_tick;  // arrival of the oldest waiting blink
+static uint8            anchor_batch_wait;
+
+/*
+ * @fn      anchor_put32
+ * @brief   little endian 32 bit value
+ * */
+static void anchor_put32(uint8 *p, uint32 val)
+{
+    p[0] = (uint8)(val);
+    p[1] = (uint8)(val >> 8);
+    p[2] = (uint8)(val >> 16);
+    p[3] = (uint8)(val >> 24);
+}
+
+/*
+ * @fn      anchor_rx_record
+ * @brief   RX good frame, called from dwt_isr() with the frame, the RX time
+ *          stamp and the first path values already read
+ * */
+static void anchor_rx_record(const dwt_rxrecord_t *rec)
+{
+    blink_rec_t blink;
+
+    radio_stats_count(RADIO_STATS_APP_RX);
+
+    if((rec->framelength < FRAME_CRTL_AND_ADDRESS) || (rec->frame[0] != FCS_EUI_64))
+    {
+        return; // not a blink
+    }
+
+    memcpy(blink.rxtime, &rec->rxtime[0], sizeof(blink.rxtime));
+    memcpy(blink.fpindex, &rec->rxtime[5], sizeof(blink.fpindex));
+    memcpy(blink.fpampl, &rec->rxtime[7], sizeof(blink.fpampl));
+    blink.seqNum = rec->frame[FRAME_CONTROL_BYTES];
+    memcpy(blink.eui64, &rec->frame[FRAME_CTRLP], sizeof(blink.eui64));
+
+    if(blink_ring_put(&blink) < 0)
+    {
+        radio_stats_count(RADIO_STATS_APP_DROP);
+    }
+
+    cir_stream_rx(rec);
+}
+
+/*
+ * @fn      anchor_rx_error
+ * @brief   RX error or overrun, dwt_isr() has reset the receiver, turn it on
+ *          again with the RX buffer pointers in sync
+ * */
+static void anchor_rx_error(const dwt_cb_data_t *rxd)
+{
+    anchor_rx_errors++;
+    radio_stats_count(RADIO_STATS_APP_RXERR);
+
+    cir_stream_rx(NULL);
+
+    dwt_rxenable(DWT_START_RX_IMMEDIATE);
+}
+
+/**
+ * @fn      anchor_init
+ * @brief   initialise the DW1000 for continuous reception
+ * */
+int anchor_init(param_block_t *pbss)
+{
+    decaIrqStatus_t stat;
+    int result;
+
+    stat = decamutexon();
+
+    // Set SPI clock to 2MHz for the initialisation
+    port_set_dw1000_slowrate();
+
+    if(dwt_readdevid() != DWT_DEVICE_ID)
+    {
+        port_wakeup_dw1000();
+        if(dwt_readdevid() != DWT_DEVICE_ID)
+        {
+            decamutexoff(stat);
+            return -1;
+        }
+    }
+
+    // The LDE microcode computes the RX time stamps
+    result = dwt_initialise(DWT_LOADUCODE);
+
+    port_set_dw1000_fastrate();
+
+    if(result != DWT_SUCCESS)
+    {
+        decamutexoff(stat);
+        return -1;
+    }
+
+    dwt_configure(&pbss->dwt_config);
+    dwt_setrxantennadelay(RX_ANT_DLY);
+    dwt_setrxtimeout(0);
+
+    dwt_setcallbacks(NULL, NULL, anchor_rx_error, anchor_rx_error);
+    dwt_setrxrecordcallback(anchor_rx_record);
+    dwt_setdblrxbuffmode(1);
+    dwt_setinterrupt(ANCHOR_RX_INTERRUPTS, 1);
+
+    decamutexoff(stat);
+
+    radio_stats_start();
+    cir_stream_init(&pbss->dwt_config);
+
+    return 0;
+}
+
+/**
+ * @fn      anchor_rx_start
+ * @brief   turn the receiver on
+ * */
+void anchor_rx_start(void)
+{
+    dwt_rxenable(DWT_START_RX_IMMEDIATE);
+}
+
+/**
+ * @fn      anchor_run
+ * @brief   send the waiting blinks in batches
+ * */
+void anchor_run(void)
+{
+    uint8  *tlv = &anchor_frame[CMD_BIN_HDR_LEN];
+    uint8  n = blink_ring_count();
+    uint32 dropped, errors;
+    uint16 len;
+    int    i;
+
+    if(n == 0)
+    {
+        return;
+    }
+
+    if(n < ANCHOR_BATCH_MAX)
+    {
+        // wait for more blinks, but not longer than ANCHOR_BATCH_MS
+        if(!anchor_batch_wait)
+        {
+            anchor_batch_wait = 1;
+            anchor_batch_tick = portGetTickCount();
+            return;
+        }
+        if((portGetTickCount() - anchor_batch_tick) < ANCHOR_BATCH_MS)
+        {
+            return;
+        }
+    }
+
+    anchor_batch_wait = 0;
+    n = MIN(n, ANCHOR_BATCH_MAX);
+
+    tlv[0] = CMD_BIN_BLINKS;
+    tlv[1] = (uint8)(n * BLINK_REC_LEN);
+    for(i = 0; i < n; i++)
+    {
+        blink_ring_get((blink_rec_t *)&tlv[2 + i * BLINK_REC_LEN]);
+    }
+    len = 2 + tlv[1];
+
+    dropped = blink_ring_dropped();
+    errors = anchor_rx_errors;
+    if((dropped != anchor_rep_dropped) || (errors != anchor_rep_errors))
+    {
+        tlv[len] = CMD_BIN_DROPS;
+        tlv[len + 1] = ANCHOR_DROPS_LEN;
+        anchor_put32(&tlv[len + 2], dropped);
+        anchor_put32(&tlv[len + 6], errors);
+        len += 2 + ANCHOR_DROPS_LEN;
+
+        anchor_rep_dropped = dropped;
+        anchor_rep_errors = errors;
+    }
+
+    cmd_bin_send(anchor_frame, len);
+
+    LEDS_INVERT(BSP_LED_3_MASK);
+}
@@ -0,0 +1,52 @@
+/*
+ * @file       anchor.h
+ *
+ * @brief      TDoA anchor: continuous double buffered reception of the tag
+ *             blinks and their report to the host
+ *
+ * @author     Decawave Software
+ *
+ * @attention  Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *             All rights reserved.
+ */
+
+#ifndef _ANCHOR_H_
+#define _ANCHOR_H_ 1
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "default_config.h"
+
+/**
+ * Initialise the DW1000 for reception: LDE microcode, the channel
+ * configuration of pbss, double buffering and the RX record callback.
+ *
+ * @param[in] pbss : configuration (dwt_config)
+ * @return 0 on success, -1 if the DW1000 does not answer or fails to
+ *         initialise
+ */
+int anchor_init(param_block_t *pbss);
+
+/**
+ * Turn the receiver on, it stays on from then (continuous RX)
+ *
+ * @return none
+ */
+void anchor_rx_start(void);
+
+/**
+ * Report the received blinks to the host: a CMD_BIN_BLINKS frame is sent
+ * when a full batch is waiting or the oldest blink waited ANCHOR_BATCH_MS.
+ * Called from the main loop.
+ *
+ * @return none
+ */
+void anchor_run(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ANCHOR_H_ */
@@ -0,0 +1,93 @@
+/*
+ * @file       anchor_main.c
+ *
+ * @brief      TDoA Anchor Application
+ *
+ *             Receives the blinks of the TDoA tags continuously and reports
+ *             them to the host over the UART, see anchor.c. The radio
+ *             settings are the dwt_config of the configuration (config.c).
+ *             The host may query the radio counters (radio_stats.c) with a
+ *             binary frame of cmd_bin.h.
+ *
+ * @author     Decawave
+ *
+ * @attention  Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *             All rights reserved.
+ *
+ */
+
+#include "port_platform.h"
+#include "deca_device_api.h"
+#include "default_config.h"
+#include "instance.h"
+#include "config.h"
+#include "anchor.h"
+#include "cir_stream.h"
+#include "cmd_bin.h"
+#include "radio_stats.h"
+#include "mem_arena.h"
+
+/* Configuration in default_config.h, kept by config.c */
+app_cfg_t app;
+
+/* @fn      anchor_uartmsg
+ * @brief   the anchor takes the binary frames of cmd_bin.h only, e.g. the
+ *          CMD_BIN_STATS query of the host, text is discarded
+ * */
+static void anchor_uartmsg(void)
+{
+    char *rx_buf = MEM_ARENA(MEM_UART_MSG);
+    int  uartLen;
+
+    uartLen = deca_uart_receive(rx_buf, MEM_ARENA_SIZE(MEM_UART_MSG));
+    mem_arena_mark(MEM_UART_MSG, uartLen);
+
+    if((uartLen > 1) && ((uint8_t)rx_buf[0] == CMD_BIN_SOF))
+    {
+        /* deca_uart_receive() counts the terminating 0 */
+        command_bin_parser((uint8_t *)rx_buf, uartLen - 1);
+    }
+}
+
+int main(void)
+{
+    mem_arena_init();
+
+    LEDS_CONFIGURE(BSP_LED_0_MASK | BSP_LED_1_MASK | BSP_LED_2_MASK | BSP_LED_3_MASK);
+    LEDS_OFF(BSP_LED_0_MASK | BSP_LED_1_MASK | BSP_LED_2_MASK | BSP_LED_3_MASK);
+
+    memset(&app,0,sizeof(app));
+
+    peripherals_init();
+
+    /* reset decawave */
+    reset_DW1000();
+
+    /* set default PRF and bit rate etc.. */
+    load_bssConfig();                 /**< load the RAM Configuration parameters from NVM block */
+    app.pConfig = get_pbssConfig();
+
+    if(anchor_init(app.pConfig) < 0)
+    {
+        return -1; // Failed to initialise the DW1000
+    }
+
+    anchor_rx_start();
+
+    // No RTOS task here so just call the main loop here.
+    while(1)
+    {
+        anchor_run();
+        cir_stream_run();
+        radio_stats_run();
+        if(deca_uart_rx_data_ready())
+        {
+            anchor_uartmsg();
+        }
+
+        // nothing to do until a blink is received (the RX record callback
+        // signals it) or the SysTick ends the batch wait, a CIR capture
+        // keeps it awake while its chunks are read
+        __WFE();
+    }
+}
@@ -0,0 +1,90 @@
+/*
+ * @file       blink_ring.c
+ *
+ * @brief      lock-free single producer / single consumer ring of the blinks
+ *             received by the anchor
+ *
+ *             The indices run freely over 0..255, the ring holds
+ *             (uint8)(in - out) records. The producer publishes a record by
+ *             advancing in after the record is stored, the consumer releases
+ *             it by advancing out after it is copied.
+ *
+ * @author     Decawave Software
+ *
+ * @attention  Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *             All rights reserved.
+ */
+
+#include "port_platform.h"
+#include "blink_ring.h"
+
+#if (BLINK_RING_SIZE & (BLINK_RING_SIZE - 1)) || (BLINK_RING_SIZE > 128)
+#error "BLINK_RING_SIZE must be a power of 2 and at most 128"
+#endif
+
+static blink_rec_t      blink_ring[BLINK_RING_SIZE];
+static volatile uint8   blink_in;       // written by the producer only
+static volatile uint8   blink_out;      // written by the consumer only
+static volatile uint32  blink_dropped;  // written by the producer only
+
+/**
+ * @fn      blink_ring_put
+ * @brief   store a record, IRQ context
+ * */
+int blink_ring_put(const blink_rec_t *rec)
+{
+    uint8 in = blink_in;
+
+    if((uint8)(in - blink_out) >= BLINK_RING_SIZE)
+    {
+        blink_dropped++;
+        return -1;
+    }
+
+    memcpy(&blink_ring[in & (BLINK_RING_SIZE - 1)], rec, BLINK_REC_LEN);
+    __DMB(); // the record must be stored before it is published
+    blink_in = in + 1;
+
+    __SEV(); // wake up the main loop if it is waiting in WFE
+
+    return 0;
+}
+
+/**
+ * @fn      blink_ring_get
+ * @brief   take the oldest record
+ * */
+int blink_ring_get(blink_rec_t *rec)
+{
+    uint8 out = blink_out;
+
+    if(out == blink_in)
+    {
+        return 0;
+    }
+
+    __DMB(); // the record is read after it was published
+    memcpy(rec, &blink_ring[out & (BLINK_RING_SIZE - 1)], BLINK_REC_LEN);
+    __DMB(); // and copied before the slot is released to the producer
+    blink_out = out + 1;
+
+    return 1;
+}
+
+/**
+ * @fn      blink_ring_count
+ * @brief   number of records in the ring
+ * */
+uint8 blink_ring_count(void)
+{
+    return (uint8)(blink_in - blink_out);
+}
+
+/**
+ * @fn      blink_ring_dropped
+ * @brief   number of records dropped because the ring was full
+ * */
+uint32 blink_ring_dropped(void)
+{
+    return blink_dropped;
+}
@@ -0,0 +1,73 @@
+/*
+ * @file       blink_ring.h
+ *
+ * @brief      lock-free single producer / single consumer ring of the blinks
+ *             received by the anchor
+ *
+ *             The producer is the dwt_isr() RX record callback (DW1000 IRQ),
+ *             the consumer is the main loop. Each index is written by one
+ *             side only, so no critical section is needed.
+ *
+ * @author     Decawave Software
+ *
+ * @attention  Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *             All rights reserved.
+ */
+
+#ifndef _BLINK_RING_H_
+#define _BLINK_RING_H_ 1
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "deca_types.h"
+#include "pckt_ieee.h"
+
+/* number of records, must be a power of 2 and at most 128 */
+#define BLINK_RING_SIZE         (64)
+
+/* received blink, also the record format on the host link (all bytes,
+ * little endian, no padding) */
+typedef struct
+{
+    uint8   rxtime[5];                  // 40 bit RX time stamp
+    uint8   eui64[EUI64_ADDR_SIZE];     // tag ID
+    uint8   seqNum;                     // blink sequence number
+    uint8   fpindex[2];                 // first path index (10.6 fixed point)
+    uint8   fpampl[2];                  // first path amplitude 1
+} blink_rec_t;
+
+#define BLINK_REC_LEN           (sizeof(blink_rec_t))
+
+/**
+ * Store a record, called by the producer only.
+ *
+ * @param[in] rec : received blink
+ * @return 0 on success, -1 if the ring is full (the record is dropped)
+ */
+int blink_ring_put(const blink_rec_t *rec);
+
+/**
+ * Take the oldest record, called by the consumer only.
+ *
+ * @param[out] rec : received blink
+ * @return 1 if rec is valid, 0 if the ring is empty
+ */
+int blink_ring_get(blink_rec_t *rec);
+
+/**
+ * @return number of records in the ring
+ */
+uint8 blink_ring_count(void);
+
+/**
+ * @return number of records dropped because the ring was full
+ */
+uint32 blink_ring_dropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BLINK_RING_H_ */
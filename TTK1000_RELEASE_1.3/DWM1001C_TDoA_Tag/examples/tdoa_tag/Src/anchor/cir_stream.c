@@ -0,0 +1,286 @@
+/*
+ * @file       cir_stream.c
+ *
+ * @brief      TDoA anchor: streaming of channel impulse response captures
+ *             to the host
+ *
+ *             The RX record callback latches the blink of a capture, the
+ *             main loop reads its accumulator window one chunk per call:
+ *             a chunk is a single DMA transfer of readfromspi(), about
+ *             0.25 ms at 8 MHz, instead of 4 ms for the whole accumulator.
+ *
+ *             The accumulator is overwritten by the next preamble, whatever
+ *             the RX double buffering, so a capture is dropped when another
+ *             RX event or a preamble is seen before it is complete. It is
+ *             sent CIR_SETTLE_MS after the blink at the earliest, when the
+ *             frame of a preamble that started before the blink callback
+ *             has ended with an RX event.
+ *
+ * @author     Decawave Software
+ *
+ * @attention  Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *             All rights reserved.
+ */
+
+#include <math.h>
+#include "port_platform.h"
+#include "deca_device_api.h"
+#include "deca_regs.h"
+#include "pckt_ieee.h"
+#include "cmd_bin.h"
+#include "cir_stream.h"
+
+#define CIR_TAP_LEN             (4)
+/* taps of one chunk, one DMA transfer with the dummy octet */
+#define CIR_CHUNK_TAPS          (63)
+/* longest CMD_BIN_CIR_DATA value, a multiple of both tap formats */
+#define CIR_DATA_MAX            (252)
+#define CIR_DATA_TLVS           ((CIR_TAPS_MAX * CIR_TAP_LEN + CIR_DATA_MAX - 1) / CIR_DATA_MAX)
+/* longest blink frame: 4096 symbol preamble at 110 kb/s */
+#define CIR_SETTLE_MS           (6)
+
+#define CIR_FRAME_LEN           (CMD_BIN_HDR_LEN + 2 + CIR_HDR_LEN + CIR_DATA_TLVS * 2 \
+                                 + CIR_TAPS_MAX * CIR_TAP_LEN + CMD_BIN_CRC_LEN)
+
+#ifndef MIN
+#define MIN(a,b)        (((a) < (b)) ? (a) : (b))
+#endif /* MIN */
+
+enum {
+    CIR_IDLE = 0,
+    CIR_BUSY            // latched by cir_stream_rx(), read by cir_stream_run()
+};
+
+static uint8   cir_frame[CIR_FRAME_LEN];
+static uint8   cir_chunk[1 + CIR_CHUNK_TAPS * CIR_TAP_LEN];
+
+static cir_cfg_t        cir_cfg;
+static uint16           cir_acc_taps;
+
+static volatile uint8   cir_state;
+static volatile uint32  cir_rx_events;  // written in IRQ context only
+static uint32           cir_ev_latch;   // cir_rx_events of the captured blink
+static uint32           cir_tick;       // arrival of the captured blink
+static uint32           cir_dropped;
+
+static uint16  cir_first;               // first tap of the window
+static uint16  cir_end;                 // tap after the window
+static uint16  cir_next;                // next tap to read
+static uint16  cir_len;                 // TLV bytes in cir_frame
+static uint16  cir_data;                // offset of the current CMD_BIN_CIR_DATA TLV
+
+/*
+ * @fn      cir_put16
+ * @brief   little endian 16 bit value
+ * */
+static void cir_put16(uint8 *p, uint16 val)
+{
+    p[0] = (uint8)(val);
+    p[1] = (uint8)(val >> 8);
+}
+
+/*
+ * @fn      cir_put_tap
+ * @brief   add a tap to the frame, a new CMD_BIN_CIR_DATA TLV is started
+ *          when the current one is full
+ * */
+static void cir_put_tap(const uint8 *tap)
+{
+    uint8 *tlv = &cir_frame[CMD_BIN_HDR_LEN];
+    int16 re, im;
+    float ampl;
+
+    if(tlv[cir_data + 1] == CIR_DATA_MAX)
+    {
+        cir_data = cir_len;
+        tlv[cir_data] = CMD_BIN_CIR_DATA;
+        tlv[cir_data + 1] = 0;
+        cir_len += 2;
+    }
+
+    if(cir_cfg.fmt == CIR_FMT_AMPL)
+    {
+        re = (int16)(tap[0] | (tap[1] << 8));
+        im = (int16)(tap[2] | (tap[3] << 8));
+        ampl = sqrtf((float)re * re + (float)im * im);
+        cir_put16(&tlv[cir_len], (uint16)ampl);
+        cir_len += 2;
+        tlv[cir_data + 1] += 2;
+    }
+    else
+    {
+        memcpy(&tlv[cir_len], tap, CIR_TAP_LEN);
+        cir_len += CIR_TAP_LEN;
+        tlv[cir_data + 1] += CIR_TAP_LEN;
+    }
+}
+
+/*
+ * @fn      cir_torn
+ * @brief   the accumulator may no longer hold the captured blink
+ * */
+static int cir_torn(void)
+{
+    return (cir_rx_events != cir_ev_latch) ||
+           ((dwt_read32bitreg(SYS_STATUS_ID) & SYS_STATUS_RXPRD) != 0);
+}
+
+/**
+ * @fn      cir_stream_init
+ * @brief   default configuration, accumulator length of the PRF
+ * */
+void cir_stream_init(const dwt_config_t *dwt)
+{
+    cir_cfg_t cfg;
+
+    cir_acc_taps = (dwt->prf == DWT_PRF_64M) ? CIR_ACC_TAPS_64M : CIR_ACC_TAPS_16M;
+
+    cfg.period_ms = CIR_PERIOD_MS_DEF;
+    cfg.pre = CIR_PRE_DEF;
+    cfg.len = CIR_LEN_DEF;
+    cfg.decim = 1;
+    cfg.fmt = CIR_FMT_AMPL;
+    cir_stream_config(&cfg);
+}
+
+/**
+ * @fn      cir_stream_config
+ * @brief   change the configuration, the capture in progress is dropped
+ * */
+void cir_stream_config(const cir_cfg_t *cfg)
+{
+    decaIrqStatus_t stat;
+
+    stat = decamutexon();
+
+    cir_cfg = *cfg;
+    cir_cfg.len = MIN(cir_cfg.len, CIR_TAPS_MAX);
+    if(cir_cfg.decim == 0)
+    {
+        cir_cfg.decim = 1;
+    }
+    cir_state = CIR_IDLE;
+
+    decamutexoff(stat);
+}
+
+/**
+ * @fn      cir_stream_rx
+ * @brief   RX event, latch the blink of the next capture
+ * */
+void cir_stream_rx(const dwt_rxrecord_t *rec)
+{
+    uint8 *tlv = &cir_frame[CMD_BIN_HDR_LEN];
+    uint32 tick;
+    uint16 fp;
+
+    cir_rx_events++;
+
+    if((rec == NULL) || (cir_state != CIR_IDLE) || (cir_cfg.period_ms == 0))
+    {
+        return;
+    }
+    if((rec->framelength < FRAME_CRTL_AND_ADDRESS) || (rec->frame[0] != FCS_EUI_64))
+    {
+        return; // not a blink
+    }
+
+    tick = portGetTickCount();
+    if((tick - cir_tick) < cir_cfg.period_ms)
+    {
+        return;
+    }
+
+    // window around the integer part of the first path index
+    fp = (uint16)((rec->rxtime[5] | (rec->rxtime[6] << 8)) >> 6);
+    cir_first = (fp > cir_cfg.pre) ? (fp - cir_cfg.pre) : 0;
+    cir_first = MIN(cir_first, cir_acc_taps - 1);
+    cir_end = MIN(cir_first + cir_cfg.len, cir_acc_taps);
+    cir_next = cir_first;
+
+    tlv[0] = CMD_BIN_CIR;
+    tlv[1] = CIR_HDR_LEN;
+    memcpy(&tlv[2], &rec->rxtime[0], 5);
+    memcpy(&tlv[7], &rec->frame[FRAME_CTRLP], EUI64_ADDR_SIZE);
+    tlv[15] = rec->frame[FRAME_CONTROL_BYTES];
+    memcpy(&tlv[16], &rec->rxtime[5], 2);
+    cir_put16(&tlv[18], cir_first);
+    tlv[20] = cir_cfg.decim;
+    tlv[21] = cir_cfg.fmt;
+    cir_put16(&tlv[22], (uint16)((cir_end - cir_first + cir_cfg.decim - 1) / cir_cfg.decim));
+
+    cir_data = 2 + CIR_HDR_LEN;
+    tlv[cir_data] = CMD_BIN_CIR_DATA;
+    tlv[cir_data + 1] = 0;
+    cir_len = cir_data + 2;
+
+    cir_tick = tick;
+    cir_ev_latch = cir_rx_events;
+    cir_state = CIR_BUSY;
+
+    __SEV(); // the main loop reads the first chunk
+}
+
+/**
+ * @fn      cir_stream_run
+ * @brief   read the next chunk, send the capture once complete
+ * */
+void cir_stream_run(void)
+{
+    uint16 n, i;
+
+    if(cir_state != CIR_BUSY)
+    {
+        return;
+    }
+
+    if(cir_next < cir_end)
+    {
+        n = MIN(cir_end - cir_next, CIR_CHUNK_TAPS);
+        dwt_readaccdata(cir_chunk, 1 + n * CIR_TAP_LEN, cir_next * CIR_TAP_LEN);
+
+        if(cir_torn())
+        {
+            cir_dropped++;
+            cir_state = CIR_IDLE;
+            return;
+        }
+
+        for(i = 0; i < n; i++)
+        {
+            if(((cir_next + i - cir_first) % cir_cfg.decim) == 0)
+            {
+                cir_put_tap(&cir_chunk[1 + i * CIR_TAP_LEN]);
+            }
+        }
+        cir_next += n;
+
+        __SEV(); // keep the main loop awake until the capture is sent
+        return;
+    }
+
+    if((portGetTickCount() - cir_tick) < CIR_SETTLE_MS)
+    {
+        return; // the SysTick wakes the main loop up
+    }
+
+    if(cir_torn() || (deca_uart_tx_free() < (CMD_BIN_HDR_LEN + cir_len + CMD_BIN_CRC_LEN)))
+    {
+        // never wait for the UART, the blink reports come first
+        cir_dropped++;
+        cir_state = CIR_IDLE;
+        return;
+    }
+
+    cmd_bin_send(cir_frame, cir_len);
+    cir_state = CIR_IDLE;
+}
+
+/**
+ * @fn      cir_stream_dropped
+ * @brief   captures dropped since the start
+ * */
+uint32 cir_stream_dropped(void)
+{
+    return cir_dropped;
+}
@@ -0,0 +1,110 @@
+/*
+ * @file       cir_stream.h
+ *
+ * @brief      TDoA anchor: streaming of channel impulse response captures
+ *             to the host, for the NLOS detection of the localizer
+ *
+ *             A received blink is captured at most every period_ms: the
+ *             accumulator window around its first path is read in chunks
+ *             from the main loop, so the DW1000 IRQ is never kept masked
+ *             for a whole accumulator dump, and sent with the RX time stamp
+ *             of the blink (cmd_bin.h):
+ *
+ *             | SOF | LEN | CMD_BIN_CIR | CMD_BIN_CIR_DATA ... | CRC |
+ *
+ * @author     Decawave Software
+ *
+ * @attention  Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *             All rights reserved.
+ */
+
+#ifndef _CIR_STREAM_H_
+#define _CIR_STREAM_H_ 1
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "deca_types.h"
+#include "deca_device_api.h"
+
+/* accumulator taps, 4 bytes each: int16 real, int16 imaginary */
+#define CIR_ACC_TAPS_16M        (992)
+#define CIR_ACC_TAPS_64M        (1016)
+
+/* longest window, in taps */
+#define CIR_TAPS_MAX            (256)
+
+/* default configuration: 20 Hz, 64 amplitude taps from 16 taps before the
+ * first path, 3.3 kB/s of the 11.5 kB/s of the UART at 115200 baud */
+#define CIR_PERIOD_MS_DEF       (50)
+#define CIR_PRE_DEF             (16)
+#define CIR_LEN_DEF             (64)
+
+/* CMD_BIN_CIR header, V: rxtime (5) | eui64 (8) | seqNum (1) | fpindex (2) |
+ * first tap (2) | decim (1) | fmt (1) | taps (2), the taps follow in
+ * CMD_BIN_CIR_DATA TLVs */
+#define CIR_HDR_LEN             (22)
+
+/* format of the taps */
+enum {
+    CIR_FMT_COMPLEX = 0,    /**< int16 real | int16 imaginary */
+    CIR_FMT_AMPL    = 1     /**< uint16 magnitude, computed on the MCU */
+};
+
+typedef struct
+{
+    uint16  period_ms;      // smallest time between two captures, 0 to stop
+    uint16  pre;            // taps before the first path index
+    uint16  len;            // taps of the window, before decimation
+    uint8   decim;          // 1 of decim taps is sent
+    uint8   fmt;            // CIR_FMT_COMPLEX or CIR_FMT_AMPL
+} cir_cfg_t;
+
+/**
+ * Set the default configuration and the accumulator length of the PRF.
+ *
+ * @param[in] dwt : radio configuration
+ * @return none
+ */
+void cir_stream_init(const dwt_config_t *dwt);
+
+/**
+ * Change the configuration, a capture in progress is dropped. len is
+ * clipped to CIR_TAPS_MAX.
+ *
+ * @param[in] cfg : configuration
+ * @return none
+ */
+void cir_stream_config(const cir_cfg_t *cfg);
+
+/**
+ * RX event, called from the dwt_isr() callbacks. A good blink starts a
+ * capture when the streamer is idle and period_ms has elapsed, any other
+ * event tears the capture in progress: the accumulator is not double
+ * buffered and belongs to the last preamble received.
+ *
+ * @param[in] rec : received frame, NULL for an RX error
+ * @return none
+ */
+void cir_stream_rx(const dwt_rxrecord_t *rec);
+
+/**
+ * Read the next chunk of the capture in progress and send the capture
+ * once complete. Called from the main loop.
+ *
+ * @return none
+ */
+void cir_stream_run(void);
+
+/**
+ * @return number of captures dropped, torn by a later preamble or with no
+ *         room in the UART TX ring
+ */
+uint32 cir_stream_dropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CIR_STREAM_H_ */
@@ -18,6 +18,9 @@
  */
 #include "cmd.h"
 #include "cmd_fn.h"
+#include "cmd_tok.h"
+#include "cmd_bin.h"
+#include "mem_arena.h"
 #include "instance.h"
 #include "config.h"
 /*
@@ -29,15 +32,17 @@
 extern app_cfg_t app;
 extern void port_tx_msg(char *ptr, int len);
 
+static cmd_index_t cmd_ix;
+
 /*
  * @brief "error" will be sent if error during parser or command execution returned error
  * */
 static void cmd_onERROR(const char *err, control_t *pcmd)
 {
-    char str[MAX_STR_SIZE];
+    char *str = MEM_ARENA(MEM_CMD_STR);
 
     strcpy(str, "error \r\n");
-    if ( strlen(err)< (sizeof(str)-6-3-1)) {
+    if ( strlen(err)< (MAX_STR_SIZE-6-3-1)) {
         strcpy(&str[6], err);
         strcpy(&str[6 + strlen(err)], "\r\n");
     }
@@ -45,6 +50,16 @@ static void cmd_onERROR(const char *err, control_t *pcmd)
 }
 
 
+/* @fn         command_init
+ * @brief    build the dispatch index of known_commands[] and give it to the
+ *             binary protocol, once at start up
+ * */
+void command_init(void)
+{
+    cmd_index_build(&cmd_ix, known_commands);
+    cmd_bin_commands(&cmd_ix);
+}
+
 /* @fn         command_parser
  * @brief    checks if input "text" string in known "COMMAND" or "PARAMETER VALUE" format,
  *             checks their execution permissions, a VALUE range if restrictions and
@@ -54,42 +69,32 @@ void command_parser(char *text)
 {
     control_t   mcmd_console;
     control_t   *pcmd = &mcmd_console;
-    command_t   *pk = NULL;
+    const command_t *pk = NULL;
+    cmd_token_t tok;
 
     memset (&mcmd_console, 0 , sizeof(mcmd_console));
 
     pcmd->equal = _NO_COMMAND;
-    pcmd->indx = 0;
-
-    do{
-        text[pcmd->indx]=(char)toupper((int)text[pcmd->indx]);
-    }while(text[ ++pcmd->indx ]);
 
-    sscanf(text ,"%10s %d", pcmd->cmd, &pcmd->val); //check MAX_COMMAND_SIZE if format will be changed
-
-    pcmd->indx = 0;
-    while (known_commands[pcmd->indx].name != NULL)
+    if (cmd_token(text, strlen(text), &tok) == 0)
     {
-        pk = (command_t *) &known_commands[pcmd->indx];
+        pk = cmd_index_find(&cmd_ix, &tok);
+        pcmd->val = tok.val;
+    }
 
-        if (( strcmp(pcmd->cmd, pk->name) == 0 ) &&\
-            ( strlen(pcmd->cmd) == strlen(pk->name)) )
+    if (pk != NULL)
+    {
+        pcmd->equal = _COMMAND_FOUND;
+
+        /* check command execution permissions.
+         * some commands can be executed only from Idle system mode:
+         * i.e. when no active processes are running.
+         * other commands can be executed at any time.
+         * */
+        if (/* pk->mode == app.mode ||*/ pk->mode == mANY)
         {
-            pcmd->equal = _COMMAND_FOUND;
-
-            /* check command execution permissions.
-             * some commands can be executed only from Idle system mode:
-             * i.e. when no active processes are running.
-             * other commands can be executed at any time.
-             * */
-            if (/* pk->mode == app.mode ||*/ pk->mode == mANY)
-            {
-                pcmd->equal = _COMMAND_ALLOWED;
-                break;
-            }
+            pcmd->equal = _COMMAND_ALLOWED;
         }
-
-        pcmd->indx++;
     }
 
 
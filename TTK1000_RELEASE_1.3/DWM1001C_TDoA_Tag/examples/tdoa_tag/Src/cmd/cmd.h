@@ -22,9 +22,7 @@
 
  /* Command parser datas */
  typedef struct {
-     int            indx;
      int            equal;
-     char         cmd[20];
      int            val;
      const char *ret;
  }control_t;
@@ -37,6 +35,11 @@
      _COMMAND_ALLOWED
  };
 
+/* @fn         command_init
+ * @brief    build the command dispatch index, before the first command
+ * */
+void command_init(void);
+
 /* @fn         command_driver
  * @brief    check if input text in known "COMMAND" or "PARAMETER=VALUE" format
  *             and executes COMMAND or set the PARAMETER to the VALUE
@@ -0,0 +1,318 @@
+/*
+ * @file    cmd_bin.c
+ * @brief   binary TLV configuration protocol
+ *
+ *          The text commands of cmd.c set one parameter per line, which is
+ *          slow when a provisioning host configures many tags. A binary frame
+ *          carries any number of parameter sets as raw param_block_t bytes,
+ *          so a host can push a whole configuration delta in one round trip.
+ *          The frames are collected by deca_uart.c, which recognises CMD_BIN_SOF
+ *          at the start of a line and does not echo them.
+ *          A CMD_BIN_CMD TLV runs a text command, found by the tokenizer and
+ *          the index of the text lines (cmd_tok.h); the reports it prints
+ *          (STAT, RSTAT...) go to the UART as text, before the answer.
+ *
+ * @author Decawave Software
+ *
+ * @attention Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *            All rights reserved.
+ *
+ */
+#include <stddef.h>
+#include "cmd_bin.h"
+#include "config.h"
+#include "crc16.h"
+#include "radio_stats.h"
+#include "mem_arena.h"
+
+extern void port_tx_msg(char *ptr, int len);
+
+/* param_block_t bytes the host may set, the version string is read only */
+#define CMD_BIN_PARAM_END       (offsetof(param_block_t, free))
+#define CMD_BIN_RO_START        (offsetof(param_block_t, version))
+#define CMD_BIN_RO_END          (CMD_BIN_RO_START + sizeof(((param_block_t *)0)->version))
+
+static uint8_t * const bin_reply = MEM_ARENA(MEM_CMD_BIN);
+static const cmd_index_t *bin_cmds = NULL;
+
+/* @fn      cmd_bin_commands
+ * @brief   commands of the CMD_BIN_CMD TLVs, the text commands of cmd.c,
+ *          none (CMD_BIN_ERR_CMD) until it is called
+ * */
+void cmd_bin_commands(const cmd_index_t *ix)
+{
+    bin_cmds = ix;
+}
+
+/*
+ * @brief command of a CMD_BIN_CMD TLV, cut by the tokenizer of the text commands
+ * */
+static const command_t *cmd_bin_cmd(const uint8_t *tlv, int *val)
+{
+    cmd_token_t tok;
+    const command_t *pk;
+
+    if((bin_cmds == NULL) || (tlv[1] <= 4) ||
+       (cmd_token((const char *)&tlv[6], tlv[1] - 4, &tok) != 0))
+    {
+        return NULL;
+    }
+    pk = cmd_index_find(bin_cmds, &tok);
+    *val = (int)(tlv[2] | ((uint32_t)tlv[3] << 8) | ((uint32_t)tlv[4] << 16) | ((uint32_t)tlv[5] << 24));
+    return ((pk != NULL) && (pk->mode == mANY)) ? (pk) : (NULL);
+}
+
+/*
+ * @brief check the param_block_t range of a SET/GET
+ * */
+static int cmd_bin_range(uint16_t offset, uint16_t len, int write)
+{
+    if((len == 0) || ((uint32_t)offset + len > CMD_BIN_PARAM_END))
+    {
+        return 0;
+    }
+    if(write && (offset < CMD_BIN_RO_END) && (offset + len > CMD_BIN_RO_START))
+    {
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * @brief check one TLV, returns CMD_BIN_OK or an error and the size of its answer
+ * */
+static int cmd_bin_check(const uint8_t *tlv, uint16_t *reply_len)
+{
+    uint8_t  t = tlv[0];
+    uint8_t  l = tlv[1];
+    uint16_t offset = (l >= 2) ? (tlv[2] | ((uint16_t)tlv[3] << 8)) : (0);
+    int      val;
+
+    *reply_len = 0;
+
+    switch(t)
+    {
+        case CMD_BIN_SET:
+            if(l < 3)
+            {
+                return CMD_BIN_ERR_LEN;
+            }
+            return (cmd_bin_range(offset, l - 2, 1)) ? (CMD_BIN_OK) : (CMD_BIN_ERR_RANGE);
+
+        case CMD_BIN_GET:
+            if(l != 3)
+            {
+                return CMD_BIN_ERR_LEN;
+            }
+            *reply_len = 2 + 2 + tlv[4];
+            return (cmd_bin_range(offset, tlv[4], 0)) ? (CMD_BIN_OK) : (CMD_BIN_ERR_RANGE);
+
+        case CMD_BIN_SAVE:
+            return (l == 0) ? (CMD_BIN_OK) : (CMD_BIN_ERR_LEN);
+
+        case CMD_BIN_STATS:
+            *reply_len = 2 + RADIO_STATS_LEN;
+            return (l == 0) ? (CMD_BIN_OK) : (CMD_BIN_ERR_LEN);
+
+        case CMD_BIN_CMD:
+            *reply_len = 2 + 1;
+            if(l <= 4)
+            {
+                return CMD_BIN_ERR_LEN;
+            }
+            return (cmd_bin_cmd(tlv, &val) != NULL) ? (CMD_BIN_OK) : (CMD_BIN_ERR_CMD);
+
+        default:
+            return CMD_BIN_ERR_TYPE;
+    }
+}
+
+/*
+ * @brief frame the answer: header, the CMD_BIN_STATUS TLV is already at
+ *        bin_reply[CMD_BIN_HDR_LEN], followed by len - 4 bytes of GET results
+ * */
+static void cmd_bin_reply(uint16_t len)
+{
+    mem_arena_mark(MEM_CMD_BIN, CMD_BIN_HDR_LEN + len + CMD_BIN_CRC_LEN);
+    cmd_bin_send(bin_reply, len);
+}
+
+/* @fn      cmd_bin_send
+ * @brief   add the header and the CRC to the len bytes of TLVs at
+ *          frame[CMD_BIN_HDR_LEN] and send the frame
+ * */
+void cmd_bin_send(uint8_t *frame, uint16_t len)
+{
+    uint16_t crc;
+
+    frame[0] = CMD_BIN_SOF;
+    frame[1] = (uint8_t)(len);
+    frame[2] = (uint8_t)(len >> 8);
+
+    crc = crc16_ccitt(CRC16_INIT, &frame[1], len + 2);
+    frame[CMD_BIN_HDR_LEN + len]     = (uint8_t)(crc);
+    frame[CMD_BIN_HDR_LEN + len + 1] = (uint8_t)(crc >> 8);
+
+    port_tx_msg((char *)frame, CMD_BIN_HDR_LEN + len + CMD_BIN_CRC_LEN);
+}
+
+/* @fn      cmd_bin_frame_len
+ * @brief   length of the whole frame from its header
+ * @return  0 if the header is not complete, the frame length otherwise
+ * */
+uint16_t cmd_bin_frame_len(const uint8_t *hdr, uint16_t len)
+{
+    if(len < CMD_BIN_HDR_LEN)
+    {
+        return 0;
+    }
+    return (CMD_BIN_HDR_LEN + (hdr[1] | ((uint16_t)hdr[2] << 8)) + CMD_BIN_CRC_LEN);
+}
+
+/*
+ * @brief check and execute a frame, the answer is left in bin_reply
+ * @return the TLV length of the answer
+ * */
+static uint16_t cmd_bin_exec(const uint8_t *frame, uint16_t len)
+{
+    param_block_t *pbss = get_pbssConfig();
+    uint8_t  *status = &bin_reply[CMD_BIN_HDR_LEN];
+    uint8_t  *out = &bin_reply[CMD_BIN_HDR_LEN + 4];
+    uint16_t tlvLen, pos, reply, reply_len;
+    uint16_t offset;
+    const command_t *pk;
+    int      val;
+    uint8_t  idx = 0;
+    int      save = 0;
+    int      err = CMD_BIN_OK;
+
+    status[0] = CMD_BIN_STATUS;
+    status[1] = 2;
+    status[3] = 0;
+
+    tlvLen = (len >= CMD_BIN_HDR_LEN) ? (frame[1] | ((uint16_t)frame[2] << 8)) : (0);
+
+    if((len < CMD_BIN_HDR_LEN + CMD_BIN_CRC_LEN) || (tlvLen > CMD_BIN_LEN_MAX) ||
+       (cmd_bin_frame_len(frame, len) != len))
+    {
+        err = CMD_BIN_ERR_LEN;
+    }
+    else if(crc16_ccitt(CRC16_INIT, &frame[1], tlvLen + 2) !=
+            (frame[CMD_BIN_HDR_LEN + tlvLen] | ((uint16_t)frame[CMD_BIN_HDR_LEN + tlvLen + 1] << 8)))
+    {
+        err = CMD_BIN_ERR_CRC;
+    }
+
+    frame += CMD_BIN_HDR_LEN;
+
+    /* pass 1: check every TLV, so a bad one leaves the configuration untouched */
+    reply = 4;
+    pos = 0;
+    while((err == CMD_BIN_OK) && (pos < tlvLen))
+    {
+        if((pos + 2 > tlvLen) || (pos + 2 + frame[pos + 1] > tlvLen))
+        {
+            err = CMD_BIN_ERR_LEN;
+            break;
+        }
+
+        err = cmd_bin_check(&frame[pos], &reply_len);
+        reply += reply_len;
+        if((err == CMD_BIN_OK) && (reply > CMD_BIN_LEN_MAX))
+        {
+            err = CMD_BIN_ERR_SIZE;
+        }
+        if(err != CMD_BIN_OK)
+        {
+            break;
+        }
+
+        pos += 2 + frame[pos + 1];
+        idx++;
+    }
+
+    if(err != CMD_BIN_OK)
+    {
+        status[2] = (uint8_t)err;
+        status[3] = idx;
+        return 4;
+    }
+
+    /* pass 2: apply */
+    for(pos = 0; pos < tlvLen; pos += 2 + frame[pos + 1])
+    {
+        const uint8_t *tlv = &frame[pos];
+
+        offset = (tlv[1] >= 2) ? (tlv[2] | ((uint16_t)tlv[3] << 8)) : (0);
+
+        switch(tlv[0])
+        {
+            case CMD_BIN_SET:
+                memcpy((uint8_t *)pbss + offset, &tlv[4], tlv[1] - 2);
+                break;
+
+            case CMD_BIN_GET:
+                out[0] = CMD_BIN_GET;
+                out[1] = 2 + tlv[4];
+                out[2] = tlv[2];
+                out[3] = tlv[3];
+                memcpy(&out[4], (uint8_t *)pbss + offset, tlv[4]);
+                out += 4 + tlv[4];
+                break;
+
+            case CMD_BIN_SAVE:
+                save = 1;
+                break;
+
+            case CMD_BIN_STATS:
+                out[0] = CMD_BIN_STATS;
+                out[1] = RADIO_STATS_LEN;
+                radio_stats_pack(&out[2]);
+                out += 2 + RADIO_STATS_LEN;
+                break;
+
+            case CMD_BIN_CMD:
+                /* checked in pass 1, a value out of the range of the command is refused by it */
+                pk = cmd_bin_cmd(tlv, &val);
+                out[0] = CMD_BIN_CMD;
+                out[1] = 1;
+                out[2] = (pk->fn((char *)pk->name, pbss, val) != NULL) ? (0) : (1);
+                out += 2 + 1;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    if(save)
+    {
+        save_bssConfig(pbss);
+    }
+
+    status[2] = CMD_BIN_OK;
+    return reply;
+}
+
+/* @fn      command_bin_parser
+ * @brief   check and execute a binary configuration frame, the parameter
+ *          sets of a frame are applied all or none
+ * */
+void command_bin_parser(const uint8_t *frame, uint16_t len)
+{
+    cmd_bin_reply(cmd_bin_exec(frame, len));
+}
+
+/* @fn      command_bin_downlink
+ * @brief   execute a binary configuration frame received over the air,
+ *          there is no answer (GET results are dropped)
+ * @return  the CMD_BIN_STATUS status, CMD_BIN_OK if it was applied
+ * */
+int command_bin_downlink(const uint8_t *frame, uint16_t len)
+{
+    cmd_bin_exec(frame, len);
+
+    return bin_reply[CMD_BIN_HDR_LEN + 2];
+}
+
+/* end of cmd_bin.c */
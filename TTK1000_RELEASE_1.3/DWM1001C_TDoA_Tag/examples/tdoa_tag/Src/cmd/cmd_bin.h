@@ -0,0 +1,106 @@
+/*
+ * @file cmd_bin.h
+ *
+ * @brief  header file for cmd_bin.c
+ *
+ *         Binary configuration frame, all fields little endian:
+ *
+ *         | SOF 0xA5 (1) | LEN (2) | TLV ... (LEN) | CRC (2) |
+ *
+ *         CRC is the CRC-16/CCITT (poly 0x1021, init 0xFFFF) of LEN and
+ *         TLVs. Each TLV is | T (1) | L (1) | V (L) |, the tag (and the
+ *         anchor) answers with a frame of the same format carrying a
+ *         CMD_BIN_STATUS TLV and the CMD_BIN_GET / CMD_BIN_STATS / CMD_BIN_CMD
+ *         results.
+ *         The anchor reports its received blinks with frames of the same
+ *         format as well.
+ *
+ * @author Decawave Software
+ *
+ * @attention Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *            All rights reserved.
+ *
+ */
+#ifndef INC_CMD_BIN_H_
+#define INC_CMD_BIN_H_    1
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "default_config.h"
+#include "port_platform.h"
+#include "cmd_tok.h"
+
+//-----------------------------------------------------------------------------
+/* module DEFINITIONS */
+
+#define CMD_BIN_SOF             (0xA5)  /**< not a character a terminal sends */
+#define CMD_BIN_HDR_LEN         (3)     /**< SOF + LEN */
+#define CMD_BIN_CRC_LEN         (2)
+#define CMD_BIN_FRAME_MAX       (RX_BUF_SIZE - 1)
+#define CMD_BIN_LEN_MAX         (CMD_BIN_FRAME_MAX - CMD_BIN_HDR_LEN - CMD_BIN_CRC_LEN)
+
+ /* TLV types */
+ enum {
+     CMD_BIN_SET    = 0x01,  /**< V: offset (2) | bytes, written into param_block_t */
+     CMD_BIN_GET    = 0x02,  /**< V: offset (2) | length (1), answered with offset (2) | bytes */
+     CMD_BIN_SAVE   = 0x03,  /**< L = 0, save the configuration once all TLVs are applied */
+     CMD_BIN_CMD    = 0x04,  /**< V: value (4, signed) | text command name, answered with V: 0 done, 1 refused */
+     CMD_BIN_BLINKS = 0x10,  /**< anchor report, V: n x blink_rec_t (blink_ring.h) */
+     CMD_BIN_DROPS  = 0x11,  /**< anchor report, V: blinks dropped (4) | RX errors (4) since the start */
+     CMD_BIN_CIR    = 0x12,  /**< anchor CIR capture, V: CIR_HDR_LEN header (cir_stream.h) */
+     CMD_BIN_CIR_DATA = 0x13, /**< anchor CIR capture, V: taps following CMD_BIN_CIR or the previous CMD_BIN_CIR_DATA */
+     CMD_BIN_STATS  = 0x14,  /**< L = 0, answered with V: RADIO_STATS_LEN report (radio_stats.h) */
+     CMD_BIN_STATUS = 0x7F   /**< answer, V: status (1) | index of the failed TLV (1) */
+ };
+
+ /* status of the CMD_BIN_STATUS answer */
+ enum {
+     CMD_BIN_OK = 0,
+     CMD_BIN_ERR_CRC,        /**< corrupted frame */
+     CMD_BIN_ERR_LEN,        /**< LEN does not match the frame or a TLV overruns it */
+     CMD_BIN_ERR_TYPE,       /**< unknown TLV type */
+     CMD_BIN_ERR_RANGE,      /**< offset/length outside of the settable parameters */
+     CMD_BIN_ERR_SIZE,       /**< the answer does not fit into a frame */
+     CMD_BIN_ERR_CMD         /**< unknown or not allowed CMD_BIN_CMD command */
+ };
+
+/* @fn      cmd_bin_commands
+ * @brief   commands of the CMD_BIN_CMD TLVs, the text commands of cmd.c,
+ *          none (CMD_BIN_ERR_CMD) until it is called
+ * */
+void cmd_bin_commands(const cmd_index_t *ix);
+
+/* @fn      cmd_bin_frame_len
+ * @brief   length of the whole frame from its header
+ * @return  0 if the header is not complete, the frame length otherwise
+ * */
+uint16_t cmd_bin_frame_len(const uint8_t *hdr, uint16_t len);
+
+/* @fn      command_bin_parser
+ * @brief   check and execute a binary configuration frame, the parameter
+ *          sets of a frame are applied all or none
+ * */
+void command_bin_parser(const uint8_t *frame, uint16_t len);
+
+/* @fn      command_bin_downlink
+ * @brief   execute a binary configuration frame received over the air,
+ *          there is no answer (GET results are dropped)
+ * @return  the CMD_BIN_STATUS status, CMD_BIN_OK if it was applied
+ * */
+int command_bin_downlink(const uint8_t *frame, uint16_t len);
+
+/* @fn      cmd_bin_send
+ * @brief   frame and send len bytes of TLVs, which the caller has put at
+ *          frame[CMD_BIN_HDR_LEN], frame must have room for the CRC
+ * */
+void cmd_bin_send(uint8_t *frame, uint16_t len);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* INC_CMD_BIN_H_ */
@@ -16,6 +16,12 @@
 #include "translate.h"
 #include "version.h"
 #include "deca_version.h"
+#include "prof.h"
+#include "instance.h"
+#include "budget.h"
+#include "radio_stats.h"
+#include "xtal_cal.h"
+#include "mem_arena.h"
 
 
 //-----------------------------------------------------------------------------
@@ -117,6 +123,10 @@ REG_FN(f_sfdTO)
     pbss->dwt_config.sfdTO = (uint16_t)(val);
     return (CMD_FN_RET_OK);
 }     
+REG_FN(f_preset)
+{
+    return ((instance_preset(pbss, val) < 0) ? (NULL) : (CMD_FN_RET_OK));
+}
 REG_FN(f_smartPowerEn)
 {
     pbss->smartPowerEn = (val == 0)?(0):(1);
@@ -137,6 +147,208 @@ REG_FN(f_randomness)
     pbss->blink.randomness = (uint8_t)(val);
     return (CMD_FN_RET_OK);
 }     
+REG_FN(f_delayedTxEn)
+{
+    pbss->delayedTxEn = (val == 0)?(0):(1);
+    return (CMD_FN_RET_OK);
+}
+REG_FN(f_superframe)
+{
+    const char * ret = NULL;
+
+    // the slot schedule runs on the DW1000 clock, see MAX_SUPERFRAME_MS
+    if((val >= 0) && (val <= MAX_SUPERFRAME_MS))
+    {
+      pbss->slot.superframe_ms = (uint16_t)(val);
+      ret = CMD_FN_RET_OK;
+    }
+    return (ret);
+}
+REG_FN(f_slotIdx)
+{
+    pbss->slot.slot_idx = (uint16_t)(val);
+    return (CMD_FN_RET_OK);
+}
+REG_FN(f_slotWidth)
+{
+    const char * ret = NULL;
+
+    if((val > 0) && (val <= 0xFFFF))
+    {
+      pbss->slot.slot_width_us = (uint16_t)(val);
+      ret = CMD_FN_RET_OK;
+    }
+    return (ret);
+}
+REG_FN(f_burst)
+{
+    const char * ret = NULL;
+
+    if((val >= 1) && (val <= 8))
+    {
+      pbss->burst.count = (uint8_t)(val);
+      ret = CMD_FN_RET_OK;
+    }
+    return (ret);
+}
+REG_FN(f_burstGap)
+{
+    const char * ret = NULL;
+
+    // the gap holds the blink on air and its preparation (see instance.c)
+    if((val >= 500) && (val <= 10000))
+    {
+      pbss->burst.gap_us = (uint16_t)(val);
+      ret = CMD_FN_RET_OK;
+    }
+    return (ret);
+}
+REG_FN(f_motionRate)
+{
+    pbss->motion.adaptiveEn = (val == 0)?(0):(1);
+    return (CMD_FN_RET_OK);
+}
+REG_FN(f_interval_move_ms)
+{
+    const char * ret = NULL;
+
+    if((val > 0) && (val <= 0xFFFF))
+    {
+      pbss->motion.interval_move_ms = (uint16_t)(val);
+      ret = CMD_FN_RET_OK;
+    }
+    return (ret);
+}
+REG_FN(f_motionLo)
+{
+    pbss->motion.intensity_lo_mg = (uint16_t)(val);
+    return (CMD_FN_RET_OK);
+}
+REG_FN(f_motionHi)
+{
+    pbss->motion.intensity_hi_mg = (uint16_t)(val);
+    return (CMD_FN_RET_OK);
+}
+REG_FN(f_dlPeriod)
+{
+    const char * ret = NULL;
+
+    if((val >= 0) && (val <= 0xFF))
+    {
+      pbss->downlink.period = (uint8_t)(val);
+      ret = CMD_FN_RET_OK;
+    }
+    return (ret);
+}
+REG_FN(f_dlWindow)
+{
+    const char * ret = NULL;
+
+    // a window shorter than the preamble of an answer is of no use
+    if((val >= 50) && (val <= 60000))
+    {
+      pbss->downlink.window_us = (uint16_t)(val);
+      ret = CMD_FN_RET_OK;
+    }
+    return (ret);
+}
+REG_FN(f_dlSniffOn)
+{
+    const char * ret = NULL;
+
+    // in PACs, 0 - sniff mode off, the receiver is on for the whole window
+    if((val >= 0) && (val <= 15))
+    {
+      pbss->downlink.sniff_on = (uint8_t)(val);
+      ret = CMD_FN_RET_OK;
+    }
+    return (ret);
+}
+REG_FN(f_dlSniffOff)
+{
+    const char * ret = NULL;
+
+    // in us
+    if((val >= 0) && (val <= 0xFF))
+    {
+      pbss->downlink.sniff_off = (uint8_t)(val);
+      ret = CMD_FN_RET_OK;
+    }
+    return (ret);
+}
+REG_FN(f_budget)
+{
+    const char * ret = NULL;
+
+    // target runtime in minutes from now, 0 - budget off
+    if((val >= 0) && (val <= 0xFFFF))
+    {
+      pbss->budget.runtime_min = (uint16_t)(val);
+      budget_start();
+      ret = CMD_FN_RET_OK;
+    }
+    return (ret);
+}
+REG_FN(f_budgetMax)
+{
+    const char * ret = NULL;
+
+    if((val >= 1) && (val <= 0xFF))
+    {
+      pbss->budget.stretch_max = (uint8_t)(val);
+      ret = CMD_FN_RET_OK;
+    }
+    return (ret);
+}
+REG_FN(f_budgetEmpty)
+{
+    const char * ret = NULL;
+
+    // in mV, the DW1000 does not run below DW_VBAT_MIN
+    if((val >= DW_VBAT_MIN) && (val <= 3600))
+    {
+      pbss->budget.vbat_empty_mv = (uint16_t)(val);
+      ret = CMD_FN_RET_OK;
+    }
+    return (ret);
+}
+REG_FN(f_xtalTrim)
+{
+    const char * ret = NULL;
+
+    // 0 - the OTP trim, applied before the next blink
+    if((val >= 0) && (val <= 31))
+    {
+      pbss->xtalTrim = (uint8_t)(val);
+      ret = CMD_FN_RET_OK;
+    }
+    return (ret);
+}
+REG_FN(f_xtalCal)
+{
+    // the trim is saved when the calibration succeeds
+    if(val == 0)
+    {
+        xtal_cal_stop();
+    }
+    else
+    {
+        xtal_cal_start();
+    }
+    return (CMD_FN_RET_OK);
+}
+REG_FN(f_dwp)
+{
+    const char * ret = NULL;
+
+    // IMU_DWP_xx mask, unsupported fields are ignored by the payload encoder
+    if((val >= 0) && (val <= 0xFF))
+    {
+      pbss->dwp = (uint8_t)(val);
+      ret = CMD_FN_RET_OK;
+    }
+    return (ret);
+}
 REG_FN(f_tagID)
 {
     char tmp[16];
@@ -162,7 +374,7 @@ REG_FN(f_decaTDoATag)
     const char *ret = NULL;
     const char ver[] = FULL_VERSION;
 
-    char str[MAX_STR_SIZE];
+    char *str = MEM_ARENA(MEM_CMD_STR);
 
     int  hlen;
 
@@ -194,7 +406,7 @@ REG_FN(f_jstat)
 {
     const char *ret = NULL;
 
-    char str[MAX_STR_SIZE];
+    char *str = MEM_ARENA(MEM_CMD_STR);
 
     int  hlen;
 
@@ -213,6 +425,17 @@ REG_FN(f_jstat)
     sprintf(&str[strlen(str)],"\"BLINKFAST\":%d,\r\n",pbss->blink.interval_in_ms);
     sprintf(&str[strlen(str)],"\"BLINKSLOW\":%d,\r\n",pbss->blink.interval_slow_in_ms);
     sprintf(&str[strlen(str)],"\"RANDOMNESS\":%d,\r\n",pbss->blink.randomness);
+    sprintf(&str[strlen(str)],"\"DELAYEDTX\":%d,\r\n",pbss->delayedTxEn);
+    sprintf(&str[strlen(str)],"\"SUPERFRAME\":%d,\r\n",pbss->slot.superframe_ms);
+    sprintf(&str[strlen(str)],"\"SLOTIDX\":%d,\r\n",pbss->slot.slot_idx);
+    sprintf(&str[strlen(str)],"\"SLOTWIDTH\":%d,\r\n",pbss->slot.slot_width_us);
+    sprintf(&str[strlen(str)],"\"BURST\":%d,\r\n",pbss->burst.count);
+    sprintf(&str[strlen(str)],"\"BURSTGAP\":%d,\r\n",pbss->burst.gap_us);
+    sprintf(&str[strlen(str)],"\"DWP\":%d,\r\n",pbss->dwp);
+    sprintf(&str[strlen(str)],"\"MOTIONRATE\":%d,\r\n",pbss->motion.adaptiveEn);
+    sprintf(&str[strlen(str)],"\"BLINKMOVE\":%d,\r\n",pbss->motion.interval_move_ms);
+    sprintf(&str[strlen(str)],"\"MOTIONLO\":%d,\r\n",pbss->motion.intensity_lo_mg);
+    sprintf(&str[strlen(str)],"\"MOTIONHI\":%d,\r\n",pbss->motion.intensity_hi_mg);
     sprintf(&str[strlen(str)],"\"TAGIDSET\":%d,\r\n",pbss->tagIDset);
     sprintf(&str[strlen(str)],"\"TAGID\":0x%02x%02x%02x%02x%02x%02x%02x%02x}}",
                                                pbss->tagID[7], pbss->tagID[6], pbss->tagID[5], pbss->tagID[4],
@@ -235,8 +458,6 @@ REG_FN(f_stat)
 {
     const char * ret = CMD_FN_RET_OK;
 
-    char str[MAX_STR_SIZE];
-
     f_decaTDoATag(text, pbss, val);
     f_jstat(text, pbss, val);
 
@@ -244,13 +465,244 @@ REG_FN(f_stat)
     return (ret);
 }
 
+/*
+ * @brief show the downlink listen window configuration and statistics
+ *        in JSON format, DUTY is the receiver on time in ppm of the up time
+ *
+ * */
+REG_FN(f_dlstat)
+{
+    const instance_dlstats_t *s = instance_downlink_stats();
+    uint32_t up_ms = portGetTickCount();
+    char *str = MEM_ARENA(MEM_CMD_STR);
+    int  hlen;
+
+    hlen = sprintf(str,"JS%04X", 0x5A5A);    // reserve space for length of JS object
+    sprintf(&str[strlen(str)],"{\"DLSTAT\":{\r\n");
+    sprintf(&str[strlen(str)],"\"PERIOD\":%d,\r\n", pbss->downlink.period);
+    sprintf(&str[strlen(str)],"\"WINDOW\":%d,\r\n", pbss->downlink.window_us);
+    sprintf(&str[strlen(str)],"\"SNIFF\":[%d,%d],\r\n", pbss->downlink.sniff_on,
+                                                       pbss->downlink.sniff_off);
+    sprintf(&str[strlen(str)],"\"WINDOWS\":%lu,\r\n", (unsigned long)s->windows);
+    sprintf(&str[strlen(str)],"\"RXUS\":%lu,\r\n", (unsigned long)s->rx_us);
+    sprintf(&str[strlen(str)],"\"DUTY\":%lu,\r\n",
+            (unsigned long)((up_ms) ? ((uint64_t)s->rx_us * 1000 / up_ms) : (0)));
+    sprintf(&str[strlen(str)],"\"FRAMES\":%lu,\r\n", (unsigned long)s->frames);
+    sprintf(&str[strlen(str)],"\"APPLIED\":%lu}}", (unsigned long)s->applied);
+
+    sprintf(&str[2],"%04X",strlen(str)-hlen);//add formatted 4X of length, this will erase first '{'
+    str[hlen]='{';                            //restore the start bracket
+    sprintf(&str[strlen(str)],"\r\n");
+    port_tx_msg((uint8_t*)str, strlen(str));
+
+    return (CMD_FN_RET_OK);
+}
+
+/*
+ * @brief show the DW1000 event counters and the application frame counters
+ *        in JSON format, totals since power up, see radio_stats.h
+ *
+ * */
+REG_FN(f_rstat)
+{
+    static const char * const names[RADIO_STATS_NUM] = {
+        "PHE", "RSL", "CRCG", "CRCB", "ARFE", "OVER", "SFDTO", "PTO", "RTO", "TXF", "HPW", "TXW",
+        "APPTX", "APPTXLOST", "APPRX", "APPRXERR", "APPDROP"
+    };
+    char *str = MEM_ARENA(MEM_CMD_STR);
+    int  hlen, i;
+
+    hlen = sprintf(str,"JS%04X", 0x5A5A);    // reserve space for length of JS object
+    sprintf(&str[strlen(str)],"{\"RSTAT\":{\r\n");
+    for(i = 0; i < RADIO_STATS_NUM; i++)
+    {
+        sprintf(&str[strlen(str)],"\"%s\":%lu%s", names[i], (unsigned long)radio_stats_get(i),
+                (i < RADIO_STATS_NUM - 1) ? (",\r\n") : ("}}"));
+    }
+
+    sprintf(&str[2],"%04X",strlen(str)-hlen);//add formatted 4X of length, this will erase first '{'
+    str[hlen]='{';                            //restore the start bracket
+    sprintf(&str[strlen(str)],"\r\n");
+    port_tx_msg((uint8_t*)str, strlen(str));
+
+    return (CMD_FN_RET_OK);
+}
+
+/*
+ * @brief show the blink budget in JSON format
+ *
+ * */
+REG_FN(f_budgetstat)
+{
+    const budget_state_t *s = budget_state();
+    char *str = MEM_ARENA(MEM_CMD_STR);
+    int  hlen;
+
+    hlen = sprintf(str,"JS%04X", 0x5A5A);    // reserve space for length of JS object
+    sprintf(&str[strlen(str)],"{\"BUDGETSTAT\":{\r\n");
+    sprintf(&str[strlen(str)],"\"RUNTIME\":%d,\r\n", pbss->budget.runtime_min);
+    sprintf(&str[strlen(str)],"\"ELAPSED\":%lu,\r\n", (unsigned long)s->elapsed_min);
+    sprintf(&str[strlen(str)],"\"REMAIN\":%ld,\r\n",
+            (s->remain_min == BUDGET_REMAIN_NONE) ? (-1L) : ((long)s->remain_min));
+    sprintf(&str[strlen(str)],"\"VBAT\":%d,\r\n", s->vbat_mv);
+    sprintf(&str[strlen(str)],"\"TEMP\":%d,\r\n", s->temp_c);
+    sprintf(&str[strlen(str)],"\"SLOPE\":%ld,\r\n", (long)s->slope_mvh);
+    sprintf(&str[strlen(str)],"\"STRETCH\":%d,\r\n", s->stretch * 100 / BUDGET_STRETCH_ONE);
+    sprintf(&str[strlen(str)],"\"LEAN\":%d}}", s->lean);
+
+    sprintf(&str[2],"%04X",strlen(str)-hlen);//add formatted 4X of length, this will erase first '{'
+    str[hlen]='{';                            //restore the start bracket
+    sprintf(&str[strlen(str)],"\r\n");
+    port_tx_msg((uint8_t*)str, strlen(str));
+
+    return (CMD_FN_RET_OK);
+}
+
+/*
+ * @brief show the XTAL trim calibration in JSON format, OFFSET in 1/100 ppm
+ *        (positive: the tag clock is slower than the anchors)
+ *
+ * */
+REG_FN(f_xtalstat)
+{
+    static const char * const states[] = { "IDLE", "RUN", "DONE", "FAIL" };
+    const xtal_cal_state_t *s = xtal_cal_state();
+    char *str = MEM_ARENA(MEM_CMD_STR);
+    int  hlen;
+
+    hlen = sprintf(str,"JS%04X", 0x5A5A);    // reserve space for length of JS object
+    sprintf(&str[strlen(str)],"{\"XTALSTAT\":{\r\n");
+    sprintf(&str[strlen(str)],"\"STATE\":\"%s\",\r\n", states[s->state & 3]);
+    sprintf(&str[strlen(str)],"\"TRIM\":%d,\r\n", s->trim);
+    sprintf(&str[strlen(str)],"\"OTPTRIM\":%d,\r\n", s->otp_trim);
+    sprintf(&str[strlen(str)],"\"CFGTRIM\":%d,\r\n", pbss->xtalTrim);
+    sprintf(&str[strlen(str)],"\"STEPS\":%d,\r\n", s->steps);
+    sprintf(&str[strlen(str)],"\"FRAMES\":%d,\r\n", s->frames);
+    sprintf(&str[strlen(str)],"\"OFFSET\":%d}}", s->offset_cppm);
+
+    sprintf(&str[2],"%04X",strlen(str)-hlen);//add formatted 4X of length, this will erase first '{'
+    str[hlen]='{';                            //restore the start bracket
+    sprintf(&str[strlen(str)],"\r\n");
+    port_tx_msg((uint8_t*)str, strlen(str));
+
+    return (CMD_FN_RET_OK);
+}
+
+/*
+ * @brief show the reason of the last MCU reset and the resets since the
+ *        power was applied in JSON format, BROWNOUT counts the supply dips
+ *
+ * */
+REG_FN(f_resetstat)
+{
+    static const char * const reasons[PORT_RESET_NUM] = { "POWERON", "BROWNOUT", "WARM" };
+    const port_reset_info_t *s = port_reset_info();
+    char *str = MEM_ARENA(MEM_CMD_STR);
+    int  hlen;
+
+    hlen = sprintf(str,"JS%04X", 0x5A5A);    // reserve space for length of JS object
+    sprintf(&str[strlen(str)],"{\"RESETSTAT\":{\r\n");
+    sprintf(&str[strlen(str)],"\"LAST\":\"%s\",\r\n", reasons[s->last]);
+    sprintf(&str[strlen(str)],"\"POWERON\":%lu,\r\n", (unsigned long)s->cnt[PORT_RESET_POWER_ON]);
+    sprintf(&str[strlen(str)],"\"BROWNOUT\":%lu,\r\n", (unsigned long)s->cnt[PORT_RESET_BROWN_OUT]);
+    sprintf(&str[strlen(str)],"\"WARM\":%lu}}", (unsigned long)s->cnt[PORT_RESET_WARM]);
+
+    sprintf(&str[2],"%04X",strlen(str)-hlen);//add formatted 4X of length, this will erase first '{'
+    str[hlen]='{';                            //restore the start bracket
+    sprintf(&str[strlen(str)],"\r\n");
+    port_tx_msg((uint8_t*)str, strlen(str));
+
+    return (CMD_FN_RET_OK);
+}
+
+/*
+ * @brief show the RAM budget in JSON format: the arena, then [size, high water
+ *        mark] in bytes of the stack and of every region of the arena
+ *
+ * */
+REG_FN(f_memstat)
+{
+    mem_region_info_t info[MEM_REGION_NUM];
+    mem_region_info_t stack;
+    char *str = MEM_ARENA(MEM_CMD_STR);
+    int  hlen, i;
+
+    /* before the answer is written over the CMDSTR region */
+    for(i = 0; i < MEM_REGION_NUM; i++)
+    {
+        mem_arena_info(i, &info[i]);
+    }
+    mem_stack_info(&stack);
+
+    hlen = sprintf(str,"JS%04X", 0x5A5A);    // reserve space for length of JS object
+    sprintf(&str[strlen(str)],"{\"MEM\":{\r\n");
+    sprintf(&str[strlen(str)],"\"BUDGET\":%d,\r\n", MEM_ARENA_BUDGET);
+    sprintf(&str[strlen(str)],"\"ARENA\":%d,\r\n", sizeof(mem_arena_t));
+    sprintf(&str[strlen(str)],"\"%s\":[%d,%d]", stack.name, stack.size, stack.hwm);
+    for(i = 0; i < MEM_REGION_NUM; i++)
+    {
+        sprintf(&str[strlen(str)],",\r\n\"%s\":[%d,%d]", info[i].name, info[i].size, info[i].hwm);
+    }
+    sprintf(&str[strlen(str)],"}}");
+
+    sprintf(&str[2],"%04X",strlen(str)-hlen);//add formatted 4X of length, this will erase first '{'
+    str[hlen]='{';                            //restore the start bracket
+    sprintf(&str[strlen(str)],"\r\n");
+    port_tx_msg((uint8_t*)str, strlen(str));
+
+    return (CMD_FN_RET_OK);
+}
+
+#if PROF_ENABLE == 1
+/*
+ * @brief show the hot path profile in JSON format, in CPU cycles
+ *        "PROF 1" clears the profile after it has been shown
+ *
+ * */
+REG_FN(f_prof)
+{
+    const prof_entry_t *e;
+    char *str = MEM_ARENA(MEM_CMD_STR);
+    int  hlen;
+    int  i;
+
+    hlen = sprintf(str,"JS%04X", 0x5A5A);    // reserve space for length of JS object
+    sprintf(&str[strlen(str)],"{\"PROF\":{\r\n");
+    sprintf(&str[strlen(str)],"\"CLK\":%lu,\r\n", (unsigned long)SystemCoreClock);
+
+    for(i = 0; i < PROF_NUM; i++)
+    {
+        e = prof_get((prof_phase_e)i);
+        sprintf(&str[strlen(str)],"\"%s\":{\"N\":%lu,\"MIN\":%lu,\"MAX\":%lu,\"MEAN\":%lu}%s\r\n",
+                prof_name((prof_phase_e)i),
+                (unsigned long)e->count,
+                (unsigned long)((e->count) ? (e->min) : (0)),
+                (unsigned long)e->max,
+                (unsigned long)((e->count) ? (e->sum / e->count) : (0)),
+                (i < PROF_NUM - 1) ? (",") : ("}}"));
+    }
+
+    sprintf(&str[2],"%04X",strlen(str)-hlen);//add formatted 4X of length, this will erase first '{'
+    str[hlen]='{';                            //restore the start bracket
+    sprintf(&str[strlen(str)],"\r\n");
+    port_tx_msg((uint8_t*)str, strlen(str));
+
+    if(val == 1)
+    {
+        prof_reset();
+    }
+
+    return (CMD_FN_RET_OK);
+}
+#endif /* PROF_ENABLE */
+
 
 REG_FN(f_help_app)
 {
     int        indx = 0;
     const char * ret = NULL;
 
-    char str[MAX_STR_SIZE];
+    char *str = MEM_ARENA(MEM_CMD_STR);
     
     while (known_commands[indx].name != NULL)
     {
@@ -292,6 +744,15 @@ REG_FN(f_save)
 const command_t known_commands []= {
     /* CMDNAME   MODE   fn     */
     {"STAT",    mANY,   f_stat},
+    {"DLSTAT",  mANY,   f_dlstat},
+    {"BUDGETSTAT", mANY, f_budgetstat},
+    {"XTALSTAT", mANY, f_xtalstat},
+    {"RESETSTAT", mANY, f_resetstat},
+    {"MEM",     mANY,   f_memstat},
+    {"RSTAT",   mANY,   f_rstat},
+#if PROF_ENABLE == 1
+    {"PROF",    mANY,   f_prof},
+#endif
     {"HELP",    mANY,   f_help_app},
     {"SAVE",    mANY,   f_save},
 
@@ -307,10 +768,31 @@ const command_t known_commands []= {
     {"PHRMODE", mANY, f_phrMode},       //!< PHR mode {0x0 - standard DWT_PHRMODE_STD, 0x3 - extended frames DWT_PHRMODE_EXT
     {"SFDTO", mANY, f_sfdTO},               //!< SFD timeout value (in symbols)
     {"SMARTPOWEREN", mANY, f_smartPowerEn}, //!< Smart Power enable / disable};
+    {"PRESET", mANY, f_preset},             //!< Link preset of DEFAULT_PRESETS, applied from the next blink
 
     {"BLINKFAST", mANY, f_interval_in_ms},      //!< Blink interval in ms
     {"BLINKSLOW", mANY, f_interval_slow_in_ms}, //!< Blink interval in ms
     {"RANDOMNESS", mANY, f_randomness},         //!< Randomness in %
+    {"DELAYEDTX", mANY, f_delayedTxEn},         //!< Blinks timed by the DW1000 clock (DW1000 stays in IDLE)
+    {"SUPERFRAME", mANY, f_superframe},         //!< TDMA superframe in ms, 0 - ALOHA blinks
+    {"SLOTIDX", mANY, f_slotIdx},               //!< TDMA slot of the Tag
+    {"SLOTWIDTH", mANY, f_slotWidth},           //!< TDMA slot width in us
+    {"BURST", mANY, f_burst},                   //!< Blinks sent per wake up, 1 - no burst
+    {"BURSTGAP", mANY, f_burstGap},             //!< Blink to blink time in a burst in us
+    {"MOTIONRATE", mANY, f_motionRate},         //!< Blink rate follows the motion intensity
+    {"BLINKMOVE", mANY, f_interval_move_ms},    //!< Blink interval in ms at MOTIONLO
+    {"MOTIONLO", mANY, f_motionLo},             //!< Motion intensity in mg, below: still
+    {"MOTIONHI", mANY, f_motionHi},             //!< Motion intensity in mg, above: BLINKFAST
+    {"XTALTRIM", mANY, f_xtalTrim},             //!< DW1000 XTAL trim 1..31, 0 - the OTP value
+    {"XTALCAL", mANY, f_xtalCal},               //!< XTAL trim calibration on the downlink frames, 0 - stop
+    {"DWP", mANY, f_dwp},                       //!< Blink telemetry fields: 0x01 temp, 0x02 vbat, 0x10 acc
+    {"DLPERIOD", mANY, f_dlPeriod},             //!< Downlink listen window after every Nth blink, 0 - off
+    {"DLWINDOW", mANY, f_dlWindow},             //!< Downlink listen window in us
+    {"DLSNIFFON", mANY, f_dlSniffOn},           //!< Sniff mode receiver on time in PACs, 0 - sniff off
+    {"DLSNIFFOFF", mANY, f_dlSniffOff},         //!< Sniff mode receiver off time in us
+    {"BUDGET", mANY, f_budget},                 //!< Target runtime in minutes from now, 0 - off
+    {"BUDGETMAX", mANY, f_budgetMax},           //!< Longest blink interval stretch, times
+    {"BUDGETEMPTY", mANY, f_budgetEmpty},       //!< Battery empty voltage in mV
 
     {"TAGID", mANY, f_tagID},       //!< Individual configurable ID of the Tag
     {"TAGIDSET", mANY, f_tagIDset},  //!< Individual configurable ID of the Tag set or unset
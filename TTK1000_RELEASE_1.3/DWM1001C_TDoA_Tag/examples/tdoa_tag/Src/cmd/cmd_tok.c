@@ -0,0 +1,160 @@
+/*
+ * @file    cmd_tok.c
+ * @brief   command tokenizer and perfect hash dispatch index
+ *
+ *          The name hash is the FNV-1a of the upper case name. The slot of
+ *          a name is the top bits of (hash ^ seed) * CMD_INDEX_MUL, and
+ *          cmd_index_build() tries the seeds in turn until every name of
+ *          the table has a slot of its own. With ~50 names in 256 slots a
+ *          seed is found after ~70 tries, in well under a millisecond.
+ *          The C compiler cannot hash the string literals of the table,
+ *          so the index is built at start up from the table itself: a
+ *          command added to the table needs no other change.
+ *
+ * @author Decawave Software
+ *
+ * @attention Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *            All rights reserved.
+ *
+ */
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include "cmd_tok.h"
+
+#define CMD_FNV_BASIS           (2166136261UL)
+#define CMD_FNV_PRIME           (16777619UL)
+#define CMD_INDEX_MUL           (0x9E3779B1UL)
+#define CMD_INDEX_BITS          (8)     /* log2(CMD_INDEX_SIZE) */
+#define CMD_SEED_TRIES          (0x10000)
+
+#define CMD_SLOT(hash, seed)    ((uint8_t)((uint32_t)(((hash) ^ (seed)) * CMD_INDEX_MUL) >> (32 - CMD_INDEX_BITS)))
+
+/*
+ * @brief hash of a table name, as cmd_token() computes it
+ * */
+static uint32_t cmd_name_hash(const char *name)
+{
+    uint32_t h = CMD_FNV_BASIS;
+
+    while(*name)
+    {
+        h = (h ^ (uint8_t)(*name++)) * CMD_FNV_PRIME;
+    }
+    return h;
+}
+
+/* @fn      cmd_token
+ * @brief   cut "NAME [VALUE]" out of len chars of text (or up to a 0)
+ * @return  0, -1 if there is no name or it is longer than CMD_NAME_MAX
+ * */
+int cmd_token(const char *text, uint16_t len, cmd_token_t *tok)
+{
+    const char *end = text + len;
+    uint32_t h = CMD_FNV_BASIS;
+    char     c;
+
+    tok->len = 0;
+    tok->val = 0;
+
+    while((text < end) && (*text == ' '))
+    {
+        text++;
+    }
+    while((text < end) && (*text != 0) && (*text != ' ') && (*text != '\r') && (*text != '\n'))
+    {
+        if(tok->len == CMD_NAME_MAX)
+        {
+            return -1;
+        }
+        c = (char)toupper((int)*text++);
+        tok->name[tok->len++] = c;
+        h = (h ^ (uint8_t)c) * CMD_FNV_PRIME;
+    }
+    tok->name[tok->len] = 0;
+    tok->hash = h;
+
+    if(tok->len == 0)
+    {
+        return -1;
+    }
+    if((text < end) && (*text == ' '))
+    {
+        /* only a text line has a value after the name, it is 0 terminated */
+        tok->val = (int)strtol(text, NULL, 10);
+    }
+    return 0;
+}
+
+/* @fn      cmd_index_build
+ * @brief   search the seed of a NULL terminated table, once at start up,
+ *          the table must not change afterwards
+ * @return  0, -1 if no seed was found (cmd_index_find() then scans the table)
+ * */
+int cmd_index_build(cmd_index_t *ix, const command_t *table)
+{
+    uint32_t seed;
+    uint8_t  s;
+    int      i;
+
+    ix->table = table;
+
+    for(seed = 0; seed < CMD_SEED_TRIES; seed++)
+    {
+        memset(ix->slot, CMD_INDEX_NONE, sizeof(ix->slot));
+
+        for(i = 0; table[i].name != NULL; i++)
+        {
+            s = CMD_SLOT(cmd_name_hash(table[i].name), seed);
+            if((i >= CMD_INDEX_NONE) || (ix->slot[s] != CMD_INDEX_NONE))
+            {
+                break;
+            }
+            ix->slot[s] = (uint8_t)i;
+        }
+        if(table[i].name == NULL)
+        {
+            ix->seed = seed;
+            return 0;
+        }
+    }
+
+    ix->seed = CMD_SEED_TRIES;
+    return -1;
+}
+
+/* @fn      cmd_index_find
+ * @brief   command of a token
+ * @return  the table entry, NULL if the name is not known
+ * */
+const command_t *cmd_index_find(const cmd_index_t *ix, const cmd_token_t *tok)
+{
+    const command_t *pk;
+    uint8_t i;
+
+    if(ix->table == NULL)
+    {
+        return NULL;
+    }
+
+    if(ix->seed == CMD_SEED_TRIES)
+    {
+        for(pk = ix->table; pk->name != NULL; pk++)
+        {
+            if(strcmp(tok->name, pk->name) == 0)
+            {
+                return pk;
+            }
+        }
+        return NULL;
+    }
+
+    i = ix->slot[CMD_SLOT(tok->hash, ix->seed)];
+    if((i == CMD_INDEX_NONE) || (strcmp(tok->name, ix->table[i].name) != 0))
+    {
+        return NULL;
+    }
+    return &ix->table[i];
+}
+
+/* end of cmd_tok.c */
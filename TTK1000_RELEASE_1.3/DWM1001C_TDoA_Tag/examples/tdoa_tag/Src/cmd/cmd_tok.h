@@ -0,0 +1,74 @@
+/*
+ * @file cmd_tok.h
+ *
+ * @brief  header file for cmd_tok.c
+ *
+ *         The command name of a text line or of a CMD_BIN_CMD TLV is cut
+ *         by cmd_token(), which folds it to upper case and hashes it in the
+ *         same pass, and is found in a command_t table with one slot of a
+ *         perfect hash index and one strcmp().
+ *
+ * @author Decawave Software
+ *
+ * @attention Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *            All rights reserved.
+ *
+ */
+#ifndef INC_CMD_TOK_H_
+#define INC_CMD_TOK_H_    1
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+#include "cmd_fn.h"
+
+//-----------------------------------------------------------------------------
+/* module DEFINITIONS */
+
+#define CMD_NAME_MAX            (15)    /**< longest command name */
+#define CMD_INDEX_SIZE          (256)   /**< slots of the index, power of 2, > table size */
+#define CMD_INDEX_NONE          (0xFF)
+
+ /* command line cut by cmd_token() */
+ typedef struct {
+     char        name[CMD_NAME_MAX + 1];    /**< upper case */
+     uint8_t     len;
+     uint32_t    hash;                      /**< of the name, before the index seed */
+     int         val;                       /**< 0 if no value follows the name */
+ }cmd_token_t;
+
+ /* perfect hash index of a command_t table */
+ typedef struct {
+     const command_t *table;
+     uint32_t    seed;                      /**< no two names of the table share a slot */
+     uint8_t     slot[CMD_INDEX_SIZE];      /**< table index, CMD_INDEX_NONE if empty */
+ }cmd_index_t;
+
+/* @fn      cmd_token
+ * @brief   cut "NAME [VALUE]" out of len chars of text (or up to a 0)
+ * @return  0, -1 if there is no name or it is longer than CMD_NAME_MAX
+ * */
+int cmd_token(const char *text, uint16_t len, cmd_token_t *tok);
+
+/* @fn      cmd_index_build
+ * @brief   search the seed of a NULL terminated table, once at start up,
+ *          the table must not change afterwards
+ * @return  0, -1 if no seed was found (cmd_index_find() then scans the table)
+ * */
+int cmd_index_build(cmd_index_t *ix, const command_t *table);
+
+/* @fn      cmd_index_find
+ * @brief   command of a token
+ * @return  the table entry, NULL if the name is not known
+ * */
+const command_t *cmd_index_find(const cmd_index_t *ix, const cmd_token_t *tok);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* INC_CMD_TOK_H_ */
@@ -10,12 +10,12 @@
  */
 
 #include "cmd_uart_rx.h"
+#include "cmd_bin.h"
+#include "mem_arena.h"
 
 extern void port_tx_msg(char *ptr, int len);
 
-#define COM_RX_BUF_SIZE   (64)
-
-static uint8_t local_buff[COM_RX_BUF_SIZE];
+static uint8_t * const local_buff = MEM_ARENA(MEM_CMD_LINE);
 static uint16_t local_buff_length=0;
 
 typedef enum {
@@ -35,7 +35,7 @@ uart_data_e waitForCommand(uint8_t *pBuf, uint16_t len)
 {
     uart_data_e ret;
     static uint8_t cmdLen = 0;
-    static uint8_t cmdBuf[COM_RX_BUF_SIZE]; /**< slow command buffer : small size */
+    uint8_t *cmdBuf = MEM_ARENA(MEM_CMD_EDIT); /**< slow command buffer : small size */
 
     ret = NO_DATA;
 
@@ -43,10 +43,10 @@ uart_data_e waitForCommand(uint8_t *pBuf, uint16_t len)
     {/* "slow" command mode: Human interface. Wait until '\r' or '\n' */
         if (cmdLen == 0)
         {
-            memset(cmdBuf, 0, sizeof(cmdBuf));
+            memset(cmdBuf, 0, MEM_ARENA_SIZE(MEM_CMD_EDIT));
         }
 
-        if (cmdLen < (sizeof(local_buff) - 1))
+        if (cmdLen < (MEM_ARENA_SIZE(MEM_CMD_LINE) - 1))
         {
             port_tx_msg(pBuf, len);    //ECHO
 
@@ -55,6 +55,7 @@ uart_data_e waitForCommand(uint8_t *pBuf, uint16_t len)
                 if (cmdLen > 0)
                 {
                     memcpy(local_buff, cmdBuf, cmdLen);
+                    mem_arena_mark(MEM_CMD_LINE, cmdLen + 1);
 
                     local_buff_length = cmdLen;
                     local_buff[cmdLen] = 0;
@@ -77,6 +78,7 @@ uart_data_e waitForCommand(uint8_t *pBuf, uint16_t len)
             {
                 cmdBuf[cmdLen] = *pBuf;
                 cmdLen++;
+                mem_arena_mark(MEM_CMD_EDIT, cmdLen);
             }
         }
         else
@@ -89,9 +91,10 @@ uart_data_e waitForCommand(uint8_t *pBuf, uint16_t len)
     else
     {/* "fast" command mode : assume every data buffer is "COMMAND_READY" */
 
-        if (len < (sizeof(local_buff) - 1))
+        if (len < (MEM_ARENA_SIZE(MEM_CMD_LINE) - 1))
         {
             memcpy(local_buff, pBuf, len);
+            mem_arena_mark(MEM_CMD_LINE, len + 1);
 
             local_buff_length = len;
             local_buff[len] = 0;
@@ -116,23 +119,30 @@ uart_data_e waitForCommand(uint8_t *pBuf, uint16_t len)
  *        If the UART msg is dwUWB command then enter
  *        into UART_COMMAND mode and perform operation
  *        based on uart input.
+ *        A binary configuration frame (CMD_BIN_SOF) goes to command_bin_parser().
  * @param[in] void
  * */
 void process_uartmsg(void)
 {
-    char rx_buf[COM_RX_BUF_SIZE];
+    char *rx_buf = MEM_ARENA(MEM_UART_MSG);
     int uartLen, res;
 
-    memset(rx_buf,0,sizeof(rx_buf));
-    uartLen = deca_uart_receive(rx_buf, COM_RX_BUF_SIZE );
-    
-    if(uartLen > 0)
+    memset(rx_buf,0,MEM_ARENA_SIZE(MEM_UART_MSG));
+    uartLen = deca_uart_receive(rx_buf, MEM_ARENA_SIZE(MEM_UART_MSG) );
+    mem_arena_mark(MEM_UART_MSG, uartLen);
+
+    if((uartLen > 1) && ((uint8_t)rx_buf[0] == CMD_BIN_SOF))
+    {
+        /* deca_uart_receive() counts the terminating 0 */
+        command_bin_parser((uint8_t *)rx_buf, uartLen - 1);
+    }
+    else if(uartLen > 0)
     {
       res = waitForCommand(rx_buf, uartLen);
     
       if (res == COMMAND_READY)
       {
-          int len = MIN((local_buff_length-1), (sizeof(local_buff)-1));
+          int len = MIN((local_buff_length-1), (MEM_ARENA_SIZE(MEM_CMD_LINE)-1));
           local_buff[len+1] = 0;
           command_parser((char *)local_buff);            //parse and execute the command
       }
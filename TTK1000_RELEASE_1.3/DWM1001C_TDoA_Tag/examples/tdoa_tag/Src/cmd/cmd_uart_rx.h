@@ -21,6 +21,9 @@
 #include "config.h"
 #include "cmd.h"
 
+/* line of the text commands */
+#define COM_RX_BUF_SIZE   (64)
+
 
 #ifdef __cplusplus
 }
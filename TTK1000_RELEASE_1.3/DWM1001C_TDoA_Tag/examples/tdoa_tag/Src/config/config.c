@@ -1,6 +1,25 @@
 /*
  * @file       config.c
  *
+ * @brief      Configuration store
+ *
+ *             FConfig is the configuration image built into the firmware and
+ *             is never erased. Changes are appended as records to a journal
+ *             of two flash pages, each record carries a run of param_block_t
+ *             bytes which differ from the previous save:
+ *
+ *             | offset (2) | len (1) | ~len (1) | crc (2) | 0xFFFF | data, padded to 4 |
+ *
+ *             The crc covers offset, len and data, a record torn by a reset is
+ *             skipped on load. The first word of a journal page holds
+ *             CONFIG_JOURNAL_MAGIC and a generation number, the page with the
+ *             newest generation is the active one. When it is full the
+ *             difference to FConfig is written to the other page as a fresh
+ *             snapshot, its header last, and only then the full page is erased.
+ *
+ *             load_bssConfig() replays the records of the active page on top
+ *             of FConfig.
+ *
  * @author     Decawave Software
  *
  * @attention  Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
@@ -11,10 +30,24 @@
 #include "instance.h"
 #include "nrf_nvmc.h"
 #include "default_config.h"
+#include "crc16.h"
+
+/* nRF52832 erase unit, the journal pages must not share it with anything */
+#define CONFIG_JOURNAL_PAGE_SIZE    (0x1000)
+#define CONFIG_JOURNAL_PAGES        (2)
+#define CONFIG_JOURNAL_MAGIC        (0xC0F1)
+/* longest record, runs of changed bytes are split into records of this size */
+#define CONFIG_REC_MAX              (64)
+/* unchanged bytes between two changed runs which still go into one record */
+#define CONFIG_REC_GAP              (8)
+
+#define CONFIG_REC_HDR_SIZE         (8)
+#define CONFIG_WORD_ALIGN(x)        (((x) + 3) & ~3UL)
+#define CONFIG_ERASED_WORD          (0xFFFFFFFFUL)
 
 /* The location of FConfig and defaultConfig are defined in Linker script file and project configuration options */
 
-/* Changeble block of parameters in the NVM */
+/* Configuration parameters built into the firmware, the base of the journal */
 const param_block_t FConfig __attribute__((section(".fConfig"))) \
                                    __attribute__((aligned(NRF52_FLASH_PAGE_SIZE))) = DEFAULT_CONFIG;
 
@@ -22,16 +55,226 @@ const param_block_t FConfig __attribute__((section(".fConfig"))) \
 const param_block_t defaultFConfig __attribute__((section(".default_config"))) \
                                    __attribute__((aligned(NRF52_FLASH_PAGE_SIZE))) = DEFAULT_CONFIG;
 
+/* Journal of the configuration changes, programmed erased */
+static const uint8_t configJournal[CONFIG_JOURNAL_PAGES * CONFIG_JOURNAL_PAGE_SIZE] \
+                                   __attribute__((section(".config_journal"))) \
+                                   __attribute__((aligned(CONFIG_JOURNAL_PAGE_SIZE))) = \
+                                   { [0 ... (CONFIG_JOURNAL_PAGES * CONFIG_JOURNAL_PAGE_SIZE - 1)] = 0xFF };
+
 /* Run-Time config parameters. */
 static param_block_t tmpConfig __attribute__((aligned(NRF52_FLASH_PAGE_SIZE)));
 
+/* the configuration as it is stored: FConfig with the journal applied */
+static param_block_t nvmConfig;
+
+static int      journalPage = -1;   // active journal page, -1: none
+static uint16_t journalGen;         // generation of the active page
+static uint32_t journalPos;         // append offset in the active page
+
 
 /* IMPLEMENTATION */
+
+/* the journal is written behind the compiler's back, it is read through
+ * volatile pointers so no read is folded to the erased initial value */
+static const volatile uint8_t *journal_ptr(int page, uint32_t pos)
+{
+    return &configJournal[page * CONFIG_JOURNAL_PAGE_SIZE + pos];
+}
+
+static uint32_t journal_addr(int page)
+{
+    return (uint32_t)journal_ptr(page, 0);
+}
+
+static uint32_t journal_word(int page, uint32_t pos)
+{
+    return *(const volatile uint32_t *)journal_ptr(page, pos);
+}
+
+static uint16_t journal_rec_crc(uint16_t offset, uint8_t len, const uint8_t *data)
+{
+    uint8_t  hdr[3] = { (uint8_t)offset, (uint8_t)(offset >> 8), len };
+    uint16_t crc;
+
+    crc = crc16_ccitt(CRC16_INIT, hdr, sizeof(hdr));
+    return crc16_ccitt(crc, data, len);
+}
+
+/* @brief   pick the page with the newest generation and replay its records
+ *          over FConfig into nvmConfig
+ * */
+static void journal_load(void)
+{
+    uint32_t hdr, w0, w1;
+    uint16_t offset, gen = 0;
+    uint8_t  len;
+    uint32_t pos;
+    int      page;
+
+    journalPage = -1;
+
+    for(page = 0; page < CONFIG_JOURNAL_PAGES; page++)
+    {
+        hdr = journal_word(page, 0);
+
+        if((hdr & 0xFFFF) != CONFIG_JOURNAL_MAGIC)
+        {
+            continue;
+        }
+        if((journalPage < 0) || ((int16_t)((uint16_t)(hdr >> 16) - gen) > 0))
+        {
+            journalPage = page;
+            gen = (uint16_t)(hdr >> 16);
+        }
+    }
+
+    memcpy(&nvmConfig, &FConfig, sizeof(nvmConfig));
+
+    journalGen = gen;
+    journalPos = CONFIG_JOURNAL_PAGE_SIZE;
+
+    if(journalPage < 0)
+    {
+        return;
+    }
+
+    pos = sizeof(uint32_t);
+    while(pos + CONFIG_REC_HDR_SIZE <= CONFIG_JOURNAL_PAGE_SIZE)
+    {
+        w0 = journal_word(journalPage, pos);
+        if(w0 == CONFIG_ERASED_WORD)
+        {
+            break;      // end of the journal
+        }
+
+        offset = (uint16_t)(w0);
+        len    = (uint8_t)(w0 >> 16);
+
+        if(((uint8_t)(w0 >> 24) != (uint8_t)~len) || (len == 0) ||
+           (pos + CONFIG_REC_HDR_SIZE + len > CONFIG_JOURNAL_PAGE_SIZE))
+        {
+            return;     // corrupted header, the page is compacted on the next save
+        }
+
+        w1 = journal_word(journalPage, pos + 4);
+        pos += CONFIG_REC_HDR_SIZE;
+
+        if((offset + len <= sizeof(nvmConfig)) &&
+           ((uint16_t)w1 == journal_rec_crc(offset, len, (const uint8_t *)journal_ptr(journalPage, pos))))
+        {
+            memcpy((uint8_t *)&nvmConfig + offset, (const uint8_t *)journal_ptr(journalPage, pos), len);
+        }
+        /* else torn record: skipped */
+
+        pos += CONFIG_WORD_ALIGN(len);
+    }
+
+    journalPos = pos;
+}
+
+/* @brief   append a record at pos of page
+ * */
+static void journal_write_rec(int page, uint32_t pos, uint16_t offset, const uint8_t *data, uint8_t len)
+{
+    uint32_t buf[CONFIG_WORD_ALIGN(CONFIG_REC_MAX) / 4];
+    uint32_t hdr[2];
+
+    hdr[0] = offset | ((uint32_t)len << 16) | ((uint32_t)(uint8_t)~len << 24);
+    hdr[1] = journal_rec_crc(offset, len, data) | 0xFFFF0000UL;
+
+    memset(buf, 0xFF, sizeof(buf));
+    memcpy(buf, data, len);
+
+    nrf_nvmc_write_words(journal_addr(page) + pos, hdr, 2);
+    nrf_nvmc_write_words(journal_addr(page) + pos + CONFIG_REC_HDR_SIZE, buf, CONFIG_WORD_ALIGN(len) / 4);
+}
+
+/* @brief   write the bytes of cfg which differ from ref as records from
+ *          *pos of page, page < 0 only counts the space needed
+ * @return  the space the records take
+ * */
+static uint32_t journal_write_diff(int page, uint32_t *pos, const uint8_t *cfg, const uint8_t *ref)
+{
+    uint32_t size = 0;
+    int      i = 0, start, end, gap;
+
+    while(i < (int)sizeof(param_block_t))
+    {
+        if(cfg[i] == ref[i])
+        {
+            i++;
+            continue;
+        }
+
+        /* run of changes, short unchanged gaps included */
+        start = i;
+        end = i + 1;
+        gap = 0;
+        for(i = end; (i < (int)sizeof(param_block_t)) && (i - start < CONFIG_REC_MAX) && (gap < CONFIG_REC_GAP); i++)
+        {
+            if(cfg[i] != ref[i])
+            {
+                end = i + 1;
+                gap = 0;
+            }
+            else
+            {
+                gap++;
+            }
+        }
+        i = end;
+
+        if(page >= 0)
+        {
+            journal_write_rec(page, *pos + size, (uint16_t)start, &cfg[start], (uint8_t)(end - start));
+        }
+        size += CONFIG_REC_HDR_SIZE + CONFIG_WORD_ALIGN(end - start);
+    }
+
+    if(pos != NULL)
+    {
+        *pos += size;
+    }
+    return size;
+}
+
+/* @brief   write cfg as a fresh snapshot to the other page and retire the
+ *          active one
+ * */
+static void journal_compact(const param_block_t *cfg)
+{
+    int      page = (journalPage < 0) ? (0) : ((journalPage + 1) % CONFIG_JOURNAL_PAGES);
+    uint16_t gen = journalGen + 1;
+    uint32_t pos = sizeof(uint32_t);
+    int      i;
+
+    nrf_nvmc_page_erase(journal_addr(page));
+
+    journal_write_diff(page, &pos, (const uint8_t *)cfg, (const uint8_t *)&FConfig);
+
+    nrf_nvmc_write_word(journal_addr(page), CONFIG_JOURNAL_MAGIC | ((uint32_t)gen << 16));
+
+    for(i = 0; i < CONFIG_JOURNAL_PAGES; i++)
+    {
+        if((i != page) && (journal_word(i, 0) != CONFIG_ERASED_WORD))
+        {
+            nrf_nvmc_page_erase(journal_addr(i));
+        }
+    }
+
+    journalPage = page;
+    journalGen = gen;
+    journalPos = pos;
+}
+
+
 /* Exported functions  */
 
 void load_bssConfig(void)
 {
-    memcpy(&tmpConfig, &FConfig, sizeof(tmpConfig));
+    journal_load();
+
+    memcpy(&tmpConfig, &nvmConfig, sizeof(tmpConfig));
 
     app.pConfig = &tmpConfig;
 }
@@ -43,18 +286,35 @@ param_block_t *get_pbssConfig(void)
 }
 
 
-/* @brief    Writes buffer to the nonvolatile config location &FConfig
- * assumes data fold to page
+/* @brief    Saves the changes of pbuf since the last save to the
+ *           configuration journal, the journal is compacted when full
  *
  */
 void save_bssConfig(param_block_t * pbuf)
 {
+    uint32_t need;
+
+    need = journal_write_diff(-1, NULL, (const uint8_t *)pbuf, (const uint8_t *)&nvmConfig);
+
+    if(need == 0)
+    {
+        return;
+    }
+
     __disable_irq();
-    nrf_nvmc_page_erase((uint32_t)&FConfig);
 
-    nrf_nvmc_write_bytes((uint32_t)&FConfig, (uint8_t*)pbuf, FCONFIG_SIZE);
+    if((journalPage < 0) || (journalPos + need > CONFIG_JOURNAL_PAGE_SIZE))
+    {
+        journal_compact(pbuf);
+    }
+    else
+    {
+        journal_write_diff(journalPage, &journalPos, (const uint8_t *)pbuf, (const uint8_t *)&nvmConfig);
+    }
 
     __enable_irq();
+
+    memcpy(&nvmConfig, pbuf, sizeof(nvmConfig));
 }
 
 
@@ -64,14 +324,21 @@ void save_bssConfig(param_block_t * pbuf)
  * */
 void restore_nvm_fconfig(void)
 {    
+    int i;
+
     __disable_irq();
 
-    nrf_nvmc_page_erase((uint32_t)&FConfig);
-    nrf_nvmc_write_bytes((uint32_t)&FConfig,  (const uint8_t *)&defaultFConfig, FCONFIG_SIZE);
+    for(i = 0; i < CONFIG_JOURNAL_PAGES; i++)
+    {
+        nrf_nvmc_page_erase(journal_addr(i));
+    }
 
-    load_bssConfig();
+    journal_load();
 
     __enable_irq();
 
+    save_bssConfig((param_block_t *)&defaultFConfig);
+
+    load_bssConfig();
 }
 /* end of config.c */
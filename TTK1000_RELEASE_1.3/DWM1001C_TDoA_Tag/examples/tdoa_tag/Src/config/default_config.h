@@ -19,6 +19,7 @@
 #include <stdint.h>
 #include "deca_device_api.h"
 #include "deca_version.h"
+#include "tvc.h"
 
 /*channel*/
 #define DEFAULT_CHANNEL                         2
@@ -37,15 +38,68 @@
 #define DEFAULT_BLINKINTERVAL_FAST_MS     100
 #define DEFAULT_BLINKINTERVAL_SLOW_MS     5000
 
+/* motion proportional blink rate, disabled by default (BLINKFAST while moving,
+ * BLINKSLOW when still, see motion_rate.c)
+ * while moving the interval is scaled from BLINKMOVE at the low intensity to
+ * BLINKFAST at the high intensity, intensity in mg */
+#define DEFAULT_MOTIONRATE                      0
+#define DEFAULT_BLINKINTERVAL_MOVE_MS           500
+#define DEFAULT_MOTION_LO_MG                    40
+#define DEFAULT_MOTION_HI_MG                    400
+
 /* blink randomness, 10 % */
 #define DEFAULT_RAND                            10
 
-/* NO IMU by default */
+/* blinks are sent immediately by default, see instance.c for the DW1000
+ * timed (delayed) blink mode */
+#define DEFAULT_DELAYEDTX                       0
+
+/* TDMA slotted blinks, disabled while the superframe is 0 (ALOHA blinks)
+ * superframe in ms, slot width in us */
+#define DEFAULT_SUPERFRAME_MS                   0
+#define DEFAULT_SLOT_IDX                        0
+#define DEFAULT_SLOT_WIDTH_US                   500
+
+/* XTAL trim 1 to 31, 0: the OTP value, set by the XTALCAL calibration */
+#define DEFAULT_XTAL_TRIM                       0
+
+/* micro-burst of blinks per wake up, 1: a single blink, spaced by the gap
+ * in us on the DW1000 clock, see instance.c */
+#define DEFAULT_BURST_COUNT                     1
+#define DEFAULT_BURST_GAP_US                    1000
+
+/* downlink listen window after every DLPERIOD-th blink, disabled while 0
+ * window in us, sniff mode ON time in PACs (0: receiver always on during
+ * the window) and OFF time in ~us, see instance.c */
+#define DEFAULT_DL_PERIOD                       0
+#define DEFAULT_DL_WINDOW_US                    1000
+#define DEFAULT_DL_SNIFF_ON                     2
+#define DEFAULT_DL_SNIFF_OFF                    16
+
+/* blink budget, disabled while the target runtime is 0
+ * runtime in minutes from power up (or the BUDGET command), the blink
+ * interval is stretched up to BUDGETMAX times to last down to the empty
+ * vbat in mV, see budget.c */
+#define DEFAULT_BUDGET_MIN                      0
+#define DEFAULT_BUDGET_EMPTY_MV                 DW_VBAT_MIN
+#define DEFAULT_BUDGET_STRETCH_MAX              4
+
+/* link presets of the PRESET command, on the channel, PRF and preamble codes
+ * of the configuration: data rate, preamble length, PAC, nsSFD and SFD
+ * timeout (preamble length + 1 + SFD length - PAC). Preset 0 is the
+ * default configuration. */
+#define PRESET_NUM                              3
+#define DEFAULT_PRESETS { \
+                            { DWT_BR_6M8,  DWT_PLEN_128,  DWT_PAC8,  0, (128 + 1 + 8 - 8) }, \
+                            { DWT_BR_850K, DWT_PLEN_256,  DWT_PAC16, 1, (256 + 1 + 16 - 16) }, \
+                            { DWT_BR_110K, DWT_PLEN_1024, DWT_PAC32, 1, (1024 + 1 + 64 - 32) }, \
+}
+
+/* NO IMU by default, IMU_DWP_xx fields of the blink payload (pckt_ieee.h),
+ * only IMU_DWP_TMP, IMU_DWP_BAT and IMU_DWP_ACC are supported */
 #define DEFAULT_DWP                             (0)
 /*#define DEFAULT_DWP                           (IMU_DWP_TMP | IMU_DWP_BAT | \
-                                                IMU_DWP_GPIO | IMU_DWP_MAG | \
-                                                IMU_DWP_ACC | IMU_DWP_GYR |
-                                                IMU_DWP_APS | IMU_DWP_ATMP)*/
+                                                IMU_DWP_ACC)*/
 
 
 /* */
@@ -67,6 +121,25 @@
                             .tagID = {0,0,0,0,0,0,0,0},\
                             .tagIDset = 0,\
                             .version = {DW1000_DEVICE_DRIVER_VER_STRING}, \
+                            .delayedTxEn = DEFAULT_DELAYEDTX, \
+                            .slot.superframe_ms = DEFAULT_SUPERFRAME_MS, \
+                            .slot.slot_idx = DEFAULT_SLOT_IDX, \
+                            .slot.slot_width_us = DEFAULT_SLOT_WIDTH_US, \
+                            .burst.count = DEFAULT_BURST_COUNT, \
+                            .burst.gap_us = DEFAULT_BURST_GAP_US, \
+                            .xtalTrim = DEFAULT_XTAL_TRIM, \
+                            .dwp = DEFAULT_DWP, \
+                            .motion.adaptiveEn = DEFAULT_MOTIONRATE, \
+                            .motion.interval_move_ms = DEFAULT_BLINKINTERVAL_MOVE_MS, \
+                            .motion.intensity_lo_mg = DEFAULT_MOTION_LO_MG, \
+                            .motion.intensity_hi_mg = DEFAULT_MOTION_HI_MG, \
+                            .downlink.period = DEFAULT_DL_PERIOD, \
+                            .downlink.window_us = DEFAULT_DL_WINDOW_US, \
+                            .downlink.sniff_on = DEFAULT_DL_SNIFF_ON, \
+                            .downlink.sniff_off = DEFAULT_DL_SNIFF_OFF, \
+                            .budget.runtime_min = DEFAULT_BUDGET_MIN, \
+                            .budget.vbat_empty_mv = DEFAULT_BUDGET_EMPTY_MV, \
+                            .budget.stretch_max = DEFAULT_BUDGET_STRETCH_MAX, \
 }
 
 /* Application FCONFIG size */
@@ -79,6 +152,54 @@ typedef struct {
     uint8_t     randomness;
 }tblink_t;
 
+typedef struct {
+    uint8_t     dataRate;
+    uint8_t     txPreambLength;
+    uint8_t     rxPAC;
+    uint8_t     nsSFD;
+    uint16_t    sfdTO;
+}tpreset_t;
+
+typedef struct {
+    uint16_t    superframe_ms;  /* 0: slotted mode disabled */
+    uint16_t    slot_idx;       /* slot of this tag in the superframe */
+    uint16_t    slot_width_us;
+}tslot_t;
+
+typedef struct {
+    uint8_t     count;          /* blinks per wake up, 1: no burst */
+    uint16_t    gap_us;         /* blink to blink time in the burst */
+}tburst_t;
+
+typedef struct {
+    uint8_t     adaptiveEn;         /* scale the blink interval with the motion */
+    uint16_t    interval_move_ms;   /* interval at intensity_lo_mg */
+    uint16_t    intensity_lo_mg;    /* below: still */
+    uint16_t    intensity_hi_mg;    /* above: interval_in_ms */
+}tmotion_t;
+
+typedef struct {
+    uint16_t    window_us;      /* receiver on time after the blink */
+    uint8_t     period;         /* listen after every period-th blink, 0: never */
+    uint8_t     sniff_on;       /* SNIFF mode ON time in PACs, 0: SNIFF disabled */
+    uint8_t     sniff_off;      /* SNIFF mode OFF time in 128/125 us */
+}tdownlink_t;
+
+typedef struct {
+    uint16_t    runtime_min;    /* target runtime, 0: budget disabled */
+    uint16_t    vbat_empty_mv;  /* vbat at the end of the runtime */
+    uint8_t     stretch_max;    /* longest blink interval, times the motion/fast interval */
+}tbudget_t;
+
+/* DW1000 OTP and TX reference values, kept for the warm boot */
+typedef struct {
+    uint8_t         valid;      /* filled in on a cold boot */
+    uint8_t         chan;       /* channel of the TX reference */
+    uint8_t         ref_vbat;   /* OTP vbat of the TX reference */
+    dwt_otpvalues_t dw;         /* values read by dwt_initialise() */
+    ref_values_t    ref;        /* TX reference of the compensation */
+}totp_cache_t;
+
 #pragma pack(push,1)
 /* pointers inside this structure not allowed */
 typedef struct param_block{
@@ -88,7 +209,18 @@ typedef struct param_block{
     uint8_t         tagID[8];
     uint8_t         tagIDset;
     char            version[64];
-    uint8_t         free[FCONFIG_SIZE -sizeof(tblink_t) - sizeof(dwt_config_t) -11 -64];
+    uint8_t         delayedTxEn;    /* schedule blinks on the DW1000 clock */
+    tslot_t         slot;
+    uint8_t         dwp;            /* telemetry payload fields IMU_DWP_xx */
+    tmotion_t       motion;
+    totp_cache_t    otp;            /* written by the firmware, not a setting */
+    tdownlink_t     downlink;       /* listen window for configuration frames */
+    tbudget_t       budget;         /* blink interval stretch for a target runtime */
+    tburst_t        burst;          /* blinks sent per wake up */
+    uint8_t         xtalTrim;       /* DW1000 XTAL trim, 0: the OTP value */
+    uint8_t         free[FCONFIG_SIZE -sizeof(tblink_t) - sizeof(dwt_config_t) -11 -64 -1 \
+                         -sizeof(tslot_t) -1 -sizeof(tmotion_t) -sizeof(totp_cache_t) \
+                         -sizeof(tdownlink_t) -sizeof(tbudget_t) -sizeof(tburst_t) -1];
 }param_block_t;
 #pragma pack(pop)
 
@@ -0,0 +1,245 @@
+/*
+ * @file       ieee_payload.c
+ *
+ * @brief      Telemetry payload of the IEEE EUI-64 blink
+ *
+ *             The payload is appended to the blink after the tag ID:
+ *
+ *             | header (1) | bit packed fields, MSB first, zero padded |
+ *
+ *             The header holds the DWP_HDR_xx flags of the fields present in
+ *             the record, in TMP, BAT, ACC order. A key record (DWP_HDR_KEY)
+ *             carries the absolute values, any other record carries only the
+ *             fields which changed since the previous record, as deltas:
+ *
+ *             field  key         delta
+ *             TMP    8 bit raw   4 bit signed
+ *             BAT    8 bit raw   4 bit signed
+ *             ACC    3 x 12 bit  4 bit (width - 1), 3 x width bit signed
+ *
+ *             A blink without a payload means nothing changed. A receiver
+ *             which missed a blink (seqNum gap) has to wait for the next key
+ *             record, which the caller requests periodically.
+ *
+ * @author     Decawave Software
+ *
+ * @attention  Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *             All rights reserved.
+ */
+
+#include "port_platform.h"
+#include "deca_device_api.h"
+#include "instance.h"
+#include "tvc.h"
+#include "LIS2DH12.h"
+#include "motion_rate.h"
+
+/* acceleration changes up to this (mg) are sensor noise and are not sent */
+#define DWP_ACC_DEADBAND        (8)
+/* largest delta width of the acceleration, wider deltas need a key record */
+#define DWP_ACC_DELTA_MAX_BITS  (12)
+/* width of the temp/vbat deltas */
+#define DWP_SAR_DELTA_BITS      (4)
+
+typedef struct {
+    uint8   *buf;
+    int     bit;
+} dwp_bits_t;
+
+/* values of the previous record, the reference of the deltas */
+static uint8 dwp_ref_valid;
+static uint8 dwp_ref_fields;
+static uint8 dwp_ref_temp;
+static uint8 dwp_ref_vbat;
+static int16 dwp_ref_acc[3];
+
+/*
+ * @fn      dwp_put
+ * @brief   append the lower nbits of val to the bit stream, MSB first
+ * */
+static void dwp_put(dwp_bits_t *w, uint32 val, int nbits)
+{
+    while(nbits--)
+    {
+        if((w->bit & 7) == 0)
+        {
+            w->buf[w->bit >> 3] = 0;
+        }
+        if(val & (1UL << nbits))
+        {
+            w->buf[w->bit >> 3] |= (uint8)(0x80 >> (w->bit & 7));
+        }
+        w->bit++;
+    }
+}
+
+/*
+ * @fn      dwp_width
+ * @brief   number of bits needed for val as a two's complement number
+ * */
+static int dwp_width(int32 val)
+{
+    int n = 1;
+
+    while((val < -(1L << (n - 1))) || (val > ((1L << (n - 1)) - 1)))
+    {
+        n++;
+    }
+    return n;
+}
+
+/*
+ * @fn      dw_ieee_payload
+ * @brief   sample the selected telemetry and encode it into buf
+ *
+ * @param   dwh : IMU_DWH_xx request flags
+ * @param   dwp : IMU_DWP_xx fields to send (param_block_t.dwp)
+ * @param   buf : output, at least IEEE_PAYLOAD_MAX bytes
+ *
+ * @return  the payload length in bytes, 0 if there is nothing to send
+ * */
+int dw_ieee_payload(uint8 dwh, uint8 dwp, uint8 * buf)
+{
+    uint8       temp = 0, vbat = 0;
+    int16       acc[3] = {0, 0, 0};
+    int32       dacc[3] = {0, 0, 0};
+    int32       dtemp = 0, dvbat = 0;
+    int         accw = 1;
+    int         key;
+    uint8       hdr = 0;
+    dwp_bits_t  w;
+    int         i;
+
+    dwp &= IMU_DWP_SUPPORTED;
+
+    if(dwp == 0)
+    {
+        dwp_ref_valid = 0;
+        return 0;
+    }
+
+    if(dwp & (IMU_DWP_TMP | IMU_DWP_BAT))
+    {
+        /* the wakeup values are sampled by the DW1000 itself (DWT_TANDV),
+         * when it did not sleep use the last compensation sample instead */
+        if(!(dwh & IMU_DWH_NOSLEEP) || !tvc_last_sample(&temp, &vbat))
+        {
+            temp = dwt_readwakeuptemp();
+            vbat = dwt_readwakeupvbat();
+        }
+    }
+
+    if((dwp & IMU_DWP_ACC) && !motion_rate_last_xyz(acc))
+    {
+        vLIS2_ReadXYZ(&acc[0], &acc[1], &acc[2]);
+    }
+
+    key = (dwh & IMU_DWH_KEY) || !dwp_ref_valid || (dwp != dwp_ref_fields);
+
+    if(!key)
+    {
+        if(dwp & IMU_DWP_TMP)
+        {
+            dtemp = (int32)temp - dwp_ref_temp;
+            if(dwp_width(dtemp) > DWP_SAR_DELTA_BITS)
+            {
+                key = 1;
+            }
+            else if(dtemp != 0)
+            {
+                hdr |= DWP_HDR_TMP;
+            }
+        }
+
+        if(dwp & IMU_DWP_BAT)
+        {
+            dvbat = (int32)vbat - dwp_ref_vbat;
+            if(dwp_width(dvbat) > DWP_SAR_DELTA_BITS)
+            {
+                key = 1;
+            }
+            else if(dvbat != 0)
+            {
+                hdr |= DWP_HDR_BAT;
+            }
+        }
+
+        if(dwp & IMU_DWP_ACC)
+        {
+            int moved = 0;
+
+            for(i = 0; i < 3; i++)
+            {
+                dacc[i] = (int32)acc[i] - dwp_ref_acc[i];
+                accw = MAX(accw, dwp_width(dacc[i]));
+                moved |= (ABS(dacc[i]) > DWP_ACC_DEADBAND);
+            }
+
+            if(moved)
+            {
+                if(accw > DWP_ACC_DELTA_MAX_BITS)
+                {
+                    key = 1;
+                }
+                else
+                {
+                    hdr |= DWP_HDR_ACC;
+                }
+            }
+        }
+    }
+
+    if(key)
+    {
+        hdr = DWP_HDR_KEY;
+        hdr |= (dwp & IMU_DWP_TMP) ? DWP_HDR_TMP : 0;
+        hdr |= (dwp & IMU_DWP_BAT) ? DWP_HDR_BAT : 0;
+        hdr |= (dwp & IMU_DWP_ACC) ? DWP_HDR_ACC : 0;
+    }
+
+    if(hdr == 0)
+    {
+        return 0;   // nothing changed, the blink goes out without a payload
+    }
+
+    buf[0] = hdr;
+    w.buf = &buf[1];
+    w.bit = 0;
+
+    if(hdr & DWP_HDR_TMP)
+    {
+        dwp_put(&w, (key) ? (temp) : ((uint32)dtemp), (key) ? (8) : (DWP_SAR_DELTA_BITS));
+        dwp_ref_temp = temp;
+    }
+
+    if(hdr & DWP_HDR_BAT)
+    {
+        dwp_put(&w, (key) ? (vbat) : ((uint32)dvbat), (key) ? (8) : (DWP_SAR_DELTA_BITS));
+        dwp_ref_vbat = vbat;
+    }
+
+    if(hdr & DWP_HDR_ACC)
+    {
+        if(key)
+        {
+            for(i = 0; i < 3; i++)
+            {
+                dwp_put(&w, (uint32)acc[i], 12);
+            }
+        }
+        else
+        {
+            dwp_put(&w, (uint32)(accw - 1), 4);
+            for(i = 0; i < 3; i++)
+            {
+                dwp_put(&w, (uint32)dacc[i], accw);
+            }
+        }
+        memcpy(dwp_ref_acc, acc, sizeof(dwp_ref_acc));
+    }
+
+    dwp_ref_fields = dwp;
+    dwp_ref_valid = 1;
+
+    return 1 + ((w.bit + 7) >> 3);
+}
@@ -17,12 +17,25 @@
 #include "config.h"
 #include "default_config.h"
 #include "tvc.h"
+#include "prof.h"
+#include "cmd_bin.h"
+#include "budget.h"
+#include "radio_stats.h"
+#include "xtal_cal.h"
 
 /** Enable LED support*/
 /**   1 : Tx phase last 80ms*/
 /**   0 : Tx phase last 25ms - Best power profile and current consumption*/
 #define ENABLE_LED    1
 
+/** Keep the blink frame resident in the DW1000 TX buffer and patch only the
+ *  sequence number on every blink */
+#define RESIDENT_TX_FRAME    1
+/** The TX buffer is not part of the AON configuration which is restored on
+ *  wake up (DWT_CONFIG), so by default the frame is uploaded again after the
+ *  DW1000 was in DEEPSLEEP. Set to 1 only on parts verified to keep it. */
+#define TX_BUFFER_KEPT_IN_SLEEP  0
+
 #ifndef SWAP
 #define SWAP(a,b) {a^=b;b^=a;a^=b;}
 #endif /* SWAP */
@@ -39,23 +52,165 @@
  * Experimental values in ms of time to restart blink
  **/
 /* Observed that timer interrupt is not serviced for the default value of
-LOWPOWER_RESTART_TIME. So LOWPOWER_RESTART_TIME is configured as 9 */
+LOWPOWER_RESTART_TIME. So LOWPOWER_RESTART_TIME is configured as 9
+The DW1000 wake up (DW1000_WAKEUP_TIME_MS) is now started from the sleep timer
+and the SPI is restored on first use, so the restart should need less. It stays
+at 15 until the PROF_WAKEUP and PROF_AWAKE figures of the PROF command
+(PROF_ENABLE=1) have been taken on a board, the crystal start-up of the DW1000
+must still fit in it */
 #define LOWPOWER_RESTART_TIME           15//9
 #define NOSLEEP_RESTART_TIME            12//1
 #define NUM_INST                        1
 
-#define DWT_SIG_RX_TIMEOUT              4
+/* Time in ms to wait for the TX frame sent interrupt before the tag goes to
+ * sleep anyway (the blink itself is on air for less than 200us) */
+#define TX_CONF_TIMEOUT_MS              5
+
+/* every DWP_KEY_PERIOD-th blink carries absolute telemetry values, so a
+ * receiver which missed a delta record can synchronise again */
+#define DWP_KEY_PERIOD                  16
+
+/*******************************************************************************
+ * DW1000 timed blinks (param_block_t.delayedTxEn)
+ *
+ * The next blink is scheduled on the DW1000 system clock relative to the
+ * previous one (dwt_setdelayedtrxtime + DWT_START_TX_DELAYED), so the blink
+ * spacing does not depend on the MCU wake up jitter. The system clock does not
+ * run in DEEPSLEEP, so in this mode the DW1000 stays in IDLE between blinks
+ * which costs several mA compared to the default mode.
+ **/
+/* DW1000 system time high 32 bits runs at 499.2MHz * 128 / 256 */
+#define DW_HI32_TICKS_PER_MS            (249600UL)
+/* the system time wraps after ~17.2s, longer intervals are sent immediately */
+#define DW_HI32_MAX_DELAY_MS            (17000)
+/* extra time the MCU wakes up before a timed blink to prepare it */
+#define DELAYED_TX_GUARD_MS             5
+
+/*******************************************************************************
+ * TDMA slotted blinks (param_block_t.slot)
+ *
+ * Every superframe the tag blinks once, at slot_idx * slot_width_us from the
+ * superframe start. The schedule is kept on the DW1000 clock, the same way as
+ * the timed blinks above (so the DW1000 stays in IDLE), the blink interval and
+ * the randomness are not used. The superframe epoch is taken from the first
+ * blink and is kept across missed slots: a late wake up skips the slot instead
+ * of transmitting into the slot of another tag. The superframe is limited to
+ * MAX_SUPERFRAME_MS so the next slot is always less than half of the DW1000
+ * clock wrap ahead.
+ *
+ * The TX start of a timed or slotted blink is set by the DW1000 delayed TX
+ * (8 ns resolution), the MCU only has to issue dwt_starttx() before it, so
+ * neither the firmware path nor decamutexon() moves it. The wake up lead
+ * (LOWPOWER_RESTART_TIME + DELAYED_TX_GUARD_MS) is a deadline for the MCU,
+ * not a guard time between slots. The DW1000 SYNC input (one-shot TX
+ * synchronisation) is not routed to the nRF52 on the DWM1001C, and an edge
+ * from an RTC compare would be quantised to the 30.5 us RTC tick anyway.
+ **/
+
+/*******************************************************************************
+ * Micro-burst of blinks (param_block_t.burst)
+ *
+ * burst.count blinks are sent per wake up, each with its own sequence number,
+ * the next one gap_us after the previous one with a delayed TX from the TX
+ * time of the previous one. The wake up, the device id check and the
+ * temperature and voltage compensation are done once per burst, and the
+ * downlink window only follows the last blink. The schedule of the next wake
+ * up is counted from the first blink of the burst. In the slotted mode the
+ * burst is cut to the blinks which start inside the slot. A lost TX
+ * confirmation ends the burst.
+ **/
+
+/*******************************************************************************
+ * Downlink listen window (param_block_t.downlink)
+ *
+ * After every period-th blink the DW1000 turns the receiver on at the end of
+ * the transmission (DWT_RESPONSE_EXPECTED) for window_us, so an anchor which
+ * received the blink can answer with a configuration frame
+ * (iso_IEEE_EUI64_dl_msg in pckt_ieee.h, applied by command_bin_downlink()).
+ * The DW1000 frame wait timeout ends the window even in the middle of a frame
+ * and SNIFF mode duty cycles the receiver while it waits for a preamble, so
+ * the RX cost is bounded by window_us / (period * blink interval). The
+ * receiver on time is counted in dlStats (DLSTAT command).
+ **/
+/* us to RX frame wait timeout units of 512/499.2 us */
+#define DL_US_TO_RXTO(us)               (((uint32)(us) * 39) / 40)
+/* time the instance timer gives the DW1000 to end the window */
+#define DL_WINDOW_GUARD_MS              2
+
+/*******************************************************************************
+ * DW1000 wake up interrupt
+ *
+ * The SLP2INIT and CPLOCK events are unmasked before DEEPSLEEP, SYS_MASK is
+ * restored from the AON on wake up (DWT_CONFIG), so the IRQ line rises once
+ * the XTAL has started. The MCU sleeps until then (port_wakeup_dw1000_at())
+ * and the device id is not read again, the events are masked and cleared in
+ * TA_SLEEP_DONE before the IRQ line goes back to dwt_isr().
+ **/
+#define INST_WAKE_INTERRUPTS            (SYS_MASK_MSLP2INIT | SYS_MASK_MCPLOCK)
+#define INST_WAKE_STATUS                (SYS_STATUS_SLP2INIT | SYS_STATUS_CPLOCK)
 
 
 /* DW1000 device variables */
 static dwt_txconfig_t tx_cfg;
 static ref_values_t ref = {0,0,0,0};
+static uint8 wakeIrqArmed = 0;
+
+/*******************************************************************************
+ * Link presets (DEFAULT_PRESETS)
+ *
+ * instance_config() records the register writes of every preset into a
+ * register image (dwt_regimagebegin()), the PRESET command then writes the
+ * image back in one run per register block, without dwt_configure() and its
+ * table lookups. The images are built at start up rather than stored in
+ * flash: they depend on the channel, the PRF and the TX power of the
+ * configuration, and recording them takes no SPI traffic.
+ **/
+static const tpreset_t presets[PRESET_NUM] = DEFAULT_PRESETS;
+static dwt_regimage_t presetImage[PRESET_NUM];
+
+/*******************************************************************************
+ * Delta reconfiguration
+ *
+ * The settings written by instance_config() are kept in instApplied. Before
+ * the first blink of a wake up the configuration (changed by a command or a
+ * downlink frame, saved or not) is compared with them and only the register
+ * groups which changed are written, without the soft reset and the
+ * dwt_initialise() of instance_init():
+ *  - INST_RECFG_PHY    channel, PRF, preamble length, PAC, data rate, SFD and
+ *                      PHR mode: dwt_configure() and the TX RF settings, and
+ *                      the OTP TX reference of a new channel
+ *  - INST_RECFG_CODE   preamble codes only: CHAN_CTRL and the LDE replica
+ *                      coefficient
+ *  - INST_RECFG_TXPWR  smart TX power: SYS_CFG and the TX power
+ *  - INST_RECFG_BLINK  blink intervals: the current interval follows
+ *  - INST_RECFG_XTAL   XTAL trim, see xtal_cal.c
+ * The preset images are recorded again after a change of the radio groups.
+ * The other settings (timed and slotted blinks, bursts, downlink window,
+ * telemetry) are read at every blink already.
+ **/
+#define INST_RECFG_PHY                  0x01
+#define INST_RECFG_CODE                 0x02
+#define INST_RECFG_TXPWR                0x04
+#define INST_RECFG_BLINK                0x08
+#define INST_RECFG_XTAL                 0x10
+
+typedef struct {
+    dwt_config_t    dwt_config;
+    uint16_t        smartPowerEn;
+    tblink_t        blink;
+}inst_applied_t;
+
+static inst_applied_t instApplied;
+
+static int instance_reconfig(param_block_t * pbss);
 
 enum inst_states
 {
    TA_INIT,
    TA_SLEEP_DONE,
-   TA_TXBLINK_WAIT_SEND
+   TA_TXBLINK_WAIT_SEND,
+   TA_TX_WAIT_CONF,
+   TA_RX_WAIT_DATA
 };
 
 typedef struct {
@@ -152,6 +307,8 @@ const uint16 rfDelays[2] = {
 
 instance_data_t instance_data[NUM_INST] ;
 
+static instance_dlstats_t dlStats;
+
 // -----------------------------------------------------------------------------
 // Functions
 // -----------------------------------------------------------------------------
@@ -184,6 +341,235 @@ void instancesettagaddress(instance_data_t *inst)
     }
 }
 
+/*
+ * @fn   instance_downlink_due
+ * @brief  returns non-zero if the receiver is to be turned on after the
+ *         blink being prepared
+ * */
+static int instance_downlink_due(instance_data_t *inst, param_block_t *pbss)
+{
+    /* the calibration measures the clock of the anchors after every blink */
+    if(xtal_cal_active() && (pbss->downlink.window_us != 0))
+    {
+        inst->dlCount = 0;
+        return 1;
+    }
+
+    if((pbss->downlink.period == 0) || (pbss->downlink.window_us == 0))
+    {
+        inst->dlCount = 0;
+        return 0;
+    }
+
+    /* listen less often when the blink budget is stretched */
+    if(++inst->dlCount < budget_dl_period(pbss->downlink.period))
+    {
+        return 0;
+    }
+
+    inst->dlCount = 0;
+    return 1;
+}
+
+/*
+ * @fn   instance_downlink_arm
+ * @brief  configure the receiver which follows the blink, the settings are
+ *         written for every window as they are not all kept through sleep
+ * */
+static void instance_downlink_arm(param_block_t *pbss)
+{
+    dwt_setsniffmode((pbss->downlink.sniff_on != 0), pbss->downlink.sniff_on,
+                     pbss->downlink.sniff_off);
+    dwt_setrxaftertxdelay(0);
+    dwt_setrxtimeout((uint16)DL_US_TO_RXTO(pbss->downlink.window_us));
+}
+
+/*
+ * @fn   instance_downlink_rx
+ * @brief  apply the configuration frame received in the window, frames for
+ *         other tags are ignored
+ * */
+static void instance_downlink_rx(instance_data_t *inst)
+{
+    const iso_IEEE_EUI64_dl_msg *dl = (const iso_IEEE_EUI64_dl_msg *)inst->dlFrame;
+    uint16 len = inst->dlFrameLength;
+    int bcast = 1;
+    int i;
+
+    if((len < DL_HDR_LEN + CMD_BIN_HDR_LEN + CMD_BIN_CRC_LEN + FRAME_CRC) ||
+       (dl->frameCtrl[0] != FCS_DL_DATA_0) || (dl->frameCtrl[1] != FCS_DL_DATA_1))
+    {
+        return;
+    }
+
+    for(i = 0; i < EUI64_ADDR_SIZE; i++)
+    {
+        bcast &= (dl->dstAddr[i] == DL_BROADCAST_BYTE);
+    }
+
+    if(!bcast && (memcmp(dl->dstAddr, inst->msg.tagID, EUI64_ADDR_SIZE) != 0))
+    {
+        return;
+    }
+
+    dlStats.frames++;
+
+    if(command_bin_downlink(dl->payload, len - DL_HDR_LEN - FRAME_CRC) == CMD_BIN_OK)
+    {
+        dlStats.applied++;
+    }
+}
+
+/*
+ * @fn   instance_downlink_end
+ * @brief  close the listen window and account its receiver on time
+ * */
+static void instance_downlink_end(instance_data_t *inst, param_block_t *pbss)
+{
+    uint32 elapsed_us;
+
+    /* normally the receiver is off already (frame or timeout) */
+    dwt_forcetrxoff();
+
+    elapsed_us = (uint32)(((uint64)(dwt_readsystimestamphi32() - inst->dlTxHi32) * 1000)
+                          / DW_HI32_TICKS_PER_MS);
+
+    dlStats.windows++;
+    dlStats.rx_us += MIN(elapsed_us, pbss->downlink.window_us);
+
+    inst->dlListen = 0;
+}
+
+/*
+ * @fn   instance_wake_irq_clear
+ * @brief  the DW1000 is awake: mask and clear its wake up events and give
+ *         the IRQ line back to dwt_isr()
+ * */
+static void instance_wake_irq_clear(void)
+{
+    if(!wakeIrqArmed)
+    {
+        return;
+    }
+
+    dwt_setinterrupt(INST_WAKE_INTERRUPTS, 0);
+    dwt_write32bitreg(SYS_STATUS_ID, INST_WAKE_STATUS);
+    port_wakeup_dw1000_irq_clear();
+    wakeIrqArmed = 0;
+}
+
+/*
+ * @fn   instance_timer_start
+ * @brief  start the instance timer, in ms of the RTC time base. SysTick
+ *         stops while the MCU waits in __WFE(), the LP_TIMER_APP deadline
+ *         wakes it up for the timeout
+ * */
+static void instance_timer_start(instance_data_t *inst, uint32 delay_ms)
+{
+    inst->timeout = portGetLPTickCount() + delay_ms;
+    inst->timeron = 1;
+    port_lp_timer_start(LP_TIMER_APP, delay_ms, NULL);
+}
+
+/*
+ * @fn   instance_timer_stop
+ * @brief  stop the instance timer and its wake up deadline
+ * */
+static void instance_timer_stop(instance_data_t *inst)
+{
+    inst->timeron = 0;
+    port_lp_timer_stop(LP_TIMER_APP);
+}
+
+/*
+ * @fn   instance_burst_len
+ * @brief  blinks of the burst starting now, see the micro-burst above
+ * */
+static uint8 instance_burst_len(param_block_t *pbss)
+{
+    uint32 len = (pbss->burst.count == 0) ? (1) : (pbss->burst.count);
+
+    if(instance_slotted(pbss) && (len > 1))
+    {
+        len = MIN(len, (uint32)(pbss->slot.slot_width_us - 1) / pbss->burst.gap_us + 1);
+    }
+
+    return (uint8)len;
+}
+
+/*
+ * @fn   instance_burst_next
+ * @brief  schedule the next blink of the burst, returns 0 if the burst is over
+ * */
+static int instance_burst_next(instance_data_t *inst, param_block_t *pbss)
+{
+    if(inst->burstIdx == 0)
+    {
+        inst->burstStartHi32 = inst->txTimeHi32;
+    }
+
+    if(inst->txTimeValid && (inst->burstIdx + 1 < inst->burstLen))
+    {
+        inst->burstIdx++;
+        inst->nextTxTimeHi32 = inst->txTimeHi32 \
+                + (uint32)(((uint64)pbss->burst.gap_us * DW_HI32_TICKS_PER_MS) / 1000);
+        inst->txDelayedPending = 1;
+        return 1;
+    }
+
+    /* the next wake up is scheduled from the start of the burst */
+    if(inst->txTimeValid)
+    {
+        inst->txTimeHi32 = inst->burstStartHi32;
+    }
+    inst->burstIdx = 0;
+
+    return 0;
+}
+
+/*
+ * @fn   instance_blink_end
+ * @brief  the blink (and its listen window) is over: the DW1000 goes to sleep
+ *         unless its system clock is needed for the next blink
+ * */
+static void instance_blink_end(instance_data_t *inst, param_block_t *pbss)
+{
+    if(instance_burst_next(inst, pbss))
+    {
+        /* next blink of the burst, the DW1000 stays awake */
+        while(instance_getevent(inst) != 0);
+
+        inst->done = 0;
+        inst->testAppState = TA_TXBLINK_WAIT_SEND;
+        return;
+    }
+
+    /* the event counters do not run in sleep, and stay below 12 bits */
+    radio_stats_snapshot();
+
+    if((pbss->delayedTxEn == 0) && !instance_slotted(pbss))
+    {
+        inst->txTimeValid = 0;
+#if TX_BUFFER_KEPT_IN_SLEEP == 0
+        inst->txFrameResident = 0;
+#endif
+        /* a CPLOCK left from the last wake up would raise the IRQ at once */
+        dwt_write32bitreg(SYS_STATUS_ID, INST_WAKE_STATUS);
+        dwt_setinterrupt(INST_WAKE_INTERRUPTS, 1);
+        port_wakeup_dw1000_irq_arm();
+        wakeIrqArmed = 1;
+
+        dwt_entersleep();
+    }
+    /* else the DW1000 stays in IDLE so its system clock keeps running */
+
+    /* anything still queued belongs to this blink */
+    while(instance_getevent(inst) != 0);
+
+    inst->done = 2; //don't sleep here but kick off the TagTimeoutTimer
+    inst->testAppState = TA_SLEEP_DONE;
+}
+
 /*
  * @fn  testapprun
  * @param *inst
@@ -218,9 +604,13 @@ int testapprun(instance_data_t *inst, int message)
                 break;
             }
 
-            // when there is no ext. power, system waking up in lowpower.c
-            if (DWT_DEVICE_ID == instancereaddeviceid() )
+            // the wake up interrupt tells the DW1000 is ready, otherwise
+            // (the sleep was cut short) its device id is read
+            if (port_wakeup_dw1000_irq_seen() || (DWT_DEVICE_ID == instancereaddeviceid()))
             {
+                instance_wake_irq_clear();
+                radio_stats_start();
+                PROF_STOP(PROF_WAKEUP);
                 inst->done = 0;
                 inst->testAppState = TA_TXBLINK_WAIT_SEND;
 
@@ -230,6 +620,10 @@ int testapprun(instance_data_t *inst, int message)
             /* if DW1000 did not waked up while MCU started up from lowpower,
              * then we need to perform the "slow wake up" */
             port_wakeup_dw1000();
+            instance_wake_irq_clear();
+            radio_stats_start();
+            inst->txFrameResident = 0;
+            PROF_STOP(PROF_WAKEUP);
             inst->done = 0;
             inst->testAppState = TA_TXBLINK_WAIT_SEND;
 
@@ -239,31 +633,225 @@ int testapprun(instance_data_t *inst, int message)
         case TA_TXBLINK_WAIT_SEND :
         {      
             int length;
+            int payload;
+            uint8 dwh;
+            int txResp = 0;
+            uint32 txWait;
+            int burstFirst = (inst->burstIdx == 0);
+
+            if(burstFirst)
+            {
+                inst->burstLen = instance_burst_len(pbss);
+
+                if(inst->presetPending)
+                {
+                    dwt_regimageapply(&presetImage[inst->presetPending - 1]);
+                    inst->presetPending = 0;
+                    tvc_invalidate();
+                    inst->txFrameResident = 0; // TX_FCTRL was written
+
+                    // the preset settings are applied, not a delta
+                    instApplied.dwt_config.dataRate = pbss->dwt_config.dataRate;
+                    instApplied.dwt_config.txPreambLength = pbss->dwt_config.txPreambLength;
+                    instApplied.dwt_config.rxPAC = pbss->dwt_config.rxPAC;
+                    instApplied.dwt_config.nsSFD = pbss->dwt_config.nsSFD;
+                    instApplied.dwt_config.sfdTO = pbss->dwt_config.sfdTO;
+                }
+
+                /* settings changed over the UART or the downlink */
+                (void)instance_reconfig(pbss);
+
+                PROF_START(PROF_TVC);
 
-            /* Do temperature and voltage compensation and get the values of tx_cfg */
-            tvc_comp(&tx_cfg, ref, pbss->dwt_config.chan);
-            
-            /* Configure tx power with new values for temperature and voltage compensation */
-            dwt_configuretxrf(&tx_cfg);
+                /* Do temperature and voltage compensation and get the values of tx_cfg */
+                if(tvc_comp(&tx_cfg, ref, pbss->dwt_config.chan))
+                {
+                    /* Configure tx power with new values for temperature and voltage compensation,
+                     * unchanged settings are kept by the DW1000 through sleep (DWT_CONFIG) */
+                    dwt_configuretxrf(&tx_cfg);
+                }
+
+                PROF_STOP(PROF_TVC);
+            }
+            PROF_START(PROF_FRAME);
 
             //blink frames with IEEE EUI-64 tag with variable dwp/dwh set
             inst->msg.frameCtrl = FCS_EUI_64 ;
             inst->msg.seqNum = inst->frame_sn++;
 
-            length = (FRAME_CRTL_AND_ADDRESS + FRAME_CRC);
+            //telemetry fields which changed since the previous blink
+            dwh = ((inst->msg.seqNum % DWP_KEY_PERIOD) == 0) ? (IMU_DWH_KEY) : (0);
+            if(pbss->delayedTxEn || instance_slotted(pbss))
+            {
+                dwh |= IMU_DWH_NOSLEEP;
+            }
+            budget_blink(pbss, burstFirst && !(dwh & IMU_DWH_NOSLEEP));
+            payload = dw_ieee_payload(dwh, budget_dwp(pbss->dwp), inst->msg.payload);
+
+            length = (FRAME_CRTL_AND_ADDRESS + payload + FRAME_CRC);
+
+#if RESIDENT_TX_FRAME == 1
+            if(inst->txFrameResident && (inst->txFrameLength == length))
+            {
+                // frame control and tag ID are already in the TX buffer,
+                // write the sequence number only (offset 1, +2 for the CRC)
+                dwt_writetxdata(sizeof(inst->msg.seqNum) + FRAME_CRC, &inst->msg.seqNum, 1);
+
+                if(payload)
+                {
+                    dwt_writetxdata(payload + FRAME_CRC, inst->msg.payload, FRAME_CRTL_AND_ADDRESS);
+                }
+            }
+            else
+#endif
+            {
+                // write the frame data
+                dwt_writetxdata(length, (uint8 *)  (&inst->msg), 0) ;
+                dwt_writetxfctrl(length, 0, 0);
+
+                inst->txFrameLength = length;
+                inst->txFrameResident = 1;
+            }
+
+            PROF_STOP(PROF_FRAME);
+            PROF_START(PROF_TX);
+
+            /* the receiver follows this blink, see the downlink window above */
+            inst->dlListen = (inst->burstIdx + 1 >= inst->burstLen) && \
+                             instance_downlink_due(inst, pbss);
+            if(inst->dlListen)
+            {
+                instance_downlink_arm(pbss);
+                txResp = DWT_RESPONSE_EXPECTED;
+            }
 
-            // write the frame data
-            dwt_writetxdata(length, (uint8 *)  (&inst->msg), 0) ;
-            dwt_writetxfctrl(length, 0, 0);
+            txWait = TX_CONF_TIMEOUT_MS;
 
-            dwt_starttx(DWT_START_TX_IMMEDIATE); //always using immediate TX
+            if(inst->txDelayedPending)
+            {
+                inst->txDelayedPending = 0;
 
-            inst->done = 2; //don't sleep here but kick off the TagTimeoutTimer
-            inst->testAppState = TA_SLEEP_DONE;
+                dwt_setdelayedtrxtime(inst->nextTxTimeHi32);
+
+                if(dwt_starttx(DWT_START_TX_DELAYED | txResp) == DWT_SUCCESS)
+                {
+                    inst->txTimeHi32 = inst->nextTxTimeHi32;
+                    txWait += (inst->nextTxTimeHi32 - dwt_readsystimestamphi32()) \
+                              / DW_HI32_TICKS_PER_MS;
+                }
+                else if(instance_slotted(pbss))
+                {
+                    /* too late for our slot, wait for the next superframe */
+                    inst->dlListen = 0;
+                    if(inst->burstIdx != 0)
+                    {
+                        inst->txTimeHi32 = inst->burstStartHi32;
+                        inst->burstIdx = 0;
+                    }
+                    inst->done = 2;
+                    inst->testAppState = TA_SLEEP_DONE;
+                    break;
+                }
+                else
+                {
+                    /* woke up too late for the scheduled time, re-synchronise
+                     * on an immediate blink */
+                    inst->txTimeValid = 0;
+                    dwt_starttx(DWT_START_TX_IMMEDIATE | txResp);
+                }
+            }
+            else
+            {
+                inst->txTimeValid = 0;
+                dwt_starttx(DWT_START_TX_IMMEDIATE | txResp);
+            }
+
+            /* wait (in WFE) for the frame sent event from dwt_isr, the
+             * instance timer covers a lost interrupt */
+            instance_timer_start(inst, txWait);
+            radio_stats_count(RADIO_STATS_APP_TX);
+
+            inst->done = 1;
+            inst->testAppState = TA_TX_WAIT_CONF;
 
             break; //TA_TXBLINK_WAIT_SEND
         }
 
+        case TA_TX_WAIT_CONF :
+        {
+            if((message != DWT_SIG_TX_DONE) && (message != DWT_SIG_RX_TIMEOUT))
+            {
+                inst->done = 1; //keep waiting
+                break;
+            }
+
+            instance_timer_stop(inst);
+
+            PROF_STOP(PROF_TX);
+            PROF_START(PROF_SLEEP_ENTRY);
+
+            if(message == DWT_SIG_RX_TIMEOUT)
+            {
+                /* TX confirmation got lost, make sure the transceiver is idle */
+                radio_stats_count(RADIO_STATS_APP_TXLOST);
+                dwt_forcetrxoff();
+                inst->txTimeValid = 0;
+                inst->txFrameResident = 0;
+                inst->dlListen = 0;
+            }
+            else if(!inst->txTimeValid)
+            {
+                /* immediate blink: its TX time is the base for the next one */
+                inst->txTimeHi32 = dwt_readtxtimestamphi32();
+                inst->txTimeValid = 1;
+            }
+
+            if(inst->dlListen)
+            {
+                /* the DW1000 has turned the receiver on, the frame wait
+                 * timeout ends the window, the instance timer a lost event */
+                inst->dlTxHi32 = dwt_readtxtimestamphi32();
+                instance_timer_start(inst, pbss->downlink.window_us / 1000 \
+                                           + DL_WINDOW_GUARD_MS);
+
+                inst->done = 1;
+                inst->testAppState = TA_RX_WAIT_DATA;
+                break;
+            }
+
+            instance_blink_end(inst, pbss);
+
+            break; //TA_TX_WAIT_CONF
+        }
+
+        case TA_RX_WAIT_DATA :
+        {
+            if((message != DWT_SIG_RX_OKAY) && (message != DWT_SIG_RX_TIMEOUT) &&
+               (message != DWT_SIG_RX_ERROR))
+            {
+                inst->done = 1; //keep waiting
+                break;
+            }
+
+            instance_timer_stop(inst);
+
+            if(message == DWT_SIG_RX_OKAY)
+            {
+                radio_stats_count(RADIO_STATS_APP_RX);
+                xtal_cal_rx(pbss);
+                instance_downlink_rx(inst);
+            }
+            else if(message == DWT_SIG_RX_ERROR)
+            {
+                radio_stats_count(RADIO_STATS_APP_RXERR);
+            }
+
+            instance_downlink_end(inst, pbss);
+            instance_blink_end(inst, pbss);
+
+            break; //TA_RX_WAIT_DATA
+        }
+
         default:
             break;
     } // end switch on testAppState
@@ -279,8 +867,12 @@ int testapprun(instance_data_t *inst, int message)
 
 /* @fn  function to initialise instance structures
  * @brief  Returns 0 on success and -1 on error
+ *         cache   : OTP values cached by instance_otp_cache(), used instead
+ *                   of the OTP reads, NULL for a full init
+ *         running : the DW1000 kept running through an MCU reset, it is not
+ *                   reset (with the cache only)
  * */
-int instance_init(int sleep_enable)
+int instance_init(int sleep_enable, const totp_cache_t *cache, int running)
 {
     int instance = 0 ;
     int result ;
@@ -289,10 +881,37 @@ int instance_init(int sleep_enable)
 
     instance_data[instance].testAppState = TA_INIT ;
 
-    // Reset the IC (might be needed if not getting here from POWER ON)
-    dwt_softreset();
+    if ((cache != NULL) && running)
+    {
+        /* only the driver data is initialised, no reset and no OTP reads */
+        result = dwt_initialise( DWT_DW_WAKE_UP | DWT_DW_WUP_NO_UCODE ) ;
+
+        dwt_setotpvalues(&cache->dw);
+        ref = cache->ref;
+        tvc_set_ref_vbat(cache->ref_vbat);
+
+        // the MCU may have been reset in the middle of a transmission
+        dwt_forcetrxoff();
+    }
+    else if (cache != NULL)
+    {
+        /* the DW1000 was reset with the MCU (brown-out): full init of the
+         * chip, the LDO tune and XTAL trim only read from OTP */
+        dwt_softreset();
+
+        result = dwt_initialise( DWT_LOADNONE ) ;
 
-    result = dwt_initialise( DWT_LOADNONE | DWT_READ_OTP_TMP | DWT_READ_OTP_BAT | DWT_READ_OTP_LID | DWT_READ_OTP_PID) ;
+        dwt_setotpvalues(&cache->dw);
+        ref = cache->ref;
+        tvc_set_ref_vbat(cache->ref_vbat);
+    }
+    else
+    {
+        // Reset the IC (might be needed if not getting here from POWER ON)
+        dwt_softreset();
+
+        result = dwt_initialise( DWT_LOADNONE | DWT_READ_OTP_TMP | DWT_READ_OTP_BAT | DWT_READ_OTP_LID | DWT_READ_OTP_PID) ;
+    }
 
     if (sleep_enable) {
         //configure the on wake parameters (upload the IC config settings)
@@ -314,7 +933,11 @@ int instance_init(int sleep_enable)
       tvc_otp_read_txcfgref(&ref, pbss->dwt_config.chan);
     }
 
-    dwt_entersleepaftertx(1);
+    xtal_cal_apply(pbss);
+
+    /* the DW1000 is put to sleep from the TX confirmation event, so the
+     * frame sent interrupt can still be serviced */
+    dwt_entersleepaftertx(0);
 
     if (DWT_SUCCESS != result)
     {
@@ -327,15 +950,56 @@ int instance_init(int sleep_enable)
                      instance_rxtimeout,
                      instance_rxerror);
 
+    /* the RX events only occur in the downlink listen window */
+    dwt_setinterrupt(DWT_INT_TFRS | DWT_INT_RFCG | DWT_INT_RFTO | DWT_INT_RPHE |
+                     DWT_INT_RFCE | DWT_INT_RFSL | DWT_INT_SFDT, 1);
+
+    radio_stats_start();
+
     instance_data[instance].frame_sn = 0;
-    instance_data[instance].timeron = 0;
-    instance_data[instance].event[0] = 0;
-    instance_data[instance].event[1] = 0;
-    instance_data[instance].eventCnt = 0;
+    instance_timer_stop(&instance_data[instance]);
+    instance_data[instance].txTimeValid = 0;
+    instance_data[instance].txDelayedPending = 0;
+    instance_data[instance].slotSynced = 0;
+    instance_data[instance].burstIdx = 0;
+    instance_data[instance].txFrameResident = 0;
+    instance_data[instance].eventIdxIn = 0;
+    instance_data[instance].eventIdxOut = 0;
+    instance_data[instance].dlCount = 0;
+    instance_data[instance].dlListen = 0;
+    instance_data[instance].dlFrameLength = 0;
 
     return 0 ;
 }
 
+/**
+ * @fn  instance_otp_cache
+ * @brief  keep the OTP values read by a full instance_init() in the
+ *         configuration for the warm boot, returns 1 if pbss->otp changed
+ *         and has to be saved
+ *
+ * */
+int instance_otp_cache(param_block_t *pbss)
+{
+    totp_cache_t otp;
+
+    memset(&otp, 0, sizeof(otp));
+
+    otp.valid = 1;
+    otp.chan = pbss->dwt_config.chan;
+    otp.ref_vbat = tvc_get_ref_vbat();
+    otp.ref = ref;
+    dwt_getotpvalues(&otp.dw);
+
+    if (memcmp(&otp, &pbss->otp, sizeof(otp)) == 0)
+    {
+        return 0;
+    }
+
+    memcpy(&pbss->otp, &otp, sizeof(otp));
+    return 1;
+}
+
 /**
  * @fn  instancereaddeviceid
  * @brief Return the Device ID register value, enables higher level validation
@@ -353,15 +1017,12 @@ uint32 instancereaddeviceid(void)
  *        and affect underlying device operation
  *
  * */
-void instance_config(param_block_t * pbss)
+static void instance_txrf_config(dwt_config_t *cfg, param_block_t * pbss)
 {
     dwt_txconfig_t  configTx ;
 
-    dwt_configure(&pbss->dwt_config) ;
-
-    configTx.PGdly = txSpectrumConfig[pbss->dwt_config.chan].PG_DELAY ;
-    configTx.power = txSpectrumConfig[pbss->dwt_config.chan].tx_pwr[pbss->dwt_config.prf \
-                     - DWT_PRF_16M];
+    configTx.PGdly = txSpectrumConfig[cfg->chan].PG_DELAY ;
+    configTx.power = txSpectrumConfig[cfg->chan].tx_pwr[cfg->prf - DWT_PRF_16M];
 
     /* smart power is always used*/
     if(pbss->smartPowerEn == 0)
@@ -373,44 +1034,373 @@ void instance_config(param_block_t * pbss)
     }
     dwt_configuretxrf(&configTx);
 }
+
+static void instance_rf_config(dwt_config_t *cfg, param_block_t * pbss)
+{
+    dwt_configure(cfg) ;
+    instance_txrf_config(cfg, pbss);
+}
+
+/*
+ * @fn   instance_preset_capture
+ * @brief  record the register images of the presets on the configuration
+ * */
+static void instance_preset_capture(param_block_t * pbss)
+{
+    dwt_config_t    cfg ;
+    int             i ;
+
+    for(i = 0; i < PRESET_NUM; i++)
+    {
+        cfg = pbss->dwt_config;
+        cfg.dataRate = presets[i].dataRate;
+        cfg.txPreambLength = presets[i].txPreambLength;
+        cfg.rxPAC = presets[i].rxPAC;
+        cfg.nsSFD = presets[i].nsSFD;
+        cfg.sfdTO = presets[i].sfdTO;
+
+        dwt_regimagebegin(&presetImage[i]);
+        instance_rf_config(&cfg, pbss);
+        (void)dwt_regimageend(); // an image which does not fit is left empty
+    }
+    instance_data[0].presetPending = 0;
+}
+
+void instance_config(param_block_t * pbss)
+{
+    /* channel and TX RF settings are queued and written together */
+    dwt_writebatchbegin();
+    instance_rf_config(&pbss->dwt_config, pbss);
+    dwt_writebatchend();
+
+    instance_preset_capture(pbss);
+
+    /* the compensated TX setting has been overwritten */
+    tvc_invalidate();
+
+    /* TX_FCTRL carries the new data rate/preamble, write the frame again */
+    instance_data[0].txFrameResident = 0;
+
+    instApplied.dwt_config = pbss->dwt_config;
+    instApplied.smartPowerEn = pbss->smartPowerEn;
+    instApplied.blink = pbss->blink;
+}
+
+/*
+ * @fn   instance_reconfig_diff
+ * @brief  INST_RECFG_xx groups of the configuration which differ from the
+ *         applied settings
+ * */
+static int instance_reconfig_diff(param_block_t * pbss)
+{
+    const dwt_config_t *a = &instApplied.dwt_config;
+    const dwt_config_t *c = &pbss->dwt_config;
+    int changed = 0;
+
+    if((c->chan != a->chan) || (c->prf != a->prf) ||
+       (c->txPreambLength != a->txPreambLength) || (c->rxPAC != a->rxPAC) ||
+       (c->nsSFD != a->nsSFD) || (c->dataRate != a->dataRate) ||
+       (c->phrMode != a->phrMode) || (c->sfdTO != a->sfdTO))
+    {
+        changed |= INST_RECFG_PHY;
+    }
+    if((c->txCode != a->txCode) || (c->rxCode != a->rxCode))
+    {
+        changed |= INST_RECFG_CODE;
+    }
+    if(pbss->smartPowerEn != instApplied.smartPowerEn)
+    {
+        changed |= INST_RECFG_TXPWR;
+    }
+    if((pbss->blink.interval_in_ms != instApplied.blink.interval_in_ms) ||
+       (pbss->blink.interval_slow_in_ms != instApplied.blink.interval_slow_in_ms))
+    {
+        changed |= INST_RECFG_BLINK;
+    }
+    if(xtal_cal_pending(pbss))
+    {
+        changed |= INST_RECFG_XTAL;
+    }
+
+    return changed;
+}
+
+/*
+ * @fn   instance_reconfig
+ * @brief  write the register groups of the settings changed since the last
+ *         blink, see the delta reconfiguration above. The DW1000 is awake.
+ *         Returns the INST_RECFG_xx groups which were applied
+ * */
+static int instance_reconfig(param_block_t * pbss)
+{
+    int changed = instance_reconfig_diff(pbss);
+
+    if(changed == 0)
+    {
+        return 0;
+    }
+
+    if(changed & INST_RECFG_BLINK)
+    {
+        /* the blink rate control (motion) keeps its fast/slow choice */
+        if(app.current_blink_interval_ms == instApplied.blink.interval_slow_in_ms)
+        {
+            app.current_blink_interval_ms = pbss->blink.interval_slow_in_ms;
+        }
+        else if(app.current_blink_interval_ms == instApplied.blink.interval_in_ms)
+        {
+            app.current_blink_interval_ms = pbss->blink.interval_in_ms;
+        }
+    }
+
+    if(changed & INST_RECFG_XTAL)
+    {
+        xtal_cal_apply(pbss);
+    }
+
+    if(changed & INST_RECFG_TXPWR)
+    {
+        dwt_setsmarttxpower( (pbss->smartPowerEn != 0) );
+    }
+
+    if(changed & INST_RECFG_PHY)
+    {
+        if(pbss->dwt_config.chan != instApplied.dwt_config.chan)
+        {
+            memset(&ref, 0, sizeof(ref));
+            tvc_otp_read_txcfgref(&ref, pbss->dwt_config.chan);
+        }
+
+        instance_config(pbss);
+    }
+    else if(changed & (INST_RECFG_CODE | INST_RECFG_TXPWR))
+    {
+        dwt_writebatchbegin();
+        if(changed & INST_RECFG_CODE)
+        {
+            dwt_configurepreamblecode(&pbss->dwt_config);
+        }
+        if(changed & INST_RECFG_TXPWR)
+        {
+            instance_txrf_config(&pbss->dwt_config, pbss);
+        }
+        dwt_writebatchend();
+
+        instance_preset_capture(pbss);
+        tvc_invalidate();
+    }
+
+    instApplied.dwt_config = pbss->dwt_config;
+    instApplied.smartPowerEn = pbss->smartPowerEn;
+    instApplied.blink = pbss->blink;
+
+    return changed;
+}
+/**
+ * @fn  instance_putevent
+ * @brief  Add an event to the instance event queue. Called from the dwt_isr
+ *         callbacks (IRQ context) and from the instance timer.
+ *         Returns 0 on success and -1 if the queue is full (event dropped)
+ *
+ * */
+int instance_putevent(instance_data_t *inst, uint8 event)
+{
+    uint8 in = inst->eventIdxIn;
+
+    if((uint8)(in - inst->eventIdxOut) >= MAX_EVENT_NUMBER)
+    {
+        radio_stats_count(RADIO_STATS_APP_DROP);
+        return -1;
+    }
+
+    inst->event[in & (MAX_EVENT_NUMBER - 1)] = event;
+    __DMB(); // the event must be stored before it is published
+    inst->eventIdxIn = in + 1;
+
+    __SEV(); // wake up the main loop if it is waiting in WFE
+
+    return 0;
+}
+
+/**
+ * @fn  instance_getevent
+ * @brief  Take the oldest event from the instance event queue.
+ *         Returns 0 if there is no event
+ *
+ * */
+uint8 instance_getevent(instance_data_t *inst)
+{
+    uint8 out = inst->eventIdxOut;
+    uint8 event;
+
+    if(out == inst->eventIdxIn)
+    {
+        return 0;
+    }
+
+    event = inst->event[out & (MAX_EVENT_NUMBER - 1)];
+    inst->eventIdxOut = out + 1;
+
+    return event;
+}
+
+/**
+ * @fn  instance_event_pending
+ * @brief  Return non-zero if the state machine has an event to process,
+ *         or the instance timer has expired
+ *
+ * */
+int instance_event_pending(void)
+{
+    return ((instance_data[0].eventIdxIn != instance_data[0].eventIdxOut) ||
+            (instance_data[0].timeron &&
+             (instance_data[0].timeout <= portGetLPTickCount())));
+}
+
 /**
  * @fn  instance_txcallback
- * @brief  Tx callback (if TX irq present)
+ * @brief  Tx callback, called from dwt_isr on the frame sent interrupt
  *
  * */
 void instance_txcallback(const dwt_cb_data_t *txd)
 {
-    //empty function
+    instance_putevent(&instance_data[0], DWT_SIG_TX_DONE);
 }
 
 /**
  * @fn  instance_rxgood
- * @brief The TDoA Tag does not have any RX functionality
+ * @brief  Rx callback, a frame was received in the downlink listen window.
+ *         It is read here as the receiver buffer is not kept through sleep
  *
  * */
 void instance_rxgood(const dwt_cb_data_t *rxd)
 {
-   //empty function
+    instance_data_t *inst = &instance_data[0];
+    uint16 len = (rxd->datalength <= sizeof(inst->dlFrame)) ? (rxd->datalength) : (0);
+
+    if(len)
+    {
+        dwt_readrxdata(inst->dlFrame, len, 0);
+    }
+    inst->dlFrameLength = len;
+
+    instance_putevent(inst, DWT_SIG_RX_OKAY);
 }
 
 /**
  * @fn  instance_rxtimeout
- * @brief The TDoA Tag does not have any RX functionality
+ * @brief  The downlink listen window has ended without a frame
  *
  * */
 void instance_rxtimeout(const dwt_cb_data_t *rxd)
 {
-    //empty function
+    instance_putevent(&instance_data[0], DWT_SIG_RX_TIMEOUT);
 }
 
 /**
  * @fn  instance_rxerror
- * @brief  The TDoA Tag does not have any RX functionality
+ * @brief  A frame in the downlink listen window was corrupted, the window
+ *         ends as the receiver is off
  *
  * */
 void instance_rxerror(const dwt_cb_data_t *rxd)
 {
-    //empty function
+    instance_putevent(&instance_data[0], DWT_SIG_RX_ERROR);
+}
+
+/**
+ * @fn  instance_slotted
+ * @brief  Return non-zero if a TDMA slot schedule is configured and the slot
+ *         fits in the superframe
+ *
+ * */
+int instance_slotted(param_block_t *pbss)
+{
+    return ((pbss->slot.superframe_ms != 0) &&
+            (pbss->slot.superframe_ms <= MAX_SUPERFRAME_MS) &&
+            (pbss->slot.slot_width_us != 0) &&
+            ((uint32)(pbss->slot.slot_idx + 1) * pbss->slot.slot_width_us
+                    <= (uint32)pbss->slot.superframe_ms * 1000));
+}
+
+/**
+ * @fn  instance_downlink_stats
+ * @brief  Return the downlink listen window statistics
+ *
+ * */
+const instance_dlstats_t *instance_downlink_stats(void)
+{
+    return &dlStats;
+}
+
+/**
+ * @fn  instance_preset
+ * @brief  switch to a link preset, its register image is written before the
+ *         next blink, when the DW1000 is awake. pbss follows the preset so
+ *         SAVE keeps it.
+ * */
+int instance_preset(param_block_t *pbss, int idx)
+{
+    if((idx < 0) || (idx >= PRESET_NUM) || (presetImage[idx].runs == 0))
+    {
+        return -1;
+    }
+
+    pbss->dwt_config.dataRate = presets[idx].dataRate;
+    pbss->dwt_config.txPreambLength = presets[idx].txPreambLength;
+    pbss->dwt_config.rxPAC = presets[idx].rxPAC;
+    pbss->dwt_config.nsSFD = presets[idx].nsSFD;
+    pbss->dwt_config.sfdTO = presets[idx].sfdTO;
+
+    instance_data[0].presetPending = (uint8)(idx + 1);
+
+    return 0;
+}
+
+/**
+ * @fn  instance_slot_schedule
+ * @brief  Schedule the next blink at the start of our slot in the next
+ *         superframe that can still be reached.
+ *         Returns the time in ms from now to the blink, or -1 if there is no
+ *         time base yet (an immediate blink is needed first)
+ *
+ * */
+static int instance_slot_schedule(instance_data_t *inst, param_block_t *pbss)
+{
+    uint32 superframe = (uint32)pbss->slot.superframe_ms * DW_HI32_TICKS_PER_MS;
+    uint32 offset = (uint32)(((uint64)pbss->slot.slot_idx * pbss->slot.slot_width_us
+                              * DW_HI32_TICKS_PER_MS) / 1000);
+    uint32 now, next;
+
+    if(memcmp(&inst->slotCfg, &pbss->slot, sizeof(tslot_t)) != 0)
+    {
+        memcpy(&inst->slotCfg, &pbss->slot, sizeof(tslot_t));
+        inst->slotSynced = 0;
+    }
+
+    if(!inst->slotSynced)
+    {
+        if(!inst->txTimeValid)
+        {
+            return -1;
+        }
+        // the last blink opens the superframe schedule at our slot
+        inst->slotEpochHi32 = inst->txTimeHi32 - offset;
+        inst->slotSynced = 1;
+    }
+
+    now = dwt_readsystimestamphi32();
+
+    do {
+        inst->slotEpochHi32 += superframe;
+        next = inst->slotEpochHi32 + offset;
+    } while((int32)(next - now) <
+            (int32)((LOWPOWER_RESTART_TIME + DELAYED_TX_GUARD_MS) * DW_HI32_TICKS_PER_MS));
+
+    inst->nextTxTimeHi32 = next;
+    inst->txDelayedPending = 1;
+
+    return (int)((next - now) / DW_HI32_TICKS_PER_MS);
 }
 
 /**
@@ -458,33 +1448,43 @@ int instance_run(void)
 {
     int instance = 0 ;
     int done = instance_data[instance].done = 0;
-    int message = instance_data[instance].event[0];
+    int message;
     int delay;
+    int slot_delay;
+    int dwIdle;
+    int dwWake;
+    int dwReady;
 
     param_block_t *pbss = get_pbssConfig();
 
+    if(instance_data[instance].timeron == 1)
+    {
+        if(instance_data[instance].timeout <= portGetLPTickCount())
+        {
+            // the queue producer side is shared with dwt_isr
+            decaIrqStatus_t stat = decamutexon();
+            instance_timer_stop(&instance_data[instance]);
+            instance_putevent(&instance_data[instance], DWT_SIG_RX_TIMEOUT);
+            decamutexoff(stat);
+        }
+    }
+
+    message = instance_getevent(&instance_data[instance]);
+
     while(!done)
     {
         // run the communications application
         done = testapprun(&instance_data[instance], message) ;
 
-        if(message) // there was an event in the buffer
-        {
-            instance_data[instance].event[0] = 0; //clear the buffer
-            instance_data[instance].eventCnt--;
-        }
-
         //we've processed message
         message = 0;
 
-        if(done)//ready for next event
+        if(done == 1)//ready for next event
         {
-            // there was an event in the buffer
-            if(instance_data[instance].event[1])
+            // there was an event in the queue
+            message = instance_getevent(&instance_data[instance]);
+            if(message)
             {
-                message = instance_data[instance].event[1];
-                instance_data[instance].event[1] = 0; //clear the buffer
-                instance_data[instance].eventCnt--;
                 instance_data[instance].done = done = 0; //wait for next done
             }
         }
@@ -495,7 +1495,7 @@ int instance_run(void)
        send another blink after some time) */
     if(done == 2)
     {
-        uint32_t currentInterval = app.current_blink_interval_ms;
+        uint32_t currentInterval = budget_interval(app.current_blink_interval_ms);
         uint32_t currentRand = pbss->blink.randomness;
 
         /* randomness in % of blink pause time */ 
@@ -506,12 +1506,45 @@ int instance_run(void)
         delay = (currentInterval + (currentInterval * currentRand/100)) \
                 - delay - LOWPOWER_RESTART_TIME ;
 
+        if(instance_slotted(pbss) &&
+           ((slot_delay = instance_slot_schedule(&instance_data[instance], pbss)) >= 0))
+        {
+            /* wake up early, the DW1000 holds the blink until our slot */
+            delay = slot_delay - LOWPOWER_RESTART_TIME - DELAYED_TX_GUARD_MS;
+        }
+        else if(pbss->delayedTxEn && instance_data[instance].txTimeValid)
+        {
+            /* blink to blink time, counted on the DW1000 clock */
+            int period = delay + LOWPOWER_RESTART_TIME;
+
+            if((period > 0) && (period < DW_HI32_MAX_DELAY_MS))
+            {
+                instance_data[instance].nextTxTimeHi32 = instance_data[instance].txTimeHi32 \
+                                              + (uint32)period * DW_HI32_TICKS_PER_MS;
+                instance_data[instance].txDelayedPending = 1;
+
+                /* wake up early, the DW1000 holds the blink until its time */
+                delay -= DELAYED_TX_GUARD_MS;
+            }
+        }
+
         if(delay > 0)
         {
+            PROF_STOP(PROF_SLEEP_ENTRY);
+            PROF_STOP(PROF_AWAKE);
+
+            /* in the timed modes the DW1000 stays in IDLE, otherwise it is
+             * woken up from the sleep timer so it is ready when the MCU is */
+            dwIdle = (pbss->delayedTxEn != 0) || instance_slotted(pbss);
+            dwWake = !dwIdle && (delay > DW1000_WAKEUP_TIME_MS);
+
+            if(dwWake)
+            {
+                port_wakeup_dw1000_at(delay - DW1000_WAKEUP_TIME_MS);
+            }
+
             #if ENABLE_LED == 0
                 low_power(delay);
-                if(check_device_id() != 0) // Read device id after Low_Power mode.
-                    return -1;
             #else
                 // if delay is greater then twice a maximum blink time - emit a short blink
                 // if delay is less then that timeperiod - invert the led
@@ -519,40 +1552,38 @@ int instance_run(void)
                 {
                     LEDS_INVERT(BSP_LED_3_MASK);
                     low_power(delay);
-                    if(check_device_id() != 0) // Read device id after Low_Power mode.
-                        return -1;
                 }
                 else 
                 {
-                    // just to be sure that the led is off almost all the time
+                    // just to be sure that the led is off almost all the time,
+                    // the RTC turns it on for the end of the sleep without
+                    // waking the MCU up
                     LEDS_OFF(BSP_LED_3_MASK);
-                    low_power( delay - MAXIMUM_LED_ON_TIME );
-                    if(check_device_id() != 0) // Read device id after Low_Power mode.
-                        return -1;
-                    LEDS_ON(BSP_LED_3_MASK);
-                    low_power( MAXIMUM_LED_ON_TIME );
+                    port_led_pulse_at(BSP_LED_3, delay - MAXIMUM_LED_ON_TIME);
+                    low_power(delay);
+                    port_led_pulse_end(BSP_LED_3);
                     LEDS_OFF(BSP_LED_3_MASK);
-                    if(check_device_id() != 0) // Read device id after Low_Power mode.
-                        return -1;
                 }
-            #endif          
+            #endif
+
+            PROF_START(PROF_AWAKE);
+            PROF_START(PROF_WAKEUP);
+
+            dwReady = (dwWake) ? (port_wakeup_dw1000_done()) : (dwIdle);
+
+            /* the device id is read again in TA_SLEEP_DONE unless the wake
+             * up interrupt came, a full check (with the slow wake up) is only
+             * needed if the early wake up did not complete (e.g. the sleep
+             * was cut short or the interrupt timed out) */
+            if(!dwReady && (check_device_id() != 0)) // Read device id after Low_Power mode.
+                return -1;
         }
 
         /* immediate wakeup after lowpower sleep */ 
-        instance_data[instance].timeout = portGetTickCount();
-        instance_data[instance].timeron = 1;
+        instance_timer_start(&instance_data[instance], 0);
         instance_data[instance].done = 0;
     }
 
-    if(instance_data[instance].timeron == 1)
-    {
-        if(instance_data[instance].timeout <= portGetTickCount()) 
-        {
-            instance_data[instance].timeron = 0;
-            instance_data[instance].event[instance_data[instance].eventCnt++] \
-                 = DWT_SIG_RX_TIMEOUT;
-        }
-    }
     return 0;
 }
 
@@ -44,6 +44,29 @@ extern app_cfg_t app;
 
 #define MAXIMUM_LED_ON_TIME   (50)
 
+/* Events passed from the DW1000 callbacks and the instance timer to the
+ * state machine. 0 is reserved for "no event" */
+#define DWT_SIG_TX_DONE                 1
+#define DWT_SIG_RX_OKAY                 2
+#define DWT_SIG_RX_ERROR                3
+#define DWT_SIG_RX_TIMEOUT              4
+
+/* Size of the instance event queue, must be a power of 2 */
+#define MAX_EVENT_NUMBER      (8)
+
+/* Longest TDMA superframe: the slot schedule compares DW1000 times as signed
+ * 32 bits differences, which is half of the ~17.2s wrap */
+#define MAX_SUPERFRAME_MS     (8000)
+
+/* Downlink listen window statistics, since the start up */
+typedef struct
+{
+    uint32       windows;           // listen windows opened after a blink
+    uint32       rx_us;             // receiver on time, at most windows * window_us
+    uint32       frames;            // configuration frames addressed to the tag
+    uint32       applied;           // frames which were applied (CMD_BIN_OK)
+} instance_dlstats_t;
+
 typedef struct
 {
     int testAppState ;
@@ -54,18 +77,50 @@ typedef struct
     iso_IEEE_EUI64_blink_msg msg ;
     uint16        psduLength ;
     uint8        frame_sn;
-    uint8        event[2];
-    uint8        eventCnt;
+    uint8        txFrameResident;   // blink frame is in the DW1000 TX buffer
+    uint16       txFrameLength;     // length (incl. CRC) written in TX_FCTRL
+    uint8        event[MAX_EVENT_NUMBER]; // ring of events, filled from dwt_isr callbacks
+    volatile uint8 eventIdxIn;          // producers: dwt_isr callbacks, timer (IRQ masked)
+    volatile uint8 eventIdxOut;         // consumer: instance_run only
     uint8        timeron;
     uint32        timeout;
     uint16_t chipSleep; // The DW1000 sleep duration
+
+    // DW1000 timed blinks (param_block_t.delayedTxEn)
+    uint32        txTimeHi32;       // DW1000 time (high 32 bits) of the last blink
+    uint8         txTimeValid;      // txTimeHi32 can be used to schedule the next blink
+    uint8         txDelayedPending; // next blink is due at nextTxTimeHi32
+    uint32        nextTxTimeHi32;
+
+    // TDMA slotted blinks (param_block_t.slot)
+    tslot_t       slotCfg;          // slot configuration the epoch belongs to
+    uint8         slotSynced;       // slotEpochHi32 is valid
+    uint32        slotEpochHi32;    // DW1000 time of the current superframe start
+
+    // micro-burst of blinks per wake up (param_block_t.burst)
+    uint8         burstLen;         // blinks of the current burst
+    uint8         burstIdx;         // blink being sent in the burst, 0: first
+    uint32        burstStartHi32;   // DW1000 time of the first blink of the burst
+
+    // downlink listen window (param_block_t.downlink)
+    uint16        dlCount;          // blinks since the last listen window
+    uint8         dlListen;         // the receiver is turned on after this blink
+    uint32        dlTxHi32;         // DW1000 time of the blink opening the window
+    volatile uint16 dlFrameLength;  // frame in dlFrame, written from dwt_isr
+    uint8         dlFrame[DL_FRAME_MAX];
+
+    // link preset (PRESET command)
+    uint8         presetPending;    // preset index + 1 to apply once the DW1000 is awake, 0: none
 } instance_data_t ;
 
 /* Exported functions prototypes */
 
 /* Set Newchip to 1 to inform instance Tag TDoA that DW1000 has no OTP calibrated
    values */
-int instance_init( int sleep_enable) ;
+int instance_init( int sleep_enable, const totp_cache_t *cache, int running) ;
+
+// Store the OTP values of a cold init into pbss->otp, returns 1 if they changed
+int instance_otp_cache(param_block_t *pbss) ;
 
 // Call init, then call config, then call run. call colose when finished
 void instance_config(param_block_t *config) ;
@@ -73,9 +128,23 @@ void instance_config(param_block_t *config) ;
 // returns indication of status report change
 int instance_run(void) ;
 
+// returns non-zero when an event is queued for the state machine
+int instance_event_pending(void) ;
+
+// returns non-zero when the slotted (TDMA) blink schedule is configured
+int instance_slotted(param_block_t *pbss) ;
+
+// returns the downlink listen window statistics
+const instance_dlstats_t *instance_downlink_stats(void) ;
+
+// switches to a link preset of DEFAULT_PRESETS before the next blink, returns -1 if there is no such preset
+int instance_preset(param_block_t *pbss, int idx) ;
+
 // Return Device ID reg, enables validation of physical device presence
 uint32 instancereaddeviceid(void) ;
 int testapprun(instance_data_t *inst, int message);
+int instance_putevent(instance_data_t *inst, uint8 event);
+uint8 instance_getevent(instance_data_t *inst);
 uint32 ulong2littleEndian(uint32);
 void instancesettagaddress(instance_data_t *inst);
 void instance_txcallback(const dwt_cb_data_t *txd);
@@ -28,15 +28,63 @@
 /* size of IEEE_EUI_64 blink message including FCS with zero payload size */
 #define EUI64_CONTROL_SIZE    (16)
 
+/* Telemetry payload fields (param_block_t.dwp), see dw_ieee_payload() */
+#define IMU_DWP_TMP           (0x01)    // DW1000 temperature (raw SAR)
+#define IMU_DWP_BAT           (0x02)    // DW1000 supply voltage (raw SAR)
+#define IMU_DWP_GPIO          (0x04)    // not supported
+#define IMU_DWP_MAG           (0x08)    // not supported
+#define IMU_DWP_ACC           (0x10)    // LIS2DH12 acceleration X,Y,Z
+#define IMU_DWP_GYR           (0x20)    // not supported
+#define IMU_DWP_APS           (0x40)    // not supported
+#define IMU_DWP_ATMP          (0x80)    // not supported
+#define IMU_DWP_SUPPORTED     (IMU_DWP_TMP | IMU_DWP_BAT | IMU_DWP_ACC)
+
+/* dw_ieee_payload() request flags (dwh) */
+#define IMU_DWH_KEY           (0x01)    // send absolute values (key record)
+#define IMU_DWH_NOSLEEP       (0x02)    // DW1000 did not wake up, its wakeup SAR values are stale
+
+/* Telemetry payload header, the first payload byte */
+#define DWP_HDR_TMP           (0x01)    // 8 bit raw temp (key) or 4 bit signed delta
+#define DWP_HDR_BAT           (0x02)    // 8 bit raw vbat (key) or 4 bit signed delta
+#define DWP_HDR_ACC           (0x04)    // 3 x 12 bit (key) or 4 bit width-1 + 3 x width bit deltas
+#define DWP_HDR_KEY           (0x80)    // values are absolute, else deltas to the previous record
+
+/* maximum payload: header + 8 + 8 + 3*12 bits */
+#define IEEE_PAYLOAD_MAX      (8)
+
 /* 12 octets for Minimum IEEE ID blink */
 typedef struct
 {
     uint8 frameCtrl;                         //  frame control bytes 00
     uint8 seqNum;                            //  sequence_number 01
     uint8 tagID[EUI64_ADDR_SIZE];            //  02-09 64 bit addresses
-    /*  10-11  we allow space for the CRC as it is logically part of the
+    uint8 payload[IEEE_PAYLOAD_MAX];         //  10-   optional telemetry, the CRC follows it
+    /*  we allow space for the CRC as it is logically part of the
         message. However DW1000 TX calculates and adds these bytes */
     uint8 fcs[2] ;
 } iso_IEEE_EUI64_blink_msg ;
 
+/* Downlink (anchor to tag) configuration frame: IEEE 802.15.4 data frame,
+ * PAN ID compressed, 64 bit destination and source addresses. The payload
+ * is a binary configuration frame of cmd_bin.h (SOF LEN TLVs CRC). The tag
+ * listens for it right after the end of a blink, see instance.c */
+#define FCS_DL_DATA_0         0x41      // data frame, PAN ID compression
+#define FCS_DL_DATA_1         0xCC      // 64 bit destination and source
+#define DL_HDR_LEN            (21)      // FC (2) SN (1) PAN (2) DST (8) SRC (8)
+#define DL_FRAME_MAX          (127)     // standard PHR, incl. the CRC
+#define DL_PAYLOAD_MAX        (DL_FRAME_MAX - DL_HDR_LEN - FRAME_CRC)
+
+/* destination address of a frame for all tags */
+#define DL_BROADCAST_BYTE     0xFF
+
+typedef struct
+{
+    uint8 frameCtrl[2];                      //  frame control bytes 00-01
+    uint8 seqNum;                            //  sequence_number 02
+    uint8 panID[2];                          //  PAN ID 03-04
+    uint8 dstAddr[EUI64_ADDR_SIZE];          //  05-12 tag EUI-64 or broadcast
+    uint8 srcAddr[EUI64_ADDR_SIZE];          //  13-20 anchor EUI-64
+    uint8 payload[DL_PAYLOAD_MAX + FRAME_CRC]; // binary configuration frame, CRC
+} iso_IEEE_EUI64_dl_msg ;
+
 #endif //IEEE_EUI_64_TAG
@@ -19,6 +19,11 @@
 #include "instance.h"
 #include "config.h"
 #include "LIS2DH12.h"
+#include "motion_rate.h"
+#include "budget.h"
+#include "prof.h"
+#include "cmd.h"
+#include "mem_arena.h"
 
 /**< Task delay. Delays a LED0 task for 200 ms */
 #define TASK_DELAY      200
@@ -32,13 +37,22 @@ app_cfg_t app;
 /* @Fn  inittestapplication
  * @brief Function for initializing the SPI.
  *
- * @param[in] void
+ * @param[in] reset : reason of the MCU reset. After a warm reset the DW1000
+ *                    is not reset, after a warm reset or a brown-out the
+ *                    cached OTP values are used
  */
-int inittestapplication(void)
+int inittestapplication(port_reset_t reset)
 {
     int32_t result = 0;
     int devID; // Decawave Device ID
     decaIrqStatus_t a;
+    param_block_t *pbss = app.pConfig;
+    int cached;
+    int warm;
+
+    /* the cache is valid for the channel it was taken on */
+    cached = (reset != PORT_RESET_POWER_ON) && pbss->otp.valid && (pbss->otp.chan == pbss->dwt_config.chan);
+    warm = cached && (reset == PORT_RESET_WARM);
 
     /* Disable ScenSor (EXT_IRQ) before starting */
     a = decamutexon();
@@ -54,13 +68,19 @@ int inittestapplication(void)
         port_wakeup_dw1000();
         // SPI not working or Unsupported Device ID
         devID = instancereaddeviceid() ;
+        if ((DWT_DEVICE_ID != devID) && warm){
+            // the DW1000 did not keep running: cold start
+            warm = 0;
+            reset_DW1000();
+            devID = instancereaddeviceid() ;
+        }
         if (DWT_DEVICE_ID != devID){
             return -1 ;
         }
     }
 
     // configure: if DW1000 is calibrated then OTP config is used, enable sleep
-    result = instance_init( 1 );
+    result = instance_init( 1, (cached) ? (&pbss->otp) : (NULL), warm );
 
     if (0 > result) {
         return(-1) ; // Some failure has occurred
@@ -78,6 +98,11 @@ int inittestapplication(void)
 
     instance_config(app.pConfig) ;  // Set operating channel etc
 
+    if (!cached && instance_otp_cache(pbss))
+    {
+        save_bssConfig(pbss);
+    }
+
     decamutexoff(a); //enable ScenSor (EXT_IRQ) before starting
     return result;
 }
@@ -96,6 +121,9 @@ bool wake_up_hook()
     if( deca_uart_rx_data_ready() ) {
         return true;
     }
+    if( motion_rate_pending() ) {
+        return true;
+    }
     return false;
 }
 
@@ -109,13 +137,13 @@ bool wake_up_hook()
 * On detecting motion turn on the blue LED, after a period of
 * inactivity, turn off the LED and wait for another motion event.
 */
+/* Motion Detection Interrupt */
+static char gMotionDetInt = 0;
+
 static void vTestModeMotionDetect(void)
 {
     param_block_t *pbss = get_pbssConfig();
 
-    /* Motion Detection Interrupt */
-    static char gMotionDetInt = 0;
-
     if(gMotionDetInt == 1)
     {
       LEDS_ON(BSP_LED_0_MASK);
@@ -150,8 +178,73 @@ static void vTestModeMotionDetect(void)
     }
 }
 
+/*!
+* @brief Run the motion proportional blink rate (MOTIONRATE 1).
+*
+* The blink interval follows the motion intensity estimated from the
+* accelerometer FIFO, see motion_rate.c. The LED is on while moving.
+*/
+static void vMotionRateMode(void)
+{
+    param_block_t *pbss = get_pbssConfig();
+    uint32_t interval = app.current_blink_interval_ms;
+
+    if (motion_rate_task(pbss, &interval))
+    {
+        LEDS_ON(BSP_LED_0_MASK);
+    }
+    else
+    {
+        LEDS_OFF(BSP_LED_0_MASK);
+    }
+
+    app.current_blink_interval_ms = interval;
+}
+
+/*!
+* @brief Select the blink rate control, switching the accelerometer mode
+* when MOTIONRATE was changed over the UART.
+*/
+static void vMotionTask(void)
+{
+    param_block_t *pbss = get_pbssConfig();
+    static uint8_t u8MotionRate = 0;
+
+    if (u8MotionRate != (pbss->motion.adaptiveEn != 0))
+    {
+        u8MotionRate = (pbss->motion.adaptiveEn != 0);
+
+        if (u8MotionRate)
+        {
+            motion_rate_start(pbss);
+        }
+        else
+        {
+            // same state as after start up
+            motion_rate_stop();
+            app.current_blink_interval_ms = pbss->blink.interval_in_ms;
+            LEDS_OFF(BSP_LED_0_MASK);
+            gMotionDetInt = 0;
+        }
+    }
+
+    if (u8MotionRate)
+    {
+        vMotionRateMode();
+    }
+    else
+    {
+        // test mode is motion dection
+        vTestModeMotionDetect();
+    }
+}
+
 int main(void)
 {
+    port_reset_t reset = port_reset_reason();
+
+    mem_arena_init();
+
     LEDS_CONFIGURE(BSP_LED_0_MASK | BSP_LED_1_MASK | BSP_LED_2_MASK | BSP_LED_3_MASK);
     LEDS_OFF(BSP_LED_0_MASK | BSP_LED_1_MASK | BSP_LED_2_MASK | BSP_LED_3_MASK);
 
@@ -159,14 +252,20 @@ int main(void)
 
     peripherals_init();
 
-    /* reset decawave */
-    reset_DW1000();
+    PROF_INIT();
+
+    /* reset decawave, after a watchdog or soft reset it is still configured */
+    if (reset != PORT_RESET_WARM)
+    {
+        reset_DW1000();
+    }
 
     /* set defualt PRF and bit rate etc.. */
     load_bssConfig();                 /**< load the RAM Configuration parameters from NVM block */
     app.pConfig = get_pbssConfig();
+    command_init();
 
-    if(inittestapplication() < 0)
+    if(inittestapplication(reset) < 0)
     {
         return -1; // Failed to intialze SPI.
     }
@@ -175,6 +274,7 @@ int main(void)
     /* Enable blink */
     app.blinkenable = 1;
     app.current_blink_interval_ms = app.pConfig->blink.interval_in_ms;
+    budget_start();
 
     // Initialise the accelerometer
     // Note: this function blocks for 20ms.
@@ -193,8 +293,8 @@ int main(void)
     // Loop forever responding to ranging requests.
     while(1)
     {
-        // test mode is motion dection
-        vTestModeMotionDetect();
+        // blink rate from the accelerometer
+        vMotionTask();
         // checking UART buffer ready to proceed
         if( deca_uart_rx_data_ready() )
         {
@@ -207,5 +307,12 @@ int main(void)
         {
             instance_run();    //< transmit packet if allowed
         }
+        // nothing to do until the DW1000, UART or accelerometer interrupt
+        // raises an event. SysTick stops in __WFE(), the instance timeouts
+        // run on the RTC, whose LP_TIMER_APP deadline wakes the MCU
+        if( !instance_event_pending() && !deca_uart_rx_data_ready() && !motion_rate_pending() )
+        {
+            __WFE();
+        }
     }
 }
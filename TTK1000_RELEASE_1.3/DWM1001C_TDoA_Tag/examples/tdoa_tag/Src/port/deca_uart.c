@@ -16,17 +16,37 @@
 #include "nrf_uart.h"
 #include "app_uart.h"
 #include "app_fifo.h"
+#include "nrf_drv_uart.h"
 #include "nrf_drv_clock.h"
 #include "twi.h"
+#include "cmd_bin.h"
+#include "mem_arena.h"
 
 /******************************************************************************
  *
  *                              APP global variables
  *
  ******************************************************************************/
-static uint8_t rx_buf[RX_BUF_SIZE];              
 static app_fifo_t m_rx_fifo; 
 static bool uart_rx_data_ready = false;
+static uint16_t uart_rx_cnt = 0;                 // bytes in m_rx_fifo
+static bool uart_rx_bin = false;                 // m_rx_fifo holds a binary frame
+static uint8_t uart_rx_bin_hdr[CMD_BIN_HDR_LEN];
+
+/* UARTE with EasyDMA: one byte RX transfers, TX from a ring buffer sent in
+ * chunks so port_tx_msg() returns as soon as the data is queued */
+#define UART_DMA_MAX_LEN        255     // EasyDMA MAXCNT is 8 bits on nRF52832
+#define UART_TX_RING_MASK       (UART_TX_BUF_SIZE - 1)
+
+static const nrf_drv_uart_t uart = NRF_DRV_UART_INSTANCE(0);
+static uint8_t uart_rx_byte;
+static bool uart_open = false;
+static uint8_t * const tx_ring = MEM_ARENA(MEM_UART_TX);
+static volatile uint16_t tx_head = 0;           // free running write index
+static volatile uint16_t tx_tail = 0;           // free running read index
+static volatile uint16_t tx_dma_len = 0;        // bytes of the running transfer
+
+static void uart_tx_put(uint8_t c);
 
 /******************************************************************************
  *
@@ -48,8 +68,8 @@ void peripherals_init(void)
     SystemCoreClockUpdate ();
     SysTick_Config(SystemCoreClock/1000);
 
-     /* Setup DW1000 IRQ pin */
-    nrf_gpio_cfg_input(DW1000_IRQ, NRF_GPIO_PIN_NOPULL);     //irq
+     /* Setup DW1000 IRQ pin, serviced by dwt_isr() */
+    port_deca_irq_init();
 
     nrf_gpio_cfg_input(RX_PIN_NUMBER, NRF_GPIO_PIN_PULLUP);
 
@@ -58,6 +78,9 @@ void peripherals_init(void)
     // Start LF 32k crystal
     nrf_drv_clock_lfclk_request(NULL);
 
+    // RTC0 time base and wake deadlines of low_power()
+    port_lp_timer_init();
+
      /* Function for initializing the UART module. */
     deca_uart_init();
 
@@ -86,19 +109,47 @@ void deca_uart_event_handle(app_uart_evt_t * p_event)
     {
         APP_ERROR_HANDLER(p_event->data.error_code);
     }
-    if (p_event->evt_type == APP_UART_DATA)
+    if (p_event->evt_type == APP_UART_DATA &&
+        !uart_rx_data_ready &&
+        (uart_rx_bin || (uart_rx_cnt == 0 && p_event->data.value == CMD_BIN_SOF)))
+    {
+        // binary configuration frame: no echo, ready when LEN bytes are in
+        uint16_t frame_len;
+        uint32_t error;
+
+        RestartUART_timer();
+
+        uart_rx_bin = true;
+        if (uart_rx_cnt < CMD_BIN_HDR_LEN) {
+            uart_rx_bin_hdr[uart_rx_cnt] = p_event->data.value;
+        }
+
+        error = app_fifo_put(&m_rx_fifo, p_event->data.value );
+        uart_rx_cnt++;
+
+        frame_len = cmd_bin_frame_len(uart_rx_bin_hdr, uart_rx_cnt);
+        if ( error == NRF_ERROR_NO_MEM ||
+             (frame_len > 0 && (uart_rx_cnt >= frame_len || frame_len > CMD_BIN_FRAME_MAX)) ) {
+            // complete, or too long: the parser answers with an error
+            uart_rx_data_ready = true;
+        }
+    }
+    else if (p_event->evt_type == APP_UART_DATA)
     {
         // echoing symbol
-        uint32_t error = app_uart_put( p_event->data.value );
+        uint32_t error;
+
+        uart_tx_put( p_event->data.value );
 
         RestartUART_timer();
 
         if ( !uart_rx_data_ready  ) {
             if ( p_event->data.value == '\r' ) {
                 uart_rx_data_ready = true;
-                app_uart_put( 0 );
+                uart_tx_put( 0 );
             }else{
                 error = app_fifo_put(&m_rx_fifo, p_event->data.value );
+                uart_rx_cnt++;
                 if ( error == NRF_ERROR_NO_MEM ) { 
                     // buffer full, lets signal app to proceed it
                     uart_rx_data_ready = true;
@@ -108,6 +159,171 @@ void deca_uart_event_handle(app_uart_evt_t * p_event)
     }
 }
 
+/* @fn  uart_tx_kick
+ *
+ * @brief start the DMA transfer of the next contiguous part of the TX ring,
+ *        if none is running. Called with the UART interrupt masked.
+ * */
+static void uart_tx_kick(void)
+{
+    uint16_t len = (uint16_t)(tx_head - tx_tail);
+    uint16_t start = tx_tail & UART_TX_RING_MASK;
+
+    if ( !uart_open || tx_dma_len != 0 || len == 0 ) {
+        return;
+    }
+
+    len = MIN(len, UART_TX_BUF_SIZE - start);
+    len = MIN(len, UART_DMA_MAX_LEN);
+
+    tx_dma_len = len;
+    if ( nrf_drv_uart_tx(&uart, &tx_ring[start], (uint8_t)len) != NRF_SUCCESS ) {
+        tx_dma_len = 0;
+    }
+}
+
+/* @fn  uart_tx_write
+ *
+ * @brief queue data into the TX ring, safe from thread and interrupt context
+ *
+ * @return number of bytes queued, less than len if the ring is full
+ * */
+static uint16_t uart_tx_write(const uint8_t *ptr, uint16_t len)
+{
+    uint16_t n, i;
+
+    CRITICAL_REGION_ENTER();
+
+    n = MIN(len, UART_TX_BUF_SIZE - (uint16_t)(tx_head - tx_tail));
+    for ( i = 0; i < n; i++ ) {
+        tx_ring[(tx_head + i) & UART_TX_RING_MASK] = ptr[i];
+    }
+    tx_head += n;
+    mem_arena_mark(MEM_UART_TX, (uint16_t)(tx_head - tx_tail));
+
+    uart_tx_kick();
+
+    CRITICAL_REGION_EXIT();
+
+    return n;
+}
+
+/* @fn  uart_tx_put
+ *
+ * @brief queue one byte, dropped if the TX ring is full
+ * */
+static void uart_tx_put(uint8_t c)
+{
+    (void)uart_tx_write(&c, 1);
+}
+
+/* @fn  uart_event_handler
+ *
+ * @brief UARTE driver events: TX ring progress, RX bytes are passed on to
+ *        deca_uart_event_handle() as app_uart events.
+ * */
+static void uart_event_handler(nrf_drv_uart_event_t * p_event, void * p_context)
+{
+    app_uart_evt_t app_uart_event;
+
+    switch (p_event->type)
+    {
+        case NRF_DRV_UART_EVT_TX_DONE:
+            tx_tail += tx_dma_len;
+            tx_dma_len = 0;
+            uart_tx_kick();
+            break;
+
+        case NRF_DRV_UART_EVT_RX_DONE:
+            app_uart_event.evt_type   = APP_UART_DATA;
+            app_uart_event.data.value = uart_rx_byte;
+            deca_uart_event_handle(&app_uart_event);
+            (void)nrf_drv_uart_rx(&uart, &uart_rx_byte, 1);
+            break;
+
+        case NRF_DRV_UART_EVT_ERROR:
+            app_uart_event.evt_type                 = APP_UART_COMMUNICATION_ERROR;
+            app_uart_event.data.error_communication = p_event->data.error.error_mask;
+            (void)nrf_drv_uart_rx(&uart, &uart_rx_byte, 1);
+            deca_uart_event_handle(&app_uart_event);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* @fn  deca_uart_open
+ *
+ * @brief Function for enabling the UARTE peripheral, queued TX data is sent.
+ *
+ * @param[in] void
+ * */
+void deca_uart_open(void)
+{
+    uint32_t err_code;
+    nrf_drv_uart_config_t config = NRF_DRV_UART_DEFAULT_CONFIG;
+
+    if ( uart_open ) {
+        return;
+    }
+
+    config.pseltxd            = TX_PIN_NUMBER;
+    config.pselrxd            = RX_PIN_NUMBER;
+    config.pselcts            = CTS_PIN_NUMBER;
+    config.pselrts            = RTS_PIN_NUMBER;
+    config.hwfc               = NRF_UART_HWFC_DISABLED;
+    config.parity             = NRF_UART_PARITY_EXCLUDED;
+    config.baudrate           = (nrf_uart_baudrate_t)UART_BAUDRATE_BAUDRATE_Baud115200;
+    config.interrupt_priority = APP_IRQ_PRIORITY_LOW;
+    config.use_easy_dma       = true;
+
+    err_code = nrf_drv_uart_init(&uart, &config, uart_event_handler);
+    APP_ERROR_CHECK(err_code);
+
+    uart_open = true;
+
+    err_code = nrf_drv_uart_rx(&uart, &uart_rx_byte, 1);
+    APP_ERROR_CHECK(err_code);
+
+    CRITICAL_REGION_ENTER();
+    uart_tx_kick();
+    CRITICAL_REGION_EXIT();
+}
+
+/* @fn  deca_uart_close
+ *
+ * @brief Function for disabling the UARTE peripheral in sleep.
+ *
+ * @param[in] void
+ * */
+void deca_uart_close(void)
+{
+    if ( !uart_open ) {
+        return;
+    }
+    uart_open = false;
+    nrf_drv_uart_uninit(&uart);
+}
+
+/* @fn  deca_uart_tx_busy
+ *
+ * @brief true while queued data is being sent
+ * */
+bool deca_uart_tx_busy(void)
+{
+    return (tx_head != tx_tail);
+}
+
+/* @fn  deca_uart_tx_free
+ *
+ * @brief room left in the TX ring, in bytes
+ * */
+uint16_t deca_uart_tx_free(void)
+{
+    return (uint16_t)(UART_TX_BUF_SIZE - (uint16_t)(tx_head - tx_tail));
+}
+
 /* @fn  deca_uart_init
  *
  * @brief Function for initializing the UART module.
@@ -117,33 +333,36 @@ void deca_uart_event_handle(app_uart_evt_t * p_event)
 void deca_uart_init(void)
 {
     uint32_t err_code;
-    const app_uart_comm_params_t comm_params =
-    {
-        RX_PIN_NUMBER,
-        TX_PIN_NUMBER,
-        RTS_PIN_NUMBER,
-        CTS_PIN_NUMBER,
-        APP_UART_FLOW_CONTROL_DISABLED,
-        false,
-        UART_BAUDRATE_BAUDRATE_Baud115200
-    };
-    err_code = app_fifo_init(&m_rx_fifo, rx_buf, sizeof (rx_buf));
-    APP_ERROR_CHECK(err_code);
 
-    APP_UART_INIT(&comm_params,
-                    deca_uart_event_handle,
-                    APP_IRQ_PRIORITY_LOW,
-                    err_code);
+    err_code = app_fifo_init(&m_rx_fifo, MEM_ARENA(MEM_UART_RX), MEM_ARENA_SIZE(MEM_UART_RX));
     APP_ERROR_CHECK(err_code);
 
+    deca_uart_open();
+
     RestartUART_timer();
 }
 
+/* @fn  port_tx_msg
+ *
+ * @brief queue data for sending, returns without waiting for the UART.
+ *        Only blocks (in WFE) if the TX ring is full.
+ * */
 void port_tx_msg(char *ptr, int len)
 {
-    for(int i=0; i<len; ++i)
+    uint16_t n;
+
+    while ( len > 0 )
     {
-        while(app_uart_put(ptr[i]) != NRF_SUCCESS);
+        n = uart_tx_write((const uint8_t *)ptr, (uint16_t)MIN(len, UART_TX_BUF_SIZE));
+        ptr += n;
+        len -= n;
+
+        if ( len > 0 ) {
+            if ( !uart_open ) {
+                break;
+            }
+            __WFE();
+        }
     }
 }
 
@@ -155,13 +374,8 @@ void port_tx_msg(char *ptr, int len)
  * */
 void deca_uart_transmit(char *ptr)
 {
-    uint32_t bit=0;
-    for(bit=0;ptr[bit] != '\0';bit++)
-    {
-        while(app_uart_put(ptr[bit]) != NRF_SUCCESS);
-    }
-    while(app_uart_put('\n') != NRF_SUCCESS);
-    while(app_uart_put('\r') != NRF_SUCCESS);
+    port_tx_msg(ptr, strlen(ptr));
+    port_tx_msg("\n\r", 2);
 }
 /* @fn  deca_uart_receive
  *
@@ -184,8 +398,13 @@ uint32_t deca_uart_receive(char * buffer, size_t size)
     }else{
         *buffer = 0;
     }
-    err_code = app_uart_put( '\n' );
+    if ( !uart_rx_bin ) {
+        uart_tx_put( '\n' );
+    }
     app_fifo_flush( &m_rx_fifo );
+    mem_arena_mark(MEM_UART_RX, uart_rx_cnt);
+    uart_rx_cnt = 0;
+    uart_rx_bin = false;
     uart_rx_data_ready = false;
     return count;
 }
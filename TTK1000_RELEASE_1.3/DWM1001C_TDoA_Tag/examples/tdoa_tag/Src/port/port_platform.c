@@ -23,8 +23,11 @@
 #include "nrfx_rtc.h"
 #include "nrf_drv_spi.h"
 #include "nrf_drv_uart.h"
+#include "nrf_drv_gpiote.h"
+#include "nrf_ppi.h"
 #include "nrf_gpio.h"
 #include "LIS2DH12.h"
+#include "mem_arena.h"
 
 #ifdef TDoA_APP
 #include "nrf.h"
@@ -45,15 +48,34 @@
  ******************************************************************************/
 static volatile uint32_t signalResetDone;
 uint32_t time32_incr = 0;
-static volatile uint32_t timer_val = 0;
-static volatile uint32_t timer_tick_val = 0;
-static uint32_t timer_tick_inc = 1;
 static app_wakeup_check_hook_t app_wakeup_check_hook = NULL;
 static acc_interrupt_hook_t accInterruptHandler = NULL;
 static uint32_t old_ready_pin = 1;
 static bool power_down_peripherals_in_sleep = false;
 static uint32_t UART_timeout;
 static uint8_t spi_init = 0;
+static uint8_t spi_fastrate = 0;
+static volatile uint8_t dw_wakeup_state = 0;
+static volatile uint8_t dw_wake_irq = 0;   // 1: armed, 2: the wake edge was seen
+
+/* pins of the DW1000 devices, see port_dw_select() */
+typedef struct {
+    uint32_t cs_pin;
+    uint32_t irq_pin;
+    uint32_t rst_pin;
+} port_dw_dev_t;
+
+static const port_dw_dev_t port_dw_dev[DWT_NUM_DW_DEV] = {
+    { SPI_CS_PIN, DW1000_IRQ, DW1000_RST },
+#if DWT_NUM_DW_DEV > 1
+    { DW1000_1_CS_PIN, DW1000_1_IRQ, DW1000_1_RST },
+#endif
+#if DWT_NUM_DW_DEV > 2
+#error The board has two DW1000 at most
+#endif
+};
+static volatile uint8_t dw_dev = 0;         // device of the dwt_* calls
+#define DW_CS_PIN               (port_dw_dev[dw_dev].cs_pin)
 /******************************************************************************
  *
  *                              Time section
@@ -81,12 +103,17 @@ void SysTick_Handler (void) {
 
 
 /* @fn    GetLPtimerTickCount
- * @brief wrapper for to read a timer_tick_val, which is incremented by the RTC ISR
- *        The resolution of timer_tick_val is roughly 1/1000 sec.
+ * @brief wrapper for to read the RTC0 time base in ms, see low power timer
  * */
-__STATIC_INLINE uint32_t GetLPtimerTickCount(void)
+static uint32_t GetLPtimerTickCount(void);
+
+/* @fn    portGetLPTickCount
+ * @brief ms of the RTC0 time base, unlike portGetTickCount() it runs in
+ *        the low power sleep
+ * */
+uint32_t portGetLPTickCount(void)
 {
-    return timer_tick_val;
+    return GetLPtimerTickCount();
 }
 
 /**
@@ -199,10 +226,143 @@ __STATIC_INLINE void nrf_gpio_cfg_input_sense_none(uint32_t pin_number, nrf_gpio
  * */
 void port_wakeup_dw1000(void)
 {
-    nrf_gpio_pin_clear(SPI_CS_PIN);
-    nrf_delay_ms(1);
-    nrf_gpio_pin_set(SPI_CS_PIN);
-    nrf_delay_ms(7);
+    nrf_gpio_pin_clear(DW_CS_PIN);
+    nrf_delay_ms(DW1000_WAKEUP_CS_MS);
+    nrf_gpio_pin_set(DW_CS_PIN);
+    nrf_delay_ms(DW1000_WAKEUP_SETTLE_MS);
+}
+
+/* @fn      deca_irq_handler
+ * @brief   GPIOTE handler of the DW1000 IRQ line
+ * */
+static void deca_irq_handler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
+{
+    if ((dw_wake_irq == 1) && (pin == DW1000_IRQ))
+    {
+        // SLP2INIT/CPLOCK of the wake up: the line stays high until the
+        // status is cleared over SPI, in thread mode by
+        // port_wakeup_dw1000_irq_clear()
+        nrf_drv_gpiote_in_event_disable(DW1000_IRQ);
+        dw_wake_irq = 2;
+        if (dw_wakeup_state == 2)
+        {
+            port_lp_timer_stop(LP_TIMER_DW_WAKE);
+            dw_wakeup_state = 3;
+        }
+        return;
+    }
+
+    process_deca_irq();
+}
+
+/* @fn      port_wakeup_dw1000_irq_arm
+ * @brief   the next rising edge of the DW1000 IRQ line is its wake up
+ *          event, called before the DW1000 enters DEEPSLEEP with the
+ *          SLP2INIT and CPLOCK events unmasked
+ * */
+void port_wakeup_dw1000_irq_arm(void)
+{
+    dw_wake_irq = 1;
+}
+
+/* @fn      port_wakeup_dw1000_irq_seen
+ * @return  true if the DW1000 signalled its wake up since the arming
+ * */
+bool port_wakeup_dw1000_irq_seen(void)
+{
+    return (dw_wake_irq == 2);
+}
+
+/* @fn      port_wakeup_dw1000_irq_clear
+ * @brief   back to dwt_isr() on the DW1000 IRQ line, once the caller has
+ *          cleared the wake up events in SYS_STATUS and SYS_MASK
+ * */
+void port_wakeup_dw1000_irq_clear(void)
+{
+    if (dw_wake_irq == 0)
+    {
+        return;
+    }
+    dw_wake_irq = 0;
+    nrf_drv_gpiote_in_event_enable(DW1000_IRQ, true);
+}
+
+/* @fn      port_deca_irq_init
+ * @brief   Route the DW1000 IRQ line (active high) to dwt_isr().
+ *          The low power PORT event is used so the GPIOTE does not keep the
+ *          HF clock running while the MCU sleeps.
+ * */
+void port_deca_irq_init(void)
+{
+    unsigned int dev;
+
+    if (!nrf_drv_gpiote_is_init())
+    {
+        APP_ERROR_CHECK( nrf_drv_gpiote_init() );
+    }
+
+    nrf_drv_gpiote_in_config_t in_config = GPIOTE_CONFIG_IN_SENSE_LOTOHI(false);
+    in_config.pull = NRF_GPIO_PIN_NOPULL;
+
+    for (dev = 0; dev < DWT_NUM_DW_DEV; dev++)
+    {
+        APP_ERROR_CHECK( nrf_drv_gpiote_in_init(port_dw_dev[dev].irq_pin, &in_config, deca_irq_handler) );
+
+        nrf_drv_gpiote_in_event_enable(port_dw_dev[dev].irq_pin, true);
+    }
+}
+
+/* @fn      process_deca_irq
+ * @brief   Service each DW1000 until its IRQ line is released, the device
+ *          of the interrupted code is selected back at the end
+ * */
+void process_deca_irq(void)
+{
+    unsigned int dev, cur = dw_dev;
+
+    for (dev = 0; dev < DWT_NUM_DW_DEV; dev++)
+    {
+        if (nrf_gpio_pin_read(port_dw_dev[dev].irq_pin) == 0)
+        {
+            continue;
+        }
+        port_dw_select(dev);
+        do {
+            dwt_isr();
+        } while (nrf_gpio_pin_read(port_dw_dev[dev].irq_pin) != 0);
+    }
+
+    port_dw_select(cur);
+}
+
+/* @fn      port_dw_select
+ * @brief   the next dwt_* calls go to the device dev: driver context and
+ *          chip select
+ * @return  0, -1 if the board has no such device
+ * */
+int port_dw_select(unsigned int dev)
+{
+    decaIrqStatus_t stat;
+
+    if (dev >= DWT_NUM_DW_DEV)
+    {
+        return -1;
+    }
+
+    stat = decamutexon();
+    dwt_setlocaldataptr(dev);
+    dw_dev = (uint8_t)dev;
+    decamutexoff(stat);
+
+    return 0;
+}
+
+/* @fn      port_dw_current
+ * @return  the device of the dwt_* calls
+ * */
+unsigned int port_dw_current(void)
+{
+    return dw_dev;
 }
 
 /**
@@ -241,33 +401,123 @@ void port_set_app_wakeup_check_hook(app_wakeup_check_hook_t ptr)
     app_wakeup_check_hook = ptr;
 }
 
+/******************************************************************************
+ *
+ *                      SPI transport (SPIM with EasyDMA)
+ *
+ * The DW1000 transaction header and body are sent as chained DMA transfers
+ * with DW_CS held low by the port (the driver does not own the CS pin).
+ * Read data goes straight into the caller's buffer and the CPU sleeps in WFE
+ * while a transfer is running.
+ *
+ ******************************************************************************/
+
+/* EasyDMA MAXCNT is 8 bits on nRF52832 */
+#define SPI_DMA_MAX_LEN         255
+/* reads up to this length are done as one combined transfer, this avoids
+ * 1-byte RX transfers (nRF52832 anomaly 58) */
+#define SPI_SHORT_READ_LEN      4
+#define SPI_HEADER_MAX_LEN      3
+
+/* EasyDMA can only read from RAM, bodies in flash are bounced through here */
+static uint8 * const spi_bounce_buf = MEM_ARENA(MEM_SPI_BOUNCE);
+
+__STATIC_INLINE bool spi_is_in_ram(const void *p)
+{
+    return ((((uint32_t)p) & 0xE0000000u) == 0x20000000u);
+}
+
+/* @fn      spi_dma_xfer
+ * @brief   one DMA transfer, sleeps until the SPIM end event
+ * */
+static void spi_dma_xfer(const uint8 *tx, uint8 txlen, uint8 *rx, uint8 rxlen)
+{
+    spi_xfer_done = false;
+    nrf_drv_spi_transfer(&spi, tx, txlen, rx, rxlen);
+    while(!spi_xfer_done)
+    {
+        __WFE();
+    }
+}
+
+/* @fn      spi_dma_tx
+ * @brief   send a buffer of any length, CS must be held by the caller
+ * */
+static void spi_dma_tx(const uint8 *tx, uint32 len)
+{
+    uint32 n;
+
+    while(len > 0)
+    {
+        if(spi_is_in_ram(tx))
+        {
+            n = MIN(len, SPI_DMA_MAX_LEN);
+            spi_dma_xfer(tx, (uint8)n, NULL, 0);
+        }
+        else
+        {
+            n = MIN(len, MEM_ARENA_SIZE(MEM_SPI_BOUNCE));
+            n = MIN(n, SPI_DMA_MAX_LEN);
+            mem_arena_mark(MEM_SPI_BOUNCE, n);
+            memcpy(spi_bounce_buf, tx, n);
+            spi_dma_xfer(spi_bounce_buf, (uint8)n, NULL, 0);
+        }
+        tx += n;
+        len -= n;
+    }
+}
+
+/* @fn      spi_dma_rx
+ * @brief   receive into a buffer of any length, CS must be held by the caller
+ * */
+static void spi_dma_rx(uint8 *rx, uint32 len)
+{
+    uint32 n;
+
+    while(len > 0)
+    {
+        n = MIN(len, SPI_DMA_MAX_LEN);
+        if((len - n) == 1)
+        {
+            n--; // never leave a 1-byte RX transfer for the end (anomaly 58)
+        }
+        spi_dma_xfer(NULL, 0, rx, (uint8)n);
+        rx += n;
+        len -= n;
+    }
+}
+
 int readfromspi(uint16 headerLength,
                 const uint8 *headerBuffer,
                 uint32 readlength,
                 uint8 *readBuffer)
 {
-    uint8 idatabuf[DATALEN1]={0};
-    uint8 itempbuf[DATALEN1]={0};
+    decaIrqStatus_t stat = decamutexon();
 
-    uint8 * p1;
-    uint32 idatalength=0;
+    port_spi_resume();
 
-    memset(idatabuf, 0, DATALEN1);
-    memset(itempbuf, 0, DATALEN1);
+    nrf_gpio_pin_clear(DW_CS_PIN);
 
-    p1=idatabuf;
-    memcpy(p1,headerBuffer, headerLength);
+    if(readlength <= SPI_SHORT_READ_LEN)
+    {
+        uint8 txbuf[SPI_HEADER_MAX_LEN + SPI_SHORT_READ_LEN];
+        uint8 rxbuf[SPI_HEADER_MAX_LEN + SPI_SHORT_READ_LEN];
+
+        memcpy(txbuf, headerBuffer, headerLength);
+        memset(&txbuf[headerLength], 0, readlength);
+        spi_dma_xfer(txbuf, (uint8)(headerLength + readlength),
+                     rxbuf, (uint8)(headerLength + readlength));
+        memcpy(readBuffer, &rxbuf[headerLength], readlength);
+    }
+    else
+    {
+        spi_dma_tx(headerBuffer, headerLength);
+        spi_dma_rx(readBuffer, readlength);
+    }
 
-    p1 += headerLength;
-    memset(p1,0x00,readlength);
+    nrf_gpio_pin_set(DW_CS_PIN);
 
-    idatalength= headerLength + readlength;
-
-    spi_xfer_done = false;
-    nrf_drv_spi_transfer(&spi, idatabuf, idatalength, itempbuf, idatalength);
-    while(!spi_xfer_done);
-    p1=itempbuf + headerLength;
-    memcpy(readBuffer, p1, readlength);
+    decamutexoff(stat);
 
     return 0;
 }
@@ -278,25 +528,18 @@ int writetospi( uint16 headerLength,
                 uint32 bodylength,
                 const uint8 *bodyBuffer)
 {
-    uint8 idatabuf[DATALEN1]={0};
-    uint8 itempbuf[DATALEN1]={0};
+    decaIrqStatus_t stat = decamutexon();
 
-    uint8 * p1;
-    uint32 idatalength=0;
+    port_spi_resume();
 
-    memset(idatabuf, 0, DATALEN1);
-    memset(itempbuf, 0, DATALEN1);
+    nrf_gpio_pin_clear(DW_CS_PIN);
 
-    p1=idatabuf;
-    memcpy(p1,headerBuffer, headerLength);
-    p1 += headerLength;
-    memcpy(p1,bodyBuffer,bodylength);
+    spi_dma_tx(headerBuffer, headerLength);
+    spi_dma_tx(bodyBuffer, bodylength);
 
-    idatalength= headerLength + bodylength;
+    nrf_gpio_pin_set(DW_CS_PIN);
 
-    spi_xfer_done = false;
-    nrf_drv_spi_transfer(&spi, idatabuf, idatalength, itempbuf, idatalength);
-    while(!spi_xfer_done);
+    decamutexoff(stat);
 
     return 0;
 }
@@ -342,6 +585,77 @@ __STATIC_INLINE void nrf_gpio_cfg_output2(uint32_t pin_number)
             NRF_GPIO_PIN_NOSENSE);
 }
 
+/* Reset counters since the power was applied, in the RAM which is not
+ * cleared by the start up code. A power-on finds it random, the check word
+ * tells. */
+#define PORT_RESET_MAGIC    0x52535431UL
+
+static struct {
+    uint32_t            magic;
+    port_reset_info_t   info;
+    uint32_t            check;
+} reset_info __attribute__((section(".non_init")));
+
+static uint32_t port_reset_check(void)
+{
+    const uint32_t *cnt = reset_info.info.cnt;
+
+    return ~(reset_info.magic ^ (uint32_t)reset_info.info.last ^ cnt[PORT_RESET_POWER_ON] ^
+             (cnt[PORT_RESET_BROWN_OUT] << 8) ^ (cnt[PORT_RESET_WARM] << 16));
+}
+
+/* @fn      port_reset_reason
+ * @brief   reason of the last MCU reset, counted. A watchdog, soft reset or
+ *          lockup is warm: the DW1000 kept its power and configuration. On
+ *          the nRF52 a brown-out is a power-on reset, RESETREAS reads 0 for
+ *          both; a brown-out is told by the reset counters, the RAM is
+ *          retained far below the brown-out level and a real power-on finds
+ *          it random. The DW1000 needs more voltage than the MCU on the same
+ *          supply, it was reset by the brown-out too. Call once, the reason
+ *          is cleared.
+ * */
+port_reset_t port_reset_reason(void)
+{
+    uint32_t reason = NRF_POWER->RESETREAS;
+    port_reset_t r;
+    bool kept;
+
+    NRF_POWER->RESETREAS = reason;  // write 1 to clear
+
+    kept = (reset_info.magic == PORT_RESET_MAGIC) && (reset_info.check == port_reset_check());
+    if ((reason & (POWER_RESETREAS_DOG_Msk | POWER_RESETREAS_SREQ_Msk | POWER_RESETREAS_LOCKUP_Msk)) != 0)
+    {
+        r = PORT_RESET_WARM;
+    }
+    else if ((reason == 0) && kept)
+    {
+        r = PORT_RESET_BROWN_OUT;
+    }
+    else
+    {
+        r = PORT_RESET_POWER_ON;
+    }
+
+    if (!kept)
+    {
+        memset(&reset_info, 0, sizeof(reset_info));
+        reset_info.magic = PORT_RESET_MAGIC;
+    }
+    reset_info.info.last = r;
+    reset_info.info.cnt[r]++;
+    reset_info.check = port_reset_check();
+
+    return r;
+}
+
+/* @fn      port_reset_info
+ * @brief   reason of the last reset and resets since the power was applied
+ * */
+const port_reset_info_t *port_reset_info(void)
+{
+    return &reset_info.info;
+}
+
 /* @fn      reset_DW1000
  * @brief   DW_RESET pin on DW1000 has 2 functions
  *          In general it is output, but it also can be used to reset the
@@ -350,15 +664,42 @@ __STATIC_INLINE void nrf_gpio_cfg_output2(uint32_t pin_number)
  * */
 void reset_DW1000(void)
 {
-    nrf_gpio_cfg_output2(DW1000_RST);
-    nrf_gpio_pin_clear(DW1000_RST);
+    unsigned int dev;
+
+    // all the devices are held in reset together
+    for (dev = 0; dev < DWT_NUM_DW_DEV; dev++)
+    {
+        nrf_gpio_cfg_output2(port_dw_dev[dev].rst_pin);
+        nrf_gpio_pin_clear(port_dw_dev[dev].rst_pin);
+    }
     nrf_delay_ms(200);
-    nrf_gpio_pin_set(DW1000_RST);
+    for (dev = 0; dev < DWT_NUM_DW_DEV; dev++)
+    {
+        nrf_gpio_pin_set(port_dw_dev[dev].rst_pin);
+    }
     nrf_delay_ms(50);
-    nrf_gpio_cfg_input(DW1000_RST, NRF_GPIO_PIN_NOPULL);
+    for (dev = 0; dev < DWT_NUM_DW_DEV; dev++)
+    {
+        nrf_gpio_cfg_input(port_dw_dev[dev].rst_pin, NRF_GPIO_PIN_NOPULL);
+    }
     nrf_delay_ms(2);
 }
 
+/* @fn      port_dw_cs_init
+ * @brief   all the chip selects high, CS is driven by readfromspi/writetospi
+ *          to chain header and body transfers
+ * */
+static void port_dw_cs_init(void)
+{
+    unsigned int dev;
+
+    for (dev = 0; dev < DWT_NUM_DW_DEV; dev++)
+    {
+        nrf_gpio_pin_set(port_dw_dev[dev].cs_pin);
+        nrf_gpio_cfg_output(port_dw_dev[dev].cs_pin);
+    }
+}
+
 /* @fn      port_set_dw1000_slowrate
  * @brief   Function is used for re-initialize the SPI freq as 2MHz which does
  *          init state check
@@ -372,9 +713,10 @@ void port_set_dw1000_slowrate(void)
 
     nrf_drv_spi_config_t  spi_config = \
            NRF_DRV_SPI_DEFAULT_CONFIG_2M(SPI_INSTANCE);
-    spi_config.ss_pin = SPI_CS_PIN;
+    port_dw_cs_init();
     APP_ERROR_CHECK( nrf_drv_spi_init(&spi, &spi_config, spi_event_handler, NULL) );
     spi_init = 1;
+    spi_fastrate = 0;
     nrf_delay_ms(2);
 }
 
@@ -391,15 +733,47 @@ void port_set_dw1000_fastrate(void)
 
     nrf_drv_spi_config_t  spi_config = \
         NRF_DRV_SPI_DEFAULT_CONFIG_8M(SPI_INSTANCE);
-    spi_config.ss_pin = SPI_CS_PIN;
+    port_dw_cs_init();
     // TODO check the behavior of nrf_drv_spi_init2 in previous project
     // nrf_drv_spi_init returns error when SPI is already inited, so deinit it first
     //nrf_drv_spi_uninit(&spi);
     APP_ERROR_CHECK( nrf_drv_spi_init(&spi, &spi_config, spi_event_handler, NULL) );
     spi_init = 1;
+    spi_fastrate = 1;
     nrf_delay_ms(2);
 }
 
+/* @fn      port_spi_suspend
+ * @brief   release the SPI for the sleep, it is restored on its next use
+ * */
+void port_spi_suspend(void)
+{
+    if(spi_init != 0){
+        nrf_drv_spi_uninit(&spi);
+        spi_init = 0;
+    }
+}
+
+/* @fn      port_spi_resume
+ * @brief   restore the SPI at the last selected rate if it was suspended
+ * */
+void port_spi_resume(void)
+{
+    if(spi_init != 0){
+        return;
+    }
+
+    nrf_drv_spi_config_t  spi_config = \
+        NRF_DRV_SPI_DEFAULT_CONFIG_8M(SPI_INSTANCE);
+
+    if(!spi_fastrate){
+        spi_config.frequency = NRF_DRV_SPI_FREQ_2M;
+    }
+    port_dw_cs_init();
+    APP_ERROR_CHECK( nrf_drv_spi_init(&spi, &spi_config, spi_event_handler, NULL) );
+    spi_init = 1;
+}
+
 void deca_sleep(unsigned int time_ms)
 {
     nrf_delay_ms(time_ms);
@@ -409,33 +783,173 @@ void deca_sleep(unsigned int time_ms)
 
 const nrfx_rtc_t rtc = NRFX_RTC_INSTANCE(0); /**< Declaring an instance of nrf_drv_rtc for RTC0. */
 
+/******************************************************************************
+ *
+ * Low power timer
+ *
+ * RTC0 is configured once and runs from the LF clock for the whole time, so
+ * the time base survives the sleeps and nothing has to be set up again per
+ * blink. CC0 is the earliest pending wake deadline (port_lp_timer_start),
+ * CC1 polls the accelerometer ready pin and the UART RX pin while the MCU
+ * sleeps in low_power().
+ *
+ ******************************************************************************/
+
+#define LP_RTC_FREQ             (32768UL)
+#define LP_RTC_MASK             (0xFFFFFFUL)    // 24 bit counter
+#define LP_MS_TO_TICKS(ms)      ((uint64_t)(ms) * LP_RTC_FREQ / 1000)
+/* poll rate in sleep, roughly one poll per ms for small delays and 64ms for
+ * large ones in order to minimize power waste in ISR */
+#define LP_POLL_FAST_TICKS      (LP_MS_TO_TICKS(1))
+#define LP_POLL_SLOW_TICKS      (LP_MS_TO_TICKS(64))
+#define LP_POLL_SLOW_MIN_MS     (1000)
+/* compare values closer than this to the counter may not fire */
+#define LP_CC_MIN_TICKS         (2)
+/* LED pulse: the RTC0 compare, through a PPI channel, toggles the LED pin
+ * with a GPIOTE task, see port_led_pulse_at() */
+#define LP_LED_CC               (2)
+#define LP_LED_PPI_CH           (NRF_PPI_CHANNEL0)
+
+typedef struct {
+    uint8_t             active;
+    uint64_t            deadline;   // in RTC ticks
+    lp_timer_handler_t  handler;
+} lp_timer_t;
+
+static lp_timer_t lp_timers[LP_TIMER_NUM];
+static volatile uint32_t lp_overflows = 0;
+static volatile uint8_t lp_sleeping = 0;
+static volatile uint8_t lp_abort = 0;   // UART activity ends the sleep
+static uint32_t lp_poll_ticks = LP_POLL_FAST_TICKS;
+
+/* @fn      lp_timer_now
+ * @brief   RTC time in ticks, extended with the counter overflows
+ * */
+static uint64_t lp_timer_now(void)
+{
+    uint32_t ovf, cnt;
+
+    CRITICAL_REGION_ENTER();
+    ovf = lp_overflows;
+    cnt = nrfx_rtc_counter_get(&rtc);
+    if ( nrf_rtc_event_pending(rtc.p_reg, NRF_RTC_EVENT_OVERFLOW) ) {
+        // overflow not serviced yet, read again to be sure it is past the wrap
+        cnt = nrfx_rtc_counter_get(&rtc);
+        ovf++;
+    }
+    CRITICAL_REGION_EXIT();
+
+    return ((uint64_t)ovf << 24) | cnt;
+}
+
+/* @fn      GetLPtimerTickCount
+ * @brief   milliseconds of the RTC0 time base
+ * */
+static uint32_t GetLPtimerTickCount(void)
+{
+    return (uint32_t)((lp_timer_now() * 1000) / LP_RTC_FREQ);
+}
+
+/* @fn      lp_poll_arm
+ * @brief   schedule the next poll of the wake up pins (CC1)
+ * */
+static void lp_poll_arm(void)
+{
+    uint32_t cc = (nrfx_rtc_counter_get(&rtc) + lp_poll_ticks) & LP_RTC_MASK;
+
+    nrfx_rtc_cc_set(&rtc, 1, cc, true);
+}
+
+/* @fn      lp_timer_arm
+ * @brief   program CC0 with the earliest deadline
+ * @return  false if the earliest deadline is already due
+ * */
+static bool lp_timer_arm(void)
+{
+    uint64_t now = lp_timer_now();
+    uint64_t earliest = 0;
+    bool     found = false;
+    int      i;
+
+    for ( i = 0; i < LP_TIMER_NUM; i++ ) {
+        if ( lp_timers[i].active && (!found || (lp_timers[i].deadline < earliest)) ) {
+            earliest = lp_timers[i].deadline;
+            found = true;
+        }
+    }
+
+    if ( !found ) {
+        nrfx_rtc_cc_disable(&rtc, 0);
+        return true;
+    }
+
+    if ( earliest < now + LP_CC_MIN_TICKS ) {
+        return false;
+    }
+
+    // deadlines past one counter period match early, they are armed again
+    nrfx_rtc_cc_set(&rtc, 0, (uint32_t)(earliest & LP_RTC_MASK), true);
+    return true;
+}
+
+/* @fn      lp_timer_process
+ * @brief   run the handlers of the expired timers and arm the next one
+ * @return  bit mask of the expired timers
+ * */
+static uint32_t lp_timer_process(void)
+{
+    uint32_t expired = 0;
+    int      i;
+
+    do {
+        uint64_t now = lp_timer_now();
+
+        for ( i = 0; i < LP_TIMER_NUM; i++ ) {
+            if ( lp_timers[i].active && (lp_timers[i].deadline <= now) ) {
+                lp_timers[i].active = 0;
+                expired |= (1UL << i);
+                // a handler may start its timer again
+                if ( lp_timers[i].handler != NULL ) {
+                    lp_timers[i].handler();
+                }
+            }
+        }
+    } while ( !lp_timer_arm() );
+
+    return expired;
+}
+
 /** @brief: Function for handling the RTC0 interrupts.
- * Triggered on TICK and COMPARE0 match.
+ * Triggered on COMPARE0 (wake deadline), COMPARE1 (pin poll) and OVERFLOW.
+ * The deadlines are processed in thread mode, the interrupt only wakes the MCU.
  */
 static void rtc_handler(nrfx_rtc_int_type_t int_type)
 {
-    if (int_type == NRFX_RTC_INT_COMPARE0)
+    if (int_type == NRFX_RTC_INT_OVERFLOW)
     {
-        timer_val++;
+        lp_overflows++;
     }
-    else if (int_type == NRFX_RTC_INT_TICK)
+    else if (int_type == NRFX_RTC_INT_COMPARE1)
     {
-        timer_tick_val += timer_tick_inc;
-        nrf_rtc_event_clear(rtc.p_reg, NRF_RTC_EVENT_TICK);
-        uint32_t ready_pin = nrf_gpio_pin_read( READY_PIN ); 
+        if ( !lp_sleeping ) {
+            return;
+        }
+        lp_poll_arm();
+
+        uint32_t ready_pin = nrf_gpio_pin_read( READY_PIN );
         if ( old_ready_pin == 0 && ready_pin == 1 ) {
             if ( accInterruptHandler != NULL ) {
                 accInterruptHandler();
             }
         }
-        old_ready_pin = ready_pin;    
+        old_ready_pin = ready_pin;
         if ( nrf_gpio_pin_latch_get(RX_PIN_NUMBER) ) {
             nrf_gpio_cfg_input_sense_none(RX_PIN_NUMBER, NRF_GPIO_PIN_NOPULL);
             power_down_peripherals_in_sleep = false;
             RestartUART_timer(0);
             nrf_gpio_pin_latch_clear(RX_PIN_NUMBER);
             // waking up from sleep in order to reenable UART
-            timer_val++;
+            lp_abort = 1;
         }
     }
 }
@@ -450,88 +964,211 @@ static void lfclk_config(void)
     nrf_drv_clock_lfclk_request(NULL);
 }
 
-/** @brief Function initialization and configuration of RTC driver instance.
- */
-static void rtc_config(void)
+/* @fn      port_lp_timer_init
+ * @brief   start the RTC0 time base, called once at start up after the
+ *          LF clock was requested
+ * */
+void port_lp_timer_init(void)
 {
     uint32_t err_code;
 
-    //Initialize RTC instance
+    //Initialize RTC instance, no prescaler: 30.5us resolution
     nrfx_rtc_config_t config = NRFX_RTC_DEFAULT_CONFIG;
-    config.prescaler = 4095;
+    config.prescaler = 0;
     err_code = nrfx_rtc_init(&rtc, &config, rtc_handler);
     APP_ERROR_CHECK(err_code);
 
-    //Enable tick event & interrupt
-    nrfx_rtc_tick_enable(&rtc,true);
+    // the overflows extend the 24 bit counter
+    nrfx_rtc_overflow_enable(&rtc, true);
 
-    //Set compare channel to trigger interrupt after COMPARE_COUNTERTIME seconds
-    err_code = nrfx_rtc_cc_set(&rtc,0,5 * 8,true);
-    APP_ERROR_CHECK(err_code);
+    memset(lp_timers, 0, sizeof(lp_timers));
 
     //Power on RTC instance
     nrfx_rtc_enable(&rtc);
 }
 
+/* @fn      port_lp_timer_start
+ * @brief   (re)start a wake deadline delay_ms from now, the handler is
+ *          called from low_power() when it expires. CC0 is armed at once,
+ *          so the deadline also wakes the MCU from __WFE() outside of
+ *          low_power()
+ * */
+void port_lp_timer_start(uint8_t id, uint32_t delay_ms, lp_timer_handler_t handler)
+{
+    if ( id >= LP_TIMER_NUM ) {
+        return;
+    }
+    lp_timers[id].deadline = lp_timer_now() + LP_MS_TO_TICKS(delay_ms);
+    lp_timers[id].handler = handler;
+    lp_timers[id].active = 1;
+    if ( !lp_timer_arm() ) {
+        // already due, the next __WFE() must not wait for CC0
+        __SEV();
+    }
+}
+
+/* @fn      port_lp_timer_stop
+ * @brief   cancel a wake deadline
+ * */
+void port_lp_timer_stop(uint8_t id)
+{
+    if ( id < LP_TIMER_NUM ) {
+        lp_timers[id].active = 0;
+    }
+}
+
+/* @fn      port_lp_timer_pending
+ * @brief   return true if the wake deadline has not expired yet
+ * */
+bool port_lp_timer_pending(uint8_t id)
+{
+    return ( (id < LP_TIMER_NUM) && lp_timers[id].active );
+}
+
+/* @fn      port_led_pulse_at
+ * @brief   turn an LED (active low) on delay_ms from now, in hardware, so
+ *          the MCU is not woken up for it. RTC0 CC2 triggers the GPIOTE
+ *          task of the pin through a PPI channel, the pin is owned by the
+ *          GPIOTE until port_led_pulse_end()
+ * */
+void port_led_pulse_at(uint32_t pin, uint32_t delay_ms)
+{
+    static bool gpiote_out = false;
+    uint64_t ticks = LP_MS_TO_TICKS(delay_ms);
+    uint32_t cc;
+
+    if ( !gpiote_out ) {
+        // starts high (LED off), the compare toggles it low
+        nrf_drv_gpiote_out_config_t out_config = GPIOTE_CONFIG_OUT_TASK_TOGGLE(true);
+
+        if ( !nrf_drv_gpiote_is_init() ) {
+            APP_ERROR_CHECK( nrf_drv_gpiote_init() );
+        }
+        APP_ERROR_CHECK( nrf_drv_gpiote_out_init(pin, &out_config) );
+        gpiote_out = true;
+    }
+
+    if ( ticks < LP_CC_MIN_TICKS ) {
+        ticks = LP_CC_MIN_TICKS;
+    }
+    if ( ticks > LP_RTC_MASK ) {
+        ticks = LP_RTC_MASK;
+    }
+    cc = (uint32_t)((nrfx_rtc_counter_get(&rtc) + ticks) & LP_RTC_MASK);
+
+    nrf_drv_gpiote_out_task_enable(pin);
+    nrf_ppi_channel_endpoint_setup(LP_LED_PPI_CH,
+                                   nrfx_rtc_event_address_get(&rtc, NRF_RTC_EVENT_COMPARE_2),
+                                   nrf_drv_gpiote_out_task_addr_get(pin));
+    nrf_ppi_channel_enable(LP_LED_PPI_CH);
+
+    // the event is routed to the PPI only, there is no interrupt
+    nrfx_rtc_cc_set(&rtc, LP_LED_CC, cc, false);
+}
+
+/* @fn      port_led_pulse_end
+ * @brief   cancel port_led_pulse_at(), the pin is given back to the GPIO
+ *          (LEDS_ON/LEDS_OFF) with the level of its OUT register
+ * */
+void port_led_pulse_end(uint32_t pin)
+{
+    nrfx_rtc_cc_disable(&rtc, LP_LED_CC);
+    nrf_ppi_channel_disable(LP_LED_PPI_CH);
+    nrf_drv_gpiote_out_task_disable(pin);
+}
+
+/* DW1000 wake up from the sleep timer: CS low, then the XTAL settles. The
+ * MCU sleeps until the wake up interrupt, DW1000_WAKEUP_SETTLE_MS at most */
+static void dw_wakeup_settle(void)
+{
+    nrf_gpio_pin_set(SPI_CS_PIN);
+    dw_wakeup_state = 2;
+    if (dw_wake_irq == 2)
+    {
+        dw_wakeup_state = 3; // the edge came while CS was still low
+        return;
+    }
+    port_lp_timer_start(LP_TIMER_DW_WAKE, DW1000_WAKEUP_SETTLE_MS, NULL);
+}
+
+static void dw_wakeup_cs(void)
+{
+    nrf_gpio_pin_clear(SPI_CS_PIN);
+    port_lp_timer_start(LP_TIMER_DW_WAKE, DW1000_WAKEUP_CS_MS, dw_wakeup_settle);
+    dw_wakeup_state = 1;
+}
+
+/* @fn      port_wakeup_dw1000_at
+ * @brief   hold DW_CS low after delay_ms (from the sleep timer) so the DW1000
+ *          is ready DW1000_WAKEUP_TIME_MS later, without a busy wait
+ * */
+void port_wakeup_dw1000_at(uint32_t delay_ms)
+{
+    dw_wakeup_state = 0;
+    port_lp_timer_start(LP_TIMER_DW_WAKE, delay_ms, dw_wakeup_cs);
+}
+
+/* @fn      port_wakeup_dw1000_done
+ * @brief   finish port_wakeup_dw1000_at(), cancels it when low_power() was
+ *          left before the DW1000 was ready
+ * @return  true if the DW1000 was woken up and signalled it is ready, or
+ *          had DW1000_WAKEUP_SETTLE_MS to settle when the wake up
+ *          interrupt is not armed
+ * */
+bool port_wakeup_dw1000_done(void)
+{
+    bool done = (dw_wakeup_state == 3) ||
+                ( (dw_wake_irq == 0) && (dw_wakeup_state == 2) && !port_lp_timer_pending(LP_TIMER_DW_WAKE) );
+
+    port_lp_timer_stop(LP_TIMER_DW_WAKE);
+    nrf_gpio_pin_set(SPI_CS_PIN);
+    dw_wakeup_state = 0;
+
+    return done;
+}
+
 void eternal_sleep()
 {
     do { __WFE(); } while(1);
 }
 
+/* @fn      low_power
+ * @brief   sleep for delay ms, or until the wake up hook returns true. The
+ *          handlers of other wake deadlines expiring meanwhile are run from
+ *          here. The SPI is restored on its next use.
+ * */
 void low_power(int delay)
 {
-    uint32_t time_ticks;
-    ret_code_t err_code = NRF_SUCCESS;
+    port_spi_suspend();
 
-    nrf_drv_spi_t spi = NRF_DRV_SPI_INSTANCE(0);
-    nrf_drv_spi_uninit(&spi);
-    spi_init = 0;
-
-    if ( !power_down_peripherals_in_sleep ) {
+    if ( !power_down_peripherals_in_sleep && !deca_uart_tx_busy() ) {
         if ( check_timer( UART_timeout, UART_INACTIVITY_TIMEOUT ) ) {
             power_down_peripherals_in_sleep = true;
         }
     }
-    
+
     bool need_to_wakeup_after_sleep = false;
     if ( power_down_peripherals_in_sleep ) {
         need_to_wakeup_after_sleep = true;
         // disabling UART - may be a bug in the Nordic chip but the 500uA in sleep is unexpectedly large current
-        app_uart_close();
+        deca_uart_close();
 
-        // RX_PIN_NUMBER is now latched 
+        // RX_PIN_NUMBER is now latched
         nrf_gpio_cfg_input_sense_low(RX_PIN_NUMBER, NRF_GPIO_PIN_NOPULL);
     }
 
-    //Initialize RTC instance
-    nrfx_rtc_config_t config = NRFX_RTC_DEFAULT_CONFIG;
-    // rougly one tick per millisecond for small delays and 64ms for large ones in order to minimize power waste in ISR
-    if ( delay > 1000 ) {
-        config.prescaler = 2111;
-        delay >>= 6;
-        timer_tick_inc = 1<<6;
-    }else{
-        config.prescaler = 32;
-        timer_tick_inc = 1;
-    }
-    err_code = nrfx_rtc_init(&rtc, &config, rtc_handler);
-    APP_ERROR_CHECK(err_code);
-
-    //Enable tick event & interrupt
-    nrfx_rtc_tick_enable(&rtc,true);
+    port_lp_timer_start(LP_TIMER_SLEEP, (delay > 0) ? (uint32_t)delay : 0, NULL);
 
-    //Set compare channel to trigger interrupt after COMPARE_COUNTERTIME seconds
-    err_code = nrfx_rtc_cc_set( &rtc, 0, delay, true );
-    APP_ERROR_CHECK(err_code);
-    // clear the counter - the only way to do it, because enable/disable, init/uninit events do not clear this register
-    nrfx_rtc_counter_clear( &rtc );
+    lp_poll_ticks = ( delay > LP_POLL_SLOW_MIN_MS ) ? LP_POLL_SLOW_TICKS : LP_POLL_FAST_TICKS;
+    lp_abort = 0;
+    lp_sleeping = 1;
+    lp_poll_arm();
 
-    timer_val = 0;
-    //Power on RTC instance
-    nrfx_rtc_enable(&rtc);
-
-    while( timer_val == 0 ) {
+    while( !(lp_timer_process() & (1UL << LP_TIMER_SLEEP)) ) {
         __WFI();
+        if ( lp_abort ) {
+            break;
+        }
         if ( app_wakeup_check_hook != NULL ) {
             if ( app_wakeup_check_hook() ) {
                 break;
@@ -539,32 +1176,16 @@ void low_power(int delay)
         }
     }
 
+    lp_sleeping = 0;
+    nrfx_rtc_cc_disable(&rtc, 1);
+    port_lp_timer_stop(LP_TIMER_SLEEP);
+
     if ( need_to_wakeup_after_sleep ) {
-        const app_uart_comm_params_t comm_params =
-        {
-            RX_PIN_NUMBER,
-            TX_PIN_NUMBER,
-            RTS_PIN_NUMBER,
-            CTS_PIN_NUMBER,
-            APP_UART_FLOW_CONTROL_DISABLED,
-            false,
-            UART_BAUDRATE_BAUDRATE_Baud115200
-        };
-        APP_UART_INIT(&comm_params,
-                    deca_uart_event_handle,
-                    APP_IRQ_PRIORITY_LOW,
-                    err_code);
-    }
-
-    timer_val=0;
+        deca_uart_open();
+    }
 
     // Enable SysTick Interrupt
     SysTick->CTRL |= SysTick_CTRL_TICKINT_Msk;
-
-    // Disable Timer.
-    nrfx_rtc_tick_disable(&rtc);
-    nrfx_rtc_uninit(&rtc);
-//    nrf_drv_timer_disable(&TIMER_Wakeup);
 }
 #endif
 //
@@ -585,6 +1206,7 @@ void low_power(int delay)
  * Function: decamutexon()
  *
  * Description: This function should disable interrupts.
+ *              The DW1000 IRQ line is serviced by the GPIOTE interrupt.
  *
  *
  * input parameters: void
@@ -595,12 +1217,12 @@ void low_power(int delay)
 
 decaIrqStatus_t decamutexon(void)
 {
-    uint32_t s = NVIC_GetPendingIRQ((IRQn_Type)DW1000_IRQ);
+    decaIrqStatus_t s = NVIC_GetEnableIRQ(GPIOTE_IRQn);
     if(s)
     {
-        NVIC_DisableIRQ((IRQn_Type)DW1000_IRQ);
+        NVIC_DisableIRQ(GPIOTE_IRQn);
     }
-    return 0;
+    return s;
 }
 ///*! ----------------------------------------------------------------------------
 // * Function: decamutexoff()
@@ -620,7 +1242,7 @@ void decamutexoff(decaIrqStatus_t j)
 {
     if(j)
     {
-        NVIC_EnableIRQ((IRQn_Type)DW1000_IRQ);
+        NVIC_EnableIRQ(GPIOTE_IRQn);
     }
 }
 
@@ -51,7 +51,7 @@ precision when performing range measurements.
 
 /**< max number of test bytes to be used for tx and rx. */
 #define MAX_TEST_DATA_BYTES     (15U)
-#define UART_TX_BUF_SIZE         256          /**< UART TX buffer size. */
+#define UART_TX_BUF_SIZE         2048         /**< UART TX ring size, must be power of 2. */
 #define UART_RX_BUF_SIZE          1           /**< UART RX buffer size. */
 
 /* Default antenna delay values for 64 MHz PRF.*/
@@ -110,6 +110,19 @@ typedef int64_t         int64 ;
 
 typedef bool (* app_wakeup_check_hook_t) (void);
 typedef void (* acc_interrupt_hook_t) (void);
+typedef void (* lp_timer_handler_t) (void);
+
+/* low power timer wake deadlines, see port_lp_timer_start() */
+#define LP_TIMER_SLEEP          0   // end of low_power()
+#define LP_TIMER_APP            1   // free for the application
+#define LP_TIMER_DW_WAKE        2   // DW1000 wake up, port_wakeup_dw1000_at()
+#define LP_TIMER_NUM            3
+
+/* DW1000 wake up from DEEPSLEEP: DW_CS low time and XTAL settle time in ms,
+ * the settle time is the timeout of the wake up interrupt when it is armed */
+#define DW1000_WAKEUP_CS_MS     1
+#define DW1000_WAKEUP_SETTLE_MS 7
+#define DW1000_WAKEUP_TIME_MS   (DW1000_WAKEUP_CS_MS + DW1000_WAKEUP_SETTLE_MS)
 
 #ifndef FALSE
 #define FALSE               0
@@ -133,8 +146,14 @@ typedef enum {
 
 void Sleep(uint32_t Delay);
 uint32_t portGetTickCount(void);
+uint32_t portGetLPTickCount(void);
 
 void port_wakeup_dw1000(void);
+void port_wakeup_dw1000_at(uint32_t delay_ms);
+bool port_wakeup_dw1000_done(void);
+void port_wakeup_dw1000_irq_arm(void);
+bool port_wakeup_dw1000_irq_seen(void);
+void port_wakeup_dw1000_irq_clear(void);
 
 /* Function is used for initialize the SPI freq as 2MHz
  * port_set_dw1000_slowrate initialize the SPI freq as 2MHz which does init
@@ -142,20 +161,61 @@ void port_wakeup_dw1000(void);
  */
 void port_set_dw1000_slowrate(void);
 void port_set_dw1000_fastrate(void);
+void port_spi_suspend(void);
+void port_spi_resume(void);
 
 void process_dwRSTn_irq(void);
 void process_deca_irq(void);
+void port_deca_irq_init(void);
 
 void reset_DW1000(void);
 
-int inittestapplication(void);
+/* reason of the last MCU reset, see port_reset_reason() */
+typedef enum {
+    PORT_RESET_POWER_ON = 0,    // power applied, pin reset
+    PORT_RESET_BROWN_OUT,       // supply dip, the RAM was retained
+    PORT_RESET_WARM,            // watchdog, soft reset, lockup
+    PORT_RESET_NUM
+} port_reset_t;
+
+typedef struct {
+    port_reset_t    last;
+    uint32_t        cnt[PORT_RESET_NUM];    // since the power was applied
+} port_reset_info_t;
+
+port_reset_t port_reset_reason(void);
+const port_reset_info_t *port_reset_info(void);
+
+/* DW1000 devices of the board, DWT_NUM_DW_DEV of deca_device_api.h (1 by
+ * default). Device 0 is the radio of the DWM1001 module, a board with a
+ * second DW1000 on the same SPI bus defines DW1000_1_CS_PIN, DW1000_1_IRQ
+ * and DW1000_1_RST. port_dw_select() switches the driver context
+ * (dwt_setlocaldataptr()) and the chip select together, the dwt_* calls
+ * which follow go to that device. The IRQ handler serves every device with
+ * its IRQ line high and then selects back the device of the interrupted
+ * code. The wake up of port_wakeup_dw1000_at() is the one of device 0.
+ */
+int port_dw_select(unsigned int dev);
+unsigned int port_dw_current(void);
+
+int inittestapplication(port_reset_t reset);
 void peripherals_init(void);
 void deca_uart_init(void);
+void deca_uart_open(void);
+void deca_uart_close(void);
+bool deca_uart_tx_busy(void);
+uint16_t deca_uart_tx_free(void);
 uint32_t deca_uart_receive(char * buffer, size_t size);
 void deca_uart_error_handle(app_uart_evt_t * p_event);
 void deca_uart_transmit(char *ptr);
 bool deca_uart_rx_data_ready();
 void low_power(int);
+void port_lp_timer_init(void);
+void port_lp_timer_start(uint8_t id, uint32_t delay_ms, lp_timer_handler_t handler);
+void port_lp_timer_stop(uint8_t id);
+bool port_lp_timer_pending(uint8_t id);
+void port_led_pulse_at(uint32_t pin, uint32_t delay_ms);
+void port_led_pulse_end(uint32_t pin);
 void deca_uart_event_handle(app_uart_evt_t * p_event);
 void RestartUART_timer();
 void port_set_app_wakeup_check_hook(app_wakeup_check_hook_t);
@@ -5,6 +5,8 @@
 * Single threaded version blocks with CPU in
 * sleep mode until TWI transfer complete event
 * occurs.
+* Burst reads can also be started without blocking,
+* the caller is then notified from the TWI interrupt.
 *
 * @file TWI.c
 *
@@ -44,12 +46,22 @@ static const nrf_drv_twi_t m_twi = NRF_DRV_TWI_INSTANCE(TWI_INSTANCE_ID);
 // Semaphore: true if TWI transfer operation has completed
 static volatile bool boTransferDone = false;
 
+// Non-blocking transfer in progress and its completion callback
+static volatile bool boAsyncBusy = false;
+static tpfTWI_Done pfAsyncDone;
+static void *pvAsyncContext;
+
+// Sub address of the read in progress, the driver sends it
+// from this buffer after the call has returned
+static uint8_t u8XferSubAdd;
+
 static ret_code_t twi_err_code;
 
 // *** Local function declarations
-static void vSetSubAdd      (uint8_t u8SubAdd);
+static ret_code_t xStartRead (uint8_t u8subAdd, uint8_t *pu8data, uint8_t u8len);
 static void vEventHandler   (nrf_drv_twi_evt_t const * p_event, void * p_context);
 static void vWaitForEvent   (void);
+static void vWaitForIdle    (void);
 
 // Public Interface Functions
 
@@ -92,6 +104,8 @@ void vTWI_Write (uint8_t u8address, uint8_t u8data)
     au8addData[0] = u8address;
     au8addData[1] = u8data;
 
+    vWaitForIdle();
+
     boTransferDone = false;
     twi_err_code = nrf_drv_twi_tx(&m_twi, LIS2DH_ADD, au8addData, sizeof(au8addData), false);
     APP_ERROR_CHECK(twi_err_code);
@@ -110,36 +124,109 @@ void vTWI_Write (uint8_t u8address, uint8_t u8data)
 */
 void vTWI_Read (uint8_t u8subAdd, uint8_t *pu8readData)
 {
-    vSetSubAdd(u8subAdd);
+    vTWI_ReadBurst(u8subAdd, pu8readData, 1);
+}
+
+/*
+* void vTWI_ReadBurst (uint8_t u8subAdd, uint8_t *pu8data, uint8_t u8len)
+*
+* Reads u8len bytes in a single transfer: the sub address write is
+* followed by a repeated start and the read.
+* The LIS2DH12 only increments the sub address between the bytes
+* if its MSB is set, see AUTO_INCREMENT in LIS2DH12registers.h.
+*
+* Parameters.
+* u8subAdd: LIS2DH12 register read address
+* pu8data: pointer to buffer for u8len bytes
+* u8len: number of bytes to read
+*
+* Returns: void
+*/
+void vTWI_ReadBurst (uint8_t u8subAdd, uint8_t *pu8data, uint8_t u8len)
+{
+    vWaitForIdle();
 
     boTransferDone = false;
-    twi_err_code = nrf_drv_twi_rx(&m_twi, LIS2DH_ADD, pu8readData, 1);
+    twi_err_code = xStartRead(u8subAdd, pu8data, u8len);
     APP_ERROR_CHECK(twi_err_code);
 
     vWaitForEvent();
 }
 
+/*
+* bool boTWI_ReadBurstAsync (uint8_t u8subAdd, uint8_t *pu8data, uint8_t u8len,
+*                            tpfTWI_Done pfDone, void *pvContext)
+*
+* Starts the same transfer as vTWI_ReadBurst() and returns immediately.
+* pfDone is called from the TWI interrupt once the data is in pu8data,
+* which must remain valid until then. The callback may start the next
+* transfer. Blocking calls made in the meantime wait for the completion.
+*
+* Parameters.
+* u8subAdd: LIS2DH12 register read address
+* pu8data: pointer to buffer for u8len bytes
+* u8len: number of bytes to read
+* pfDone: completion callback, can be NULL
+* pvContext: passed to pfDone
+*
+* Returns: false if a transfer is already in progress
+*/
+bool boTWI_ReadBurstAsync (uint8_t u8subAdd, uint8_t *pu8data, uint8_t u8len,
+                           tpfTWI_Done pfDone, void *pvContext)
+{
+    if (boAsyncBusy)
+    {
+        return false;
+    }
+
+    pfAsyncDone = pfDone;
+    pvAsyncContext = pvContext;
+    boAsyncBusy = true;
+
+    if (xStartRead(u8subAdd, pu8data, u8len) != NRF_SUCCESS)
+    {
+        boAsyncBusy = false;
+        return false;
+    }
+
+    return true;
+}
+
+/*
+* bool boTWI_Busy (void)
+*
+* Returns: true while a non-blocking transfer is in progress
+*/
+bool boTWI_Busy (void)
+{
+    return boAsyncBusy;
+}
+
 /* --- Local scope functions */
 
-// Sets sub address for read operation following initial TWI comand write.
-static void vSetSubAdd(uint8_t u8subAdd)
+// Starts a sub address write, repeated start, read transfer.
+static ret_code_t xStartRead (uint8_t u8subAdd, uint8_t *pu8data, uint8_t u8len)
 {
-    boTransferDone = false;
-    twi_err_code = nrf_drv_twi_tx(&m_twi, LIS2DH_ADD, &u8subAdd, 1, false);
-    APP_ERROR_CHECK(twi_err_code);
+    u8XferSubAdd = u8subAdd;
 
-    vWaitForEvent();
+    nrf_drv_twi_xfer_desc_t const tsXfer =
+        NRF_DRV_TWI_XFER_DESC_TXRX(LIS2DH_ADD, &u8XferSubAdd, 1, pu8data, u8len);
+
+    return nrf_drv_twi_xfer(&m_twi, &tsXfer, 0);
 }
 
 /*
 * Interrupt event handler for TWI.
 * Expecting events for read and write transfers complete,
-* anything else is an error condition.
+* a NACK is an error condition which still ends the transfer.
 * Transfer complete sets a semaphore (boTransferDone) to
-* release the MCU from __WFE sleep mode.
+* release the MCU from __WFE sleep mode, or calls the
+* callback of a non-blocking transfer.
 */
 static void vEventHandler(nrf_drv_twi_evt_t const * p_event, void * p_context)
 {
+    bool boOk;
+
     switch (p_event->type)
     {
         case NRF_DRV_TWI_EVT_DONE:
@@ -148,19 +235,43 @@ static void vEventHandler(nrf_drv_twi_evt_t const * p_event, void * p_context)
             {
                 case NRF_DRV_TWI_XFER_TX:
                 case NRF_DRV_TWI_XFER_RX:
+                case NRF_DRV_TWI_XFER_TXRX:
                 {
-                    boTransferDone = true;
+                    boOk = true;
                     break;
                 }
                 default:
                     //printf("unknown xfer_desc.type: %x\n", p_event->xfer_desc.type);
-                    break;
+                    return;
             }
             break;
         }
+        case NRF_DRV_TWI_EVT_ADDRESS_NACK:
+        case NRF_DRV_TWI_EVT_DATA_NACK:
+        {
+            boOk = false;
+            break;
+        }
         default:
             //printf("Unknown event type: %x\n", p_event->type);
-            break;
+            return;
+    }
+
+    if (boAsyncBusy)
+    {
+        tpfTWI_Done pfDone = pfAsyncDone;
+
+        // Free the bus first, the callback may start the next transfer
+        boAsyncBusy = false;
+
+        if (pfDone != NULL)
+        {
+            pfDone(boOk, pvAsyncContext);
+        }
+    }
+    else
+    {
+        boTransferDone = true;
     }
 }
 
@@ -184,3 +295,17 @@ static void vWaitForEvent(void)
     while (! boTransferDone);
 }
 
+/*
+* void vWaitForIdle(void)
+*
+* Blocks, in low-power sleep mode, until the non-blocking
+* transfer in progress (if any) has completed.
+*/
+static void vWaitForIdle(void)
+{
+    while (boAsyncBusy)
+    {
+        __WFE();
+    }
+}
+
@@ -12,7 +12,16 @@
 *  Author: Decawave, 2018
 */
 #include <stdint.h>
+#include <stdbool.h>
+
+// Completion callback of a non-blocking transfer, called from the
+// TWI interrupt. boOk is false if the LIS2DH12 did not acknowledge.
+typedef void (*tpfTWI_Done)(bool boOk, void *pvContext);
 
 void vTWI_Init  (void);
 void vTWI_Write (uint8_t u8address, uint8_t   u8data);
 void vTWI_Read  (uint8_t u8subAdd,  uint8_t *pu8data);
+void vTWI_ReadBurst (uint8_t u8subAdd, uint8_t *pu8data, uint8_t u8len);
+bool boTWI_ReadBurstAsync (uint8_t u8subAdd, uint8_t *pu8data, uint8_t u8len,
+                           tpfTWI_Done pfDone, void *pvContext);
+bool boTWI_Busy (void);
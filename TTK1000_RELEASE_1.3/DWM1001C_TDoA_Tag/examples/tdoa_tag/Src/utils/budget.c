@@ -0,0 +1,257 @@
+/*
+ * @file       budget.c
+ *
+ * @brief      battery and temperature aware blink budget
+ *
+ *             The DW1000 vbat is sampled every BUDGET_SAMPLE_MS while the
+ *             blink is prepared and smoothed. A cold cell sags, so the
+ *             samples are compensated by BUDGET_TEMPCO_MV per deg C below
+ *             BUDGET_TEMP_REF_C, a warm up is not taken for a recharge.
+ *
+ *             Every BUDGET_TREND_MS the smoothed vbat is kept as a trend
+ *             checkpoint. The drain (mV/h) is measured over the last
+ *             BUDGET_TREND_N checkpoints and gives the runtime left down to
+ *             BUDGET_EMPTY at the current blink rate.
+ *
+ *             While the elapsed time is below the target runtime (BUDGET,
+ *             in minutes) the stretch is moved half way to
+ *                  stretch * runtime to go / runtime left
+ *             and clamped to 1..BUDGETMAX. The stretch scales the blink
+ *             interval and the downlink period (in blinks, so the downlink
+ *             listen duty falls with the square of the stretch: the receiver
+ *             costs more than the blink). From BUDGET_LEAN_STRETCH on only
+ *             the battery is kept in the telemetry payload.
+ *
+ *             The time base is the RTC, the SysTick is stopped in sleep.
+ *
+ * @author     Decawave Software
+ *
+ * @attention  Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *             All rights reserved.
+ */
+
+#include "port_platform.h"
+#include "deca_device_api.h"
+#include "pckt_ieee.h"
+#include "tvc.h"
+#include "budget.h"
+
+/* vbat sample period, the samples are smoothed by 1/2^BUDGET_EMA_SHIFT */
+#define BUDGET_SAMPLE_MS            10000
+#define BUDGET_EMA_SHIFT            3
+/* trend checkpoints, the drain is measured over up to 30 minutes */
+#define BUDGET_TREND_MS             300000
+#define BUDGET_TREND_N              6
+/* cell voltage sag in the cold, mV per deg C below BUDGET_TEMP_REF_C */
+#define BUDGET_TEMPCO_MV            2
+#define BUDGET_TEMP_REF_C           20
+/* from this stretch on only the battery is sent in the blink payload */
+#define BUDGET_LEAN_STRETCH         (2 * BUDGET_STRETCH_ONE)
+
+static budget_state_t bs = { .stretch = BUDGET_STRETCH_ONE, .remain_min = BUDGET_REMAIN_NONE };
+
+static uint32_t bs_start_ms;
+static uint32_t bs_sample_ms;
+static uint8_t  bs_sampled;
+static int32_t  bs_vbat_q4;     /* smoothed vbat, 1/16 mV */
+
+/* trend checkpoints, ring of the last BUDGET_TREND_N */
+static struct {
+    uint32_t    t_ms;
+    uint16_t    vbat_mv;
+}bs_trend[BUDGET_TREND_N];
+static uint8_t  bs_trend_cnt;
+static uint8_t  bs_trend_next;
+static uint32_t bs_trend_ms;
+
+/*
+ * @fn      budget_vbat_mv
+ * @brief   vbat in mV of the raw SAR values, compensated for the cold sag
+ * */
+static int32_t budget_vbat_mv(uint8_t raw_temp, uint8_t raw_vbat)
+{
+    int32_t mv = (int32_t)(dwt_convertrawvoltage(raw_vbat) * 1000);
+
+    bs.temp_c = (int16_t)dwt_convertrawtemperature(raw_temp);
+
+    if(bs.temp_c < BUDGET_TEMP_REF_C)
+    {
+        mv += BUDGET_TEMPCO_MV * (BUDGET_TEMP_REF_C - bs.temp_c);
+    }
+
+    return ((mv < 0) ? (0) : (mv));
+}
+
+/*
+ * @fn      budget_update
+ * @brief   add a trend checkpoint, update the drain, the runtime left and
+ *          the stretch
+ * */
+static void budget_update(param_block_t *pbss, uint32_t now)
+{
+    uint32_t target = pbss->budget.runtime_min;
+    uint32_t max = ((pbss->budget.stretch_max > 1) ? (pbss->budget.stretch_max) : (1)) \
+                   * BUDGET_STRETCH_ONE;
+    uint32_t want;
+    int32_t  margin;
+    int      oldest;
+
+    bs_trend[bs_trend_next].t_ms = now;
+    bs_trend[bs_trend_next].vbat_mv = bs.vbat_mv;
+    bs_trend_next = (bs_trend_next + 1) % BUDGET_TREND_N;
+    if(bs_trend_cnt < BUDGET_TREND_N)
+    {
+        bs_trend_cnt++;
+    }
+
+    if(bs_trend_cnt < 2)
+    {
+        return;
+    }
+
+    oldest = (bs_trend_cnt < BUDGET_TREND_N) ? (0) : (bs_trend_next);
+    bs.slope_mvh = (int32_t)(((int64_t)bs_trend[oldest].vbat_mv - bs.vbat_mv) * 3600000 \
+                             / (now - bs_trend[oldest].t_ms));
+
+    margin = (int32_t)bs.vbat_mv - pbss->budget.vbat_empty_mv;
+    if(margin <= 0)
+    {
+        bs.remain_min = 0;
+    }
+    else if(bs.slope_mvh > 0)
+    {
+        bs.remain_min = (uint32_t)margin * 60 / bs.slope_mvh;
+    }
+    else
+    {
+        bs.remain_min = BUDGET_REMAIN_NONE;
+    }
+
+    if((target == 0) || (bs.elapsed_min >= target))
+    {
+        /* no target or the event is over */
+        bs.stretch = BUDGET_STRETCH_ONE;
+        return;
+    }
+
+    if(bs.remain_min == BUDGET_REMAIN_NONE)
+    {
+        return;
+    }
+
+    if(bs.remain_min == 0)
+    {
+        want = max;
+    }
+    else
+    {
+        want = (uint32_t)(((uint64_t)bs.stretch * (target - bs.elapsed_min)) / bs.remain_min);
+    }
+
+    want = (want < BUDGET_STRETCH_ONE) ? (BUDGET_STRETCH_ONE) : ((want > max) ? (max) : (want));
+
+    bs.stretch = (uint16_t)((bs.stretch + want + 1) / 2);
+}
+
+/**
+ * @fn      budget_start
+ * @brief   restart the budget clock and the trend
+ * */
+void budget_start(void)
+{
+    memset(&bs, 0, sizeof(bs));
+    bs.stretch = BUDGET_STRETCH_ONE;
+    bs.remain_min = BUDGET_REMAIN_NONE;
+
+    bs_start_ms = portGetLPTickCount();
+    bs_sampled = 0;
+    bs_trend_cnt = 0;
+    bs_trend_next = 0;
+}
+
+/**
+ * @fn      budget_blink
+ * @brief   sample vbat / temp, every BUDGET_SAMPLE_MS
+ * */
+void budget_blink(param_block_t *pbss, int slept)
+{
+    uint32_t now = portGetLPTickCount();
+    uint8_t  temp, vbat;
+    int32_t  mv;
+
+    bs.elapsed_min = (now - bs_start_ms) / 60000;
+
+    if(bs_sampled && ((now - bs_sample_ms) < BUDGET_SAMPLE_MS))
+    {
+        return;
+    }
+
+    if(slept)
+    {
+        temp = dwt_readwakeuptemp();
+        vbat = dwt_readwakeupvbat();
+    }
+    else if(!tvc_last_sample(&temp, &vbat))
+    {
+        return;
+    }
+
+    mv = budget_vbat_mv(temp, vbat);
+
+    if(!bs_sampled)
+    {
+        bs_vbat_q4 = mv << 4;
+        bs_trend_ms = now;
+        bs_sampled = 1;
+    }
+    else
+    {
+        bs_vbat_q4 += ((mv << 4) - bs_vbat_q4) / (1 << BUDGET_EMA_SHIFT);
+    }
+    bs_sample_ms = now;
+    bs.vbat_mv = (uint16_t)(bs_vbat_q4 >> 4);
+
+    if((now - bs_trend_ms) >= BUDGET_TREND_MS)
+    {
+        bs_trend_ms = now;
+        budget_update(pbss, now);
+    }
+
+    bs.lean = (bs.stretch >= BUDGET_LEAN_STRETCH);
+}
+
+/**
+ * @fn      budget_interval
+ * @brief   stretched blink interval
+ * */
+uint32_t budget_interval(uint32_t interval_ms)
+{
+    return (uint32_t)(((uint64_t)interval_ms * bs.stretch) / BUDGET_STRETCH_ONE);
+}
+
+/**
+ * @fn      budget_dl_period
+ * @brief   stretched downlink period, in blinks
+ * */
+uint32_t budget_dl_period(uint8_t period)
+{
+    return ((uint32_t)period * bs.stretch) / BUDGET_STRETCH_ONE;
+}
+
+/**
+ * @fn      budget_dwp
+ * @brief   telemetry fields, only the battery when lean
+ * */
+uint8_t budget_dwp(uint8_t dwp)
+{
+    return ((bs.lean) ? (dwp & IMU_DWP_BAT) : (dwp));
+}
+
+/**
+ * @fn      budget_state
+ * @brief   state of the BUDGETSTAT report
+ * */
+const budget_state_t *budget_state(void)
+{
+    return (&bs);
+}
@@ -0,0 +1,78 @@
+/*
+ * @file       budget.h
+ *
+ * @brief      battery and temperature aware blink budget
+ *
+ * @author     Decawave Software
+ *
+ * @attention  Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *             All rights reserved.
+ */
+
+#ifndef _BUDGET_H_
+#define _BUDGET_H_ 1
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "default_config.h"
+
+/* stretch of the blink interval in 1/BUDGET_STRETCH_ONE */
+#define BUDGET_STRETCH_ONE          16
+/* remain_min while no drain was measured */
+#define BUDGET_REMAIN_NONE          0xFFFFFFFFUL
+
+typedef struct {
+    uint32_t    elapsed_min;    /* since budget_start() */
+    uint32_t    remain_min;     /* estimated battery runtime at the current stretch */
+    int32_t     slope_mvh;      /* vbat drain in mV per hour, temperature compensated */
+    uint16_t    vbat_mv;        /* smoothed vbat, temperature compensated */
+    int16_t     temp_c;         /* DW1000 temperature of the last sample */
+    uint16_t    stretch;        /* 1/BUDGET_STRETCH_ONE */
+    uint8_t     lean;           /* telemetry reduced to the battery */
+}budget_state_t;
+
+/**
+ * Start (restart) the budget clock, the target runtime BUDGET is counted
+ * from here. The trend is cleared and the interval is not stretched until
+ * it is known.
+ *
+ * @return none
+ */
+void budget_start(void);
+
+/**
+ * Sample the DW1000 vbat and temperature for the trend, called with the
+ * DW1000 awake while the blink is prepared. The SAR is not read here: the
+ * last compensation sample of tvc_comp() is used, or the wakeup values when
+ * the DW1000 slept before the blink.
+ *
+ * @param[in] pbss  : configuration (budget settings)
+ * @param[in] slept : the DW1000 woke up for this blink (DWT_TANDV values valid)
+ * @return none
+ */
+void budget_blink(param_block_t *pbss, int slept);
+
+/**
+ * Scale the blink interval, the downlink period and the telemetry fields
+ * with the current stretch
+ *
+ * @return the interval in ms, the period in blinks, the IMU_DWP_xx fields
+ */
+uint32_t budget_interval(uint32_t interval_ms);
+uint32_t budget_dl_period(uint8_t period);
+uint8_t budget_dwp(uint8_t dwp);
+
+/**
+ * Return the budget state for the BUDGETSTAT report
+ *
+ * @return state, updated by budget_blink()
+ */
+const budget_state_t *budget_state(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BUDGET_H_ */
@@ -0,0 +1,32 @@
+/*
+ * @file       crc16.c
+ *
+ * @brief      CRC-16/CCITT (poly 0x1021), bitwise: the tag only checks
+ *             configuration frames and records, which are short
+ *
+ * @author     Decawave Software
+ *
+ * @attention  Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *             All rights reserved.
+ */
+
+#include "crc16.h"
+
+/**
+ * @fn      crc16_ccitt
+ * @brief   CRC-16/CCITT of a buffer
+ * */
+uint16_t crc16_ccitt(uint16_t crc, const uint8_t *p, uint16_t len)
+{
+    int i;
+
+    while(len--)
+    {
+        crc ^= (uint16_t)(*p++) << 8;
+        for(i = 0; i < 8; i++)
+        {
+            crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+        }
+    }
+    return crc;
+}
@@ -0,0 +1,38 @@
+/*
+ * @file       crc16.h
+ *
+ * @brief      CRC-16/CCITT (poly 0x1021)
+ *
+ * @author     Decawave Software
+ *
+ * @attention  Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *             All rights reserved.
+ */
+
+#ifndef _CRC16_H_
+#define _CRC16_H_ 1
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define CRC16_INIT              (0xFFFF)
+
+/**
+ * CRC-16/CCITT of a buffer, seeded with the CRC of the previous
+ * part for data in several pieces
+ *
+ * @param[in] crc : CRC16_INIT or the CRC of the previous part
+ * @param[in] p   : data
+ * @param[in] len : length of the data
+ * @return the CRC
+ */
+uint16_t crc16_ccitt(uint16_t crc, const uint8_t *p, uint16_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CRC16_H_ */
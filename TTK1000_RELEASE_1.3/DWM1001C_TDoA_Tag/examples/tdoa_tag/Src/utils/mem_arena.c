@@ -0,0 +1,108 @@
+/*
+ * @file       mem_arena.c
+ *
+ * @brief      static arena of the UART, command and SPI buffers, with their
+ *             high water marks and the one of the stack
+ *
+ *             The stack is painted from __StackLimit (flash_placement.xml)
+ *             up to a little below the stack pointer of mem_arena_init(),
+ *             its mark is the deepest byte written since.
+ *
+ * @author     Decawave Software
+ *
+ * @attention  Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *             All rights reserved.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "mem_arena.h"
+
+#define MEM_PAINT_BYTE              (0xA5)
+/* stack of mem_arena_init() itself, not painted */
+#define MEM_STACK_MARGIN            (64)
+
+#define MEM_REGION_INFO(id, size, name, mark)      { name, (size), offsetof(mem_arena_t, id##_buf), (mark) },
+
+/* the arena does not fit into its budget */
+typedef char mem_arena_budget_check[(sizeof(mem_arena_t) <= MEM_ARENA_BUDGET) ? (1) : (-1)];
+
+typedef struct {
+    const char  *name;
+    uint16_t    size;
+    uint16_t    offset;         /* in the arena */
+    uint8_t     mark;
+}mem_region_t;
+
+static const mem_region_t mem_regions[MEM_REGION_NUM] = {
+    MEM_ARENA_REGIONS(MEM_REGION_INFO)
+};
+
+mem_arena_t mem_arena __attribute__((aligned(4)));
+
+static uint16_t mem_hwm[MEM_REGION_NUM];
+
+extern uint8_t __StackLimit[];
+extern uint8_t __StackTop[];
+
+/*
+ * @brief offset of the first byte not painted, from the end of the buffer
+ * */
+static uint32_t mem_painted_hwm(const uint8_t *p, uint32_t size)
+{
+    while((size > 0) && (p[size - 1] == MEM_PAINT_BYTE))
+    {
+        size--;
+    }
+    return size;
+}
+
+#define mem_region_start(id)        ((uint8_t *)&mem_arena + mem_regions[id].offset)
+
+void mem_arena_init(void)
+{
+    volatile uint8_t sp;
+    int i;
+
+    for(i = 0; i < MEM_REGION_NUM; i++)
+    {
+        if(mem_regions[i].mark == MEM_PAINT)
+        {
+            memset(mem_region_start(i), MEM_PAINT_BYTE, mem_regions[i].size);
+        }
+    }
+
+    if((uint8_t *)&sp - MEM_STACK_MARGIN > __StackLimit)
+    {
+        memset(__StackLimit, MEM_PAINT_BYTE, (uint8_t *)&sp - MEM_STACK_MARGIN - __StackLimit);
+    }
+}
+
+void mem_arena_mark(int id, uint32_t used)
+{
+    if(used > mem_hwm[id])
+    {
+        mem_hwm[id] = (uint16_t)MIN(used, mem_regions[id].size);
+    }
+}
+
+void mem_arena_info(int id, mem_region_info_t *info)
+{
+    info->name = mem_regions[id].name;
+    info->size = mem_regions[id].size;
+    info->hwm = (mem_regions[id].mark == MEM_PAINT) ?
+                (uint16_t)mem_painted_hwm(mem_region_start(id), mem_regions[id].size) : (mem_hwm[id]);
+}
+
+void mem_stack_info(mem_region_info_t *info)
+{
+    const uint8_t *p = __StackLimit;
+
+    while((p < __StackTop) && (*p == MEM_PAINT_BYTE))
+    {
+        p++;
+    }
+    info->name = "STACK";
+    info->size = (uint16_t)(__StackTop - __StackLimit);
+    info->hwm = (uint16_t)(__StackTop - p);
+}
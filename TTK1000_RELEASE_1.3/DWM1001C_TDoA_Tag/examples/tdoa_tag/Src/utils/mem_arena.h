@@ -0,0 +1,128 @@
+/*
+ * @file       mem_arena.h
+ *
+ * @brief      static arena of the UART, command and SPI buffers, with their
+ *             high water marks and the one of the stack
+ *
+ *             The buffers are regions of one statically sized arena, listed
+ *             in MEM_ARENA_REGIONS, so the RAM they take is known at build
+ *             time: the build fails if it exceeds MEM_ARENA_BUDGET. The MEM
+ *             command reports the size and the high water mark of every
+ *             region and of the stack.
+ *
+ *             A MEM_PAINT region is painted by mem_arena_init(), its mark is
+ *             the last byte written. A MEM_MARK region (rings, buffers
+ *             cleared before use) is marked by its owner with
+ *             mem_arena_mark().
+ *
+ * @author     Decawave Software
+ *
+ * @attention  Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *             All rights reserved.
+ */
+
+#ifndef _MEM_ARENA_H_
+#define _MEM_ARENA_H_ 1
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+#include "port_platform.h"
+#include "cmd_bin.h"
+#include "config.h"
+#ifdef TDoA_TAG
+#include "cmd_uart_rx.h"
+#endif
+
+/* RAM of the arena, the build fails beyond it */
+#ifndef MEM_ARENA_BUDGET
+#define MEM_ARENA_BUDGET            (4096)
+#endif
+
+#define MEM_PAINT                   0
+#define MEM_MARK                    1
+
+/* id, size, name of the report, mark */
+#ifdef TDoA_TAG
+#define MEM_ARENA_APP_REGIONS(X) \
+    X(MEM_CMD_EDIT,   COM_RX_BUF_SIZE,          "CMDEDIT",   MEM_MARK)  /* cmd_uart_rx.c line being typed */ \
+    X(MEM_CMD_LINE,   COM_RX_BUF_SIZE,          "CMDLINE",   MEM_MARK)  /* cmd_uart_rx.c line to parse */    \
+    X(MEM_CMD_STR,    MAX_STR_SIZE,             "CMDSTR",    MEM_PAINT) /* text answers of cmd.c, cmd_fn.c */
+#else
+#define MEM_ARENA_APP_REGIONS(X)
+#endif
+
+#define MEM_ARENA_REGIONS(X) \
+    X(MEM_UART_RX,    RX_BUF_SIZE,              "UARTRX",    MEM_MARK)  /* deca_uart.c RX FIFO */             \
+    X(MEM_UART_TX,    UART_TX_BUF_SIZE,         "UARTTX",    MEM_MARK)  /* deca_uart.c TX ring */             \
+    X(MEM_UART_MSG,   CMD_BIN_FRAME_MAX + 2,    "UARTMSG",   MEM_MARK)  /* message read from the RX FIFO */   \
+    X(MEM_CMD_BIN,    CMD_BIN_FRAME_MAX,        "CMDBIN",    MEM_MARK)  /* cmd_bin.c answer */                \
+    X(MEM_SPI_BOUNCE, DATALEN1,                 "SPIBOUNCE", MEM_MARK)  /* port_platform.c flash to DMA */    \
+    MEM_ARENA_APP_REGIONS(X)
+
+#define MEM_ALIGN(size)             (((size) + 3) & ~3)
+
+#define MEM_REGION_ID(id, size, name, mark)        id,
+#define MEM_REGION_MEMBER(id, size, name, mark)    uint8_t id##_buf[MEM_ALIGN(size)];
+
+enum {
+    MEM_ARENA_REGIONS(MEM_REGION_ID)
+    MEM_REGION_NUM
+};
+
+typedef struct {
+    MEM_ARENA_REGIONS(MEM_REGION_MEMBER)
+} mem_arena_t;
+
+extern mem_arena_t mem_arena;
+
+/* buffer and size of a region */
+#define MEM_ARENA(id)               ((void *)mem_arena.id##_buf)
+#define MEM_ARENA_SIZE(id)          (sizeof(mem_arena.id##_buf))
+
+typedef struct {
+    const char  *name;
+    uint16_t    size;
+    uint16_t    hwm;            /* bytes, the size if it was full */
+}mem_region_info_t;
+
+/**
+ * Paint the MEM_PAINT regions and the free stack, first thing in main()
+ *
+ * @return none
+ */
+void mem_arena_init(void);
+
+/**
+ * High water mark of a MEM_MARK region, IRQ context allowed
+ *
+ * @param[in] id   : MEM_xx
+ * @param[in] used : bytes in use
+ * @return none
+ */
+void mem_arena_mark(int id, uint32_t used);
+
+/**
+ * Size and high water mark of a region
+ *
+ * @param[in] id    : MEM_xx
+ * @param[out] info
+ * @return none
+ */
+void mem_arena_info(int id, mem_region_info_t *info);
+
+/**
+ * Size and high water mark of the stack
+ *
+ * @param[out] info
+ * @return none
+ */
+void mem_stack_info(mem_region_info_t *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MEM_ARENA_H_ */
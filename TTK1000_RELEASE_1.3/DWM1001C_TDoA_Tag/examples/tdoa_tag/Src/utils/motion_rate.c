@@ -0,0 +1,282 @@
+/*
+ * @file       motion_rate.c
+ *
+ * @brief      motion proportional blink rate
+ *
+ *             While the tag moves, the LIS2DH12 streams X,Y,Z samples into
+ *             its FIFO and raises the watermark interrupt once per batch.
+ *             The motion intensity of a batch is the sum over the axes of
+ *             the mean absolute deviation from the batch mean (in mg) so the
+ *             gravity and the orientation of the tag do not count. It rises
+ *             immediately and decays over a few batches.
+ *
+ *             The blink rate (not the interval) is interpolated linearly
+ *             between 1/interval_move_ms at intensity_lo_mg and
+ *             1/interval_in_ms at intensity_hi_mg. When the intensity stayed
+ *             below intensity_lo_mg for MOTION_RATE_STILL_BATCHES the tag
+ *             blinks at interval_slow_in_ms and the accelerometer goes back
+ *             to the low power wake-up detection.
+ *
+ *             The FIFO is drained from the TWI interrupt (boLIS2_ReadFifoAsync)
+ *             and the batch is processed by the next motion_rate_task() call,
+ *             the MCU does not wait for the transfer.
+ *
+ * @author     Decawave Software
+ *
+ * @attention  Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *             All rights reserved.
+ */
+
+#include "port_platform.h"
+#include "LIS2DH12.h"
+#include "LIS2DH12registers.h"
+#include "motion_rate.h"
+
+/* accelerometer FIFO batch: 16 samples at 50Hz, i.e. every 320ms */
+#define MOTION_RATE_ODR             ODR_50Hz
+#define MOTION_RATE_BATCH           16
+/* number of still batches (~3s) before going back to wake-up detection */
+#define MOTION_RATE_STILL_BATCHES   10
+/* decay of the intensity, 1/2^MOTION_RATE_DECAY_SHIFT per batch */
+#define MOTION_RATE_DECAY_SHIFT     2
+
+#ifndef ABS
+#define ABS(x)          (((x) < 0) ? (-(x)) : (x))
+#endif /* ABS */
+
+#ifndef MIN
+#define MIN(a,b)        (((a) < (b)) ? (a) : (b))
+#endif /* MIN */
+
+#ifndef MAX
+#define MAX(a,b)        (((a) < (b)) ? (b) : (a))
+#endif /* MAX */
+
+enum mr_states
+{
+    MR_WAKEUP,      // accelerometer in wake-up detection
+    MR_FIFO         // accelerometer streaming into the FIFO
+};
+
+static int16_t  mr_batch[MAX_FIFO_SIZE][3];
+static uint8_t  mr_state = MR_WAKEUP;
+static uint8_t  mr_still_cnt;
+static uint16_t mr_intensity;
+
+/* FIFO drain into mr_batch, completed from the TWI interrupt */
+static volatile uint8_t mr_drain_done;
+static volatile uint8_t mr_drain_n;
+
+/* newest sample of the last processed batch */
+static int16_t  mr_last[3];
+static uint8_t  mr_last_valid;
+
+/*
+ * @fn      motion_rate_batch_intensity
+ * @brief   sum of the mean absolute deviation of the axes, in mg
+ * */
+static uint16_t motion_rate_batch_intensity(int16_t xyz[][3], uint8_t n)
+{
+    int32_t  mean;
+    uint32_t dev;
+    uint32_t intensity = 0;
+    int      axis, i;
+
+    for(axis = 0; axis < 3; axis++)
+    {
+        mean = 0;
+        for(i = 0; i < n; i++)
+        {
+            mean += xyz[i][axis];
+        }
+        mean /= n;
+
+        dev = 0;
+        for(i = 0; i < n; i++)
+        {
+            dev += ABS(xyz[i][axis] - mean);
+        }
+        intensity += dev / n;
+    }
+
+    return (uint16_t)MIN(intensity, 0xFFFF);
+}
+
+/*
+ * @fn      motion_rate_interval
+ * @brief   blink interval for the intensity, the rate is linear in the
+ *          intensity between the configured bounds
+ * */
+static uint32_t motion_rate_interval(param_block_t *pbss, uint16_t intensity)
+{
+    uint32_t fast = MAX(pbss->blink.interval_in_ms, 1);
+    uint32_t move = MAX(pbss->motion.interval_move_ms, fast);
+    uint16_t lo = pbss->motion.intensity_lo_mg;
+    uint16_t hi = pbss->motion.intensity_hi_mg;
+    uint32_t rate_lo, rate_hi, rate;
+
+    if(intensity <= lo)
+    {
+        return move;
+    }
+    if((intensity >= hi) || (hi <= lo))
+    {
+        return fast;
+    }
+
+    /* rates in mHz */
+    rate_lo = 1000000UL / move;
+    rate_hi = 1000000UL / fast;
+    rate = rate_lo + (uint32_t)(((uint64_t)(rate_hi - rate_lo) * (intensity - lo)) / (hi - lo));
+
+    return 1000000UL / rate;
+}
+
+/*
+ * @fn      motion_rate_fifo_done
+ * @brief   completion of the FIFO drain, TWI interrupt context
+ * */
+static void motion_rate_fifo_done(uint8_t n)
+{
+    mr_drain_n = n;
+    mr_drain_done = 1;
+}
+
+/*
+ * @fn      motion_rate_batch
+ * @brief   update the intensity and the blink interval from a batch
+ * */
+static int motion_rate_batch(param_block_t *pbss, uint8_t n, uint32_t *interval_ms)
+{
+    uint16_t intensity;
+
+    if(n < 2)
+    {
+        return 1;
+    }
+
+    memcpy(mr_last, mr_batch[n - 1], sizeof(mr_last));
+    mr_last_valid = 1;
+
+    intensity = motion_rate_batch_intensity(mr_batch, n);
+
+    /* fast attack, slow decay */
+    if(intensity >= mr_intensity)
+    {
+        mr_intensity = intensity;
+    }
+    else
+    {
+        mr_intensity -= (mr_intensity - intensity + (1 << MOTION_RATE_DECAY_SHIFT) - 1) \
+                        >> MOTION_RATE_DECAY_SHIFT;
+    }
+
+    if(mr_intensity < pbss->motion.intensity_lo_mg)
+    {
+        if(++mr_still_cnt >= MOTION_RATE_STILL_BATCHES)
+        {
+            motion_rate_stop();
+            *interval_ms = pbss->blink.interval_slow_in_ms;
+            return 0;
+        }
+    }
+    else
+    {
+        mr_still_cnt = 0;
+    }
+
+    *interval_ms = motion_rate_interval(pbss, mr_intensity);
+
+    return 1;
+}
+
+/**
+ * @fn      motion_rate_start
+ * @brief   start FIFO streaming, the tag is assumed to be moving
+ * */
+void motion_rate_start(param_block_t *pbss)
+{
+    vLIS2_EnableFifoSampling(MOTION_RATE_ODR, MOTION_RATE_BATCH);
+
+    /* a drain of the previous batch has completed by now */
+    mr_state = MR_FIFO;
+    mr_drain_done = 0;
+    mr_last_valid = 0;
+    mr_still_cnt = 0;
+    mr_intensity = pbss->motion.intensity_lo_mg;
+}
+
+/**
+ * @fn      motion_rate_stop
+ * @brief   back to the low power wake-up detection
+ * */
+void motion_rate_stop(void)
+{
+    vLIS2_EnableWakeUpDetect();
+
+    mr_state = MR_WAKEUP;
+    mr_drain_done = 0;
+    mr_last_valid = 0;
+    mr_intensity = 0;
+}
+
+/**
+ * @fn      motion_rate_task
+ * @brief   process the accelerometer interrupt and update the blink interval
+ * */
+int motion_rate_task(param_block_t *pbss, uint32_t *interval_ms)
+{
+    if((mr_state == MR_FIFO) && mr_drain_done)
+    {
+        mr_drain_done = 0;
+        return motion_rate_batch(pbss, mr_drain_n, interval_ms);
+    }
+
+    if(!boLIS2_InterruptOccurred())
+    {
+        return (mr_state == MR_FIFO);
+    }
+    boLIS2_InterruptClear();
+
+    if(mr_state == MR_WAKEUP)
+    {
+        if(u8LIS2_EventStatus() & (XHIE | YHIE | ZHIE))
+        {
+            motion_rate_start(pbss);
+            *interval_ms = motion_rate_interval(pbss, mr_intensity);
+        }
+        return (mr_state == MR_FIFO);
+    }
+
+    /* drain the FIFO in the background, if a drain is still running the
+     * samples it leaves behind raise the watermark interrupt again */
+    boLIS2_ReadFifoAsync(mr_batch, MAX_FIFO_SIZE, motion_rate_fifo_done);
+
+    return 1;
+}
+
+/**
+ * @fn      motion_rate_pending
+ * @brief   a drained batch waits for motion_rate_task()
+ * */
+int motion_rate_pending(void)
+{
+    return (mr_state == MR_FIFO) && mr_drain_done;
+}
+
+/**
+ * @fn      motion_rate_last_xyz
+ * @brief   newest sample of the last FIFO batch, reading the output
+ *          registers directly would take samples out of the FIFO
+ * */
+int motion_rate_last_xyz(int16_t xyz[3])
+{
+    if((mr_state != MR_FIFO) || !mr_last_valid)
+    {
+        return 0;
+    }
+
+    memcpy(xyz, mr_last, sizeof(mr_last));
+
+    return 1;
+}
@@ -0,0 +1,70 @@
+/*
+ * @file       motion_rate.h
+ *
+ * @brief      motion proportional blink rate
+ *
+ * @author     Decawave Software
+ *
+ * @attention  Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *             All rights reserved.
+ */
+
+#ifndef _MOTION_RATE_H_
+#define _MOTION_RATE_H_ 1
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "default_config.h"
+
+/**
+ * Start the motion proportional blink rate. Puts the accelerometer into
+ * FIFO streaming and assumes the tag is moving.
+ *
+ * @param[in] pbss : configuration (blink and motion settings)
+ * @return none
+ */
+void motion_rate_start(param_block_t *pbss);
+
+/**
+ * Stop the motion proportional blink rate, the accelerometer is put back
+ * into wake-up detection.
+ *
+ * @return none
+ */
+void motion_rate_stop(void);
+
+/**
+ * Process the accelerometer interrupt: read the FIFO batch, update the
+ * motion intensity and the blink interval.
+ *
+ * @param[in]  pbss        : configuration (blink and motion settings)
+ * @param[out] interval_ms : updated blink interval, unchanged if there was
+ *                           no new batch
+ * @return 1 while the tag is moving, 0 when it is still
+ */
+int motion_rate_task(param_block_t *pbss, uint32_t *interval_ms);
+
+/**
+ * Check whether a FIFO batch has been read in the background and waits
+ * for motion_rate_task(), i.e. the MCU should not go back to sleep.
+ *
+ * @return 1 if motion_rate_task() has a batch to process
+ */
+int motion_rate_pending(void);
+
+/**
+ * Return the newest accelerometer sample while the accelerometer streams
+ * into the FIFO (the output registers must not be read then)
+ *
+ * @param[out] xyz : X,Y,Z in mg
+ * @return 1 if xyz is valid, 0 if the FIFO is not used
+ */
+int motion_rate_last_xyz(int16_t xyz[3]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MOTION_RATE_H_ */
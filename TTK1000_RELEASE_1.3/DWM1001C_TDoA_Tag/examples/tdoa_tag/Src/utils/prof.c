@@ -0,0 +1,116 @@
+/*
+ * @file       prof.c
+ *
+ * @brief      hot path profiler based on the Cortex-M4 DWT cycle counter
+ *
+ * @author     Decawave Software
+ *
+ * @attention  Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *             All rights reserved.
+ */
+
+#include "prof.h"
+
+#if PROF_ENABLE == 1
+
+#include <string.h>
+#include "nrf.h"
+
+static prof_entry_t prof_table[PROF_NUM];
+
+static const char * const prof_names[PROF_NUM] = {
+    "WAKEUP",
+    "TVC",
+    "FRAME",
+    "TX",
+    "SLEEP",
+    "AWAKE"
+};
+
+/**
+ * @fn      prof_init
+ * @brief   enable the DWT cycle counter and clear the table
+ * */
+void prof_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    prof_reset();
+}
+
+/**
+ * @fn      prof_reset
+ * @brief   clear the statistics of all phases
+ * */
+void prof_reset(void)
+{
+    int i;
+
+    memset(prof_table, 0, sizeof(prof_table));
+    for(i = 0; i < PROF_NUM; i++)
+    {
+        prof_table[i].min = UINT32_MAX;
+    }
+}
+
+/**
+ * @fn      prof_start
+ * @brief   mark the start of a phase
+ * */
+void prof_start(prof_phase_e id)
+{
+    prof_table[id].start = DWT->CYCCNT;
+    prof_table[id].running = 1;
+}
+
+/**
+ * @fn      prof_stop
+ * @brief   account the cycles since prof_start(), ignored if the phase
+ *          was not started (e.g. no sleep before the first blink)
+ * */
+void prof_stop(prof_phase_e id)
+{
+    prof_entry_t *e = &prof_table[id];
+    uint32_t cycles;
+
+    if(!e->running)
+    {
+        return;
+    }
+
+    cycles = DWT->CYCCNT - e->start;   // wraps after 67s at 64MHz
+    e->running = 0;
+
+    e->count++;
+    e->sum += cycles;
+    if(cycles < e->min)
+    {
+        e->min = cycles;
+    }
+    if(cycles > e->max)
+    {
+        e->max = cycles;
+    }
+}
+
+/**
+ * @fn      prof_get
+ * @brief   statistics of a phase
+ * */
+const prof_entry_t *prof_get(prof_phase_e id)
+{
+    return &prof_table[id];
+}
+
+/**
+ * @fn      prof_name
+ * @brief   name of a phase as shown by the PROF command
+ * */
+const char *prof_name(prof_phase_e id)
+{
+    return prof_names[id];
+}
+
+#endif /* PROF_ENABLE */
@@ -0,0 +1,79 @@
+/*
+ * @file       prof.h
+ *
+ * @brief      hot path profiler based on the Cortex-M4 DWT cycle counter
+ *
+ *             Every phase of the tag wake cycle keeps count/min/max/mean of
+ *             its CPU cycles in a fixed RAM table, which is shown with the
+ *             PROF command. The cycle counter does not run while the CPU
+ *             sleeps (WFE/WFI), so the figures are CPU busy time, which is
+ *             what the phase costs from the battery on the MCU side.
+ *
+ *             Set PROF_ENABLE to 1 to build it, with 0 the PROF_xx macros
+ *             and the PROF command compile out.
+ *
+ * @author     Decawave Software
+ *
+ * @attention  Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *             All rights reserved.
+ */
+
+#ifndef _PROF_H_
+#define _PROF_H_ 1
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+
+#ifndef PROF_ENABLE
+#define PROF_ENABLE             0
+#endif
+
+/* profiled phases of the wake cycle */
+typedef enum {
+    PROF_WAKEUP,        // sleep end to DW1000 ready (device id, SPI restore)
+    PROF_TVC,           // tvc_comp() and TX RF configuration
+    PROF_FRAME,         // payload encoding and frame write
+    PROF_TX,            // start of TX to the frame sent event
+    PROF_SLEEP_ENTRY,   // frame sent event to low_power()
+    PROF_AWAKE,         // whole wake cycle, sleep end to next low_power()
+    PROF_NUM
+} prof_phase_e;
+
+typedef struct {
+    uint32_t    count;
+    uint32_t    min;
+    uint32_t    max;
+    uint64_t    sum;
+    uint32_t    start;
+    uint8_t     running;
+} prof_entry_t;
+
+#if PROF_ENABLE == 1
+
+void prof_init(void);
+void prof_reset(void);
+void prof_start(prof_phase_e id);
+void prof_stop(prof_phase_e id);
+const prof_entry_t *prof_get(prof_phase_e id);
+const char *prof_name(prof_phase_e id);
+
+#define PROF_INIT()             prof_init()
+#define PROF_START(id)          prof_start(id)
+#define PROF_STOP(id)           prof_stop(id)
+
+#else
+
+#define PROF_INIT()
+#define PROF_START(id)
+#define PROF_STOP(id)
+
+#endif /* PROF_ENABLE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PROF_H_ */
@@ -0,0 +1,140 @@
+/*
+ * @file       radio_stats.c
+ *
+ * @brief      DW1000 event counters and application frame counters
+ *
+ *             The DW1000 counts the receiver and transmitter events in 12 bit
+ *             registers, cleared by dwt_configeventcounters() and lost when
+ *             the DW1000 sleeps. A snapshot adds them to 32 bit totals and
+ *             clears them, with the SPI taken so that dwt_isr() does not
+ *             access the DW1000 in between (an event between the read and the
+ *             clear is lost).
+ *
+ *             The application counters are kept alongside. Comparing the two
+ *             tells where frames are lost: the RF (PHE, RSL, CRCB, SFDTO are
+ *             collisions or a weak link) or the firmware (CRCG above APP_RX,
+ *             OVER, APP_DROP).
+ *
+ * @author     Decawave Software
+ *
+ * @attention  Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *             All rights reserved.
+ */
+
+#include "port_platform.h"
+#include "deca_device_api.h"
+#include "radio_stats.h"
+
+static volatile uint32 rs_cnt[RADIO_STATS_NUM];
+static uint32 rs_snapshot_ms;
+static uint8  rs_started;
+
+/*
+ * @fn      radio_stats_put32
+ * @brief   little endian 32 bit value
+ * */
+static void radio_stats_put32(uint8 *p, uint32 val)
+{
+    p[0] = (uint8)(val);
+    p[1] = (uint8)(val >> 8);
+    p[2] = (uint8)(val >> 16);
+    p[3] = (uint8)(val >> 24);
+}
+
+/**
+ * @fn      radio_stats_start
+ * @brief   clear and enable the DW1000 event counters
+ * */
+void radio_stats_start(void)
+{
+    dwt_configeventcounters(1);
+
+    if(!rs_started)
+    {
+        rs_started = 1;
+        rs_snapshot_ms = portGetTickCount();
+    }
+}
+
+/**
+ * @fn      radio_stats_snapshot
+ * @brief   add the DW1000 event counters to the totals and clear them
+ * */
+void radio_stats_snapshot(void)
+{
+    dwt_deviceentcnts_t evc;
+    decaIrqStatus_t stat;
+
+    if(!rs_started)
+    {
+        return;
+    }
+
+    stat = decamutexon();
+    dwt_readeventcounters(&evc);
+    dwt_configeventcounters(1);
+    decamutexoff(stat);
+
+    rs_cnt[RADIO_STATS_PHE]   += evc.PHE;
+    rs_cnt[RADIO_STATS_RSL]   += evc.RSL;
+    rs_cnt[RADIO_STATS_CRCG]  += evc.CRCG;
+    rs_cnt[RADIO_STATS_CRCB]  += evc.CRCB;
+    rs_cnt[RADIO_STATS_ARFE]  += evc.ARFE;
+    rs_cnt[RADIO_STATS_OVER]  += evc.OVER;
+    rs_cnt[RADIO_STATS_SFDTO] += evc.SFDTO;
+    rs_cnt[RADIO_STATS_PTO]   += evc.PTO;
+    rs_cnt[RADIO_STATS_RTO]   += evc.RTO;
+    rs_cnt[RADIO_STATS_TXF]   += evc.TXF;
+    rs_cnt[RADIO_STATS_HPW]   += evc.HPW;
+    rs_cnt[RADIO_STATS_TXW]   += evc.TXW;
+
+    rs_snapshot_ms = portGetTickCount();
+}
+
+/**
+ * @fn      radio_stats_run
+ * @brief   periodic snapshot
+ * */
+void radio_stats_run(void)
+{
+    if(rs_started && ((portGetTickCount() - rs_snapshot_ms) >= RADIO_STATS_PERIOD_MS))
+    {
+        radio_stats_snapshot();
+    }
+}
+
+/**
+ * @fn      radio_stats_count
+ * @brief   count an application event
+ * */
+void radio_stats_count(int id)
+{
+    if((id >= RADIO_STATS_APP_TX) && (id < RADIO_STATS_NUM))
+    {
+        rs_cnt[id]++;
+    }
+}
+
+/**
+ * @fn      radio_stats_get
+ * @brief   total of a counter
+ * */
+uint32 radio_stats_get(int id)
+{
+    return ((id >= 0) && (id < RADIO_STATS_NUM)) ? (rs_cnt[id]) : (0);
+}
+
+/**
+ * @fn      radio_stats_pack
+ * @brief   CMD_BIN_STATS report
+ * */
+void radio_stats_pack(uint8 *buf)
+{
+    int i;
+
+    radio_stats_put32(buf, rs_snapshot_ms);
+    for(i = 0; i < RADIO_STATS_NUM; i++)
+    {
+        radio_stats_put32(&buf[4 + 4 * i], rs_cnt[i]);
+    }
+}
@@ -0,0 +1,104 @@
+/*
+ * @file       radio_stats.h
+ *
+ * @brief      DW1000 event counters and application frame counters
+ *
+ * @author     Decawave Software
+ *
+ * @attention  Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *             All rights reserved.
+ */
+
+#ifndef _RADIO_STATS_H_
+#define _RADIO_STATS_H_ 1
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "deca_types.h"
+
+/* counters, in the order of the CMD_BIN_STATS report */
+enum {
+    /* DW1000 event counters, dwt_deviceentcnts_t */
+    RADIO_STATS_PHE = 0,        // PHY header errors
+    RADIO_STATS_RSL,            // Reed Solomon (frame sync) losses
+    RADIO_STATS_CRCG,           // frames with a good CRC
+    RADIO_STATS_CRCB,           // frames with a bad CRC
+    RADIO_STATS_ARFE,           // frames rejected by the frame filter
+    RADIO_STATS_OVER,           // receiver overruns (double buffer)
+    RADIO_STATS_SFDTO,          // SFD timeouts
+    RADIO_STATS_PTO,            // preamble detection timeouts
+    RADIO_STATS_RTO,            // frame wait timeouts
+    RADIO_STATS_TXF,            // frames sent
+    RADIO_STATS_HPW,            // half period warnings (delayed TX/RX too late)
+    RADIO_STATS_TXW,            // TX power up warnings
+    /* application */
+    RADIO_STATS_APP_TX,         // frames (blinks) the application started
+    RADIO_STATS_APP_TXLOST,     // TX confirmations lost
+    RADIO_STATS_APP_RX,         // good frames passed to the application
+    RADIO_STATS_APP_RXERR,      // RX errors seen by the application, the receiver was reset
+    RADIO_STATS_APP_DROP,       // good frames the firmware had no room for
+    RADIO_STATS_NUM
+};
+
+/* CMD_BIN_STATS report: portGetTickCount() of the snapshot (4) | RADIO_STATS_NUM x counter (4) */
+#define RADIO_STATS_LEN         (4 + 4 * RADIO_STATS_NUM)
+
+/* snapshot period of radio_stats_run(): the 12 bit DW1000 counters must not
+ * overflow in between */
+#define RADIO_STATS_PERIOD_MS   (1000)
+
+/**
+ * Clear and enable the DW1000 event counters, after the initialisation and
+ * after every DW1000 wake up (the counters do not run in sleep)
+ *
+ * @return none
+ */
+void radio_stats_start(void);
+
+/**
+ * Add the DW1000 event counters to the totals and clear them, before the
+ * DW1000 goes to sleep and at least every RADIO_STATS_PERIOD_MS
+ *
+ * @return none
+ */
+void radio_stats_snapshot(void);
+
+/**
+ * Take a snapshot every RADIO_STATS_PERIOD_MS, for an application where the
+ * DW1000 never sleeps
+ *
+ * @return none
+ */
+void radio_stats_run(void);
+
+/**
+ * Count an application event, IRQ context allowed
+ *
+ * @param[in] id : RADIO_STATS_APP_xx
+ * @return none
+ */
+void radio_stats_count(int id);
+
+/**
+ * Return a total since radio_stats_start() was called first
+ *
+ * @param[in] id : RADIO_STATS_xx
+ * @return the counter as of the last snapshot (application counters: now)
+ */
+uint32 radio_stats_get(int id);
+
+/**
+ * Write the CMD_BIN_STATS report, little endian
+ *
+ * @param[out] buf : RADIO_STATS_LEN bytes
+ * @return none
+ */
+void radio_stats_pack(uint8 *buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RADIO_STATS_H_ */
@@ -71,6 +71,29 @@ static const uint8 ref_vbat_goldenval = 0x7e;
 /* Local parameter to store OTP vbat value*/
 static uint8 ref_vbat;
 
+/* Compensation cache, one entry per temp/vbat bin */
+typedef struct {
+    uint8           valid;
+    uint8           chan;
+    uint8           temp_bin;
+    uint8           vbat_bin;
+    dwt_txconfig_t  cfg;
+} tvc_cache_entry_t;
+
+static tvc_cache_entry_t tvc_cache[TVC_CACHE_SIZE];
+static uint8 tvc_cache_next;
+
+/* raw temp/vbat of the TX configuration currently in the DW1000 */
+static uint8 tvc_applied_valid;
+static uint8 tvc_applied_temp;
+static uint8 tvc_applied_vbat;
+static uint8 tvc_sample_cnt;
+
+/* raw temp/vbat of the last SAR sample */
+static uint8 tvc_sample_valid;
+static uint8 tvc_sample_temp;
+static uint8 tvc_sample_vbat;
+
 /**
  * Read the tx configuration reference values from OTP.
  *
@@ -117,47 +140,147 @@ void tvc_otp_read_txcfgref(ref_values_t* ref, uint8 chan)
 }
 
 /**
- * Run bandwidth and TX power compensation
+ * @fn      tvc_get_ref_vbat / tvc_set_ref_vbat
+ * @brief   OTP battery voltage of the TX configuration reference
+ * */
+uint8 tvc_get_ref_vbat(void)
+{
+    return ref_vbat;
+}
+
+void tvc_set_ref_vbat(uint8 vbat)
+{
+    ref_vbat = vbat;
+}
+
+/**
+ * Find the cache entry of a temp/vbat bin
+ *
+ * @return pointer to the entry or NULL
+ */
+static tvc_cache_entry_t *tvc_cache_find(uint8 chan, uint8 temp_bin, uint8 vbat_bin)
+{
+  int i;
+
+  for (i = 0; i < TVC_CACHE_SIZE; i++)
+  {
+    if (tvc_cache[i].valid && (tvc_cache[i].chan == chan) &&
+        (tvc_cache[i].temp_bin == temp_bin) && (tvc_cache[i].vbat_bin == vbat_bin))
+    {
+      return &tvc_cache[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Force the next tvc_comp() call to sample and return a TX configuration
  *
  * @return none
  */
-void tvc_comp(dwt_txconfig_t* tx_cfg, ref_values_t ref, uint8 channel)
+void tvc_invalidate(void)
+{
+  tvc_applied_valid = 0;
+}
+
+/**
+ * Return the raw temp/vbat of the last SAR sample taken by tvc_comp()
+ *
+ * @return 1 if the values are valid, 0 otherwise
+ */
+int tvc_last_sample(uint8* temp, uint8* vbat)
+{
+  *temp = tvc_sample_temp;
+  *vbat = tvc_sample_vbat;
+
+  return tvc_sample_valid;
+}
+
+/**
+ * Run bandwidth and TX power compensation
+ *
+ * @return 1 if tx_cfg has to be applied, 0 otherwise
+ */
+int tvc_comp(dwt_txconfig_t* tx_cfg, ref_values_t ref, uint8 channel)
 {
   uint8 curr_temp;
   uint8 curr_vbat;
   int32_t delta_temp;
-  uint8 pgdly;
   uint16_t tempvbat;
-  uint32_t power;
+  tvc_cache_entry_t *entry;
+  uint8 temp_bin;
+  uint8 vbat_bin;
 
   /* Only do compensation when the reference registers are set during production */
-  if ((ref.power) && (ref.pgcnt) && (ref.temp)) 
+  if (!((ref.power) && (ref.pgcnt) && (ref.temp)))
+  {
+    return 0;
+  }
+
+  /* temp and vbat move slowly, do not sample the SAR on every call */
+  if (tvc_applied_valid && (++tvc_sample_cnt < TVC_SAMPLE_DIV))
+  {
+    return 0;
+  }
+  tvc_sample_cnt = 0;
+
+  /* Set SPI clock to 2MHz */
+  port_set_dw1000_slowrate();
+
+  /* Read DW1000 IC temperature and supply volgate for compensation procedure. */
+  tempvbat = dwt_readtempvbat(0);
+  curr_vbat = tempvbat & 0xff;
+  curr_temp = (tempvbat >> 8) & 0xff;
+
+  tvc_sample_temp = curr_temp;
+  tvc_sample_vbat = curr_vbat;
+  tvc_sample_valid = 1;
+
+  if (tvc_applied_valid &&
+      (ABS((int)curr_temp - (int)tvc_applied_temp) < DW_BW_TXPWR_MAX_TEMP_DIFF) &&
+      (ABS((int)curr_vbat - (int)tvc_applied_vbat) < DW_BW_TXPWR_MAX_VBAT_DIFF))
   {
-    /* Set SPI clock to 2MHz */
-    port_set_dw1000_slowrate();         
+    /* the setting in the DW1000 is still good */
+    port_set_dw1000_fastrate();
+    return 0;
+  }
+
+  temp_bin = curr_temp / DW_BW_TXPWR_MAX_TEMP_DIFF;
+  vbat_bin = curr_vbat / DW_BW_TXPWR_MAX_VBAT_DIFF;
+
+  entry = tvc_cache_find(channel, temp_bin, vbat_bin);
 
-    /* Read DW1000 IC temperature and supply volgate for compensation procedure. */
-    tempvbat = dwt_readtempvbat(0);    
-    curr_vbat = tempvbat & 0xff;
-    curr_temp = (tempvbat >> 8) & 0xff;
+  if (entry == NULL)
+  {
+    entry = &tvc_cache[tvc_cache_next];
+    tvc_cache_next = (tvc_cache_next + 1) % TVC_CACHE_SIZE;
 
     /* Calculate temperature difference in raw value unit */
     delta_temp = (int32_t)((dwt_convertrawtemperature(curr_temp) - (float)(ref.temp)) / SAR_TEMP_TO_CELCIUS_CONV);
 
     /* Calculate the corrected bandwidth setting */
-    pgdly = dwt_calcbandwidthtempadj(ref.pgcnt);
+    entry->cfg.PGdly = dwt_calcbandwidthtempadj(ref.pgcnt);
 
     /* Calculate the corrected tx power setting */
-    power = tvc_calcpowertempvbatadj(channel, ref.power, delta_temp, curr_vbat);
-
-    /* Adjust the tx power register to suit the latest temp & vbat */
-    tx_cfg->PGdly = pgdly;
-    tx_cfg->power = power;    
-    //dwt_configuretxrf(tx_cfg);
+    entry->cfg.power = tvc_calcpowertempvbatadj(channel, ref.power, delta_temp, curr_vbat);
 
-    /* Set SPI clock to 8MHz */
-    port_set_dw1000_fastrate();
+    entry->chan = channel;
+    entry->temp_bin = temp_bin;
+    entry->vbat_bin = vbat_bin;
+    entry->valid = 1;
   }
+
+  /* Adjust the tx power register to suit the latest temp & vbat */
+  *tx_cfg = entry->cfg;
+
+  tvc_applied_temp = curr_temp;
+  tvc_applied_vbat = curr_vbat;
+  tvc_applied_valid = 1;
+
+  /* Set SPI clock to 8MHz */
+  port_set_dw1000_fastrate();
+
+  return 1;
 }
 
 
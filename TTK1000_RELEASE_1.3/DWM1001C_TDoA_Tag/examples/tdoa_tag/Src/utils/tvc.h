@@ -39,6 +39,11 @@
 #define ABS(x)  (((x) < 0) ? (-(x)) : (x))
 #endif
 
+/* compensation cache: number of temp/vbat bins kept, and the SAR is sampled
+ * on every TVC_SAMPLE_DIV-th call of tvc_comp() only */
+#define TVC_CACHE_SIZE              8
+#define TVC_SAMPLE_DIV              10
+
 /* define structure for DW1000 device reference values */
 struct ref_values {
     uint8   pgdly;
@@ -60,15 +65,47 @@ typedef struct ref_values ref_values_t;
  */
 void tvc_otp_read_txcfgref(ref_values_t* ref, uint8 chan);
 
+/**
+ * Return / set the OTP battery voltage read with the TX configuration
+ * reference, to keep it with a cached reference (warm boot)
+ *
+ * @return the raw reference voltage
+ */
+uint8 tvc_get_ref_vbat(void);
+void tvc_set_ref_vbat(uint8 vbat);
+
 /**
  * Run bandwidth and TX power compensation
  *
+ * The DW1000 temperature and voltage are sampled at a reduced rate and the
+ * results are cached per temp/vbat bin, tx_cfg is only updated when the
+ * device moved past DW_BW_TXPWR_MAX_TEMP_DIFF / DW_BW_TXPWR_MAX_VBAT_DIFF
+ * since the last applied setting.
+ *
  * @param[in] reference structure
  * @param[out] tx_cfg values
  *
+ * @return 1 if tx_cfg changed and has to be written with dwt_configuretxrf(),
+ *         0 otherwise
+ */
+int tvc_comp(dwt_txconfig_t* tx_cfg, ref_values_t ref, uint8 channel);
+
+/**
+ * Force the next tvc_comp() call to sample and return a TX configuration,
+ * used after the TX RF configuration was overwritten (e.g. by instance_config)
+ *
  * @return none
  */
-void tvc_comp(dwt_txconfig_t* tx_cfg, ref_values_t ref, uint8 channel);
+void tvc_invalidate(void);
+
+/**
+ * Return the raw temp/vbat of the last SAR sample taken by tvc_comp()
+ *
+ * @param[out] temp, vbat : raw SAR values
+ *
+ * @return 1 if a sample was taken since power up, 0 otherwise
+ */
+int tvc_last_sample(uint8* temp, uint8* vbat);
 
 
 #ifdef __cplusplus
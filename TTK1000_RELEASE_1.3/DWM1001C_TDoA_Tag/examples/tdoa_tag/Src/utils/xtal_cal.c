@@ -0,0 +1,192 @@
+/*
+ * @file       xtal_cal.c
+ *
+ * @brief      crystal trim calibration against the anchor clocks
+ *
+ *             The carrier integrator of every frame received in the
+ *             downlink window gives the offset of the tag clock from the
+ *             clock of the anchor which sent it. The offsets of
+ *             XTAL_CAL_FRAMES frames are averaged (frames further than
+ *             XTAL_CAL_MAX_CPPM are dropped), then the trim is moved by the
+ *             mean offset in XTAL_CAL_STEP_CPPM steps: a higher trim loads
+ *             the crystal and slows the clock down. The loop ends when the
+ *             mean offset is within half a step, the trim is then stored
+ *             in the configuration and saved, or after XTAL_CAL_ROUNDS
+ *             rounds or at the end of the trim range.
+ *
+ *             A trim of 0 in the configuration is the OTP value, as
+ *             dwt_initialise() sets it.
+ *
+ * @author     Decawave Software
+ *
+ * @attention  Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *             All rights reserved.
+ */
+
+#include "port_platform.h"
+#include "deca_device_api.h"
+#include "deca_regs.h"
+#include "default_config.h"
+#include "config.h"
+#include "tvc.h"
+#include "xtal_cal.h"
+
+/* frames of a round, the offset is the mean of them */
+#define XTAL_CAL_FRAMES             8
+#define XTAL_CAL_ROUNDS             8
+/* offset of one trim step and the largest offset taken, 1/100 ppm */
+#define XTAL_CAL_STEP_CPPM          150
+#define XTAL_CAL_MAX_CPPM           5000
+#define XTAL_CAL_TRIM_MAX           (FS_XTALT_MASK)
+
+static xtal_cal_state_t xs;
+
+static int32_t  xs_sum_cppm;
+static uint8_t  xs_round_frames;
+static uint8_t  xs_rounds;
+
+/*
+ * @fn      xtal_cal_cppm
+ * @brief   clock offset of the frame received, from the carrier integrator
+ * */
+static int32_t xtal_cal_cppm(param_block_t *pbss)
+{
+    float hz_to_ppm;
+    float hz = (float)dwt_readcarrierintegrator() *
+               ((pbss->dwt_config.dataRate == DWT_BR_110K) ?
+                    (float)FREQ_OFFSET_MULTIPLIER_110KB : (float)FREQ_OFFSET_MULTIPLIER);
+
+    switch(pbss->dwt_config.chan)
+    {
+        case 1:  hz_to_ppm = (float)HERTZ_TO_PPM_MULTIPLIER_CHAN_1; break;
+        case 2:
+        case 4:  hz_to_ppm = (float)HERTZ_TO_PPM_MULTIPLIER_CHAN_2; break;
+        case 3:  hz_to_ppm = (float)HERTZ_TO_PPM_MULTIPLIER_CHAN_3; break;
+        default: hz_to_ppm = (float)HERTZ_TO_PPM_MULTIPLIER_CHAN_5; break;
+    }
+
+    return (int32_t)(hz * hz_to_ppm * 100.0f);
+}
+
+/*
+ * @fn      xtal_cal_end
+ * @brief   end of the calibration, the trim is kept on success
+ * */
+static void xtal_cal_end(param_block_t *pbss, uint8_t state)
+{
+    xs.state = state;
+
+    if(state == XTAL_CAL_DONE)
+    {
+        pbss->xtalTrim = xs.trim;
+        save_bssConfig(pbss);
+    }
+    /* else xtal_cal_pending() gives the configured trim back */
+}
+
+void xtal_cal_apply(param_block_t *pbss)
+{
+    uint32 otp;
+
+    if(xs.otp_trim == 0)
+    {
+        /* first call, read again on a warm boot which kept another trim */
+        dwt_otpread(OTP_XTRIM_ADDRESS, &otp, 1);
+        xs.otp_trim = ((otp & XTAL_CAL_TRIM_MAX) != 0) ? (otp & XTAL_CAL_TRIM_MAX) : (FS_XTALT_MIDRANGE);
+    }
+
+    xs.trim = (pbss->xtalTrim != 0) ? (pbss->xtalTrim & XTAL_CAL_TRIM_MAX) : (xs.otp_trim);
+    dwt_setxtaltrim(xs.trim);
+}
+
+int xtal_cal_pending(param_block_t *pbss)
+{
+    uint8_t trim = (pbss->xtalTrim != 0) ? (pbss->xtalTrim & XTAL_CAL_TRIM_MAX) : (xs.otp_trim);
+
+    return (xs.state != XTAL_CAL_RUN) && (xs.otp_trim != 0) && (trim != xs.trim);
+}
+
+void xtal_cal_start(void)
+{
+    xs.state = XTAL_CAL_RUN;
+    xs.steps = 0;
+    xs.frames = 0;
+    xs.offset_cppm = 0;
+    xs_sum_cppm = 0;
+    xs_round_frames = 0;
+    xs_rounds = 0;
+}
+
+void xtal_cal_stop(void)
+{
+    if(xs.state == XTAL_CAL_RUN)
+    {
+        xs.state = XTAL_CAL_IDLE;
+    }
+}
+
+int xtal_cal_active(void)
+{
+    return (xs.state == XTAL_CAL_RUN);
+}
+
+void xtal_cal_rx(param_block_t *pbss)
+{
+    int32_t cppm, step, trim;
+
+    if(xs.state != XTAL_CAL_RUN)
+    {
+        return;
+    }
+
+    cppm = xtal_cal_cppm(pbss);
+    if((cppm > XTAL_CAL_MAX_CPPM) || (cppm < -XTAL_CAL_MAX_CPPM))
+    {
+        return;
+    }
+
+    xs.frames++;
+    xs_sum_cppm += cppm;
+    if(++xs_round_frames < XTAL_CAL_FRAMES)
+    {
+        return;
+    }
+
+    xs.offset_cppm = (int16_t)(xs_sum_cppm / XTAL_CAL_FRAMES);
+    xs_sum_cppm = 0;
+    xs_round_frames = 0;
+
+    if((xs.offset_cppm <= XTAL_CAL_STEP_CPPM / 2) && (xs.offset_cppm >= -XTAL_CAL_STEP_CPPM / 2))
+    {
+        xtal_cal_end(pbss, XTAL_CAL_DONE);
+        return;
+    }
+
+    if(++xs_rounds > XTAL_CAL_ROUNDS)
+    {
+        xtal_cal_end(pbss, XTAL_CAL_FAIL);
+        return;
+    }
+
+    /* a slow tag clock (positive offset) needs a lower trim */
+    step = (xs.offset_cppm + ((xs.offset_cppm > 0) ? (XTAL_CAL_STEP_CPPM / 2) : (-XTAL_CAL_STEP_CPPM / 2)))
+           / XTAL_CAL_STEP_CPPM;
+    trim = (int32_t)xs.trim - step;
+    trim = (trim < 1) ? (1) : ((trim > XTAL_CAL_TRIM_MAX) ? (XTAL_CAL_TRIM_MAX) : (trim));
+
+    if(trim == xs.trim)
+    {
+        /* the offset is out of the trim range */
+        xtal_cal_end(pbss, XTAL_CAL_FAIL);
+        return;
+    }
+
+    xs.trim = (uint8_t)trim;
+    xs.steps++;
+    dwt_setxtaltrim(xs.trim);
+}
+
+const xtal_cal_state_t *xtal_cal_state(void)
+{
+    return &xs;
+}
@@ -0,0 +1,86 @@
+/*
+ * @file       xtal_cal.h
+ *
+ * @brief      crystal trim calibration against the anchor clocks
+ *
+ * @author     Decawave Software
+ *
+ * @attention  Copyright 2018 (c) DecaWave Ltd, Dublin, Ireland.
+ *             All rights reserved.
+ */
+
+#ifndef _XTAL_CAL_H_
+#define _XTAL_CAL_H_ 1
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "default_config.h"
+
+/* calibration states */
+#define XTAL_CAL_IDLE               0
+#define XTAL_CAL_RUN                1
+#define XTAL_CAL_DONE               2
+#define XTAL_CAL_FAIL               3
+
+typedef struct {
+    uint8_t     state;          /* XTAL_CAL_xx */
+    uint8_t     trim;           /* XTAL trim in use */
+    uint8_t     otp_trim;       /* XTAL trim of the OTP, mid range if not trimmed */
+    uint8_t     steps;          /* trim adjustments of the calibration */
+    uint16_t    frames;         /* frames measured by the calibration */
+    int16_t     offset_cppm;    /* mean offset of the last round, 1/100 ppm,
+                                   positive: the tag clock is slower */
+}xtal_cal_state_t;
+
+/**
+ * Set the XTAL trim of the configuration, the OTP value if it is 0, called
+ * with the DW1000 awake after dwt_initialise() and when xtal_cal_pending()
+ *
+ * @param[in] pbss  : configuration (xtal settings)
+ * @return none
+ */
+void xtal_cal_apply(param_block_t *pbss);
+
+/**
+ * Check if the trim in use is not the one of the configuration (XTALTRIM
+ * changed, or a calibration was stopped or failed)
+ *
+ * @param[in] pbss  : configuration (xtal settings)
+ * @return non-zero if xtal_cal_apply() is due
+ */
+int xtal_cal_pending(param_block_t *pbss);
+
+/**
+ * Start or stop the calibration. While it runs the receiver is turned on
+ * after every blink (the downlink window must be set)
+ *
+ * @return none
+ */
+void xtal_cal_start(void);
+void xtal_cal_stop(void);
+int xtal_cal_active(void);
+
+/**
+ * Take the clock offset of a frame received in the downlink window, called
+ * with the RX event before the receiver is turned on again. At the end of
+ * the calibration the trim is stored into pbss and saved.
+ *
+ * @param[in] pbss  : configuration (channel, data rate, xtal settings)
+ * @return none
+ */
+void xtal_cal_rx(param_block_t *pbss);
+
+/**
+ * Return the calibration state for the XTALSTAT report
+ *
+ * @return state
+ */
+const xtal_cal_state_t *xtal_cal_state(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _XTAL_CAL_H_ */
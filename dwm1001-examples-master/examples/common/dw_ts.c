@@ -0,0 +1,279 @@
+/*! ----------------------------------------------------------------------------
+*  @file    dw_ts.c
+*  @brief   DW1000 40-bit time-stamp and time-of-flight helpers shared by the TWR examples
+*
+*           See NOTES at the end of this file for the fixed-point formats.
+*
+* @attention
+*
+* Copyright 2018 (c) Decawave Ltd, Dublin, Ireland.
+*
+* All rights reserved.
+*
+* @author Decawave
+*/
+#include "deca_device_api.h"
+#include "dw_ts.h"
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn dw_ts_get()
+*
+* @brief Read a time-stamp field of a message. In the time-stamp fields, the least significant byte is at the lower
+*        address.
+*
+* @param  ts_field  pointer on the first byte of the time-stamp field to read
+*         len  length of the field in bytes, 5 for a full time-stamp, 4 for the low 32 bits
+*
+* @return  the time-stamp value
+*/
+uint64_t dw_ts_get(const uint8_t *ts_field, int len)
+{
+  uint64_t ts = 0;
+  int i;
+  for (i = len - 1; i >= 0; i--)
+  {
+    ts <<= 8;
+    ts |= ts_field[i];
+  }
+  return ts;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn dw_ts_set()
+*
+* @brief Fill a time-stamp field of a message, least significant byte first.
+*
+* @param  ts_field  pointer on the first byte of the time-stamp field to fill
+*         ts  time-stamp value
+*         len  length of the field in bytes
+*
+* @return none
+*/
+void dw_ts_set(uint8_t *ts_field, uint64_t ts, int len)
+{
+  int i;
+  for (i = 0; i < len; i++)
+  {
+    ts_field[i] = (uint8_t)(ts >> (i * 8));
+  }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn dw_ts_read_rx()
+*
+* @brief Get the 40-bit RX time-stamp of the last received frame.
+*
+* @param  none
+*
+* @return  the RX time-stamp, in dtu
+*/
+uint64_t dw_ts_read_rx(void)
+{
+  uint8_t ts_tab[5];
+  dwt_readrxtimestamp(ts_tab);
+  return dw_ts_get(ts_tab, 5);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn dw_ts_read_tx()
+*
+* @brief Get the 40-bit TX time-stamp of the last transmitted frame.
+*
+* @param  none
+*
+* @return  the TX time-stamp, in dtu
+*/
+uint64_t dw_ts_read_tx(void)
+{
+  uint8_t ts_tab[5];
+  dwt_readtxtimestamp(ts_tab);
+  return dw_ts_get(ts_tab, 5);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn dw_ts_add()
+*
+* @brief Add a duration to a time-stamp, wrapping around like the DW1000 system time.
+*
+* @param  ts  time-stamp, in dtu
+*         dtu  duration, in dtu
+*
+* @return  (ts + dtu) modulo 2**40
+*/
+uint64_t dw_ts_add(uint64_t ts, uint64_t dtu)
+{
+  return (ts + dtu) & DW_TS_MASK;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn dw_ts_sub()
+*
+* @brief Signed difference of two time-stamps, correct across the wrap around of the system time as long as the two
+*        time-stamps are less than 2**39 dtu (around 8.6 s) apart.
+*
+* @param  a, b  time-stamps, in dtu
+*
+* @return  a - b, in dtu
+*/
+int64_t dw_ts_sub(uint64_t a, uint64_t b)
+{
+  /* Sign extend the 40-bit difference. */
+  return ((int64_t)(((a - b) & DW_TS_MASK) << (64 - DW_TS_BITS))) >> (64 - DW_TS_BITS);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn dw_ts_dx_time()
+*
+* @brief Convert a time-stamp into the value programmed by dwt_setdelayedtrxtime(), i.e. its high 32 bits.
+*
+* @param  ts  time-stamp, in dtu
+*
+* @return  the delayed TX/RX time
+*/
+uint32_t dw_ts_dx_time(uint64_t ts)
+{
+  return (uint32_t)((ts & DW_TS_MASK) >> 8);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn dw_ts_from_dx_time()
+*
+* @brief Time-stamp at which a delayed transmission actually starts. The DW1000 ignores the low order bit of the
+*        delayed time, see NOTE 1 below. The TX antenna delay still has to be added to get the TX time-stamp.
+*
+* @param  dx_time  value given to dwt_setdelayedtrxtime()
+*
+* @return  the time-stamp, in dtu
+*/
+uint64_t dw_ts_from_dx_time(uint32_t dx_time)
+{
+  return ((uint64_t)(dx_time & 0xFFFFFFFEUL)) << 8;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn dw_clock_offset_q31()
+*
+* @brief Clock offset ratio of the remote transmitter relative to the local clock, from the carrier integrator of the
+*        last received frame. See NOTE 2 below.
+*
+* @param  carrier_integrator  value returned by dwt_readcarrierintegrator()
+*         chan  channel number the frame was received on
+*         data_rate  DWT_BR_110K, DWT_BR_850K or DWT_BR_6M8
+*
+* @return  the clock offset ratio in Q31, positive when the remote clock is slower than the local clock
+*/
+int32_t dw_clock_offset_q31(int32_t carrier_integrator, uint8_t chan, uint8_t data_rate)
+{
+  int32_t m;
+
+  /* Carrier frequency in multiples of 998.4 MHz / 2. */
+  switch (chan)
+  {
+    case 1:  m = 7;  break;
+    case 2:
+    case 4:  m = 8;  break;
+    case 3:  m = 9;  break;
+    default: m = 13; break; /* Channels 5 and 7. */
+  }
+
+  if (data_rate == DWT_BR_110K)
+  {
+    m *= 8;
+  }
+
+  return -(carrier_integrator * 16) / m;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn dw_ts_mul_q31()
+*
+* @brief Scale a duration by a Q31 fraction, rounding to the nearest dtu.
+*
+* @param  dtu  duration, in dtu
+*         q31  Q31 fraction, dtu * q31 must fit in 63 bits (a clock offset of 100 ppm is below 2**18)
+*
+* @return  dtu * q31 / 2**31
+*/
+int64_t dw_ts_mul_q31(int64_t dtu, int32_t q31)
+{
+  return (dtu * q31 + (1LL << 30)) >> 31;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn dw_ss_twr_tof2()
+*
+* @brief Single-sided TWR round trip, corrected for the clock offset of the responder.
+*
+* @param  rtd_init  poll TX to response RX, measured by the initiator, in dtu
+*         rtd_resp  poll RX to response TX, measured by the responder, in dtu
+*         offset_q31  clock offset ratio returned by dw_clock_offset_q31()
+*
+* @return  twice the time of flight, in dtu. It is kept doubled so that no resolution is lost before the conversion
+*          into a distance.
+*/
+int64_t dw_ss_twr_tof2(int64_t rtd_init, int64_t rtd_resp, int32_t offset_q31)
+{
+  return rtd_init - rtd_resp + dw_ts_mul_q31(rtd_resp, offset_q31);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn dw_ds_twr_tof2()
+*
+* @brief Asymmetric double-sided TWR time of flight, see NOTE 4 below. The clock offset cancels out without the carrier integrator and
+*        the two reply times do not need to be equal.
+*
+* @param  round_a  poll TX to response RX, measured by the initiator, in dtu
+*         reply_a  response RX to final TX, measured by the initiator, in dtu
+*         round_b  response TX to final RX, measured by the responder, in dtu
+*         reply_b  poll RX to response TX, measured by the responder, in dtu
+*
+* @return  twice the time of flight, in dtu, rounded to the nearest dtu
+*/
+int64_t dw_ds_twr_tof2(int64_t round_a, int64_t reply_a, int64_t round_b, int64_t reply_b)
+{
+  int64_t num = 2 * (round_a * round_b - reply_a * reply_b);
+  int64_t den = round_a + reply_a + round_b + reply_b;
+
+  if (den <= 0)
+  {
+    return 0;
+  }
+
+  return (num >= 0) ? ((num + den / 2) / den) : ((num - den / 2) / den);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn dw_tof2_to_mm()
+*
+* @brief Convert twice the time of flight into a distance, rounding to the nearest millimetre (1 dtu of time of
+*        flight is around 4.69 mm).
+*
+* @param  tof2  twice the time of flight, in dtu, as returned by dw_ss_twr_tof2()
+*
+* @return  the distance, in millimetres
+*/
+int32_t dw_tof2_to_mm(int64_t tof2)
+{
+  const int64_t den = (int64_t)(2 * DW_DTU_PER_S / 1000);
+  int64_t num = tof2 * DW_SPEED_OF_LIGHT;
+
+  return (int32_t)((num >= 0) ? ((num + den / 2) / den) : ((num - den / 2) / den));
+}
+
+/*****************************************************************************************************************************************************
+* NOTES:
+*
+* 1. The DW1000 delayed TX/RX time has a resolution of 512 dtu (around 8 ns): the low 9 bits of the 40-bit system time are ignored. Bit 0 of the
+*    value given to dwt_setdelayedtrxtime() is system time bit 8 and is ignored as well, hence the mask in dw_ts_from_dx_time().
+* 2. The carrier integrator is the carrier frequency offset of the received frame, in units of 998.4 MHz / 2 / 1024 / 131072 Hz (/ 8192 instead of
+*    / 1024 at 110 kbps). Dividing by the carrier frequency fc gives the clock offset ratio, fc being m * 998.4 MHz / 2:
+*      ratio = - ci / (m * 2**27)   so in Q31:   ratio * 2**31 = - ci * 16 / m
+*    The carrier integrator is a 21-bit signed value so the product fits in 32 bits. This is the integer form of
+*    ci * FREQ_OFFSET_MULTIPLIER * HERTZ_TO_PPM_MULTIPLIER_CHAN_x / 1.0e6 of the DW1000 API, with a resolution of around 0.0005 ppm.
+* 3. The SS TWR time of flight is (rtd_init - rtd_resp * (1 - ratio)) / 2. The round trip delays of the examples are a few hundred microseconds,
+*    i.e. below 2**26 dtu, so rtd_resp * ratio and tof2 * DW_SPEED_OF_LIGHT cannot overflow 64 bits.
+* 4. The asymmetric DS TWR time of flight is (Ra * Rb - Da * Db) / (Ra + Rb + Da + Db) with Ra, Da the round trip and reply times of the
+*    initiator and Rb, Db those of the responder. Each of them is measured by one clock only, so the formula is exact to the first order of the
+*    clock offset whatever the reply times. 2 * Ra * Rb fits in 64 bits for round trip and reply times below 2**30 dtu (around 16 ms).
+*
+****************************************************************************************************************************************************/
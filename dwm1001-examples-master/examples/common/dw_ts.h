@@ -0,0 +1,62 @@
+/*! ----------------------------------------------------------------------------
+*  @file    dw_ts.h
+*  @brief   DW1000 40-bit time-stamp and time-of-flight helpers shared by the TWR examples -- Header file
+*
+*           All the arithmetic is integer. Time-stamps are kept in device time units (dtu, 1 / (499.2 MHz * 128),
+*           around 15.65 ps), the clock offset ratio is a Q31 fraction and distances are in millimetres, so that the
+*           ranging path does not need the soft-float double support of the Cortex-M4F.
+*
+* @attention
+*
+* Copyright 2018 (c) Decawave Ltd, Dublin, Ireland.
+*
+* All rights reserved.
+*
+* @author Decawave
+*/
+#ifndef DW_TS_H_
+#define DW_TS_H_
+
+#include <stdint.h>
+
+/* Time-stamps are 40 bits wide and wrap around every 2**40 dtu (around 17.2 s). */
+#define DW_TS_BITS  40
+#define DW_TS_MASK  0xFFFFFFFFFFULL
+
+/* UWB microsecond (uus) to device time unit (dtu) conversion factor.
+* 1 uus = 512 / 499.2 us and 1 us = 499.2 * 128 dtu. */
+#define DW_UUS_TO_DTU 65536
+
+/* Speed of light in air, in metres per second. */
+#define DW_SPEED_OF_LIGHT 299702547
+
+/* Device time units per second, 499.2 MHz * 128. */
+#define DW_DTU_PER_S 63897600000ULL
+
+uint64_t dw_ts_get(const uint8_t *ts_field, int len);
+
+void dw_ts_set(uint8_t *ts_field, uint64_t ts, int len);
+
+uint64_t dw_ts_read_rx(void);
+
+uint64_t dw_ts_read_tx(void);
+
+uint64_t dw_ts_add(uint64_t ts, uint64_t dtu);
+
+int64_t dw_ts_sub(uint64_t a, uint64_t b);
+
+uint32_t dw_ts_dx_time(uint64_t ts);
+
+uint64_t dw_ts_from_dx_time(uint32_t dx_time);
+
+int32_t dw_clock_offset_q31(int32_t carrier_integrator, uint8_t chan, uint8_t data_rate);
+
+int64_t dw_ts_mul_q31(int64_t dtu, int32_t q31);
+
+int64_t dw_ss_twr_tof2(int64_t rtd_init, int64_t rtd_resp, int32_t offset_q31);
+
+int64_t dw_ds_twr_tof2(int64_t round_a, int64_t reply_a, int64_t round_b, int64_t reply_b);
+
+int32_t dw_tof2_to_mm(int64_t tof2);
+
+#endif /* DW_TS_H_ */
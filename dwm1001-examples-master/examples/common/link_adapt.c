@@ -0,0 +1,237 @@
+/*! ----------------------------------------------------------------------------
+*  @file    link_adapt.c
+*  @brief   Link adaptation of the TWR examples: per peer choice of the preamble length and data rate
+*
+*           See NOTES at the end of this file for the first path power and the thresholds.
+*
+* @attention
+*
+* Copyright 2018 (c) Decawave Ltd, Dublin, Ireland.
+*
+* All rights reserved.
+*
+* @author Decawave
+*/
+#include <math.h>
+#include "deca_device_api.h"
+#include "twr_bench.h"
+#include "link_adapt.h"
+
+/* A profile and the first path power under which its frames are too weak, in dBm. See NOTE 2 below. */
+typedef struct
+{
+  twr_bench_cfg_t cfg;
+  float down_dbm;
+} link_profile_t;
+
+/* Profiles, from the shortest air time to the most robust. The base profile (LINK_PROFILE_BASE) is the configuration of main.c. */
+static const link_profile_t link_profiles[] =
+{
+  { { 5, 64,   64,  8, 6810 }, -85.0f },
+  { { 5, 64,  128,  8, 6810 }, -88.0f },
+  { { 5, 64,  512, 16,  850 }, -94.0f },
+  { { 5, 64, 1024, 32,  850 }, -200.0f },   /* the most robust profile is never left for a longer one */
+};
+#define LINK_PROFILES_N ((int)(sizeof(link_profiles) / sizeof(link_profiles[0])))
+
+/* Hysteresis: the first path power has to be this far above the threshold of the next shorter profile, in dB. */
+#define LINK_HYST_DB 4.0f
+
+/* Consecutive frames needed to move to a shorter profile, and to a longer one. */
+#define LINK_UP_N 8
+#define LINK_DOWN_N 3
+
+/* Consecutive timeouts which move the peer to a longer profile. */
+#define LINK_TIMEOUT_N 3
+
+/* Constant A of the first path power, in dBm, for the 16 MHz and 64 MHz PRF. */
+#define FP_A_PRF16_DBM 113.77f
+#define FP_A_PRF64_DBM 121.74f
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn link_adapt_count()
+*
+* @brief Number of profiles.
+*
+* @param  none
+*
+* @return  the number of profiles
+*/
+int link_adapt_count(void)
+{
+  return LINK_PROFILES_N;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn link_adapt_config()
+*
+* @brief DW1000 configuration of a profile.
+*
+* @param  profile  index of the profile
+*         config  filled with the DW1000 configuration
+*
+* @return  0 on success, -1 if the profile does not exist
+*/
+int link_adapt_config(int profile, dwt_config_t *config)
+{
+  if ((profile < 0) || (profile >= LINK_PROFILES_N))
+  {
+    return -1;
+  }
+  return twr_bench_dwt_config(&link_profiles[profile].cfg, config);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn link_adapt_fp_dbm()
+*
+* @brief First path power of the last received frame. See NOTE 1 below.
+*
+* @param  diag  diagnostics of the frame, from dwt_readdiagnostics()
+*         prf  DWT_PRF_16M or DWT_PRF_64M
+*
+* @return  the first path power, in dBm
+*/
+float link_adapt_fp_dbm(const dwt_rxdiag_t *diag, uint8 prf)
+{
+  float f1 = diag->firstPathAmp1;
+  float f2 = diag->firstPathAmp2;
+  float f3 = diag->firstPathAmp3;
+  float n = diag->rxPreamCount;
+
+  if (n < 1.0f)
+  {
+    return -200.0f;
+  }
+
+  return 10.0f * log10f((f1 * f1 + f2 * f2 + f3 * f3) / (n * n)) - ((prf == DWT_PRF_16M) ? (FP_A_PRF16_DBM) : (FP_A_PRF64_DBM));
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn link_adapt_init()
+*
+* @brief Start a peer on the base profile.
+*
+* @param  la  link adaptation state of the peer
+*
+* @return none
+*/
+void link_adapt_init(link_adapt_t *la)
+{
+  link_adapt_set(la, LINK_PROFILE_BASE);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn link_adapt_set()
+*
+* @brief Set the profile of a peer, once it has switched, and restart the hysteresis counters.
+*
+* @param  la  link adaptation state of the peer
+*         profile  index of the profile
+*
+* @return none
+*/
+void link_adapt_set(link_adapt_t *la, int profile)
+{
+  la->profile = (uint8_t)profile;
+  la->want = (uint8_t)profile;
+  la->up_n = 0;
+  la->down_n = 0;
+  la->timeout_n = 0;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn link_adapt_rx()
+*
+* @brief Account a frame received from a peer.
+*
+* @param  la  link adaptation state of the peer
+*         fp_dbm  first path power of the frame, from link_adapt_fp_dbm()
+*
+* @return  the profile the peer should use (la->want), its current profile if no change is needed
+*/
+int link_adapt_rx(link_adapt_t *la, float fp_dbm)
+{
+  const int p = la->profile;
+  int want = p;
+
+  la->timeout_n = 0;
+
+  if (fp_dbm < link_profiles[p].down_dbm)
+  {
+    la->up_n = 0;
+    if (la->down_n < 0xFF)
+    {
+      la->down_n++;
+    }
+    if ((la->down_n >= LINK_DOWN_N) && (p + 1 < LINK_PROFILES_N))
+    {
+      want = p + 1;
+    }
+  }
+  else
+  {
+    la->down_n = 0;
+    if ((p > 0) && (fp_dbm > link_profiles[p - 1].down_dbm + LINK_HYST_DB))
+    {
+      if ((la->up_n < 0xFF) && (++la->up_n >= LINK_UP_N))
+      {
+        want = p - 1;
+      }
+    }
+    else
+    {
+      la->up_n = 0;
+    }
+  }
+
+  la->want = (uint8_t)want;
+  return want;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn link_adapt_timeout()
+*
+* @brief Account an exchange with a peer which has not been answered.
+*
+* @param  la  link adaptation state of the peer
+*
+* @return  the profile the peer should use (la->want), its current profile if no change is needed
+*/
+int link_adapt_timeout(link_adapt_t *la)
+{
+  const int p = la->profile;
+  int want = p;
+
+  la->up_n = 0;
+  if (la->timeout_n < 0xFF)
+  {
+    la->timeout_n++;
+  }
+
+  if ((la->timeout_n >= LINK_TIMEOUT_N) && (p + 1 < LINK_PROFILES_N))
+  {
+    want = p + 1;
+  }
+
+  la->want = (uint8_t)want;
+  return want;
+}
+
+/*****************************************************************************************************************************************************
+* NOTES:
+*
+* 1. The first path power is estimated as in the DW1000 User Manual (section 4.7.1): FP = 10 * log10((F1^2 + F2^2 + F3^2) / N^2) - A, with
+*    F1, F2 and F3 the first path amplitudes, N the preamble symbols accumulated (dwt_rxdiag_t.rxPreamCount, not corrected for the SFD as
+*    the estimate is only compared to thresholds) and A 113.77 dBm at 16 MHz PRF or 121.74 dBm at 64 MHz PRF. The first path power is
+*    used rather than the total RX power because it is the detection of the first path that fails on the long links (and in NLOS).
+* 2. A frame below the threshold of its profile counts as weak, LINK_DOWN_N weak frames or LINK_TIMEOUT_N timeouts in a row ask for the
+*    next longer profile. A frame above the threshold of the next shorter profile plus LINK_HYST_DB counts as strong, LINK_UP_N strong
+*    frames in a row ask for that profile. The thresholds are the first path powers at which the shorter preamble starts to lose frames,
+*    around 3 dB of processing gain per doubling of the preamble; they are starting points to be adjusted with the benchmark build
+*    (twr_bench.c) in the actual arena. The gap between the two thresholds of a step keeps a link on the edge from toggling at each
+*    exchange, and the asymmetry (fast down, slow up) favours the frames getting through.
+* 3. The change is asked for in the poll (one byte after the function code): the peer answers with the current profile and then
+*    switches, so no frame is spent on it. If the answer is lost the two sides disagree for a while: the initiator times out, after
+*    LINK_LOST_N timeouts it goes back to the base profile, which the responder has returned to after LINK_IDLE_MS without a frame.
+*
+****************************************************************************************************************************************************/
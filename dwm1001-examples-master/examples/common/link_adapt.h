@@ -0,0 +1,60 @@
+/*! ----------------------------------------------------------------------------
+*  @file    link_adapt.h
+*  @brief   Link adaptation of the TWR examples: per peer choice of the preamble length and data rate -- Header file
+*
+*           The profiles go from the shortest air time (short preamble, 6.8 Mbps) to the most robust (long preamble, 850 kbps).
+*           Each peer steps between them from the first path power of its frames and its timeouts, with hysteresis. See NOTES
+*           at the end of link_adapt.c.
+*
+* @attention
+*
+* Copyright 2018 (c) Decawave Ltd, Dublin, Ireland.
+*
+* All rights reserved.
+*
+* @author Decawave
+*/
+#ifndef LINK_ADAPT_H_
+#define LINK_ADAPT_H_
+
+#include <stdint.h>
+#include "deca_device_api.h"
+#include "twr_bench.h"
+
+/* Profile of the ranging examples (main.c), used until a change is made and after LINK_IDLE_MS without a frame. */
+#define LINK_PROFILE_BASE 1
+
+/* A responder goes back to the base profile after this time without a frame, in milliseconds. It must cover several epochs of the
+* initiator. */
+#ifndef LINK_IDLE_MS
+#define LINK_IDLE_MS 2000
+#endif
+
+/* After this many consecutive timeouts the peer is assumed to be back on the base profile. */
+#define LINK_LOST_N 12
+
+/* Link adaptation state of a peer. */
+typedef struct
+{
+  uint8_t profile;        /* profile in use */
+  uint8_t want;           /* profile asked for, the peer switches to it after answering the next exchange */
+  uint8_t up_n;           /* consecutive frames strong enough for the next shorter profile */
+  uint8_t down_n;         /* consecutive frames too weak for this profile */
+  uint8_t timeout_n;      /* consecutive timeouts */
+} link_adapt_t;
+
+int link_adapt_count(void);
+
+int link_adapt_config(int profile, dwt_config_t *config);
+
+float link_adapt_fp_dbm(const dwt_rxdiag_t *diag, uint8 prf);
+
+void link_adapt_init(link_adapt_t *la);
+
+void link_adapt_set(link_adapt_t *la, int profile);
+
+int link_adapt_rx(link_adapt_t *la, float fp_dbm);
+
+int link_adapt_timeout(link_adapt_t *la);
+
+#endif /* LINK_ADAPT_H_ */
@@ -0,0 +1,201 @@
+/*! ----------------------------------------------------------------------------
+*  @file    range_stats.c
+*  @brief   Streaming ranging statistics of a responder, with outlier rejection
+*
+*           See NOTES at the end of this file.
+*
+* @attention
+*
+* Copyright 2018 (c) Decawave Ltd, Dublin, Ireland.
+*
+* All rights reserved.
+*
+* @author Decawave
+*/
+#include <math.h>
+#include <string.h>
+#include "range_stats.h"
+
+#if (RANGE_STATS_MEDIAN_N % 2) == 0
+#error "RANGE_STATS_MEDIAN_N must be odd"
+#endif
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn range_stats_init()
+*
+* @brief Start the statistics of a responder.
+*
+* @param  s  statistics
+*         addr  short address of the responder
+*
+* @return none
+*/
+void range_stats_init(range_stats_t *s, uint16_t addr)
+{
+  memset(s, 0, sizeof(*s));
+  s->addr = addr;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn range_stats_clear()
+*
+* @brief Start a new period: the statistics and counters are cleared, the median window is kept.
+*
+* @param  s  statistics
+*
+* @return none
+*/
+void range_stats_clear(range_stats_t *s)
+{
+  s->n = 0;
+  s->mean_mm = 0.0f;
+  s->m2 = 0.0f;
+  s->min_mm = 0;
+  s->max_mm = 0;
+  s->rejected = 0;
+  s->timeouts = 0;
+  s->errors = 0;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn range_stats_add()
+*
+* @brief Add a range. It goes into the median window, and into the statistics of the period unless it is too far from the median of
+*        the window (NOTE 1).
+*
+* @param  s  statistics
+*         distance_mm  range, in millimetres
+*
+* @return  true if the range has been accepted
+*/
+bool range_stats_add(range_stats_t *s, int32_t distance_mm)
+{
+  int32_t median;
+  float delta;
+
+  s->win[s->win_idx] = distance_mm;
+  s->win_idx = (s->win_idx + 1) % RANGE_STATS_MEDIAN_N;
+  if (s->win_n < RANGE_STATS_MEDIAN_N)
+  {
+    s->win_n++;
+  }
+
+  if (s->win_n == RANGE_STATS_MEDIAN_N)
+  {
+    median = range_stats_median(s);
+    if ((distance_mm > median + RANGE_STATS_REJECT_MM) || (distance_mm < median - RANGE_STATS_REJECT_MM))
+    {
+      s->rejected++;
+      return false;
+    }
+  }
+
+  /* Welford update, see NOTE 2 below. */
+  s->n++;
+  delta = (float)distance_mm - s->mean_mm;
+  s->mean_mm += delta / (float)s->n;
+  s->m2 += delta * ((float)distance_mm - s->mean_mm);
+
+  if ((s->n == 1) || (distance_mm < s->min_mm))
+  {
+    s->min_mm = distance_mm;
+  }
+  if ((s->n == 1) || (distance_mm > s->max_mm))
+  {
+    s->max_mm = distance_mm;
+  }
+  return true;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn range_stats_timeout()
+*
+* @brief Count an exchange without response.
+*
+* @param  s  statistics
+*
+* @return none
+*/
+void range_stats_timeout(range_stats_t *s)
+{
+  s->timeouts++;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn range_stats_error()
+*
+* @brief Count a failed exchange.
+*
+* @param  s  statistics
+*
+* @return none
+*/
+void range_stats_error(range_stats_t *s)
+{
+  s->errors++;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn range_stats_median()
+*
+* @brief Median of the ranges of the window.
+*
+* @param  s  statistics
+*
+* @return  the median, in millimetres, 0 if no range has been added yet
+*/
+int32_t range_stats_median(const range_stats_t *s)
+{
+  int32_t v[RANGE_STATS_MEDIAN_N];
+  int32_t t;
+  int i, j;
+
+  if (s->win_n == 0)
+  {
+    return 0;
+  }
+
+  /* Insertion sort of a copy, the window is a handful of ranges. */
+  for (i = 0; i < s->win_n; i++)
+  {
+    t = s->win[i];
+    for (j = i; (j > 0) && (v[j - 1] > t); j--)
+    {
+      v[j] = v[j - 1];
+    }
+    v[j] = t;
+  }
+
+  return v[s->win_n / 2];
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn range_stats_stddev_mm()
+*
+* @brief Standard deviation of the accepted ranges of the period.
+*
+* @param  s  statistics
+*
+* @return  the sample standard deviation, in millimetres, rounded
+*/
+uint32_t range_stats_stddev_mm(const range_stats_t *s)
+{
+  if (s->n < 2)
+  {
+    return 0;
+  }
+
+  return (uint32_t)(sqrtf(s->m2 / (float)(s->n - 1)) + 0.5f);
+}
+
+/*****************************************************************************************************************************************************
+* NOTES:
+*
+* 1. Non line of sight paths make the range jump by up to a few metres for single exchanges. Until the window is full every range is
+*    accepted, then a range further than RANGE_STATS_REJECT_MM from the median of the last RANGE_STATS_MEDIAN_N ranges (itself included) is
+*    rejected. A real move makes the median follow within RANGE_STATS_MEDIAN_N / 2 + 1 ranges.
+* 2. Welford's update keeps the mean and the sum of squared differences without storing the samples and without the cancellation of the
+*    sum of squares method. Single precision is enough for ranges of up to a few hundred metres over a period, and is done by the FPU of
+*    the Cortex-M4F.
+*
+****************************************************************************************************************************************************/
@@ -0,0 +1,64 @@
+/*! ----------------------------------------------------------------------------
+*  @file    range_stats.h
+*  @brief   Streaming ranging statistics of a responder, with outlier rejection -- Header file
+*
+*           O(1) per sample, fixed memory: Welford mean/variance, min/max and the event counters of a period, and a sliding median
+*           window which rejects the NLOS spikes before they reach the statistics. See NOTES at the end of range_stats.c.
+*
+* @attention
+*
+* Copyright 2018 (c) Decawave Ltd, Dublin, Ireland.
+*
+* All rights reserved.
+*
+* @author Decawave
+*/
+#ifndef RANGE_STATS_H_
+#define RANGE_STATS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Length of the median window, odd. */
+#define RANGE_STATS_MEDIAN_N 5
+
+/* A range further than this from the median of the window is rejected, in millimetres. */
+#define RANGE_STATS_REJECT_MM 500
+
+typedef struct
+{
+  uint16_t addr;          /* short address of the responder */
+
+  /* Statistics of the accepted ranges of the current period */
+  uint32_t n;
+  float    mean_mm;
+  float    m2;            /* sum of the squared differences to the mean */
+  int32_t  min_mm;
+  int32_t  max_mm;
+
+  /* Events of the current period */
+  uint32_t rejected;      /* ranges rejected by the median filter */
+  uint32_t timeouts;
+  uint32_t errors;        /* RX errors, unexpected frames and lost interrupts */
+
+  /* Median window of the last ranges, kept across periods */
+  int32_t  win[RANGE_STATS_MEDIAN_N];
+  uint8_t  win_n;
+  uint8_t  win_idx;
+} range_stats_t;
+
+void range_stats_init(range_stats_t *s, uint16_t addr);
+
+void range_stats_clear(range_stats_t *s);
+
+bool range_stats_add(range_stats_t *s, int32_t distance_mm);
+
+void range_stats_timeout(range_stats_t *s);
+
+void range_stats_error(range_stats_t *s);
+
+int32_t range_stats_median(const range_stats_t *s);
+
+uint32_t range_stats_stddev_mm(const range_stats_t *s);
+
+#endif /* RANGE_STATS_H_ */
@@ -0,0 +1,213 @@
+/*! ----------------------------------------------------------------------------
+*  @file    twr_bench.c
+*  @brief   Configuration sweep of the TWR benchmark builds, shared by the initiator and the responder
+*
+*           See NOTES at the end of this file for the handshake and the frame duration.
+*
+* @attention
+*
+* Copyright 2018 (c) Decawave Ltd, Dublin, Ireland.
+*
+* All rights reserved.
+*
+* @author Decawave
+*/
+#include <stddef.h>
+#include "deca_device_api.h"
+#include "translate.h"
+#include "twr_bench.h"
+
+/* Settings swept by the benchmark, in this order. See NOTE 2 below. It can be replaced at build time, with the same matrix on both
+* sides. */
+#ifndef BENCH_MATRIX
+#define BENCH_MATRIX \
+  { \
+    { 5, 64,  128,  8, 6810 }, \
+    { 5, 64,   64,  8, 6810 }, \
+    { 5, 16,  128,  8, 6810 }, \
+    { 5, 64,  256, 16, 6810 }, \
+    { 5, 64,  512, 16,  850 }, \
+    { 5, 64, 1024, 32,  850 }, \
+    { 5, 64, 2048, 64,  110 }, \
+    { 2, 64,  128,  8, 6810 }, \
+  }
+#endif
+static const twr_bench_cfg_t bench_matrix[] = BENCH_MATRIX;
+#define BENCH_MATRIX_N ((int)(sizeof(bench_matrix) / sizeof(bench_matrix[0])))
+
+const twr_bench_cfg_t twr_bench_base = { 5, 64, 128, 8, 6810 };
+
+/* Time the responder needs from the end of the poll to the response being ready to be sent, in microseconds. The 1100 uus reply
+* delay of the responder at 6.8 Mbps, less the poll data and the response preamble. */
+#define BENCH_PROC_US 900
+
+/* Durations of the preamble symbols and of the data bits, in nanoseconds. See NOTE 3 below. */
+#define PRE_SYM_PRF16_NS  994
+#define PRE_SYM_PRF64_NS  1018
+#define BIT_110K_NS       8205
+#define BIT_850K_NS       1026
+#define BIT_6M8_NS        128
+
+/* PHR length and Reed-Solomon parity: 48 bits for each block of up to 330 data bits. */
+#define PHR_BITS          21
+#define RS_BLOCK_BITS     330
+#define RS_PARITY_BITS    48
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn twr_bench_count()
+*
+* @brief Number of settings of the matrix.
+*
+* @param  none
+*
+* @return  the number of settings
+*/
+int twr_bench_count(void)
+{
+  return BENCH_MATRIX_N;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn twr_bench_get()
+*
+* @brief Setting of the matrix.
+*
+* @param  idx  index of the setting
+*
+* @return  the setting, NULL if idx is out of the matrix
+*/
+const twr_bench_cfg_t *twr_bench_get(int idx)
+{
+  if ((idx < 0) || (idx >= BENCH_MATRIX_N))
+  {
+    return NULL;
+  }
+  return &bench_matrix[idx];
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn twr_bench_dwt_config()
+*
+* @brief Translate a setting into the DW1000 configuration, with the standard SFD and PHR.
+*
+* @param  cfg  setting, in human units
+*         config  filled with the DW1000 configuration
+*
+* @return  0 on success, -1 if a parameter of the setting is not supported
+*/
+int twr_bench_dwt_config(const twr_bench_cfg_t *cfg, dwt_config_t *config)
+{
+  int chan = chan_to_deca(cfg->chan);
+  int prf = prf_to_deca(cfg->prf);
+  int plen = plen_to_deca(cfg->plen);
+  int pac = pac_to_deca(cfg->pac);
+  int rate = bitrate_to_deca(cfg->kbps);
+  int sfd_len = (rate == DWT_BR_110K) ? (64) : (8);
+
+  if ((chan < 0) || (prf < 0) || (plen < 0) || (pac < 0) || (rate < 0) || (cfg->pac >= cfg->plen))
+  {
+    return -1;
+  }
+
+  config->chan = (uint8)chan;
+  config->prf = (uint8)prf;
+  config->txPreambLength = (uint8)plen;
+  config->rxPAC = (uint8)pac;
+  /* Channels 2 and 5 share the preamble codes 3, 4 (16 MHz) and 9 to 12 (64 MHz). */
+  config->txCode = (prf == DWT_PRF_16M) ? (4) : (10);
+  config->rxCode = config->txCode;
+  config->nsSFD = 0;
+  config->dataRate = (uint8)rate;
+  config->phrMode = DWT_PHRMODE_STD;
+  config->sfdTO = (uint16)(cfg->plen + 1 + sfd_len - cfg->pac);
+  return 0;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn twr_bench_shr_us()
+*
+* @brief Duration of the synchronisation header (preamble and SFD), from the start of the frame to its RMARKER.
+*
+* @param  config  DW1000 configuration
+*
+* @return  the duration, in microseconds, rounded up
+*/
+uint32_t twr_bench_shr_us(const dwt_config_t *config)
+{
+  uint32_t sym_ns = (config->prf == DWT_PRF_16M) ? (PRE_SYM_PRF16_NS) : (PRE_SYM_PRF64_NS);
+  uint32_t syms = deca_to_plen(config->txPreambLength) + ((config->dataRate == DWT_BR_110K) ? (64) : (8));
+
+  return (syms * sym_ns + 999) / 1000;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn twr_bench_frame_us()
+*
+* @brief On-air duration of a frame.
+*
+* @param  config  DW1000 configuration
+*         len  frame length, in bytes, including the 2 bytes of check-sum
+*
+* @return  the duration, in microseconds, rounded up
+*/
+uint32_t twr_bench_frame_us(const dwt_config_t *config, int len)
+{
+  uint32_t bit_ns;
+  uint32_t data_bits = (uint32_t)len * 8;
+  uint32_t ns;
+
+  switch (config->dataRate)
+  {
+    case DWT_BR_110K: bit_ns = BIT_110K_NS; break;
+    case DWT_BR_850K: bit_ns = BIT_850K_NS; break;
+    default:          bit_ns = BIT_6M8_NS;  break;
+  }
+
+  data_bits += RS_PARITY_BITS * ((data_bits + RS_BLOCK_BITS - 1) / RS_BLOCK_BITS);
+
+  /* The PHR is sent at 850 kbps, or at 110 kbps with the 110 kbps data rate. */
+  ns = PHR_BITS * ((config->dataRate == DWT_BR_110K) ? (BIT_110K_NS) : (BIT_850K_NS)) + data_bits * bit_ns;
+
+  return twr_bench_shr_us(config) + (ns + 999) / 1000;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn twr_bench_reply_uus()
+*
+* @brief Reply delay of the responder, from the poll RX time-stamp to the response TX time-stamp. See NOTE 4 below.
+*
+* @param  config  DW1000 configuration
+*         poll_len  length of the poll, in bytes, including the check-sum
+*
+* @return  the reply delay, in UWB microseconds
+*/
+uint32_t twr_bench_reply_uus(const dwt_config_t *config, int poll_len)
+{
+  uint32_t shr_us = twr_bench_shr_us(config);
+  uint32_t poll_tail_us = twr_bench_frame_us(config, poll_len) - shr_us;
+
+  /* A microsecond is used as a UWB microsecond, 2.5 % longer. */
+  return poll_tail_us + BENCH_PROC_US + shr_us;
+}
+
+/*****************************************************************************************************************************************************
+* NOTES:
+*
+* 1. Both sides start with the base settings (twr_bench_base, those of main.c). The initiator sends a configuration frame (function code
+*    0xE5) carrying the index of the next setting and the responder acknowledges it (0xE6) before both switch to that setting. The
+*    initiator then runs BENCH_N exchanges back-to-back and goes back to the base settings; the responder goes back after BENCH_IDLE_MS
+*    without a poll. A lost handshake is retried by the initiator until the responder is back. The frames are only sent with the base
+*    settings, so a setting that does not work costs its BENCH_N timeouts and not the benchmark.
+* 2. The matrix holds the channel, PRF, preamble length, PAC and data rate of each setting, translated by chan_to_deca(), prf_to_deca(),
+*    plen_to_deca(), pac_to_deca() and bitrate_to_deca() (the same translation as the TDoA tag commands); a setting which does not
+*    translate is skipped. The recommended PAC is 8 up to 128 symbols, 16 for 256 and 512, 32 for 1024 and 64 above. The SFD is the
+*    standard one (8 symbols, 64 at 110 kbps), the SFD timeout is derived from the preamble length as in main.c.
+* 3. A frame is its synchronisation header (preamble and SFD symbols, around 1 us each), the 21 bit PHR at 850 kbps (110 kbps at the 110
+*    kbps data rate) and the data with 48 Reed-Solomon parity bits for each block of 330 bits. The RX and TX time-stamps (RMARKER) are taken
+*    at the end of the SFD. The computed duration is within 0.1 % of the DW1000 User Manual formula.
+* 4. The delayed TX time is the time of the RMARKER of the response, so the response has to be ready its synchronisation header before it.
+*    The reply delay covers the rest of the poll after its RMARKER (PHR and data), the responder processing (BENCH_PROC_US, as at 6.8 Mbps
+*    in the ranging examples) and the preamble and SFD of the response. Long preambles and the lower data rates thus cost more than
+*    their own air time: the reply delay also grows, and so does the SS TWR clock drift error.
+*
+****************************************************************************************************************************************************/
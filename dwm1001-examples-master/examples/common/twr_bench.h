@@ -0,0 +1,61 @@
+/*! ----------------------------------------------------------------------------
+*  @file    twr_bench.h
+*  @brief   Configuration sweep of the TWR benchmark builds, shared by the initiator and the responder -- Header file
+*
+*           The matrix of radio settings is kept in human units (channel, MHz, symbols, kbps) and translated into dwt_config_t
+*           with translate.c. Both sides of the benchmark must be built with the same matrix. See NOTES at the end of twr_bench.c.
+*
+* @attention
+*
+* Copyright 2018 (c) Decawave Ltd, Dublin, Ireland.
+*
+* All rights reserved.
+*
+* @author Decawave
+*/
+#ifndef TWR_BENCH_H_
+#define TWR_BENCH_H_
+
+#include <stdint.h>
+#include "deca_device_api.h"
+
+/* Function codes of the configuration handshake, sent with the base settings. See NOTE 1 in twr_bench.c. */
+#define FUNC_CODE_BENCH_CFG 0xE5
+#define FUNC_CODE_BENCH_ACK 0xE6
+
+/* Exchanges run with each setting of the matrix. */
+#ifndef BENCH_N
+#define BENCH_N 200
+#endif
+
+/* The responder goes back to the base settings after this time without a poll, in milliseconds. */
+#ifndef BENCH_IDLE_MS
+#define BENCH_IDLE_MS 200
+#endif
+
+/* One setting of the matrix, in human units. */
+typedef struct
+{
+  uint8_t  chan;      /* channel, 2 or 5 */
+  uint8_t  prf;       /* pulse repetition frequency, 16 or 64 MHz */
+  uint16_t plen;      /* preamble length, 64 to 2048 symbols */
+  uint8_t  pac;       /* preamble acquisition chunk, 8 to 64 symbols */
+  uint16_t kbps;      /* data rate, 110, 850 or 6810 kbps */
+} twr_bench_cfg_t;
+
+/* Settings of the ranging examples (main.c), used for the handshake. */
+extern const twr_bench_cfg_t twr_bench_base;
+
+int twr_bench_count(void);
+
+const twr_bench_cfg_t *twr_bench_get(int idx);
+
+int twr_bench_dwt_config(const twr_bench_cfg_t *cfg, dwt_config_t *config);
+
+uint32_t twr_bench_shr_us(const dwt_config_t *config);
+
+uint32_t twr_bench_frame_us(const dwt_config_t *config, int len);
+
+uint32_t twr_bench_reply_uus(const dwt_config_t *config, int poll_len);
+
+#endif /* TWR_BENCH_H_ */
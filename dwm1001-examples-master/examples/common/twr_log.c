@@ -0,0 +1,111 @@
+/*! ----------------------------------------------------------------------------
+*  @file    twr_log.c
+*  @brief   Deferred binary log of the TWR exchanges
+*
+*           Single producer, single consumer ring of twr_log_rec_t records, without any lock. See NOTES at the end of this file.
+*
+* @attention
+*
+* Copyright 2018 (c) Decawave Ltd, Dublin, Ireland.
+*
+* All rights reserved.
+*
+* @author Decawave
+*/
+#include "nrf.h"
+#include "twr_log.h"
+
+#define TWR_LOG_MASK (TWR_LOG_SIZE - 1)
+
+#if (TWR_LOG_SIZE & TWR_LOG_MASK) != 0
+#error "TWR_LOG_SIZE must be a power of 2"
+#endif
+
+static twr_log_rec_t log_ring[TWR_LOG_SIZE];
+
+/* Free running indexes, head is only written by the producer and tail by the consumer. */
+static volatile uint32_t log_head = 0;
+static volatile uint32_t log_tail = 0;
+
+/* Records which did not fit into the ring, only written by the producer. */
+static volatile uint32_t log_dropped = 0;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn twr_log_put()
+*
+* @brief Append a record to the ring. It never blocks: when the ring is full the record is dropped and counted.
+*
+* @param  rec  record to append
+*
+* @return  true if the record has been appended, false if it has been dropped
+*/
+bool twr_log_put(const twr_log_rec_t *rec)
+{
+  uint32_t head = log_head;
+
+  if (head - log_tail >= TWR_LOG_SIZE)
+  {
+    log_dropped++;
+    return false;
+  }
+
+  log_ring[head & TWR_LOG_MASK] = *rec;
+
+  /* The record must be complete before the consumer sees it. */
+  __DMB();
+  log_head = head + 1;
+  return true;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn twr_log_get()
+*
+* @brief Take the oldest record out of the ring.
+*
+* @param  rec  filled with the record
+*
+* @return  false if the ring is empty
+*/
+bool twr_log_get(twr_log_rec_t *rec)
+{
+  uint32_t tail = log_tail;
+
+  if (tail == log_head)
+  {
+    return false;
+  }
+
+  /* Read the record only after having seen the head which publishes it. */
+  __DMB();
+  *rec = log_ring[tail & TWR_LOG_MASK];
+
+  /* The slot may only be reused once it has been copied. */
+  __DMB();
+  log_tail = tail + 1;
+  return true;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn twr_log_dropped()
+*
+* @brief Number of records dropped because the ring was full, since the start up.
+*
+* @param  none
+*
+* @return  the number of dropped records
+*/
+uint32_t twr_log_dropped(void)
+{
+  return log_dropped;
+}
+
+/*****************************************************************************************************************************************************
+* NOTES:
+*
+* 1. There must be only one producer and one consumer, each of them only writes its own index so no lock and no atomic read-modify-write is
+*    needed. The DW1000 callbacks (interrupt context) must not log directly: they signal the ranging task which writes the record.
+* 2. The indexes are free running 32-bit counters, head - tail is the number of records in the ring even across their wrap around.
+* 3. A record is 28 bytes, at 115200 baud its text form takes several milliseconds to print. The consumer task is given a priority below the
+*    ranging task so the prints only use the time between the exchanges, a burst of up to TWR_LOG_SIZE exchanges is absorbed by the ring.
+*
+****************************************************************************************************************************************************/
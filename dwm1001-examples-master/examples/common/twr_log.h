@@ -0,0 +1,58 @@
+/*! ----------------------------------------------------------------------------
+*  @file    twr_log.h
+*  @brief   Deferred binary log of the TWR exchanges -- Header file
+*
+*           The ranging task writes one fixed-size record per exchange into a ring and a low priority task formats and
+*           prints them, so that the UART does not limit the ranging rate. See NOTES at the end of twr_log.c.
+*
+* @attention
+*
+* Copyright 2018 (c) Decawave Ltd, Dublin, Ireland.
+*
+* All rights reserved.
+*
+* @author Decawave
+*/
+#ifndef TWR_LOG_H_
+#define TWR_LOG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Number of records of the ring, must be a power of 2. */
+#define TWR_LOG_SIZE 16
+
+/* Outcome of an exchange. */
+typedef enum
+{
+  TWR_LOG_RANGE = 0,   /* distance_mm is valid */
+  TWR_LOG_NO_TX,       /* no transmission confirmation */
+  TWR_LOG_TIMEOUT,     /* no response received */
+  TWR_LOG_RX_ERROR,    /* corrupted frame, it may be from a different UWB device */
+  TWR_LOG_BAD_FRAME,   /* a frame which is not the expected response */
+  TWR_LOG_LOST_IRQ,    /* no DW1000 event at all */
+  TWR_LOG_FINAL,       /* DS TWR final sent, the distance is computed by the responder */
+  TWR_LOG_FINAL_LATE   /* DS TWR final could not be sent in time */
+} twr_log_status_t;
+
+/* Log record of an exchange, the time-stamps are the low 32 bits in dtu. */
+typedef struct
+{
+  uint32_t seq;         /* exchange (or epoch) number */
+  uint8_t  status;      /* twr_log_status_t */
+  uint8_t  frame_seq;   /* sequence number of the poll */
+  uint16_t resp_addr;   /* short address of the responder */
+  uint32_t poll_tx_ts;
+  uint32_t resp_rx_ts;
+  uint32_t poll_rx_ts;  /* from the response */
+  uint32_t resp_tx_ts;  /* from the response */
+  int32_t  distance_mm;
+} twr_log_rec_t;
+
+bool twr_log_put(const twr_log_rec_t *rec);
+
+bool twr_log_get(twr_log_rec_t *rec);
+
+uint32_t twr_log_dropped(void);
+
+#endif /* TWR_LOG_H_ */
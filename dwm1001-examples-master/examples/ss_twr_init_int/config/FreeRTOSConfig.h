@@ -0,0 +1,43 @@
+/*! ----------------------------------------------------------------------------
+*  @file    FreeRTOSConfig.h
+*  @brief   FreeRTOS configuration of the TWR examples
+*
+*           The configuration of the SDK (external/freertos/config/FreeRTOSConfig.h, found after ../config in the include path)
+*           with the tickless idle of the RTC tick source, see TWR_TICKLESS_IDLE below.
+*
+* @attention
+*
+* Copyright 2018 (c) Decawave Ltd, Dublin, Ireland.
+*
+* All rights reserved.
+*
+* @author Decawave
+*/
+#ifndef TWR_FREERTOS_CONFIG_H
+#define TWR_FREERTOS_CONFIG_H
+
+#include_next "FreeRTOSConfig.h"
+
+/* 1 to stop the tick while all the tasks are blocked: the idle task sleeps in vPortSuppressTicksAndSleep() (port_cmsis_systick.c)
+* until the next timeout of a task or timer, which the RTC wakes up, or until an interrupt, e.g. the DW1000 IRQ. 0 for the 1 kHz
+* tick of the SDK configuration. See the notes of main.c. */
+#ifndef TWR_TICKLESS_IDLE
+#define TWR_TICKLESS_IDLE 1
+#endif
+
+#if TWR_TICKLESS_IDLE
+
+#if (configTICK_SOURCE != FREERTOS_USE_RTC)
+#error "TWR_TICKLESS_IDLE needs the RTC tick source, the SysTick stops in sleep"
+#endif
+
+#undef configUSE_TICKLESS_IDLE
+#define configUSE_TICKLESS_IDLE 1
+
+/* Shorter idle times are not worth the RTC reprogramming, in ticks. */
+#undef configEXPECTED_IDLE_TIME_BEFORE_SLEEP
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP 2
+
+#endif // #if TWR_TICKLESS_IDLE
+
+#endif // #ifndef TWR_FREERTOS_CONFIG_H
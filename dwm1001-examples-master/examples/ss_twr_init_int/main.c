@@ -60,10 +60,9 @@ static dwt_config_t config = {
 /* Delay between frames, in UWB microseconds. See NOTE 1 below. */
 #define POLL_TX_TO_RESP_RX_DLY_UUS 100 
 
-/*Should be accurately calculated during calibration*/
-/* Assume units are UWB microseconds (1 uus = 512/499.2 ms) */
-#define TX_ANT_DLY 16476//16300
-#define RX_ANT_DLY 16456	
+/* RESP_RX_TIMEOUT_UUS, the receive response timeout, is defined in ss_init_main.h. See NOTE 3 below. */
+
+/* TX_ANT_DLY and RX_ANT_DLY are defined in ss_init_main.h. */
 
 //--------------dw1000---end---------------
 
@@ -75,6 +74,8 @@ static dwt_config_t config = {
 
 TaskHandle_t  ss_initiator_task_handle;   /**< Reference to SS TWR Initiator FreeRTOS task. */
 extern void ss_initiator_task_function (void * pvParameter);
+TaskHandle_t  ss_log_task_handle;   /**< Reference to SS TWR Initiator log FreeRTOS task. */
+extern void ss_log_task_function (void * pvParameter);
 TaskHandle_t  led_toggle_task_handle;   /**< Reference to LED0 toggling FreeRTOS task. */
 TimerHandle_t led_toggle_timer_handle;  /**< Reference to LED1 toggling FreeRTOS timer. */
 #endif
@@ -131,6 +132,9 @@ int main(void)
 
     /* Create task for SS TWR Initiator set to 2 */
     UNUSED_VARIABLE(xTaskCreate(ss_initiator_task_function, "SSTWR_INIT", configMINIMAL_STACK_SIZE + 200, NULL, 2, &ss_initiator_task_handle));
+
+    /* Create task printing the ranging log set to 1, below the initiator so the UART only uses the time between exchanges */
+    UNUSED_VARIABLE(xTaskCreate(ss_log_task_function, "SSTWR_LOG", configMINIMAL_STACK_SIZE + 200, NULL, 1, &ss_log_task_handle));
   #endif // #ifdef USE_FREERTOS
   
   //-------------dw1000  ini------------------------------------	
@@ -161,6 +165,11 @@ int main(void)
   /* Configure DW1000. */
   dwt_configure(&config);
 
+  /* Only accept the data frames of this PAN addressed to the initiator (or broadcast). See NOTE 6 below. */
+  dwt_setpanid(TWR_PAN_ID);
+  dwt_setaddress16(INIT_ADDR);
+  dwt_enableframefilter(DWT_FF_DATA_EN);
+
   /* Initialization of the DW1000 interrupt*/
   /* Callback are defined in ss_init_main.c */
   dwt_setcallbacks(&tx_conf_cb, &rx_ok_cb, &rx_to_cb, &rx_err_cb);
@@ -178,7 +187,7 @@ int main(void)
   /* Set expected response's delay and timeout. 
   * As this example only handles one incoming frame with always the same delay and timeout, those values can be set here once for all. */
   dwt_setrxaftertxdelay(POLL_TX_TO_RESP_RX_DLY_UUS);
-  dwt_setrxtimeout(65000); // Maximum value timeout with DW1000 is 65ms  
+  dwt_setrxtimeout(RESP_RX_TIMEOUT_UUS); // a responder which does not answer only delays the epoch by this timeout
 
   //-------------dw1000  ini------end---------------------------	
   // IF WE GET HERE THEN THE LEDS WILL BLINK
@@ -222,8 +231,9 @@ void vInterruptInit (void)
   else
     nrf_drv_gpiote_init();
 
-  // input pin, +ve edge interrupt, no pull-up
-  nrf_drv_gpiote_in_config_t in_config = GPIOTE_CONFIG_IN_SENSE_LOTOHI(true);
+  // input pin, +ve edge interrupt, no pull-up. With TWR_TICKLESS_IDLE (config/FreeRTOSConfig.h) it is sensed by the PORT event, which
+  // does not keep the high frequency clock running in sleep, the callbacks only follow the time-stamped frames.
+  nrf_drv_gpiote_in_config_t in_config = GPIOTE_CONFIG_IN_SENSE_LOTOHI(!TWR_TICKLESS_IDLE);
   in_config.pull = NRF_GPIO_PIN_NOPULL;
 
   // Link this pin interrupt source to its interrupt handler
@@ -252,6 +262,12 @@ void vInterruptInit (void)
  *    the dwt_configuretxrf API call) to per device calibrated values saved in the target system or the DW1000 OTP memory.
  * 5. The user is referred to DecaRanging ARM application (distributed with EVK1000 product) for additional practical example of usage, and to the
  *     DW1000 API Guide for more details on the DW1000 driver functions.
+ * 6. With the frame filter, the DW1000 drops the frames of other PANs, the frames which are not data frames and the frames addressed to
+ *    other devices: the receiver keeps listening and, the rejection interrupt (DWT_INT_ARFE) being masked, the MCU is not woken up. Foreign
+ *    frames on the channel then cost no ISR, no frame read and no RX reset, only the responses to this initiator reach rx_ok_cb(). The
+ *    rejection is still latched in the status register, so dwt_isr() may report it with the next good frame: ss_init_main.c clears it
+ *    before each exchange. The PAN ID and addresses are those of the frames of ss_init_main.c, the filter settings are kept by
+ *    dwt_configure() (benchmark settings too).
  *
  ****************************************************************************************************************************************************/
 
@@ -22,28 +22,132 @@
 */
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 #include "FreeRTOS.h"
 #include "task.h"
 #include "deca_device_api.h"
 #include "deca_regs.h"
 #include "port_platform.h"
 #include "ss_init_main.h"
+#include "dw_ts.h"
+#include "twr_log.h"
+#include "range_stats.h"
+#include "twr_bench.h"
+#include "link_adapt.h"
 
 #define APP_NAME "SS TWR INIT v1.3"
 
-/* Inter-ranging delay period, in milliseconds. */
+/* Ranging epoch period, in milliseconds: all the responders are ranged back-to-back once per epoch. */
 #define RNG_DELAY_MS 250
 
+/* Short addresses of the responders, ranged in this order. See NOTE 9 below. Each responder is an ss_twr_resp build with its own
+* RESP_ADDR, 0x4157 ('W', 'A') is the address of its default build. */
+#ifndef SS_RESPONDERS
+#define SS_RESPONDERS { 0x4157 }
+#endif
+static const uint16 responder_addr[] = SS_RESPONDERS;
+#define N_RESPONDERS (sizeof(responder_addr) / sizeof(responder_addr[0]))
+
+/* Results of the current epoch, one slot per responder, flushed together to the log at the end of the epoch. */
+static twr_log_rec_t range_slot[N_RESPONDERS];
+
+/* Period of the ranging statistics report, in milliseconds. See NOTE 11 below. */
+#ifndef STATS_PERIOD_MS
+#define STATS_PERIOD_MS 1000
+#endif
+
+/* 1 to print every exchange as well, 0 to only print the statistics. */
+#ifndef SS_LOG_RAW
+#define SS_LOG_RAW 0
+#endif
+
+/* Ranging statistics of each responder, only used by the log task. */
+static range_stats_t range_stats[N_RESPONDERS];
+
+/* Ranging scheme, 0 for single-sided TWR, 1 for asymmetric double-sided TWR. See NOTE 10 below. It can be changed at run time with
+* ss_init_set_ds(). */
+#ifndef TWR_DS
+#define TWR_DS 0
+#endif
+static volatile int twr_ds = TWR_DS;
+
+/* Broadcast poll mode, 1 for one poll per epoch answered by every responder in its own slot. See NOTE 12 below. It can be changed at
+* run time with ss_init_set_bcast(), it takes precedence over TWR_DS. */
+#ifndef TWR_BCAST
+#define TWR_BCAST 0
+#endif
+static volatile int twr_bcast = TWR_BCAST;
+
+/* Configuration sweep benchmark, 1 to step the first responder of SS_RESPONDERS through the settings of twr_bench.c instead of the
+* ranging epochs. The responder must be a TWR_BENCH build too. See NOTE 13 below. */
+#ifndef TWR_BENCH
+#define TWR_BENCH 0
+#endif
+
+/* Handshake tries before a setting is given up, spaced to cover BENCH_IDLE_MS of the responder twice. */
+#define BENCH_CFG_TRIES 20
+#define BENCH_CFG_RETRY_MS (BENCH_IDLE_MS / 10)
+
+/* Margin of the RX timeout of the benchmark over the reply delay and the response, in UWB microseconds. */
+#define BENCH_RX_MARGIN_UUS 300
+
+/* Link adaptation, 1 to choose the preamble length and data rate of each responder from the diagnostics of its responses
+* (link_adapt.c). The responders must be built from this tree. See NOTE 14 below. Not used with TWR_BCAST or TWR_BENCH. */
+#ifndef TWR_LINK_ADAPT
+#define TWR_LINK_ADAPT 0
+#endif
+
 /* Frames used in the ranging process. See NOTE 1,2 below. */
-static uint8 tx_poll_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 'W', 'A', 'V', 'E', 0xE0, 0, 0};
+#define RESP_FRAME_LEN 20
+static uint8 tx_poll_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 'W', 'A', 'V', 'E', 0xE0, 0, 0, 0};
+/* With TWR_LINK_ADAPT the poll carries the profile asked for, one byte after the function code. */
+#define POLL_MSG_PROFILE_IDX 10
+#define POLL_FRAME_LEN ((TWR_LINK_ADAPT) ? (sizeof(tx_poll_msg)) : (sizeof(tx_poll_msg) - 1))
 static uint8 rx_resp_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 'V', 'E', 'W', 'A', 0xE1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+/* Frames of the DS TWR exchange, the poll is tx_poll_msg with its own function code. */
+static uint8 rx_ds_resp_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 'V', 'E', 'W', 'A', 0x10, 0, 0};
+static uint8 tx_final_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 'W', 'A', 'V', 'E', 0x23, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+#define FUNC_CODE_SS_POLL 0xE0
+#define FUNC_CODE_DS_POLL 0x21
+#define FUNC_CODE_BCAST_POLL 0xE2
+/* Handshake frames of the benchmark, carrying the index of the setting. */
+static uint8 tx_bench_cfg_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 'W', 'A', 'V', 'E', FUNC_CODE_BENCH_CFG, 0, 0, 0};
+static uint8 rx_bench_ack_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 'V', 'E', 'W', 'A', FUNC_CODE_BENCH_ACK, 0, 0, 0};
+#define BENCH_MSG_IDX_IDX 10
+#define BCAST_ADDR 0xFFFF
+
+/* Response slots of the broadcast poll, they must match ss_resp_main.c: the responder of index i of SS_RESPONDERS answers
+* BCAST_RESP_DLY_UUS + i * BCAST_SLOT_UUS after the poll. */
+#define BCAST_RESP_DLY_UUS 1100
+#define BCAST_SLOT_UUS 400
+
+/* Responses received in the broadcast poll window, copied by rx_ok_cb() so that the receiver can be re-enabled at once. */
+typedef struct
+{
+  uint8 frame[RESP_FRAME_LEN];
+  uint32 rx_ts;
+  int32 ci;
+} bcast_rx_t;
+static bcast_rx_t bcast_rx[N_RESPONDERS];
+static volatile int bcast_rx_n = 0;
+static volatile int bcast_active = 0;
 /* Length of the common part of the message (up to and including the function code, see NOTE 1 below). */
 #define ALL_MSG_COMMON_LEN 10
 /* Indexes to access some of the fields in the frames defined above. */
 #define ALL_MSG_SN_IDX 2
+#define ALL_MSG_DST_IDX 5
+#define ALL_MSG_SRC_IDX 7
 #define RESP_MSG_POLL_RX_TS_IDX 10
 #define RESP_MSG_RESP_TX_TS_IDX 14
 #define RESP_MSG_TS_LEN 4
+#define ALL_MSG_FUNC_IDX 9
+#define FINAL_MSG_POLL_TX_TS_IDX 10
+#define FINAL_MSG_RESP_RX_TS_IDX 14
+#define FINAL_MSG_FINAL_TX_TS_IDX 18
+#define FINAL_MSG_TS_LEN 4
+/* Delay from the response RX time-stamp to the final TX, in UWB microseconds. The task has to be woken up, read the time-stamps and
+* write the final message in this time. See NOTE 10 below. */
+#define RESP_RX_TO_FINAL_TX_DLY_UUS 2000
 /* Frame sequence number, incremented after each transmission. */
 static uint8 frame_seq_nb = 0;
 
@@ -59,72 +163,281 @@ static uint32 status_reg = 0;
 * 1 uus = 512 / 499.2 s and 1 s = 499.2 * 128 dtu. */
 #define UUS_TO_DWT_TIME 65536
 
-/* Speed of light in air, in metres per second. */
-#define SPEED_OF_LIGHT 299702547
+/* Hold copies of computed time of flight (doubled, in dtu) and distance (in mm) here for reference so that it can be examined at a debug
+* breakpoint. */
+static int64_t tof2;
+static int32_t distance_mm;
+
+/* DW1000 events signalled by the callbacks to the initiator task, as task notification bits. See NOTE 7 below. */
+#define SS_EVT_TX   0x01 // Transmit success
+#define SS_EVT_RX   0x02 // Receive success
+#define SS_EVT_TO   0x04 // Timeout
+#define SS_EVT_ER   0x08 // Error
+
+/* Time the task waits for the DW1000 events, in milliseconds. The RX wait covers the RX timeout programmed in main()
+* (RESP_RX_TIMEOUT_UUS, around 2 ms), a wait which expires means that an interrupt was lost. */
+#define TX_CONF_WAIT_MS 5
+#define RX_EVT_WAIT_MS 10
+
+/* RX event wait in use, longer for the slow settings of the benchmark. */
+static uint32_t rx_evt_wait_ms = RX_EVT_WAIT_MS;
+
+/* Channel and data rate of the DW1000 configuration in use, for the clock offset ratio. */
+static uint8 rng_chan = 5;
+static uint8 rng_rate = DWT_BR_6M8;
 
-/* Hold copies of computed time of flight and distance here for reference so that it can be examined at a debug breakpoint. */
-static double tof;
-static double distance;
+/* Link adaptation state of each responder, and the profile the DW1000 is configured with (-1 for a benchmark setting). */
+static link_adapt_t link_state[N_RESPONDERS];
+static int radio_profile = LINK_PROFILE_BASE;
 
-/* Declaration of static functions. */
-static void resp_msg_get_ts(uint8 *ts_field, uint32 *ts);
+/* Initiator task, set when it starts, and the events it has been notified of but not handled yet. */
+static TaskHandle_t ss_task = NULL;
+static uint32_t ss_events = 0;
 
-/*Interrupt flag*/
-static volatile int tx_int_flag = 0 ; // Transmit success interrupt flag
-static volatile int rx_int_flag = 0 ; // Receive success interrupt flag
-static volatile int to_int_flag = 0 ; // Timeout interrupt flag
-static volatile int er_int_flag = 0 ; // Error interrupt flag 
+/* Log task, woken up for each record written into the log ring. See NOTE 8 below. */
+static TaskHandle_t ss_log_task = NULL;
 
-/*Transactions Counters */
-static volatile int tx_count = 0 ; // Successful transmit counter
-static volatile int rx_count = 0 ; // Successful receive counter 
+/* Epoch counter, the sequence number of the log records. */
+static uint32_t epoch_count = 0;
 
 
 /*! ------------------------------------------------------------------------------------------------------------------
-* @fn main()
+* @fn ss_signal()
 *
-* @brief Application entry point.
+* @brief Notify the initiator task of DW1000 events, called by the callbacks from the DW1000 interrupt.
 *
-* @param  none
+* @param  events  SS_EVT_xx bits
 *
 * @return none
 */
-int ss_init_run(void)
+static void ss_signal(uint32_t events)
+{
+  BaseType_t woken = pdFALSE;
+
+  if (ss_task != NULL)
+  {
+    xTaskNotifyFromISR(ss_task, events, eSetBits, &woken);
+    portYIELD_FROM_ISR(woken);
+  }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn ss_wait()
+*
+* @brief Block the initiator task until one of the wanted DW1000 events has been signalled, or the wait expires. Events which are
+*        not waited for are kept for the next wait.
+*
+* @param  mask  SS_EVT_xx bits to wait for
+*         wait_ms  maximum time to wait, in milliseconds
+*
+* @return  the events of mask which have been signalled, 0 if the wait expired
+*/
+static uint32_t ss_wait(uint32_t mask, uint32_t wait_ms)
+{
+  TickType_t start = xTaskGetTickCount();
+  TickType_t wait = pdMS_TO_TICKS(wait_ms) + 1;
+  TickType_t elapsed;
+  uint32_t notified;
+  uint32_t events;
+
+  while (!(ss_events & mask))
+  {
+    elapsed = xTaskGetTickCount() - start;
+    if ((elapsed >= wait) || (xTaskNotifyWait(0, 0xFFFFFFFFUL, &notified, wait - elapsed) == pdFALSE))
+    {
+      return 0;
+    }
+    ss_events |= notified;
+  }
+
+  events = ss_events & mask;
+  ss_events &= ~mask;
+  return events;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn ss_log_flush()
+*
+* @brief Write the records of an epoch into the log ring and wake up the log task once. It never blocks.
+*
+* @param  rec  records of the epoch
+*         n  number of records
+*
+* @return none
+*/
+static void ss_log_flush(const twr_log_rec_t *rec, int n)
+{
+  int logged = 0;
+  int i;
+
+  for (i = 0; i < n; i++)
+  {
+    logged |= twr_log_put(&rec[i]);
+  }
+
+  if (logged && (ss_log_task != NULL))
+  {
+    xTaskNotifyGive(ss_log_task);
+  }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn ss_ds_final()
+*
+* @brief Send the final message of a DS TWR exchange, carrying the initiator time-stamps. The responder computes the distance.
+*
+* @param  rec  record of the exchange, its status is updated
+*
+* @return none
+*/
+static void ss_ds_final(twr_log_rec_t *rec)
+{
+  uint64_t poll_tx_ts, resp_rx_ts, final_tx_ts;
+  uint32 final_tx_time;
+
+  /* Retrieve poll transmission and response reception timestamps. */
+  poll_tx_ts = dw_ts_read_tx();
+  resp_rx_ts = dw_ts_read_rx();
+
+  /* Compute final message transmission time, its time-stamp is the programmed time plus the antenna delay. */
+  final_tx_time = dw_ts_dx_time(dw_ts_add(resp_rx_ts, (uint64_t)RESP_RX_TO_FINAL_TX_DLY_UUS * UUS_TO_DWT_TIME));
+  dwt_setdelayedtrxtime(final_tx_time);
+  final_tx_ts = dw_ts_add(dw_ts_from_dx_time(final_tx_time), TX_ANT_DLY);
+
+  /* Write all timestamps in the final message. */
+  dw_ts_set(&tx_final_msg[FINAL_MSG_POLL_TX_TS_IDX], poll_tx_ts, FINAL_MSG_TS_LEN);
+  dw_ts_set(&tx_final_msg[FINAL_MSG_RESP_RX_TS_IDX], resp_rx_ts, FINAL_MSG_TS_LEN);
+  dw_ts_set(&tx_final_msg[FINAL_MSG_FINAL_TX_TS_IDX], final_tx_ts, FINAL_MSG_TS_LEN);
+
+  rec->poll_tx_ts = (uint32)poll_tx_ts;
+  rec->resp_rx_ts = (uint32)resp_rx_ts;
+
+  tx_final_msg[ALL_MSG_SN_IDX] = frame_seq_nb;
+  dwt_writetxdata(sizeof(tx_final_msg), tx_final_msg, 0); /* Zero offset in TX buffer. */
+  dwt_writetxfctrl(sizeof(tx_final_msg), 0, 1); /* Zero offset in TX buffer, ranging. */
+
+  /* If the final cannot be sent in time (the task was woken up too late), the exchange is abandoned. */
+  if (dwt_starttx(DWT_START_TX_DELAYED) != DWT_SUCCESS)
+  {
+    rec->status = TWR_LOG_FINAL_LATE;
+    return;
+  }
+
+  rec->status = (ss_wait(SS_EVT_TX, TX_CONF_WAIT_MS)) ? (TWR_LOG_FINAL) : (TWR_LOG_LOST_IRQ);
+
+  /* Increment frame sequence number after transmission of the final message (modulo 256). */
+  frame_seq_nb++;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn ss_resp_distance()
+*
+* @brief Compute the distance of a SS TWR exchange from a response frame.
+*
+* @param  rec  record of the exchange, filled
+*         frame  response frame
+*         poll_tx_ts, resp_rx_ts  local time-stamps (low 32 bits) of the poll and of the response
+*         ci  carrier integrator of the response
+*
+* @return none
+*/
+static void ss_resp_distance(twr_log_rec_t *rec, const uint8 *frame, uint32 poll_tx_ts, uint32 resp_rx_ts, int32 ci)
+{
+  uint32 poll_rx_ts, resp_tx_ts;
+  int32 rtd_init, rtd_resp;
+  int32_t clock_offset_q31;
+
+  /* Calculate clock offset ratio. See NOTE 6 below. */
+  clock_offset_q31 = dw_clock_offset_q31(ci, rng_chan, rng_rate);
+
+  /* Get timestamps embedded in response message. */
+  poll_rx_ts = (uint32)dw_ts_get(&frame[RESP_MSG_POLL_RX_TS_IDX], RESP_MSG_TS_LEN);
+  resp_tx_ts = (uint32)dw_ts_get(&frame[RESP_MSG_RESP_TX_TS_IDX], RESP_MSG_TS_LEN);
+
+  /* Compute time of flight and distance, using clock offset ratio to correct for differing local and remote clock rates */
+  rtd_init = resp_rx_ts - poll_tx_ts;
+  rtd_resp = resp_tx_ts - poll_rx_ts;
+
+  tof2 = dw_ss_twr_tof2(rtd_init, rtd_resp, clock_offset_q31);
+  distance_mm = dw_tof2_to_mm(tof2);
+
+  rec->poll_tx_ts = poll_tx_ts;
+  rec->resp_rx_ts = resp_rx_ts;
+  rec->poll_rx_ts = poll_rx_ts;
+  rec->resp_tx_ts = resp_tx_ts;
+  rec->distance_mm = distance_mm;
+  rec->status = TWR_LOG_RANGE;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn ss_range()
+*
+* @brief Run one ranging exchange with a responder, the task sleeps while it waits for the DW1000 events.
+*
+* @param  addr  short address of the responder
+*         rec  filled with the result of the exchange
+*
+* @return  true if the distance has been measured
+*/
+static bool ss_range(uint16 addr, twr_log_rec_t *rec)
 {
+  const int ds = twr_ds;
+  uint32_t events;
+
+  /* Events left over from the previous exchange (e.g. a late interrupt after an expired wait) are stale. */
+  xTaskNotifyWait(0, 0xFFFFFFFFUL, NULL, 0);
+  ss_events = 0;
+  /* So is a frame filter rejection latched since the previous exchange, see NOTE 6 in main.c. */
+  dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_AFFREJ);
 
-  /* Loop forever initiating ranging exchanges. */
+  memset(rec, 0, sizeof(*rec));
+  rec->seq = epoch_count;
+  rec->frame_seq = frame_seq_nb;
+  rec->resp_addr = addr;
 
+  /* Poll and expected response of this responder, addresses are little endian. */
+  tx_poll_msg[ALL_MSG_DST_IDX] = (uint8)addr;
+  tx_poll_msg[ALL_MSG_DST_IDX + 1] = (uint8)(addr >> 8);
+  rx_resp_msg[ALL_MSG_SRC_IDX] = (uint8)addr;
+  rx_resp_msg[ALL_MSG_SRC_IDX + 1] = (uint8)(addr >> 8);
+  rx_ds_resp_msg[ALL_MSG_SRC_IDX] = (uint8)addr;
+  rx_ds_resp_msg[ALL_MSG_SRC_IDX + 1] = (uint8)(addr >> 8);
+  tx_final_msg[ALL_MSG_DST_IDX] = (uint8)addr;
+  tx_final_msg[ALL_MSG_DST_IDX + 1] = (uint8)(addr >> 8);
+  tx_poll_msg[ALL_MSG_FUNC_IDX] = (ds) ? (FUNC_CODE_DS_POLL) : (FUNC_CODE_SS_POLL);
 
   /* Write frame data to DW1000 and prepare transmission. See NOTE 3 below. */
   tx_poll_msg[ALL_MSG_SN_IDX] = frame_seq_nb;
-  dwt_writetxdata(sizeof(tx_poll_msg), tx_poll_msg, 0); /* Zero offset in TX buffer. */
-  dwt_writetxfctrl(sizeof(tx_poll_msg), 0, 1); /* Zero offset in TX buffer, ranging. */
+  dwt_writetxdata(POLL_FRAME_LEN, tx_poll_msg, 0); /* Zero offset in TX buffer. */
+  dwt_writetxfctrl(POLL_FRAME_LEN, 0, 1); /* Zero offset in TX buffer, ranging. */
 
   /* Start transmission, indicating that a response is expected so that reception is enabled automatically after the frame is sent and the delay
   * set by dwt_setrxaftertxdelay() has elapsed. */
   dwt_starttx(DWT_START_TX_IMMEDIATE | DWT_RESPONSE_EXPECTED);
 
-  /*Waiting for transmission success flag*/
-  while (!(tx_int_flag))
-  {};
-
-  if (tx_int_flag)
-  {
-    tx_count++;
-    printf("Transmission # : %d\r\n",tx_count);
-
-    /*Reseting tx interrupt flag*/
-    tx_int_flag = 0 ;
-  }
+  /* Wait for the transmission confirmation. */
+  rec->status = (ss_wait(SS_EVT_TX, TX_CONF_WAIT_MS)) ? (TWR_LOG_LOST_IRQ) : (TWR_LOG_NO_TX);
 
-  /* Wait for reception, timeout or error interrupt flag*/
-  while (!(rx_int_flag || to_int_flag|| er_int_flag))
-  {};
+  /* Wait for reception, timeout or error. */
+  events = ss_wait(SS_EVT_RX | SS_EVT_TO | SS_EVT_ER, rx_evt_wait_ms);
 
   /* Increment frame sequence number after transmission of the poll message (modulo 256). */
   frame_seq_nb++;
 
-  if (rx_int_flag)
+  if (events == 0)
+  {
+    /* The DW1000 interrupt has been lost, put the transceiver back into IDLE. */
+    dwt_forcetrxoff();
+    dwt_rxreset();
+    return false;
+  }
+
+  if (rec->status != TWR_LOG_NO_TX)
+  {
+    rec->status = (events & SS_EVT_RX) ? (TWR_LOG_BAD_FRAME) : ((events & SS_EVT_TO) ? (TWR_LOG_TIMEOUT) : (TWR_LOG_RX_ERROR));
+  }
+
+  if (events & SS_EVT_RX)
   {		
     uint32 frame_len;
 
@@ -138,53 +451,444 @@ int ss_init_run(void)
     /* Check that the frame is the expected response from the companion "SS TWR responder" example.
     * As the sequence number field of the frame is not relevant, it is cleared to simplify the validation of the frame. */
     rx_buffer[ALL_MSG_SN_IDX] = 0;
-    if (memcmp(rx_buffer, rx_resp_msg, ALL_MSG_COMMON_LEN) == 0)
+    if (ds)
+    {
+      if ((rec->status != TWR_LOG_NO_TX) && (memcmp(rx_buffer, rx_ds_resp_msg, ALL_MSG_COMMON_LEN) == 0))
+      {
+        ss_ds_final(rec);
+      }
+    }
+    else if ((rec->status != TWR_LOG_NO_TX) && (memcmp(rx_buffer, rx_resp_msg, ALL_MSG_COMMON_LEN) == 0))
     {	
-      rx_count++;
-      printf("Reception # : %d\r\n",rx_count);
-      float reception_rate = (float) rx_count / (float) tx_count * 100;
-      printf("Reception rate # : %f\r\n",reception_rate);
-      uint32 poll_tx_ts, resp_rx_ts, poll_rx_ts, resp_tx_ts;
-      int32 rtd_init, rtd_resp;
-      float clockOffsetRatio ;
-
       /* Retrieve poll transmission and response reception timestamps. See NOTE 4 below. */
-      poll_tx_ts = dwt_readtxtimestamplo32();
-      resp_rx_ts = dwt_readrxtimestamplo32();
+      ss_resp_distance(rec, rx_buffer, dwt_readtxtimestamplo32(), dwt_readrxtimestamplo32(), dwt_readcarrierintegrator());
+    }
+   }
 
-      /* Read carrier integrator value and calculate clock offset ratio. See NOTE 6 below. */
-      clockOffsetRatio = dwt_readcarrierintegrator() * (FREQ_OFFSET_MULTIPLIER * HERTZ_TO_PPM_MULTIPLIER_CHAN_5 / 1.0e6) ;
+  if (events & (SS_EVT_TO | SS_EVT_ER))
+  {
+    /* Reset RX to properly reinitialise LDE operation. */
+    dwt_rxreset();
+  }
+
+  return ((rec->status == TWR_LOG_RANGE) || (rec->status == TWR_LOG_FINAL));
+}
 
-      /* Get timestamps embedded in response message. */
-      resp_msg_get_ts(&rx_buffer[RESP_MSG_POLL_RX_TS_IDX], &poll_rx_ts);
-      resp_msg_get_ts(&rx_buffer[RESP_MSG_RESP_TX_TS_IDX], &resp_tx_ts);
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn ss_bcast_epoch()
+*
+* @brief Run one broadcast poll epoch: a single poll, then the responses of all the responders are received back-to-back in their slots.
+*
+* @param  none
+*
+* @return  the number of responders ranged
+*/
+static int ss_bcast_epoch(void)
+{
+  TickType_t start;
+  TickType_t window;
+  uint32 poll_tx_ts;
+  int ranged = 0;
+  int tx_ok;
+  int i, j;
+  uint16 src;
 
-      /* Compute time of flight and distance, using clock offset ratio to correct for differing local and remote clock rates */
-      rtd_init = resp_rx_ts - poll_tx_ts;
-      rtd_resp = resp_tx_ts - poll_rx_ts;
+  xTaskNotifyWait(0, 0xFFFFFFFFUL, NULL, 0);
+  ss_events = 0;
+  dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_AFFREJ);
 
-      tof = ((rtd_init - rtd_resp * (1.0f - clockOffsetRatio)) / 2.0f) * DWT_TIME_UNITS; // Specifying 1.0f and 2.0f are floats to clear warning 
-      distance = tof * SPEED_OF_LIGHT;
-      printf("Distance : %f\r\n",distance);
+  for (i = 0; i < N_RESPONDERS; i++)
+  {
+    memset(&range_slot[i], 0, sizeof(range_slot[i]));
+    range_slot[i].seq = epoch_count;
+    range_slot[i].frame_seq = frame_seq_nb;
+    range_slot[i].resp_addr = responder_addr[i];
+    range_slot[i].status = TWR_LOG_TIMEOUT;
+  }
 
-      /*Reseting receive interrupt flag*/
-      rx_int_flag = 0; 
+  tx_poll_msg[ALL_MSG_DST_IDX] = (uint8)BCAST_ADDR;
+  tx_poll_msg[ALL_MSG_DST_IDX + 1] = (uint8)(BCAST_ADDR >> 8);
+  tx_poll_msg[ALL_MSG_FUNC_IDX] = FUNC_CODE_BCAST_POLL;
+  tx_poll_msg[ALL_MSG_SN_IDX] = frame_seq_nb;
+  dwt_writetxdata(POLL_FRAME_LEN, tx_poll_msg, 0); /* Zero offset in TX buffer. */
+  dwt_writetxfctrl(POLL_FRAME_LEN, 0, 1); /* Zero offset in TX buffer, ranging. */
+
+  /* The receiver stays on for the whole window, the task ends it. */
+  bcast_rx_n = 0;
+  bcast_active = 1;
+  dwt_setrxtimeout(0);
+  dwt_starttx(DWT_START_TX_IMMEDIATE | DWT_RESPONSE_EXPECTED);
+
+  tx_ok = (ss_wait(SS_EVT_TX, TX_CONF_WAIT_MS) != 0);
+  poll_tx_ts = dwt_readtxtimestamplo32();
+  frame_seq_nb++;
+
+  /* Wait for all the slots, or the end of the last one. */
+  start = xTaskGetTickCount();
+  window = pdMS_TO_TICKS((BCAST_RESP_DLY_UUS + N_RESPONDERS * BCAST_SLOT_UUS) / 1000 + 1) + 1;
+  while (tx_ok && (bcast_rx_n < N_RESPONDERS) && ((xTaskGetTickCount() - start) < window))
+  {
+    ss_wait(SS_EVT_RX, (window - (xTaskGetTickCount() - start)) * portTICK_PERIOD_MS);
+  }
+
+  bcast_active = 0;
+  dwt_forcetrxoff();
+  dwt_setrxtimeout(RESP_RX_TIMEOUT_UUS);
+
+  for (j = 0; j < bcast_rx_n; j++)
+  {
+    bcast_rx[j].frame[ALL_MSG_SN_IDX] = 0;
+    src = bcast_rx[j].frame[ALL_MSG_SRC_IDX] | ((uint16)bcast_rx[j].frame[ALL_MSG_SRC_IDX + 1] << 8);
+
+    /* rx_resp_msg with this source address: the destination and function code of the response are checked too. */
+    rx_resp_msg[ALL_MSG_SRC_IDX] = bcast_rx[j].frame[ALL_MSG_SRC_IDX];
+    rx_resp_msg[ALL_MSG_SRC_IDX + 1] = bcast_rx[j].frame[ALL_MSG_SRC_IDX + 1];
+    if (memcmp(bcast_rx[j].frame, rx_resp_msg, ALL_MSG_COMMON_LEN) != 0)
+    {
+      continue;
     }
-   }
 
-  if (to_int_flag || er_int_flag)
+    for (i = 0; i < N_RESPONDERS; i++)
+    {
+      if ((responder_addr[i] == src) && (range_slot[i].status != TWR_LOG_RANGE))
+      {
+        ss_resp_distance(&range_slot[i], bcast_rx[j].frame, poll_tx_ts, bcast_rx[j].rx_ts, bcast_rx[j].ci);
+        ranged++;
+        break;
+      }
+    }
+  }
+
+  if (!tx_ok)
   {
-    /* Reset RX to properly reinitialise LDE operation. */
-    dwt_rxreset();
+    for (i = 0; i < N_RESPONDERS; i++)
+    {
+      range_slot[i].status = TWR_LOG_NO_TX;
+    }
+  }
+
+  return ranged;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn ss_bench_handshake()
+*
+* @brief Ask the responder to switch to a setting of the benchmark, with the base settings. See NOTE 13 below.
+*
+* @param  addr  short address of the responder
+*         idx  index of the setting
+*
+* @return  true if the responder has acknowledged the setting
+*/
+static bool ss_bench_handshake(uint16 addr, int idx)
+{
+  uint32_t events;
+  uint32 frame_len;
+  int i;
+
+  tx_bench_cfg_msg[ALL_MSG_DST_IDX] = (uint8)addr;
+  tx_bench_cfg_msg[ALL_MSG_DST_IDX + 1] = (uint8)(addr >> 8);
+  tx_bench_cfg_msg[BENCH_MSG_IDX_IDX] = (uint8)idx;
+  rx_bench_ack_msg[ALL_MSG_SRC_IDX] = (uint8)addr;
+  rx_bench_ack_msg[ALL_MSG_SRC_IDX + 1] = (uint8)(addr >> 8);
+  rx_bench_ack_msg[BENCH_MSG_IDX_IDX] = (uint8)idx;
+
+  for (i = 0; i < BENCH_CFG_TRIES; i++)
+  {
+    xTaskNotifyWait(0, 0xFFFFFFFFUL, NULL, 0);
+    ss_events = 0;
+    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_AFFREJ);
+
+    tx_bench_cfg_msg[ALL_MSG_SN_IDX] = frame_seq_nb++;
+    dwt_writetxdata(sizeof(tx_bench_cfg_msg), tx_bench_cfg_msg, 0); /* Zero offset in TX buffer. */
+    dwt_writetxfctrl(sizeof(tx_bench_cfg_msg), 0, 0); /* Zero offset in TX buffer, not ranging. */
+    dwt_starttx(DWT_START_TX_IMMEDIATE | DWT_RESPONSE_EXPECTED);
+
+    ss_wait(SS_EVT_TX, TX_CONF_WAIT_MS);
+    events = ss_wait(SS_EVT_RX | SS_EVT_TO | SS_EVT_ER, RX_EVT_WAIT_MS);
+
+    if (events & SS_EVT_RX)
+    {
+      frame_len = dwt_read32bitreg(RX_FINFO_ID) & RX_FINFO_RXFLEN_MASK;
+      if (frame_len == sizeof(rx_bench_ack_msg))
+      {
+        dwt_readrxdata(rx_buffer, frame_len, 0);
+        rx_buffer[ALL_MSG_SN_IDX] = 0;
+        if (memcmp(rx_buffer, rx_bench_ack_msg, BENCH_MSG_IDX_IDX + 1) == 0)
+        {
+          return true;
+        }
+      }
+    }
+    else
+    {
+      /* Timeout, error or lost interrupt: put the transceiver back into IDLE and reset RX to reinitialise LDE operation. */
+      dwt_forcetrxoff();
+      dwt_rxreset();
+    }
+
+    /* The responder may still be on the previous setting, it comes back after BENCH_IDLE_MS. */
+    vTaskDelay(pdMS_TO_TICKS(BENCH_CFG_RETRY_MS));
+  }
+
+  return false;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn ss_radio_apply()
+*
+* @brief Configure the DW1000 with a setting of the benchmark or a link adaptation profile, with the RX timeout and wait of its
+*        reply delay.
+*
+* @param  config  DW1000 configuration
+*         rx_timeout_uus  RX timeout of the response
+*
+* @return none
+*/
+static void ss_radio_apply(const dwt_config_t *config, uint32 rx_timeout_uus)
+{
+  dwt_forcetrxoff();
+  dwt_configure((dwt_config_t *)config);
+  dwt_setrxtimeout((uint16)rx_timeout_uus);
+
+  rx_evt_wait_ms = rx_timeout_uus / 1000 + RX_EVT_WAIT_MS;
+  rng_chan = config->chan;
+  rng_rate = config->dataRate;
+}
 
-    /*Reseting interrupt flag*/
-    to_int_flag = 0 ;
-    er_int_flag = 0 ;
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn ss_bench_run()
+*
+* @brief Run one sweep of the benchmark: BENCH_N exchanges back-to-back with each setting of twr_bench.c, and print the throughput,
+*        success rate, distance statistics and frame durations of each setting.
+*
+* @param  none
+*
+* @return none
+*/
+static void ss_bench_run(void)
+{
+  const uint16 addr = responder_addr[0];
+  const twr_bench_cfg_t *b;
+  dwt_config_t base, config;
+  twr_log_rec_t rec;
+  range_stats_t stats;
+  TickType_t start;
+  uint32 elapsed_ms;
+  uint32 rx_timeout_uus;
+  uint32 poll_us, resp_us;
+  uint32 ok;
+  int idx, n;
+
+  twr_bench_dwt_config(&twr_bench_base, &base);
+  printf("Bench sweep : %d settings, %d exchanges each\r\n", twr_bench_count(), BENCH_N);
+
+  for (idx = 0; idx < twr_bench_count(); idx++)
+  {
+    b = twr_bench_get(idx);
+    if (twr_bench_dwt_config(b, &config) != 0)
+    {
+      printf("Bench %d : ch %u prf %u plen %u pac %u %u kbps not supported\r\n", idx, (unsigned)b->chan, (unsigned)b->prf,
+             (unsigned)b->plen, (unsigned)b->pac, (unsigned)b->kbps);
+      continue;
+    }
+
+    if (!ss_bench_handshake(addr, idx))
+    {
+      printf("Bench %d : no answer from %04X\r\n", idx, (unsigned)addr);
+      continue;
+    }
+
+    poll_us = twr_bench_frame_us(&config, POLL_FRAME_LEN);
+    resp_us = twr_bench_frame_us(&config, sizeof(rx_resp_msg));
+    rx_timeout_uus = twr_bench_reply_uus(&config, POLL_FRAME_LEN) + resp_us + BENCH_RX_MARGIN_UUS;
+    ss_radio_apply(&config, rx_timeout_uus);
+    radio_profile = -1;
+
+    range_stats_init(&stats, addr);
+    ok = 0;
+    start = xTaskGetTickCount();
+    for (n = 0; n < BENCH_N; n++)
+    {
+      if (ss_range(addr, &rec))
+      {
+        ok++;
+        range_stats_add(&stats, rec.distance_mm);
+      }
+      else if (rec.status == TWR_LOG_TIMEOUT)
+      {
+        range_stats_timeout(&stats);
+      }
+      else
+      {
+        range_stats_error(&stats);
+      }
+    }
+    elapsed_ms = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+    if (elapsed_ms == 0)
+    {
+      elapsed_ms = 1;
+    }
+
+    /* Back to the base settings for the next handshake, the responder follows after BENCH_IDLE_MS. */
+    ss_radio_apply(&base, RESP_RX_TIMEOUT_UUS);
+    radio_profile = LINK_PROFILE_BASE;
+
+    printf("Bench %d : ch %u prf %u plen %u pac %u %u kbps, poll %lu us resp %lu us, %lu.%lu exch/s, ok %lu.%lu %%, "
+           "mean %ld sd %lu mm, rejected %lu timeouts %lu errors %lu\r\n",
+           idx, (unsigned)b->chan, (unsigned)b->prf, (unsigned)b->plen, (unsigned)b->pac, (unsigned)b->kbps,
+           (unsigned long)poll_us, (unsigned long)resp_us,
+           (unsigned long)(BENCH_N * 1000UL / elapsed_ms), (unsigned long)((BENCH_N * 10000UL / elapsed_ms) % 10),
+           (unsigned long)(ok * 100 / BENCH_N), (unsigned long)((ok * 1000 / BENCH_N) % 10),
+           (long)((stats.n) ? (lroundf(stats.mean_mm)) : (0)), (unsigned long)range_stats_stddev_mm(&stats),
+           (unsigned long)stats.rejected, (unsigned long)stats.timeouts, (unsigned long)stats.errors);
+  }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn ss_link_select()
+*
+* @brief Configure the DW1000 with a link adaptation profile, if it is not the one in use.
+*
+* @param  profile  index of the profile, see link_adapt.c
+*
+* @return none
+*/
+static void ss_link_select(int profile)
+{
+  dwt_config_t config;
+
+  if ((profile == radio_profile) || (link_adapt_config(profile, &config) != 0))
+  {
+    return;
   }
 
-    /* Execute a delay between ranging exchanges. */
-    //     deca_sleep(RNG_DELAY_MS);
-    //	return(1);
+  if (profile == LINK_PROFILE_BASE)
+  {
+    ss_radio_apply(&config, RESP_RX_TIMEOUT_UUS);
+  }
+  else
+  {
+    ss_radio_apply(&config, twr_bench_reply_uus(&config, POLL_FRAME_LEN) + twr_bench_frame_us(&config, RESP_FRAME_LEN)
+                   + BENCH_RX_MARGIN_UUS);
+  }
+  radio_profile = profile;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn ss_link_update()
+*
+* @brief Account the result of an exchange in the link adaptation of its responder, from the diagnostics of the response. The
+*        profile asked for goes in the next poll to the responder. See NOTE 14 below.
+*
+* @param  la  link adaptation state of the responder
+*         rec  record of the exchange
+*
+* @return none
+*/
+static void ss_link_update(link_adapt_t *la, const twr_log_rec_t *rec)
+{
+  dwt_rxdiag_t diag;
+  dwt_config_t config;
+
+  switch (rec->status)
+  {
+    case TWR_LOG_RANGE:
+    case TWR_LOG_FINAL:
+      if (la->want != la->profile)
+      {
+        /* The responder has answered the poll which asked for the change, it switches after the exchange. */
+        link_adapt_set(la, la->want);
+        break;
+      }
+      link_adapt_config(la->profile, &config);
+      dwt_readdiagnostics(&diag);
+      link_adapt_rx(la, link_adapt_fp_dbm(&diag, config.prf));
+      break;
+    case TWR_LOG_TIMEOUT:
+      link_adapt_timeout(la);
+      if (la->timeout_n >= LINK_LOST_N)
+      {
+        /* The responder has gone back to the base profile after LINK_IDLE_MS, or it is out of range. */
+        link_adapt_set(la, LINK_PROFILE_BASE);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn ss_init_set_bcast()
+*
+* @brief Select the broadcast poll mode, it applies from the next epoch. The responders answer both kinds of poll.
+*
+* @param  bcast  0 for one exchange per responder, 1 for one broadcast poll per epoch
+*
+* @return none
+*/
+void ss_init_set_bcast(int bcast)
+{
+  twr_bcast = (bcast != 0);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn ss_init_set_ds()
+*
+* @brief Select the ranging scheme, it applies from the next exchange. The responders answer both kinds of poll.
+*
+* @param  ds  0 for single-sided TWR, 1 for asymmetric double-sided TWR
+*
+* @return none
+*/
+void ss_init_set_ds(int ds)
+{
+  twr_ds = (ds != 0);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn ss_init_run()
+*
+* @brief Run one ranging epoch: poll every responder of the table back-to-back, then flush their results together.
+*
+* @param  none
+*
+* @return  the number of responders ranged
+*/
+int ss_init_run(void)
+{
+  int ranged = 0;
+  int i;
+
+  if (twr_bcast)
+  {
+    /* All the responders answer the same poll, it is sent with the base profile. */
+    ss_link_select(LINK_PROFILE_BASE);
+    ranged = ss_bcast_epoch();
+  }
+  else
+  {
+    for (i = 0; i < N_RESPONDERS; i++)
+    {
+      if (TWR_LINK_ADAPT)
+      {
+        ss_link_select(link_state[i].profile);
+        tx_poll_msg[POLL_MSG_PROFILE_IDX] = link_state[i].want;
+      }
+
+      ranged += ss_range(responder_addr[i], &range_slot[i]);
+
+      if (TWR_LINK_ADAPT)
+      {
+        ss_link_update(&link_state[i], &range_slot[i]);
+      }
+    }
+  }
+
+  epoch_count++;
+
+  ss_log_flush(range_slot, N_RESPONDERS);
+  return ranged;
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -198,7 +902,23 @@ int ss_init_run(void)
 */
 void rx_ok_cb(const dwt_cb_data_t *cb_data)
 {
-  rx_int_flag = 1 ;
+  if (bcast_active)
+  {
+    /* Broadcast poll window: keep the response and re-enable the receiver for the next slot at once. See NOTE 12 below. */
+    if ((bcast_rx_n < N_RESPONDERS) && (cb_data->datalength == RESP_FRAME_LEN))
+    {
+      bcast_rx_t *r = &bcast_rx[bcast_rx_n];
+      dwt_readrxdata(r->frame, RESP_FRAME_LEN, 0);
+      r->rx_ts = dwt_readrxtimestamplo32();
+      r->ci = dwt_readcarrierintegrator();
+      bcast_rx_n++;
+    }
+    if (bcast_rx_n < N_RESPONDERS)
+    {
+      dwt_rxenable(DWT_START_RX_IMMEDIATE);
+    }
+  }
+  ss_signal(SS_EVT_RX);
   /* TESTING BREAKPOINT LOCATION #1 */
 }
 
@@ -213,9 +933,8 @@ void rx_ok_cb(const dwt_cb_data_t *cb_data)
 */
 void rx_to_cb(const dwt_cb_data_t *cb_data)
 {
-  to_int_flag = 1 ;
+  ss_signal(SS_EVT_TO);
   /* TESTING BREAKPOINT LOCATION #2 */
-  printf("TimeOut\r\n");
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -229,9 +948,15 @@ void rx_to_cb(const dwt_cb_data_t *cb_data)
 */
 void rx_err_cb(const dwt_cb_data_t *cb_data)
 {
-  er_int_flag = 1 ;
+  if (bcast_active)
+  {
+    /* Broadcast poll window: a corrupted response (e.g. slots overlapping) does not end the window. */
+    dwt_rxreset();
+    dwt_rxenable(DWT_START_RX_IMMEDIATE);
+    return;
+  }
+  ss_signal(SS_EVT_ER);
   /* TESTING BREAKPOINT LOCATION #3 */
-  printf("Transmission Error : may receive package from different UWB device\r\n");
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -251,49 +976,228 @@ void tx_conf_cb(const dwt_cb_data_t *cb_data)
   * An actual application that would not need this callback could simply not define it and set the corresponding field to NULL when calling
   * dwt_setcallbacks(). The ISR will not call it which will allow to save some interrupt processing time. */
 
-  tx_int_flag = 1 ;
+  ss_signal(SS_EVT_TX);
   /* TESTING BREAKPOINT LOCATION #4 */
 }
 
 
+/**@brief SS TWR Initiator task entry function.
+*
+* @param[in] pvParameter   Pointer that will be used as the parameter for the task.
+*/
+void ss_initiator_task_function (void * pvParameter)
+{
+  TickType_t epoch_start;
+  int i;
+
+  UNUSED_PARAMETER(pvParameter);
+
+  dwt_setleds(DWT_LEDS_ENABLE);
+
+  ss_task = xTaskGetCurrentTaskHandle();
+  epoch_start = xTaskGetTickCount();
+
+  for (i = 0; i < N_RESPONDERS; i++)
+  {
+    link_adapt_init(&link_state[i]);
+  }
+
+  while (true)
+  {
+    if (TWR_BENCH)
+    {
+      ss_bench_run();
+      continue;
+    }
+    ss_init_run();
+    /* Delay a task until the start of the next epoch, the epoch period does not depend on the number of responders */
+    vTaskDelayUntil(&epoch_start, pdMS_TO_TICKS(RNG_DELAY_MS));
+    /* Tasks must be implemented to never return... */
+  }
+}
+
+#if SS_LOG_RAW == 1
 /*! ------------------------------------------------------------------------------------------------------------------
-* @fn resp_msg_get_ts()
+* @fn ss_log_print()
 *
-* @brief Read a given timestamp value from the response message. In the timestamp fields of the response message, the
-*        least significant byte is at the lower address.
+* @brief Print the record of an exchange (SS_LOG_RAW).
 *
-* @param  ts_field  pointer on the first byte of the timestamp field to get
-*         ts  timestamp value
+* @param  rec  record of the exchange
 *
 * @return none
 */
-static void resp_msg_get_ts(uint8 *ts_field, uint32 *ts)
+static void ss_log_print(const twr_log_rec_t *rec)
 {
+  static uint32_t tx_count = 0; // Successful transmit counter
+  static uint32_t rx_count = 0; // Successful receive counter
+
+  if (rec->status != TWR_LOG_NO_TX)
+  {
+    tx_count++;
+    printf("Transmission # : %lu\r\n", (unsigned long)tx_count);
+  }
+
+  switch (rec->status)
+  {
+    case TWR_LOG_RANGE:
+      rx_count++;
+      printf("Reception # : %lu\r\n", (unsigned long)rx_count);
+      printf("Reception rate # : %lu.%lu %%\r\n", (unsigned long)(rx_count * 100 / tx_count),
+             (unsigned long)((rx_count * 1000 / tx_count) % 10));
+      printf("Distance %04X : %ld mm (#%lu, poll TX %08lX RX %08lX, resp RX %08lX TX %08lX)\r\n", (unsigned)rec->resp_addr,
+             (long)rec->distance_mm, (unsigned long)rec->seq, (unsigned long)rec->poll_tx_ts, (unsigned long)rec->poll_rx_ts,
+             (unsigned long)rec->resp_rx_ts, (unsigned long)rec->resp_tx_ts);
+      break;
+    case TWR_LOG_FINAL:
+      printf("Final sent %04X (#%lu, poll TX %08lX, resp RX %08lX)\r\n", (unsigned)rec->resp_addr, (unsigned long)rec->seq,
+             (unsigned long)rec->poll_tx_ts, (unsigned long)rec->resp_rx_ts);
+      break;
+    case TWR_LOG_FINAL_LATE:
+      printf("Final too late %04X (#%lu)\r\n", (unsigned)rec->resp_addr, (unsigned long)rec->seq);
+      break;
+    case TWR_LOG_NO_TX:
+      printf("No transmission confirmation (#%lu)\r\n", (unsigned long)rec->seq);
+      break;
+    case TWR_LOG_TIMEOUT:
+      printf("TimeOut %04X\r\n", (unsigned)rec->resp_addr);
+      break;
+    case TWR_LOG_RX_ERROR:
+      printf("Transmission Error : may receive package from different UWB device\r\n");
+      break;
+    case TWR_LOG_BAD_FRAME:
+      printf("Unexpected frame (#%lu)\r\n", (unsigned long)rec->seq);
+      break;
+    default:
+      printf("Lost DW1000 interrupt (#%lu)\r\n", (unsigned long)rec->seq);
+      break;
+  }
+}
+#endif
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn ss_stats_add()
+*
+* @brief Account the record of an exchange in the statistics of its responder.
+*
+* @param  rec  record of the exchange
+*
+* @return none
+*/
+static void ss_stats_add(const twr_log_rec_t *rec)
+{
+  range_stats_t *s = NULL;
   int i;
-  *ts = 0;
-  for (i = 0; i < RESP_MSG_TS_LEN; i++)
+
+  for (i = 0; i < N_RESPONDERS; i++)
+  {
+    if (range_stats[i].addr == rec->resp_addr)
+    {
+      s = &range_stats[i];
+      break;
+    }
+  }
+
+  if (s == NULL)
+  {
+    return;
+  }
+
+  switch (rec->status)
   {
-  *ts += ts_field[i] << (i * 8);
+    case TWR_LOG_RANGE:
+      range_stats_add(s, rec->distance_mm);
+      break;
+    case TWR_LOG_FINAL:
+      /* DS TWR: the distance is computed by the responder */
+      break;
+    case TWR_LOG_TIMEOUT:
+      range_stats_timeout(s);
+      break;
+    default:
+      range_stats_error(s);
+      break;
   }
 }
 
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn ss_stats_report()
+*
+* @brief Print the statistics of the period of every responder and start a new period.
+*
+* @param  none
+*
+* @return none
+*/
+static void ss_stats_report(void)
+{
+  range_stats_t *s;
+  int i;
 
-/**@brief SS TWR Initiator task entry function.
+  for (i = 0; i < N_RESPONDERS; i++)
+  {
+    s = &range_stats[i];
+    printf("Stats %04X : n %lu mean %ld median %ld sd %lu min %ld max %ld mm, rejected %lu timeouts %lu errors %lu\r\n",
+           (unsigned)s->addr, (unsigned long)s->n, (long)((s->n) ? (lroundf(s->mean_mm)) : (0)), (long)range_stats_median(s),
+           (unsigned long)range_stats_stddev_mm(s), (long)s->min_mm, (long)s->max_mm, (unsigned long)s->rejected,
+           (unsigned long)s->timeouts, (unsigned long)s->errors);
+    if (TWR_LINK_ADAPT)
+    {
+      printf("Link %04X : profile %u\r\n", (unsigned)s->addr, (unsigned)link_state[i].profile);
+    }
+    range_stats_clear(s);
+  }
+}
+
+/**@brief SS TWR Initiator log task entry function, drains the log ring into the ranging statistics and reports them every
+*        STATS_PERIOD_MS. With SS_LOG_RAW the records are printed as well.
 *
 * @param[in] pvParameter   Pointer that will be used as the parameter for the task.
 */
-void ss_initiator_task_function (void * pvParameter)
+void ss_log_task_function (void * pvParameter)
 {
+  twr_log_rec_t rec;
+  TickType_t next_report;
+  TickType_t now;
+  uint32_t dropped = 0;
+  uint32_t d;
+  int i;
+
   UNUSED_PARAMETER(pvParameter);
 
-  dwt_setleds(DWT_LEDS_ENABLE);
+  for (i = 0; i < N_RESPONDERS; i++)
+  {
+    range_stats_init(&range_stats[i], responder_addr[i]);
+  }
+
+  ss_log_task = xTaskGetCurrentTaskHandle();
+  next_report = xTaskGetTickCount() + pdMS_TO_TICKS(STATS_PERIOD_MS);
 
   while (true)
   {
-    ss_init_run();
-    /* Delay a task for a given number of ticks */
-    vTaskDelay(RNG_DELAY_MS);
-    /* Tasks must be implemented to never return... */
+    now = xTaskGetTickCount();
+    ulTaskNotifyTake(pdTRUE, ((int32_t)(next_report - now) > 0) ? (next_report - now) : (0));
+
+    while (twr_log_get(&rec))
+    {
+      ss_stats_add(&rec);
+#if SS_LOG_RAW == 1
+      ss_log_print(&rec);
+#endif
+    }
+
+    if ((int32_t)(xTaskGetTickCount() - next_report) >= 0)
+    {
+      ss_stats_report();
+      next_report += pdMS_TO_TICKS(STATS_PERIOD_MS);
+    }
+
+    /* Records are dropped if the UART cannot keep up with the ranging rate. */
+    d = twr_log_dropped();
+    if (d != dropped)
+    {
+      printf("Log records dropped : %lu\r\n", (unsigned long)(d - dropped));
+      dropped = d;
+    }
   }
 }
 /*****************************************************************************************************************************************************
@@ -332,5 +1236,51 @@ void ss_initiator_task_function (void * pvParameter)
 * 6. The use of the carrier integrator value to correct the TOF calculation, was added Feb 2017 for v1.3 of this example.  This significantly
 *     improves the result of the SS-TWR where the remote responder unit's clock is a number of PPM offset from the local inmitiator unit's clock.
 *     As stated in NOTE 2 a fixed offset in range will be seen unless the antenna delsy is calibratred and set correctly.
+*     The clock offset ratio and the time of flight are computed in fixed point by dw_ts.c, the channel and data rate given to
+*     dw_clock_offset_q31() must match the configuration of the DW1000.
+* 7. The callbacks are called by dwt_isr() from the GPIOTE interrupt, its priority (GPIOTE_CONFIG_IRQ_PRIORITY, 7) is below
+*    configMAX_SYSCALL_INTERRUPT_PRIORITY so the FromISR FreeRTOS API can be used there. The initiator task blocks in xTaskNotifyWait()
+*    instead of polling flags, so the CPU is free for the LED and UART tasks (or sleeps) for the whole exchange. ss_init_run() can only
+*    be called from the initiator task: the bare-metal loop of main() (USE_FREERTOS undefined) would never be notified.
+* 8. Nothing is printed by the initiator task or by the callbacks: each exchange writes one binary record (twr_log.c) which the log
+*    task, of lower priority, formats and prints in the time between the exchanges. The ranging rate is then limited by the radio and
+*    RNG_DELAY_MS, not by the 115200 baud UART. The reception counters and the rate are computed by the log task (integer per-mille,
+*    the float formatting of printf is not needed).
+* 9. The poll is addressed to one responder (destination address) and only the response carrying that responder as source address is
+*    accepted, so several ss_twr_resp anchors can share the channel. The responders are polled back-to-back: an exchange ends with the
+*    response or the short RX timeout, so a responder which does not answer costs around 2 ms and not a whole epoch. The results of the
+*    epoch go to the log ring in one burst, which must hold them all (N_RESPONDERS <= TWR_LOG_SIZE, 16).
+* 10. With TWR_DS (or ss_init_set_ds(1)) the poll function code is 0x21 and the responder answers with a short response (0x10), the
+*    initiator then sends a final message (0x23) carrying its poll TX, response RX and final TX time-stamps, and the responder computes
+*    the distance with the asymmetric DS TWR formula (dw_ds_twr_tof2()). The clock offset cancels out, so neither the carrier integrator nor
+*    short reply times are needed for accuracy: POLL_RX_TO_RESP_TX_DLY_UUS of the responder can be as short as its SPI/CPU latency allows.
+*    The final TX time is computed in advance like the response TX time of the responder, RESP_RX_TO_FINAL_TX_DLY_UUS must cover the
+*    task wake up and the final message write.
+* 11. The log task feeds every record into the statistics of its responder (range_stats.c): the ranges which pass the median filter
+*    give the mean, standard deviation, min and max of the period, the others are counted as rejected, along with the timeouts and the
+*    errors. One line per responder is printed every STATS_PERIOD_MS instead of several lines per exchange, define SS_LOG_RAW to 1 to
+*    print the exchanges too.
+* 12. With TWR_BCAST (or ss_init_set_bcast(1)) an epoch is a single poll to the broadcast address (function code 0xE2), and the responder
+*    of index i of SS_RESPONDERS (RESP_SLOT = i in ss_resp_main.c) answers BCAST_RESP_DLY_UUS + i * BCAST_SLOT_UUS after it, with the SS
+*    TWR response. A fix to N responders takes N + 1 frames instead of 2 * N. The receiver is kept on for the whole window: rx_ok_cb()
+*    copies each response, its RX time-stamp and carrier integrator into bcast_rx[] and re-enables the receiver at once, which acts as the
+*    double buffering of the responses (the DW1000 RX buffer is free again well before the next slot, a slot is around 400 us for a
+*    response of around 200 us). The task only wakes up to compute the distances once the window is over. BCAST_SLOT_UUS must cover the
+*    response and the interrupt latency, and all the responders must agree on BCAST_RESP_DLY_UUS and BCAST_SLOT_UUS.
+* 13. With TWR_BENCH the initiator task sweeps the settings of twr_bench.c instead of running the epochs: for each setting a handshake
+*    with the base settings (function codes 0xE5/0xE6, see twr_bench.c) switches both sides, then BENCH_N SS TWR exchanges are run
+*    back-to-back with the first responder of SS_RESPONDERS and one line is printed: the exchanges per second (wall clock of the N
+*    exchanges, timeouts included), the success rate, the mean and standard deviation of the distance (range_stats.c), and the on-air
+*    durations of the poll and of the response. The RX timeout and the task wait follow the reply delay of the setting, and the clock
+*    offset ratio uses its channel and data rate. The antenna delays are those of the base settings, so the mean distance of the 16 MHz
+*    PRF settings carries an offset; the TX power and pulse shape are the reset values of channel 5 (see NOTE 4 in main.c). Nothing goes
+*    to the log task, the line is printed after the N exchanges.
+* 14. With TWR_LINK_ADAPT each responder has its own profile (link_adapt.c), from 64 symbols at 6.8 Mbps to 1024 symbols at 850 kbps,
+*    and the DW1000 is reconfigured before polling a responder on another profile (nothing is done when consecutive responders share
+*    it). After each response the first path power is computed from dwt_readdiagnostics() (first path amplitudes and preamble count),
+*    and with the timeouts it drives the hysteresis of link_adapt.c. A change is asked for in the next poll (byte 10, the poll is then
+*    13 bytes long): the responder answers it with the current profile and then switches, and so does the initiator once it has the
+*    answer. Short links thus use the shortest frames and only the far links pay for the long preambles, and their longer RX timeout
+*    and reply delay. The profile of each responder is printed with its statistics.
 *
 ****************************************************************************************************************************************************/
@@ -12,8 +12,19 @@
  * @author Decawave
  */
 
-/* Declaration of static functions. */
-static void resp_msg_get_ts(uint8 *ts_field, uint32 *ts);
+/* Should be accurately calculated during calibration. The TX antenna delay is also used to compute the DS TWR final TX time-stamp. */
+/* Assume units are UWB microseconds (1 uus = 512/499.2 ms) */
+#define TX_ANT_DLY 16476//16300
+#define RX_ANT_DLY 16456
+
+/* Receive response timeout, in UWB microseconds: the response is sent POLL_RX_TO_RESP_TX_DLY_UUS (1100) after the poll, and takes
+* around 200 us. */
+#define RESP_RX_TIMEOUT_UUS 2000
+
+/* IEEE 802.15.4 addressing of the ranging frames: PAN ID (0xDECA) and short address of the initiator ('V', 'E'), used by the frame
+* filter of the DW1000. See NOTE 6 in main.c. */
+#define TWR_PAN_ID 0xDECA
+#define INIT_ADDR 0x4556
 
 int ss_init_run(void);
 
@@ -25,6 +36,10 @@ void rx_err_cb(const dwt_cb_data_t *cb_data);
 
 void tx_conf_cb(const dwt_cb_data_t *cb_data);
 
-static void resp_msg_get_ts(uint8 *ts_field, uint32 *ts);
-
 void ss_initiator_task_function (void * pvParameter);
+
+void ss_log_task_function (void * pvParameter);
+
+void ss_init_set_ds(int ds);
+
+void ss_init_set_bcast(int bcast);
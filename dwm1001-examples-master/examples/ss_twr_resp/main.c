@@ -38,6 +38,7 @@
 #include "deca_param_types.h"
 #include "deca_regs.h"
 #include "deca_device_api.h"
+#include "nrf_drv_gpiote.h"
 
 // Defines ---------------------------------------------
 
@@ -60,7 +61,11 @@ static dwt_config_t config = {
 //--------------dw1000---end---------------
 
 
-#define TASK_DELAY        10            /**< Task delay. Delays a LED0 task for 200 ms */
+#if TWR_TICKLESS_IDLE
+#define TASK_DELAY        200           /**< Task delay. Delays a LED0 task for 200 ms, see NOTE 4 below */
+#else
+#define TASK_DELAY        10            /**< Task delay. Delays a LED0 task for 10 ms */
+#endif
 #define TIMER_PERIOD      2000          /**< Timer period. LED1 timer will expire after 1000 ms */
 
 #ifdef USE_FREERTOS
@@ -72,6 +77,13 @@ static dwt_config_t config = {
   extern int ss_resp_run(void);
 #endif    // #ifdef USE_FREERTOS
 
+extern void ss_resp_set_filter(void);
+extern void ss_resp_set_irq(void);
+
+#if defined(USE_FREERTOS) && TWR_TICKLESS_IDLE
+  static void vInterruptInit(void);
+#endif
+
 #ifdef USE_FREERTOS
 
   /**@brief LED0 task entry function.
@@ -124,7 +136,12 @@ int main(void)
   //-------------dw1000  ini------------------------------------	
 
   /* Setup DW1000 IRQ pin */
-  nrf_gpio_cfg_input(DW1000_IRQ, NRF_GPIO_PIN_NOPULL); 		//irq
+  #if defined(USE_FREERTOS) && TWR_TICKLESS_IDLE
+    /* The responder task sleeps until the DW1000 IRQ, see NOTE 4 below. */
+    vInterruptInit();
+  #else
+    nrf_gpio_cfg_input(DW1000_IRQ, NRF_GPIO_PIN_NOPULL); 		//irq
+  #endif
 
   /* Reset DW1000 */
   reset_DW1000(); 
@@ -146,6 +163,12 @@ int main(void)
   /* Configure DW1000. */
   dwt_configure(&config);
 
+  /* Only accept the data frames of this PAN addressed to the responder (or broadcast), defined in ss_resp_main.c */
+  ss_resp_set_filter();
+
+  /* Raise the DW1000 IRQ on the events ending the wait for a poll, defined in ss_resp_main.c */
+  ss_resp_set_irq();
+
   /* Apply default antenna delay value. Defined in port platform.h */
   dwt_setrxantennadelay(RX_ANT_DLY);
   dwt_settxantennadelay(TX_ANT_DLY);
@@ -174,6 +197,44 @@ int main(void)
     #endif  // #ifdef USE_FREERTOS
 }
 
+#if defined(USE_FREERTOS) && TWR_TICKLESS_IDLE
+
+/*!
+* Interrupt handler of the DW1000 IRQ, wakes the responder task up which reads the status itself. See NOTE 4 below.
+*/
+void vInterruptHandler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
+{
+  BaseType_t woken = pdFALSE;
+
+  vTaskNotifyGiveFromISR(ss_responder_task_handle, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+/*!
+* @brief Configure an IO pin as a positive edge triggered interrupt source, with the low power PORT event.
+*/
+static void vInterruptInit(void)
+{
+  ret_code_t err_code;
+
+  if (!nrf_drv_gpiote_is_init())
+  {
+    nrf_drv_gpiote_init();
+  }
+
+  // input pin, +ve edge interrupt, no pull-up, sensed by the PORT event which does not keep the high frequency clock running
+  nrf_drv_gpiote_in_config_t in_config = GPIOTE_CONFIG_IN_SENSE_LOTOHI(false);
+  in_config.pull = NRF_GPIO_PIN_NOPULL;
+
+  // Link this pin interrupt source to its interrupt handler
+  err_code = nrf_drv_gpiote_in_init(DW1000_IRQ, &in_config, vInterruptHandler);
+  APP_ERROR_CHECK(err_code);
+
+  nrf_drv_gpiote_in_event_enable(DW1000_IRQ, true);
+}
+
+#endif // #if defined(USE_FREERTOS) && TWR_TICKLESS_IDLE
+
 /*****************************************************************************************************************************************************
 * NOTES:
 *
@@ -186,6 +247,12 @@ int main(void)
 *    on timing.
 * 3. The user is referred to DecaRanging ARM application (distributed with EVK1000 product) for additional practical example of usage, and to the
 *     DW1000 API Guide for more details on the DW1000 driver functions.
+* 4. With TWR_TICKLESS_IDLE (config/FreeRTOSConfig.h) the tick stops while the tasks are blocked and the nRF52 sleeps until the next
+*    timeout or interrupt. The responder task blocks until the DW1000 IRQ while it waits for a poll, instead of polling the status
+*    register over SPI, and the LED0 task runs every 200 ms instead of every 10 ms, so the idle nRF52 wakes up a few times a second. The
+*    IRQ is sensed with the PORT event of the GPIOTE, which draws no current in sleep; its few microseconds of latency, with the wake-up
+*    from sleep, are within the reply delay, which is calibrated on the actual latency (see NOTE 12 of ss_resp_main.c). The DW1000
+*    receiver, which is on while a poll is awaited, still draws its RX current: only the nRF52 goes down to microamps.
 *
 ****************************************************************************************************************************************************/
 
@@ -25,6 +25,9 @@
 #include "deca_device_api.h"
 #include "deca_regs.h"
 #include "port_platform.h"
+#include "dw_ts.h"
+#include "twr_bench.h"
+#include "link_adapt.h"
 
 /* Inter-ranging delay period, in milliseconds. See NOTE 1*/
 #define RNG_DELAY_MS 80
@@ -33,14 +36,87 @@
 static uint8 rx_poll_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 'W', 'A', 'V', 'E', 0xE0, 0, 0};
 static uint8 tx_resp_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 'V', 'E', 'W', 'A', 0xE1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 
+/* Frames of the asymmetric double-sided TWR exchange, selected by the function code of the poll. See NOTE 11 below. */
+static uint8 rx_ds_poll_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 'W', 'A', 'V', 'E', 0x21, 0, 0};
+static uint8 tx_ds_resp_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 'V', 'E', 'W', 'A', 0x10, 0, 0};
+static uint8 rx_final_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 'W', 'A', 'V', 'E', 0x23, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+/* Broadcast poll, answered with the SS TWR response in the slot of this responder. See NOTE 13 below. */
+static uint8 rx_bcast_poll_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 0xFF, 0xFF, 'V', 'E', 0xE2, 0, 0};
+
+/* Configuration frame of the benchmark and its acknowledgement, carrying the index of the setting. See NOTE 14 below. */
+static uint8 rx_bench_cfg_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 'W', 'A', 'V', 'E', FUNC_CODE_BENCH_CFG, 0, 0, 0};
+static uint8 tx_bench_ack_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 'V', 'E', 'W', 'A', FUNC_CODE_BENCH_ACK, 0, 0, 0};
+#define BENCH_MSG_IDX_IDX 10
+
+/* 1 to follow the settings of the benchmark initiator (TWR_BENCH in ss_init_main.c). */
+#ifndef TWR_BENCH
+#define TWR_BENCH 0
+#endif
+
+/* RX timeout while a setting of the benchmark is in use, in UWB microseconds, so that the idle time can be checked. */
+#define BENCH_RX_TIMEOUT_UUS 50000
+
+/* Setting of the benchmark acknowledged and not applied yet, -1 for none. */
+static int bench_next = -1;
+
+/* Link adaptation: profile in use (link_adapt.c) and time of the last frame received, to go back to the base profile. See NOTE 16
+* below. */
+#define POLL_MSG_PROFILE_IDX 10
+#define LINK_POLL_LEN 13
+#define LINK_RX_TIMEOUT_UUS 50000
+static int link_profile = LINK_PROFILE_BASE;
+static TickType_t link_last_rx;
+
+/* Reply delay and calibration of the base profile, kept while another profile is in use. */
+static uint32 link_base_dly_uus;
+static int link_base_cal_count;
+
+/* RX timeout while waiting for a poll, in UWB microseconds, 0 for none. */
+static uint32 resp_rx_timeout_uus = 0;
+
+/* Short address of this responder, the initiator polls each responder of its SS_RESPONDERS table by address. It has to be unique
+* among the responders in range, default 0x4157 ('W', 'A'). */
+#ifndef RESP_ADDR
+#define RESP_ADDR 0x4157
+#endif
+
+/* PAN ID of the ranging frames, used by the frame filter with RESP_ADDR. See NOTE 15 below. */
+#define TWR_PAN_ID 0xDECA
+
+/* RX errors the responder waits for: the frame filter rejections are not errors, the receiver keeps listening. */
+#define RX_ERR_WAIT_MASK (SYS_STATUS_ALL_RX_ERR & ~SYS_STATUS_AFFREJ)
+
+/* Events ending the wait for a poll, they raise the DW1000 IRQ with TWR_TICKLESS_IDLE. See NOTE 17 below. */
+#define RX_WAIT_EVENTS (SYS_STATUS_RXFCG | SYS_STATUS_ALL_RX_TO | RX_ERR_WAIT_MASK)
+
+/* Longest sleep of the responder task waiting for the IRQ of a poll, in milliseconds: the status is read again in case an IRQ edge was
+* missed. */
+#define RX_WAIT_IRQ_MS 1000
+
+/* Slot of this responder for the broadcast poll, its index in the SS_RESPONDERS table of the initiator. */
+#ifndef RESP_SLOT
+#define RESP_SLOT 0
+#endif
+
+/* Response slots of the broadcast poll, they must match ss_init_main.c. */
+#define BCAST_RESP_DLY_UUS 1100
+#define BCAST_SLOT_UUS 400
+
 /* Length of the common part of the message (up to and including the function code, see NOTE 3 below). */
 #define ALL_MSG_COMMON_LEN 10
 
 /* Index to access some of the fields in the frames involved in the process. */
 #define ALL_MSG_SN_IDX 2
+#define ALL_MSG_DST_IDX 5
+#define ALL_MSG_SRC_IDX 7
 #define RESP_MSG_POLL_RX_TS_IDX 10
 #define RESP_MSG_RESP_TX_TS_IDX 14
 #define RESP_MSG_TS_LEN 4	
+#define FINAL_MSG_POLL_TX_TS_IDX 10
+#define FINAL_MSG_RESP_RX_TS_IDX 14
+#define FINAL_MSG_FINAL_TX_TS_IDX 18
+#define FINAL_MSG_TS_LEN 4
 
 /* Frame sequence number, incremented after each transmission. */
 static uint8 frame_seq_nb = 0;
@@ -62,26 +138,294 @@ static uint32 status_reg = 0;
 // See note 6 at the end of this file
 #define POLL_RX_TO_RESP_TX_DLY_UUS  1100
 
+/* Reply delay auto-tuning, see NOTE 12 below. POLL_RX_TO_RESP_TX_DLY_UUS is the worst case, used until the calibration is done. */
+#define RESP_CAL_POLLS          32    /* polls measured by the calibration */
+#define RESP_DLY_MIN_UUS        300   /* the initiator receiver is on RX after TX delay (100 uus) after the end of the poll */
+#define RESP_DLY_MARGIN_UUS     100   /* added to the worst measured latency */
+#define RESP_DLY_STEP_UUS       100   /* added to the reply delay when a response is too late */
+
+/* Reply delay in use, worst poll RX to TX ready latency measured and polls measured so far. */
+static uint32 resp_dly_uus = POLL_RX_TO_RESP_TX_DLY_UUS;
+static uint32 resp_lat_max_uus = 0;
+static int resp_cal_count = 0;
+
+/* The response frame, all but its time-stamps, is in the DW1000 TX buffer. */
+static int resp_staged = 0;
+
 /* This is the delay from the end of the frame transmission to the enable of the receiver, as programmed for the DW1000's wait for response feature. */
 #define RESP_TX_TO_FINAL_RX_DLY_UUS 500
 
-/* Timestamps of frames transmission/reception.
-* As they are 40-bit wide, we need to define a 64-bit int type to handle them. */
-typedef signed long long int64;
-typedef unsigned long long uint64;
-static uint64 poll_rx_ts;
+/* Receive final timeout, in UWB microseconds. The initiator sends the final RESP_RX_TO_FINAL_TX_DLY_UUS (2000) after the response. */
+#define FINAL_RX_TIMEOUT_UUS 3000
+
+/* Timestamps of frames transmission/reception. They are 40-bit wide, see dw_ts.h. */
+static uint64_t poll_rx_ts;
+static uint64_t resp_tx_ts;
+static uint64_t final_rx_ts;
+
+/* Hold copies of computed time of flight (doubled, in dtu) and distance (in mm) of the last DS TWR exchange here for reference so that
+* they can be examined at a debug breakpoint. */
+static int64_t tof2;
+static int32_t distance_mm;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn resp_stage()
+*
+* @brief Load the response frame into the DW1000 TX buffer while waiting for the poll, so that only its two time-stamp fields have to
+*        be written once the poll is received. The TX buffer is not used by the reception.
+*
+* @param  none
+*
+* @return none
+*/
+static void resp_stage(void)
+{
+  tx_resp_msg[ALL_MSG_SN_IDX] = frame_seq_nb;
+  dwt_writetxdata(sizeof(tx_resp_msg), tx_resp_msg, 0); /* Zero offset in TX buffer. See Note 5 below.*/
+  dwt_writetxfctrl(sizeof(tx_resp_msg), 0, 1); /* Zero offset in TX buffer, ranging. */
+  resp_staged = 1;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn resp_wait_rx()
+*
+* @brief Wait for the end of the reception of a poll: a good frame, an RX timeout or an RX error. The responder task sleeps until the
+*        DW1000 IRQ with TWR_TICKLESS_IDLE, the status register is polled otherwise. See NOTE 17 below.
+*
+* @param  none
+*
+* @return the DW1000 status register
+*/
+static uint32 resp_wait_rx(void)
+{
+  uint32 status;
+
+  while (!((status = dwt_read32bitreg(SYS_STATUS_ID)) & RX_WAIT_EVENTS))
+  {
+    #if defined(USE_FREERTOS) && TWR_TICKLESS_IDLE
+      /* A notification of an earlier frame only costs one more status read. */
+      (void)ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(RX_WAIT_IRQ_MS));
+    #endif
+  }
+  return status;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn resp_calibrate()
+*
+* @brief Measure the latency from the poll RX time-stamp to the response being ready to be sent. After RESP_CAL_POLLS polls, the reply
+*        delay is set to the worst latency plus a margin.
+*
+* @param  none
+*
+* @return none
+*/
+static void resp_calibrate(void)
+{
+  int64_t lat_dtu;
+  uint32 lat_uus;
+
+  if (resp_cal_count >= RESP_CAL_POLLS)
+  {
+    return;
+  }
+
+  /* The system time is read with the resolution of the delayed TX time (512 dtu). */
+  lat_dtu = dw_ts_sub((uint64_t)dwt_readsystimestamphi32() << 8, poll_rx_ts);
+  lat_uus = (lat_dtu > 0) ? ((uint32)(lat_dtu / UUS_TO_DWT_TIME) + 1) : (0);
+  if (lat_uus > resp_lat_max_uus)
+  {
+    resp_lat_max_uus = lat_uus;
+  }
+
+  if (++resp_cal_count == RESP_CAL_POLLS)
+  {
+    resp_dly_uus = resp_lat_max_uus + RESP_DLY_MARGIN_UUS;
+    if (resp_dly_uus < RESP_DLY_MIN_UUS)
+    {
+      resp_dly_uus = RESP_DLY_MIN_UUS;
+    }
+    if (resp_dly_uus > POLL_RX_TO_RESP_TX_DLY_UUS)
+    {
+      resp_dly_uus = POLL_RX_TO_RESP_TX_DLY_UUS;
+    }
+    printf("Reply delay : %lu uus (latency %lu uus)\r\n", (unsigned long)resp_dly_uus, (unsigned long)resp_lat_max_uus);
+  }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn ds_resp_run()
+*
+* @brief Answer a DS TWR poll, then receive the final message and compute the distance. The poll has just been received.
+*
+* @param  none
+*
+* @return  1 if the response has been sent, 0 if it was too late
+*/
+static int ds_resp_run(void)
+{
+  uint32 resp_tx_time;
+  uint32 frame_len;
+
+  /* Retrieve poll reception timestamp and program the response, see the SS TWR response below. */
+  poll_rx_ts = dw_ts_read_rx();
+  resp_tx_time = dw_ts_dx_time(dw_ts_add(poll_rx_ts, (uint64_t)resp_dly_uus * UUS_TO_DWT_TIME));
+  dwt_setdelayedtrxtime(resp_tx_time);
+
+  /* The TX buffer no longer holds the SS TWR response. */
+  resp_staged = 0;
+
+  /* The receiver is turned on for the final after the response. */
+  dwt_setrxaftertxdelay(RESP_TX_TO_FINAL_RX_DLY_UUS);
+  dwt_setrxtimeout(FINAL_RX_TIMEOUT_UUS);
+
+  tx_ds_resp_msg[ALL_MSG_SN_IDX] = frame_seq_nb;
+  dwt_writetxdata(sizeof(tx_ds_resp_msg), tx_ds_resp_msg, 0); /* Zero offset in TX buffer. */
+  dwt_writetxfctrl(sizeof(tx_ds_resp_msg), 0, 1); /* Zero offset in TX buffer, ranging. */
+
+  if (dwt_starttx(DWT_START_TX_DELAYED | DWT_RESPONSE_EXPECTED) != DWT_SUCCESS)
+  {
+    /* Too late for the response, see NOTE 6 below. */
+    dwt_rxreset();
+    dwt_setrxtimeout(resp_rx_timeout_uus);
+    return(0);
+  }
+
+  /* Poll for reception of the final or error/timeout. See NOTE 5 below. */
+  while (!((status_reg = dwt_read32bitreg(SYS_STATUS_ID)) & (SYS_STATUS_RXFCG | SYS_STATUS_ALL_RX_TO | RX_ERR_WAIT_MASK)))
+  {};
+
+  /* Increment frame sequence number after transmission of the response message (modulo 256). */
+  frame_seq_nb++;
+
+  /* Back to the reception of polls. */
+  dwt_setrxtimeout(resp_rx_timeout_uus);
+
+  if (!(status_reg & SYS_STATUS_RXFCG))
+  {
+    /* Clear RX error/timeout events in the DW1000 status register. */
+    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_ALL_RX_TO | SYS_STATUS_ALL_RX_ERR | SYS_STATUS_TXFRS);
+
+    /* Reset RX to properly reinitialise LDE operation. */
+    dwt_rxreset();
+    return(1);
+  }
+
+  /* Clear good RX frame and TX frame sent events in the DW1000 status register. */
+  dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_RXFCG | SYS_STATUS_TXFRS);
+
+  frame_len = dwt_read32bitreg(RX_FINFO_ID) & RX_FINFO_RXFL_MASK_1023;
+  if (frame_len > RX_BUF_LEN)
+  {
+    return(1);
+  }
+  dwt_readrxdata(rx_buffer, frame_len, 0);
+
+  rx_buffer[ALL_MSG_SN_IDX] = 0;
+  if (memcmp(rx_buffer, rx_final_msg, ALL_MSG_COMMON_LEN) == 0)
+  {
+    uint32 poll_tx_ts, resp_rx_ts, final_tx_ts;
+    uint32 round_a, reply_a, round_b, reply_b;
+
+    /* Retrieve response transmission and final reception timestamps, 32-bit as in the final message. See NOTE 8 below. */
+    resp_tx_ts = dw_ts_read_tx();
+    final_rx_ts = dw_ts_read_rx();
+
+    /* Get timestamps embedded in the final message. */
+    poll_tx_ts = (uint32)dw_ts_get(&rx_buffer[FINAL_MSG_POLL_TX_TS_IDX], FINAL_MSG_TS_LEN);
+    resp_rx_ts = (uint32)dw_ts_get(&rx_buffer[FINAL_MSG_RESP_RX_TS_IDX], FINAL_MSG_TS_LEN);
+    final_tx_ts = (uint32)dw_ts_get(&rx_buffer[FINAL_MSG_FINAL_TX_TS_IDX], FINAL_MSG_TS_LEN);
+
+    /* Compute time of flight and distance. */
+    round_a = resp_rx_ts - poll_tx_ts;
+    reply_a = final_tx_ts - resp_rx_ts;
+    round_b = (uint32)final_rx_ts - (uint32)resp_tx_ts;
+    reply_b = (uint32)resp_tx_ts - (uint32)poll_rx_ts;
+
+    tof2 = dw_ds_twr_tof2(round_a, reply_a, round_b, reply_b);
+    distance_mm = dw_tof2_to_mm(tof2);
+    printf("DS Distance : %ld mm\r\n", (long)distance_mm);
+  }
+  return(1);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn resp_bench_ack()
+*
+* @brief Acknowledge a setting of the benchmark, the configuration frame has just been received. The setting is applied by
+*        resp_bench_run(). See NOTE 14 below.
+*
+* @param  idx  index of the setting
+*
+* @return none
+*/
+static void resp_bench_ack(int idx)
+{
+  tx_bench_ack_msg[ALL_MSG_SN_IDX] = frame_seq_nb;
+  tx_bench_ack_msg[BENCH_MSG_IDX_IDX] = (uint8)idx;
+  dwt_writetxdata(sizeof(tx_bench_ack_msg), tx_bench_ack_msg, 0); /* Zero offset in TX buffer. */
+  dwt_writetxfctrl(sizeof(tx_bench_ack_msg), 0, 0); /* Zero offset in TX buffer, not ranging. */
 
-/* Declaration of static functions. */
-//static uint64 get_tx_timestamp_u64(void);
-static uint64 get_rx_timestamp_u64(void);
-static void resp_msg_set_ts(uint8 *ts_field, const uint64 ts);
-//static void final_msg_get_ts(const uint8 *ts_field, uint32 *ts);
+  /* The TX buffer no longer holds the SS TWR response. */
+  resp_staged = 0;
 
-/* Timestamps of frames transmission/reception.
-* As they are 40-bit wide, we need to define a 64-bit int type to handle them. */
-typedef unsigned long long uint64;
-static uint64 poll_rx_ts;
-static uint64 resp_tx_ts;
+  if (dwt_starttx(DWT_START_TX_IMMEDIATE) == DWT_SUCCESS)
+  {
+    while (!(dwt_read32bitreg(SYS_STATUS_ID) & SYS_STATUS_TXFRS))
+    {};
+    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_TXFRS);
+    frame_seq_nb++;
+    bench_next = idx;
+  }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn resp_link_apply()
+*
+* @brief Switch the DW1000 to a profile of the link adaptation, asked for by the initiator in the poll which has just been
+*        answered. See NOTE 16 below.
+*
+* @param  profile  profile of link_adapt.c
+*
+* @return none
+*/
+static void resp_link_apply(int profile)
+{
+  dwt_config_t config;
+
+  if ((profile == link_profile) || (link_adapt_config(profile, &config) != 0))
+  {
+    return;
+  }
+
+  if (link_profile == LINK_PROFILE_BASE)
+  {
+    link_base_dly_uus = resp_dly_uus;
+    link_base_cal_count = resp_cal_count;
+  }
+
+  dwt_forcetrxoff();
+  dwt_configure(&config);
+
+  if (profile == LINK_PROFILE_BASE)
+  {
+    resp_rx_timeout_uus = 0;
+    resp_dly_uus = link_base_dly_uus;
+    resp_cal_count = link_base_cal_count;
+  }
+  else
+  {
+    /* The reply delay of the other profiles is computed, it is not calibrated. */
+    resp_rx_timeout_uus = LINK_RX_TIMEOUT_UUS;
+    resp_dly_uus = twr_bench_reply_uus(&config, LINK_POLL_LEN);
+    resp_cal_count = RESP_CAL_POLLS;
+  }
+  dwt_setrxtimeout(resp_rx_timeout_uus);
+
+  /* The response is staged again for the next poll. */
+  resp_staged = 0;
+  link_profile = profile;
+}
 
 /*! ------------------------------------------------------------------------------------------------------------------
 * @fn main()
@@ -90,18 +434,37 @@ static uint64 resp_tx_ts;
 *
 * @param  none
 *
-* @return none
+* @return  1 if a frame has been received, 0 on an RX timeout or error
 */
 
 int ss_resp_run(void)
 {
+  /* Only the polls addressed to this responder are answered, addresses are little endian. */
+  rx_poll_msg[ALL_MSG_DST_IDX] = (uint8)RESP_ADDR;
+  rx_poll_msg[ALL_MSG_DST_IDX + 1] = (uint8)(RESP_ADDR >> 8);
+  tx_resp_msg[ALL_MSG_SRC_IDX] = (uint8)RESP_ADDR;
+  tx_resp_msg[ALL_MSG_SRC_IDX + 1] = (uint8)(RESP_ADDR >> 8);
+  rx_ds_poll_msg[ALL_MSG_DST_IDX] = (uint8)RESP_ADDR;
+  rx_ds_poll_msg[ALL_MSG_DST_IDX + 1] = (uint8)(RESP_ADDR >> 8);
+  tx_ds_resp_msg[ALL_MSG_SRC_IDX] = (uint8)RESP_ADDR;
+  tx_ds_resp_msg[ALL_MSG_SRC_IDX + 1] = (uint8)(RESP_ADDR >> 8);
+  rx_final_msg[ALL_MSG_DST_IDX] = (uint8)RESP_ADDR;
+  rx_final_msg[ALL_MSG_DST_IDX + 1] = (uint8)(RESP_ADDR >> 8);
+  rx_bench_cfg_msg[ALL_MSG_DST_IDX] = (uint8)RESP_ADDR;
+  rx_bench_cfg_msg[ALL_MSG_DST_IDX + 1] = (uint8)(RESP_ADDR >> 8);
+  tx_bench_ack_msg[ALL_MSG_SRC_IDX] = (uint8)RESP_ADDR;
+  tx_bench_ack_msg[ALL_MSG_SRC_IDX + 1] = (uint8)(RESP_ADDR >> 8);
+
+  if (!resp_staged)
+  {
+    resp_stage();
+  }
 
   /* Activate reception immediately. */
   dwt_rxenable(DWT_START_RX_IMMEDIATE);
 
-  /* Poll for reception of a frame or error/timeout. See NOTE 5 below. */
-  while (!((status_reg = dwt_read32bitreg(SYS_STATUS_ID)) & (SYS_STATUS_RXFCG | SYS_STATUS_ALL_RX_TO | SYS_STATUS_ALL_RX_ERR)))
-  {};
+  /* Wait for the reception of a frame or error/timeout. See NOTE 5 and 17 below. */
+  status_reg = resp_wait_rx();
 
     #if 0	  // Include to determine the type of timeout if required.
     int temp = 0;
@@ -115,45 +478,62 @@ int ss_resp_run(void)
   if (status_reg & SYS_STATUS_RXFCG)
   {
     uint32 frame_len;
+    int bcast;
+    int link_req = link_profile;
 
-    /* Clear good RX frame event in the DW1000 status register. */
-    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_RXFCG);
+    /* Clear good RX frame event, and the frame filter rejections while waiting, in the DW1000 status register. */
+    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_RXFCG | SYS_STATUS_AFFREJ);
+    link_last_rx = xTaskGetTickCount();
 
     /* A frame has been received, read it into the local buffer. */
     frame_len = dwt_read32bitreg(RX_FINFO_ID) & RX_FINFO_RXFL_MASK_1023;
-    if (frame_len <= RX_BUFFER_LEN)
+    if (frame_len <= RX_BUF_LEN)
     {
       dwt_readrxdata(rx_buffer, frame_len, 0);
     }
 
+    /* A poll of a link adaptation initiator carries the profile it asks for. See NOTE 16 below. */
+    if (frame_len >= LINK_POLL_LEN)
+    {
+      link_req = rx_buffer[POLL_MSG_PROFILE_IDX];
+    }
+
     /* Check that the frame is a poll sent by "SS TWR initiator" example.
     * As the sequence number field of the frame is not relevant, it is cleared to simplify the validation of the frame. */
     rx_buffer[ALL_MSG_SN_IDX] = 0;
-    if (memcmp(rx_buffer, rx_poll_msg, ALL_MSG_COMMON_LEN) == 0)
+    bcast = (memcmp(rx_buffer, rx_bcast_poll_msg, ALL_MSG_COMMON_LEN) == 0);
+    if (bcast || (memcmp(rx_buffer, rx_poll_msg, ALL_MSG_COMMON_LEN) == 0))
     {
+      uint32 dly_uus = (bcast) ? (BCAST_RESP_DLY_UUS + RESP_SLOT * BCAST_SLOT_UUS) : (resp_dly_uus);
       uint32 resp_tx_time;
       int ret;
 
       /* Retrieve poll reception timestamp. */
-      poll_rx_ts = get_rx_timestamp_u64();
+      poll_rx_ts = dw_ts_read_rx();
 
       /* Compute final message transmission time. See NOTE 7 below. */
-      resp_tx_time = (poll_rx_ts + (POLL_RX_TO_RESP_TX_DLY_UUS * UUS_TO_DWT_TIME)) >> 8;
+      resp_tx_time = dw_ts_dx_time(dw_ts_add(poll_rx_ts, (uint64_t)dly_uus * UUS_TO_DWT_TIME));
       dwt_setdelayedtrxtime(resp_tx_time);
 
       /* Response TX timestamp is the transmission time we programmed plus the antenna delay. */
-      resp_tx_ts = (((uint64)(resp_tx_time & 0xFFFFFFFEUL)) << 8) + TX_ANT_DLY;
+      resp_tx_ts = dw_ts_add(dw_ts_from_dx_time(resp_tx_time), TX_ANT_DLY);
 
       /* Write all timestamps in the final message. See NOTE 8 below. */
-      resp_msg_set_ts(&tx_resp_msg[RESP_MSG_POLL_RX_TS_IDX], poll_rx_ts);
-      resp_msg_set_ts(&tx_resp_msg[RESP_MSG_RESP_TX_TS_IDX], resp_tx_ts);
+      dw_ts_set(&tx_resp_msg[RESP_MSG_POLL_RX_TS_IDX], poll_rx_ts, RESP_MSG_TS_LEN);
+      dw_ts_set(&tx_resp_msg[RESP_MSG_RESP_TX_TS_IDX], resp_tx_ts, RESP_MSG_TS_LEN);
 
-      /* Write and send the response message. See NOTE 9 below. */
-      tx_resp_msg[ALL_MSG_SN_IDX] = frame_seq_nb;
-      dwt_writetxdata(sizeof(tx_resp_msg), tx_resp_msg, 0); /* Zero offset in TX buffer. See Note 5 below.*/
-      dwt_writetxfctrl(sizeof(tx_resp_msg), 0, 1); /* Zero offset in TX buffer, ranging. */
+      /* Only patch the two time-stamps of the staged response, the length given to dwt_writetxdata() includes the 2 bytes of
+      * check-sum which are not written. See NOTE 9 below. */
+      dwt_writetxdata(2 * RESP_MSG_TS_LEN + 2, &tx_resp_msg[RESP_MSG_POLL_RX_TS_IDX], RESP_MSG_POLL_RX_TS_IDX);
+      if (!bcast)
+      {
+        resp_calibrate();
+      }
       ret = dwt_starttx(DWT_START_TX_DELAYED);
 
+      /* The sequence number changes, the next response is staged before the next poll. */
+      resp_staged = 0;
+
       //ret = dwt_starttx(DWT_START_TX_IMMEDIATE);
 
       /* If dwt_starttx() returns an error, abandon this ranging exchange and proceed to the next one. */
@@ -168,6 +548,11 @@ int ss_resp_run(void)
 
       /* Increment frame sequence number after transmission of the poll message (modulo 256). */
       frame_seq_nb++;
+
+      if (!bcast)
+      {
+        resp_link_apply(link_req);
+      }
       }
       else
       {
@@ -178,69 +563,131 @@ int ss_resp_run(void)
       Knowing the exact time when the responder is going to send its response is vital for time of flight 
       calculation. The specification of the time of respnse must allow the processor enough time to do its 
       calculations and put the packet in the Tx buffer. So more time is required for a slower system(processor).
+      The reply delay is auto-tuned (NOTE 12), a late response increases it.
       */
+      if (!bcast && (resp_dly_uus + RESP_DLY_STEP_UUS <= POLL_RX_TO_RESP_TX_DLY_UUS))
+      {
+        resp_dly_uus += RESP_DLY_STEP_UUS;
+      }
 
       /* Reset RX to properly reinitialise LDE operation. */
       dwt_rxreset();
       }
     }
+    else if (memcmp(rx_buffer, rx_ds_poll_msg, ALL_MSG_COMMON_LEN) == 0)
+    {
+      if (ds_resp_run())
+      {
+        resp_link_apply(link_req);
+      }
+    }
+    else if (TWR_BENCH && (frame_len == sizeof(rx_bench_cfg_msg)) && (memcmp(rx_buffer, rx_bench_cfg_msg, ALL_MSG_COMMON_LEN) == 0))
+    {
+      resp_bench_ack(rx_buffer[BENCH_MSG_IDX_IDX]);
+    }
   }
   else
   {
-    /* Clear RX error events in the DW1000 status register. */
-    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_ALL_RX_ERR);
+    /* Clear RX error/timeout events in the DW1000 status register. */
+    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_ALL_RX_TO | SYS_STATUS_ALL_RX_ERR);
 
     /* Reset RX to properly reinitialise LDE operation. */
     dwt_rxreset();
+    return(0);
   }
 
   return(1);		
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
-* @fn get_rx_timestamp_u64()
+* @fn resp_bench_run()
 *
-* @brief Get the RX time-stamp in a 64-bit variable.
-*        /!\ This function assumes that length of time-stamps is 40 bits, for both TX and RX!
+* @brief Answer the polls of the benchmark with the acknowledged setting, until the initiator has been silent for BENCH_IDLE_MS,
+*        then go back to the base settings. Called from the responder task.
 *
 * @param  none
 *
-* @return  64-bit value of the read time-stamp.
+* @return none
 */
-static uint64 get_rx_timestamp_u64(void)
+static void resp_bench_run(void)
 {
-  uint8 ts_tab[5];
-  uint64 ts = 0;
-  int i;
-  dwt_readrxtimestamp(ts_tab);
-  for (i = 4; i >= 0; i--)
+  const uint32 dly_uus = resp_dly_uus;
+  const int cal_count = resp_cal_count;
+  const twr_bench_cfg_t *b;
+  dwt_config_t config;
+  TickType_t last;
+
+  /* The reply delay of each setting is computed, it is not calibrated. */
+  resp_cal_count = RESP_CAL_POLLS;
+
+  while (bench_next >= 0)
   {
-    ts <<= 8;
-    ts |= ts_tab[i];
+    b = twr_bench_get(bench_next);
+    bench_next = -1;
+    if ((b == NULL) || (twr_bench_dwt_config(b, &config) != 0))
+    {
+      break;
+    }
+
+    dwt_forcetrxoff();
+    dwt_configure(&config);
+    resp_rx_timeout_uus = BENCH_RX_TIMEOUT_UUS;
+    dwt_setrxtimeout(resp_rx_timeout_uus);
+    resp_dly_uus = twr_bench_reply_uus(&config, sizeof(rx_poll_msg));
+
+    last = xTaskGetTickCount();
+    while ((bench_next < 0) && ((xTaskGetTickCount() - last) < pdMS_TO_TICKS(BENCH_IDLE_MS)))
+    {
+      if (ss_resp_run())
+      {
+        last = xTaskGetTickCount();
+      }
+    }
   }
-  return ts;
+
+  twr_bench_dwt_config(&twr_bench_base, &config);
+  dwt_forcetrxoff();
+  dwt_configure(&config);
+  resp_rx_timeout_uus = 0;
+  dwt_setrxtimeout(resp_rx_timeout_uus);
+  resp_dly_uus = dly_uus;
+  resp_cal_count = cal_count;
+  link_profile = LINK_PROFILE_BASE;
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
-* @fn final_msg_set_ts()
+* @fn ss_resp_set_filter()
 *
-* @brief Fill a given timestamp field in the response message with the given value. In the timestamp fields of the
-*        response message, the least significant byte is at the lower address.
+* @brief Set the PAN ID and the short address of the responder and enable the frame filter of the DW1000 for data frames, called
+*        once the DW1000 is configured. See NOTE 15 below.
 *
-* @param  ts_field  pointer on the first byte of the timestamp field to fill
-*         ts  timestamp value
+* @param  none
 *
 * @return none
 */
-static void resp_msg_set_ts(uint8 *ts_field, const uint64 ts)
+void ss_resp_set_filter(void)
 {
-  int i;
-  for (i = 0; i < RESP_MSG_TS_LEN; i++)
-  {
-    ts_field[i] = (ts >> (i * 8)) & 0xFF;
-  }
+  dwt_setpanid(TWR_PAN_ID);
+  dwt_setaddress16(RESP_ADDR);
+  dwt_enableframefilter(DWT_FF_DATA_EN);
 }
 
+/*! ------------------------------------------------------------------------------------------------------------------
+* @fn ss_resp_set_irq()
+*
+* @brief Enable the DW1000 IRQ on the events ending the wait for a poll, with TWR_TICKLESS_IDLE. The bits of the interrupt mask are
+*        those of the status register. See NOTE 17 below.
+*
+* @param  none
+*
+* @return none
+*/
+void ss_resp_set_irq(void)
+{
+  #if defined(USE_FREERTOS) && TWR_TICKLESS_IDLE
+    dwt_setinterrupt(RX_WAIT_EVENTS, 1);
+  #endif
+}
 
 /**@brief SS TWR Initiator task entry function.
 *
@@ -254,7 +701,23 @@ void ss_responder_task_function (void * pvParameter)
 
   while (true)
   {
-    ss_resp_run();
+    int rx = ss_resp_run();
+    if (bench_next >= 0)
+    {
+      /* Benchmark setting acknowledged, see NOTE 14 below. */
+      resp_bench_run();
+      continue;
+    }
+    if ((link_profile != LINK_PROFILE_BASE) && ((xTaskGetTickCount() - link_last_rx) >= pdMS_TO_TICKS(LINK_IDLE_MS)))
+    {
+      /* The initiator is lost on this profile, see NOTE 16 below. */
+      resp_link_apply(LINK_PROFILE_BASE);
+    }
+    if (!rx)
+    {
+      /* RX timeout of a profile, the idle time has been checked. */
+      continue;
+    }
     /* Delay a task for a given number of ticks */
     vTaskDelay(RNG_DELAY_MS);
     /* Tasks must be implemented to never return... */
@@ -312,6 +775,41 @@ void ss_responder_task_function (void * pvParameter)
 *    work anymore then as we would still have to indicate the full length of the frame to dwt_writetxdata()).
 *10. The user is referred to DecaRanging ARM application (distributed with EVK1000 product) for additional practical example of usage, and to the
 *    DW1000 API Guide for more details on the DW1000 driver functions.
+*11. The initiator selects the ranging scheme with the function code of its poll (TWR_DS in ss_init_main.c), 0xE0 for single-sided TWR and
+*    0x21 for asymmetric double-sided TWR: a short response (0x10) is sent and a final message (0x23) carrying the initiator time-stamps is
+*    received, the distance is computed here with dw_ds_twr_tof2(). The DS TWR result does not depend on the clock offset, so it keeps its
+*    accuracy with a short POLL_RX_TO_RESP_TX_DLY_UUS.
+*12. The response is staged in the TX buffer before the poll is received (resp_stage()), so the time critical part only writes the 8 bytes
+*    of time-stamps. The reply delay then only has to cover the poll read out, the time-stamp read and that write. For the first
+*    RESP_CAL_POLLS polls the worst case POLL_RX_TO_RESP_TX_DLY_UUS is used and the latency from the poll RX time-stamp to the response
+*    being ready is measured (resp_calibrate()); the reply delay is then the worst latency plus RESP_DLY_MARGIN_UUS, at least
+*    RESP_DLY_MIN_UUS. A response which is still too late (e.g. a higher priority task ran) raises it by RESP_DLY_STEP_UUS. The SS TWR
+*    initiator uses the time-stamps of the response, so it does not need to know the reply delay. A shorter reply delay means less air
+*    time per exchange and less clock drift error in the SS TWR result.
+*13. A poll to the broadcast address with the function code 0xE2 is answered by every responder of the initiator table, each in its own
+*    slot: BCAST_RESP_DLY_UUS + RESP_SLOT * BCAST_SLOT_UUS after the poll, with the staged SS TWR response. The slots are fixed so they do
+*    not follow the auto-tuned reply delay, RESP_SLOT must be unique among the responders in range.
+*14. A TWR_BENCH build also answers the configuration frames of the benchmark initiator (function code 0xE5, see twr_bench.c): it
+*    acknowledges the index of the setting (0xE6), switches the DW1000 to that setting and answers the polls with the reply delay
+*    computed for it (twr_bench_reply_uus(), the calibration of NOTE 12 is suspended), without the task delay between the exchanges.
+*    After BENCH_IDLE_MS without a frame it goes back to the base settings of main.c, which must match twr_bench_base. This needs the
+*    responder task: the bare-metal loop of main() does not follow the settings.
+*15. The frame filter of the DW1000 only accepts the data frames of the PAN 0xDECA addressed to RESP_ADDR or to the broadcast address,
+*    the others are dropped by the DW1000 which keeps listening: the frames of the other ranging systems in range no longer end the
+*    wait for a poll with an RX reset and a frame read, and they no longer cost the task delay of the responder. The rejection status
+*    (AFFREJ) is therefore not waited for, it is cleared with the good frame events. The broadcast poll needs no coordinator mode, the
+*    PAN ID of the poll matches.
+*16. A poll of 13 bytes comes from an initiator with link adaptation (TWR_LINK_ADAPT in ss_init_main.c, see link_adapt.c): byte 10 is
+*    the profile it asks for. The poll is answered on the current profile, then the DW1000 is switched to the one asked for, with the
+*    reply delay computed for it (twr_bench_reply_uus(), the calibration of NOTE 12 is kept for the base profile) and an RX timeout of
+*    LINK_RX_TIMEOUT_UUS. After LINK_IDLE_MS without a frame on another profile the responder goes back to the base profile of main.c,
+*    where a lost initiator looks for it. A 12 byte poll leaves the profile unchanged. As with NOTE 14 this needs the responder task.
+*17. With TWR_TICKLESS_IDLE (config/FreeRTOSConfig.h) the responder task does not poll the status register over SPI while it waits for
+*    a poll, which would keep the nRF52 awake: the DW1000 raises its IRQ on RX_WAIT_EVENTS and the GPIOTE handler of main.c notifies
+*    the task, which sleeps in ulTaskNotifyTake() while the tick is stopped. The IRQ stays high until the events are cleared, all of
+*    them are cleared once the frame or the error is handled. The time critical waits of an exchange (the final of DS TWR and the
+*    TX confirmations) last less than a millisecond and are still polled: the TX confirmation does not raise the IRQ, the notification
+*    left by the final only costs one more status read in the next wait.
 *
 ****************************************************************************************************************************************************/
  
\ No newline at end of file
@@ -11,6 +11,8 @@
  */ 
 #include "lmh.h"
 #include "dwm_api.h"
+#include "dwm_api_cache.h"
+#include "dwm_tlv.h"
 #include <string.h>
 
 #define RESP_ERRNO_LEN           3
@@ -28,6 +30,16 @@ void dwm_deinit(void)
    LMH_DeInit();
 }
 
+int dwm_dev_sel(int dev)
+{
+   return (HAL_DevSel(dev) == HAL_OK) ? RV_OK : RV_ERR;
+}
+
+int dwm_dev_num(void)
+{
+   return HAL_DevNum();
+}
+
 int dwm_pos_set(dwm_pos_t* pos)
 {
    uint8_t tx_data[DWM1001_TLV_MAX_SIZE], tx_len = 0;
@@ -35,13 +47,7 @@ int dwm_pos_set(dwm_pos_t* pos)
    uint16_t rx_len;
    tx_data[tx_len++] = DWM1001_TLV_TYPE_CMD_POS_SET;
    tx_data[tx_len++] = 13;
-   *(uint32_t*)(tx_data+tx_len) = pos->x;
-   tx_len+=4;
-   *(uint32_t*)(tx_data+tx_len) = pos->y;
-   tx_len+=4;
-   *(uint32_t*)(tx_data+tx_len) = pos->z;
-   tx_len+=4;
-   tx_data[tx_len++] = pos->qf;
+   tx_len += dwm_tlv_encode(tx_data+tx_len, DWM1001_TLV_MAX_SIZE-tx_len, &dwm_tlv_pos_layout, pos, 0);
    LMH_Tx(tx_data, &tx_len);      
    return LMH_WaitForRx(rx_data, &rx_len, 3);
 }
@@ -51,30 +57,12 @@ int dwm_pos_get(dwm_pos_t* p_pos)
    uint8_t tx_data[DWM1001_TLV_MAX_SIZE], tx_len = 0;
    uint8_t rx_data[DWM1001_TLV_MAX_SIZE];
    uint16_t rx_len;
-   uint8_t data_cnt;
    tx_data[tx_len++] = DWM1001_TLV_TYPE_CMD_POS_GET;
    tx_data[tx_len++] = 0;   
    LMH_Tx(tx_data, &tx_len);   
    if(LMH_WaitForRx(rx_data, &rx_len, 18) == RV_OK)
    {
-      data_cnt = RESP_DAT_VALUE_OFFSET;
-      p_pos->x = rx_data[data_cnt] 
-             + (rx_data[data_cnt+1]<<8) 
-             + (rx_data[data_cnt+2]<<16) 
-             + (rx_data[data_cnt+3]<<24); 
-      data_cnt += 4;
-      p_pos->y = rx_data[data_cnt] 
-             + (rx_data[data_cnt+1]<<8) 
-             + (rx_data[data_cnt+2]<<16) 
-             + (rx_data[data_cnt+3]<<24); 
-      data_cnt += 4;
-      p_pos->z = rx_data[data_cnt] 
-             + (rx_data[data_cnt+1]<<8) 
-             + (rx_data[data_cnt+2]<<16) 
-             + (rx_data[data_cnt+3]<<24); 
-      data_cnt += 4;
-      p_pos->qf = rx_data[data_cnt];
-      return RV_OK;
+      return dwm_tlv_pos_decode(rx_data, rx_len, p_pos);
    }   
    return RV_ERR;
 }
@@ -106,9 +94,9 @@ int dwm_upd_rate_get(uint16_t *ur, uint16_t *ur_static)
    if(LMH_WaitForRx(rx_data, &rx_len, 9) == RV_OK)
    {
       data_cnt = RESP_DAT_VALUE_OFFSET;
-      *ur = rx_data[data_cnt] + (rx_data[data_cnt+1]<<8);
+      *ur = dwm_tlv_get(rx_data+data_cnt, 2);
       data_cnt += 2;
-      *ur_static  = rx_data[data_cnt] + (rx_data[data_cnt+1]<<8);
+      *ur_static  = dwm_tlv_get(rx_data+data_cnt, 2);
       data_cnt += 2;
       return RV_OK;
    }   
@@ -120,6 +108,7 @@ int dwm_cfg_tag_set(dwm_cfg_tag_t* cfg)
    uint8_t tx_data[DWM1001_TLV_MAX_SIZE], tx_len = 0;
    uint8_t rx_data[DWM1001_TLV_MAX_SIZE];
    uint16_t rx_len;
+   int rv;
    tx_data[tx_len++] = DWM1001_TLV_TYPE_CMD_CFG_TN_SET;
    tx_data[tx_len++] = 2;
    tx_data[tx_len++] = (cfg->low_power_en ?        (1<<7):0)
@@ -132,7 +121,9 @@ int dwm_cfg_tag_set(dwm_cfg_tag_t* cfg)
    tx_data[tx_len++] = (cfg->stnry_en ?            (1<<2):0)
                      + (((cfg->meas_mode)       &  0x03)<<0);
    LMH_Tx(tx_data, &tx_len);    
-   return LMH_WaitForRx(rx_data, &rx_len, 3);   
+   rv = LMH_WaitForRx(rx_data, &rx_len, 3);
+   dwm_cache_invalidate(DWM_CACHE_MASK(DWM_CACHE_CFG) | DWM_CACHE_MASK(DWM_CACHE_ANCHOR_LIST));
+   return rv;   
 }
 
 int dwm_cfg_anchor_set(dwm_cfg_anchor_t* cfg)
@@ -140,6 +131,7 @@ int dwm_cfg_anchor_set(dwm_cfg_anchor_t* cfg)
    uint8_t tx_data[DWM1001_TLV_MAX_SIZE], tx_len = 0;
    uint8_t rx_data[DWM1001_TLV_MAX_SIZE];
    uint16_t rx_len;
+   int rv;
    tx_data[tx_len++] = DWM1001_TLV_TYPE_CMD_CFG_AN_SET;
    tx_data[tx_len++] = 2;
    tx_data[tx_len++] = (cfg->initiator ?           (1<<7):0)
@@ -151,7 +143,9 @@ int dwm_cfg_anchor_set(dwm_cfg_anchor_t* cfg)
                      + (((cfg->common.uwb_mode)  & 0x03)<<0);
    tx_data[tx_len++] = ((cfg->uwb_bh_routing      & 0x03)<<0);
    LMH_Tx(tx_data, &tx_len);    
-   return LMH_WaitForRx(rx_data, &rx_len, 3);   
+   rv = LMH_WaitForRx(rx_data, &rx_len, 3);
+   dwm_cache_invalidate(DWM_CACHE_MASK(DWM_CACHE_CFG) | DWM_CACHE_MASK(DWM_CACHE_ANCHOR_LIST));
+   return rv;   
 }
 
 int dwm_cfg_get(dwm_cfg_t* cfg)
@@ -226,25 +220,12 @@ int dwm_anchor_list_get(dwm_anchor_list_t *p_list)
          }        
          for (i = 0; i < p_list->cnt; i++)
          {
-            p_list->v[i].node_id = rx_data[data_cnt]
-                                 + (rx_data[data_cnt+1]<<8);
-            data_cnt += 2;
-            p_list->v[i].x = rx_data[data_cnt]
-                           + (rx_data[data_cnt+1]<<8)
-                           + (rx_data[data_cnt+2]<<16)
-                           + (rx_data[data_cnt+3]<<24);
-            data_cnt += 4;
-            p_list->v[i].y = rx_data[data_cnt]
-                           + (rx_data[data_cnt+1]<<8)
-                           + (rx_data[data_cnt+2]<<16)
-                           + (rx_data[data_cnt+3]<<24);
-            data_cnt += 4;
-            p_list->v[i].z = rx_data[data_cnt]
-                           + (rx_data[data_cnt+1]<<8)
-                           + (rx_data[data_cnt+2]<<16)
-                           + (rx_data[data_cnt+3]<<24);
-            data_cnt += 4;
-            p_list->v[i].rssi = rx_data[data_cnt++];
+            // element + seat byte
+            if(data_cnt + dwm_tlv_anchor_elt_layout.wire_len + 1 > rx_len)
+            {
+               return RV_ERR;
+            }
+            data_cnt += dwm_tlv_decode(rx_data+data_cnt, rx_len-data_cnt, &dwm_tlv_anchor_elt_layout, &p_list->v[i], 0);
             p_list->v[i].seat = rx_data[data_cnt] & 0x0f;
             p_list->v[i].neighbor_network = (rx_data[data_cnt] & 0x10) >> 4;
             data_cnt++;
@@ -256,122 +237,19 @@ int dwm_anchor_list_get(dwm_anchor_list_t *p_list)
    return RV_ERR;
 }
 
-#define RESP_DATA_LOC_LOC_SIZE     15
-#define RESP_DATA_LOC_DIST_OFFSET  RESP_DAT_TYPE_OFFSET + RESP_DATA_LOC_LOC_SIZE
-#define RESP_DATA_LOC_DIST_LEN_MIN 3
 int dwm_loc_get(dwm_loc_data_t* loc)
 { 
    uint8_t tx_data[DWM1001_TLV_MAX_SIZE], tx_len = 0;
    uint8_t rx_data[DWM1001_TLV_MAX_SIZE];
    uint16_t rx_len;
-   uint8_t data_cnt, i, j;
    tx_data[tx_len++] = DWM1001_TLV_TYPE_CMD_LOC_GET;
    tx_data[tx_len++] = 0;   
    LMH_Tx(tx_data, &tx_len);   
    if(LMH_WaitForRx(rx_data, &rx_len, DWM1001_TLV_MAX_SIZE) == RV_OK)
    {
-      if(rx_len<RESP_ERRNO_LEN+RESP_DATA_LOC_LOC_SIZE + RESP_DATA_LOC_DIST_LEN_MIN)// ok + pos + distance/range
-      {
-         return RV_ERR;
-      }
-      
-      if(rx_data[RESP_DAT_TYPE_OFFSET]==DWM1001_TLV_TYPE_POS_XYZ)//0x41
-      {
-         // node self position.
-         data_cnt = RESP_DAT_VALUE_OFFSET;// jump Type and Length, goto data
-         loc->p_pos->x = rx_data[data_cnt] 
-                      + (rx_data[data_cnt+1]<<8) 
-                      + (rx_data[data_cnt+2]<<16) 
-                      + (rx_data[data_cnt+3]<<24); 
-         data_cnt += 4;
-         loc->p_pos->y = rx_data[data_cnt] 
-                      + (rx_data[data_cnt+1]<<8) 
-                      + (rx_data[data_cnt+2]<<16) 
-                      + (rx_data[data_cnt+3]<<24); 
-         data_cnt += 4;
-         loc->p_pos->z = rx_data[data_cnt] 
-                      + (rx_data[data_cnt+1]<<8) 
-                      + (rx_data[data_cnt+2]<<16) 
-                      + (rx_data[data_cnt+3]<<24); 
-         data_cnt += 4;
-         loc->p_pos->qf = rx_data[data_cnt++];
-      }
-      
-      if(rx_data[RESP_DATA_LOC_DIST_OFFSET]==DWM1001_TLV_TYPE_RNG_AN_DIST)//0x48
-      {
-         // node is Anchor, recording Tag ID, distances and qf
-         loc->anchors.dist.cnt = rx_data[RESP_DATA_LOC_DIST_OFFSET+2];
-         loc->anchors.an_pos.cnt = 0;
-         data_cnt = RESP_DATA_LOC_DIST_OFFSET + 3; // jump Type, Length and cnt, goto data
-         for (i = 0; i < loc->anchors.dist.cnt; i++)
-         {
-            // Tag ID
-            loc->anchors.dist.addr[i] = 0;
-            for (j = 0; j < 8; j++)
-            {
-               loc->anchors.dist.addr[i] += rx_data[data_cnt++]<<(j*8);
-            }
-            // Tag distance
-            loc->anchors.dist.dist[i] = 0;
-            for (j = 0; j < 4; j++)
-            {
-               loc->anchors.dist.dist[i] += rx_data[data_cnt++]<<(j*8);
-            }
-            // Tag qf
-            loc->anchors.dist.qf[i] = rx_data[data_cnt++];
-         }
-      }
-      else if (rx_data[RESP_DATA_LOC_DIST_OFFSET]==DWM1001_TLV_TYPE_RNG_AN_POS_DIST)//0x49
-      {
-         // node is Tag, recording Anchor ID, distances, qf and positions
-         loc->anchors.dist.cnt = rx_data[RESP_DATA_LOC_DIST_OFFSET+2];
-         loc->anchors.an_pos.cnt = rx_data[RESP_DATA_LOC_DIST_OFFSET+2];
-         data_cnt = RESP_DATA_LOC_DIST_OFFSET + 3; // jump Type, Length and cnt, goto data
-         for (i = 0; i < loc->anchors.dist.cnt; i++)
-         {
-            // anchor ID
-            loc->anchors.dist.addr[i] = 0;
-            for (j = 0; j < 2; j++)
-            {
-               loc->anchors.dist.addr[i] += ((uint64_t)rx_data[data_cnt++])<<(j*8);
-            }
-            // anchor distance
-            loc->anchors.dist.dist[i] = 0;
-            for (j = 0; j < 4; j++)
-            {
-               loc->anchors.dist.dist[i] += ((uint32_t)rx_data[data_cnt++])<<(j*8);
-            }
-            // anchor qf
-            loc->anchors.dist.qf[i] = rx_data[data_cnt++];
-            // anchor position
-            loc->anchors.an_pos.pos[i].x  = rx_data[data_cnt] 
-                                         + (rx_data[data_cnt+1]<<8) 
-                                         + (rx_data[data_cnt+2]<<16) 
-                                         + (rx_data[data_cnt+3]<<24); 
-            data_cnt += 4;
-            loc->anchors.an_pos.pos[i].y = rx_data[data_cnt] 
-                                         + (rx_data[data_cnt+1]<<8) 
-                                         + (rx_data[data_cnt+2]<<16) 
-                                         + (rx_data[data_cnt+3]<<24); 
-            data_cnt += 4;
-            loc->anchors.an_pos.pos[i].z = rx_data[data_cnt] 
-                                         + (rx_data[data_cnt+1]<<8) 
-                                         + (rx_data[data_cnt+2]<<16) 
-                                         + (rx_data[data_cnt+3]<<24); 
-            data_cnt += 4;
-            loc->anchors.an_pos.pos[i].qf = rx_data[data_cnt++];
-         }
-      }
-      else
-      {
-         return RV_ERR;   
-      }
-   }
-   else
-   {
-      return RV_ERR;   
+      return dwm_tlv_loc_decode(rx_data, rx_len, loc);
    }
-   return RV_OK;
+   return RV_ERR;   
 }
 
 int dwm_baddr_set(dwm_baddr_t* p_baddr)
@@ -451,10 +329,13 @@ int dwm_factory_reset(void)
    uint8_t tx_data[DWM1001_TLV_MAX_SIZE], tx_len = 0;
    uint8_t rx_data[DWM1001_TLV_MAX_SIZE];
    uint16_t rx_len;
+   int rv;
    tx_data[tx_len++] = DWM1001_TLV_TYPE_CMD_FAC_RESET;
    tx_data[tx_len++] = 0;  
    LMH_Tx(tx_data, &tx_len);      
-   return LMH_WaitForRx(rx_data, &rx_len, 3);   
+   rv = LMH_WaitForRx(rx_data, &rx_len, 3);
+   dwm_cache_invalidate(DWM_CACHE_ALL);
+   return rv;   
 }  
 
 int dwm_reset(void)
@@ -462,10 +343,13 @@ int dwm_reset(void)
    uint8_t tx_data[DWM1001_TLV_MAX_SIZE], tx_len = 0;
    uint8_t rx_data[DWM1001_TLV_MAX_SIZE];
    uint16_t rx_len;
+   int rv;
    tx_data[tx_len++] = DWM1001_TLV_TYPE_CMD_RESET;
    tx_data[tx_len++] = 0;  
    LMH_Tx(tx_data, &tx_len);      
-   return LMH_WaitForRx(rx_data, &rx_len, 3);   
+   rv = LMH_WaitForRx(rx_data, &rx_len, 3);
+   dwm_cache_invalidate(DWM_CACHE_ALL);
+   return rv;   
 }
 
 int dwm_ver_get(dwm_ver_t* ver)
@@ -533,6 +417,7 @@ int dwm_uwb_cfg_set(dwm_uwb_cfg_t* p_cfg)
    uint8_t tx_data[DWM1001_TLV_MAX_SIZE], tx_len = 0;
    uint8_t rx_data[DWM1001_TLV_MAX_SIZE];
    uint16_t rx_len;
+   int rv;
    tx_data[tx_len++] = DWM1001_TLV_TYPE_CMD_UWB_CFG_SET;
    tx_data[tx_len++] = 5;
    tx_data[tx_len++] = p_cfg->pg_delay;
@@ -541,7 +426,9 @@ int dwm_uwb_cfg_set(dwm_uwb_cfg_t* p_cfg)
    tx_data[tx_len++] = (p_cfg->tx_power >> 16) & 0xff;
    tx_data[tx_len++] = (p_cfg->tx_power >> 24) & 0xff;
    LMH_Tx(tx_data, &tx_len);    
-   return LMH_WaitForRx(rx_data, &rx_len, 3);   
+   rv = LMH_WaitForRx(rx_data, &rx_len, 3);
+   dwm_cache_invalidate(DWM_CACHE_MASK(DWM_CACHE_ANCHOR_LIST));
+   return rv;   
 }
 
 int dwm_uwb_cfg_get(dwm_uwb_cfg_t* p_cfg) 
@@ -582,21 +469,7 @@ int dwm_usr_data_read(uint8_t* p_data, uint8_t* p_len)
    LMH_Tx(tx_data, &tx_len);   
    if(LMH_WaitForRx(rx_data, &rx_len, DWM1001_TLV_MAX_SIZE) == RV_OK)
    {
-      if((rx_len<3+2) || (rx_len > 3+2+DWM_API_USR_DATA_LEN_MAX))// ok + pos + distance/range
-      {
-         return RV_ERR;
-      }      
-      memset(p_data, 0, DWM_API_USR_DATA_LEN_MAX);
-      *p_len = rx_data[4];
-      if((rx_len == 5) && (*p_len == 0))
-      {
-         return RV_OK;
-      }
-      if(*p_len <= DWM_API_USR_DATA_LEN_MAX)
-      {
-         memcpy(p_data, rx_data+5, *p_len);
-         return RV_OK;
-      }
+      return dwm_tlv_usr_data_decode(rx_data, rx_len, p_data, p_len);
    }   
    return RV_ERR;   
 }
@@ -761,12 +634,15 @@ int dwm_panid_set(uint16_t value)
    uint8_t tx_data[DWM1001_TLV_MAX_SIZE], tx_len = 0;
    uint8_t rx_data[DWM1001_TLV_MAX_SIZE];
    uint16_t rx_len;
+   int rv;
    tx_data[tx_len++] = DWM1001_TLV_TYPE_CMD_PANID_SET;
    tx_data[tx_len++] = 2;
    tx_data[tx_len++] = value & 0xff;
    tx_data[tx_len++] = (value & 0xff00)>>8;    
    LMH_Tx(tx_data, &tx_len);   
-   return LMH_WaitForRx(rx_data, &rx_len, 3);
+   rv = LMH_WaitForRx(rx_data, &rx_len, 3);
+   dwm_cache_invalidate(DWM_CACHE_MASK(DWM_CACHE_ANCHOR_LIST));
+   return rv;
 }
 
 int dwm_panid_get(uint16_t* p_value)
@@ -779,7 +655,7 @@ int dwm_panid_get(uint16_t* p_value)
    LMH_Tx(tx_data, &tx_len);   
    if(LMH_WaitForRx(rx_data, &rx_len, 7) == RV_OK)
    {
-      *p_value = rx_data[5] + ((uint16_t)rx_data[6]<<8);
+      *p_value = dwm_tlv_get(rx_data+RESP_DAT_VALUE_OFFSET, 2);
       return RV_OK;
    }   
    return RV_ERR;
@@ -790,22 +666,12 @@ int dwm_node_id_get(uint64_t *p_node_id)
    uint8_t tx_data[DWM1001_TLV_MAX_SIZE], tx_len = 0;
    uint8_t rx_data[DWM1001_TLV_MAX_SIZE];
    uint16_t rx_len;
-   uint8_t data_cnt;
    tx_data[tx_len++] = DWM1001_TLV_TYPE_CMD_NODE_ID_GET;
    tx_data[tx_len++] = 0; 
    LMH_Tx(tx_data, &tx_len);  
    if(LMH_WaitForRx(rx_data, &rx_len, 13) == RV_OK)
    {
-      data_cnt = RESP_DAT_VALUE_OFFSET;
-      *p_node_id = (uint64_t)rx_data[data_cnt] 
-               + ((uint64_t)rx_data[data_cnt+1]<<8) 
-               + ((uint64_t)rx_data[data_cnt+2]<<16) 
-               + ((uint64_t)rx_data[data_cnt+3]<<24) 
-               + ((uint64_t)rx_data[data_cnt+4]<<32) 
-               + ((uint64_t)rx_data[data_cnt+5]<<40) 
-               + ((uint64_t)rx_data[data_cnt+6]<<48) 
-               + ((uint64_t)rx_data[data_cnt+7]<<56); 
-      return RV_OK;
+      return dwm_tlv_node_id_decode(rx_data, rx_len, p_node_id);
    }   
    return RV_ERR; 
 }
@@ -815,22 +681,16 @@ int dwm_status_get(dwm_status_t* p_status)
    uint8_t tx_data[DWM1001_TLV_MAX_SIZE], tx_len = 0;
    uint8_t rx_data[DWM1001_TLV_MAX_SIZE];
    uint16_t rx_len;
-   uint16_t flags;
    tx_data[tx_len++] = DWM1001_TLV_TYPE_CMD_STATUS_GET;
    tx_data[tx_len++] = 0;   
    LMH_Tx(tx_data, &tx_len);   
    if(LMH_WaitForRx(rx_data, &rx_len, 7) == RV_OK)
    {
-      flags = (uint16_t)rx_data[5] + (((uint16_t)rx_data[6])<<8);
-      p_status->loc_data         = (flags & API_STATUS_FLAG_LOC_READY)? 1:0;
-      p_status->uwbmac_joined    = (flags & API_STATUS_FLAG_UWBMAC_JOINED)? 1:0;
-      p_status->bh_data_ready    = (flags & API_STATUS_FLAG_BH_STATUS_CHANGED)? 1:0;
-      p_status->bh_status_changed = (flags & API_STATUS_FLAG_BH_DATA_READY)? 1:0;
-      p_status->bh_initialized   = (flags & API_STATUS_FLAG_BH_INITIALIZED)? 1:0;
-      p_status->uwb_scan_ready   = (flags & API_STATUS_FLAG_UWB_SCAN_READY)? 1:0;
-      p_status->usr_data_ready   = (flags & API_STATUS_FLAG_USR_DATA_READY)? 1:0;
-      p_status->usr_data_sent    = (flags & API_STATUS_FLAG_USR_DATA_SENT)? 1:0;
-      p_status->fwup_in_progress = (flags & API_STATUS_FLAG_FWUP_IN_PROGRESS)? 1:0;
+      if(dwm_tlv_status_decode(rx_data, rx_len, p_status) != RV_OK)
+      {
+         return RV_ERR;
+      }
+      dwm_cache_status_update(p_status);
       return RV_OK;
    }   
    return RV_ERR;
@@ -859,7 +719,7 @@ int dwm_int_cfg_get(uint16_t *p_value)
    LMH_Tx(tx_data, &tx_len);   
    if(LMH_WaitForRx(rx_data, &rx_len, 7) == RV_OK)
    {
-      *p_value = (uint16_t)rx_data[5] + (((uint16_t)rx_data[6])<<8);
+      *p_value = dwm_tlv_get(rx_data+RESP_DAT_VALUE_OFFSET, 2);
       return RV_OK;
    }   
    return RV_ERR;
@@ -916,6 +776,7 @@ int dwm_enc_key_set(dwm_enc_key_t* p_key)
    uint8_t rx_data[DWM1001_TLV_MAX_SIZE];
    uint8_t i;
    uint16_t rx_len;
+   int rv;
    tx_data[tx_len++] = DWM1001_TLV_TYPE_CMD_ENC_KEY_SET;
    tx_data[tx_len++] = DWM_ENC_KEY_LEN;
    for(i = 0; i < DWM_ENC_KEY_LEN; i++)
@@ -923,7 +784,9 @@ int dwm_enc_key_set(dwm_enc_key_t* p_key)
       tx_data[tx_len++] = p_key->byte[i];      
    }   
    LMH_Tx(tx_data, &tx_len);   
-   return LMH_WaitForRx(rx_data, &rx_len, 3);
+   rv = LMH_WaitForRx(rx_data, &rx_len, 3);
+   dwm_cache_invalidate(DWM_CACHE_MASK(DWM_CACHE_ANCHOR_LIST));
+   return rv;
 }
    
 int dwm_enc_key_clear(void)
@@ -931,10 +794,13 @@ int dwm_enc_key_clear(void)
    uint8_t tx_data[DWM1001_TLV_MAX_SIZE], tx_len = 0;
    uint8_t rx_data[DWM1001_TLV_MAX_SIZE];
    uint16_t rx_len;
+   int rv;
    tx_data[tx_len++] = DWM1001_TLV_TYPE_CMD_ENC_KEY_CLEAR;
    tx_data[tx_len++] = 0;  
    LMH_Tx(tx_data, &tx_len);      
-   return LMH_WaitForRx(rx_data, &rx_len, 3);   
+   rv = LMH_WaitForRx(rx_data, &rx_len, 3);
+   dwm_cache_invalidate(DWM_CACHE_MASK(DWM_CACHE_ANCHOR_LIST));
+   return rv;   
 }  
 
 // =======================================================================================
@@ -950,11 +816,14 @@ int dwm_uwb_preamble_code_set(dwm_uwb_preamble_code_t code)
    uint8_t tx_data[DWM1001_TLV_MAX_SIZE], tx_len = 0;
    uint8_t rx_data[DWM1001_TLV_MAX_SIZE];
    uint16_t rx_len;
+   int rv;
    tx_data[tx_len++] = DWM1001_TLV_TYPE_CMD_UWB_PREAMBLE_SET;
    tx_data[tx_len++] = 1;
    tx_data[tx_len++] = code;  
    LMH_Tx(tx_data, &tx_len);   
-   return LMH_WaitForRx(rx_data, &rx_len, 3);
+   rv = LMH_WaitForRx(rx_data, &rx_len, 3);
+   dwm_cache_invalidate(DWM_CACHE_MASK(DWM_CACHE_ANCHOR_LIST));
+   return rv;   
 }
 
 int dwm_uwb_preamble_code_get(dwm_uwb_preamble_code_t *p_code)
@@ -0,0 +1,383 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_api_async.c
+ * @brief   DWM1001 host API, asynchronous requests
+ *
+ *          The requests are taken from a fixed pool and queued in submission
+ *          order. The I/O thread runs them with the synchronous dwm_*
+ *          functions, so each request is one exchange with the module and
+ *          the callers never wait on the interface.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include "dwm_api.h"
+#include "dwm_api_async.h"
+#include "hal_log.h"
+
+typedef enum {
+   REQ_FREE = 0,
+   REQ_QUEUED,
+   REQ_DONE,
+} dwm_async_state_t;
+
+struct dwm_async_req {
+   dwm_async_state_t state;
+   int (*run)(dwm_async_req_t *req);
+   dwm_async_cb_t cb;
+   void *user;
+   int rv;
+   union {
+      struct { int (*fn)(void *arg); void *arg; } call;
+      dwm_loc_data_t *loc;
+      dwm_status_t *status;
+      struct { uint8_t *data; uint8_t *len; } usr_rd;
+      struct { uint8_t data[DWM_API_USR_DATA_LEN_MAX]; uint8_t len; bool overwrite; } usr_wr;
+      struct { dwm_gpio_idx_t idx; bool value; bool *p_value; } gpio;
+   } arg;
+};
+
+static dwm_async_req_t async_pool[DWM_ASYNC_QUEUE_LEN];
+static dwm_async_req_t *async_queue[DWM_ASYNC_QUEUE_LEN];
+static int async_head = 0;       /* next request to run */
+static int async_count = 0;      /* requests queued */
+static bool async_running = false;
+static int async_dev = 0;        /* module driven by the I/O thread */
+static pthread_t async_thread;
+static pthread_mutex_t async_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t async_queue_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t async_done_cond;
+
+/**
+ * @brief I/O thread, runs the queued requests in order
+ */
+static void *dwm_async_thread(void *arg)
+{
+   dwm_async_req_t *req;
+
+   (void)arg;
+   dwm_dev_sel(async_dev);
+   pthread_mutex_lock(&async_mutex);
+   for(;;)
+   {
+      while((async_count == 0) && async_running)
+      {
+         pthread_cond_wait(&async_queue_cond, &async_mutex);
+      }
+      if(async_count == 0)
+      {
+         break;
+      }
+      req = async_queue[async_head];
+      async_head = (async_head + 1) % DWM_ASYNC_QUEUE_LEN;
+      async_count--;
+      pthread_mutex_unlock(&async_mutex);
+
+      req->rv = req->run(req);
+      if(req->cb != NULL)
+      {
+         req->cb(req->rv, req->user);
+      }
+
+      pthread_mutex_lock(&async_mutex);
+      if(req->cb != NULL)
+      {
+         req->state = REQ_FREE;
+      }
+      else
+      {
+         req->state = REQ_DONE;
+         pthread_cond_broadcast(&async_done_cond);
+      }
+   }
+   pthread_mutex_unlock(&async_mutex);
+   return NULL;
+}
+
+/**
+ * @brief takes a free request, to be filled then given to dwm_async_queue()
+ *
+ * @return the request, NULL if none is free
+ */
+static dwm_async_req_t *dwm_async_alloc(void)
+{
+   dwm_async_req_t *req = NULL;
+   int i;
+
+   pthread_mutex_lock(&async_mutex);
+   if(async_running)
+   {
+      for(i = 0; i < DWM_ASYNC_QUEUE_LEN; i++)
+      {
+         if(async_pool[i].state == REQ_FREE)
+         {
+            req = &async_pool[i];
+            req->state = REQ_QUEUED;
+            break;
+         }
+      }
+   }
+   pthread_mutex_unlock(&async_mutex);
+   if(req == NULL)
+   {
+      HAL_LogErr("dwm: *** ERROR *** async: no request available\n");
+   }
+   return req;
+}
+
+/**
+ * @brief queues a request taken with dwm_async_alloc()
+ *
+ * @return the request
+ */
+static dwm_async_req_t *dwm_async_queue(dwm_async_req_t *req, dwm_async_cb_t cb, void *user)
+{
+   req->cb = cb;
+   req->user = user;
+   pthread_mutex_lock(&async_mutex);
+   async_queue[(async_head + async_count) % DWM_ASYNC_QUEUE_LEN] = req;
+   async_count++;
+   pthread_cond_signal(&async_queue_cond);
+   pthread_mutex_unlock(&async_mutex);
+   return req;
+}
+
+int dwm_async_init(void)
+{
+   pthread_condattr_t attr;
+   int i;
+
+   if(async_running)
+   {
+      return RV_OK;
+   }
+   for(i = 0; i < DWM_ASYNC_QUEUE_LEN; i++)
+   {
+      async_pool[i].state = REQ_FREE;
+   }
+   async_head = 0;
+   async_count = 0;
+   async_dev = dwm_dev_num();
+
+   // the waits are on the monotonic clock, as the HAL time
+   pthread_condattr_init(&attr);
+   pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+   pthread_cond_init(&async_done_cond, &attr);
+   pthread_condattr_destroy(&attr);
+
+   async_running = true;
+   if(pthread_create(&async_thread, NULL, dwm_async_thread, NULL) != 0)
+   {
+      HAL_LogErr("dwm: *** ERROR *** async: cannot start the I/O thread\n");
+      async_running = false;
+      pthread_cond_destroy(&async_done_cond);
+      return RV_ERR;
+   }
+   HAL_Log("dwm:     async: I/O thread started\n");
+   return RV_OK;
+}
+
+void dwm_async_deinit(void)
+{
+   pthread_mutex_lock(&async_mutex);
+   if(!async_running)
+   {
+      pthread_mutex_unlock(&async_mutex);
+      return;
+   }
+   async_running = false;
+   pthread_cond_signal(&async_queue_cond);
+   pthread_mutex_unlock(&async_mutex);
+
+   pthread_join(async_thread, NULL);
+   pthread_cond_destroy(&async_done_cond);
+   HAL_Log("dwm:     async: I/O thread stopped\n");
+}
+
+int dwm_async_wait(dwm_async_req_t *req, int timeout_ms, int *rv)
+{
+   struct timespec ts;
+   int ret = 0;
+
+   if((req == NULL) || (req->cb != NULL))
+   {
+      return RV_ERR;
+   }
+   if(timeout_ms >= 0)
+   {
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      ts.tv_sec += timeout_ms / 1000;
+      ts.tv_nsec += (timeout_ms % 1000) * 1000000L;
+      if(ts.tv_nsec >= 1000000000L)
+      {
+         ts.tv_sec++;
+         ts.tv_nsec -= 1000000000L;
+      }
+   }
+
+   pthread_mutex_lock(&async_mutex);
+   while((req->state != REQ_DONE) && (ret != ETIMEDOUT))
+   {
+      if(timeout_ms >= 0)
+      {
+         ret = pthread_cond_timedwait(&async_done_cond, &async_mutex, &ts);
+      }
+      else
+      {
+         pthread_cond_wait(&async_done_cond, &async_mutex);
+      }
+   }
+   if(req->state != REQ_DONE)
+   {
+      pthread_mutex_unlock(&async_mutex);
+      return RV_ERR;
+   }
+   if(rv != NULL)
+   {
+      *rv = req->rv;
+   }
+   req->state = REQ_FREE;
+   pthread_mutex_unlock(&async_mutex);
+   return RV_OK;
+}
+
+static int dwm_async_run_call(dwm_async_req_t *req)
+{
+   return req->arg.call.fn(req->arg.call.arg);
+}
+
+dwm_async_req_t *dwm_async_call(int (*fn)(void *arg), void *arg, dwm_async_cb_t cb, void *user)
+{
+   dwm_async_req_t *req = dwm_async_alloc();
+   if(req == NULL)
+   {
+      return NULL;
+   }
+   req->run = dwm_async_run_call;
+   req->arg.call.fn = fn;
+   req->arg.call.arg = arg;
+   return dwm_async_queue(req, cb, user);
+}
+
+static int dwm_async_run_loc_get(dwm_async_req_t *req)
+{
+   return dwm_loc_get(req->arg.loc);
+}
+
+dwm_async_req_t *dwm_loc_get_async(dwm_loc_data_t* loc, dwm_async_cb_t cb, void *user)
+{
+   dwm_async_req_t *req = dwm_async_alloc();
+   if(req == NULL)
+   {
+      return NULL;
+   }
+   req->run = dwm_async_run_loc_get;
+   req->arg.loc = loc;
+   return dwm_async_queue(req, cb, user);
+}
+
+static int dwm_async_run_status_get(dwm_async_req_t *req)
+{
+   return dwm_status_get(req->arg.status);
+}
+
+dwm_async_req_t *dwm_status_get_async(dwm_status_t* p_status, dwm_async_cb_t cb, void *user)
+{
+   dwm_async_req_t *req = dwm_async_alloc();
+   if(req == NULL)
+   {
+      return NULL;
+   }
+   req->run = dwm_async_run_status_get;
+   req->arg.status = p_status;
+   return dwm_async_queue(req, cb, user);
+}
+
+static int dwm_async_run_usr_data_read(dwm_async_req_t *req)
+{
+   return dwm_usr_data_read(req->arg.usr_rd.data, req->arg.usr_rd.len);
+}
+
+dwm_async_req_t *dwm_usr_data_read_async(uint8_t* p_data, uint8_t* p_len, dwm_async_cb_t cb, void *user)
+{
+   dwm_async_req_t *req = dwm_async_alloc();
+   if(req == NULL)
+   {
+      return NULL;
+   }
+   req->run = dwm_async_run_usr_data_read;
+   req->arg.usr_rd.data = p_data;
+   req->arg.usr_rd.len = p_len;
+   return dwm_async_queue(req, cb, user);
+}
+
+static int dwm_async_run_usr_data_write(dwm_async_req_t *req)
+{
+   return dwm_usr_data_write(req->arg.usr_wr.data, req->arg.usr_wr.len, req->arg.usr_wr.overwrite);
+}
+
+dwm_async_req_t *dwm_usr_data_write_async(uint8_t* p_data, uint8_t len, bool overwrite, dwm_async_cb_t cb, void *user)
+{
+   dwm_async_req_t *req;
+
+   if(len > DWM_API_USR_DATA_LEN_MAX)
+   {
+      HAL_LogErr("dwm: *** ERROR *** async: user data length %d exceeds %d\n", len, DWM_API_USR_DATA_LEN_MAX);
+      return NULL;
+   }
+   req = dwm_async_alloc();
+   if(req == NULL)
+   {
+      return NULL;
+   }
+   req->run = dwm_async_run_usr_data_write;
+   memcpy(req->arg.usr_wr.data, p_data, len);
+   req->arg.usr_wr.len = len;
+   req->arg.usr_wr.overwrite = overwrite;
+   return dwm_async_queue(req, cb, user);
+}
+
+static int dwm_async_run_gpio_value_set(dwm_async_req_t *req)
+{
+   return dwm_gpio_value_set(req->arg.gpio.idx, req->arg.gpio.value);
+}
+
+dwm_async_req_t *dwm_gpio_value_set_async(dwm_gpio_idx_t idx, bool value, dwm_async_cb_t cb, void *user)
+{
+   dwm_async_req_t *req = dwm_async_alloc();
+   if(req == NULL)
+   {
+      return NULL;
+   }
+   req->run = dwm_async_run_gpio_value_set;
+   req->arg.gpio.idx = idx;
+   req->arg.gpio.value = value;
+   return dwm_async_queue(req, cb, user);
+}
+
+static int dwm_async_run_gpio_value_get(dwm_async_req_t *req)
+{
+   return dwm_gpio_value_get(req->arg.gpio.idx, req->arg.gpio.p_value);
+}
+
+dwm_async_req_t *dwm_gpio_value_get_async(dwm_gpio_idx_t idx, bool* value, dwm_async_cb_t cb, void *user)
+{
+   dwm_async_req_t *req = dwm_async_alloc();
+   if(req == NULL)
+   {
+      return NULL;
+   }
+   req->run = dwm_async_run_gpio_value_get;
+   req->arg.gpio.idx = idx;
+   req->arg.gpio.p_value = value;
+   return dwm_async_queue(req, cb, user);
+}
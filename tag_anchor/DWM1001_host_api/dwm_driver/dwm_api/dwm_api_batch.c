@@ -0,0 +1,239 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_api_batch.c
+ * @brief   DWM1001 host API, batched requests
+ *
+ *          The requests are written one after the other in tx_data and sent
+ *          with a single LMH_Tx(). The response is read at once, with the
+ *          sum of the response lengths when they are all fixed, and each
+ *          response is decoded by the TLV codec of its request.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "lmh.h"
+#include "dwm_api.h"
+#include "dwm_api_batch.h"
+#include "dwm_api_cache.h"
+#include "dwm_tlv.h"
+#include "hal_log.h"
+
+static int dwm_batch_pos_decode(const uint8_t* rsp, uint16_t len, void* out0, void* out1)
+{
+   (void)out1;
+   return dwm_tlv_pos_decode(rsp, len, out0);
+}
+
+static int dwm_batch_loc_decode(const uint8_t* rsp, uint16_t len, void* out0, void* out1)
+{
+   (void)out1;
+   return dwm_tlv_loc_decode(rsp, len, out0);
+}
+
+static int dwm_batch_node_id_decode(const uint8_t* rsp, uint16_t len, void* out0, void* out1)
+{
+   (void)out1;
+   return dwm_tlv_node_id_decode(rsp, len, out0);
+}
+
+static int dwm_batch_status_decode(const uint8_t* rsp, uint16_t len, void* out0, void* out1)
+{
+   (void)out1;
+   if(dwm_tlv_status_decode(rsp, len, out0) != RV_OK)
+   {
+      return RV_ERR;
+   }
+   dwm_cache_status_update(out0);
+   return RV_OK;
+}
+
+static int dwm_batch_usr_data_decode(const uint8_t* rsp, uint16_t len, void* out0, void* out1)
+{
+   return dwm_tlv_usr_data_decode(rsp, len, out0, out1);
+}
+
+static int dwm_batch_ret_val_decode(const uint8_t* rsp, uint16_t len, void* out0, void* out1)
+{
+   (void)rsp;
+   (void)out0;
+   (void)out1;
+   return (len >= DWM_TLV_RET_VAL_LEN) ? RV_OK : RV_ERR;
+}
+
+/**
+ * @brief appends a request to a batch
+ *
+ * @param[in] type, command TLV type
+ * @param[in] val, val_len, value of the request, NULL and 0 if none
+ * @param[in] exp_len, response length, DWM1001_TLV_MAX_SIZE if variable
+ *
+ * @return Error code
+ */
+static int dwm_batch_add_val(dwm_batch_t* batch, uint8_t type, const uint8_t* val, uint8_t val_len, uint16_t exp_len, 
+   dwm_batch_decode_t decode, void* out0, void* out1)
+{
+   dwm_batch_entry_t *e;
+
+   if((batch->cnt >= DWM_BATCH_CNT_MAX) || (batch->tx_len + DWM_TLV_HDR_LEN + val_len > DWM1001_TLV_MAX_SIZE))
+   {
+      HAL_LogErr("dwm: *** ERROR *** batch: full, %d requests\n", batch->cnt);
+      return RV_ERR;
+   }
+   e = &batch->entry[batch->cnt++];
+   e->decode = decode;
+   e->out[0] = out0;
+   e->out[1] = out1;
+   e->tx_offset = batch->tx_len;
+   e->tx_len = DWM_TLV_HDR_LEN + val_len;
+   e->exp_len = exp_len;
+   e->rv = RV_ERR;
+   batch->tx_data[batch->tx_len++] = type;
+   batch->tx_data[batch->tx_len++] = val_len;
+   if(val_len > 0)
+   {
+      memcpy(batch->tx_data + batch->tx_len, val, val_len);
+      batch->tx_len += val_len;
+   }
+   return RV_OK;
+}
+
+static int dwm_batch_add(dwm_batch_t* batch, uint8_t type, uint16_t exp_len, dwm_batch_decode_t decode, void* out0, void* out1)
+{
+   return dwm_batch_add_val(batch, type, NULL, 0, exp_len, decode, out0, out1);
+}
+
+void dwm_batch_init(dwm_batch_t* batch)
+{
+   batch->tx_len = 0;
+   batch->cnt = 0;
+}
+
+int dwm_batch_pos_get(dwm_batch_t* batch, dwm_pos_t* p_pos)
+{
+   return dwm_batch_add(batch, DWM1001_TLV_TYPE_CMD_POS_GET, 18, dwm_batch_pos_decode, p_pos, NULL);
+}
+
+int dwm_batch_loc_get(dwm_batch_t* batch, dwm_loc_data_t* loc)
+{
+   return dwm_batch_add(batch, DWM1001_TLV_TYPE_CMD_LOC_GET, DWM1001_TLV_MAX_SIZE, dwm_batch_loc_decode, loc, NULL);
+}
+
+int dwm_batch_node_id_get(dwm_batch_t* batch, uint64_t* p_node_id)
+{
+   return dwm_batch_add(batch, DWM1001_TLV_TYPE_CMD_NODE_ID_GET, 13, dwm_batch_node_id_decode, p_node_id, NULL);
+}
+
+int dwm_batch_status_get(dwm_batch_t* batch, dwm_status_t* p_status)
+{
+   return dwm_batch_add(batch, DWM1001_TLV_TYPE_CMD_STATUS_GET, 7, dwm_batch_status_decode, p_status, NULL);
+}
+
+int dwm_batch_usr_data_read(dwm_batch_t* batch, uint8_t* p_data, uint8_t* p_len)
+{
+   return dwm_batch_add(batch, DWM1001_TLV_TYPE_CMD_USR_DATA_READ, DWM1001_TLV_MAX_SIZE, dwm_batch_usr_data_decode, p_data, p_len);
+}
+
+int dwm_batch_usr_data_write(dwm_batch_t* batch, const uint8_t* p_data, uint8_t len, bool overwrite)
+{
+   uint8_t val[DWM_API_USR_DATA_LEN_MAX + 1];
+
+   if(len > DWM_API_USR_DATA_LEN_MAX)
+   {
+      return RV_ERR;
+   }
+   val[0] = overwrite;
+   memcpy(val + 1, p_data, len);
+   return dwm_batch_add_val(batch, DWM1001_TLV_TYPE_CMD_USR_DATA_WRITE, val, len + 1, DWM_TLV_RET_VAL_LEN, 
+      dwm_batch_ret_val_decode, NULL, NULL);
+}
+
+int dwm_batch_run(dwm_batch_t* batch)
+{
+   uint8_t rx_data[DWM1001_TLV_MAX_SIZE];
+   bool done[DWM_BATCH_CNT_MAX];
+   uint16_t rx_len = 0, exp_len = 0, offset = 0, len;
+   uint8_t tx_len, i;
+   dwm_batch_entry_t *e;
+   int ret = RV_OK;
+
+   if(batch->cnt == 0)
+   {
+      return RV_OK;
+   }
+   for(i = 0; i < batch->cnt; i++)
+   {
+      batch->entry[i].rv = RV_ERR;
+      done[i] = false;
+      exp_len += batch->entry[i].exp_len;
+   }
+   if(exp_len > DWM1001_TLV_MAX_SIZE)
+   {
+      exp_len = DWM1001_TLV_MAX_SIZE;
+   }
+
+   // all the requests in one transfer, then split the responses
+   tx_len = batch->tx_len;
+   LMH_Tx(batch->tx_data, &tx_len);
+   if(LMH_WaitForRx(rx_data, &rx_len, exp_len) == RV_OK)
+   {
+      for(i = 0; i < batch->cnt; i++)
+      {
+         e = &batch->entry[i];
+         len = dwm_tlv_rsp_len(rx_data+offset, rx_len-offset);
+         if(len == 0)
+         {
+            break;
+         }
+         if(LMH_CheckRetVal(rx_data+offset) != LMH_OK)
+         {
+            done[i] = true;   // answered with an error, not sent again
+         }
+         else if((e->rv = e->decode(rx_data+offset, len, e->out[0], e->out[1])) == RV_OK)
+         {
+            done[i] = true;
+         }
+         offset += len;
+      }
+   }
+
+   // the requests not answered are sent alone
+   for(i = 0; i < batch->cnt; i++)
+   {
+      if(done[i])
+      {
+         continue;
+      }
+      e = &batch->entry[i];
+      HAL_LogDbg("dwm:     batch: request %d of %d sent alone\n", i, batch->cnt);
+      tx_len = e->tx_len;
+      LMH_Tx(batch->tx_data+e->tx_offset, &tx_len);
+      if(LMH_WaitForRx(rx_data, &rx_len, e->exp_len) == RV_OK)
+      {
+         e->rv = e->decode(rx_data, rx_len, e->out[0], e->out[1]);
+      }
+   }
+
+   for(i = 0; i < batch->cnt; i++)
+   {
+      if(batch->entry[i].rv != RV_OK)
+      {
+         ret = RV_ERR;
+      }
+   }
+   return ret;
+}
+
+int dwm_batch_rv(const dwm_batch_t* batch, uint8_t idx)
+{
+   if(idx >= batch->cnt)
+   {
+      return RV_ERR;
+   }
+   return batch->entry[idx].rv;
+}
@@ -0,0 +1,218 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_api_cache.c
+ * @brief   DWM1001 host API, cache of the slowly changing module values
+ *
+ *          Each device has a generation, incremented by every invalidation.
+ *          A value is read from the module without the lock held and is
+ *          stored only if the generation did not change meanwhile.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+#include "dwm_api.h"
+#include "dwm_api_cache.h"
+#include "hal.h"
+
+typedef struct {
+   uint32_t valid;                     /* DWM_CACHE_MASK() of the values */
+   uint32_t gen;
+   uint64_t ts[DWM_CACHE_NUM];         /* HAL_GetTime64() of the reads */
+   bool joined;
+   bool joined_known;
+   dwm_anchor_list_t anchor_list;
+   dwm_cfg_t cfg;
+   uint64_t node_id;
+   dwm_ver_t ver;
+} dwm_cache_dev_t;
+
+typedef struct {
+   size_t offset;
+   size_t size;
+   int (*read)(void* out);
+} dwm_cache_item_t;
+
+static int dwm_cache_anchor_list_read(void* out)
+{
+   return dwm_anchor_list_get(out);
+}
+
+static int dwm_cache_cfg_read(void* out)
+{
+   return dwm_cfg_get(out);
+}
+
+static int dwm_cache_node_id_read(void* out)
+{
+   return dwm_node_id_get(out);
+}
+
+static int dwm_cache_ver_read(void* out)
+{
+   return dwm_ver_get(out);
+}
+
+static const dwm_cache_item_t dwm_cache_item[DWM_CACHE_NUM] = {
+   [DWM_CACHE_ANCHOR_LIST] = {offsetof(dwm_cache_dev_t, anchor_list), sizeof(dwm_anchor_list_t), dwm_cache_anchor_list_read},
+   [DWM_CACHE_CFG]         = {offsetof(dwm_cache_dev_t, cfg), sizeof(dwm_cfg_t), dwm_cache_cfg_read},
+   [DWM_CACHE_NODE_ID]     = {offsetof(dwm_cache_dev_t, node_id), sizeof(uint64_t), dwm_cache_node_id_read},
+   [DWM_CACHE_VER]         = {offsetof(dwm_cache_dev_t, ver), sizeof(dwm_ver_t), dwm_cache_ver_read},
+};
+
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static dwm_cache_dev_t cache_dev[DWM_CACHE_DEV_NUM];
+static int cache_ttl[DWM_CACHE_NUM] = {
+   DWM_CACHE_TTL_ANCHOR_LIST, DWM_CACHE_TTL_CFG, DWM_CACHE_TTL_NODE_ID, DWM_CACHE_TTL_VER
+};
+static uint32_t cache_hit = 0;
+static uint32_t cache_miss = 0;
+
+static dwm_cache_dev_t* dwm_cache_dev(void)
+{
+   int dev = dwm_dev_num();
+   return ((dev < 0) || (dev >= DWM_CACHE_DEV_NUM)) ? NULL : &cache_dev[dev];
+}
+
+/**
+ * @brief serves a value from memory if it is valid and fresh, else reads it
+ */
+static int dwm_cache_get(int item, void* out)
+{
+   const dwm_cache_item_t* it = &dwm_cache_item[item];
+   dwm_cache_dev_t* d = dwm_cache_dev();
+   uint64_t now = HAL_GetTime64();
+   uint32_t gen;
+   int rv;
+
+   if(d == NULL)
+   {
+      return it->read(out);
+   }
+   pthread_mutex_lock(&cache_mutex);
+   if((d->valid & DWM_CACHE_MASK(item)) && (cache_ttl[item] >= 0)
+      && ((cache_ttl[item] == 0) || (now - d->ts[item] < (uint64_t)cache_ttl[item]*1000)))
+   {
+      memcpy(out, (uint8_t*)d + it->offset, it->size);
+      cache_hit++;
+      pthread_mutex_unlock(&cache_mutex);
+      return RV_OK;
+   }
+   cache_miss++;
+   gen = d->gen;
+   pthread_mutex_unlock(&cache_mutex);
+
+   rv = it->read(out);
+   if((rv != RV_OK) || (cache_ttl[item] < 0))
+   {
+      return rv;
+   }
+
+   pthread_mutex_lock(&cache_mutex);
+   if(d->gen == gen)
+   {
+      memcpy((uint8_t*)d + it->offset, out, it->size);
+      d->ts[item] = now;
+      d->valid |= DWM_CACHE_MASK(item);
+   }
+   pthread_mutex_unlock(&cache_mutex);
+   return rv;
+}
+
+int dwm_cache_anchor_list_get(dwm_anchor_list_t* p_list)
+{
+   return dwm_cache_get(DWM_CACHE_ANCHOR_LIST, p_list);
+}
+
+int dwm_cache_cfg_get(dwm_cfg_t* cfg)
+{
+   return dwm_cache_get(DWM_CACHE_CFG, cfg);
+}
+
+int dwm_cache_node_id_get(uint64_t* p_node_id)
+{
+   return dwm_cache_get(DWM_CACHE_NODE_ID, p_node_id);
+}
+
+int dwm_cache_ver_get(dwm_ver_t* ver)
+{
+   return dwm_cache_get(DWM_CACHE_VER, ver);
+}
+
+int dwm_cache_ttl_set(int item, int ttl_ms)
+{
+   if((item < 0) || (item >= DWM_CACHE_NUM) || (ttl_ms < -1))
+   {
+      return RV_ERR;
+   }
+   pthread_mutex_lock(&cache_mutex);
+   cache_ttl[item] = ttl_ms;
+   pthread_mutex_unlock(&cache_mutex);
+   return RV_OK;
+}
+
+void dwm_cache_invalidate(uint32_t mask)
+{
+   dwm_cache_dev_t* d = dwm_cache_dev();
+   if(d == NULL)
+   {
+      return;
+   }
+   pthread_mutex_lock(&cache_mutex);
+   d->valid &= ~mask;
+   d->gen++;
+   pthread_mutex_unlock(&cache_mutex);
+}
+
+void dwm_cache_status_update(const dwm_status_t* p_status)
+{
+   dwm_cache_dev_t* d = dwm_cache_dev();
+   uint32_t mask = 0;
+
+   if(d == NULL)
+   {
+      return;
+   }
+   pthread_mutex_lock(&cache_mutex);
+   if(d->joined_known && (d->joined != p_status->uwbmac_joined))
+   {
+      mask |= DWM_CACHE_MASK(DWM_CACHE_ANCHOR_LIST) | DWM_CACHE_MASK(DWM_CACHE_CFG);
+   }
+   d->joined = p_status->uwbmac_joined;
+   d->joined_known = true;
+   if(p_status->bh_data_ready || p_status->bh_status_changed)
+   {
+      mask |= DWM_CACHE_MASK(DWM_CACHE_ANCHOR_LIST);
+   }
+   if(p_status->fwup_in_progress)
+   {
+      mask |= DWM_CACHE_ALL;
+   }
+   if(mask != 0)
+   {
+      d->valid &= ~mask;
+      d->gen++;
+   }
+   pthread_mutex_unlock(&cache_mutex);
+}
+
+void dwm_cache_stats_get(uint32_t* hit, uint32_t* miss)
+{
+   pthread_mutex_lock(&cache_mutex);
+   if(hit != NULL)
+   {
+      *hit = cache_hit;
+   }
+   if(miss != NULL)
+   {
+      *miss = cache_miss;
+   }
+   pthread_mutex_unlock(&cache_mutex);
+}
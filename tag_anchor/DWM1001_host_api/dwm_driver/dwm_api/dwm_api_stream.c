@@ -0,0 +1,285 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_api_stream.c
+ * @brief   DWM1001 host API, location streaming
+ *
+ *          The interrupt callback only records the time of the edge and wakes
+ *          the stream thread, which reads the status and the location in one
+ *          batch. The location is pushed only if the status reports new
+ *          location data, so no empty location is read. Without an edge for
+ *          DWM_STREAM_POLL_MS the status is checked anyway.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include "lmh.h"
+#include "dwm_api.h"
+#include "dwm_api_batch.h"
+#include "dwm_api_stream.h"
+#include "hal.h"
+#include "hal_log.h"
+
+static dwm_stream_rec_t stream_ring[DWM_STREAM_RING_LEN];
+static int stream_head = 0;         /* oldest record */
+static int stream_count = 0;        /* records in the ring */
+static uint32_t stream_seq = 0;
+static uint32_t stream_dropped = 0;
+static bool stream_running = false;
+static bool stream_int = false;     /* an edge is waiting to be handled */
+static bool stream_io = false;      /* the stream thread is in a transfer */
+static uint64_t stream_int_ts = 0;
+static uint16_t stream_int_cfg = 0; /* interrupt configuration before the stream */
+static int stream_dev = 0;          /* module driven by the stream thread */
+static pthread_t stream_thread;
+static pthread_mutex_t stream_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stream_int_cond;
+static pthread_cond_t stream_rec_cond;
+
+/**
+ * @brief absolute time on the monotonic clock, ms from now
+ */
+static void dwm_stream_deadline(struct timespec *ts, int ms)
+{
+   clock_gettime(CLOCK_MONOTONIC, ts);
+   ts->tv_sec += ms / 1000;
+   ts->tv_nsec += (ms % 1000) * 1000000L;
+   if(ts->tv_nsec >= 1000000000L)
+   {
+      ts->tv_sec++;
+      ts->tv_nsec -= 1000000000L;
+   }
+}
+
+/**
+ * @brief rising edge of the interrupt pin, from the GPIO interrupt thread
+ */
+static void dwm_stream_int_cb(void)
+{
+   pthread_mutex_lock(&stream_mutex);
+#if (INTERFACE_NUMBER == 2) || (INTERFACE_NUMBER == 3)
+   // the pin also rises for the responses of the stream own requests
+   if(stream_io && (HAL_IF_Get(stream_dev) == HAL_IF_SPI_DRDY))
+   {
+      pthread_mutex_unlock(&stream_mutex);
+      return;
+   }
+#endif
+   if(!stream_int)
+   {
+      stream_int = true;
+      stream_int_ts = HAL_GetTime64();
+      pthread_cond_signal(&stream_int_cond);
+   }
+   pthread_mutex_unlock(&stream_mutex);
+}
+
+/**
+ * @brief pushes a location into the ring, overwriting the oldest if full,
+ *        stream_mutex held
+ */
+static void dwm_stream_push(const dwm_loc_data_t *loc, const dwm_pos_t *pos, uint64_t ts)
+{
+   dwm_stream_rec_t *rec;
+
+   if(stream_count == DWM_STREAM_RING_LEN)
+   {
+      stream_head = (stream_head + 1) % DWM_STREAM_RING_LEN;
+      stream_count--;
+      stream_dropped++;
+   }
+   rec = &stream_ring[(stream_head + stream_count) % DWM_STREAM_RING_LEN];
+   rec->ts = ts;
+   rec->seq = stream_seq++;
+   rec->pos = *pos;
+   rec->loc = *loc;
+   rec->loc.p_pos = &rec->pos;
+   stream_count++;
+   pthread_cond_broadcast(&stream_rec_cond);
+}
+
+/**
+ * @brief stream thread, reads the location on each interrupt
+ */
+static void *dwm_stream_thread(void *arg)
+{
+   struct timespec ts;
+   dwm_batch_t batch;
+   dwm_status_t status;
+   dwm_loc_data_t loc;
+   dwm_pos_t pos;
+   uint64_t int_ts;
+
+   (void)arg;
+   dwm_dev_sel(stream_dev);
+   loc.p_pos = &pos;
+   dwm_batch_init(&batch);
+   dwm_batch_status_get(&batch, &status);
+   dwm_batch_loc_get(&batch, &loc);
+
+   pthread_mutex_lock(&stream_mutex);
+   // the location may be ready before the first edge
+   stream_int = true;
+   stream_int_ts = HAL_GetTime64();
+   while(stream_running)
+   {
+      if(!stream_int)
+      {
+         dwm_stream_deadline(&ts, DWM_STREAM_POLL_MS);
+         while(!stream_int && stream_running)
+         {
+            if(pthread_cond_timedwait(&stream_int_cond, &stream_mutex, &ts) == ETIMEDOUT)
+            {
+               break;
+            }
+         }
+         if(!stream_running)
+         {
+            break;
+         }
+      }
+      int_ts = stream_int ? stream_int_ts : HAL_GetTime64();
+      stream_int = false;
+      stream_io = true;
+      pthread_mutex_unlock(&stream_mutex);
+
+      dwm_batch_run(&batch);
+
+      pthread_mutex_lock(&stream_mutex);
+      stream_io = false;
+      if((dwm_batch_rv(&batch, 0) == RV_OK) && status.loc_data && (dwm_batch_rv(&batch, 1) == RV_OK))
+      {
+         dwm_stream_push(&loc, &pos, int_ts);
+      }
+   }
+   pthread_mutex_unlock(&stream_mutex);
+   return NULL;
+}
+
+int dwm_stream_init(void)
+{
+   pthread_condattr_t attr;
+
+   if(stream_running)
+   {
+      return RV_OK;
+   }
+   if(dwm_int_cfg_get(&stream_int_cfg) != RV_OK)
+   {
+      HAL_LogErr("dwm: *** ERROR *** stream: cannot read the interrupt configuration\n");
+      return RV_ERR;
+   }
+   if(dwm_int_cfg_set(stream_int_cfg | DWM1001_INTR_LOC_READY) != RV_OK)
+   {
+      HAL_LogErr("dwm: *** ERROR *** stream: cannot enable the location ready interrupt\n");
+      return RV_ERR;
+   }
+   stream_dev = dwm_dev_num();
+   stream_head = 0;
+   stream_count = 0;
+   stream_seq = 0;
+   stream_dropped = 0;
+   stream_int = false;
+   stream_io = false;
+
+   // the waits are on the monotonic clock, as the HAL time
+   pthread_condattr_init(&attr);
+   pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+   pthread_cond_init(&stream_int_cond, &attr);
+   pthread_cond_init(&stream_rec_cond, &attr);
+   pthread_condattr_destroy(&attr);
+
+   LMH_SetIntCb(dwm_stream_int_cb);
+   stream_running = true;
+   if(pthread_create(&stream_thread, NULL, dwm_stream_thread, NULL) != 0)
+   {
+      HAL_LogErr("dwm: *** ERROR *** stream: cannot start the stream thread\n");
+      stream_running = false;
+      LMH_SetIntCb(NULL);
+      pthread_cond_destroy(&stream_int_cond);
+      pthread_cond_destroy(&stream_rec_cond);
+      dwm_int_cfg_set(stream_int_cfg);
+      return RV_ERR;
+   }
+   HAL_Log("dwm:     stream: started on dev%d\n", stream_dev);
+   return RV_OK;
+}
+
+void dwm_stream_deinit(void)
+{
+   int dev;
+
+   pthread_mutex_lock(&stream_mutex);
+   if(!stream_running)
+   {
+      pthread_mutex_unlock(&stream_mutex);
+      return;
+   }
+   stream_running = false;
+   pthread_cond_signal(&stream_int_cond);
+   pthread_cond_broadcast(&stream_rec_cond);
+   pthread_mutex_unlock(&stream_mutex);
+   pthread_join(stream_thread, NULL);
+
+   dev = dwm_dev_num();
+   dwm_dev_sel(stream_dev);
+   LMH_SetIntCb(NULL);
+   dwm_int_cfg_set(stream_int_cfg);
+   dwm_dev_sel(dev);
+
+   pthread_cond_destroy(&stream_int_cond);
+   pthread_cond_destroy(&stream_rec_cond);
+   HAL_Log("dwm:     stream: stopped, %u locations dropped\n", stream_dropped);
+}
+
+int dwm_stream_read(dwm_stream_rec_t* rec, int timeout_ms)
+{
+   struct timespec ts;
+   int ret = 0;
+
+   if(timeout_ms > 0)
+   {
+      dwm_stream_deadline(&ts, timeout_ms);
+   }
+   pthread_mutex_lock(&stream_mutex);
+   while((stream_count == 0) && stream_running && (timeout_ms != 0) && (ret != ETIMEDOUT))
+   {
+      if(timeout_ms > 0)
+      {
+         ret = pthread_cond_timedwait(&stream_rec_cond, &stream_mutex, &ts);
+      }
+      else
+      {
+         pthread_cond_wait(&stream_rec_cond, &stream_mutex);
+      }
+   }
+   if(stream_count == 0)
+   {
+      pthread_mutex_unlock(&stream_mutex);
+      return RV_ERR;
+   }
+   *rec = stream_ring[stream_head];
+   rec->loc.p_pos = &rec->pos;
+   stream_head = (stream_head + 1) % DWM_STREAM_RING_LEN;
+   stream_count--;
+   pthread_mutex_unlock(&stream_mutex);
+   return RV_OK;
+}
+
+uint32_t dwm_stream_dropped(void)
+{
+   uint32_t dropped;
+
+   pthread_mutex_lock(&stream_mutex);
+   dropped = stream_dropped;
+   pthread_mutex_unlock(&stream_mutex);
+   return dropped;
+}
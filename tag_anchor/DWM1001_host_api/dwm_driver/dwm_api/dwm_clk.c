@@ -0,0 +1,277 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_clk.c
+ * @brief   DWM1001 host API, anchor clock synchronisation for TDoA
+ *
+ *          The filter state is kept relative to the last update: the offset
+ *          is split into an integer part set at the first blink and a double
+ *          residual, and the prediction only uses the tick difference to the
+ *          last update, so the precision does not degrade as the unwrapped
+ *          counters grow.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include "dwm_api.h"
+#include "dwm_clk.h"
+
+#define DWM_CLK_TS_MASK          ((1ULL << DWM_CLK_TS_BITS) - 1)
+#define DWM_CLK_DRIFT_P0         1e-10          /* initial drift variance, 10 ppm rms */
+
+/**
+ * @brief propagation time between two positions, in ticks
+ */
+static double dwm_clk_dist_ticks(const dwm_pos_t* a, const dwm_pos_t* b)
+{
+   double dx = a->x - b->x, dy = a->y - b->y, dz = a->z - b->z;
+   return sqrt(dx*dx + dy*dy + dz*dz) / 1000 / DWM_CLK_SPEED_OF_LIGHT * DWM_CLK_TICK_HZ;
+}
+
+/**
+ * @brief unwraps a 40 bit timestamp of an anchor, a timestamp slightly
+ *        older than the last one is unwrapped backwards
+ */
+static uint64_t dwm_clk_unwrap(dwm_clk_anchor_t* an, uint64_t ts)
+{
+   int64_t delta;
+   uint64_t u;
+
+   ts &= DWM_CLK_TS_MASK;
+   if(!an->ts_seen)
+   {
+      an->ts_seen = true;
+      an->ts_last = ts;
+      return ts;
+   }
+   delta = (int64_t)((ts - an->ts_last) & DWM_CLK_TS_MASK);
+   if(delta >= (int64_t)(1ULL << (DWM_CLK_TS_BITS - 1)))
+   {
+      delta -= (int64_t)(1ULL << DWM_CLK_TS_BITS);
+   }
+   u = an->ts_last + delta;
+   if(delta > 0)
+   {
+      an->ts_last = u;
+   }
+   return u;
+}
+
+/**
+ * @brief Kalman update of an anchor with a reference blink
+ *
+ * @param[in] x, anchor RX time of the blink, unwrapped
+ * @param[in] y, master RX time of the blink, unwrapped
+ */
+static int dwm_clk_update(dwm_clk_t* clk, dwm_clk_anchor_t* an, uint64_t x, uint64_t y)
+{
+   const dwm_clk_anchor_t *m = &clk->an[clk->master];
+   double dt, dts, z, e, s, k0, k1, p00, p01, p11;
+
+   // the master time of the arrival at the anchor is y - d_m/c + d_a/c
+   if(an->upd_cnt == 0)
+   {
+      an->off0 = (int64_t)(y - x);
+      an->off = an->dist_ticks - m->dist_ticks;
+      an->drift = 0;
+      an->p[0][0] = clk->r;
+      an->p[0][1] = an->p[1][0] = 0;
+      an->p[1][1] = DWM_CLK_DRIFT_P0;
+      an->ts_upd = x;
+      an->upd_cnt = 1;
+      an->rej_cnt = 0;
+      return RV_OK;
+   }
+   dt = (double)(int64_t)(x - an->ts_upd);
+   if(dt < 0)
+   {
+      return RV_ERR;   // older than the last update
+   }
+
+   // predict
+   p00 = an->p[0][0] + 2*dt*an->p[0][1] + dt*dt*an->p[1][1];
+   p01 = an->p[0][1] + dt*an->p[1][1];
+   p11 = an->p[1][1];
+   dts = dt / DWM_CLK_TICK_HZ;
+   p00 += clk->q_off * dts;
+   p11 += clk->q_drift * dts;
+   an->off += an->drift * dt;
+   an->ts_upd = x;
+
+   // update
+   z = (double)((int64_t)(y - x) - an->off0) + an->dist_ticks - m->dist_ticks;
+   e = z - an->off;
+   s = p00 + clk->r;
+   if((clk->gate > 0) && (an->upd_cnt >= DWM_CLK_SYNC_MIN) && (e*e > clk->gate*clk->gate*s))
+   {
+      an->p[0][0] = p00;
+      an->p[0][1] = an->p[1][0] = p01;
+      an->p[1][1] = p11;
+      // a clock reset is rejected as well, the model restarts after a whole window
+      if(++an->rej_cnt >= DWM_CLK_SEQ_WIN)
+      {
+         an->upd_cnt = 0;
+      }
+      return RV_ERR;
+   }
+   k0 = p00 / s;
+   k1 = p01 / s;
+   an->off += k0 * e;
+   an->drift += k1 * e;
+   an->p[0][0] = (1 - k0) * p00;
+   an->p[0][1] = an->p[1][0] = (1 - k0) * p01;
+   an->p[1][1] = p11 - k1 * p01;
+   an->upd_cnt++;
+   an->rej_cnt = 0;
+   return RV_OK;
+}
+
+void dwm_clk_init(dwm_clk_t* clk, const dwm_pos_t* ref_pos)
+{
+   memset(clk, 0, sizeof(dwm_clk_t));
+   clk->master = -1;
+   clk->ref_pos = *ref_pos;
+   dwm_clk_noise_set(clk, DWM_CLK_Q_OFFSET, DWM_CLK_Q_DRIFT, DWM_CLK_R, DWM_CLK_GATE);
+}
+
+void dwm_clk_noise_set(dwm_clk_t* clk, double q_off, double q_drift, double r, double gate)
+{
+   clk->q_off = q_off;
+   clk->q_drift = q_drift;
+   clk->r = r;
+   clk->gate = gate;
+}
+
+int dwm_clk_anchor_set(dwm_clk_t* clk, int idx, const dwm_pos_t* pos)
+{
+   dwm_clk_anchor_t *an;
+
+   if((idx < 0) || (idx >= DWM_CLK_ANCHOR_CNT_MAX))
+   {
+      return RV_ERR;
+   }
+   an = &clk->an[idx];
+   memset(an, 0, sizeof(dwm_clk_anchor_t));
+   an->used = true;
+   an->pos = *pos;
+   an->dist_ticks = dwm_clk_dist_ticks(pos, &clk->ref_pos);
+   if(clk->master < 0)
+   {
+      clk->master = idx;
+   }
+   return RV_OK;
+}
+
+int dwm_clk_ref_rx(dwm_clk_t* clk, int idx, uint32_t seq, uint64_t ts)
+{
+   dwm_clk_anchor_t *an, *m, *a;
+   uint64_t u;
+   uint8_t i;
+   int j;
+
+   if((idx < 0) || (idx >= DWM_CLK_ANCHOR_CNT_MAX) || !clk->an[idx].used)
+   {
+      return RV_ERR;
+   }
+   an = &clk->an[idx];
+   m = &clk->an[clk->master];
+   u = dwm_clk_unwrap(an, ts);
+
+   if(idx == clk->master)
+   {
+      // the anchors which received the blink first
+      for(j = 0; j < DWM_CLK_ANCHOR_CNT_MAX; j++)
+      {
+         a = &clk->an[j];
+         if(!a->used || (j == clk->master))
+         {
+            continue;
+         }
+         for(i = 0; i < a->ref_cnt; i++)
+         {
+            if(a->ref_seq[i] == seq)
+            {
+               dwm_clk_update(clk, a, a->ref_ts[i], u);
+               a->ref_seq[i] = a->ref_seq[--a->ref_cnt];
+               a->ref_ts[i] = a->ref_ts[a->ref_cnt];
+               break;
+            }
+         }
+      }
+   }
+   else
+   {
+      for(i = 0; i < m->ref_cnt; i++)
+      {
+         if(m->ref_seq[i] == seq)
+         {
+            return dwm_clk_update(clk, an, u, m->ref_ts[i]);
+         }
+      }
+   }
+
+   // kept until the master, or the anchors, receive the blink; the oldest is replaced
+   if(an->ref_cnt < DWM_CLK_SEQ_WIN)
+   {
+      i = an->ref_cnt++;
+   }
+   else
+   {
+      i = an->ref_next;
+      an->ref_next = (an->ref_next + 1) % DWM_CLK_SEQ_WIN;
+   }
+   an->ref_seq[i] = seq;
+   an->ref_ts[i] = u;
+   return RV_OK;
+}
+
+int dwm_clk_correct(dwm_clk_t* clk, int idx, uint64_t ts, uint64_t* master_ts)
+{
+   dwm_clk_anchor_t *an;
+   uint64_t u;
+   double dt;
+
+   if((idx < 0) || (idx >= DWM_CLK_ANCHOR_CNT_MAX) || !clk->an[idx].used)
+   {
+      return RV_ERR;
+   }
+   an = &clk->an[idx];
+   u = dwm_clk_unwrap(an, ts);
+   if(idx == clk->master)
+   {
+      *master_ts = u;
+      return RV_OK;
+   }
+   if(an->upd_cnt == 0)
+   {
+      *master_ts = u;
+      return RV_ERR;
+   }
+   dt = (double)(int64_t)(u - an->ts_upd);
+   *master_ts = u + an->off0 + (int64_t)llround(an->off + an->drift * dt);
+   if((an->upd_cnt < DWM_CLK_SYNC_MIN) || (fabs(dt) > DWM_CLK_STALE_S * DWM_CLK_TICK_HZ))
+   {
+      return RV_ERR;
+   }
+   return RV_OK;
+}
+
+int dwm_clk_get(const dwm_clk_t* clk, int idx, double* drift_ppb, double* sigma_ticks)
+{
+   const dwm_clk_anchor_t *an;
+
+   if((idx < 0) || (idx >= DWM_CLK_ANCHOR_CNT_MAX) || !clk->an[idx].used)
+   {
+      return RV_ERR;
+   }
+   an = &clk->an[idx];
+   *drift_ppb = an->drift * 1e9;
+   *sigma_ticks = sqrt(an->p[0][0]);
+   return (an->upd_cnt >= DWM_CLK_SYNC_MIN) ? RV_OK : RV_ERR;
+}
@@ -0,0 +1,303 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_frag.c
+ * @brief   DWM1001 host API, message stream over the user data of the
+ *          backhaul header
+ *
+ *          The TX fragments are kept in slots indexed by their sequence
+ *          number, from base, the oldest not acknowledged, to tail. next is
+ *          the next one to write and sent the first one never written, next
+ *          goes back to base on a retransmission timeout.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "dwm_api.h"
+#include "dwm_api_batch.h"
+#include "dwm_frag.h"
+#include "hal.h"
+
+#define FRAG_SLOT(seq)     ((seq) & (DWM_FRAG_SLOT_NUM - 1))
+
+void dwm_frag_cfg_default(dwm_frag_cfg_t* cfg)
+{
+   cfg->window = 8;
+   cfg->rto_ms = 500;
+   cfg->ack_every = 4;
+   cfg->ack_delay_ms = 100;
+   cfg->batch = true;
+}
+
+int dwm_frag_init(dwm_frag_t* f, const dwm_frag_cfg_t* cfg, dwm_frag_cb_t cb, void* arg)
+{
+   memset(f, 0, sizeof(*f));
+   if(cfg == NULL)
+   {
+      dwm_frag_cfg_default(&f->cfg);
+   }
+   else
+   {
+      f->cfg = *cfg;
+   }
+   if((f->cfg.window < 1) || (f->cfg.window > DWM_FRAG_WINDOW_MAX) || (f->cfg.rto_ms == 0) || (f->cfg.ack_every < 1))
+   {
+      return RV_ERR;
+   }
+   f->cb = cb;
+   f->arg = arg;
+   return RV_OK;
+}
+
+int dwm_frag_pending(const dwm_frag_t* f)
+{
+   return (uint8_t)(f->tail - f->base);
+}
+
+int dwm_frag_send(dwm_frag_t* f, const uint8_t* msg, uint16_t len)
+{
+   int cnt = (len + DWM_FRAG_PAYLOAD_MAX - 1)/DWM_FRAG_PAYLOAD_MAX, i, n;
+   uint8_t* p;
+
+   if(len > DWM_FRAG_MSG_MAX)
+   {
+      return RV_ERR_PARAM;
+   }
+   if(cnt == 0)
+   {
+      cnt = 1;    // an empty message is one empty fragment
+   }
+   if(dwm_frag_pending(f) + cnt > DWM_FRAG_SLOT_NUM)
+   {
+      return RV_ERR_BUSY;
+   }
+   for(i = 0; i < cnt; i++)
+   {
+      n = (len > DWM_FRAG_PAYLOAD_MAX) ? DWM_FRAG_PAYLOAD_MAX : len;
+      p = f->slot[FRAG_SLOT(f->tail)];
+      p[0] = DWM_FRAG_F_DATA | ((i == 0) ? DWM_FRAG_F_FIRST : 0) | ((i == cnt-1) ? DWM_FRAG_F_LAST : 0);
+      p[1] = f->tail;
+      p[2] = 0;
+      memcpy(p + DWM_FRAG_HDR_LEN, msg, n);
+      f->slot_len[FRAG_SLOT(f->tail)] = DWM_FRAG_HDR_LEN + n;
+      f->tail++;
+      msg += n;
+      len -= n;
+   }
+   return RV_OK;
+}
+
+/**
+ * @brief fragment or acknowledgement to write, 0 if none is due
+ */
+static uint8_t dwm_frag_tx_next(dwm_frag_t* f, uint64_t now, uint8_t* buf)
+{
+   uint8_t len;
+
+   if((f->rto_deadline != 0) && (now >= f->rto_deadline))
+   {
+      f->next = f->base;   // go back to the oldest not acknowledged
+      f->rto_deadline = now + (uint64_t)f->cfg.rto_ms*1000;
+   }
+   if(((uint8_t)(f->next - f->base) < f->cfg.window) && (f->next != f->tail))
+   {
+      len = f->slot_len[FRAG_SLOT(f->next)];
+      memcpy(buf, f->slot[FRAG_SLOT(f->next)], len);
+      buf[0] |= DWM_FRAG_F_ACK;
+      buf[2] = f->rx_next;
+      return len;
+   }
+   if((f->ack_deadline != 0) && (now >= f->ack_deadline))
+   {
+      buf[0] = DWM_FRAG_F_ACK;
+      buf[1] = 0;
+      buf[2] = f->rx_next;
+      return DWM_FRAG_HDR_LEN;
+   }
+   return 0;
+}
+
+/**
+ * @brief result of the write of dwm_frag_tx_next()
+ */
+static void dwm_frag_tx_done(dwm_frag_t* f, const uint8_t* buf, uint64_t now, bool ok)
+{
+   if(!ok)
+   {
+      f->stats.tx_busy++;
+      return;
+   }
+   if(buf[0] & DWM_FRAG_F_DATA)
+   {
+      if((uint8_t)(f->next - f->base) < (uint8_t)(f->sent - f->base))
+      {
+         f->stats.tx_retry++;
+      }
+      else
+      {
+         f->sent = f->next + 1;
+      }
+      f->next++;
+      f->stats.tx_frag++;
+      if(f->rto_deadline == 0)
+      {
+         f->rto_deadline = now + (uint64_t)f->cfg.rto_ms*1000;
+      }
+   }
+   else
+   {
+      f->stats.tx_ack++;
+   }
+   f->rx_unacked = 0;
+   f->ack_deadline = 0;
+}
+
+/**
+ * @brief acknowledgement of the fragments before ack
+ */
+static void dwm_frag_ack(dwm_frag_t* f, uint8_t ack, uint64_t now)
+{
+   uint8_t n = ack - f->base, i;
+
+   if((n == 0) || (n > (uint8_t)(f->sent - f->base)))
+   {
+      return;     // nothing new, or not a fragment written
+   }
+   for(i = 0; i < n; i++)
+   {
+      if(f->slot[FRAG_SLOT(f->base)][0] & DWM_FRAG_F_LAST)
+      {
+         f->stats.tx_msg++;
+      }
+      f->base++;
+   }
+   if((uint8_t)(f->next - f->base) > (uint8_t)(f->sent - f->base))
+   {
+      f->next = f->base;   // went back to a fragment acknowledged since
+   }
+   f->rto_deadline = (f->base != f->sent) ? now + (uint64_t)f->cfg.rto_ms*1000 : 0;
+}
+
+/**
+ * @brief takes a fragment read from the module
+ */
+static void dwm_frag_rx(dwm_frag_t* f, const uint8_t* buf, uint8_t len, uint64_t now)
+{
+   uint8_t flags = buf[0], n;
+
+   if(len < DWM_FRAG_HDR_LEN)
+   {
+      f->stats.rx_drop++;
+      return;
+   }
+   if(flags & DWM_FRAG_F_ACK)
+   {
+      dwm_frag_ack(f, buf[2], now);
+   }
+   if(!(flags & DWM_FRAG_F_DATA))
+   {
+      return;
+   }
+   if(buf[1] != f->rx_next)
+   {
+      // tells the peer at once where to go back to
+      f->stats.rx_drop++;
+      f->ack_deadline = now;
+      return;
+   }
+   f->rx_next++;
+   f->stats.rx_frag++;
+
+   n = len - DWM_FRAG_HDR_LEN;
+   if(flags & DWM_FRAG_F_FIRST)
+   {
+      if(f->msg_open)
+      {
+         f->stats.rx_msg_drop++;
+      }
+      f->msg_open = true;
+      f->msg_len = 0;
+   }
+   if(f->msg_open && (f->msg_len + n > DWM_FRAG_MSG_MAX))
+   {
+      f->msg_open = false;
+      f->stats.rx_msg_drop++;
+   }
+   if(f->msg_open)
+   {
+      memcpy(f->msg + f->msg_len, buf + DWM_FRAG_HDR_LEN, n);
+      f->msg_len += n;
+      if(flags & DWM_FRAG_F_LAST)
+      {
+         f->msg_open = false;
+         f->stats.rx_msg++;
+         if(f->cb != NULL)
+         {
+            f->cb(f->arg, f->msg, f->msg_len);
+         }
+      }
+   }
+   else if((flags & (DWM_FRAG_F_FIRST | DWM_FRAG_F_LAST)) == DWM_FRAG_F_LAST)
+   {
+      f->stats.rx_msg_drop++;
+   }
+
+   if(++f->rx_unacked >= f->cfg.ack_every)
+   {
+      f->ack_deadline = now;
+   }
+   else if(f->ack_deadline == 0)
+   {
+      f->ack_deadline = now + (uint64_t)f->cfg.ack_delay_ms*1000;
+   }
+}
+
+int dwm_frag_poll(dwm_frag_t* f)
+{
+   uint8_t rx[DWM_API_USR_DATA_LEN_MAX], rx_len = DWM_API_USR_DATA_LEN_MAX;
+   uint8_t tx[DWM_API_USR_DATA_LEN_MAX], tx_len;
+   uint64_t now = HAL_GetTime64();
+   dwm_batch_t batch;
+   int rv_rx, rv_tx = RV_OK;
+
+   // decided before the read, the acknowledgement it carries is one poll old at most
+   tx_len = dwm_frag_tx_next(f, now, tx);
+   if(f->cfg.batch)
+   {
+      dwm_batch_init(&batch);
+      dwm_batch_usr_data_read(&batch, rx, &rx_len);
+      if(tx_len > 0)
+      {
+         dwm_batch_usr_data_write(&batch, tx, tx_len, false);
+      }
+      dwm_batch_run(&batch);
+      rv_rx = dwm_batch_rv(&batch, 0);
+      if(tx_len > 0)
+      {
+         rv_tx = dwm_batch_rv(&batch, 1);
+      }
+   }
+   else
+   {
+      rv_rx = dwm_usr_data_read(rx, &rx_len);
+      if(tx_len > 0)
+      {
+         rv_tx = dwm_usr_data_write(tx, tx_len, false);
+      }
+   }
+
+   if(tx_len > 0)
+   {
+      dwm_frag_tx_done(f, tx, now, rv_tx == RV_OK);
+   }
+   if((rv_rx == RV_OK) && (rx_len > 0))
+   {
+      dwm_frag_rx(f, rx, rx_len, now);
+   }
+   return rv_rx;
+}
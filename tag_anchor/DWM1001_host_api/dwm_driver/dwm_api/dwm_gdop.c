@@ -0,0 +1,221 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_gdop.c
+ * @brief   DWM1001 host API, GDOP grid of the TDoA anchor subsets
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "dwm_api.h"
+#include "dwm_tdoa.h"
+#include "dwm_gdop.h"
+
+#define DWM_GDOP_DIST_MIN        1e-9     /* m, tag on an anchor */
+#define DWM_GDOP_CELL_MAX        (1 << 20)
+
+double dwm_gdop_eval(const dwm_tdoa_t* an, uint32_t mask, const double* p)
+{
+   double u[DWM_TDOA_DIM_MAX], s[DWM_TDOA_DIM_MAX] = {0}, m[DWM_TDOA_DIM_MAX][DWM_TDOA_DIM_MAX] = {{0}};
+   double r, det, tr;
+   int i, j, k, n = 0, dim = an->dim;
+
+   // information of the timestamp differences: sum u u' - (sum u)(sum u)'/n
+   for(i = 0; i < an->cnt; i++)
+   {
+      if(!(mask & (1U << i)))
+      {
+         continue;
+      }
+      r = 0;
+      for(j = 0; j < dim; j++)
+      {
+         u[j] = p[j] - an->a[i][j];
+         r += u[j] * u[j];
+      }
+      r = sqrt(r);
+      for(j = 0; j < dim; j++)
+      {
+         u[j] /= (r > DWM_GDOP_DIST_MIN) ? r : DWM_GDOP_DIST_MIN;
+         s[j] += u[j];
+         for(k = 0; k <= j; k++)
+         {
+            m[j][k] += u[j] * u[k];
+         }
+      }
+      n++;
+   }
+   if(n < dim + 1)
+   {
+      return INFINITY;
+   }
+   for(j = 0; j < dim; j++)
+   {
+      for(k = 0; k <= j; k++)
+      {
+         m[j][k] -= s[j] * s[k] / n;
+         m[k][j] = m[j][k];
+      }
+   }
+   // trace of the inverse, the adjugate diagonal over the determinant
+   if(dim == 2)
+   {
+      det = m[0][0] * m[1][1] - m[0][1] * m[0][1];
+      tr = m[0][0] + m[1][1];
+   }
+   else
+   {
+      det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[1][2])
+            - m[0][1] * (m[0][1] * m[2][2] - m[1][2] * m[0][2])
+            + m[0][2] * (m[0][1] * m[1][2] - m[1][1] * m[0][2]);
+      tr = (m[1][1] * m[2][2] - m[1][2] * m[1][2]) + (m[0][0] * m[2][2] - m[0][2] * m[0][2])
+            + (m[0][0] * m[1][1] - m[0][1] * m[0][1]);
+   }
+   if(!(det > 1e-12 * tr * tr))
+   {
+      return INFINITY;
+   }
+   return sqrt(tr / det);
+}
+
+int dwm_gdop_init(dwm_gdop_t* g, const dwm_tdoa_t* an, int sub_cnt, const double* lo, const double* hi, double cell)
+{
+   uint16_t *subs;
+   uint32_t mask;
+   int cols, rows, sub_num = 0, c, i, j, k;
+   double p[DWM_TDOA_DIM_MAX], v;
+   dwm_gdop_cell_t *e;
+
+   memset(g, 0, sizeof(dwm_gdop_t));
+   if((sub_cnt < an->dim + 1) || (sub_cnt > an->cnt) || !(cell > 0) || !(hi[0] > lo[0]) || !(hi[1] > lo[1]))
+   {
+      return RV_ERR;
+   }
+   cols = (int)ceil((hi[0] - lo[0]) / cell);
+   rows = (int)ceil((hi[1] - lo[1]) / cell);
+   if((double)cols * rows > DWM_GDOP_CELL_MAX)
+   {
+      return RV_ERR;
+   }
+   // the subsets of sub_cnt anchors, at most C(16, 8)
+   subs = malloc((1U << an->cnt) * sizeof(uint16_t));
+   g->cells = calloc(cols * rows, sizeof(dwm_gdop_cell_t));
+   if((subs == NULL) || (g->cells == NULL))
+   {
+      free(subs);
+      free(g->cells);
+      g->cells = NULL;
+      return RV_ERR;
+   }
+   for(mask = 0; mask < (1U << an->cnt); mask++)
+   {
+      if(__builtin_popcount(mask) == sub_cnt)
+      {
+         subs[sub_num++] = (uint16_t)mask;
+      }
+   }
+   g->x0 = lo[0];
+   g->y0 = lo[1];
+   g->cell = cell;
+   g->cols = cols;
+   g->rows = rows;
+   g->sub_cnt = sub_cnt;
+   if(an->dim > 2)
+   {
+      p[2] = lo[2];
+   }
+   for(c = 0; c < cols * rows; c++)
+   {
+      e = &g->cells[c];
+      for(k = 0; k < DWM_GDOP_RANK; k++)
+      {
+         e->gdop[k] = INFINITY;
+      }
+      p[0] = lo[0] + (c % cols + 0.5) * cell;
+      p[1] = lo[1] + (c / cols + 0.5) * cell;
+      for(i = 0; i < sub_num; i++)
+      {
+         v = dwm_gdop_eval(an, subs[i], p);
+         if(!(v < e->gdop[DWM_GDOP_RANK - 1]))
+         {
+            continue;
+         }
+         for(j = DWM_GDOP_RANK - 1; (j > 0) && (v < e->gdop[j - 1]); j--)
+         {
+            e->gdop[j] = e->gdop[j - 1];
+            e->mask[j] = e->mask[j - 1];
+         }
+         e->gdop[j] = (float)v;
+         e->mask[j] = subs[i];
+      }
+   }
+   free(subs);
+   return RV_OK;
+}
+
+void dwm_gdop_free(dwm_gdop_t* g)
+{
+   free(g->cells);
+   g->cells = NULL;
+}
+
+const dwm_gdop_cell_t* dwm_gdop_cell(const dwm_gdop_t* g, const double* p)
+{
+   int col = (int)floor((p[0] - g->x0) / g->cell), row = (int)floor((p[1] - g->y0) / g->cell);
+
+   col = (col < 0) ? 0 : ((col >= g->cols) ? g->cols - 1 : col);
+   row = (row < 0) ? 0 : ((row >= g->rows) ? g->rows - 1 : row);
+   return &g->cells[row * g->cols + col];
+}
+
+uint32_t dwm_gdop_select(const dwm_gdop_t* g, const double* p, uint32_t avail)
+{
+   const dwm_gdop_cell_t *e;
+   int k;
+
+   if(!(fabs(p[0]) < INFINITY) || !(fabs(p[1]) < INFINITY))
+   {
+      return avail;
+   }
+   e = dwm_gdop_cell(g, p);
+   for(k = 0; (k < DWM_GDOP_RANK) && (e->mask[k] != 0); k++)
+   {
+      if((e->mask[k] & avail) == e->mask[k])
+      {
+         return e->mask[k];
+      }
+   }
+   return avail;
+}
+
+int dwm_gdop_solve(const dwm_tdoa_t* an, uint32_t mask, const double* rd, const double* guess, double* p, double* rms)
+{
+   double a[DWM_TDOA_ANCHOR_CNT_MAX * DWM_TDOA_DIM_MAX], sub_rd[DWM_TDOA_ANCHOR_CNT_MAX];
+   dwm_tdoa_t sub;
+   int i, j, cnt = 0, ref = -1, dim = an->dim;
+
+   for(i = 0; i < an->cnt; i++)
+   {
+      if(!(mask & (1U << i)))
+      {
+         continue;
+      }
+      ref = (ref < 0) ? i : ref;
+      for(j = 0; j < dim; j++)
+      {
+         a[cnt*dim + j] = an->a[i][j];
+      }
+      sub_rd[cnt++] = ((i > 0) ? rd[i] : 0) - ((ref > 0) ? rd[ref] : 0);
+   }
+   if(dwm_tdoa_init(&sub, dim, cnt, a) != RV_OK)
+   {
+      return RV_ERR;
+   }
+   return dwm_tdoa_solve(&sub, sub_rd, guess, p, rms);
+}
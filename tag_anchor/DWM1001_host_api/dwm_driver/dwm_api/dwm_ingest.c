@@ -0,0 +1,469 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_ingest.c
+ * @brief   DWM1001 host API, TDoA blink ingestion
+ *
+ *          A tag keeps the extended numbers base, its oldest epoch not
+ *          resolved yet, and top, its newest epoch, with top - base below
+ *          DWM_INGEST_WIN. Epoch n is in slot n % DWM_INGEST_WIN, a slot
+ *          holding an older number is free. A resolved slot keeps its number
+ *          and its anchors until it is reused, to tell a duplicate from a
+ *          late timestamp.
+ *
+ *          The deadlines are queued in the order the epochs open, which is
+ *          the order they expire in, so dwm_ingest_poll() only looks at the
+ *          head of the queue. An entry whose epoch was resolved meanwhile is
+ *          skipped. The tag table uses open addressing on the EUI-64 and
+ *          only grows, as the one of dwm_pipe.c.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dwm_api.h"
+#include "dwm_ingest.h"
+#include "dwm_tlv.h"
+#include "dwm_trace.h"
+
+#define INGEST_HDR_LEN           3              /* SOF, LEN */
+#define INGEST_CRC_LEN           2
+#define INGEST_DUE_MAX           (DWM_INGEST_TAG_MAX * DWM_INGEST_WIN)
+#define INGEST_DROPS_LEN         8
+
+typedef struct {
+   uint32_t seq;                                /* extended */
+   uint32_t mask;
+   bool done;                                   /* emitted or dropped */
+   double first_s;
+   uint64_t ts[DWM_INGEST_ANCHOR_MAX];
+} ingest_epoch_t;
+
+typedef struct {
+   bool used;
+   uint64_t id;
+   uint32_t base, top;
+   uint16_t lost;                               /* since the last epoch emitted */
+   double last_s;                               /* last timestamp */
+   ingest_epoch_t win[DWM_INGEST_WIN];
+} ingest_tag_t;
+
+typedef struct {
+   uint16_t tag;
+   uint32_t seq;
+   double due_s;
+} ingest_due_t;
+
+typedef struct {
+   uint8_t buf[DWM_INGEST_FRAME_MAX];
+   int len;
+} ingest_stream_t;
+
+struct dwm_ingest {
+   int anchor_cnt, quorum, min_cnt;
+   double deadline_s;
+   dwm_ingest_cb_t cb;
+   void *arg;
+   ingest_tag_t tag[DWM_INGEST_TAG_MAX];
+   ingest_due_t due[INGEST_DUE_MAX];            /* ring, head is the oldest */
+   uint32_t due_head, due_cnt;
+   ingest_stream_t rx[DWM_INGEST_ANCHOR_MAX];
+   dwm_ingest_stats_t st;
+   dwm_trace_t *tr;
+};
+
+static void ingest_emit(dwm_ingest_t* ing, ingest_tag_t* tag, const ingest_epoch_t* ep, int cnt, double now_s)
+{
+   dwm_ingest_epoch_t e;
+
+   e.tag_id = tag->id;
+   e.seq = ep->seq;
+   e.mask = ep->mask;
+   e.cnt = (uint8_t)cnt;
+   e.lost = tag->lost;
+   e.first_s = ep->first_s;
+   e.emit_s = now_s;
+   memcpy(e.ts, ep->ts, sizeof(e.ts));
+   tag->lost = 0;
+
+   ing->st.epochs++;
+   ing->st.latency_sum_s += now_s - ep->first_s;
+   if(now_s - ep->first_s > ing->st.latency_max_s)
+   {
+      ing->st.latency_max_s = now_s - ep->first_s;
+   }
+   if(ing->tr != NULL)
+   {
+      dwm_trace_stamp(ing->tr, DWM_TRACE_GROUP, e.tag_id, e.seq & 0xFF, dwm_trace_now_us());
+   }
+   ing->cb(ing->arg, &e);
+}
+
+/**
+ * @brief resolves the epochs of a tag from base up to last: emitted at
+ *        their deadline if min_cnt anchors reported them, else dropped
+ */
+static void ingest_resolve(dwm_ingest_t* ing, ingest_tag_t* tag, uint32_t last, double now_s)
+{
+   ingest_epoch_t *ep;
+   uint32_t seq;
+   int cnt;
+
+   for(seq = tag->base; (int32_t)(last - seq) >= 0; seq++)
+   {
+      ep = &tag->win[seq % DWM_INGEST_WIN];
+      if((ep->seq != seq) || (ep->mask == 0))
+      {
+         // no anchor heard it
+         ep->seq = seq;
+         ep->mask = 0;
+         ep->done = true;
+         ing->st.gap++;
+         tag->lost++;
+         continue;
+      }
+      if(ep->done)
+      {
+         continue;
+      }
+      ep->done = true;
+      cnt = __builtin_popcount(ep->mask);
+      if(cnt >= ing->min_cnt)
+      {
+         ing->st.deadline++;
+         ingest_emit(ing, tag, ep, cnt, now_s);
+      }
+      else
+      {
+         ing->st.short_cnt++;
+         tag->lost++;
+      }
+   }
+   tag->base = last + 1;
+}
+
+/**
+ * @brief pops the head of the deadline queue, resolving its epoch
+ */
+static void ingest_due_pop(dwm_ingest_t* ing, double now_s)
+{
+   ingest_due_t *d = &ing->due[ing->due_head];
+   ingest_tag_t *tag = &ing->tag[d->tag];
+
+   ing->due_head = (ing->due_head + 1) % INGEST_DUE_MAX;
+   ing->due_cnt--;
+   if((int32_t)(d->seq - tag->base) >= 0)
+   {
+      ingest_resolve(ing, tag, d->seq, now_s);
+   }
+}
+
+/**
+ * @brief tag of an EUI-64, added if new, NULL if the table is full
+ */
+static ingest_tag_t* ingest_tag(dwm_ingest_t* ing, uint64_t tag_id)
+{
+   ingest_tag_t *tag;
+   int i, idx;
+
+   for(i = 0; i < DWM_INGEST_TAG_MAX; i++)
+   {
+      idx = (int)(((tag_id * 0x9E3779B97F4A7C15ULL) >> 48) + i) % DWM_INGEST_TAG_MAX;
+      tag = &ing->tag[idx];
+      if(!tag->used || (tag->id == tag_id))
+      {
+         return tag;
+      }
+   }
+   return NULL;
+}
+
+/**
+ * @brief extended number of a blink: the nearest to top, or forward after
+ *        a silence, a new tag starts at its number
+ */
+static uint32_t ingest_extend(dwm_ingest_t* ing, ingest_tag_t* tag, uint64_t tag_id, uint8_t seq, double now_s)
+{
+   uint8_t d;
+
+   if(!tag->used)
+   {
+      memset(tag, 0, sizeof(*tag));
+      tag->used = true;
+      tag->id = tag_id;
+      tag->base = seq;
+      tag->top = seq - 1;
+      return seq;
+   }
+   if(now_s - tag->last_s > DWM_INGEST_RESYNC_S)
+   {
+      // the open epochs are past their deadline, the blink can only be newer
+      ing->st.resync++;
+      d = (uint8_t)(seq - (uint8_t)tag->top);
+      return tag->top + ((d == 0) ? 256 : d);
+   }
+   return tag->top + (int8_t)(seq - (uint8_t)tag->top);
+}
+
+int dwm_ingest_init(dwm_ingest_t** ing, int anchor_cnt, int quorum, int min_cnt, double deadline_s,
+      dwm_ingest_cb_t cb, void* arg)
+{
+   dwm_ingest_t *p;
+
+   quorum = (quorum == 0) ? anchor_cnt : quorum;
+   if((anchor_cnt < 1) || (anchor_cnt > DWM_INGEST_ANCHOR_MAX) || (quorum > anchor_cnt) || (min_cnt < 1)
+         || (min_cnt > quorum) || (deadline_s < 0))
+   {
+      return RV_ERR;
+   }
+   p = calloc(1, sizeof(dwm_ingest_t));
+   if(p == NULL)
+   {
+      return RV_ERR;
+   }
+   p->anchor_cnt = anchor_cnt;
+   p->quorum = quorum;
+   p->min_cnt = min_cnt;
+   p->deadline_s = (deadline_s > 0) ? deadline_s : DWM_INGEST_DEADLINE_S;
+   p->cb = cb;
+   p->arg = arg;
+   *ing = p;
+   return RV_OK;
+}
+
+void dwm_ingest_deinit(dwm_ingest_t* ing)
+{
+   free(ing);
+}
+
+int dwm_ingest_blink(dwm_ingest_t* ing, uint64_t tag_id, uint8_t seq, int anchor, uint64_t ts, double now_s)
+{
+   ingest_tag_t *tag;
+   ingest_epoch_t *ep;
+   uint32_t e, bit;
+   int cnt;
+
+   if((anchor < 0) || (anchor >= ing->anchor_cnt))
+   {
+      return RV_ERR;
+   }
+   bit = 1U << anchor;
+   dwm_ingest_poll(ing, now_s);
+   ing->st.recs++;
+
+   tag = ingest_tag(ing, tag_id);
+   if(tag == NULL)
+   {
+      ing->st.tag_full++;
+      return RV_ERR;
+   }
+   e = ingest_extend(ing, tag, tag_id, seq, now_s);
+   tag->last_s = now_s;
+
+   if((int32_t)(e - tag->base) < 0)
+   {
+      ep = &tag->win[e % DWM_INGEST_WIN];
+      if((ep->seq == e) && (ep->mask & bit))
+      {
+         ing->st.dup++;
+      }
+      else
+      {
+         ing->st.late++;
+      }
+      return RV_ERR;
+   }
+   if((int32_t)(e - tag->top) > 0)
+   {
+      // slide the window, the epochs pushed out are resolved
+      if((int32_t)(e - tag->base) >= DWM_INGEST_WIN)
+      {
+         if((int32_t)(e - DWM_INGEST_WIN - tag->top) > 0)
+         {
+            ingest_resolve(ing, tag, tag->top, now_s);
+            ing->st.gap += e - DWM_INGEST_WIN - tag->top;
+            tag->lost += e - DWM_INGEST_WIN - tag->top;
+            tag->base = e - DWM_INGEST_WIN + 1;
+         }
+         else
+         {
+            ingest_resolve(ing, tag, e - DWM_INGEST_WIN, now_s);
+         }
+      }
+      tag->top = e;
+   }
+
+   ep = &tag->win[e % DWM_INGEST_WIN];
+   if(ep->seq != e)
+   {
+      ep->seq = e;
+      ep->mask = 0;
+      ep->done = false;
+   }
+   if(ep->mask & bit)
+   {
+      ing->st.dup++;
+      return RV_ERR;
+   }
+   if(ep->mask == 0)
+   {
+      ep->first_s = now_s;
+      if(ing->due_cnt == INGEST_DUE_MAX)
+      {
+         ingest_due_pop(ing, now_s);
+      }
+      ing->due[(ing->due_head + ing->due_cnt) % INGEST_DUE_MAX] = (ingest_due_t){ (uint16_t)(tag - ing->tag), e,
+            now_s + ing->deadline_s };
+      ing->due_cnt++;
+   }
+   ep->ts[anchor] = ts;
+   ep->mask |= bit;
+
+   cnt = __builtin_popcount(ep->mask);
+   if(cnt >= ing->quorum)
+   {
+      // the older epochs of the tag go first
+      if(e != tag->base)
+      {
+         ingest_resolve(ing, tag, e - 1, now_s);
+      }
+      ep->done = true;
+      tag->base = e + 1;
+      ing->st.quorum++;
+      ingest_emit(ing, tag, ep, cnt, now_s);
+   }
+   return RV_OK;
+}
+
+/**
+ * @brief checks a frame and gives its records, RV_ERR if it is not valid
+ */
+static int ingest_frame(dwm_ingest_t* ing, int anchor, const uint8_t* frame, int len, double now_s)
+{
+   const uint8_t *tlv = frame + INGEST_HDR_LEN, *r;
+   int tlv_len = len - INGEST_HDR_LEN - INGEST_CRC_LEN, pos, k;
+   uint64_t read_us = (ing->tr != NULL) ? dwm_trace_now_us() : 0;
+
+   if(dwm_tlv_crc16(0xFFFF, frame + 1, tlv_len + 2) != (frame[len-2] | (frame[len-1] << 8)))
+   {
+      return RV_ERR;
+   }
+   for(pos = 0; pos + 2 <= tlv_len; pos += 2 + tlv[pos+1])
+   {
+      if(pos + 2 + tlv[pos+1] > tlv_len)
+      {
+         return RV_ERR;
+      }
+   }
+   for(pos = 0; pos + 2 <= tlv_len; pos += 2 + tlv[pos+1])
+   {
+      if(tlv[pos] == DWM_INGEST_TLV_BLINKS)
+      {
+         for(k = 0; k + DWM_INGEST_REC_LEN <= tlv[pos+1]; k += DWM_INGEST_REC_LEN)
+         {
+            r = &tlv[pos + 2 + k];
+            if(ing->tr != NULL)
+            {
+               dwm_trace_stamp(ing->tr, DWM_TRACE_RX, dwm_tlv_get(r + 5, 8), r[13],
+                     dwm_trace_anchor_rx(ing->tr, anchor, dwm_tlv_get(r, 5), read_us));
+               dwm_trace_stamp(ing->tr, DWM_TRACE_READ, dwm_tlv_get(r + 5, 8), r[13], read_us);
+            }
+            dwm_ingest_blink(ing, dwm_tlv_get(r + 5, 8), r[13], anchor, dwm_tlv_get(r, 5), now_s);
+         }
+      }
+      else if((tlv[pos] == DWM_INGEST_TLV_DROPS) && (tlv[pos+1] == INGEST_DROPS_LEN))
+      {
+         ing->st.ring_drops[anchor] = (uint32_t)dwm_tlv_get(&tlv[pos+2], 4);
+      }
+   }
+   return RV_OK;
+}
+
+int dwm_ingest_rx(dwm_ingest_t* ing, int anchor, const uint8_t* data, int len, double now_s)
+{
+   ingest_stream_t *s;
+   int n, pos, flen;
+
+   if((anchor < 0) || (anchor >= ing->anchor_cnt))
+   {
+      return RV_ERR;
+   }
+   s = &ing->rx[anchor];
+   while(len > 0)
+   {
+      n = (len < DWM_INGEST_FRAME_MAX - s->len) ? len : DWM_INGEST_FRAME_MAX - s->len;
+      memcpy(s->buf + s->len, data, n);
+      s->len += n;
+      data += n;
+      len -= n;
+
+      // a full buffer always holds a whole frame or a bad header
+      for(pos = 0; ; )
+      {
+         while((pos < s->len) && (s->buf[pos] != DWM_INGEST_SOF))
+         {
+            pos++;
+         }
+         if(s->len - pos < INGEST_HDR_LEN)
+         {
+            break;
+         }
+         flen = INGEST_HDR_LEN + (s->buf[pos+1] | (s->buf[pos+2] << 8)) + INGEST_CRC_LEN;
+         if(flen <= DWM_INGEST_FRAME_MAX)
+         {
+            if(s->len - pos < flen)
+            {
+               break;
+            }
+            if(ingest_frame(ing, anchor, s->buf + pos, flen, now_s) == RV_OK)
+            {
+               pos += flen;
+               continue;
+            }
+         }
+         ing->st.crc_err++;
+         pos++;
+      }
+      memmove(s->buf, s->buf + pos, s->len - pos);
+      s->len -= pos;
+   }
+   return RV_OK;
+}
+
+void dwm_ingest_poll(dwm_ingest_t* ing, double now_s)
+{
+   while((ing->due_cnt > 0) && (ing->due[ing->due_head].due_s <= now_s))
+   {
+      ingest_due_pop(ing, now_s);
+   }
+}
+
+void dwm_ingest_flush(dwm_ingest_t* ing, double now_s)
+{
+   int i;
+
+   for(i = 0; i < DWM_INGEST_TAG_MAX; i++)
+   {
+      if(ing->tag[i].used && ((int32_t)(ing->tag[i].top - ing->tag[i].base) >= 0))
+      {
+         ingest_resolve(ing, &ing->tag[i], ing->tag[i].top, now_s);
+      }
+   }
+   ing->due_head = 0;
+   ing->due_cnt = 0;
+}
+
+void dwm_ingest_trace_set(dwm_ingest_t* ing, dwm_trace_t* tr)
+{
+   ing->tr = tr;
+}
+
+void dwm_ingest_stats(const dwm_ingest_t* ing, dwm_ingest_stats_t* stats)
+{
+   *stats = ing->st;
+}
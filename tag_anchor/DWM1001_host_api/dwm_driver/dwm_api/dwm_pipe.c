@@ -0,0 +1,498 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_pipe.c
+ * @brief   DWM1001 host API, parallel TDoA solve pipeline
+ *
+ *          Locking: the pipe mutex guards the tag table, the open epochs and
+ *          the counters, a tag mutex its epoch queue and its scheduled flag,
+ *          a deque mutex its deque. The producer takes them in this order,
+ *          a worker only one at a time. The last fix of a tag is only used
+ *          by the worker running the tag.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "dwm_api.h"
+#include "dwm_tdoa.h"
+#include "dwm_clk.h"
+#include "dwm_pipe.h"
+#include "dwm_gdop.h"
+#include "dwm_trace.h"
+
+typedef struct {
+   uint32_t seq;
+   uint32_t mask;                               /* anchors which received the blink */
+   uint64_t ts[DWM_TDOA_ANCHOR_CNT_MAX];
+} pipe_epoch_t;
+
+typedef struct {
+   bool used;
+   uint64_t id;
+   /* producer, pipe mutex */
+   bool open;
+   pipe_epoch_t cur;
+   uint32_t last_seq;
+   bool last_valid;
+   /* queue, tag mutex */
+   pthread_mutex_t m;
+   pipe_epoch_t q[DWM_PIPE_EPOCH_Q];
+   uint8_t q_head, q_cnt;
+   bool sched;                                  /* in a deque or running */
+   /* worker running the tag */
+   double fix[DWM_TDOA_DIM_MAX];
+   bool fix_valid;
+} pipe_tag_t;
+
+typedef struct {
+   pthread_mutex_t m;
+   uint16_t idx[DWM_PIPE_TAG_MAX];              /* ring of tag indexes, head is the oldest */
+   uint16_t head, cnt;
+} pipe_deque_t;
+
+typedef struct {
+   struct dwm_pipe *pipe;
+   int self;
+} pipe_worker_arg_t;
+
+struct dwm_pipe {
+   dwm_tdoa_t an;
+   const dwm_gdop_t *gdop;
+   dwm_trace_t *tr;
+   dwm_pipe_cb_t cb;
+   void *arg;
+   int worker_cnt;
+   pthread_t worker[DWM_PIPE_WORKER_MAX];
+   pipe_worker_arg_t worker_arg[DWM_PIPE_WORKER_MAX];
+   pipe_deque_t dq[DWM_PIPE_WORKER_MAX];
+   pipe_tag_t tag[DWM_PIPE_TAG_MAX];
+   pthread_mutex_t m;
+   pthread_cond_t work_cond;                    /* ready > 0 or stop */
+   pthread_cond_t idle_cond;                    /* inflight == 0 */
+   uint32_t ready;                              /* tags in the deques, not taken by a worker */
+   uint32_t inflight;                           /* epochs queued and not reported */
+   uint32_t drop_cnt;
+   bool stop;
+};
+
+/**
+ * @brief pushes a tag at the newest end, taken first by the owner
+ */
+static void pipe_dq_push_new(pipe_deque_t* dq, uint16_t idx)
+{
+   pthread_mutex_lock(&dq->m);
+   dq->idx[(dq->head + dq->cnt++) % DWM_PIPE_TAG_MAX] = idx;
+   pthread_mutex_unlock(&dq->m);
+}
+
+/**
+ * @brief pushes a tag at the oldest end, behind the other tags of the owner
+ */
+static void pipe_dq_push_old(pipe_deque_t* dq, uint16_t idx)
+{
+   pthread_mutex_lock(&dq->m);
+   dq->head = (dq->head + DWM_PIPE_TAG_MAX - 1) % DWM_PIPE_TAG_MAX;
+   dq->idx[dq->head] = idx;
+   dq->cnt++;
+   pthread_mutex_unlock(&dq->m);
+}
+
+/**
+ * @brief takes the newest tag of its own deque, or steals the oldest
+ */
+static int pipe_dq_pop(pipe_deque_t* dq, bool own)
+{
+   int idx = -1;
+
+   pthread_mutex_lock(&dq->m);
+   if(dq->cnt > 0)
+   {
+      if(own)
+      {
+         idx = dq->idx[(dq->head + --dq->cnt) % DWM_PIPE_TAG_MAX];
+      }
+      else
+      {
+         idx = dq->idx[dq->head];
+         dq->head = (dq->head + 1) % DWM_PIPE_TAG_MAX;
+         dq->cnt--;
+      }
+   }
+   pthread_mutex_unlock(&dq->m);
+   return idx;
+}
+
+/**
+ * @brief queues the open epoch of a tag, pipe mutex held
+ */
+static void pipe_submit(dwm_pipe_t* pipe, int idx)
+{
+   pipe_tag_t *tag = &pipe->tag[idx];
+   bool wake = false;
+
+   tag->open = false;
+   tag->last_seq = tag->cur.seq;
+   tag->last_valid = true;
+
+   pthread_mutex_lock(&tag->m);
+   if(tag->q_cnt == DWM_PIPE_EPOCH_Q)
+   {
+      tag->q_head = (tag->q_head + 1) % DWM_PIPE_EPOCH_Q;
+      tag->q_cnt--;
+      pipe->drop_cnt++;
+      pipe->inflight--;
+   }
+   tag->q[(tag->q_head + tag->q_cnt++) % DWM_PIPE_EPOCH_Q] = tag->cur;
+   if(!tag->sched)
+   {
+      tag->sched = wake = true;
+   }
+   pthread_mutex_unlock(&tag->m);
+
+   pipe->inflight++;
+   if(wake)
+   {
+      pipe_dq_push_new(&pipe->dq[idx % pipe->worker_cnt], idx);
+      pipe->ready++;
+      pthread_cond_signal(&pipe->work_cond);
+   }
+}
+
+/**
+ * @brief solves an epoch on the anchors which received the blink, or on
+ *        the best subset of them at the last fix with a GDOP grid
+ */
+static void pipe_solve(dwm_pipe_t* pipe, pipe_tag_t* tag, const pipe_epoch_t* e)
+{
+   double a[DWM_TDOA_ANCHOR_CNT_MAX * DWM_TDOA_DIM_MAX], rd[DWM_TDOA_ANCHOR_CNT_MAX];
+   double p[DWM_TDOA_DIM_MAX] = {0};
+   dwm_tdoa_t sub;
+   uint32_t mask = e->mask;
+   int i, j, cnt = 0, ref = -1, rv = RV_ERR, dim = pipe->an.dim;
+
+   if((pipe->gdop != NULL) && tag->fix_valid)
+   {
+      mask = dwm_gdop_select(pipe->gdop, tag->fix, mask);
+   }
+   for(i = 0; i < pipe->an.cnt; i++)
+   {
+      if(!(mask & (1U << i)))
+      {
+         continue;
+      }
+      ref = (ref < 0) ? i : ref;
+      for(j = 0; j < dim; j++)
+      {
+         a[cnt*dim + j] = pipe->an.a[i][j];
+      }
+      rd[cnt++] = (double)(int64_t)(e->ts[i] - e->ts[ref]) / DWM_CLK_TICK_HZ * DWM_CLK_SPEED_OF_LIGHT;
+   }
+   if(dwm_tdoa_init(&sub, dim, cnt, a) == RV_OK)
+   {
+      rv = dwm_tdoa_solve_warm(&sub, rd, tag->fix_valid ? tag->fix : NULL, DWM_TDOA_WARM_RMS, p, NULL, NULL);
+      if(rv == RV_OK)
+      {
+         memcpy(tag->fix, p, sizeof(double) * dim);
+         tag->fix_valid = true;
+      }
+   }
+   if(pipe->tr != NULL)
+   {
+      dwm_trace_stamp(pipe->tr, DWM_TRACE_SOLVE, tag->id, e->seq & 0xFF, dwm_trace_now_us());
+   }
+   pipe->cb(pipe->arg, tag->id, e->seq, p, rv);
+}
+
+static void* pipe_worker(void* arg)
+{
+   dwm_pipe_t *pipe = ((pipe_worker_arg_t*)arg)->pipe;
+   int i, idx, self = ((pipe_worker_arg_t*)arg)->self;
+   pipe_tag_t *tag;
+   pipe_epoch_t e;
+   bool again;
+
+   for(;;)
+   {
+      pthread_mutex_lock(&pipe->m);
+      while((pipe->ready == 0) && !pipe->stop)
+      {
+         pthread_cond_wait(&pipe->work_cond, &pipe->m);
+      }
+      if(pipe->stop)
+      {
+         pthread_mutex_unlock(&pipe->m);
+         break;
+      }
+      pipe->ready--;
+      pthread_mutex_unlock(&pipe->m);
+
+      // one tag is reserved, it is in a deque
+      idx = pipe_dq_pop(&pipe->dq[self], true);
+      for(i = 1; idx < 0; i++)
+      {
+         idx = pipe_dq_pop(&pipe->dq[(self + i) % pipe->worker_cnt], false);
+      }
+      tag = &pipe->tag[idx];
+
+      pthread_mutex_lock(&tag->m);
+      e = tag->q[tag->q_head];
+      tag->q_head = (tag->q_head + 1) % DWM_PIPE_EPOCH_Q;
+      tag->q_cnt--;
+      pthread_mutex_unlock(&tag->m);
+
+      pipe_solve(pipe, tag, &e);
+
+      pthread_mutex_lock(&tag->m);
+      again = tag->q_cnt > 0;
+      tag->sched = again;
+      pthread_mutex_unlock(&tag->m);
+      if(again)
+      {
+         pipe_dq_push_old(&pipe->dq[self], idx);
+      }
+
+      pthread_mutex_lock(&pipe->m);
+      if(again)
+      {
+         pipe->ready++;
+         pthread_cond_signal(&pipe->work_cond);
+      }
+      if(--pipe->inflight == 0)
+      {
+         pthread_cond_broadcast(&pipe->idle_cond);
+      }
+      pthread_mutex_unlock(&pipe->m);
+   }
+   return NULL;
+}
+
+int dwm_pipe_init(dwm_pipe_t** pipe, const dwm_tdoa_t* an, int worker_cnt, dwm_pipe_cb_t cb, void* arg)
+{
+   dwm_pipe_t *p;
+   int i;
+
+   if((worker_cnt < 1) || (worker_cnt > DWM_PIPE_WORKER_MAX))
+   {
+      return RV_ERR;
+   }
+   p = calloc(1, sizeof(dwm_pipe_t));
+   if(p == NULL)
+   {
+      return RV_ERR;
+   }
+   p->an = *an;
+   p->cb = cb;
+   p->arg = arg;
+   p->worker_cnt = worker_cnt;
+   pthread_mutex_init(&p->m, NULL);
+   pthread_cond_init(&p->work_cond, NULL);
+   pthread_cond_init(&p->idle_cond, NULL);
+   for(i = 0; i < DWM_PIPE_TAG_MAX; i++)
+   {
+      pthread_mutex_init(&p->tag[i].m, NULL);
+   }
+   for(i = 0; i < DWM_PIPE_WORKER_MAX; i++)
+   {
+      pthread_mutex_init(&p->dq[i].m, NULL);
+   }
+   for(i = 0; i < worker_cnt; i++)
+   {
+      p->worker_arg[i].pipe = p;
+      p->worker_arg[i].self = i;
+      if(pthread_create(&p->worker[i], NULL, pipe_worker, &p->worker_arg[i]) != 0)
+      {
+         p->worker_cnt = i;
+         dwm_pipe_deinit(p);
+         return RV_ERR;
+      }
+   }
+   *pipe = p;
+   return RV_OK;
+}
+
+void dwm_pipe_deinit(dwm_pipe_t* pipe)
+{
+   int i;
+
+   pthread_mutex_lock(&pipe->m);
+   pipe->stop = true;
+   pthread_cond_broadcast(&pipe->work_cond);
+   pthread_mutex_unlock(&pipe->m);
+   for(i = 0; i < pipe->worker_cnt; i++)
+   {
+      pthread_join(pipe->worker[i], NULL);
+   }
+   for(i = 0; i < DWM_PIPE_WORKER_MAX; i++)
+   {
+      pthread_mutex_destroy(&pipe->dq[i].m);
+   }
+   for(i = 0; i < DWM_PIPE_TAG_MAX; i++)
+   {
+      pthread_mutex_destroy(&pipe->tag[i].m);
+   }
+   pthread_cond_destroy(&pipe->idle_cond);
+   pthread_cond_destroy(&pipe->work_cond);
+   pthread_mutex_destroy(&pipe->m);
+   free(pipe);
+}
+
+/**
+ * @brief index of a tag, added if new, -1 if the table is full, pipe
+ *        mutex held
+ */
+static int pipe_tag_find(dwm_pipe_t* pipe, uint64_t tag_id)
+{
+   pipe_tag_t *tag;
+   int i, idx;
+
+   // open addressing on the tag id, the table only grows
+   for(i = 0; i < DWM_PIPE_TAG_MAX; i++)
+   {
+      idx = (int)(((tag_id * 0x9E3779B97F4A7C15ULL) >> 48) + i) % DWM_PIPE_TAG_MAX;
+      tag = &pipe->tag[idx];
+      if(!tag->used || (tag->id == tag_id))
+      {
+         if(!tag->used)
+         {
+            tag->used = true;
+            tag->id = tag_id;
+         }
+         return idx;
+      }
+   }
+   return -1;
+}
+
+int dwm_pipe_blink(dwm_pipe_t* pipe, uint64_t tag_id, uint32_t seq, int anchor, uint64_t ts)
+{
+   pipe_tag_t *tag = NULL;
+   int idx, rv = RV_OK;
+
+   if((anchor < 0) || (anchor >= pipe->an.cnt))
+   {
+      return RV_ERR;
+   }
+   pthread_mutex_lock(&pipe->m);
+   idx = pipe_tag_find(pipe, tag_id);
+   if(idx < 0)
+   {
+      rv = RV_ERR;
+   }
+   else
+   {
+      tag = &pipe->tag[idx];
+      if(tag->open && (tag->cur.seq != seq) && ((int32_t)(seq - tag->cur.seq) > 0))
+      {
+         pipe_submit(pipe, idx);
+      }
+      if(!tag->open)
+      {
+         if(tag->last_valid && ((int32_t)(seq - tag->last_seq) <= 0))
+         {
+            rv = RV_ERR;
+         }
+         else
+         {
+            tag->open = true;
+            tag->cur.seq = seq;
+            tag->cur.mask = 0;
+         }
+      }
+      if((rv == RV_OK) && (tag->cur.seq == seq))
+      {
+         tag->cur.ts[anchor] = ts;
+         tag->cur.mask |= 1U << anchor;
+         if(tag->cur.mask == (uint32_t)((1ULL << pipe->an.cnt) - 1))
+         {
+            pipe_submit(pipe, idx);
+         }
+      }
+      else
+      {
+         rv = RV_ERR;
+      }
+   }
+   pthread_mutex_unlock(&pipe->m);
+   return rv;
+}
+
+int dwm_pipe_epoch(dwm_pipe_t* pipe, uint64_t tag_id, uint32_t seq, uint32_t mask, const uint64_t* ts)
+{
+   pipe_tag_t *tag;
+   int i, idx, rv = RV_ERR;
+
+   mask &= (uint32_t)((1ULL << pipe->an.cnt) - 1);
+   pthread_mutex_lock(&pipe->m);
+   idx = pipe_tag_find(pipe, tag_id);
+   if(idx >= 0)
+   {
+      tag = &pipe->tag[idx];
+      if(tag->open && ((int32_t)(seq - tag->cur.seq) > 0))
+      {
+         pipe_submit(pipe, idx);
+      }
+      if(!tag->open && (!tag->last_valid || ((int32_t)(seq - tag->last_seq) > 0)))
+      {
+         tag->cur.seq = seq;
+         tag->cur.mask = mask;
+         for(i = 0; i < pipe->an.cnt; i++)
+         {
+            tag->cur.ts[i] = ts[i];
+         }
+         pipe_submit(pipe, idx);
+         rv = RV_OK;
+      }
+   }
+   pthread_mutex_unlock(&pipe->m);
+   return rv;
+}
+
+void dwm_pipe_flush(dwm_pipe_t* pipe)
+{
+   int i;
+
+   pthread_mutex_lock(&pipe->m);
+   for(i = 0; i < DWM_PIPE_TAG_MAX; i++)
+   {
+      if(pipe->tag[i].used && pipe->tag[i].open)
+      {
+         pipe_submit(pipe, i);
+      }
+   }
+   while(pipe->inflight > 0)
+   {
+      pthread_cond_wait(&pipe->idle_cond, &pipe->m);
+   }
+   pthread_mutex_unlock(&pipe->m);
+}
+
+void dwm_pipe_gdop_set(dwm_pipe_t* pipe, const dwm_gdop_t* gdop)
+{
+   pthread_mutex_lock(&pipe->m);
+   pipe->gdop = gdop;
+   pthread_mutex_unlock(&pipe->m);
+}
+
+void dwm_pipe_trace_set(dwm_pipe_t* pipe, dwm_trace_t* tr)
+{
+   pthread_mutex_lock(&pipe->m);
+   pipe->tr = tr;
+   pthread_mutex_unlock(&pipe->m);
+}
+
+uint32_t dwm_pipe_drop_cnt(dwm_pipe_t* pipe)
+{
+   uint32_t cnt;
+
+   pthread_mutex_lock(&pipe->m);
+   cnt = pipe->drop_cnt;
+   pthread_mutex_unlock(&pipe->m);
+   return cnt;
+}
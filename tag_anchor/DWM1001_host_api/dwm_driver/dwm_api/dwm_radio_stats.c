@@ -0,0 +1,175 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_radio_stats.c
+ * @brief   DWM1001 host API, radio counters of the TDoA tag and anchor firmware
+ *
+ *          dwm_radio_stats_parse() and dwm_radio_stats_loss() do not use
+ *          the HAL, dwm_radio_stats_get() reads the UART of the HAL.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+#include <stdint.h>
+#include <string.h>
+#include "dwm_api.h"
+#include "dwm_radio_stats.h"
+#include "dwm_tlv.h"
+#include "hal.h"
+
+#define RS_HDR_LEN         3              /* SOF, LEN */
+#define RS_CRC_LEN         2
+#define RS_FRAME_MAX       (RS_HDR_LEN + 256 + RS_CRC_LEN)
+
+/**
+ * @brief length of the frame at p, 0 if its header is not complete
+ */
+static int frame_len(const uint8_t* p, int len)
+{
+   if(len < RS_HDR_LEN)
+   {
+      return 0;
+   }
+   return RS_HDR_LEN + (p[1] | (p[2] << 8)) + RS_CRC_LEN;
+}
+
+int dwm_radio_stats_parse(const uint8_t* frame, int len, dwm_radio_stats_t* s)
+{
+   int tlv_len, pos, i;
+   const uint8_t* tlv = frame + RS_HDR_LEN;
+
+   if((len < RS_HDR_LEN + RS_CRC_LEN) || (frame[0] != DWM_RADIO_STATS_SOF) || (frame_len(frame, len) != len))
+   {
+      return RV_ERR;
+   }
+   tlv_len = len - RS_HDR_LEN - RS_CRC_LEN;
+   if(dwm_tlv_crc16(0xFFFF, frame + 1, tlv_len + 2) != (frame[len-2] | (frame[len-1] << 8)))
+   {
+      return RV_ERR;
+   }
+
+   for(pos = 0; pos + 2 <= tlv_len; pos += 2 + tlv[pos+1])
+   {
+      if(pos + 2 + tlv[pos+1] > tlv_len)
+      {
+         return RV_ERR;
+      }
+      if((tlv[pos] == DWM_RADIO_STATS_TLV) && (tlv[pos+1] == DWM_RADIO_STATS_LEN))
+      {
+         s->tick_ms = (uint32_t)dwm_tlv_get(&tlv[pos+2], 4);
+         for(i = 0; i < DWM_RADIO_STATS_NUM; i++)
+         {
+            s->cnt[i] = (uint32_t)dwm_tlv_get(&tlv[pos+6+4*i], 4);
+         }
+         return RV_OK;
+      }
+   }
+   return RV_ERR;
+}
+
+void dwm_radio_stats_loss(const dwm_radio_stats_t* prev, const dwm_radio_stats_t* now, dwm_radio_loss_t* loss)
+{
+   uint32_t d[DWM_RADIO_STATS_NUM];
+   int i;
+
+   // the totals wrap, unsigned differences
+   for(i = 0; i < DWM_RADIO_STATS_NUM; i++)
+   {
+      d[i] = now->cnt[i] - prev->cnt[i];
+   }
+
+   loss->rx = d[DWM_RADIO_STATS_APP_RX];
+   loss->rf = d[DWM_RADIO_STATS_PHE] + d[DWM_RADIO_STATS_RSL] + d[DWM_RADIO_STATS_CRCB] + d[DWM_RADIO_STATS_SFDTO];
+   loss->fw = d[DWM_RADIO_STATS_OVER] + d[DWM_RADIO_STATS_APP_DROP];
+   // the DW1000 counters are as of the last snapshot, the application counters are current
+   if(d[DWM_RADIO_STATS_CRCG] > d[DWM_RADIO_STATS_APP_RX])
+   {
+      loss->fw += d[DWM_RADIO_STATS_CRCG] - d[DWM_RADIO_STATS_APP_RX];
+   }
+   loss->tx_lost = d[DWM_RADIO_STATS_APP_TXLOST];
+}
+
+#if (INTERFACE_NUMBER == 0) || (INTERFACE_NUMBER == 3)
+int dwm_radio_stats_get(dwm_radio_stats_t* s)
+{
+   uint8_t req[RS_HDR_LEN + 2 + RS_CRC_LEN];
+   uint8_t buf[RS_FRAME_MAX];
+   uint8_t length;
+   uint16_t crc;
+   uint64_t deadline, now;
+   int len = 0, flen;
+
+   if(HAL_IF_Get(HAL_DevNum()) != HAL_IF_UART)
+   {
+      return RV_ERR;
+   }
+   req[0] = DWM_RADIO_STATS_SOF;
+   req[1] = 2;
+   req[2] = 0;
+   req[3] = DWM_RADIO_STATS_TLV;
+   req[4] = 0;
+   crc = dwm_tlv_crc16(0xFFFF, req + 1, 4);
+   req[5] = (uint8_t)crc;
+   req[6] = (uint8_t)(crc >> 8);
+
+   length = sizeof(req);
+   if(HAL_UART_Tx(req, &length) != HAL_OK)
+   {
+      return RV_ERR;
+   }
+
+   now = HAL_GetTime64();
+   deadline = now + (uint64_t)DWM_RADIO_STATS_TIMEOUT*1000;
+   while(now < deadline)
+   {
+      if(HAL_UART_WaitRx(deadline - now) == HAL_OK)
+      {
+         length = (uint8_t)((sizeof(buf) - len > HAL_UART_MAX_LENGTH) ? (HAL_UART_MAX_LENGTH) : (sizeof(buf) - len));
+         HAL_UART_Rx(buf + len, &length);
+         len += length;
+      }
+
+      // frames one after the other, resynchronised on the SOF
+      for(;;)
+      {
+         while((len > 0) && (buf[0] != DWM_RADIO_STATS_SOF))
+         {
+            memmove(buf, buf + 1, --len);
+         }
+         flen = frame_len(buf, len);
+         if((flen == 0) || (flen > len))
+         {
+            break;
+         }
+         if(dwm_radio_stats_parse(buf, flen, s) == RV_OK)
+         {
+            return RV_OK;
+         }
+         // another frame, or a false SOF: skip the SOF only if it is broken
+         if(dwm_tlv_crc16(0xFFFF, buf + 1, flen - RS_HDR_LEN) == (buf[flen-2] | (buf[flen-1] << 8)))
+         {
+            len -= flen;
+            memmove(buf, buf + flen, len);
+         }
+         else
+         {
+            memmove(buf, buf + 1, --len);
+         }
+      }
+      if(frame_len(buf, len) > (int)sizeof(buf))
+      {
+         memmove(buf, buf + 1, --len);
+      }
+      now = HAL_GetTime64();
+   }
+   return RV_ERR;
+}
+#else
+int dwm_radio_stats_get(dwm_radio_stats_t* s)
+{
+   (void)s;
+   return RV_ERR;
+}
+#endif
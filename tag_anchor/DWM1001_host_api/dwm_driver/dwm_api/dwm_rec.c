@@ -0,0 +1,186 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_rec.c
+ * @brief   DWM1001 host API, binary location record files
+ *
+ *          The writer only depends on stdio and the reader on mmap, so the
+ *          converters link this file alone, without the HAL.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "dwm_api.h"
+#include "dwm_rec.h"
+
+_Static_assert(sizeof(dwm_rec_hdr_t) == 64, "dwm_rec_hdr_t must stay 64 bytes");
+_Static_assert(sizeof(dwm_rec_t) == 152, "dwm_rec_t must stay 152 bytes");
+
+int dwm_rec_open(dwm_rec_writer_t* w, const char* path)
+{
+   dwm_rec_hdr_t hdr;
+   struct timespec ts;
+   struct timeval tv;
+
+   w->cnt = 0;
+   w->fp = fopen(path, "wb");
+   if(w->fp == NULL)
+   {
+      return RV_ERR;
+   }
+   // the records are buffered in w->buf, not in the stream
+   setvbuf(w->fp, NULL, _IONBF, 0);
+
+   memset(&hdr, 0, sizeof(hdr));
+   memcpy(hdr.magic, DWM_REC_MAGIC, sizeof(hdr.magic));
+   hdr.version = DWM_REC_VERSION;
+   hdr.hdr_size = sizeof(dwm_rec_hdr_t);
+   hdr.rec_size = sizeof(dwm_rec_t);
+   hdr.an_cnt_max = DWM_RANGING_ANCHOR_CNT_MAX;
+   // same clock as HAL_GetTime64()
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   hdr.start_ts = (uint64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+   gettimeofday(&tv, NULL);
+   hdr.start_wall = (uint64_t)tv.tv_sec*1000000 + tv.tv_usec;
+
+   if(fwrite(&hdr, sizeof(hdr), 1, w->fp) != 1)
+   {
+      fclose(w->fp);
+      w->fp = NULL;
+      return RV_ERR;
+   }
+   return RV_OK;
+}
+
+int dwm_rec_append(dwm_rec_writer_t* w, uint64_t ts, uint32_t seq, uint64_t node_id, const dwm_loc_data_t* loc)
+{
+   dwm_rec_t *rec;
+   uint8_t i;
+
+   if(w->fp == NULL)
+   {
+      return RV_ERR;
+   }
+   if((w->cnt == DWM_REC_BUF_CNT) && (dwm_rec_flush(w) != RV_OK))
+   {
+      return RV_ERR;
+   }
+   rec = &w->buf[w->cnt++];
+   memset(rec, 0, sizeof(dwm_rec_t));
+   rec->ts = ts;
+   rec->node_id = node_id;
+   rec->seq = seq;
+   rec->x = loc->p_pos->x;
+   rec->y = loc->p_pos->y;
+   rec->z = loc->p_pos->z;
+   rec->qf = loc->p_pos->qf;
+   rec->cnt = (loc->anchors.dist.cnt < DWM_RANGING_ANCHOR_CNT_MAX) ? loc->anchors.dist.cnt : DWM_RANGING_ANCHOR_CNT_MAX;
+   for(i = 0; i < rec->cnt; i++)
+   {
+      rec->an[i].addr = loc->anchors.dist.addr[i];
+      rec->an[i].qf = loc->anchors.dist.qf[i];
+      rec->an[i].dist = loc->anchors.dist.dist[i];
+   }
+   return RV_OK;
+}
+
+int dwm_rec_flush(dwm_rec_writer_t* w)
+{
+   int cnt = w->cnt;
+
+   if(w->fp == NULL)
+   {
+      return RV_ERR;
+   }
+   w->cnt = 0;
+   if((cnt > 0) && (fwrite(w->buf, sizeof(dwm_rec_t), cnt, w->fp) != (size_t)cnt))
+   {
+      return RV_ERR;
+   }
+   return RV_OK;
+}
+
+int dwm_rec_close(dwm_rec_writer_t* w)
+{
+   int ret;
+
+   if(w->fp == NULL)
+   {
+      return RV_ERR;
+   }
+   ret = dwm_rec_flush(w);
+   if(fclose(w->fp) != 0)
+   {
+      ret = RV_ERR;
+   }
+   w->fp = NULL;
+   return ret;
+}
+
+int dwm_rec_map(dwm_rec_reader_t* r, const char* path)
+{
+   struct stat st;
+   void *base;
+   int fd;
+
+   memset(r, 0, sizeof(dwm_rec_reader_t));
+   fd = open(path, O_RDONLY);
+   if(fd < 0)
+   {
+      return RV_ERR;
+   }
+   if((fstat(fd, &st) != 0) || (st.st_size < (off_t)sizeof(dwm_rec_hdr_t)))
+   {
+      close(fd);
+      return RV_ERR;
+   }
+   base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+   close(fd);
+   if(base == MAP_FAILED)
+   {
+      return RV_ERR;
+   }
+   r->base = base;
+   r->size = st.st_size;
+   r->hdr = (const dwm_rec_hdr_t*)base;
+
+   // a newer version may only append fields, the sizes are read from the header
+   if((memcmp(r->hdr->magic, DWM_REC_MAGIC, sizeof(r->hdr->magic)) != 0) \
+   || (r->hdr->version < DWM_REC_VERSION) || (r->hdr->hdr_size < sizeof(dwm_rec_hdr_t)) \
+   || (r->hdr->rec_size < sizeof(dwm_rec_t)) || (r->hdr->hdr_size > r->size))
+   {
+      dwm_rec_unmap(r);
+      return RV_ERR;
+   }
+   r->cnt = (r->size - r->hdr->hdr_size) / r->hdr->rec_size;
+   return RV_OK;
+}
+
+const dwm_rec_t* dwm_rec_at(const dwm_rec_reader_t* r, uint32_t idx)
+{
+   if(idx >= r->cnt)
+   {
+      return NULL;
+   }
+   return (const dwm_rec_t*)(r->base + r->hdr->hdr_size + (size_t)idx*r->hdr->rec_size);
+}
+
+void dwm_rec_unmap(dwm_rec_reader_t* r)
+{
+   if(r->base != NULL)
+   {
+      munmap((void*)r->base, r->size);
+   }
+   memset(r, 0, sizeof(dwm_rec_reader_t));
+}
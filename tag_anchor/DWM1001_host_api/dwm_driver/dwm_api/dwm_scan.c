@@ -0,0 +1,343 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_scan.c
+ * @brief   DWM1001 host API, background UWB scan and preamble code choice
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include "dwm_api.h"
+#include "dwm_api_cache.h"
+#include "dwm_scan.h"
+#include "hal.h"
+#include "hal_log.h"
+
+#define SCAN_VALID(code)   (((code) >= DWM_SCAN_CODE_MIN) && ((code) < DWM_SCAN_CODE_MIN + DWM_SCAN_CODE_NUM))
+
+void dwm_scan_cfg_default(dwm_scan_cfg_t* cfg)
+{
+   cfg->period_ms = 60000;
+   cfg->result_ms = 1000;
+   cfg->sweep = true;
+   cfg->min_scans = 3;
+   cfg->margin_db = 3.0f;
+   cfg->auto_apply = false;
+   cfg->switch_delay_ms = 2000;
+   cfg->announce_cnt = 5;
+}
+
+int dwm_scan_init(dwm_scan_t* s, const dwm_scan_cfg_t* cfg)
+{
+   dwm_uwb_preamble_code_t code;
+
+   memset(s, 0, sizeof(*s));
+   if(cfg == NULL)
+   {
+      dwm_scan_cfg_default(&s->cfg);
+   }
+   else
+   {
+      s->cfg = *cfg;
+   }
+   if((s->cfg.min_scans < 1) || (s->cfg.min_scans > DWM_SCAN_HIST_LEN))
+   {
+      return RV_ERR_PARAM;
+   }
+   if((dwm_uwb_preamble_code_get(&code) != RV_OK) || !SCAN_VALID(code))
+   {
+      return RV_ERR;
+   }
+   s->home = s->cur = code;
+   s->idx = s->cfg.sweep ? 0 : code - DWM_SCAN_CODE_MIN;
+   s->next_ts = HAL_GetTime64();
+   return RV_OK;
+}
+
+/**
+ * @brief power of the own network heard by an anchor, 0 on a tag
+ */
+static float dwm_scan_own_pwr(void)
+{
+   dwm_anchor_list_t list;
+   float pwr = 0;
+   int i;
+
+   if(dwm_cache_anchor_list_get(&list) != RV_OK)
+   {
+      return 0;
+   }
+   for(i = 0; i < list.cnt; i++)
+   {
+      if(!list.v[i].neighbor_network)
+      {
+         pwr += powf(10.0f, list.v[i].rssi/10.0f);
+      }
+   }
+   return pwr;
+}
+
+static void dwm_scan_record(dwm_scan_t* s, const dwm_uwb_scan_result_t* r)
+{
+   uint8_t c = s->idx, pos = s->hist_pos[c], i;
+   int8_t rssi_max = -128;
+   float pwr = 0;
+
+   for(i = 0; i < r->cnt; i++)
+   {
+      pwr += powf(10.0f, r->rssi[i]/10.0f);
+      if(r->rssi[i] > rssi_max)
+      {
+         rssi_max = r->rssi[i];
+      }
+   }
+   if(c + DWM_SCAN_CODE_MIN == s->home)
+   {
+      pwr -= dwm_scan_own_pwr();
+      if(pwr < 0)
+      {
+         pwr = 0;
+      }
+   }
+   s->hist_nets[c][pos] = r->cnt;
+   s->hist_rssi[c][pos] = rssi_max;
+   s->hist_pwr[c][pos] = pwr;
+   s->hist_pos[c] = (pos + 1) % DWM_SCAN_HIST_LEN;
+   if(s->hist_len[c] < DWM_SCAN_HIST_LEN)
+   {
+      s->hist_len[c]++;
+   }
+   s->scans++;
+}
+
+/**
+ * @brief moves the module to a code, dwm_uwb_preamble_code_set() only if needed
+ */
+static int dwm_scan_move(dwm_scan_t* s, uint8_t code)
+{
+   if(s->cur == code)
+   {
+      return RV_OK;
+   }
+   if(dwm_uwb_preamble_code_set(code) != RV_OK)
+   {
+      return RV_ERR;
+   }
+   s->cur = code;
+   return RV_OK;
+}
+
+/**
+ * @brief announcement and switch of a scheduled switch
+ */
+static int dwm_scan_switch_step(dwm_scan_t* s, uint64_t now)
+{
+   uint8_t msg[DWM_SCAN_MSG_LEN];
+   uint32_t left;
+   int rv;
+
+   if(now >= s->sw_ts)
+   {
+      s->wait = false;
+      s->home = s->sw_code;
+      s->sw_ts = 0;
+      rv = dwm_scan_move(s, s->home);
+      HAL_Log("dwm:     scan: switched to preamble code %d, %s\n", s->home, (rv == RV_OK) ? "ok" : "failed");
+      // the own network moved with the node, the history no longer tells
+      memset(s->hist_len, 0, sizeof(s->hist_len));
+      memset(s->hist_pos, 0, sizeof(s->hist_pos));
+      s->idx = s->cfg.sweep ? 0 : s->home - DWM_SCAN_CODE_MIN;
+      s->next_ts = now + (uint64_t)s->cfg.period_ms*1000;
+      s->switches++;
+      return rv;
+   }
+   if(s->cur != s->home)
+   {
+      // a sweep was cut by the switch
+      s->wait = false;
+      return dwm_scan_move(s, s->home);
+   }
+   if(s->sw_announce == 0)
+   {
+      return RV_OK;
+   }
+   left = (uint32_t)((s->sw_ts - now)/1000);
+   msg[0] = DWM_SCAN_MSG_ID;
+   msg[1] = s->sw_code;
+   msg[2] = left & 0xff;
+   msg[3] = (left >> 8) & 0xff;
+   msg[4] = s->sw_seq;
+   rv = dwm_usr_data_write(msg, DWM_SCAN_MSG_LEN, false);
+   if(rv == RV_OK)
+   {
+      s->sw_announce--;    // else busy, sent at the next step
+   }
+   return rv;
+}
+
+int dwm_scan_step(dwm_scan_t* s)
+{
+   uint64_t now = HAL_GetTime64();
+   dwm_uwb_scan_result_t res;
+   dwm_uwb_preamble_code_t code;
+   dwm_status_t status;
+   int rv;
+
+   if(s->sw_ts != 0)
+   {
+      return dwm_scan_switch_step(s, now);
+   }
+   if(!s->wait)
+   {
+      if(now < s->next_ts)
+      {
+         return RV_OK;
+      }
+      if((dwm_scan_move(s, s->idx + DWM_SCAN_CODE_MIN) != RV_OK) || (dwm_uwb_scan_start() != RV_OK))
+      {
+         s->next_ts = now + (uint64_t)s->cfg.period_ms*1000;
+         dwm_scan_move(s, s->home);
+         return RV_ERR;
+      }
+      s->wait = true;
+      s->next_ts = now + (uint64_t)s->cfg.result_ms*1000;
+      return RV_OK;
+   }
+
+   rv = dwm_status_get(&status);
+   if((rv == RV_OK) && !status.uwb_scan_ready && (now < s->next_ts))
+   {
+      return RV_OK;
+   }
+   s->wait = false;
+   rv = dwm_uwb_scan_result_get(&res);
+   if(rv == RV_OK)
+   {
+      dwm_scan_record(s, &res);
+   }
+   if(s->cfg.sweep && (++s->idx < DWM_SCAN_CODE_NUM))
+   {
+      s->next_ts = now;    // next code at the next step
+      return rv;
+   }
+
+   // end of the sweep
+   s->idx = s->cfg.sweep ? 0 : s->home - DWM_SCAN_CODE_MIN;
+   s->next_ts = now + (uint64_t)s->cfg.period_ms*1000;
+   if(dwm_scan_move(s, s->home) != RV_OK)
+   {
+      rv = RV_ERR;
+   }
+   if(s->cfg.auto_apply && (dwm_scan_recommend(s, &code) == RV_OK))
+   {
+      dwm_scan_switch(s, code);
+   }
+   return rv;
+}
+
+int dwm_scan_code_stat_get(const dwm_scan_t* s, dwm_uwb_preamble_code_t code, dwm_scan_code_stat_t* stat)
+{
+   uint8_t c, i;
+   uint16_t nets = 0;
+   float pwr = 0;
+
+   if(!SCAN_VALID(code))
+   {
+      return RV_ERR_PARAM;
+   }
+   c = code - DWM_SCAN_CODE_MIN;
+   stat->scans = s->hist_len[c];
+   stat->rssi_max = -128;
+   for(i = 0; i < s->hist_len[c]; i++)
+   {
+      nets += s->hist_nets[c][i];
+      pwr += s->hist_pwr[c][i];
+      if(s->hist_rssi[c][i] > stat->rssi_max)
+      {
+         stat->rssi_max = s->hist_rssi[c][i];
+      }
+   }
+   if(stat->scans == 0)
+   {
+      stat->nets = 0;
+      stat->congestion_db = DWM_SCAN_FLOOR_DB;
+      return RV_OK;
+   }
+   stat->nets = (float)nets/stat->scans;
+   pwr = pwr/stat->scans + powf(10.0f, DWM_SCAN_FLOOR_DB/10.0f);
+   stat->congestion_db = 10.0f*log10f(pwr);
+   return RV_OK;
+}
+
+int dwm_scan_recommend(const dwm_scan_t* s, dwm_uwb_preamble_code_t* code)
+{
+   dwm_scan_code_stat_t stat;
+   float home_db = 0, best_db = 0;
+   int c, best = -1;
+
+   for(c = DWM_SCAN_CODE_MIN; c < DWM_SCAN_CODE_MIN + DWM_SCAN_CODE_NUM; c++)
+   {
+      dwm_scan_code_stat_get(s, c, &stat);
+      if(stat.scans < s->cfg.min_scans)
+      {
+         return RV_ERR;
+      }
+      if(c == s->home)
+      {
+         home_db = stat.congestion_db;
+      }
+      if((best < 0) || (stat.congestion_db < best_db))
+      {
+         best = c;
+         best_db = stat.congestion_db;
+      }
+   }
+   if((best == s->home) || (home_db - best_db < s->cfg.margin_db))
+   {
+      return RV_ERR;
+   }
+   *code = best;
+   return RV_OK;
+}
+
+int dwm_scan_switch(dwm_scan_t* s, dwm_uwb_preamble_code_t code)
+{
+   if(!SCAN_VALID(code))
+   {
+      return RV_ERR_PARAM;
+   }
+   s->sw_code = code;
+   s->sw_ts = HAL_GetTime64() + (uint64_t)s->cfg.switch_delay_ms*1000;
+   s->sw_seq++;
+   s->sw_announce = s->cfg.announce_cnt;
+   HAL_Log("dwm:     scan: switch to preamble code %d in %d ms\n", code, s->cfg.switch_delay_ms);
+   return RV_OK;
+}
+
+int dwm_scan_msg_rx(dwm_scan_t* s, const uint8_t* data, uint8_t len)
+{
+   uint16_t left;
+
+   if((len != DWM_SCAN_MSG_LEN) || (data[0] != DWM_SCAN_MSG_ID) || !SCAN_VALID(data[1]))
+   {
+      return RV_ERR;
+   }
+   if(s->rx_seq_known && (data[4] == s->rx_seq))
+   {
+      return RV_OK;     // repeated announcement of the same switch
+   }
+   s->rx_seq_known = true;
+   s->rx_seq = data[4];
+   left = data[2] | (data[3] << 8);
+   s->sw_code = data[1];
+   s->sw_ts = HAL_GetTime64() + (uint64_t)left*1000;
+   s->sw_announce = 0;
+   HAL_Log("dwm:     scan: switch to preamble code %d in %d ms, announced\n", s->sw_code, left);
+   return RV_OK;
+}
@@ -0,0 +1,359 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_tdoa.c
+ * @brief   DWM1001 host API, TDoA multilateration
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "dwm_api.h"
+#include "dwm_tdoa.h"
+
+#define DWM_TDOA_N               (DWM_TDOA_DIM_MAX + 1)
+#define DWM_TDOA_DIST_MIN        1e-9     /* m, tag on an anchor */
+#define DWM_TDOA_LAMBDA0         1e-3
+#define DWM_TDOA_SPAN_MAX        4        /* fixes further from anchor 0 than this many anchor spans ran away */
+
+/**
+ * @brief solves m x = b in place for a symmetric positive definite m
+ *        by Cholesky, b is overwritten by x
+ */
+static int dwm_tdoa_chol(double m[DWM_TDOA_N][DWM_TDOA_N], double* b, int n)
+{
+   int i, j, k;
+   double s;
+
+   for(j = 0; j < n; j++)
+   {
+      s = m[j][j];
+      for(k = 0; k < j; k++)
+      {
+         s -= m[j][k] * m[j][k];
+      }
+      if(!(s > 0))
+      {
+         return RV_ERR;
+      }
+      m[j][j] = sqrt(s);
+      for(i = j + 1; i < n; i++)
+      {
+         s = m[i][j];
+         for(k = 0; k < j; k++)
+         {
+            s -= m[i][k] * m[j][k];
+         }
+         m[i][j] = s / m[j][j];
+      }
+   }
+   for(i = 0; i < n; i++)
+   {
+      s = b[i];
+      for(k = 0; k < i; k++)
+      {
+         s -= m[i][k] * b[k];
+      }
+      b[i] = s / m[i][i];
+   }
+   for(i = n - 1; i >= 0; i--)
+   {
+      s = b[i];
+      for(k = i + 1; k < n; k++)
+      {
+         s -= m[k][i] * b[k];
+      }
+      b[i] = s / m[i][i];
+   }
+   return RV_OK;
+}
+
+/**
+ * @brief residuals of the hyperbolas at p, and J'J, J'r if jtj is not NULL
+ *
+ * @return sum of the squared residuals
+ */
+static double dwm_tdoa_resid(const dwm_tdoa_t* t, const double* rd, const double* p,
+      double jtj[DWM_TDOA_N][DWM_TDOA_N], double* jtr)
+{
+   double u0[DWM_TDOA_DIM_MAX], ui[DWM_TDOA_DIM_MAX], g[DWM_TDOA_DIM_MAX];
+   double r0 = 0, ri, e, cost = 0;
+   int i, j, k, dim = t->dim;
+
+   for(j = 0; j < dim; j++)
+   {
+      u0[j] = p[j] - t->a[0][j];
+      r0 += u0[j] * u0[j];
+   }
+   r0 = sqrt(r0);
+   for(j = 0; j < dim; j++)
+   {
+      u0[j] /= (r0 > DWM_TDOA_DIST_MIN) ? r0 : DWM_TDOA_DIST_MIN;
+   }
+   if(jtj != NULL)
+   {
+      memset(jtj, 0, sizeof(double) * DWM_TDOA_N * DWM_TDOA_N);
+      memset(jtr, 0, sizeof(double) * dim);
+   }
+   for(i = 1; i < t->cnt; i++)
+   {
+      ri = 0;
+      for(j = 0; j < dim; j++)
+      {
+         ui[j] = p[j] - t->a[i][j];
+         ri += ui[j] * ui[j];
+      }
+      ri = sqrt(ri);
+      e = ri - r0 - rd[i];
+      cost += e * e;
+      if(jtj == NULL)
+      {
+         continue;
+      }
+      for(j = 0; j < dim; j++)
+      {
+         g[j] = ui[j] / ((ri > DWM_TDOA_DIST_MIN) ? ri : DWM_TDOA_DIST_MIN) - u0[j];
+         jtr[j] += g[j] * e;
+         for(k = 0; k <= j; k++)
+         {
+            jtj[j][k] += g[j] * g[k];
+         }
+      }
+   }
+   return cost;
+}
+
+int dwm_tdoa_init(dwm_tdoa_t* t, int dim, int cnt, const double* anchors)
+{
+   int i, j;
+   double d;
+
+   if((dim < 2) || (dim > DWM_TDOA_DIM_MAX) || (cnt < dim + 1) || (cnt > DWM_TDOA_ANCHOR_CNT_MAX))
+   {
+      return RV_ERR;
+   }
+   memset(t, 0, sizeof(dwm_tdoa_t));
+   t->dim = dim;
+   t->cnt = cnt;
+   for(i = 0; i < cnt; i++)
+   {
+      for(j = 0; j < dim; j++)
+      {
+         t->a[i][j] = anchors[i*dim + j];
+      }
+   }
+   for(i = 0; i < cnt; i++)
+   {
+      for(j = 0; j < dim; j++)
+      {
+         d = t->a[i][j] - t->a[0][j];
+         t->k[i] += d * d;
+      }
+   }
+   return RV_OK;
+}
+
+int dwm_tdoa_linear(const dwm_tdoa_t* t, const double* rd, double* p)
+{
+   double ata[DWM_TDOA_N][DWM_TDOA_N], atb[DWM_TDOA_N], row[DWM_TDOA_N], b;
+   int i, j, k, n = t->dim + 1;
+
+   if(t->cnt - 1 < n)
+   {
+      return RV_ERR;
+   }
+   memset(ata, 0, sizeof(ata));
+   memset(atb, 0, sizeof(atb));
+   // unknowns p - a_0 and r_0, relative to anchor 0 for the conditioning
+   for(i = 1; i < t->cnt; i++)
+   {
+      for(j = 0; j < t->dim; j++)
+      {
+         row[j] = 2 * (t->a[i][j] - t->a[0][j]);
+      }
+      row[t->dim] = 2 * rd[i];
+      b = t->k[i] - rd[i] * rd[i];
+      for(j = 0; j < n; j++)
+      {
+         atb[j] += row[j] * b;
+         for(k = 0; k <= j; k++)
+         {
+            ata[j][k] += row[j] * row[k];
+         }
+      }
+   }
+   if(dwm_tdoa_chol(ata, atb, n) != RV_OK)
+   {
+      return RV_ERR;
+   }
+   for(j = 0; j < t->dim; j++)
+   {
+      p[j] = t->a[0][j] + atb[j];
+   }
+   return RV_OK;
+}
+
+/**
+ * @brief Levenberg-Marquardt from p, until a step is below step_min, or the
+ *        next one would be at the rate of the last two accepted steps
+ *
+ * @param[out] rms, may be NULL
+ * @param[out] iter, iterations, J'J solves
+ *
+ * @return Error code, RV_ERR if the iterations ran away from the anchors,
+ *         p is then the starting point
+ */
+static int dwm_tdoa_lm(const dwm_tdoa_t* t, const double* rd, double* p, double step_min, double* rms, int* iter)
+{
+   double jtj[DWM_TDOA_N][DWM_TDOA_N], m[DWM_TDOA_N][DWM_TDOA_N], jtr[DWM_TDOA_DIM_MAX];
+   double jtj_new[DWM_TDOA_N][DWM_TDOA_N], jtr_new[DWM_TDOA_DIM_MAX];
+   double step[DWM_TDOA_DIM_MAX], q[DWM_TDOA_DIM_MAX] = {0}, p0[DWM_TDOA_DIM_MAX];
+   double cost, cost_new, lambda = DWM_TDOA_LAMBDA0, d, d_last = 0, span = 0;
+   int i, j, k, it, dim = t->dim;
+
+   memcpy(p0, p, sizeof(double) * dim);
+   cost = dwm_tdoa_resid(t, rd, p, jtj, jtr);
+   for(it = 1; it <= DWM_TDOA_ITER_MAX; it++)
+   {
+      // (J'J + lambda diag(J'J)) step = -J'r, lambda grows until the cost drops
+      for(j = 0; j < dim; j++)
+      {
+         for(k = 0; k <= j; k++)
+         {
+            m[j][k] = jtj[j][k];
+         }
+         m[j][j] *= 1 + lambda;
+         step[j] = -jtr[j];
+      }
+      if(dwm_tdoa_chol(m, step, dim) != RV_OK)
+      {
+         break;
+      }
+      d = 0;
+      for(j = 0; j < dim; j++)
+      {
+         q[j] = p[j] + step[j];
+         d += step[j] * step[j];
+      }
+      // the Jacobian is computed with the cost, the steps are mostly accepted
+      cost_new = dwm_tdoa_resid(t, rd, q, jtj_new, jtr_new);
+      if(cost_new < cost)
+      {
+         memcpy(p, q, sizeof(double) * dim);
+         cost = cost_new;
+         lambda *= 0.1;
+         // the steps shrink at least linearly near the fix: d_next ~ d^2 / d_last
+         if((d < step_min * step_min) || ((d_last > 0) && (d * d < step_min * step_min * d_last)))
+         {
+            break;
+         }
+         d_last = d;
+         memcpy(jtj, jtj_new, sizeof(jtj));
+         memcpy(jtr, jtr_new, sizeof(double) * dim);
+      }
+      else
+      {
+         lambda *= 10;
+         if(d < step_min * step_min)
+         {
+            break;
+         }
+      }
+   }
+   *iter = (it > DWM_TDOA_ITER_MAX) ? DWM_TDOA_ITER_MAX : it;
+   if(rms != NULL)
+   {
+      *rms = sqrt(cost / (t->cnt - 1));
+   }
+   // outside the anchors the hyperbolas flatten, a noisy fix can follow them away
+   for(i = 1; i < t->cnt; i++)
+   {
+      span = (t->k[i] > span) ? t->k[i] : span;
+   }
+   d = 0;
+   for(j = 0; j < dim; j++)
+   {
+      d += (p[j] - t->a[0][j]) * (p[j] - t->a[0][j]);
+   }
+   if(!(d <= DWM_TDOA_SPAN_MAX * DWM_TDOA_SPAN_MAX * span))
+   {
+      memcpy(p, p0, sizeof(double) * dim);
+      return RV_ERR;
+   }
+   return RV_OK;
+}
+
+/**
+ * @brief starting point of a cold solve: the linear solve, or the centroid
+ *        of the anchors if there are too few
+ */
+static void dwm_tdoa_start(const dwm_tdoa_t* t, const double* rd, double* p)
+{
+   int i, j;
+
+   if(dwm_tdoa_linear(t, rd, p) == RV_OK)
+   {
+      return;
+   }
+   for(j = 0; j < t->dim; j++)
+   {
+      p[j] = 0;
+      for(i = 0; i < t->cnt; i++)
+      {
+         p[j] += t->a[i][j];
+      }
+      p[j] /= t->cnt;
+   }
+}
+
+int dwm_tdoa_solve(const dwm_tdoa_t* t, const double* rd, const double* guess, double* p, double* rms)
+{
+   int iter;
+
+   if(guess != NULL)
+   {
+      memcpy(p, guess, sizeof(double) * t->dim);
+   }
+   else
+   {
+      dwm_tdoa_start(t, rd, p);
+   }
+   return dwm_tdoa_lm(t, rd, p, DWM_TDOA_STEP_MIN, rms, &iter);
+}
+
+int dwm_tdoa_solve_warm(const dwm_tdoa_t* t, const double* rd, const double* pred, double rms_max,
+      double* p, double* rms, int* iter)
+{
+   double r;
+   int rv, n = 0, m;
+
+   if(pred != NULL)
+   {
+      memcpy(p, pred, sizeof(double) * t->dim);
+      rv = dwm_tdoa_lm(t, rd, p, DWM_TDOA_WARM_STEP, &r, &n);
+      if((rv == RV_OK) && (r <= rms_max))
+      {
+         if(rms != NULL)
+         {
+            *rms = r;
+         }
+         if(iter != NULL)
+         {
+            *iter = n;
+         }
+         return RV_OK;
+      }
+   }
+   // no prediction, or it converged to a wrong fix: full solve
+   dwm_tdoa_start(t, rd, p);
+   rv = dwm_tdoa_lm(t, rd, p, DWM_TDOA_STEP_MIN, rms, &m);
+   if(iter != NULL)
+   {
+      *iter = n + m;
+   }
+   return rv;
+}
@@ -0,0 +1,295 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_tlv.c
+ * @brief   DWM1001 host API, TLV codec of the requests and responses
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+#include <stdint.h>
+#include <string.h>
+#include "dwm1001_tlv.h"
+#include "dwm_tlv.h"
+
+#define RESP_DAT_TYPE_OFFSET     DWM_TLV_RET_VAL_LEN
+#define RESP_DAT_LEN_OFFSET      RESP_DAT_TYPE_OFFSET+1
+#define RESP_DAT_VALUE_OFFSET    RESP_DAT_LEN_OFFSET+1
+
+#define RESP_DATA_LOC_LOC_SIZE     15
+#define RESP_DATA_LOC_DIST_OFFSET  RESP_DAT_TYPE_OFFSET + RESP_DATA_LOC_LOC_SIZE
+#define RESP_DATA_LOC_DIST_LEN_MIN 3
+
+static const dwm_tlv_field_t pos_fields[] = {
+   DWM_TLV_FIELD(dwm_pos_t, x, 4),
+   DWM_TLV_FIELD(dwm_pos_t, y, 4),
+   DWM_TLV_FIELD(dwm_pos_t, z, 4),
+   DWM_TLV_FIELD(dwm_pos_t, qf, 1),
+};
+const dwm_tlv_layout_t dwm_tlv_pos_layout = DWM_TLV_LAYOUT(pos_fields, 13);
+
+// anchor node: 8 bytes tag ID, distance and qf
+static const dwm_tlv_field_t an_dist_fields[] = {
+   DWM_TLV_ARRAY_FIELD(dwm_distance_t, addr, 8),
+   DWM_TLV_ARRAY_FIELD(dwm_distance_t, dist, 4),
+   DWM_TLV_ARRAY_FIELD(dwm_distance_t, qf, 1),
+};
+const dwm_tlv_layout_t dwm_tlv_an_dist_layout = DWM_TLV_LAYOUT(an_dist_fields, 13);
+
+// tag node: 2 bytes anchor ID, distance and qf, followed by the anchor position
+static const dwm_tlv_field_t tag_dist_fields[] = {
+   DWM_TLV_ARRAY_FIELD(dwm_distance_t, addr, 2),
+   DWM_TLV_ARRAY_FIELD(dwm_distance_t, dist, 4),
+   DWM_TLV_ARRAY_FIELD(dwm_distance_t, qf, 1),
+};
+const dwm_tlv_layout_t dwm_tlv_tag_dist_layout = DWM_TLV_LAYOUT(tag_dist_fields, 7);
+
+// the seat and neighbor network bits of the byte after rssi are decoded apart
+static const dwm_tlv_field_t anchor_elt_fields[] = {
+   DWM_TLV_FIELD(dwm_anchor_list_elt_t, node_id, 2),
+   DWM_TLV_FIELD(dwm_anchor_list_elt_t, x, 4),
+   DWM_TLV_FIELD(dwm_anchor_list_elt_t, y, 4),
+   DWM_TLV_FIELD(dwm_anchor_list_elt_t, z, 4),
+   DWM_TLV_FIELD(dwm_anchor_list_elt_t, rssi, 1),
+};
+const dwm_tlv_layout_t dwm_tlv_anchor_elt_layout = DWM_TLV_LAYOUT(anchor_elt_fields, 15);
+
+uint64_t dwm_tlv_get(const uint8_t* buf, uint8_t len)
+{
+   uint64_t value = 0;
+   while(len-- > 0)
+   {
+      value = (value << 8) | buf[len];
+   }
+   return value;
+}
+
+void dwm_tlv_put(uint8_t* buf, uint64_t value, uint8_t len)
+{
+   uint8_t i;
+   for(i = 0; i < len; i++)
+   {
+      buf[i] = (uint8_t)(value >> (i*8));
+   }
+}
+
+uint16_t dwm_tlv_crc16(uint16_t crc, const uint8_t* buf, uint16_t len)
+{
+   int i;
+
+   while(len--)
+   {
+      crc ^= (uint16_t)(*buf++) << 8;
+      for(i = 0; i < 8; i++)
+      {
+         crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+      }
+   }
+   return crc;
+}
+
+int dwm_tlv_decode(const uint8_t* buf, uint16_t len, const dwm_tlv_layout_t* layout, void* obj, uint8_t idx)
+{
+   const dwm_tlv_field_t *f;
+   uint8_t *dst;
+   uint64_t value;
+   uint8_t i;
+
+   if(len < layout->wire_len)
+   {
+      return -1;
+   }
+   for(i = 0; i < layout->cnt; i++)
+   {
+      f = &layout->fields[i];
+      dst = (uint8_t*)obj + f->offset + idx*f->stride;
+      value = dwm_tlv_get(buf, f->wire_len);
+      buf += f->wire_len;
+      switch(f->host_size)
+      {
+         case 1: *(uint8_t*)dst = (uint8_t)value; break;
+         case 2: *(uint16_t*)dst = (uint16_t)value; break;
+         case 4: *(uint32_t*)dst = (uint32_t)value; break;
+         case 8: *(uint64_t*)dst = value; break;
+         default: return -1;
+      }
+   }
+   return layout->wire_len;
+}
+
+int dwm_tlv_encode(uint8_t* buf, uint16_t size, const dwm_tlv_layout_t* layout, const void* obj, uint8_t idx)
+{
+   const dwm_tlv_field_t *f;
+   const uint8_t *src;
+   uint64_t value;
+   uint8_t i;
+
+   if(size < layout->wire_len)
+   {
+      return -1;
+   }
+   for(i = 0; i < layout->cnt; i++)
+   {
+      f = &layout->fields[i];
+      src = (const uint8_t*)obj + f->offset + idx*f->stride;
+      switch(f->host_size)
+      {
+         case 1: value = *(const uint8_t*)src; break;
+         case 2: value = *(const uint16_t*)src; break;
+         case 4: value = *(const uint32_t*)src; break;
+         case 8: value = *(const uint64_t*)src; break;
+         default: return -1;
+      }
+      dwm_tlv_put(buf, value, f->wire_len);
+      buf += f->wire_len;
+   }
+   return layout->wire_len;
+}
+
+uint16_t dwm_tlv_rsp_len(const uint8_t* buf, uint16_t len)
+{
+   uint16_t cnt;
+
+   if((len < DWM_TLV_RET_VAL_LEN) || (buf[0] != DWM1001_TLV_TYPE_RET_VAL))
+   {
+      return 0;
+   }
+   cnt = DWM_TLV_RET_VAL_LEN;
+   while((cnt + DWM_TLV_HDR_LEN <= len) && (buf[cnt] != DWM1001_TLV_TYPE_RET_VAL))
+   {
+      if(cnt + DWM_TLV_HDR_LEN + buf[cnt+1] > len)
+      {
+         return 0;
+      }
+      cnt += DWM_TLV_HDR_LEN + buf[cnt+1];
+   }
+   return cnt;
+}
+
+int dwm_tlv_pos_decode(const uint8_t* rsp, uint16_t len, dwm_pos_t* p_pos)
+{
+   if(len < RESP_DAT_VALUE_OFFSET)
+   {
+      return RV_ERR;
+   }
+   if(dwm_tlv_decode(rsp+RESP_DAT_VALUE_OFFSET, len-RESP_DAT_VALUE_OFFSET, &dwm_tlv_pos_layout, p_pos, 0) < 0)
+   {
+      return RV_ERR;
+   }
+   return RV_OK;
+}
+
+int dwm_tlv_loc_decode(const uint8_t* rsp, uint16_t len, dwm_loc_data_t* loc)
+{
+   const dwm_tlv_layout_t *dist_layout;
+   uint16_t data_cnt;
+   uint8_t i, cnt;
+   int ret;
+
+   if(len<RESP_DAT_TYPE_OFFSET+RESP_DATA_LOC_LOC_SIZE + RESP_DATA_LOC_DIST_LEN_MIN)// ok + pos + distance/range
+   {
+      return RV_ERR;
+   }
+
+   if(rsp[RESP_DAT_TYPE_OFFSET]==DWM1001_TLV_TYPE_POS_XYZ)//0x41
+   {
+      // node self position.
+      dwm_tlv_decode(rsp+RESP_DAT_VALUE_OFFSET, len-RESP_DAT_VALUE_OFFSET, &dwm_tlv_pos_layout, loc->p_pos, 0);
+   }
+
+   if(rsp[RESP_DATA_LOC_DIST_OFFSET]==DWM1001_TLV_TYPE_RNG_AN_DIST)//0x48
+   {
+      // node is Anchor, recording Tag ID, distances and qf
+      dist_layout = &dwm_tlv_an_dist_layout;
+   }
+   else if (rsp[RESP_DATA_LOC_DIST_OFFSET]==DWM1001_TLV_TYPE_RNG_AN_POS_DIST)//0x49
+   {
+      // node is Tag, recording Anchor ID, distances, qf and positions
+      dist_layout = &dwm_tlv_tag_dist_layout;
+   }
+   else
+   {
+      return RV_ERR;
+   }
+
+   cnt = rsp[RESP_DATA_LOC_DIST_OFFSET+2];
+   if(cnt > DWM_RANGING_ANCHOR_CNT_MAX)
+   {
+      return RV_ERR;
+   }
+   loc->anchors.dist.cnt = cnt;
+   loc->anchors.an_pos.cnt = (dist_layout == &dwm_tlv_tag_dist_layout) ? cnt : 0;
+   data_cnt = RESP_DATA_LOC_DIST_OFFSET + 3; // jump Type, Length and cnt, goto data
+   for (i = 0; i < cnt; i++)
+   {
+      ret = dwm_tlv_decode(rsp+data_cnt, len-data_cnt, dist_layout, &loc->anchors.dist, i);
+      if(ret < 0)
+      {
+         return RV_ERR;
+      }
+      data_cnt += ret;
+      if(loc->anchors.an_pos.cnt > 0)
+      {
+         ret = dwm_tlv_decode(rsp+data_cnt, len-data_cnt, &dwm_tlv_pos_layout, &loc->anchors.an_pos.pos[i], 0);
+         if(ret < 0)
+         {
+            return RV_ERR;
+         }
+         data_cnt += ret;
+      }
+   }
+   return RV_OK;
+}
+
+int dwm_tlv_node_id_decode(const uint8_t* rsp, uint16_t len, uint64_t* p_node_id)
+{
+   if(len < RESP_DAT_VALUE_OFFSET+8)
+   {
+      return RV_ERR;
+   }
+   *p_node_id = dwm_tlv_get(rsp+RESP_DAT_VALUE_OFFSET, 8);
+   return RV_OK;
+}
+
+int dwm_tlv_status_decode(const uint8_t* rsp, uint16_t len, dwm_status_t* p_status)
+{
+   uint16_t flags;
+
+   if(len < RESP_DAT_VALUE_OFFSET+2)
+   {
+      return RV_ERR;
+   }
+   flags = (uint16_t)dwm_tlv_get(rsp+RESP_DAT_VALUE_OFFSET, 2);
+   p_status->loc_data         = (flags & API_STATUS_FLAG_LOC_READY)? 1:0;
+   p_status->uwbmac_joined    = (flags & API_STATUS_FLAG_UWBMAC_JOINED)? 1:0;
+   p_status->bh_data_ready    = (flags & API_STATUS_FLAG_BH_STATUS_CHANGED)? 1:0;
+   p_status->bh_status_changed = (flags & API_STATUS_FLAG_BH_DATA_READY)? 1:0;
+   p_status->bh_initialized   = (flags & API_STATUS_FLAG_BH_INITIALIZED)? 1:0;
+   p_status->uwb_scan_ready   = (flags & API_STATUS_FLAG_UWB_SCAN_READY)? 1:0;
+   p_status->usr_data_ready   = (flags & API_STATUS_FLAG_USR_DATA_READY)? 1:0;
+   p_status->usr_data_sent    = (flags & API_STATUS_FLAG_USR_DATA_SENT)? 1:0;
+   p_status->fwup_in_progress = (flags & API_STATUS_FLAG_FWUP_IN_PROGRESS)? 1:0;
+   return RV_OK;
+}
+
+int dwm_tlv_usr_data_decode(const uint8_t* rsp, uint16_t len, uint8_t* p_data, uint8_t* p_len)
+{
+   if((len<RESP_DAT_VALUE_OFFSET) || (len > RESP_DAT_VALUE_OFFSET+DWM_API_USR_DATA_LEN_MAX))
+   {
+      return RV_ERR;
+   }
+   memset(p_data, 0, DWM_API_USR_DATA_LEN_MAX);
+   *p_len = rsp[RESP_DAT_LEN_OFFSET];
+   if((len == RESP_DAT_VALUE_OFFSET) && (*p_len == 0))
+   {
+      return RV_OK;
+   }
+   if((*p_len <= DWM_API_USR_DATA_LEN_MAX) && (RESP_DAT_VALUE_OFFSET + *p_len <= len))
+   {
+      memcpy(p_data, rsp+RESP_DAT_VALUE_OFFSET, *p_len);
+      return RV_OK;
+   }
+   return RV_ERR;
+}
@@ -0,0 +1,151 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_tlv.h
+ * @brief   DWM1001 host API, TLV codec of the requests and responses
+ *
+ *          The values of the TLV frames are little endian fixed layouts,
+ *          described by tables of fields. A table converts a value to or
+ *          from its host structure, dwm_api only builds the frames.
+ *
+ *          A response is a RET_VAL TLV followed by its data TLVs, so the
+ *          responses of several requests can be split at each RET_VAL.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DWM_TLV_H_
+#define _DWM_TLV_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "dwm_api.h"
+
+#define DWM_TLV_HDR_LEN          2     /* type + length */
+#define DWM_TLV_RET_VAL_LEN      3     /* RET_VAL TLV, leading each response */
+
+/**
+ * @brief field of a fixed layout
+ */
+typedef struct {
+   uint8_t  wire_len;   /* bytes in the frame, 1 to 8 */
+   uint8_t  host_size;  /* size of the host field, 1, 2, 4 or 8 */
+   uint8_t  stride;     /* host step between records, 0 unless a field of parallel arrays */
+   uint16_t offset;     /* offset of the host field in its structure */
+} dwm_tlv_field_t;
+
+/**
+ * @brief fixed layout, the fields in frame order
+ */
+typedef struct {
+   const dwm_tlv_field_t *fields;
+   uint8_t cnt;
+   uint8_t wire_len;    /* bytes of one record in the frame */
+} dwm_tlv_layout_t;
+
+#define DWM_TLV_HOST_SIZE(type, member)   sizeof(((type*)0)->member)
+
+/* field of a structure */
+#define DWM_TLV_FIELD(type, member, len)  \
+   { (len), DWM_TLV_HOST_SIZE(type, member), 0, offsetof(type, member) }
+
+/* field of a structure of arrays, record idx is element idx of the array */
+#define DWM_TLV_ARRAY_FIELD(type, member, len)  \
+   { (len), DWM_TLV_HOST_SIZE(type, member[0]), DWM_TLV_HOST_SIZE(type, member[0]), offsetof(type, member) }
+
+#define DWM_TLV_LAYOUT(fields, len)       { (fields), sizeof(fields)/sizeof((fields)[0]), (len) }
+
+extern const dwm_tlv_layout_t dwm_tlv_pos_layout;        /* dwm_pos_t */
+extern const dwm_tlv_layout_t dwm_tlv_an_dist_layout;    /* dwm_distance_t record, anchor node */
+extern const dwm_tlv_layout_t dwm_tlv_tag_dist_layout;   /* dwm_distance_t record, tag node */
+extern const dwm_tlv_layout_t dwm_tlv_anchor_elt_layout; /* dwm_anchor_list_elt_t, without seat */
+
+/**
+ * @brief reads a little endian value
+ *
+ * @param[in] buf, pointer to the value
+ * @param[in] len, value length in bytes, up to 8
+ *
+ * @return the value
+ */
+uint64_t dwm_tlv_get(const uint8_t* buf, uint8_t len);
+
+/**
+ * @brief writes a little endian value
+ *
+ * @param[out] buf, pointer to the value
+ * @param[in] value, value to write
+ * @param[in] len, value length in bytes, up to 8
+ *
+ * @return none
+ */
+void dwm_tlv_put(uint8_t* buf, uint64_t value, uint8_t len);
+
+/**
+ * @brief CRC-16/CCITT of the binary command frames, as crc16_ccitt() of the
+ *        firmware
+ *
+ * @param[in] crc, initial value, 0xFFFF, or the CRC of the previous bytes
+ * @param[in] buf, bytes
+ * @param[in] len, bytes count
+ *
+ * @return the CRC
+ */
+uint16_t dwm_tlv_crc16(uint16_t crc, const uint8_t* buf, uint16_t len);
+
+/**
+ * @brief decodes one record of a layout
+ *
+ * @param[in] buf, pointer to the record in the frame
+ * @param[in] len, bytes available from buf
+ * @param[in] layout, layout of the record
+ * @param[out] obj, host structure
+ * @param[in] idx, record index for the array fields
+ *
+ * @return bytes decoded, -1 if the record does not fit in len
+ */
+int dwm_tlv_decode(const uint8_t* buf, uint16_t len, const dwm_tlv_layout_t* layout, void* obj, uint8_t idx);
+
+/**
+ * @brief encodes one record of a layout
+ *
+ * @param[out] buf, pointer to the record in the frame
+ * @param[in] size, bytes available from buf
+ * @param[in] layout, layout of the record
+ * @param[in] obj, host structure
+ * @param[in] idx, record index for the array fields
+ *
+ * @return bytes encoded, -1 if the record does not fit in size
+ */
+int dwm_tlv_encode(uint8_t* buf, uint16_t size, const dwm_tlv_layout_t* layout, const void* obj, uint8_t idx);
+
+/**
+ * @brief length of the first response of a buffer: its RET_VAL and the
+ *        data TLVs up to the next RET_VAL
+ *
+ * @param[in] buf, pointer to the RET_VAL of the response
+ * @param[in] len, bytes available from buf
+ *
+ * @return response length, 0 if buf does not start with a complete response
+ */
+uint16_t dwm_tlv_rsp_len(const uint8_t* buf, uint16_t len);
+
+/**
+ * @brief response decoders, from the RET_VAL of the response
+ *
+ * @param[in] rsp, pointer to the response
+ * @param[in] len, response length
+ * @param[out] decoded values
+ *
+ * @return Error code
+ */
+int dwm_tlv_pos_decode(const uint8_t* rsp, uint16_t len, dwm_pos_t* p_pos);
+int dwm_tlv_loc_decode(const uint8_t* rsp, uint16_t len, dwm_loc_data_t* loc);
+int dwm_tlv_node_id_decode(const uint8_t* rsp, uint16_t len, uint64_t* p_node_id);
+int dwm_tlv_status_decode(const uint8_t* rsp, uint16_t len, dwm_status_t* p_status);
+int dwm_tlv_usr_data_decode(const uint8_t* rsp, uint16_t len, uint8_t* p_data, uint8_t* p_len);
+
+#endif //_DWM_TLV_H_
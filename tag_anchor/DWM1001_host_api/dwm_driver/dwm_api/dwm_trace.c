@@ -0,0 +1,361 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_trace.c
+ * @brief   DWM1001 host API, latency tracing of the blinks and locations
+ *
+ *          The open traces are a direct mapped table on a hash of the tag
+ *          and the sequence number, a new trace takes the slot of an older
+ *          one, counted as evicted if it was still live. The sequence
+ *          number of a blink wraps, a trace not stamped for
+ *          DWM_TRACE_LIVE_US starts again.
+ *
+ *          Bucket b of a histogram is b us below 32 us, then 8 buckets per
+ *          octave: the 3 bits below the top bit.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include "dwm_api.h"
+#include "dwm_clk.h"
+#include "dwm_trace.h"
+
+#define TRACE_LINEAR             32             /* buckets of 1 us */
+#define TRACE_SUB_BITS           3              /* buckets per octave, log2 */
+#define TRACE_TS_MASK            ((1ULL << DWM_CLK_TS_BITS) - 1)
+
+typedef struct {
+   bool used;
+   uint8_t mask;                                /* stages stamped */
+   uint64_t tag_id;
+   uint32_t seq;
+   uint64_t last_us;                            /* last stamp */
+   uint64_t t[DWM_TRACE_STAGE_CNT];
+} trace_entry_t;
+
+typedef struct {
+   uint32_t cnt;                                /* stamps */
+   uint32_t neg;                                /* steps before their earlier stage, clocks out of sync */
+   uint64_t max[2];                             /* step, total */
+   uint32_t hist[2][DWM_TRACE_BUCKET_CNT];
+} trace_stage_t;
+
+typedef struct {
+   bool seen;
+   uint64_t ts;                                 /* last, unwrapped */
+   double off_us;                               /* wall clock - anchor clock */
+   uint64_t upd_us;                             /* read of the last offset update */
+} trace_anchor_t;
+
+struct dwm_trace {
+   pthread_mutex_t m;
+   trace_entry_t open[DWM_TRACE_OPEN];
+   trace_stage_t st[DWM_TRACE_STAGE_CNT];
+   trace_anchor_t an[DWM_TRACE_ANCHOR_MAX];
+   uint32_t evicted;
+};
+
+static const char * const trace_names[DWM_TRACE_STAGE_CNT] = { "RX", "READ", "GROUP", "SOLVE", "PUB", "MERGE" };
+
+static int trace_bucket(uint64_t us)
+{
+   int msb, b;
+
+   if(us < TRACE_LINEAR)
+   {
+      return (int)us;
+   }
+   msb = 63 - __builtin_clzll(us);
+   b = TRACE_LINEAR + ((msb - 5) << TRACE_SUB_BITS) + (int)((us >> (msb - TRACE_SUB_BITS)) & 7);
+   return (b < DWM_TRACE_BUCKET_CNT) ? b : DWM_TRACE_BUCKET_CNT - 1;
+}
+
+/**
+ * @brief largest value of a bucket, us
+ */
+static uint64_t trace_bucket_max(int b)
+{
+   int msb, sub;
+
+   if(b < TRACE_LINEAR)
+   {
+      return b;
+   }
+   msb = (b - TRACE_LINEAR) / 8 + 5;
+   sub = (b - TRACE_LINEAR) % 8;
+   return ((uint64_t)(8 + sub) << (msb - TRACE_SUB_BITS)) + (1ULL << (msb - TRACE_SUB_BITS)) - 1;
+}
+
+static void trace_add(trace_stage_t* st, int kind, int64_t us)
+{
+   if(us < 0)
+   {
+      st->neg++;
+      us = 0;
+   }
+   st->hist[kind][trace_bucket(us)]++;
+   if((uint64_t)us > st->max[kind])
+   {
+      st->max[kind] = us;
+   }
+}
+
+/**
+ * @brief entry of a trace, a new one replaces the slot, mutex held
+ */
+static trace_entry_t* trace_entry(dwm_trace_t* tr, uint64_t tag_id, uint32_t seq, uint64_t t_us)
+{
+   trace_entry_t *e;
+   bool live;
+
+   e = &tr->open[((tag_id ^ ((uint64_t)seq << 40) ^ seq) * 0x9E3779B97F4A7C15ULL) >> 52 & (DWM_TRACE_OPEN - 1)];
+   live = e->used && ((int64_t)(t_us - e->last_us) < DWM_TRACE_LIVE_US);
+   if(!live || (e->tag_id != tag_id) || (e->seq != seq))
+   {
+      if(live)
+      {
+         tr->evicted++;
+      }
+      e->used = true;
+      e->tag_id = tag_id;
+      e->seq = seq;
+      e->mask = 0;
+   }
+   return e;
+}
+
+/**
+ * @brief stamps a stage of an entry, mutex held
+ */
+static void trace_stamp(dwm_trace_t* tr, trace_entry_t* e, int stage, uint64_t t_us)
+{
+   int i, prev = -1, first = -1;
+
+   if(e->mask & (1U << stage))
+   {
+      return;
+   }
+   for(i = 0; i < stage; i++)
+   {
+      if(e->mask & (1U << i))
+      {
+         first = (first < 0) ? i : first;
+         prev = i;
+      }
+   }
+   e->mask |= 1U << stage;
+   e->t[stage] = t_us;
+   e->last_us = t_us;
+   tr->st[stage].cnt++;
+   if(prev >= 0)
+   {
+      trace_add(&tr->st[stage], 0, (int64_t)(t_us - e->t[prev]));
+      trace_add(&tr->st[stage], 1, (int64_t)(t_us - e->t[first]));
+   }
+}
+
+/**
+ * @brief upper bound of the bucket of the quantile, at most the maximum
+ */
+static uint64_t trace_quantile(const uint32_t* hist, uint64_t max, double q)
+{
+   uint64_t n = 0, c = 0, target;
+   int b;
+
+   for(b = 0; b < DWM_TRACE_BUCKET_CNT; b++)
+   {
+      n += hist[b];
+   }
+   if(n == 0)
+   {
+      return 0;
+   }
+   target = (uint64_t)(q * n + 0.999999);
+   target = (target == 0) ? 1 : target;
+   for(b = 0; b < DWM_TRACE_BUCKET_CNT; b++)
+   {
+      c += hist[b];
+      if(c >= target)
+      {
+         break;
+      }
+   }
+   return (trace_bucket_max(b) < max) ? trace_bucket_max(b) : max;
+}
+
+int dwm_trace_init(dwm_trace_t** tr)
+{
+   dwm_trace_t *p;
+
+   p = calloc(1, sizeof(dwm_trace_t));
+   if(p == NULL)
+   {
+      return RV_ERR;
+   }
+   pthread_mutex_init(&p->m, NULL);
+   *tr = p;
+   return RV_OK;
+}
+
+void dwm_trace_deinit(dwm_trace_t* tr)
+{
+   pthread_mutex_destroy(&tr->m);
+   free(tr);
+}
+
+uint64_t dwm_trace_now_us(void)
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return (uint64_t)tv.tv_sec*1000000 + tv.tv_usec;
+}
+
+void dwm_trace_stamp(dwm_trace_t* tr, int stage, uint64_t tag_id, uint32_t seq, uint64_t t_us)
+{
+   if((stage < 0) || (stage >= DWM_TRACE_STAGE_CNT))
+   {
+      return;
+   }
+   pthread_mutex_lock(&tr->m);
+   trace_stamp(tr, trace_entry(tr, tag_id, seq, t_us), stage, t_us);
+   pthread_mutex_unlock(&tr->m);
+}
+
+void dwm_trace_stamp_from(dwm_trace_t* tr, int stage, uint64_t tag_id, uint32_t seq, int prev_stage, uint64_t prev_us,
+      uint64_t t_us)
+{
+   trace_entry_t *e;
+
+   if((stage < 0) || (stage >= DWM_TRACE_STAGE_CNT) || (prev_stage < 0) || (prev_stage >= stage))
+   {
+      return;
+   }
+   pthread_mutex_lock(&tr->m);
+   e = trace_entry(tr, tag_id, seq, t_us);
+   if(!(e->mask & (1U << prev_stage)))
+   {
+      e->mask |= 1U << prev_stage;
+      e->t[prev_stage] = prev_us;
+      e->last_us = t_us;
+   }
+   trace_stamp(tr, e, stage, t_us);
+   pthread_mutex_unlock(&tr->m);
+}
+
+uint64_t dwm_trace_anchor_rx(dwm_trace_t* tr, int anchor, uint64_t ts, uint64_t read_us)
+{
+   trace_anchor_t *an;
+   int64_t delta;
+   double ts_us, off;
+
+   if((anchor < 0) || (anchor >= DWM_TRACE_ANCHOR_MAX))
+   {
+      return read_us;
+   }
+   pthread_mutex_lock(&tr->m);
+   an = &tr->an[anchor];
+   ts &= TRACE_TS_MASK;
+   if(!an->seen)
+   {
+      an->ts = ts;
+   }
+   else
+   {
+      // as dwm_clk_unwrap(), a record slightly older is unwrapped backwards
+      delta = (int64_t)((ts - an->ts) & TRACE_TS_MASK);
+      if(delta >= (int64_t)(1ULL << (DWM_CLK_TS_BITS - 1)))
+      {
+         delta -= (int64_t)(1ULL << DWM_CLK_TS_BITS);
+      }
+      ts = an->ts + delta;
+      if(delta > 0)
+      {
+         an->ts = ts;
+      }
+   }
+   ts_us = ts / DWM_CLK_TICK_HZ * 1e6;
+   off = read_us - ts_us;
+   if(an->seen)
+   {
+      an->off_us += DWM_TRACE_RELAX_PPM * 1e-6 * (double)(int64_t)(read_us - an->upd_us);
+      if(off > an->off_us)
+      {
+         off = an->off_us;
+      }
+   }
+   an->seen = true;
+   an->off_us = off;
+   an->upd_us = read_us;
+   pthread_mutex_unlock(&tr->m);
+   return (uint64_t)(ts_us + off);
+}
+
+uint64_t dwm_trace_quantile(dwm_trace_t* tr, int stage, double q, bool total)
+{
+   uint64_t us;
+
+   if((stage < 0) || (stage >= DWM_TRACE_STAGE_CNT))
+   {
+      return 0;
+   }
+   pthread_mutex_lock(&tr->m);
+   us = trace_quantile(tr->st[stage].hist[total ? 1 : 0], tr->st[stage].max[total ? 1 : 0], q);
+   pthread_mutex_unlock(&tr->m);
+   return us;
+}
+
+int dwm_trace_dump(dwm_trace_t* tr, const char* path)
+{
+   static const char * const kinds[2] = { "step", "total" };
+   char tmp[256];
+   trace_stage_t *st;
+   FILE *f;
+   int s, k, b, n;
+
+   snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+   f = fopen(tmp, "w");
+   if(f == NULL)
+   {
+      return RV_ERR;
+   }
+   pthread_mutex_lock(&tr->m);
+   fprintf(f, "{\"time_us\":%llu,\"evicted\":%u,\"stages\":{", (unsigned long long)dwm_trace_now_us(), tr->evicted);
+   for(s = 0; s < DWM_TRACE_STAGE_CNT; s++)
+   {
+      st = &tr->st[s];
+      fprintf(f, "%s\n\"%s\":{\"cnt\":%u,\"neg\":%u", s ? "," : "", trace_names[s], st->cnt, st->neg);
+      for(k = 0; k < 2; k++)
+      {
+         fprintf(f, ",\"%s\":{\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"max\":%llu,\"hist\":[", kinds[k],
+               (unsigned long long)trace_quantile(st->hist[k], st->max[k], 0.5),
+               (unsigned long long)trace_quantile(st->hist[k], st->max[k], 0.9),
+               (unsigned long long)trace_quantile(st->hist[k], st->max[k], 0.99), (unsigned long long)st->max[k]);
+         // [largest us of the bucket, count], the empty buckets left out
+         for(b = 0, n = 0; b < DWM_TRACE_BUCKET_CNT; b++)
+         {
+            if(st->hist[k][b] != 0)
+            {
+               fprintf(f, "%s[%llu,%u]", n++ ? "," : "", (unsigned long long)trace_bucket_max(b), st->hist[k][b]);
+            }
+         }
+         fprintf(f, "]}");
+      }
+      fprintf(f, "}");
+   }
+   fprintf(f, "}}\n");
+   pthread_mutex_unlock(&tr->m);
+   if((fclose(f) != 0) || (rename(tmp, path) != 0))
+   {
+      return RV_ERR;
+   }
+   return RV_OK;
+}
@@ -0,0 +1,337 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_track.c
+ * @brief   DWM1001 host API, batched TDoA EKF tracker
+ *
+ *          The pool is one array of rows of cap doubles, the rows of a tag
+ *          (state, covariance, measurements) come first so a removal moves
+ *          one column of them, the scratch rows follow.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "dwm_api.h"
+#include "dwm_track.h"
+
+#define DWM_TRACK_DIST_MIN       1e-9     /* m, tag on an anchor */
+
+/* rows of a tag: state, covariance, range differences, velocity, w, wv */
+#define DWM_TRACK_ROWS_TAG(acnt) ((uint32_t)(DWM_TRACK_STATE_NUM + DWM_TRACK_COV_NUM + (acnt) + 4))
+/* then the scratch rows: h, hx, hy, sp */
+#define DWM_TRACK_ROWS(acnt)     (DWM_TRACK_ROWS_TAG(acnt) + 3*(acnt) + 2)
+
+int dwm_track_init(dwm_track_t* t, const dwm_tdoa_t* an, const dwm_track_noise_t* n, uint32_t cap)
+{
+   double *row;
+   uint32_t i, acnt = an->cnt;
+
+   if((an->dim != 2) || (cap == 0))
+   {
+      return RV_ERR;
+   }
+   memset(t, 0, sizeof(dwm_track_t));
+   t->pool = calloc(cap, DWM_TRACK_ROWS(acnt) * sizeof(double) + 3 * sizeof(uint32_t));
+   if(t->pool == NULL)
+   {
+      return RV_ERR;
+   }
+   t->an = *an;
+   t->n = *n;
+   t->cap = cap;
+
+   row = t->pool;
+   for(i = 0; i < DWM_TRACK_STATE_NUM; i++, row += cap)
+   {
+      t->s[i] = row;
+   }
+   for(i = 0; i < DWM_TRACK_COV_NUM; i++, row += cap)
+   {
+      t->p[i] = row;
+   }
+   t->z = row;       row += acnt * cap;
+   t->zv[0] = row;   row += cap;
+   t->zv[1] = row;   row += cap;
+   t->w = row;       row += cap;
+   t->wv = row;      row += cap;
+   t->h = row;       row += acnt * cap;
+   t->hx = row;      row += acnt * cap;
+   t->hy = row;      row += acnt * cap;
+   t->sp[0] = row;   row += cap;
+   t->sp[1] = row;   row += cap;
+   t->slot_handle = (uint32_t*)row;
+   t->handle_slot = t->slot_handle + cap;
+   t->free_handle = t->handle_slot + cap;
+   for(i = 0; i < cap; i++)
+   {
+      t->handle_slot[i] = DWM_TRACK_HANDLE_NONE;
+      t->free_handle[i] = cap - 1 - i;
+   }
+   t->free_cnt = cap;
+   return RV_OK;
+}
+
+void dwm_track_free(dwm_track_t* t)
+{
+   free(t->pool);
+   t->pool = NULL;
+   t->cap = t->cnt = t->free_cnt = 0;
+}
+
+int dwm_track_add(dwm_track_t* t, const double* pos, uint32_t* handle)
+{
+   double *pool = t->pool;
+   uint32_t r, s = t->cnt;
+
+   if(t->free_cnt == 0)
+   {
+      return RV_ERR;
+   }
+   *handle = t->free_handle[--t->free_cnt];
+   t->handle_slot[*handle] = s;
+   t->slot_handle[s] = *handle;
+   t->cnt++;
+
+   for(r = 0; r < DWM_TRACK_ROWS_TAG(t->an.cnt); r++)
+   {
+      pool[r*t->cap + s] = 0;
+   }
+   t->s[0][s] = pos[0];
+   t->s[1][s] = pos[1];
+   t->p[0][s] = t->p[4][s] = t->n.p0_pos;
+   t->p[7][s] = t->p[9][s] = t->n.p0_vel;
+   return RV_OK;
+}
+
+int dwm_track_remove(dwm_track_t* t, uint32_t handle)
+{
+   double *pool = t->pool;
+   uint32_t r, s, last;
+
+   if((handle >= t->cap) || (t->handle_slot[handle] == DWM_TRACK_HANDLE_NONE))
+   {
+      return RV_ERR;
+   }
+   s = t->handle_slot[handle];
+   last = --t->cnt;
+   if(s != last)
+   {
+      for(r = 0; r < DWM_TRACK_ROWS_TAG(t->an.cnt); r++)
+      {
+         pool[r*t->cap + s] = pool[r*t->cap + last];
+      }
+      t->slot_handle[s] = t->slot_handle[last];
+      t->handle_slot[t->slot_handle[s]] = s;
+   }
+   t->handle_slot[handle] = DWM_TRACK_HANDLE_NONE;
+   t->free_handle[t->free_cnt++] = handle;
+   return RV_OK;
+}
+
+int dwm_track_meas(dwm_track_t* t, uint32_t handle, const double* rd, const double* vel)
+{
+   uint32_t s;
+   int k;
+
+   if((handle >= t->cap) || (t->handle_slot[handle] == DWM_TRACK_HANDLE_NONE))
+   {
+      return RV_ERR;
+   }
+   s = t->handle_slot[handle];
+   for(k = 1; k < t->an.cnt; k++)
+   {
+      t->z[k*t->cap + s] = rd[k];
+   }
+   t->w[s] = 1;
+   if(vel != NULL)
+   {
+      t->zv[0][s] = vel[0];
+      t->zv[1][s] = vel[1];
+      t->wv[s] = 1;
+   }
+   return RV_OK;
+}
+
+/**
+ * @brief scalar update of all the slots with the measurement row hx, hy,
+ *        0, 0, innovation e and weight w
+ */
+static void dwm_track_upd_pos(dwm_track_t* t, const double* restrict hx, const double* restrict hy,
+      const double* restrict e, const double* restrict w, double r)
+{
+   double * restrict x = t->s[0], * restrict y = t->s[1], * restrict vx = t->s[2], * restrict vy = t->s[3];
+   double * restrict p00 = t->p[0], * restrict p01 = t->p[1], * restrict p02 = t->p[2], * restrict p03 = t->p[3];
+   double * restrict p11 = t->p[4], * restrict p12 = t->p[5], * restrict p13 = t->p[6];
+   double * restrict p22 = t->p[7], * restrict p23 = t->p[8], * restrict p33 = t->p[9];
+   double a0, a1, a2, a3, g, ge;
+   uint32_t i, cnt = t->cnt;
+
+   for(i = 0; i < cnt; i++)
+   {
+      // a = P H', S = H a + r, x += a e / S, P -= a a' / S
+      a0 = p00[i]*hx[i] + p01[i]*hy[i];
+      a1 = p01[i]*hx[i] + p11[i]*hy[i];
+      a2 = p02[i]*hx[i] + p12[i]*hy[i];
+      a3 = p03[i]*hx[i] + p13[i]*hy[i];
+      g = w[i] / (hx[i]*a0 + hy[i]*a1 + r);
+      ge = g * e[i];
+      x[i] += a0 * ge;
+      y[i] += a1 * ge;
+      vx[i] += a2 * ge;
+      vy[i] += a3 * ge;
+      p00[i] -= a0*a0*g;  p01[i] -= a0*a1*g;  p02[i] -= a0*a2*g;  p03[i] -= a0*a3*g;
+      p11[i] -= a1*a1*g;  p12[i] -= a1*a2*g;  p13[i] -= a1*a3*g;
+      p22[i] -= a2*a2*g;  p23[i] -= a2*a3*g;
+      p33[i] -= a3*a3*g;
+   }
+}
+
+/**
+ * @brief scalar update of all the slots with the velocity component c
+ */
+static void dwm_track_upd_vel(dwm_track_t* t, int c)
+{
+   double * restrict x = t->s[0], * restrict y = t->s[1], * restrict vx = t->s[2], * restrict vy = t->s[3];
+   double * restrict p00 = t->p[0], * restrict p01 = t->p[1], * restrict p02 = t->p[2], * restrict p03 = t->p[3];
+   double * restrict p11 = t->p[4], * restrict p12 = t->p[5], * restrict p13 = t->p[6];
+   double * restrict p22 = t->p[7], * restrict p23 = t->p[8], * restrict p33 = t->p[9];
+   const double * restrict z = t->zv[c], * restrict w = t->wv;
+   double a0, a1, a2, a3, g, ge, r = t->n.r_vel;
+   uint32_t i, cnt = t->cnt;
+
+   for(i = 0; i < cnt; i++)
+   {
+      // H is the unit row of vx or vy, a is that column of P
+      a0 = c ? p03[i] : p02[i];
+      a1 = c ? p13[i] : p12[i];
+      a2 = c ? p23[i] : p22[i];
+      a3 = c ? p33[i] : p23[i];
+      g = w[i] / ((c ? a3 : a2) + r);
+      ge = g * (z[i] - (c ? vy[i] : vx[i]));
+      x[i] += a0 * ge;
+      y[i] += a1 * ge;
+      vx[i] += a2 * ge;
+      vy[i] += a3 * ge;
+      p00[i] -= a0*a0*g;  p01[i] -= a0*a1*g;  p02[i] -= a0*a2*g;  p03[i] -= a0*a3*g;
+      p11[i] -= a1*a1*g;  p12[i] -= a1*a2*g;  p13[i] -= a1*a3*g;
+      p22[i] -= a2*a2*g;  p23[i] -= a2*a3*g;
+      p33[i] -= a3*a3*g;
+   }
+}
+
+void dwm_track_step(dwm_track_t* t, double dt)
+{
+   double * restrict x = t->s[0], * restrict y = t->s[1], * restrict vx = t->s[2], * restrict vy = t->s[3];
+   double * restrict p00 = t->p[0], * restrict p01 = t->p[1], * restrict p02 = t->p[2], * restrict p03 = t->p[3];
+   double * restrict p11 = t->p[4], * restrict p12 = t->p[5], * restrict p13 = t->p[6];
+   double * restrict p22 = t->p[7], * restrict p23 = t->p[8], * restrict p33 = t->p[9];
+   double * restrict h0 = t->h, * restrict ux0 = t->hx, * restrict uy0 = t->hy;
+   double * restrict xp = t->sp[0], * restrict yp = t->sp[1];
+   double qp = t->n.q_pos * dt, qv = t->n.q_vel * dt, dxa, dya, ri;
+   uint32_t i, cnt = t->cnt, cap = t->cap;
+   int k, acnt = t->an.cnt;
+   double ax, ay, *hk, *hxk, *hyk, *zk;
+
+   // predict, F is the constant velocity model
+   for(i = 0; i < cnt; i++)
+   {
+      p00[i] += dt * (2*p02[i] + dt*p22[i]) + qp;
+      p01[i] += dt * (p03[i] + p12[i] + dt*p23[i]);
+      p11[i] += dt * (2*p13[i] + dt*p33[i]) + qp;
+      p02[i] += dt * p22[i];
+      p03[i] += dt * p23[i];
+      p12[i] += dt * p23[i];
+      p13[i] += dt * p33[i];
+      p22[i] += qv;
+      p33[i] += qv;
+      x[i] += vx[i] * dt;
+      y[i] += vy[i] * dt;
+      xp[i] = x[i];
+      yp[i] = y[i];
+   }
+
+   // hyperbolas and their gradient at the prediction, row 0 holds r_0 and its gradient
+   ax = t->an.a[0][0];
+   ay = t->an.a[0][1];
+   for(i = 0; i < cnt; i++)
+   {
+      dxa = x[i] - ax;
+      dya = y[i] - ay;
+      h0[i] = fmax(sqrt(dxa*dxa + dya*dya), DWM_TRACK_DIST_MIN);
+      ux0[i] = dxa / h0[i];
+      uy0[i] = dya / h0[i];
+   }
+   for(k = 1; k < acnt; k++)
+   {
+      hk = t->h + k*cap;
+      hxk = t->hx + k*cap;
+      hyk = t->hy + k*cap;
+      ax = t->an.a[k][0];
+      ay = t->an.a[k][1];
+      for(i = 0; i < cnt; i++)
+      {
+         dxa = x[i] - ax;
+         dya = y[i] - ay;
+         ri = fmax(sqrt(dxa*dxa + dya*dya), DWM_TRACK_DIST_MIN);
+         hk[i] = ri - h0[i];
+         hxk[i] = dxa / ri - ux0[i];
+         hyk[i] = dya / ri - uy0[i];
+      }
+   }
+
+   // sequential updates, the innovation is linearised at the prediction
+   for(k = 1; k < acnt; k++)
+   {
+      hk = t->h + k*cap;
+      hxk = t->hx + k*cap;
+      hyk = t->hy + k*cap;
+      zk = t->z + k*cap;
+      for(i = 0; i < cnt; i++)
+      {
+         // the innovation overwrites h, it is not used after
+         hk[i] = zk[i] - hk[i] - hxk[i]*(x[i] - xp[i]) - hyk[i]*(y[i] - yp[i]);
+      }
+      dwm_track_upd_pos(t, hxk, hyk, hk, t->w, t->n.r_rd);
+   }
+   dwm_track_upd_vel(t, 0);
+   dwm_track_upd_vel(t, 1);
+
+   memset(t->w, 0, cnt * sizeof(double));
+   memset(t->wv, 0, cnt * sizeof(double));
+}
+
+int dwm_track_get(const dwm_track_t* t, uint32_t handle, double* state)
+{
+   uint32_t s, i;
+
+   if((handle >= t->cap) || (t->handle_slot[handle] == DWM_TRACK_HANDLE_NONE))
+   {
+      return RV_ERR;
+   }
+   s = t->handle_slot[handle];
+   for(i = 0; i < DWM_TRACK_STATE_NUM; i++)
+   {
+      state[i] = t->s[i][s];
+   }
+   return RV_OK;
+}
+
+int dwm_track_predict(const dwm_track_t* t, uint32_t handle, double dt, double* pos)
+{
+   uint32_t s;
+
+   if((handle >= t->cap) || (t->handle_slot[handle] == DWM_TRACK_HANDLE_NONE))
+   {
+      return RV_ERR;
+   }
+   s = t->handle_slot[handle];
+   pos[0] = t->s[0][s] + t->s[2][s] * dt;
+   pos[1] = t->s[1][s] + t->s[3][s] * dt;
+   return RV_OK;
+}
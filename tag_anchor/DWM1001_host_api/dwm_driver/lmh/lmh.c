@@ -18,6 +18,148 @@
 #include "lmh.h"
 #include "hal.h"
 #include "hal_log.h"
+#include "hal_gpio.h"
+#include "hal_stat.h"
+
+// request of the calling thread, for the latency of its command
+static __thread uint64_t lmh_tx_ns = 0;
+static __thread uint8_t lmh_tx_type = 0;
+
+// interfaces built in, indexed by HAL_IF_Get() 
+typedef struct {
+   const char* name;
+   void (*init)(void);
+   void (*deinit)(void);
+   void (*set_timeout)(int timeout);
+   int  (*tx)(uint8_t* data, uint8_t* length);
+   int  (*wait_for_rx)(uint8_t* data, uint16_t* length, uint16_t exp_length);
+} lmh_if_t;
+
+static const lmh_if_t lmh_if[HAL_IF_NUM] = {
+#if (INTERFACE_NUMBER == 0) || (INTERFACE_NUMBER == 3)
+   [HAL_IF_UART] = {"UART", LMH_UARTRX_Init, LMH_UARTRX_DeInit, LMH_UARTRX_SetTimeout,
+                    HAL_UART_Tx, LMH_UARTRX_WaitForRx},
+#endif
+#if (INTERFACE_NUMBER == 1) || (INTERFACE_NUMBER == 3)
+   [HAL_IF_SPI] = {"SPI", LMH_SPIRX_Init, LMH_SPIRX_DeInit, LMH_SPIRX_SetTimeout,
+                   HAL_SPI_Tx, LMH_SPIRX_WaitForRx},
+#endif
+#if (INTERFACE_NUMBER == 2) || (INTERFACE_NUMBER == 3)
+   [HAL_IF_SPI_DRDY] = {"SPI_DRDY", LMH_SPIRX_DRDY_Init, LMH_SPIRX_DRDY_DeInit, LMH_SPIRX_DRDY_SetTimeout,
+                        HAL_SPI_Tx, LMH_SPIRX_DRDY_WaitForRx},
+#endif
+};
+
+#if INTERFACE_NUMBER == 3
+#define LMH_PROBE_CNT            4     // status requests timed per interface
+#define LMH_PROBE_TIMEOUT        100   // response timeout while probing, ms
+#define LMH_FALLBACK_ERR_CNT     3     // link errors in a row before probing again
+
+static const int lmh_probe_order[] = {HAL_IF_SPI_DRDY, HAL_IF_SPI, HAL_IF_UART};
+static int lmh_err_cnt[HAL_SPI_DEV_NUM] = {0, 0};
+static void (*lmh_int_cb[HAL_SPI_DEV_NUM])(void) = {NULL, NULL};
+
+/** 
+ * @brief de-initializes an interface of the current device and closes its 
+ *       HAL device, so that the next init opens it again
+ */
+static void LMH_IfClose(int interface)
+{
+   lmh_if[interface].deinit();
+   if(interface == HAL_IF_UART)
+   {
+      HAL_UART_DeInit();
+   }
+   else
+   {
+      HAL_SPI_DeInit();
+   }
+}
+
+/** 
+ * @brief mean round trip of LMH_PROBE_CNT status requests over an interface
+ *       of the current device, the interface is left initialized
+ *
+ * @return round trip in ns, UINT64_MAX if a request failed
+ */
+static uint64_t LMH_ProbeIf(int interface)
+{
+   uint8_t tx_data[DWM1001_TLV_MAX_SIZE], tx_len;
+   uint8_t rx_data[DWM1001_TLV_MAX_SIZE];
+   uint16_t rx_len;
+   uint64_t start, sum = 0;
+   int i;
+   
+   if(interface == HAL_IF_SPI_DRDY)
+   {
+      // the data ready setup of the init is an SPI request, not to wait 1 s for it
+      LMH_SPIRX_Init();
+      LMH_SPIRX_SetTimeout(LMH_PROBE_TIMEOUT);
+   }
+   lmh_if[interface].init();
+   lmh_if[interface].set_timeout(LMH_PROBE_TIMEOUT);
+   for(i = 0; i < LMH_PROBE_CNT; i++)
+   {
+      tx_len = 0;
+      tx_data[tx_len++] = DWM1001_TLV_TYPE_CMD_STATUS_GET;
+      tx_data[tx_len++] = 0;
+      start = HAL_GetTimeNs();
+      if((lmh_if[interface].tx(tx_data, &tx_len) != HAL_OK)
+         || (lmh_if[interface].wait_for_rx(rx_data, &rx_len, 7) != LMH_OK)
+         || (rx_data[0] != DWM1001_TLV_TYPE_RET_VAL) || (rx_data[2] != RV_OK))
+      {
+         return UINT64_MAX;
+      }
+      sum += HAL_GetTimeNs() - start;
+   }
+   return sum/LMH_PROBE_CNT;
+}
+
+/** 
+ * @brief probes the interfaces of the current device and initializes the 
+ *       one with the lowest round trip, SPI if none answers 
+ */
+static void LMH_Probe(void)
+{
+   int dev = HAL_DevNum(), best = HAL_IF_SPI, i;
+   uint64_t ns, best_ns = UINT64_MAX;
+   
+   for(i = 0; i < (int)(sizeof(lmh_probe_order)/sizeof(lmh_probe_order[0])); i++)
+   {
+      if(HAL_IF_Set(dev, lmh_probe_order[i]) != HAL_OK)
+      {
+         continue;   // no UART on this device
+      }
+      ns = LMH_ProbeIf(lmh_probe_order[i]);
+      LMH_IfClose(lmh_probe_order[i]);
+      if(ns == UINT64_MAX)
+      {
+         HAL_Log("lmh:     probe dev%d: %s no response\n", dev, lmh_if[lmh_probe_order[i]].name);
+         continue;
+      }
+      HAL_Log("lmh:     probe dev%d: %s %llu us\n", dev, lmh_if[lmh_probe_order[i]].name, 
+         (unsigned long long)(ns/1000));
+      if(ns < best_ns)
+      {
+         best_ns = ns;
+         best = lmh_probe_order[i];
+      }
+   }
+   if(best_ns == UINT64_MAX)
+   {
+      HAL_LogErr("lmh: *** ERROR *** probe dev%d: no interface answers, using SPI\n", dev);
+   }
+   
+   HAL_IF_Set(dev, best);
+   HAL_Log("lmh:     %s Init(): dev%d...\n", lmh_if[best].name, dev);  
+   lmh_if[best].init(); 
+   lmh_err_cnt[dev] = 0;
+   if(lmh_int_cb[dev] != NULL)
+   {
+      LMH_SetIntCb(lmh_int_cb[dev]);
+   }
+}
+#endif
 
 /** 
  * @brief initializes the LMH utilities over defined interface
@@ -28,15 +170,11 @@
  */
 void LMH_Init(void)
 {
-#if INTERFACE_NUMBER == 0
-   HAL_Log("lmh:     LMH_UARTRX_Init()...\n");  
-   LMH_UARTRX_Init();
-#elif INTERFACE_NUMBER == 1
-   HAL_Log("lmh:     LMH_SPIRX_Init(): SPI dev%d...\n", HAL_SPI_Which());  
-   LMH_SPIRX_Init();
-#elif INTERFACE_NUMBER == 2
-   HAL_Log("lmh:     LMH_SPIRX_DRDY_Init(): SPI dev%d...\n", HAL_SPI_Which());  
-   LMH_SPIRX_DRDY_Init();
+#if INTERFACE_NUMBER == 3
+   LMH_Probe();
+#else
+   HAL_Log("lmh:     %s Init(): dev%d...\n", lmh_if[INTERFACE_NUMBER].name, HAL_DevNum());  
+   lmh_if[INTERFACE_NUMBER].init();
 #endif
 }
 
@@ -49,15 +187,12 @@ void LMH_Init(void)
  */
 void LMH_DeInit(void)
 {
-#if INTERFACE_NUMBER == 0
-   HAL_Log("lmh:     LMH_UARTRX_DeInit()...\n");  
-   LMH_UARTRX_DeInit();
-#elif INTERFACE_NUMBER == 1
-   HAL_Log("lmh:     LMH_SPIRX_DeInit(): SPI dev%d...\n", HAL_SPI_Which());  
-   LMH_SPIRX_DeInit();
-#elif INTERFACE_NUMBER == 2
-   HAL_Log("lmh:     LMH_SPIRX_DRDY_DeInit(): SPI dev%d...\n", HAL_SPI_Which());  
-   LMH_SPIRX_DRDY_DeInit();
+   int interface = HAL_IF_Get(HAL_DevNum());
+   HAL_Log("lmh:     %s DeInit(): dev%d...\n", lmh_if[interface].name, HAL_DevNum());  
+#if INTERFACE_NUMBER == 3
+   LMH_IfClose(interface);
+#else
+   lmh_if[interface].deinit();
 #endif
 }
 
@@ -71,7 +206,15 @@ void LMH_DeInit(void)
  */
 int LMH_Tx(uint8_t* data, uint8_t* length)
 {
-   return HAL_IF_Tx(data, length);
+   int ret;
+   uint64_t start = HAL_GetTimeNs();
+   
+   lmh_tx_type = data[0];
+   ret = lmh_if[HAL_IF_Get(HAL_DevNum())].tx(data, length);
+   lmh_tx_ns = HAL_GetTimeNs();
+   HAL_STAT_ADD(HAL_STAT_TX, lmh_tx_ns - start);
+   lmh_tx_ns = start;
+   return ret;
 }
 
 /** 
@@ -92,13 +235,29 @@ int LMH_Tx(uint8_t* data, uint8_t* length)
  */
 int LMH_WaitForRx(uint8_t* data, uint16_t* length, uint16_t exp_length)
 {
-#if INTERFACE_NUMBER == 0
-   return LMH_UARTRX_WaitForRx(data, length, exp_length);
-#elif INTERFACE_NUMBER == 1
-   return LMH_SPIRX_WaitForRx(data, length, exp_length);
-#elif INTERFACE_NUMBER == 2
-   return LMH_SPIRX_DRDY_WaitForRx(data, length, exp_length);
+   int dev = HAL_DevNum();
+   int ret = lmh_if[HAL_IF_Get(dev)].wait_for_rx(data, length, exp_length);
+#if INTERFACE_NUMBER == 3
+   // a module error is still an answer, a timeout or a garbled answer is not
+   if((ret == LMH_OK) && (data[0] == DWM1001_TLV_TYPE_RET_VAL))
+   {
+      lmh_err_cnt[dev] = 0;
+   }
+   else if(++lmh_err_cnt[dev] >= LMH_FALLBACK_ERR_CNT)
+   {
+      HAL_LogErr("lmh: *** ERROR *** dev%d: %d link errors over %s, probing again\n", dev, 
+         lmh_err_cnt[dev], lmh_if[HAL_IF_Get(dev)].name);
+      LMH_IfClose(HAL_IF_Get(dev));
+      LMH_Probe();
+   }
 #endif
+   // a batch is counted as its first command
+   if(lmh_tx_ns != 0)
+   {
+      HAL_STAT_ADD(HAL_STAT_CMD_ID(lmh_tx_type), HAL_GetTimeNs() - lmh_tx_ns);
+      lmh_tx_ns = 0;
+   }
+   return ret;
 }
 
 /**
@@ -112,12 +271,12 @@ int LMH_CheckRetVal(uint8_t* ret_val)
 {
    if(ret_val[0] != DWM1001_TLV_TYPE_RET_VAL)
    {
-      HAL_Log("lmh: *** ERROR *** %s: RET_VAL type wrong: %d\n", HAL_IF_STR, ret_val[0]);    
+      HAL_LogErr("lmh: *** ERROR *** %s: RET_VAL type wrong: %d\n", HAL_IF_STR, ret_val[0]);    
       return LMH_ERR;
    }
    if(ret_val[1] != 1)
    {
-      HAL_Log("lmh: *** ERROR *** %s: RET_VAL length wrong: %d\n", HAL_IF_STR, ret_val[1]);    
+      HAL_LogErr("lmh: *** ERROR *** %s: RET_VAL length wrong: %d\n", HAL_IF_STR, ret_val[1]);    
       return LMH_ERR;
    }
    
@@ -127,7 +286,7 @@ int LMH_CheckRetVal(uint8_t* ret_val)
    }   
    else
    {
-      HAL_Log("lmh: *** ERROR *** %s: DWM1001_RV_ERR: %d\n", HAL_IF_STR, ret_val[2]);    
+      HAL_LogErr("lmh: *** ERROR *** %s: DWM1001_RV_ERR: %d\n", HAL_IF_STR, ret_val[2]);    
       return LMH_ERR;
    }
 }
@@ -157,7 +316,34 @@ int LMH_CheckGPIOIdx(dwm_gpio_idx_t idx)
    }
 }
 
-
-
-
-
+/** 
+ * @brief set the callback of the module interrupt pin of the current device, 
+ *       called from the GPIO interrupt thread on each rising edge. 
+ *       With the DRDY interface the pin also signals the SPI responses, the 
+ *       callback is then chained after the DRDY one. 
+ *
+ * @param [in] cb: callback, NULL to remove it
+ *
+ * @return Error code
+ */
+int LMH_SetIntCb(void (*cb)(void))
+{
+   int dev = HAL_DevNum();
+   int pin = (dev == 0) ? HAL_GPIO_DRDY : HAL_GPIO_DRDY1;
+#if INTERFACE_NUMBER == 3
+   // set again by the probe, when the interface changes
+   lmh_int_cb[dev] = cb;
+#endif
+#if (INTERFACE_NUMBER == 2) || (INTERFACE_NUMBER == 3)
+   if(HAL_IF_Get(dev) == HAL_IF_SPI_DRDY)
+   {
+      LMH_SPIRX_DRDY_SetIntCb(cb);
+      return LMH_OK;
+   }
+#endif
+   if(cb == NULL)
+   {
+      return HAL_GPIO_SetupCb(pin, HAL_GPIO_INT_EDGE_SETUP, NULL);
+   }
+   return HAL_GPIO_SetupCb(pin, HAL_GPIO_INT_EDGE_RISING, cb);
+}
@@ -31,11 +31,19 @@
 #elif INTERFACE_NUMBER == 2
 #include "lmh_spirx.h"
 #include "lmh_spirx_drdy.h"
+#elif INTERFACE_NUMBER == 3
+#include "lmh_uartrx.h"
+#include "lmh_spirx.h"
+#include "lmh_spirx_drdy.h"
 #endif  
 
 
 /** 
  * @brief initializes the LMH utilities over defined interface
+ *       With INTERFACE_NUMBER = 3 the interfaces of the current device are
+ *       probed, SPI_DRDY, SPI then UART, and the one with the lowest
+ *       round trip is kept. After LMH_FALLBACK_ERR_CNT link errors in a row
+ *       the device is probed again.
  *
  * @param none
  *
@@ -103,6 +111,16 @@ int LMH_CheckGPIOIdx(dwm_gpio_idx_t idx);
  */
 int LMH_CheckRetVal(uint8_t* ret_val);
 
+/** 
+ * @brief set the callback of the module interrupt pin of the current device, 
+ *       called from the GPIO interrupt thread on each rising edge
+ *
+ * @param [in] cb: callback, NULL to remove it
+ *
+ * @return Error code
+ */
+int LMH_SetIntCb(void (*cb)(void));
+
 
 #endif //_LMH_H_
 
@@ -23,6 +23,7 @@
 
 #include "hal.h"
 #include "hal_log.h"
+#include "hal_stat.h"
 #include "lmh.h"
 
 #define LMH_SPIRX_HEADER_LENGTH           1
@@ -32,10 +33,15 @@
 #endif   
 
 #define LMH_SPIRX_TIMEOUT_DEFAULT         1000
+#define LMH_SPIRX_WAIT_MIN_DEFAULT        50 //us, doubled after each empty SIZE poll
+#define LMH_SPIRX_IDLE_BYTES              3  //dummy bytes of LMH_SPIRX_SetToIdle()
 
-static bool lmh_spirx_initialized[2]={false, false};
-static int  lmh_spirx_timeout = LMH_SPIRX_TIMEOUT_DEFAULT;
-static int  lmh_spirx_wait = HAL_SPI_WAIT_PERIOD;
+// the settings are kept per SPI device, each is used by the thread that 
+// selected the device
+static bool lmh_spirx_initialized[HAL_SPI_DEV_NUM]={false, false};
+static int  lmh_spirx_timeout[HAL_SPI_DEV_NUM] = {LMH_SPIRX_TIMEOUT_DEFAULT, LMH_SPIRX_TIMEOUT_DEFAULT};
+static int  lmh_spirx_wait[HAL_SPI_DEV_NUM] = {HAL_SPI_WAIT_PERIOD, HAL_SPI_WAIT_PERIOD};
+static int  lmh_spirx_wait_min[HAL_SPI_DEV_NUM] = {LMH_SPIRX_WAIT_MIN_DEFAULT, LMH_SPIRX_WAIT_MIN_DEFAULT};
 
 /**
  * @brief : initialises the SPIRX functions. 
@@ -43,9 +49,9 @@ static int  lmh_spirx_wait = HAL_SPI_WAIT_PERIOD;
 void LMH_SPIRX_Init(void)
 {  
    int dev = HAL_SPI_Which();
-   if(dev > 1)
+   if(dev >= HAL_SPI_DEV_NUM)
    {
-      HAL_Log("lmh: *** ERROR *** SPI: Cannot find SPI dev%d.\n", dev);      
+      HAL_LogErr("lmh: *** ERROR *** SPI: Cannot find SPI dev%d.\n", dev);      
       return;
    }
    if(lmh_spirx_initialized[dev])
@@ -57,6 +63,7 @@ void LMH_SPIRX_Init(void)
    
    LMH_SPIRX_SetTimeout(LMH_SPIRX_TIMEOUT_DEFAULT);
    LMH_SPIRX_SetWait(HAL_SPI_WAIT_PERIOD);
+   LMH_SPIRX_SetWaitMin(LMH_SPIRX_WAIT_MIN_DEFAULT);
    LMH_SPIRX_SetToIdle();
    
    lmh_spirx_initialized[dev] = true;
@@ -74,16 +81,21 @@ void LMH_SPIRX_DeInit(void)
 
 /**
  * @brief : sets the DWM1001 module SPIRX functions into idle mode. 
+ *          Each dummy byte is its own transfer, the wait period is spent 
+ *          with the chip select released. 
  */
 void LMH_SPIRX_SetToIdle(void)
 {
-   uint8_t dummy = 0xff, length = 1;
-   int i = 3;
-   HAL_Log("lmh:     SPI%d: Reseting DWM1001 to SPI:IDLE\n", HAL_SPI_Which()); 
-   while(i-- > 0){
+   uint8_t dummy, length;
+   int i;
+   int dev = HAL_SPI_Which();
+   HAL_LogDbg("lmh:     SPI%d: Reseting DWM1001 to SPI:IDLE, wait %d ms between the bytes\n", dev, lmh_spirx_wait[dev]); 
+   for(i = 0; i < LMH_SPIRX_IDLE_BYTES; i++)
+   {
+      dummy = 0xff;
+      length = 1;
       HAL_SPI_Tx(&dummy, &length);
-      HAL_Delay(lmh_spirx_wait);
-      HAL_Log("lmh:     SPI%d: Wait %d ms...\n", HAL_SPI_Which(), lmh_spirx_wait); 
+      HAL_Delay(lmh_spirx_wait[dev]);
    }
 }
 
@@ -94,22 +106,38 @@ void LMH_SPIRX_SetToIdle(void)
  */
 void LMH_SPIRX_SetTimeout(int timeout)
 {
-   lmh_spirx_timeout = timeout;
+   lmh_spirx_timeout[HAL_SPI_Which()] = timeout;
 }
 
 /**
- * @brief : Set the SPIRX wait period between each poll of SIZE. 
+ * @brief : Set the longest SPIRX wait period between two polls of SIZE. 
+ *          The wait starts at the minimum and doubles after each empty poll 
+ *          up to this period. 
  *
  * @param [in] wait, SPIRX wait period in ms
  */
 void LMH_SPIRX_SetWait(int wait)
 {
-   lmh_spirx_wait = wait;
+   lmh_spirx_wait[HAL_SPI_Which()] = wait;
 }
 
 /**
- * @brief : wait length=exp_length for max time=lmh_spirx_wait
+ * @brief : Set the first SPIRX wait period before a poll of SIZE, also the 
+ *          wait before the data read and after it. 
+ *
+ * @param [in] wait_us, SPIRX minimum wait period in us
+ */
+void LMH_SPIRX_SetWaitMin(int wait_us)
+{
+   lmh_spirx_wait_min[HAL_SPI_Which()] = wait_us;
+}
+
+/**
+ * @brief : wait length=exp_length for max time=lmh_spirx_timeout
  *          needs LMH_SPIRX_Init() at initialization 
+ *          SIZE is polled after lmh_spirx_wait_min us, then the wait doubles 
+ *          after each empty poll up to lmh_spirx_wait ms, and it never goes 
+ *          past the deadline. 
  *
  * @param [out] data,       pointer to received data 
  * @param [out] length,     pointer to received data length 
@@ -120,55 +148,69 @@ void LMH_SPIRX_SetWait(int wait)
 int LMH_SPIRX_WaitForRx(uint8_t* data, uint16_t* length, uint16_t exp_length)
 {
    uint8_t len_header, sizenum[LMH_SPIRX_HEADER_LENGTH];
-   int timeout = lmh_spirx_timeout;
-
+   uint64_t start, deadline, current, phase_ns;
    int dev = HAL_SPI_Which();
+   int wait_us = lmh_spirx_wait_min[dev];
+   int wait_max_us = lmh_spirx_wait[dev]*1000;
+   int polls = 0;
+
    if(!lmh_spirx_initialized[dev])
    {
-      HAL_Log("lmh: *** ERROR *** SPI%d: LMH_SPIRX not initialized.\n", dev);
+      HAL_LogErr("lmh: *** ERROR *** SPI%d: LMH_SPIRX not initialized.\n", dev);
       return LMH_ERR;
    }
    if(exp_length < DWM1001_TLV_RET_VAL_MIN_SIZE)
    {
-      HAL_Log("lmh: *** ERROR *** SPI%d: exp_length must be >= 3.\n", dev);    
+      HAL_LogErr("lmh: *** ERROR *** SPI%d: exp_length must be >= 3.\n", dev);    
       return LMH_ERR;
    }
    
-   HAL_Log("lmh:     SPI%d: Rx step 1:\n", dev);
+   HAL_LogDbg("lmh:     SPI%d: Rx step 1:\n", dev);
    memset(sizenum, 0, LMH_SPIRX_HEADER_LENGTH);
-   while((sizenum[LMH_SPIRX_SIZE_OFFSET] == 0) && (timeout>0))
+   phase_ns = HAL_GetTimeNs();
+   current = start = HAL_GetTime64();
+   deadline = start + (uint64_t)lmh_spirx_timeout[dev]*1000;
+   while((sizenum[LMH_SPIRX_SIZE_OFFSET] == 0) && (current < deadline))
    {
-      HAL_Delay(lmh_spirx_wait);
-      timeout-=lmh_spirx_wait;
-      HAL_Log("lmh:     SPI%d: Wait %d ms...\n", dev, lmh_spirx_wait); 
+      if((uint64_t)wait_us > deadline - current)
+      {
+         wait_us = (int)(deadline - current);
+      }
+      HAL_DelayUs(wait_us);
       
       len_header = LMH_SPIRX_HEADER_LENGTH;
       HAL_SPI_Rx(sizenum, &len_header);
+      polls++;
+      
+      wait_us = (wait_us*2 < wait_max_us)? wait_us*2 : wait_max_us;
+      current = HAL_GetTime64();
    }
+   HAL_LogDbg("lmh:     SPI%d: SIZE polled %d times in %d us\n", dev, polls, (int)(current - start)); 
    
-   if((timeout < 0) && (sizenum[LMH_SPIRX_SIZE_OFFSET] == 0)){
-      HAL_Log("lmh: *** ERROR *** SPI%d: Read SIZE timed out after %d ms...\n", dev, lmh_spirx_timeout);  
+   if(sizenum[LMH_SPIRX_SIZE_OFFSET] == 0){
+      HAL_LogErr("lmh: *** ERROR *** SPI%d: Read SIZE timed out after %d ms...\n", dev, lmh_spirx_timeout[dev]);  
         
       return LMH_ERR;
    }
+   HAL_STAT_ADD(HAL_STAT_WAIT_SIZE, HAL_GetTimeNs() - phase_ns);
+   phase_ns = HAL_GetTimeNs();
    
    *length = 0;
-   HAL_Log("lmh:     SPISPI%d: Rx step 2:\n", dev);
+   HAL_LogDbg("lmh:     SPISPI%d: Rx step 2:\n", dev);
    
 #if LMH_SPIRX_HEADER_LENGTH == 2
    uint8_t i;
    for(i = 0; i < sizenum[LMH_SPIRX_NUM_OFFSET]; i++)
 #endif
    {
-      HAL_Delay(lmh_spirx_wait);
-      timeout-=lmh_spirx_wait;
-      HAL_Log("lmh:     SPI%d: Wait %d ms...\n", dev, lmh_spirx_wait); 
+      HAL_DelayUs(lmh_spirx_wait_min[dev]);
       HAL_SPI_Rx(data, sizenum+LMH_SPIRX_SIZE_OFFSET);      
       *length += sizenum[LMH_SPIRX_SIZE_OFFSET];
    }
      
-   HAL_Delay(lmh_spirx_wait);
-   HAL_Log("lmh:     SPI%d: Wait %d ms...\n", dev, lmh_spirx_wait); 
+   HAL_DelayUs(lmh_spirx_wait_min[dev]);
+   current = HAL_GetTime64();
+   HAL_STAT_ADD(HAL_STAT_WAIT_DATA, HAL_GetTimeNs() - phase_ns);
    
    if(LMH_CheckRetVal(data) != LMH_OK)
    {
@@ -177,12 +219,12 @@ int LMH_SPIRX_WaitForRx(uint8_t* data, uint16_t* length, uint16_t exp_length)
    
    if((*length != exp_length) && (exp_length != DWM1001_TLV_MAX_SIZE))
    {
-      HAL_Log("lmh: *** ERROR *** SPI%d: Expecting %d bytes, received %d bytes, in %d ms\n", \
-      dev, exp_length, *length, lmh_spirx_timeout-timeout);
+      HAL_LogErr("lmh: *** ERROR *** SPI%d: Expecting %d bytes, received %d bytes, in %d us\n", \
+      dev, exp_length, *length, (int)(current - start));
       return LMH_ERR;
    }
    
-   HAL_Log("lmh:     SPI%d: Received %d bytes, in %d ms \t OK\n", dev, *length, lmh_spirx_timeout-timeout);
+   HAL_Log("lmh:     SPI%d: Received %d bytes, in %d us \t OK\n", dev, *length, (int)(current - start));
    return LMH_OK;      
 }
 
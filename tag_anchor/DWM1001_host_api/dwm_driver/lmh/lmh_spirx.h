@@ -45,12 +45,22 @@ void LMH_SPIRX_SetToIdle(void);
 void LMH_SPIRX_SetTimeout(int timeout);
 
 /**
- * @brief : Set the SPIRX wait period between each poll of SIZE. 
+ * @brief : Set the longest SPIRX wait period between two polls of SIZE. 
+ *          The wait starts at the minimum and doubles after each empty poll 
+ *          up to this period. 
  *
  * @param [in] wait, SPIRX wait period in ms
  */
 void LMH_SPIRX_SetWait(int wait);
 
+/**
+ * @brief : Set the first SPIRX wait period before a poll of SIZE, also the 
+ *          wait before the data read and after it. 
+ *
+ * @param [in] wait_us, SPIRX minimum wait period in us
+ */
+void LMH_SPIRX_SetWaitMin(int wait_us);
+
 /**
  * @brief : wait length=exp_length for max time=lmh_spirx_wait
  *          needs LMH_SPIRX_Init() at initialization 
@@ -18,10 +18,14 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
 
 #include "hal_gpio.h"
 #include "hal.h"
 #include "hal_log.h"
+#include "hal_stat.h"
 #include "lmh.h"
 
 #define LMH_SPIRX_DRDY_HEADER_LENGTH           1
@@ -31,14 +35,31 @@
 #endif   
 
 #define LMH_SPIRX_DRDY_TIMEOUT_DEFAULT       1000
+#define LMH_SPIRX_DRDY_SIZE_POLL_US          50    // SIZE poll period while the pin is held by another interrupt
+#define LMH_SPIRX_DRDY_IDLE_BYTES            3     // dummy bytes of LMH_SPIRX_DRDY_SetToIdle()
 
 static int  LMH_SPIRX_DRDY_IntCfg(uint16_t value);
-static void LMH_SPIRX_DRDY_DrdyCb(void);
+static void LMH_SPIRX_DRDY_DrdyCb(int dev);
+static void LMH_SPIRX_DRDY_DrdyCb0(void);
+static void LMH_SPIRX_DRDY_DrdyCb1(void);
+static void LMH_SPIRX_DRDY_PinUpdate(int dev);
+static bool LMH_SPIRX_DRDY_WaitHigh(int dev, uint64_t deadline);
+static void LMH_SPIRX_DRDY_Rearm(int dev);
+static bool LMH_SPIRX_DRDY_WaitEdge(int dev, uint64_t deadline);
 
-static bool lmh_spirx_drdy_initialized[2] = {false, false};
-static int  lmh_spirx_drdy_timeout = LMH_SPIRX_DRDY_TIMEOUT_DEFAULT;
-static int  lmh_spirx_drdy_wait = HAL_SPI_WAIT_PERIOD;
-static bool lmh_spirx_drdy_drdy_flag = false;
+// the state is kept per SPI device, each module has its own DRDY pin 
+static const int lmh_spirx_drdy_pin[HAL_SPI_DEV_NUM] = {HAL_GPIO_DRDY, HAL_GPIO_DRDY1};
+static void (* const lmh_spirx_drdy_cb[HAL_SPI_DEV_NUM])(void) = {LMH_SPIRX_DRDY_DrdyCb0, LMH_SPIRX_DRDY_DrdyCb1};
+static bool lmh_spirx_drdy_initialized[HAL_SPI_DEV_NUM] = {false, false};
+static int  lmh_spirx_drdy_timeout[HAL_SPI_DEV_NUM] = {LMH_SPIRX_DRDY_TIMEOUT_DEFAULT, LMH_SPIRX_DRDY_TIMEOUT_DEFAULT};
+static int  lmh_spirx_drdy_wait[HAL_SPI_DEV_NUM] = {HAL_SPI_WAIT_PERIOD, HAL_SPI_WAIT_PERIOD};
+static bool lmh_spirx_drdy_drdy_flag[HAL_SPI_DEV_NUM] = {false, false};
+static void (* volatile lmh_spirx_drdy_int_cb[HAL_SPI_DEV_NUM])(void) = {NULL, NULL};
+
+// the DRDY callbacks run in the GPIO interrupt threads, they signal the waiter 
+static pthread_mutex_t lmh_spirx_drdy_mutex[HAL_SPI_DEV_NUM] = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER};
+static pthread_cond_t  lmh_spirx_drdy_cond[HAL_SPI_DEV_NUM];
+static bool lmh_spirx_drdy_cond_initialized[HAL_SPI_DEV_NUM] = {false, false};
 
 /**
  * @brief : initialises the UARTRX functions. 
@@ -46,9 +67,9 @@ static bool lmh_spirx_drdy_drdy_flag = false;
 void LMH_SPIRX_DRDY_Init(void)
 {  
    int dev = HAL_SPI_Which();
-   if(dev > 1)
+   if(dev >= HAL_SPI_DEV_NUM)
    {
-      HAL_Log("lmh: *** ERROR *** SPI_DRDY: Cannot find SPI dev%d.\n", dev);      
+      HAL_LogErr("lmh: *** ERROR *** SPI_DRDY: Cannot find SPI dev%d.\n", dev);      
       return;
    }
    if(lmh_spirx_drdy_initialized[dev])
@@ -61,12 +82,23 @@ void LMH_SPIRX_DRDY_Init(void)
    
    if(LMH_SPIRX_DRDY_IntCfg(DWM1001_INTR_SPI_DATA_READY) == LMH_ERR)
    {
-      HAL_Log("lmh: *** ERROR *** SPI_DRDY: LMH_SPIRX_DRDY_IntCfg() failed.\n");
+      HAL_LogErr("lmh: *** ERROR *** SPI_DRDY: LMH_SPIRX_DRDY_IntCfg() failed.\n");
       return;
    }
    
+   if(!lmh_spirx_drdy_cond_initialized[dev])
+   {
+      // the deadlines are on the monotonic clock of HAL_GetTime64()
+      pthread_condattr_t attr;
+      pthread_condattr_init(&attr);
+      pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+      pthread_cond_init(&lmh_spirx_drdy_cond[dev], &attr);
+      pthread_condattr_destroy(&attr);
+      lmh_spirx_drdy_cond_initialized[dev] = true;
+   }
+   
    HAL_GPIO_Init();
-   HAL_GPIO_SetupCb(HAL_GPIO_DRDY, HAL_GPIO_INT_EDGE_BOTH, &LMH_SPIRX_DRDY_DrdyCb);
+   HAL_GPIO_SetupCb(lmh_spirx_drdy_pin[dev], HAL_GPIO_INT_EDGE_BOTH, lmh_spirx_drdy_cb[dev]);
    
    LMH_SPIRX_DRDY_SetTimeout(LMH_SPIRX_DRDY_TIMEOUT_DEFAULT);
    LMH_SPIRX_DRDY_SetWait(HAL_SPI_WAIT_PERIOD);     
@@ -84,7 +116,7 @@ void LMH_SPIRX_DRDY_DeInit(void)
    int dev = HAL_SPI_Which();
    LMH_SPIRX_DeInit();
    lmh_spirx_drdy_initialized[dev] = false;
-   HAL_GPIO_SetupCb(HAL_GPIO_DRDY, HAL_GPIO_INT_EDGE_SETUP, NULL);   
+   HAL_GPIO_SetupCb(lmh_spirx_drdy_pin[dev], HAL_GPIO_INT_EDGE_SETUP, NULL);   
 }
 
 /**
@@ -107,48 +139,174 @@ static int LMH_SPIRX_DRDY_IntCfg(uint16_t value)
 
 /**
  * @brief : sets the DWM1001 module SPIRX functions into idle mode. 
+ *          Each dummy byte is its own transfer, the wait period is spent 
+ *          with the chip select released. 
  */
 void LMH_SPIRX_DRDY_SetToIdle(void)
 {
-   uint8_t dummy = 0xff, length = 1;
-   int i = 3;
-   HAL_Log("lmh:     SPI_DRDY: Reseting DWM1001 to SPI:IDLE \n"); 
-   while(i-- > 0){
+   uint8_t dummy, length;
+   int i;
+   int dev = HAL_SPI_Which();
+   HAL_LogDbg("lmh:     SPI_DRDY%d: Reseting DWM1001 to SPI:IDLE, wait %d ms between the bytes\n", dev, lmh_spirx_drdy_wait[dev]); 
+   for(i = 0; i < LMH_SPIRX_DRDY_IDLE_BYTES; i++)
+   {
+      dummy = 0xff;
+      length = 1;
       HAL_SPI_Tx(&dummy, &length);
-      HAL_Delay(1);
-      HAL_Log("lmh:     SPI_DRDY: Wait %d ms...\n", 1); 
+      HAL_Delay(lmh_spirx_drdy_wait[dev]);
    }
 }
 
 /**
  * @brief : on drdy pin going high/low, set/reset the lmh_spirx_drdy_drdy_flag 
+ *          of the device and wake up LMH_SPIRX_DRDY_WaitHigh()
+ *
+ * @param [in] dev, SPI device of the pin
+ *
+ * @return none
+ */
+static void LMH_SPIRX_DRDY_DrdyCb(int dev)
+{
+   bool high;
+   pthread_mutex_lock(&lmh_spirx_drdy_mutex[dev]);
+   LMH_SPIRX_DRDY_PinUpdate(dev);
+   high = lmh_spirx_drdy_drdy_flag[dev];
+   if(high)
+   {
+      pthread_cond_signal(&lmh_spirx_drdy_cond[dev]);
+   }
+   pthread_mutex_unlock(&lmh_spirx_drdy_mutex[dev]);
+   HAL_LogDbg("lmh:     SPI_DRDY%d: DRDY pin rising edge detected.  %s \n", dev, high ? "+++" : "---"); 
+   if(high && (lmh_spirx_drdy_int_cb[dev] != NULL))
+   {
+      lmh_spirx_drdy_int_cb[dev]();
+   }
+}
+
+/**
+ * @brief : DRDY callbacks of each device, the GPIO callbacks take no argument
+ */
+static void LMH_SPIRX_DRDY_DrdyCb0(void)
+{
+   LMH_SPIRX_DRDY_DrdyCb(HAL_SPI_DEV0);
+}
+
+static void LMH_SPIRX_DRDY_DrdyCb1(void)
+{
+   LMH_SPIRX_DRDY_DrdyCb(HAL_SPI_DEV1);
+}
+
+/**
+ * @brief : wait until the DRDY pin is high, sleeping on the condition signaled 
+ *          by LMH_SPIRX_DRDY_DrdyCb(). The pin is read once before sleeping, 
+ *          in case its edge came before the wait. 
+ *
+ * @param [in] deadline, end of the wait, HAL_GetTime64() time in us
+ *
+ * @return true if the pin is high, false if the deadline is reached
+ */
+static bool LMH_SPIRX_DRDY_WaitHigh(int dev, uint64_t deadline)
+{
+   struct timespec ts;
+   bool high;
+   
+   ts.tv_sec = deadline / 1000000;
+   ts.tv_nsec = (deadline % 1000000) * 1000;
+   
+   pthread_mutex_lock(&lmh_spirx_drdy_mutex[dev]);
+   LMH_SPIRX_DRDY_PinUpdate(dev);
+   while(!lmh_spirx_drdy_drdy_flag[dev])
+   {
+      if(pthread_cond_timedwait(&lmh_spirx_drdy_cond[dev], &lmh_spirx_drdy_mutex[dev], &ts) == ETIMEDOUT)
+      {
+         LMH_SPIRX_DRDY_PinUpdate(dev);
+         break;
+      }
+   }
+   high = lmh_spirx_drdy_drdy_flag[dev];
+   pthread_mutex_unlock(&lmh_spirx_drdy_mutex[dev]);
+   return high;
+}
+
+/**
+ * @brief : clear lmh_spirx_drdy_drdy_flag before a read, so that 
+ *          LMH_SPIRX_DRDY_WaitEdge() only returns on a rising edge which 
+ *          comes after it. The pin is still high from the previous phase. 
+ *
+ * @param [in] dev, SPI device of the pin
  *
  * @return none
  */
-static void LMH_SPIRX_DRDY_DrdyCb(void)
+static void LMH_SPIRX_DRDY_Rearm(int dev)
 {
-   LMH_SPIRX_DRDY_PinCheck();
-   HAL_Log("lmh:     SPI_DRDY: DRDY pin rising edge detected.  %s \n", LMH_SPIRX_DRDY_PinGet() ? "+++" : "---"); 
+   pthread_mutex_lock(&lmh_spirx_drdy_mutex[dev]);
+   lmh_spirx_drdy_drdy_flag[dev] = false;
+   pthread_mutex_unlock(&lmh_spirx_drdy_mutex[dev]);
 }
 
 /**
- * @brief : update lmh_spirx_drdy_drdy_flag status according to HAL_GPIO_DRDY status
+ * @brief : wait for the rising edge of the DRDY pin after 
+ *          LMH_SPIRX_DRDY_Rearm(), sleeping on the condition signaled by 
+ *          LMH_SPIRX_DRDY_DrdyCb(). The pin level is only read at the deadline. 
+ *
+ * @param [in] deadline, end of the wait, HAL_GetTime64() time in us
+ *
+ * @return true on the edge, false if the deadline is reached
+ */
+static bool LMH_SPIRX_DRDY_WaitEdge(int dev, uint64_t deadline)
+{
+   struct timespec ts;
+   bool high;
+   
+   ts.tv_sec = deadline / 1000000;
+   ts.tv_nsec = (deadline % 1000000) * 1000;
+   
+   pthread_mutex_lock(&lmh_spirx_drdy_mutex[dev]);
+   while(!lmh_spirx_drdy_drdy_flag[dev])
+   {
+      if(pthread_cond_timedwait(&lmh_spirx_drdy_cond[dev], &lmh_spirx_drdy_mutex[dev], &ts) == ETIMEDOUT)
+      {
+         LMH_SPIRX_DRDY_PinUpdate(dev);
+         break;
+      }
+   }
+   high = lmh_spirx_drdy_drdy_flag[dev];
+   pthread_mutex_unlock(&lmh_spirx_drdy_mutex[dev]);
+   return high;
+}
+
+/**
+ * @brief : update lmh_spirx_drdy_drdy_flag of a device according to its 
+ *          DRDY pin status
+ *
+ * @param [in] dev, SPI device of the pin
+ *
+ * @return none
+ */
+static void LMH_SPIRX_DRDY_PinUpdate(int dev)
+{   
+   lmh_spirx_drdy_drdy_flag[dev] = HAL_GPIO_PinRead(lmh_spirx_drdy_pin[dev]) == 1? true: false;
+}
+
+/**
+ * @brief : update lmh_spirx_drdy_drdy_flag status of the current device 
+ *          according to its DRDY pin status
  *
  * @return none
  */
 void LMH_SPIRX_DRDY_PinCheck(void)
 {   
-   lmh_spirx_drdy_drdy_flag = HAL_GPIO_PinRead(HAL_GPIO_DRDY) == 1? true: false;
+   LMH_SPIRX_DRDY_PinUpdate(HAL_SPI_Which());
 }
 
 /**
- * @brief : get lmh_spirx_drdy_drdy_flag 
+ * @brief : get lmh_spirx_drdy_drdy_flag of the current device
  *
  * @return lmh_spirx_drdy_drdy_flag
  */
 bool LMH_SPIRX_DRDY_PinGet(void)
 {   
-   return lmh_spirx_drdy_drdy_flag;
+   return lmh_spirx_drdy_drdy_flag[HAL_SPI_Which()];
 }
 
 /**
@@ -158,22 +316,38 @@ bool LMH_SPIRX_DRDY_PinGet(void)
  */
 void LMH_SPIRX_DRDY_SetTimeout(int timeout)
 {
-   lmh_spirx_drdy_timeout = timeout;
+   lmh_spirx_drdy_timeout[HAL_SPI_Which()] = timeout;
 }
 
 /**
- * @brief : Set the SPIRX_DRDY wait period between each poll of SIZE. 
+ * @brief : Set the SPIRX_DRDY wait period between the dummy bytes of 
+ *          LMH_SPIRX_DRDY_SetToIdle(). The responses are waited for on the 
+ *          DRDY interrupt, without a polling period. 
  *
  * @param [in] wait, SPIRX_DRDY wait period in ms
  */
 void LMH_SPIRX_DRDY_SetWait(int wait)
 {
-   lmh_spirx_drdy_wait = wait;
+   lmh_spirx_drdy_wait[HAL_SPI_Which()] = wait;
 }
 
 /**
- * @brief : wait length=exp_length for max time=lmh_spirx_drdy_wait
+ * @brief : Set a callback chained after the DRDY callback of the current 
+ *          device. 
+ *
+ * @param [in] cb, callback, NULL to remove it
+ */
+void LMH_SPIRX_DRDY_SetIntCb(void (*cb)(void))
+{
+   lmh_spirx_drdy_int_cb[HAL_SPI_Which()] = cb;
+}
+
+/**
+ * @brief : wait length=exp_length for max time=lmh_spirx_drdy_timeout
  *          needs LMH_SPIRX_DRDY_Init() at initialization 
+ *          The thread sleeps until the DRDY interrupt, then reads SIZE, 
+ *          and sleeps until the next rising edge of the pin before each DATA 
+ *          segment, without fixed delays. 
  *
  * @param [out] data,       pointer to received data 
  * @param [out] length,     pointer to received data length 
@@ -184,80 +358,78 @@ void LMH_SPIRX_DRDY_SetWait(int wait)
 int LMH_SPIRX_DRDY_WaitForRx(uint8_t* data, uint16_t* length, uint16_t exp_length)
 {   
    uint8_t len_header, sizenum[LMH_SPIRX_DRDY_HEADER_LENGTH];
-   int timeout = lmh_spirx_drdy_timeout;
+   uint64_t start, deadline, current, phase_ns;
    int ret_val = LMH_OK;
-   int wait_temp;
 
    // check invalid cases    
    int dev = HAL_SPI_Which();
    if(!lmh_spirx_drdy_initialized[dev])
    {
-      HAL_Log("lmh: *** ERROR *** SPI_DRDY: LMH_SPIRX_DRDY dev%d not initialized.\n", dev);
+      HAL_LogErr("lmh: *** ERROR *** SPI_DRDY: LMH_SPIRX_DRDY dev%d not initialized.\n", dev);
       return LMH_ERR;
    }
    if(exp_length < DWM1001_TLV_RET_VAL_MIN_SIZE)
    {
-      HAL_Log("lmh: *** ERROR *** SPI_DRDY: exp_length must be >= 3\n");    
+      HAL_LogErr("lmh: *** ERROR *** SPI_DRDY: exp_length must be >= 3\n");    
       return LMH_ERR;
    }
    
    // wait for SIZE to be ready 
-   HAL_Log("lmh:     SPI_DRDY%d: Rx step 1:\n", dev);
+   HAL_LogDbg("lmh:     SPI_DRDY%d: Rx step 1:\n", dev);
    memset(sizenum, 0, LMH_SPIRX_DRDY_HEADER_LENGTH);
-   HAL_Log("lmh:     SPI_DRDY%d: Start wait for spirx_drdy ...\n", dev);
-   wait_temp = 0;
-   while((!LMH_SPIRX_DRDY_PinGet()) && (timeout>0))
-   {
-      HAL_Delay(lmh_spirx_drdy_wait);
-      wait_temp += lmh_spirx_drdy_wait;
-      timeout-=lmh_spirx_drdy_wait;
-      LMH_SPIRX_DRDY_PinCheck();    
-   }   
-   HAL_Log("lmh:     SPI_DRDY%d: Waited %d ms for spirx_drdy ...\n", dev, wait_temp); 
-      
-   HAL_Log("lmh:     SPI_DRDY%d: Wait %d ms...\n", dev, lmh_spirx_drdy_wait); 
-   HAL_Delay(lmh_spirx_drdy_wait);
-   timeout-=lmh_spirx_drdy_wait;
-   
-   if(timeout <= 0){
-      HAL_Log("lmh: *** ERROR *** SPI_DRDY: Read SIZE timed out after %d ms...\n", lmh_spirx_drdy_timeout);        
-      LMH_SPIRX_DRDY_PinCheck();   
-      ret_val = LMH_ERR;
+   HAL_LogDbg("lmh:     SPI_DRDY%d: Start wait for spirx_drdy ...\n", dev);
+   phase_ns = HAL_GetTimeNs();
+   start = HAL_GetTime64();
+   deadline = start + (uint64_t)lmh_spirx_drdy_timeout[dev]*1000;
+   if(!LMH_SPIRX_DRDY_WaitHigh(dev, deadline)){
+      HAL_LogErr("lmh: *** ERROR *** SPI_DRDY: Read SIZE timed out after %d ms...\n", lmh_spirx_drdy_timeout[dev]);        
+      return LMH_ERR;
    }
+   current = HAL_GetTime64();
+   HAL_LogDbg("lmh:     SPI_DRDY%d: Waited %d us for spirx_drdy ...\n", dev, (int)(current - start)); 
          
-   // read SIZE & NUM
+   // read SIZE & NUM, the pin may be high for another interrupt, such as 
+   // the location ready one, before the response: SIZE is then polled 
    len_header = LMH_SPIRX_DRDY_HEADER_LENGTH;
+   LMH_SPIRX_DRDY_Rearm(dev);
    HAL_SPI_Rx(sizenum, &len_header);
-      
-   // wait for DATA to be ready 
-   HAL_Log("lmh:     SPI_DRDY%d: Rx step 2: \n", dev);
-   HAL_Log("lmh:     SPI_DRDY%d: Start wait for spirx_drdy ...\n", dev);
-   wait_temp = 0;
-   while((!LMH_SPIRX_DRDY_PinGet()) && (timeout>0))
+   while((sizenum[LMH_SPIRX_DRDY_SIZE_OFFSET] == 0) && (HAL_GetTime64() < deadline))
    {
-      HAL_Delay(lmh_spirx_drdy_wait);
-      timeout-=lmh_spirx_drdy_wait;
-      LMH_SPIRX_DRDY_PinCheck();        
+      HAL_DelayUs(LMH_SPIRX_DRDY_SIZE_POLL_US);
+      len_header = LMH_SPIRX_DRDY_HEADER_LENGTH;
+      LMH_SPIRX_DRDY_Rearm(dev);
+      HAL_SPI_Rx(sizenum, &len_header);
    }
-   HAL_Log("lmh:     SPI_DRDY%d: Waited %d ms for spirx_drdy ...\n", dev, wait_temp); 
-   
-   // read DATA 
+   HAL_STAT_ADD(HAL_STAT_WAIT_SIZE, HAL_GetTimeNs() - phase_ns);
+   phase_ns = HAL_GetTimeNs();
+   if(sizenum[LMH_SPIRX_DRDY_SIZE_OFFSET] == 0)
+   {
+      HAL_LogErr("lmh: *** ERROR *** SPI_DRDY: Read SIZE timed out after %d ms...\n", lmh_spirx_drdy_timeout[dev]);        
+      return LMH_ERR;
+   }
+      
+   // wait for DATA to be ready, a rising edge of the pin after the previous 
+   // read, then read DATA 
+   HAL_LogDbg("lmh:     SPI_DRDY%d: Rx step 2: \n", dev);
    *length = 0;
 #if LMH_SPIRX_DRDY_HEADER_LENGTH == 2
    uint8_t i;
    for(i = 0; i < sizenum[LMH_SPIRX_DRDY_NUM_OFFSET]; i++)
 #endif
    {     
-      HAL_Delay(lmh_spirx_drdy_wait);
-      timeout-=lmh_spirx_drdy_wait;
-      HAL_Log("lmh:     SPI_DRDY%d: Wait %d ms...\n", dev, lmh_spirx_drdy_wait); 
+      HAL_LogDbg("lmh:     SPI_DRDY%d: Start wait for spirx_drdy ...\n", dev);
+      if(!LMH_SPIRX_DRDY_WaitEdge(dev, deadline))
+      {
+         HAL_LogErr("lmh: *** ERROR *** SPI_DRDY: Read DATA timed out after %d ms...\n", lmh_spirx_drdy_timeout[dev]);        
+         return LMH_ERR;
+      }
+      HAL_LogDbg("lmh:     SPI_DRDY%d: Waited %d us for spirx_drdy ...\n", dev, (int)(HAL_GetTime64() - current)); 
+      LMH_SPIRX_DRDY_Rearm(dev);
       HAL_SPI_Rx(data, sizenum+LMH_SPIRX_DRDY_SIZE_OFFSET); 
       *length += sizenum[LMH_SPIRX_DRDY_SIZE_OFFSET];
    }
-   
-   HAL_Delay(lmh_spirx_drdy_wait);
-   HAL_Log("lmh:     SPI_DRDY: Wait %d ms...\n", lmh_spirx_drdy_wait); 
-   LMH_SPIRX_DRDY_PinCheck();   
+   current = HAL_GetTime64();
+   HAL_STAT_ADD(HAL_STAT_WAIT_DATA, HAL_GetTimeNs() - phase_ns);
    
    if(LMH_CheckRetVal(data) != LMH_OK)
    {
@@ -266,13 +438,13 @@ int LMH_SPIRX_DRDY_WaitForRx(uint8_t* data, uint16_t* length, uint16_t exp_lengt
    
    if((*length != exp_length) && (exp_length != DWM1001_TLV_MAX_SIZE))
    {
-      HAL_Log("lmh: *** ERROR *** SPI_DRDY:: Expecting %d bytes, received %d bytes, in %d ms\n", \
-      exp_length, *length, lmh_spirx_drdy_timeout-timeout);
+      HAL_LogErr("lmh: *** ERROR *** SPI_DRDY:: Expecting %d bytes, received %d bytes, in %d us\n", \
+      exp_length, *length, (int)(current - start));
       return LMH_ERR;   
    }
    
-   HAL_Log("lmh:     SPI_DRDY: Received %d bytes, in %d ms\n", \
-   *length, lmh_spirx_drdy_timeout-timeout);
+   HAL_Log("lmh:     SPI_DRDY: Received %d bytes, in %d us\n", \
+   *length, (int)(current - start));
    return ret_val; 
    
 }
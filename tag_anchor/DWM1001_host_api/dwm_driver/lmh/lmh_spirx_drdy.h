@@ -58,12 +58,23 @@ bool LMH_SPIRX_DRDY_PinGet(void);
 void LMH_SPIRX_DRDY_SetTimeout(int timeout);
 
 /**
- * @brief : Set the SPIRX_DRDY wait period between each poll of SIZE. 
+ * @brief : Set the SPIRX_DRDY wait period between the dummy bytes of 
+ *          LMH_SPIRX_DRDY_SetToIdle(). The responses are waited for on the 
+ *          DRDY interrupt, without a polling period. 
  *
  * @param [in] wait, SPIRX_DRDY wait period in ms
  */
 void LMH_SPIRX_DRDY_SetWait(int wait);
 
+/**
+ * @brief : Set a callback chained after the DRDY callback of the current 
+ *          device, called on each rising edge of its DRDY pin, the 
+ *          responses as well as the other module interrupts. 
+ *
+ * @param [in] cb, callback, NULL to remove it
+ */
+void LMH_SPIRX_DRDY_SetIntCb(void (*cb)(void));
+
 /**
  * @brief : wait length=exp_length for max time=lmh_spirx_drdy_wait
  *          needs LMH_SPIRX_DRDY_Init() at initialization 
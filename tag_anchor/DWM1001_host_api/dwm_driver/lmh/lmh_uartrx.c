@@ -20,6 +20,7 @@
 
 #include "hal.h"
 #include "hal_log.h"
+#include "hal_stat.h"
 #include "lmh.h"
 #include "lmh_uartrx.h"
 
@@ -33,7 +34,7 @@ static int  lmh_uartrx_timeout;
 /**
  * @brief : on having received any UART incoming bytes, set the lmh_uartrx_flag 
  *
- * @param [in] status, uart signal number, NOT used here. 
+ * @param [in] status, NOT used here. 
  *
  * @return none
  */
@@ -104,6 +105,9 @@ void LMH_UARTRX_SetTimeout(int timeout)
  * @brief : wait length=exp_length for max time=lmh_uartrx_timeout
  *          needs LMH_UARTRX_Init() at initialization 
  *          needs LMH_UARTRX_Clear() before Tx the TLV request  
+ *          The thread sleeps in HAL_UART_WaitRx() until bytes arrive or the 
+ *          deadline is reached, the deadline becomes LMH_UART_TIMEOUT_MESSAGE
+ *          after the first byte. 
  *
  * @param [out] data,       pointer to received data 
  * @param [out] length,     pointer to received data length 
@@ -111,39 +115,41 @@ void LMH_UARTRX_SetTimeout(int timeout)
  *
  * @return RV_OK if success; else RV_ERR
  */
-#define _10SECOND_FACTOR 10000000
 int LMH_UARTRX_WaitForRx(uint8_t* data, uint16_t* length, uint16_t exp_length)
 {
    uint8_t rx_started = 0;
    uint8_t rx_length = HAL_UART_MAX_LENGTH;
-   uint64_t start0, start, current;
+   uint64_t start0, deadline, current, phase_ns;
    int timeout = lmh_uartrx_timeout;
    
    if(!lmh_uartrx_initialized)
    {
-      HAL_Log("lmh: *** ERROR *** UART: not initialized.");
+      HAL_LogErr("lmh: *** ERROR *** UART: not initialized.");
       return LMH_ERR;
    }
    if(exp_length < DWM1001_TLV_RET_VAL_MIN_SIZE)
    {
-      HAL_Log("lmh: *** ERROR *** UART: exp_length must be >= 3\n");    
+      HAL_LogErr("lmh: *** ERROR *** UART: exp_length must be >= 3\n");    
       return LMH_ERR;
    }
       
-   current = start = start0 = HAL_GetTime64()%_10SECOND_FACTOR;
+   phase_ns = HAL_GetTimeNs();
+   current = start0 = HAL_GetTime64();
+   deadline = start0 + (uint64_t)timeout*1000;
    *length = 0;   
                
-   while(((current + _10SECOND_FACTOR - start)%_10SECOND_FACTOR < (timeout*1000)) && (*length < exp_length))
+   while((current < deadline) && (*length < exp_length))
    { 
-      HAL_Delay(1);
-      if(LMH_UARTRX_IsSet()) 
+      if(HAL_UART_WaitRx(deadline - current) == HAL_OK) 
       {
          if(!rx_started)
          { 
-            start = HAL_GetTime64()%_10SECOND_FACTOR;
             timeout = LMH_UART_TIMEOUT_MESSAGE;
-            HAL_Log("lmh: rx started, timeout period changed to %d ms\n", timeout);   
+            deadline = HAL_GetTime64() + (uint64_t)timeout*1000;
+            HAL_LogDbg("lmh: rx started, timeout period changed to %d ms\n", timeout);   
             rx_started = 1;
+            HAL_STAT_ADD(HAL_STAT_WAIT_SIZE, HAL_GetTimeNs() - phase_ns);
+            phase_ns = HAL_GetTimeNs();
          }
          LMH_UARTRX_Clear();
          rx_length = HAL_UART_MAX_LENGTH;
@@ -155,14 +161,14 @@ int LMH_UARTRX_WaitForRx(uint8_t* data, uint16_t* length, uint16_t exp_length)
             return LMH_ERR;
          }
       }
-      current = HAL_GetTime64() % _10SECOND_FACTOR;
+      current = HAL_GetTime64();
    }   
-   HAL_Delay(1);
    
    LMH_UARTRX_Clear();    
    
    if(rx_started)
    {
+      HAL_STAT_ADD(HAL_STAT_WAIT_DATA, HAL_GetTimeNs() - phase_ns);
       HAL_Log("lmh:     UART: Received all %d bytes, within %0.2f ms \t OK\n", \
       *length, ((float)(current-start0)/1000));
       return LMH_OK;
@@ -175,20 +181,20 @@ int LMH_UARTRX_WaitForRx(uint8_t* data, uint16_t* length, uint16_t exp_length)
    }      
    else// timed out
    {
-      HAL_Log("lmh: *** ERROR *** UART: Received %d bytes, expected %d bytes, timed out in %d ms\n", \
+      HAL_LogErr("lmh: *** ERROR *** UART: Received %d bytes, expected %d bytes, timed out in %d ms\n", \
       *length, exp_length, lmh_uartrx_timeout);
    
-      HAL_Log("lmh:     UART: Received length=%d",*length);
+      HAL_LogErr("lmh:     UART: Received length=%d",*length);
       if (*length >0)
       {
-         HAL_Log(", data=0x");
+         HAL_LogErr(", data=0x");
          int i;
          for(i=0; i<*length; i++)
          {
-            HAL_Log(" %02x", data[i]);
+            HAL_LogErr(" %02x", data[i]);
          }
       }
-      HAL_Log("\n");
+      HAL_LogErr("\n");
       
       return LMH_ERR;
    }
@@ -0,0 +1,249 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    ingest.c
+ * @brief   TDoA blink ingestion of the anchor streams, with the counters of
+ *          dwm_ingest.h printed every second
+ *
+ *          usage: ingest [-a anchors] [-q quorum] [-m min_cnt] [-d deadline_ms]
+ *                        [-u port | -i prefix] [-b baud] [-T trace_file]
+ *
+ *          The frames of anchor i are received on UDP port+i, default 1240,
+ *          as sent by ex9_blink_gen, or read from the file <prefix>i.bin.
+ *          The files are read in turn, 64 bytes of each anchor at a time,
+ *          and the time is that of the bytes at baud bit/s, 10 bits per
+ *          byte, as they came out of the anchor UARTs.
+ *
+ *          With -T the RX, READ and GROUP stages of the blinks are traced
+ *          with dwm_trace.h, the histograms are written to trace_file every
+ *          second and the p99 of the RX to GROUP latency is printed.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include "dwm_ingest.h"
+
+#define ING_PORT           1240
+#define ING_POLL_MS        10
+#define ING_FILE_CHUNK     64
+
+static volatile sig_atomic_t running = 1;
+static uint32_t cnt_hist[DWM_INGEST_ANCHOR_MAX + 1];
+static dwm_trace_t *tr = NULL;
+static char *trace_file = NULL;
+
+static void stop(int sig)
+{
+   (void)sig;
+   running = 0;
+}
+
+static double now_s(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief epoch callback, the anchor counts of the epochs
+ */
+static void on_epoch(void* arg, const dwm_ingest_epoch_t* e)
+{
+   (void)arg;
+   cnt_hist[e->cnt]++;
+}
+
+/**
+ * @brief prints the counters of the last second
+ */
+static void print_stats(dwm_ingest_t* ing, double t, int an_cnt)
+{
+   static dwm_ingest_stats_t s0;
+   dwm_ingest_stats_t s;
+   uint32_t drops = 0;
+   uint32_t n;
+   int i;
+
+   dwm_ingest_stats(ing, &s);
+   for(i = 0; i < an_cnt; i++)
+   {
+      drops += s.ring_drops[i];
+   }
+   n = s.epochs - s0.epochs;
+   printf("%6.1f s: %u records, %u epochs (%u quorum, %u deadline), %u short, %u gap, %u dup, %u late, "
+         "%u resync, %u crc, %u ring drops, latency %.1f ms avg %.1f ms max\n", t, s.recs - s0.recs, n,
+         s.quorum - s0.quorum, s.deadline - s0.deadline, s.short_cnt - s0.short_cnt, s.gap - s0.gap, s.dup - s0.dup,
+         s.late - s0.late, s.resync - s0.resync, s.crc_err - s0.crc_err, drops,
+         n ? 1e3 * (s.latency_sum_s - s0.latency_sum_s) / n : 0.0, 1e3 * s.latency_max_s);
+   s0 = s;
+   if(tr != NULL)
+   {
+      printf("        trace: RX to READ p99 %.1f ms, READ to GROUP p99 %.1f ms, RX to GROUP p99 %.1f ms\n",
+            1e-3 * dwm_trace_quantile(tr, DWM_TRACE_READ, 0.99, false),
+            1e-3 * dwm_trace_quantile(tr, DWM_TRACE_GROUP, 0.99, false),
+            1e-3 * dwm_trace_quantile(tr, DWM_TRACE_GROUP, 0.99, true));
+      dwm_trace_dump(tr, trace_file);
+   }
+}
+
+int main(int argc, char*argv[])
+{
+   char name[256], *prefix = NULL;
+   double deadline_ms = 0, t0, t, t_print = 1;
+   int fd[DWM_INGEST_ANCHOR_MAX], opt, i, n, open_cnt;
+   int an_cnt = 6, quorum = 0, min_cnt = 4, port = ING_PORT;
+   long baud = 115200;
+   uint64_t bytes[DWM_INGEST_ANCHOR_MAX] = {0};
+   struct pollfd pfd[DWM_INGEST_ANCHOR_MAX];
+   struct sockaddr_in addr;
+   FILE *f[DWM_INGEST_ANCHOR_MAX];
+   uint8_t buf[2048];
+   dwm_ingest_t *ing;
+   dwm_ingest_stats_t s;
+
+   while((opt = getopt(argc, argv, "a:q:m:d:u:i:b:T:")) != -1)
+   {
+      switch(opt)
+      {
+         case 'a': an_cnt = atoi(optarg); break;
+         case 'q': quorum = atoi(optarg); break;
+         case 'm': min_cnt = atoi(optarg); break;
+         case 'd': deadline_ms = atof(optarg); break;
+         case 'u': port = atoi(optarg); break;
+         case 'i': prefix = optarg; break;
+         case 'b': baud = atol(optarg); break;
+         case 'T': trace_file = optarg; break;
+         default:
+            fprintf(stderr, "usage: %s [-a anchors] [-q quorum] [-m min_cnt] [-d deadline_ms] [-u port | -i prefix] "
+                  "[-b baud] [-T trace_file]\n", argv[0]);
+            return 1;
+      }
+   }
+   if((an_cnt < 1) || (an_cnt > DWM_INGEST_ANCHOR_MAX) || (baud <= 0) ||
+         (dwm_ingest_init(&ing, an_cnt, quorum, min_cnt, deadline_ms * 1e-3, on_epoch, NULL) != RV_OK))
+   {
+      fprintf(stderr, "ingest: 1 to %d anchors, min_cnt <= quorum <= anchors, baud > 0\n", DWM_INGEST_ANCHOR_MAX);
+      return 1;
+   }
+   if(trace_file != NULL)
+   {
+      if(dwm_trace_init(&tr) != RV_OK)
+      {
+         return 1;
+      }
+      dwm_ingest_trace_set(ing, tr);
+   }
+   signal(SIGINT, stop);
+   signal(SIGTERM, stop);
+
+   for(i = 0; i < an_cnt; i++)
+   {
+      if(prefix != NULL)
+      {
+         snprintf(name, sizeof(name), "%s%d.bin", prefix, i);
+         f[i] = fopen(name, "rb");
+         if(f[i] == NULL)
+         {
+            fprintf(stderr, "ingest: cannot read %s\n", name);
+            return 1;
+         }
+         continue;
+      }
+      memset(&addr, 0, sizeof(addr));
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_ANY);
+      addr.sin_port = htons(port + i);
+      fd[i] = socket(AF_INET, SOCK_DGRAM, 0);
+      if((fd[i] < 0) || (bind(fd[i], (struct sockaddr*)&addr, sizeof(addr)) != 0))
+      {
+         fprintf(stderr, "ingest: cannot bind UDP port %d\n", port + i);
+         return 1;
+      }
+      pfd[i].fd = fd[i];
+      pfd[i].events = POLLIN;
+   }
+
+   t0 = now_s();
+   t = 0;
+   for(open_cnt = an_cnt; running && (open_cnt > 0); )
+   {
+      if(prefix != NULL)
+      {
+         // the anchor furthest behind in time goes next
+         for(i = 0, n = -1; i < an_cnt; i++)
+         {
+            if((f[i] != NULL) && ((n < 0) || (bytes[i] < bytes[n])))
+            {
+               n = i;
+            }
+         }
+         i = n;
+         n = fread(buf, 1, ING_FILE_CHUNK, f[i]);
+         if(n <= 0)
+         {
+            fclose(f[i]);
+            f[i] = NULL;
+            open_cnt--;
+            continue;
+         }
+         bytes[i] += n;
+         t = bytes[i] * 10.0 / baud;
+         dwm_ingest_rx(ing, i, buf, n, t);
+      }
+      else
+      {
+         if(poll(pfd, an_cnt, ING_POLL_MS) > 0)
+         {
+            for(i = 0; i < an_cnt; i++)
+            {
+               if(pfd[i].revents & POLLIN)
+               {
+                  n = recv(fd[i], buf, sizeof(buf), 0);
+                  if(n > 0)
+                  {
+                     dwm_ingest_rx(ing, i, buf, n, now_s() - t0);
+                  }
+               }
+            }
+         }
+         t = now_s() - t0;
+         dwm_ingest_poll(ing, t);
+      }
+      if(t >= t_print)
+      {
+         print_stats(ing, t, an_cnt);
+         t_print += 1;
+      }
+   }
+   dwm_ingest_flush(ing, t);
+   print_stats(ing, t, an_cnt);
+
+   dwm_ingest_stats(ing, &s);
+   printf("ingest: %u records, %u epochs, %u short, %u gap, %u dup, %u late, anchors per epoch:",
+         s.recs, s.epochs, s.short_cnt, s.gap, s.dup, s.late);
+   for(i = 1; i <= an_cnt; i++)
+   {
+      printf(" %d:%u", i, cnt_hist[i]);
+   }
+   printf("\n");
+   dwm_ingest_deinit(ing);
+   if(tr != NULL)
+   {
+      dwm_trace_deinit(tr);
+   }
+   return 0;
+}
@@ -0,0 +1,350 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    ext_api_bench.c
+ * @brief   benchmark mode of ext_api_fulltest: latency of the API calls over
+ *          the interface of the build
+ *
+ *          Each call of the table is run k times and timed with
+ *          HAL_GetTimeNs(), on the raw monotonic clock. The calls only read
+ *          the module or leave it as it was, the setters writing the flash
+ *          and the resets are not timed. The report has one line per call:
+ *             interface,call,k,fail,min_ns,mean_ns,p50_ns,p90_ns,p99_ns,max_ns,tx_p50_ns,wait_size_p50_ns,wait_data_p50_ns
+ *          the last three are the transport phases of hal_stat.h, 0 unless
+ *          built with HAL_STAT_ENABLED = 1.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "dwm_api.h"
+#include "hal.h"
+#include "hal_log.h"
+#include "hal_stat.h"
+#include "ext_api_bench.h"
+
+#define BENCH_GPIO_IDX        DWM_GPIO_IDX_13
+#define BENCH_LINE_MAX        256
+#define BENCH_NAME_MAX        32
+#define BENCH_BASE_MAX        256      // lines of a baseline
+#define BENCH_HEADER          "interface,call,k,fail,min_ns,mean_ns,p50_ns,p90_ns,p99_ns,max_ns,tx_p50_ns,wait_size_p50_ns,wait_data_p50_ns"
+
+typedef struct {
+   const char* name;
+   int (*call)(void);
+} bench_call_t;
+
+typedef struct {
+   char iface[BENCH_NAME_MAX];
+   char call[BENCH_NAME_MAX];
+   unsigned long fail;
+   unsigned long long p50;
+   unsigned long long p99;
+} bench_line_t;
+
+static int bench_pos_get(void)
+{
+   dwm_pos_t pos;
+   return dwm_pos_get(&pos);
+}
+
+static int bench_loc_get(void)
+{
+   dwm_loc_data_t loc;
+   dwm_pos_t pos;
+   loc.p_pos = &pos;
+   return dwm_loc_get(&loc);
+}
+
+static int bench_upd_rate_get(void)
+{
+   uint16_t ur, urs;
+   return dwm_upd_rate_get(&ur, &urs);
+}
+
+static int bench_cfg_get(void)
+{
+   dwm_cfg_t cfg;
+   return dwm_cfg_get(&cfg);
+}
+
+static int bench_ver_get(void)
+{
+   dwm_ver_t ver;
+   return dwm_ver_get(&ver);
+}
+
+static int bench_stnry_cfg_get(void)
+{
+   dwm_stnry_sensitivity_t sensitivity;
+   return dwm_stnry_cfg_get(&sensitivity);
+}
+
+static int bench_baddr_get(void)
+{
+   dwm_baddr_t baddr;
+   return dwm_baddr_get(&baddr);
+}
+
+static int bench_status_get(void)
+{
+   dwm_status_t status;
+   return dwm_status_get(&status);
+}
+
+static int bench_int_cfg_get(void)
+{
+   uint16_t value;
+   return dwm_int_cfg_get(&value);
+}
+
+static int bench_panid_get(void)
+{
+   uint16_t panid;
+   return dwm_panid_get(&panid);
+}
+
+static int bench_node_id_get(void)
+{
+   uint64_t node_id;
+   return dwm_node_id_get(&node_id);
+}
+
+static int bench_uwb_cfg_get(void)
+{
+   dwm_uwb_cfg_t cfg;
+   return dwm_uwb_cfg_get(&cfg);
+}
+
+static int bench_label_read(void)
+{
+   uint8_t label[DWM_LABEL_LEN_MAX], len = DWM_LABEL_LEN_MAX;
+   return dwm_label_read(label, &len);
+}
+
+static int bench_preamble_code_get(void)
+{
+   dwm_uwb_preamble_code_t code;
+   return dwm_uwb_preamble_code_get(&code);
+}
+
+static int bench_gpio_value_get(void)
+{
+   bool value;
+   return dwm_gpio_value_get(BENCH_GPIO_IDX, &value);
+}
+
+static const bench_call_t bench_calls[] = {
+   {"dwm_pos_get", bench_pos_get},
+   {"dwm_loc_get", bench_loc_get},
+   {"dwm_upd_rate_get", bench_upd_rate_get},
+   {"dwm_cfg_get", bench_cfg_get},
+   {"dwm_ver_get", bench_ver_get},
+   {"dwm_stnry_cfg_get", bench_stnry_cfg_get},
+   {"dwm_baddr_get", bench_baddr_get},
+   {"dwm_status_get", bench_status_get},
+   {"dwm_int_cfg_get", bench_int_cfg_get},
+   {"dwm_panid_get", bench_panid_get},
+   {"dwm_node_id_get", bench_node_id_get},
+   {"dwm_uwb_cfg_get", bench_uwb_cfg_get},
+   {"dwm_label_read", bench_label_read},
+   {"dwm_uwb_preamble_code_get", bench_preamble_code_get},
+   {"dwm_gpio_value_get", bench_gpio_value_get},
+};
+
+#define BENCH_CALL_NUM  (sizeof(bench_calls)/sizeof(bench_calls[0]))
+
+static int Bench_CmpNs(const void* a, const void* b)
+{
+   uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+   return (x > y) - (x < y);
+}
+
+// nearest rank of the sorted latencies
+static uint64_t Bench_Percentile(const uint64_t* ns, int k, int pct10)
+{
+   int rank = (int)(((int64_t)k*pct10 + 999)/1000);
+   return ns[(rank > 0)? rank-1 : 0];
+}
+
+/**
+ * @brief runs each API call of the benchmark k times and writes the latency
+ *        report, one line per call
+ *
+ * @param[in] k, calls of each API, after one warm up call
+ * @param[in] report_path, report file, appended, NULL for stdout
+ *
+ * @return number of failed calls
+ */
+int Bench_Run(int k, const char* report_path)
+{
+   uint64_t* ns;
+   uint64_t t, sum;
+   hal_stat_t tx, wait_size, wait_data;
+   FILE* f = stdout;
+   int i, j, fail, fail_total = 0;
+
+   if(k <= 0)
+   {
+      return 0;
+   }
+   ns = malloc(sizeof(uint64_t)*k);
+   if(ns == NULL)
+   {
+      HAL_LogErr("bench: no memory for %d latencies\n", k);
+      return k;
+   }
+   if(report_path != NULL)
+   {
+      f = fopen(report_path, "a");
+      if(f == NULL)
+      {
+         HAL_LogErr("bench: can not open %s\n", report_path);
+         free(ns);
+         return k;
+      }
+   }
+
+   fseek(f, 0, SEEK_END);
+   if(ftell(f) <= 0)
+   {
+      fprintf(f, "# %s\n", BENCH_HEADER);
+   }
+
+   for(i = 0; i < (int)BENCH_CALL_NUM; i++)
+   {
+      bench_calls[i].call();
+      HAL_Stat_Reset();
+      fail = 0;
+      sum = 0;
+      for(j = 0; j < k; j++)
+      {
+         t = HAL_GetTimeNs();
+         fail += (bench_calls[i].call() != RV_OK);
+         ns[j] = HAL_GetTimeNs() - t;
+         sum += ns[j];
+      }
+      qsort(ns, k, sizeof(uint64_t), Bench_CmpNs);
+      HAL_Stat_Get(HAL_STAT_TX, &tx);
+      HAL_Stat_Get(HAL_STAT_WAIT_SIZE, &wait_size);
+      HAL_Stat_Get(HAL_STAT_WAIT_DATA, &wait_data);
+
+      fprintf(f, "%s,%s,%d,%d,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n", HAL_IF_STR, bench_calls[i].name, k, fail,
+         (unsigned long long)ns[0], (unsigned long long)(sum/k),
+         (unsigned long long)Bench_Percentile(ns, k, 500), (unsigned long long)Bench_Percentile(ns, k, 900),
+         (unsigned long long)Bench_Percentile(ns, k, 990), (unsigned long long)ns[k-1],
+         (unsigned long long)tx.p50, (unsigned long long)wait_size.p50, (unsigned long long)wait_data.p50);
+      printf("%s %-28s p50 %8.1f us  p99 %8.1f us  fail %d/%d\n", (fail > 0)? "ERR" : "   ", bench_calls[i].name,
+         Bench_Percentile(ns, k, 500)/1000.0, Bench_Percentile(ns, k, 990)/1000.0, fail, k);
+      fail_total += fail;
+   }
+
+   if(f != stdout)
+   {
+      fclose(f);
+   }
+   free(ns);
+   return fail_total;
+}
+
+// reads the lines of a report, the lines starting with '#' are comments
+static int Bench_Load(const char* path, bench_line_t* line, int max)
+{
+   char buf[BENCH_LINE_MAX];
+   unsigned long long min, mean, p90;
+   unsigned long k;
+   int cnt = 0;
+   FILE* f = fopen(path, "r");
+
+   if(f == NULL)
+   {
+      HAL_LogErr("bench: can not open %s\n", path);
+      return -1;
+   }
+   while((cnt < max) && (fgets(buf, sizeof(buf), f) != NULL))
+   {
+      if(buf[0] == '#')
+      {
+         continue;
+      }
+      if(sscanf(buf, "%31[^,],%31[^,],%lu,%lu,%llu,%llu,%llu,%llu,%llu", line[cnt].iface, line[cnt].call, &k,
+         &line[cnt].fail, &min, &mean, &line[cnt].p50, &p90, &line[cnt].p99) == 9)
+      {
+         cnt++;
+      }
+   }
+   fclose(f);
+   return cnt;
+}
+
+// 1 if now rose over base by more than tol_pct % and BENCH_FLOOR_NS
+static int Bench_Rise(unsigned long long now, unsigned long long base, int tol_pct)
+{
+   return (now > base + BENCH_FLOOR_NS) && (now*100 > base*(100 + tol_pct));
+}
+
+/**
+ * @brief compares a report with a baseline report, the lines of the same
+ *        interface and call are compared, the others are ignored
+ *
+ * @param[in] report_path, report of Bench_Run()
+ * @param[in] baseline_path, stored report
+ * @param[in] tol_pct, rise of the p50 or p99 latency flagged as a regression
+ *
+ * @return number of regressions, -1 if a file can not be read
+ */
+int Bench_Compare(const char* report_path, const char* baseline_path, int tol_pct)
+{
+   static bench_line_t now[BENCH_BASE_MAX], base[BENCH_BASE_MAX];
+   int now_cnt, base_cnt, i, j, reg = 0;
+
+   now_cnt = Bench_Load(report_path, now, BENCH_BASE_MAX);
+   base_cnt = Bench_Load(baseline_path, base, BENCH_BASE_MAX);
+   if((now_cnt < 0) || (base_cnt < 0))
+   {
+      return -1;
+   }
+
+   for(i = 0; i < now_cnt; i++)
+   {
+      // the last line of a call counts, the reports are appended to
+      for(j = i+1; j < now_cnt; j++)
+      {
+         if((strcmp(now[i].iface, now[j].iface) == 0) && (strcmp(now[i].call, now[j].call) == 0))
+         {
+            break;
+         }
+      }
+      if(j < now_cnt)
+      {
+         continue;
+      }
+      for(j = base_cnt-1; j >= 0; j--)
+      {
+         if((strcmp(now[i].iface, base[j].iface) == 0) && (strcmp(now[i].call, base[j].call) == 0))
+         {
+            break;
+         }
+      }
+      if(j < 0)
+      {
+         printf("NEW %s %s: no baseline\n", now[i].iface, now[i].call);
+         continue;
+      }
+      if(Bench_Rise(now[i].p50, base[j].p50, tol_pct) || Bench_Rise(now[i].p99, base[j].p99, tol_pct)
+         || (now[i].fail > base[j].fail))
+      {
+         printf("REG %s %s: p50 %.1f -> %.1f us, p99 %.1f -> %.1f us, fail %lu -> %lu\n", now[i].iface, now[i].call,
+            base[j].p50/1000.0, now[i].p50/1000.0, base[j].p99/1000.0, now[i].p99/1000.0, base[j].fail, now[i].fail);
+         reg++;
+      }
+   }
+   printf("%d regressions over %s, tolerance %d %%\n", reg, baseline_path, tol_pct);
+   return reg;
+}
@@ -0,0 +1,45 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    ext_api_bench.h
+ * @brief   benchmark mode of ext_api_fulltest: latency of the API calls over
+ *          the interface of the build
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _EXT_API_BENCH_H_
+#define _EXT_API_BENCH_H_
+
+#define BENCH_TOL_PCT_DEFAULT    10       // latency rise flagged as a regression, %
+#define BENCH_FLOOR_NS           20000    // latency rise always within the noise, ns
+
+/**
+ * @brief runs each API call of the benchmark k times and writes the latency
+ *        report, one line per call
+ *
+ * @param[in] k, calls of each API, after one warm up call
+ * @param[in] report_path, report file, appended, NULL for stdout
+ *
+ * @return number of failed calls
+ */
+int Bench_Run(int k, const char* report_path);
+
+/**
+ * @brief compares a report with a baseline report, the lines of the same
+ *        interface and call are compared, the others are ignored
+ *
+ * @param[in] report_path, report of Bench_Run()
+ * @param[in] baseline_path, stored report, e.g. the reports of the three
+ *            interfaces concatenated
+ * @param[in] tol_pct, rise of the p50 or p99 latency over the baseline,
+ *            and over BENCH_FLOOR_NS, flagged as a regression
+ *
+ * @return number of regressions, -1 if a file can not be read
+ */
+int Bench_Compare(const char* report_path, const char* baseline_path, int tol_pct);
+
+#endif //_EXT_API_BENCH_H_
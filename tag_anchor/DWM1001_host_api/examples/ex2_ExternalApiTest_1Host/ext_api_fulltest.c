@@ -11,10 +11,13 @@
  */
 
 #include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
 #include "dwm_api.h"
 #include "hal.h"
 #include "hal_log.h"
 #include "../test_util/test_util.h"
+#include "ext_api_bench.h"
 
 int frst(void)
 {
@@ -999,9 +1002,41 @@ void example_external_api_fulltest(void)
    Test_End();
 }
 
+// -b k runs the benchmark instead of the test, see ext_api_bench.c
 int main(int argc, char*argv[])
 {   
-   int k=1;
+   int k=1, opt, bench_k = 0, tol_pct = BENCH_TOL_PCT_DEFAULT, rv = 0;
+   const char* report_path = NULL;
+   const char* baseline_path = NULL;
+   
+   while((opt = getopt(argc, argv, "b:o:c:t:")) != -1)
+   {
+      switch(opt)
+      {
+         case 'b': bench_k = atoi(optarg); break;
+         case 'o': report_path = optarg; break;
+         case 'c': baseline_path = optarg; break;
+         case 't': tol_pct = atoi(optarg); break;
+         default:
+            fprintf(stderr, "usage: %s [-b k [-o report.csv] [-c baseline.csv] [-t tol_pct]]\n", argv[0]);
+            return 1;
+      }
+   }
+   
+   if(bench_k > 0)
+   {
+      // only the errors are logged, the log file would be timed with the calls
+      HAL_Log_SetLevel(HAL_LOG_LVL_ERR);
+      dwm_init();
+      Bench_Run(bench_k, report_path);
+      if((baseline_path != NULL) && (report_path != NULL))
+      {
+         // regressions or an unreadable file fail the run
+         rv = (Bench_Compare(report_path, baseline_path, tol_pct) != 0);
+      }
+      return rv;
+   }
+   
    while(k-->0)
    {
       example_external_api_fulltest();
@@ -1,6 +1,9 @@
 /*! ------------------------------------------------------------------------------------------------------------------
  * @file    test_les.c
- * @brief   Setup the node as a tag and print out the RTLS info.
+ * @brief   Setup the node as a tag and print out the RTLS info, streamed on 
+ *          the location ready interrupt.
+ *          With a file name argument the locations are written to that 
+ *          binary record file instead, see dwm_rec.h, until Ctrl-C.
  *          In this example, the steps to configure the Tag include:
  *          Tag mode, PANID, encryption key, update rate. 
  *          According to the network settings, some of these settings 
@@ -15,17 +18,23 @@
  */
 
 #include <string.h>
+#include <signal.h>
 #include "dwm_api.h"
+#include "dwm_api_stream.h"
+#include "dwm_rec.h"
 #include "hal.h"
 #include "hal_log.h"
-#include "hal_gpio.h"
 #include "../test_util/test_util.h"
-#include <sys/time.h>
 
-struct timeval tv;
-uint64_t ts_curr = 0;
-uint64_t ts_last = 0;
-volatile uint8_t data_ready;
+static dwm_rec_writer_t rec_w;
+static const char* rec_path = NULL;
+static uint64_t rec_node_id = 0;
+static volatile sig_atomic_t running = 1;
+
+static void stop(int sig)
+{
+   running = 0;
+}
    
 int frst(void)
 {
@@ -51,21 +60,22 @@ int frst(void)
    
 int get_loc(void)
 {
-   // ========== dwm_loc_get ==========
+   // ========== dwm_stream_read ==========
    int rv, err_cnt = 0, i; 
    
+   dwm_stream_rec_t rec;
    dwm_loc_data_t loc;
-   dwm_pos_t pos;
-   loc.p_pos = &pos;
-   HAL_Log("dwm_loc_get(&loc)\n");
-   rv = Test_CheckTxRx(dwm_loc_get(&loc));
-   
-   gettimeofday(&tv,NULL);      
+   rv = dwm_stream_read(&rec, -1);
       
-   if(rv == RV_OK)
+   if((rv == RV_OK) && (rec_path != NULL))
+   {
+      rv = dwm_rec_append(&rec_w, rec.ts, rec.seq, rec_node_id, &rec.loc);
+   }
+   else if(rv == RV_OK)
    {
-      HAL_Log("ts:%ld.%06ld [%d,%d,%d,%u]\n", tv.tv_sec, tv.tv_usec, loc.p_pos->x, loc.p_pos->y, loc.p_pos->z, loc.p_pos->qf);
-      printf("ts:%ld.%06ld [%d,%d,%d,%u]", tv.tv_sec, tv.tv_usec, loc.p_pos->x, loc.p_pos->y, loc.p_pos->z, loc.p_pos->qf);
+      loc = rec.loc;
+      HAL_Log("ts:%lu.%06lu seq:%u [%d,%d,%d,%u]\n", (unsigned long)(rec.ts/1000000), (unsigned long)(rec.ts%1000000), rec.seq, loc.p_pos->x, loc.p_pos->y, loc.p_pos->z, loc.p_pos->qf);
+      printf("ts:%lu.%06lu seq:%u [%d,%d,%d,%u]", (unsigned long)(rec.ts/1000000), (unsigned long)(rec.ts%1000000), rec.seq, loc.p_pos->x, loc.p_pos->y, loc.p_pos->z, loc.p_pos->qf);
 
       for (i = 0; i < loc.anchors.dist.cnt; ++i) 
       {
@@ -191,11 +201,6 @@ int setup_enc()
    printf("%s %s: err_cnt = %d\n", (err_cnt >0)? "ERR" : "   ", __FUNCTION__, err_cnt);
    return err_cnt;
 }
-void gpio_cb(void)
-{
-   data_ready = 1;
-}
-
 
 void spi_les_test(void)
 {   
@@ -227,22 +232,35 @@ void spi_les_test(void)
    HAL_Log("dwm_panid_set(panid);\n");
    dwm_panid_set(panid);
    
-   // setup GPIO interrupt from "LOC_READY" event
-   HAL_Log("dwm_int_cfg_set(DWM1001_INTR_LOC_READY);\n");
-   dwm_int_cfg_set(DWM1001_INTR_LOC_READY);
-   HAL_GPIO_SetupCb(HAL_GPIO_DRDY, HAL_GPIO_INT_EDGE_RISING, &gpio_cb);
-   
    // setup encryption key for network
    setup_enc();
    
-   while(1)
+   if(rec_path != NULL)
    {
-      if(data_ready == 1)
+      HAL_Log("dwm_node_id_get(&rec_node_id);\n");
+      err_cnt += Test_CheckTxRx(dwm_node_id_get(&rec_node_id));
+      if(dwm_rec_open(&rec_w, rec_path) != RV_OK)
       {
-         data_ready = 0;
-         get_loc();
+         printf("cannot create %s\n", rec_path);
+         return;
       }
-      HAL_Delay(1);
+      signal(SIGINT, stop);
+   }
+   
+   // stream the locations on the "LOC_READY" interrupt
+   HAL_Log("dwm_stream_init();\n");
+   err_cnt += Test_CheckTxRx(dwm_stream_init());
+   
+   while(running)
+   {
+      get_loc();
+   }
+   
+   if(rec_path != NULL)
+   {
+      dwm_stream_deinit();
+      dwm_rec_close(&rec_w);
+      printf("%s written, %u locations dropped\n", rec_path, dwm_stream_dropped());
    }
    
    HAL_Log("err_cnt = %d \n", err_cnt);
@@ -253,6 +271,10 @@ void spi_les_test(void)
 int main(int argc, char*argv[])
 {   
    int k=1;
+   if(argc > 1)
+   {
+      rec_path = argv[1];
+   }
    while(k-->0)
    {
       spi_les_test();
@@ -0,0 +1,86 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    rec2csv.c
+ * @brief   Converts a binary location record file, see dwm_rec.h, to CSV.
+ *          The columns follow the Simulator+Localizer logs: Sample_idx, 
+ *          sample_time in s from the first record, the module position as 
+ *          filtEstX/filtEstY in m, rounded to 4 decimals, then the record 
+ *          fields and the distances to the ranging anchors. 
+ *
+ *          usage: rec2csv file.rec [node_id] > file.csv 
+ *          with node_id, in hex, only the records of that node are written, 
+ *          as a log holds the track of one node. 
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "dwm_rec.h"
+
+int main(int argc, char*argv[])
+{
+   dwm_rec_reader_t r;
+   const dwm_rec_t *rec;
+   uint64_t node_id = 0, t0 = 0;
+   uint32_t i, idx = 0;
+   int filter = 0, k;
+
+   if(argc < 2)
+   {
+      fprintf(stderr, "usage: %s file.rec [node_id]\n", argv[0]);
+      return 1;
+   }
+   if(argc > 2)
+   {
+      node_id = strtoull(argv[2], NULL, 16);
+      filter = 1;
+   }
+   if(dwm_rec_map(&r, argv[1]) != RV_OK)
+   {
+      fprintf(stderr, "%s: not a record file\n", argv[1]);
+      return 1;
+   }
+
+   printf("Sample_idx,sample_time,filtEstX,filtEstY,filtEstZ,qf,node_id,seq,an_cnt");
+   for(k = 0; k < DWM_RANGING_ANCHOR_CNT_MAX; k++)
+   {
+      printf(",an%d_addr,an%d_dist,an%d_qf", k, k, k);
+   }
+   printf("\n");
+
+   for(i = 0; i < r.cnt; i++)
+   {
+      rec = dwm_rec_at(&r, i);
+      if(filter && (rec->node_id != node_id))
+      {
+         continue;
+      }
+      if(idx == 0)
+      {
+         t0 = rec->ts;
+      }
+      printf("%u,%.4f,%.4f,%.4f,%.4f,%u,0x%016llx,%u,%u", idx++, (double)(rec->ts - t0)/1000000, \
+      rec->x/1000.0, rec->y/1000.0, rec->z/1000.0, rec->qf, (unsigned long long)rec->node_id, rec->seq, rec->cnt);
+      for(k = 0; k < DWM_RANGING_ANCHOR_CNT_MAX; k++)
+      {
+         if(k < rec->cnt)
+         {
+            printf(",0x%04x,%.4f,%u", rec->an[k].addr, rec->an[k].dist/1000.0, rec->an[k].qf);
+         }
+         else
+         {
+            printf(",,,");
+         }
+      }
+      printf("\n");
+   }
+
+   dwm_rec_unmap(&r);
+   return 0;
+}
@@ -0,0 +1,323 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    loc_pub.c
+ * @brief   Location publisher daemon: streams the locations of the module
+ *          on the location ready interrupt and publishes them in binary
+ *          frames, over UDP multicast or to the TCP clients.
+ *          Several locations are batched per frame, a frame is sent once
+ *          full or FLUSH_MS after its first location.
+ *
+ *          usage: loc_pub [-u group:port | -t port] [-f flush_ms] [-T trace_file]
+ *          default: UDP multicast to 239.255.77.1:1234
+ *
+ *          The frame format is described in loc_frame.h, the frames carry
+ *          the node id of the module.
+ *
+ *          With -T the READ stage, the location ready interrupt, and the
+ *          PUB stage, the frame sent, of each location are traced with
+ *          dwm_trace.h, the histograms are written to trace_file every
+ *          second.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "dwm_api.h"
+#include "dwm_api_stream.h"
+#include "hal.h"
+#include "hal_log.h"
+#include "dwm_trace.h"
+#include "../loc_frame/loc_frame.h"
+
+#define PUB_GROUP          "239.255.77.1"
+#define PUB_PORT           1234
+#define PUB_FLUSH_MS       20
+#define PUB_IDLE_MS        100      /* wait for a location while the frame is empty */
+#define PUB_CLIENT_MAX     8
+#define PUB_TRACE_MS       1000     /* trace file written every second */
+
+static volatile sig_atomic_t running = 1;
+static int udp_fd = -1, tcp_fd = -1;
+static int clients[PUB_CLIENT_MAX];
+static int client_cnt = 0;
+static struct sockaddr_in group_addr;
+
+static loc_frame_t frame;
+static uint64_t frame_ts = 0;       /* HAL_GetTime64() time of the first location of the frame */
+static uint64_t node_id = 0;
+static int64_t wall_offset = 0;     /* wall clock - HAL_GetTime64(), in us */
+static dwm_trace_t *tr = NULL;
+static uint32_t frame_seqs[LOC_FRAME_MAX / LOC_FRAME_LOC_LEN];  /* of the locations of the frame, for the trace */
+
+static void stop(int sig)
+{
+   (void)sig;
+   running = 0;
+}
+
+/**
+ * @brief opens the UDP socket, the frames are sent to group_addr
+ */
+static int pub_udp_open(const char* group, int port)
+{
+   unsigned char ttl = 1;
+
+   memset(&group_addr, 0, sizeof(group_addr));
+   group_addr.sin_family = AF_INET;
+   group_addr.sin_port = htons(port);
+   if(inet_pton(AF_INET, group, &group_addr.sin_addr) != 1)
+   {
+      return -1;
+   }
+   udp_fd = socket(AF_INET, SOCK_DGRAM, 0);
+   if(udp_fd < 0)
+   {
+      return -1;
+   }
+   setsockopt(udp_fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+   return 0;
+}
+
+/**
+ * @brief opens the TCP listening socket, the clients are accepted in pub_tcp_accept()
+ */
+static int pub_tcp_open(int port)
+{
+   struct sockaddr_in addr;
+   int on = 1;
+
+   tcp_fd = socket(AF_INET, SOCK_STREAM, 0);
+   if(tcp_fd < 0)
+   {
+      return -1;
+   }
+   setsockopt(tcp_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family = AF_INET;
+   addr.sin_port = htons(port);
+   addr.sin_addr.s_addr = htonl(INADDR_ANY);
+   if((bind(tcp_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) || (listen(tcp_fd, PUB_CLIENT_MAX) != 0))
+   {
+      close(tcp_fd);
+      tcp_fd = -1;
+      return -1;
+   }
+   return 0;
+}
+
+/**
+ * @brief accepts the pending TCP clients, without waiting
+ */
+static void pub_tcp_accept(void)
+{
+   struct pollfd pfd = { tcp_fd, POLLIN, 0 };
+   int fd;
+
+   while((poll(&pfd, 1, 0) > 0) && (pfd.revents & POLLIN))
+   {
+      fd = accept(tcp_fd, NULL, NULL);
+      if(fd < 0)
+      {
+         return;
+      }
+      if(client_cnt == PUB_CLIENT_MAX)
+      {
+         close(fd);
+         continue;
+      }
+      clients[client_cnt++] = fd;
+      HAL_Log("loc_pub: client %d connected\n", fd);
+   }
+}
+
+/**
+ * @brief sends the frame and starts the next one
+ */
+static void pub_flush(void)
+{
+   uint16_t len = LocFrame_Close(&frame);
+   int i;
+
+   if(len == 0)
+   {
+      return;
+   }
+   if(udp_fd >= 0)
+   {
+      sendto(udp_fd, frame.data, len, 0, (struct sockaddr*)&group_addr, sizeof(group_addr));
+   }
+   if(tr != NULL)
+   {
+      for(i = 0; i < frame.cnt; i++)
+      {
+         dwm_trace_stamp(tr, DWM_TRACE_PUB, node_id, frame_seqs[i], dwm_trace_now_us());
+      }
+   }
+   // a client too slow to take a whole frame is dropped, the others must not wait
+   for(i = 0; i < client_cnt; i++)
+   {
+      if(send(clients[i], frame.data, len, MSG_DONTWAIT | MSG_NOSIGNAL) != len)
+      {
+         HAL_Log("loc_pub: client %d dropped\n", clients[i]);
+         close(clients[i]);
+         clients[i--] = clients[--client_cnt];
+      }
+   }
+   LocFrame_Reset(&frame);
+}
+
+/**
+ * @brief appends a location to the frame, the frame is sent first if full
+ */
+static void pub_add(const dwm_stream_rec_t* rec)
+{
+   const dwm_distance_t *d = &rec->loc.anchors.dist;
+   loc_frame_loc_t loc;
+   uint8_t i;
+
+   loc.ts = rec->ts + wall_offset;
+   loc.node_id = node_id;
+   loc.seq = rec->seq;
+   loc.x = rec->pos.x;
+   loc.y = rec->pos.y;
+   loc.z = rec->pos.z;
+   loc.qf = rec->pos.qf;
+   loc.cnt = (d->cnt < DWM_RANGING_ANCHOR_CNT_MAX) ? d->cnt : DWM_RANGING_ANCHOR_CNT_MAX;
+   for(i = 0; i < loc.cnt; i++)
+   {
+      loc.addr[i] = d->addr[i];
+      loc.dist[i] = d->dist[i];
+      loc.dist_qf[i] = d->qf[i];
+   }
+   if(LocFrame_Add(&frame, &loc) != 0)
+   {
+      pub_flush();
+      LocFrame_Add(&frame, &loc);
+   }
+   if(tr != NULL)
+   {
+      frame_seqs[frame.cnt - 1] = loc.seq;
+      dwm_trace_stamp(tr, DWM_TRACE_READ, node_id, loc.seq, loc.ts);
+   }
+   if(frame.cnt == 1)
+   {
+      frame_ts = HAL_GetTime64();
+   }
+}
+
+int main(int argc, char*argv[])
+{
+   dwm_stream_rec_t rec;
+   struct timeval tv;
+   char group[32] = PUB_GROUP;
+   int port = PUB_PORT, tcp = 0, flush_ms = PUB_FLUSH_MS;
+   int opt, wait_ms;
+   char *colon, *trace_file = NULL;
+   uint64_t trace_ts = 0;
+
+   while((opt = getopt(argc, argv, "u:t:f:T:")) != -1)
+   {
+      switch(opt)
+      {
+         case 'u':
+            snprintf(group, sizeof(group), "%s", optarg);
+            colon = strchr(group, ':');
+            if(colon != NULL)
+            {
+               *colon = 0;
+               port = atoi(colon+1);
+            }
+            break;
+         case 't': tcp = 1; port = atoi(optarg); break;
+         case 'f': flush_ms = atoi(optarg); break;
+         case 'T': trace_file = optarg; break;
+         default:
+            fprintf(stderr, "usage: %s [-u group:port | -t port] [-f flush_ms] [-T trace_file]\n", argv[0]);
+            return 1;
+      }
+   }
+   if((tcp ? pub_tcp_open(port) : pub_udp_open(group, port)) != 0)
+   {
+      fprintf(stderr, "loc_pub: cannot open the %s socket on port %d\n", tcp ? "TCP" : "UDP", port);
+      return 1;
+   }
+   if((trace_file != NULL) && (dwm_trace_init(&tr) != RV_OK))
+   {
+      fprintf(stderr, "loc_pub: cannot trace\n");
+      return 1;
+   }
+   signal(SIGINT, stop);
+   signal(SIGTERM, stop);
+
+   dwm_init();
+   if(dwm_node_id_get(&node_id) != RV_OK)
+   {
+      fprintf(stderr, "loc_pub: no module\n");
+      return 1;
+   }
+   if(dwm_stream_init() != RV_OK)
+   {
+      fprintf(stderr, "loc_pub: cannot stream the locations\n");
+      return 1;
+   }
+   gettimeofday(&tv, NULL);
+   wall_offset = (int64_t)tv.tv_sec*1000000 + tv.tv_usec - (int64_t)HAL_GetTime64();
+
+   LocFrame_Init(&frame, node_id);
+   printf("loc_pub: node 0x%016llx on %s %s:%d\n", (unsigned long long)node_id, tcp ? "TCP" : "UDP", tcp ? "*" : group, port);
+
+   while(running)
+   {
+      if(tcp)
+      {
+         pub_tcp_accept();
+      }
+      // wait for a location until the frame is due
+      wait_ms = PUB_IDLE_MS;
+      if(frame.cnt > 0)
+      {
+         wait_ms = flush_ms - (int)((HAL_GetTime64() - frame_ts) / 1000);
+         if(wait_ms < 0)
+         {
+            wait_ms = 0;
+         }
+      }
+      if(dwm_stream_read(&rec, wait_ms) == RV_OK)
+      {
+         pub_add(&rec);
+      }
+      if((frame.cnt > 0) && (HAL_GetTime64() - frame_ts >= (uint64_t)flush_ms*1000))
+      {
+         pub_flush();
+      }
+      if((tr != NULL) && (HAL_GetTime64() - trace_ts >= PUB_TRACE_MS*1000))
+      {
+         trace_ts = HAL_GetTime64();
+         dwm_trace_dump(tr, trace_file);
+      }
+   }
+
+   pub_flush();
+   if(tr != NULL)
+   {
+      dwm_trace_dump(tr, trace_file);
+      dwm_trace_deinit(tr);
+   }
+   dwm_stream_deinit();
+   printf("loc_pub: %u frames, %u locations dropped\n", frame.seq, dwm_stream_dropped());
+   return 0;
+}
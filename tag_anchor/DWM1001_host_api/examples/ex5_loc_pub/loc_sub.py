@@ -0,0 +1,77 @@
+# Receives the binary location frames of loc_pub or loc_agg and prints the locations.
+# usage: python3 loc_sub.py [group:port | tcp:host:port [node_id...]]
+# with node ids, in hex, loc_agg only sends the locations of these tags.
+import socket
+import struct
+import sys
+
+GROUP = "239.255.77.1"
+PORT = 1234
+HDR = struct.Struct("<4sBBHIQ")       # magic, version, cnt, len, seq, node_id
+LOC = struct.Struct("<QQIiiiBB")      # ts, node_id, seq, x, y, z, qf, an_cnt
+DIST = struct.Struct("<HIB")          # addr, dist, qf
+
+def parse(frame):
+    magic, version, cnt, length, seq, pub_id = HDR.unpack_from(frame)
+    if magic != b"DWMP" or length > len(frame):
+        return None
+    off = HDR.size
+    locs = []
+    for _ in range(cnt):
+        ts, node_id, loc_seq, x, y, z, qf, an_cnt = LOC.unpack_from(frame, off)
+        off += LOC.size
+        an = [DIST.unpack_from(frame, off + i*DIST.size) for i in range(an_cnt)]
+        off += an_cnt*DIST.size
+        locs.append({"ts": ts/1e6, "node_id": node_id, "seq": loc_seq, 
+                     "x": x/1000, "y": y/1000, "z": z/1000, "qf": qf, "an": an})
+    return seq, pub_id, locs
+
+def udp_frames(group, port):
+    s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    s.bind(("", port))
+    mreq = struct.pack("4s4s", socket.inet_aton(group), socket.inet_aton("0.0.0.0"))
+    s.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
+    while True:
+        yield s.recv(65536)
+
+def tcp_frames(host, port, tags):
+    s = socket.create_connection((host, port))
+    if tags:
+        s.sendall(("SUB " + " ".join(tags) + "\n").encode())
+    buf = b""
+    while True:
+        data = s.recv(65536)
+        if not data:
+            return
+        buf += data
+        # the frame length is in the header
+        while len(buf) >= HDR.size:
+            length = HDR.unpack_from(buf)[3]
+            if len(buf) < length:
+                break
+            yield buf[:length]
+            buf = buf[length:]
+
+def main():
+    arg = sys.argv[1] if len(sys.argv) > 1 else f"{GROUP}:{PORT}"
+    if arg.startswith("tcp:"):
+        _, host, port = arg.split(":")
+        frames = tcp_frames(host, int(port), sys.argv[2:])
+    else:
+        group, port = arg.split(":")
+        frames = udp_frames(group, int(port))
+    last = {}
+    for frame in frames:
+        res = parse(frame)
+        if res is None:
+            continue
+        seq, pub_id, locs = res
+        if pub_id in last and seq != last[pub_id] + 1:
+            print(f"node {pub_id:#x}: {seq - last[pub_id] - 1} frames lost")
+        last[pub_id] = seq
+        for l in locs:
+            print(f"{l['ts']:.6f} {l['node_id']:#x} #{l['seq']} [{l['x']:.3f},{l['y']:.3f},{l['z']:.3f},{l['qf']}] {len(l['an'])} anchors")
+
+if __name__ == "__main__":
+    main()
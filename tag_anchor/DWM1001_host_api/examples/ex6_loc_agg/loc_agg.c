@@ -0,0 +1,865 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    loc_agg.c
+ * @brief   Location aggregator: receives the binary frames of the loc_pub
+ *          publishers, merges their locations in time order and sends them
+ *          to the subscribers, filtered by tag.
+ *
+ *          usage: loc_agg [-u group:port] [-s host:port]... [-l port] [-d delay_ms] [-m shm_name]
+ *                         [-T trace_file]
+ *          default: UDP multicast 239.255.77.1:1234, subscribers on port 1235
+ *
+ *          All the sockets are served by one epoll loop. The locations of
+ *          each publisher go into its own ring, and on each tick the oldest
+ *          head of the rings is sent while every active publisher has a
+ *          location waiting, or once it is older than the delay: a
+ *          publisher late by less than the delay is still merged in order.
+ *          A publisher silent for AGG_IDLE_MS does not hold the merge.
+ *
+ *          A subscriber connects over TCP and may send a line
+ *          "SUB <node_id> <node_id>...\n" to receive only these tags, "SUB\n"
+ *          for all, the default. It receives loc_frame.h frames with the
+ *          node id 0. A subscriber too slow to take its frames loses frames,
+ *          seen as gaps in their seq, the others are not held.
+ *
+ *          With -m the merged locations are also written to the shared
+ *          memory ring of ../loc_shm/loc_shm.h, read in place by the local
+ *          consumers, loc_shm.py, without the sockets.
+ *
+ *          With -T the MERGE stage of each location is traced with
+ *          dwm_trace.h from its READ stage, the ts of the location on the
+ *          publisher host, the histograms are written to trace_file every
+ *          second.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include "../loc_frame/loc_frame.h"
+#include "../loc_shm/loc_shm.h"
+#include "dwm_trace.h"
+
+#define AGG_GROUP          "239.255.77.1"
+#define AGG_PORT           1234
+#define AGG_SUB_PORT       1235
+#define AGG_DELAY_MS       100      // longest wait for a late publisher
+#define AGG_IDLE_MS        1000     // publisher not waited for after this silence
+#define AGG_TRACE_MS       1000     // trace file written every second
+#define AGG_TICK_MS        10
+#define AGG_RECONNECT_MS   1000
+#define AGG_SRC_MAX        64       // publishers
+#define AGG_CONN_MAX       16       // TCP publishers
+#define AGG_SUB_MAX        32
+#define AGG_RING_LEN       256      // locations per publisher, power of 2
+#define AGG_FILTER_MAX     16       // tags per subscriber
+#define AGG_OUT_LEN        (64*1024) // bytes queued per subscriber
+#define AGG_EVENT_MAX      64
+
+enum { FD_TIMER, FD_UDP, FD_LISTEN, FD_CONN, FD_SUB };
+
+/**
+ * @brief epoll entry, the event data points to it
+ */
+typedef struct {
+   int type;
+   int fd;
+   int idx;
+} agg_fd_t;
+
+/**
+ * @brief publisher, with the locations not merged yet
+ */
+typedef struct {
+   uint64_t node_id;
+   bool frame_seen;
+   uint32_t frame_seq;     // of the last frame
+   uint32_t frames_lost;
+   uint32_t dropped;       // locations overwritten in the ring
+   uint64_t rx_ts;         // monotonic ms of the last frame
+   unsigned int head;
+   unsigned int cnt;
+   loc_frame_loc_t ring[AGG_RING_LEN];
+} agg_src_t;
+
+/**
+ * @brief TCP connection to a publisher
+ */
+typedef struct {
+   agg_fd_t efd;
+   char host[64];
+   char port[8];
+   bool connected;
+   bool connecting;        // non-blocking connect in progress
+   uint64_t retry_ts;      // monotonic ms of the next connection attempt
+   uint16_t len;
+   uint8_t buf[2*LOC_FRAME_MAX];
+} agg_conn_t;
+
+/**
+ * @brief subscriber
+ */
+typedef struct {
+   agg_fd_t efd;
+   bool used;              // the slots are not freed, a pending event still points to its efd
+   uint8_t filter_cnt;     // 0 for all the tags
+   uint64_t filter[AGG_FILTER_MAX];
+   uint16_t line_len;
+   char line[256];
+   loc_frame_t frame;
+   uint32_t out_head;      // queued bytes: out[out_head .. out_head+out_len[
+   uint32_t out_len;
+   uint32_t frames_lost;
+   bool want_out;          // EPOLLOUT set
+   uint8_t out[AGG_OUT_LEN];
+} agg_sub_t;
+
+static volatile sig_atomic_t running = 1;
+static int ep_fd = -1;
+static agg_fd_t timer_efd = { FD_TIMER, -1, 0 };
+static agg_fd_t udp_efd = { FD_UDP, -1, 0 };
+static agg_fd_t listen_efd = { FD_LISTEN, -1, 0 };
+static agg_src_t *srcs[AGG_SRC_MAX];
+static int src_cnt = 0;
+static agg_conn_t conns[AGG_CONN_MAX];
+static int conn_cnt = 0;
+static agg_sub_t subs[AGG_SUB_MAX];
+static uint64_t delay_us = AGG_DELAY_MS*1000;
+static uint64_t merged = 0, late = 0;
+static uint64_t last_ts = 0;       // ts of the last location sent
+static loc_shm_t shm;
+static bool shm_on = false;
+static dwm_trace_t *tr = NULL;
+static char *trace_file = NULL;
+static uint64_t trace_ms = 0;
+
+static void stop(int sig)
+{
+   (void)sig;
+   running = 0;
+}
+
+static uint64_t agg_mono_ms(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+static uint64_t agg_wall_us(void)
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return (uint64_t)tv.tv_sec*1000000 + tv.tv_usec;
+}
+
+static int agg_ep_add(agg_fd_t* efd, uint32_t events)
+{
+   struct epoll_event ev;
+   ev.events = events;
+   ev.data.ptr = efd;
+   return epoll_ctl(ep_fd, EPOLL_CTL_ADD, efd->fd, &ev);
+}
+
+static void agg_ep_mod(agg_fd_t* efd, uint32_t events)
+{
+   struct epoll_event ev;
+   ev.events = events;
+   ev.data.ptr = efd;
+   epoll_ctl(ep_fd, EPOLL_CTL_MOD, efd->fd, &ev);
+}
+
+static void agg_nonblock(int fd)
+{
+   fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+/**
+ * @brief publisher of a node id, added at its first frame
+ */
+static agg_src_t *agg_src(uint64_t node_id)
+{
+   int i;
+
+   for(i = 0; i < src_cnt; i++)
+   {
+      if(srcs[i]->node_id == node_id)
+      {
+         return srcs[i];
+      }
+   }
+   if(src_cnt == AGG_SRC_MAX)
+   {
+      return NULL;
+   }
+   srcs[src_cnt] = calloc(1, sizeof(agg_src_t));
+   if(srcs[src_cnt] == NULL)
+   {
+      return NULL;
+   }
+   srcs[src_cnt]->node_id = node_id;
+   printf("loc_agg: publisher 0x%016llx\n", (unsigned long long)node_id);
+   return srcs[src_cnt++];
+}
+
+/**
+ * @brief pushes the locations of a frame into the ring of its publisher
+ */
+static void agg_frame(const uint8_t* buf, uint16_t len)
+{
+   loc_frame_loc_t *loc;
+   agg_src_t *src;
+   uint64_t node_id;
+   uint32_t seq;
+   uint16_t flen, off = LOC_FRAME_HDR_LEN;
+   uint8_t cnt, i;
+
+   if((LocFrame_ParseHdr(buf, len, &cnt, &flen, &seq, &node_id) != 0) || (flen > len))
+   {
+      return;
+   }
+   src = agg_src(node_id);
+   if(src == NULL)
+   {
+      return;
+   }
+   if(src->frame_seen && (seq != src->frame_seq + 1))
+   {
+      src->frames_lost += seq - src->frame_seq - 1;
+   }
+   src->frame_seen = true;
+   src->frame_seq = seq;
+   src->rx_ts = agg_mono_ms();
+   for(i = 0; i < cnt; i++)
+   {
+      if(src->cnt == AGG_RING_LEN)
+      {
+         src->head = (src->head + 1) & (AGG_RING_LEN - 1);
+         src->cnt--;
+         src->dropped++;
+      }
+      loc = &src->ring[(src->head + src->cnt) & (AGG_RING_LEN - 1)];
+      if(LocFrame_Get(buf, flen, &off, loc) != 0)
+      {
+         return;
+      }
+      src->cnt++;
+   }
+}
+
+/**
+ * @brief queues the frame of a subscriber, lost if the queue is full
+ */
+static void agg_sub_queue(agg_sub_t* sub)
+{
+   uint16_t len = LocFrame_Close(&sub->frame);
+   uint32_t tail, first;
+
+   if(len == 0)
+   {
+      return;
+   }
+   if(sub->out_len + len > AGG_OUT_LEN)
+   {
+      sub->frames_lost++;
+   }
+   else
+   {
+      tail = (sub->out_head + sub->out_len) % AGG_OUT_LEN;
+      first = (AGG_OUT_LEN - tail < len) ? AGG_OUT_LEN - tail : len;
+      memcpy(sub->out + tail, sub->frame.data, first);
+      memcpy(sub->out, sub->frame.data + first, len - first);
+      sub->out_len += len;
+   }
+   LocFrame_Reset(&sub->frame);
+}
+
+static void agg_sub_close(agg_sub_t* sub)
+{
+   printf("loc_agg: subscriber %d closed, %u frames lost\n", sub->efd.fd, sub->frames_lost);
+   epoll_ctl(ep_fd, EPOLL_CTL_DEL, sub->efd.fd, NULL);
+   close(sub->efd.fd);
+   sub->used = false;
+}
+
+/**
+ * @brief writes the queue of a subscriber as far as the socket takes it
+ */
+static void agg_sub_write(agg_sub_t* sub)
+{
+   uint32_t first;
+   ssize_t n;
+
+   while(sub->out_len > 0)
+   {
+      first = (AGG_OUT_LEN - sub->out_head < sub->out_len) ? AGG_OUT_LEN - sub->out_head : sub->out_len;
+      n = send(sub->efd.fd, sub->out + sub->out_head, first, MSG_DONTWAIT | MSG_NOSIGNAL);
+      if(n < 0)
+      {
+         if((errno == EAGAIN) || (errno == EWOULDBLOCK))
+         {
+            break;
+         }
+         agg_sub_close(sub);
+         return;
+      }
+      sub->out_head = (sub->out_head + n) % AGG_OUT_LEN;
+      sub->out_len -= n;
+   }
+   if((sub->out_len > 0) != sub->want_out)
+   {
+      sub->want_out = (sub->out_len > 0);
+      agg_ep_mod(&sub->efd, EPOLLIN | (sub->want_out ? EPOLLOUT : 0));
+   }
+}
+
+/**
+ * @brief reads the filter lines of a subscriber
+ */
+static void agg_sub_read(agg_sub_t* sub)
+{
+   char *line, *tok, *end;
+   ssize_t n;
+
+   n = recv(sub->efd.fd, sub->line + sub->line_len, sizeof(sub->line) - 1 - sub->line_len, 0);
+   if(n <= 0)
+   {
+      if((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+      {
+         return;
+      }
+      agg_sub_close(sub);
+      return;
+   }
+   sub->line_len += n;
+   sub->line[sub->line_len] = 0;
+   while((end = strchr(sub->line, '\n')) != NULL)
+   {
+      *end = 0;
+      line = sub->line;
+      tok = strtok(line, " \t\r");
+      if((tok != NULL) && (strcmp(tok, "SUB") == 0))
+      {
+         sub->filter_cnt = 0;
+         while(((tok = strtok(NULL, " \t\r")) != NULL) && (sub->filter_cnt < AGG_FILTER_MAX))
+         {
+            sub->filter[sub->filter_cnt++] = strtoull(tok, NULL, 16);
+         }
+      }
+      sub->line_len -= (end + 1 - sub->line);
+      memmove(sub->line, end + 1, sub->line_len + 1);
+   }
+   // a line longer than the buffer is dropped
+   if(sub->line_len == sizeof(sub->line) - 1)
+   {
+      sub->line_len = 0;
+   }
+}
+
+static bool agg_sub_wants(const agg_sub_t* sub, uint64_t node_id)
+{
+   uint8_t i;
+
+   if(sub->filter_cnt == 0)
+   {
+      return true;
+   }
+   for(i = 0; i < sub->filter_cnt; i++)
+   {
+      if(sub->filter[i] == node_id)
+      {
+         return true;
+      }
+   }
+   return false;
+}
+
+/**
+ * @brief sends a merged location to the subscribers of its tag
+ */
+static void agg_fan_out(const loc_frame_loc_t* loc)
+{
+   agg_sub_t *sub;
+   int i;
+
+   if(shm_on)
+   {
+      LocShm_Write(&shm, loc);
+   }
+   if(tr != NULL)
+   {
+      dwm_trace_stamp_from(tr, DWM_TRACE_MERGE, loc->node_id, loc->seq, DWM_TRACE_READ, loc->ts, agg_wall_us());
+   }
+   for(i = 0; i < AGG_SUB_MAX; i++)
+   {
+      sub = &subs[i];
+      if(!sub->used || !agg_sub_wants(sub, loc->node_id))
+      {
+         continue;
+      }
+      if(LocFrame_Add(&sub->frame, loc) != 0)
+      {
+         agg_sub_queue(sub);
+         LocFrame_Add(&sub->frame, loc);
+      }
+   }
+}
+
+/**
+ * @brief merges the rings in time order, see the file header
+ */
+static void agg_merge(void)
+{
+   uint64_t now_ms = agg_mono_ms(), now_us = agg_wall_us();
+   agg_src_t *src, *oldest;
+   bool all;
+   int i;
+
+   while(1)
+   {
+      oldest = NULL;
+      all = true;
+      for(i = 0; i < src_cnt; i++)
+      {
+         src = srcs[i];
+         if(src->cnt == 0)
+         {
+            if(now_ms - src->rx_ts < AGG_IDLE_MS)
+            {
+               all = false;
+            }
+            continue;
+         }
+         if((oldest == NULL) || (src->ring[src->head].ts < oldest->ring[oldest->head].ts))
+         {
+            oldest = src;
+         }
+      }
+      if((oldest == NULL) || (!all && (oldest->ring[oldest->head].ts + delay_us > now_us)))
+      {
+         break;
+      }
+      if(oldest->ring[oldest->head].ts < last_ts)
+      {
+         late++;
+      }
+      else
+      {
+         last_ts = oldest->ring[oldest->head].ts;
+      }
+      agg_fan_out(&oldest->ring[oldest->head]);
+      oldest->head = (oldest->head + 1) & (AGG_RING_LEN - 1);
+      oldest->cnt--;
+      merged++;
+   }
+
+   for(i = 0; i < AGG_SUB_MAX; i++)
+   {
+      if(subs[i].used)
+      {
+         agg_sub_queue(&subs[i]);
+         agg_sub_write(&subs[i]);
+      }
+   }
+}
+
+static void agg_accept(void)
+{
+   agg_sub_t *sub;
+   int fd, i, on = 1;
+
+   while((fd = accept(listen_efd.fd, NULL, NULL)) >= 0)
+   {
+      for(i = 0; (i < AGG_SUB_MAX) && subs[i].used; i++);
+      if(i == AGG_SUB_MAX)
+      {
+         close(fd);
+         continue;
+      }
+      sub = &subs[i];
+      memset(sub, 0, sizeof(agg_sub_t));
+      sub->used = true;
+      agg_nonblock(fd);
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+      sub->efd.type = FD_SUB;
+      sub->efd.fd = fd;
+      sub->efd.idx = i;
+      LocFrame_Init(&sub->frame, 0);
+      agg_ep_add(&sub->efd, EPOLLIN);
+      printf("loc_agg: subscriber %d connected\n", fd);
+   }
+}
+
+/**
+ * @brief starts a connection to a TCP publisher, without waiting for it,
+ *        the next try is scheduled if it fails
+ */
+static void agg_conn_open(agg_conn_t* c)
+{
+   struct addrinfo hints, *res;
+   int ret;
+
+   c->retry_ts = agg_mono_ms() + AGG_RECONNECT_MS;
+   memset(&hints, 0, sizeof(hints));
+   hints.ai_family = AF_INET;
+   hints.ai_socktype = SOCK_STREAM;
+   if(getaddrinfo(c->host, c->port, &hints, &res) != 0)
+   {
+      return;
+   }
+   c->efd.fd = socket(AF_INET, SOCK_STREAM, 0);
+   if(c->efd.fd >= 0)
+   {
+      agg_nonblock(c->efd.fd);
+      ret = connect(c->efd.fd, res->ai_addr, res->ai_addrlen);
+      if((ret == 0) || (errno == EINPROGRESS))
+      {
+         c->connecting = true;
+         c->len = 0;
+         agg_ep_add(&c->efd, EPOLLIN | EPOLLOUT);
+      }
+      else
+      {
+         close(c->efd.fd);
+         c->efd.fd = -1;
+      }
+   }
+   freeaddrinfo(res);
+}
+
+static void agg_conn_close(agg_conn_t* c)
+{
+   if(c->connected)
+   {
+      printf("loc_agg: lost %s:%s\n", c->host, c->port);
+   }
+   epoll_ctl(ep_fd, EPOLL_CTL_DEL, c->efd.fd, NULL);
+   close(c->efd.fd);
+   c->efd.fd = -1;
+   c->connected = false;
+   c->connecting = false;
+   c->retry_ts = agg_mono_ms() + AGG_RECONNECT_MS;
+}
+
+/**
+ * @brief ends the connection to a TCP publisher, once writable
+ */
+static void agg_conn_done(agg_conn_t* c)
+{
+   int err = 0;
+   socklen_t len = sizeof(err);
+
+   getsockopt(c->efd.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+   if(err != 0)
+   {
+      agg_conn_close(c);
+      return;
+   }
+   c->connecting = false;
+   c->connected = true;
+   agg_ep_mod(&c->efd, EPOLLIN);
+   printf("loc_agg: connected to %s:%s\n", c->host, c->port);
+}
+
+/**
+ * @brief reads the frames of a TCP publisher, delimited by their length
+ */
+static void agg_conn_read(agg_conn_t* c)
+{
+   uint64_t node_id;
+   uint32_t seq;
+   uint16_t flen;
+   uint8_t cnt;
+   ssize_t n;
+
+   n = recv(c->efd.fd, c->buf + c->len, sizeof(c->buf) - c->len, 0);
+   if(n <= 0)
+   {
+      if((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+      {
+         return;
+      }
+      agg_conn_close(c);
+      return;
+   }
+   c->len += n;
+   while(c->len >= LOC_FRAME_HDR_LEN)
+   {
+      if(LocFrame_ParseHdr(c->buf, c->len, &cnt, &flen, &seq, &node_id) != 0)
+      {
+         // out of sync, the stream is restarted
+         agg_conn_close(c);
+         return;
+      }
+      if(c->len < flen)
+      {
+         break;
+      }
+      agg_frame(c->buf, flen);
+      c->len -= flen;
+      memmove(c->buf, c->buf + flen, c->len);
+   }
+}
+
+static int agg_udp_open(const char* group, int port)
+{
+   struct sockaddr_in addr;
+   struct ip_mreq mreq;
+   int on = 1;
+
+   udp_efd.fd = socket(AF_INET, SOCK_DGRAM, 0);
+   if(udp_efd.fd < 0)
+   {
+      return -1;
+   }
+   setsockopt(udp_efd.fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family = AF_INET;
+   addr.sin_port = htons(port);
+   addr.sin_addr.s_addr = htonl(INADDR_ANY);
+   if(bind(udp_efd.fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+   {
+      return -1;
+   }
+   if(inet_pton(AF_INET, group, &mreq.imr_multiaddr) != 1)
+   {
+      return -1;
+   }
+   mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+   if(setsockopt(udp_efd.fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0)
+   {
+      return -1;
+   }
+   agg_nonblock(udp_efd.fd);
+   return agg_ep_add(&udp_efd, EPOLLIN);
+}
+
+static int agg_listen_open(int port)
+{
+   struct sockaddr_in addr;
+   int on = 1;
+
+   listen_efd.fd = socket(AF_INET, SOCK_STREAM, 0);
+   if(listen_efd.fd < 0)
+   {
+      return -1;
+   }
+   setsockopt(listen_efd.fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family = AF_INET;
+   addr.sin_port = htons(port);
+   addr.sin_addr.s_addr = htonl(INADDR_ANY);
+   if((bind(listen_efd.fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) || (listen(listen_efd.fd, AGG_SUB_MAX) != 0))
+   {
+      return -1;
+   }
+   agg_nonblock(listen_efd.fd);
+   return agg_ep_add(&listen_efd, EPOLLIN);
+}
+
+static int agg_timer_open(void)
+{
+   struct itimerspec its;
+
+   timer_efd.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+   if(timer_efd.fd < 0)
+   {
+      return -1;
+   }
+   its.it_value.tv_sec = its.it_interval.tv_sec = 0;
+   its.it_value.tv_nsec = its.it_interval.tv_nsec = AGG_TICK_MS*1000000L;
+   timerfd_settime(timer_efd.fd, 0, &its, NULL);
+   return agg_ep_add(&timer_efd, EPOLLIN);
+}
+
+static void agg_tick(void)
+{
+   uint64_t expirations, now = agg_mono_ms();
+   int i;
+
+   if(read(timer_efd.fd, &expirations, sizeof(expirations)) < 0)
+   {
+      return;
+   }
+   for(i = 0; i < conn_cnt; i++)
+   {
+      if(!conns[i].connected && !conns[i].connecting && (now >= conns[i].retry_ts))
+      {
+         agg_conn_open(&conns[i]);
+      }
+   }
+   agg_merge();
+   if((tr != NULL) && (now - trace_ms >= AGG_TRACE_MS))
+   {
+      trace_ms = now;
+      dwm_trace_dump(tr, trace_file);
+   }
+}
+
+int main(int argc, char*argv[])
+{
+   struct epoll_event events[AGG_EVENT_MAX];
+   uint8_t buf[LOC_FRAME_MAX];
+   char group[32] = AGG_GROUP;
+   char *shm_name = NULL;
+   int port = AGG_PORT, sub_port = AGG_SUB_PORT, udp = 0;
+   int opt, n, i;
+   ssize_t len;
+   agg_fd_t *efd;
+   char *colon;
+
+   while((opt = getopt(argc, argv, "u:s:l:d:m:T:")) != -1)
+   {
+      switch(opt)
+      {
+         case 'u':
+            snprintf(group, sizeof(group), "%s", optarg);
+            colon = strchr(group, ':');
+            if(colon != NULL)
+            {
+               *colon = 0;
+               port = atoi(colon+1);
+            }
+            udp = 1;
+            break;
+         case 's':
+            colon = strrchr(optarg, ':');
+            if((colon == NULL) || (conn_cnt == AGG_CONN_MAX))
+            {
+               fprintf(stderr, "loc_agg: bad publisher %s\n", optarg);
+               return 1;
+            }
+            *colon = 0;
+            snprintf(conns[conn_cnt].host, sizeof(conns[conn_cnt].host), "%s", optarg);
+            snprintf(conns[conn_cnt].port, sizeof(conns[conn_cnt].port), "%s", colon+1);
+            conns[conn_cnt].efd.type = FD_CONN;
+            conns[conn_cnt].efd.fd = -1;
+            conns[conn_cnt].efd.idx = conn_cnt;
+            conn_cnt++;
+            break;
+         case 'l': sub_port = atoi(optarg); break;
+         case 'd': delay_us = (uint64_t)atoi(optarg)*1000; break;
+         case 'm': shm_name = optarg; break;
+         case 'T': trace_file = optarg; break;
+         default:
+            fprintf(stderr, "usage: %s [-u group:port] [-s host:port]... [-l port] [-d delay_ms] [-m shm_name] "
+                  "[-T trace_file]\n", argv[0]);
+            return 1;
+      }
+   }
+   // multicast by default, with the TCP publishers only if -u is given too
+   if(conn_cnt == 0)
+   {
+      udp = 1;
+   }
+
+   signal(SIGINT, stop);
+   signal(SIGTERM, stop);
+   ep_fd = epoll_create1(0);
+   if((ep_fd < 0) || (agg_timer_open() != 0) || (agg_listen_open(sub_port) != 0) \
+   || (udp && (agg_udp_open(group, port) != 0)))
+   {
+      fprintf(stderr, "loc_agg: cannot open the sockets\n");
+      return 1;
+   }
+   if(shm_name != NULL)
+   {
+      if(LocShm_Open(&shm, shm_name, LOC_SHM_SLOT_CNT) != 0)
+      {
+         fprintf(stderr, "loc_agg: cannot open the shared memory %s\n", shm_name);
+         return 1;
+      }
+      shm_on = true;
+      printf("loc_agg: locations in /dev/shm/%s, %d slots\n", shm_name, LOC_SHM_SLOT_CNT);
+   }
+   if((trace_file != NULL) && (dwm_trace_init(&tr) != RV_OK))
+   {
+      fprintf(stderr, "loc_agg: cannot trace\n");
+      return 1;
+   }
+   printf("loc_agg: subscribers on port %d, delay %llu ms\n", sub_port, (unsigned long long)delay_us/1000);
+
+   while(running)
+   {
+      n = epoll_wait(ep_fd, events, AGG_EVENT_MAX, -1);
+      for(i = 0; i < n; i++)
+      {
+         efd = events[i].data.ptr;
+         switch(efd->type)
+         {
+            case FD_TIMER:
+               agg_tick();
+               break;
+            case FD_UDP:
+               while((len = recv(udp_efd.fd, buf, sizeof(buf), 0)) > 0)
+               {
+                  agg_frame(buf, len);
+               }
+               break;
+            case FD_LISTEN:
+               agg_accept();
+               break;
+            case FD_CONN:
+               if(conns[efd->idx].connecting)
+               {
+                  agg_conn_done(&conns[efd->idx]);
+               }
+               else if(conns[efd->idx].connected)
+               {
+                  agg_conn_read(&conns[efd->idx]);
+               }
+               break;
+            case FD_SUB:
+               // the subscriber may be closed by either handler, or by the tick
+               if((events[i].events & EPOLLOUT) && subs[efd->idx].used)
+               {
+                  agg_sub_write(&subs[efd->idx]);
+               }
+               if((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && subs[efd->idx].used)
+               {
+                  agg_sub_read(&subs[efd->idx]);
+               }
+               break;
+         }
+      }
+   }
+
+   printf("loc_agg: %llu locations merged, %llu late\n", (unsigned long long)merged, (unsigned long long)late);
+   if(tr != NULL)
+   {
+      dwm_trace_dump(tr, trace_file);
+      printf("loc_agg: READ to MERGE p99 %.1f ms\n", 1e-3 * dwm_trace_quantile(tr, DWM_TRACE_MERGE, 0.99, true));
+      dwm_trace_deinit(tr);
+   }
+   if(shm_on)
+   {
+      // kept for the readers, the next run takes it over
+      LocShm_Close(&shm, false);
+   }
+   for(i = 0; i < src_cnt; i++)
+   {
+      printf("loc_agg: publisher 0x%016llx: %u frames lost, %u locations dropped\n", \
+      (unsigned long long)srcs[i]->node_id, srcs[i]->frames_lost, srcs[i]->dropped);
+   }
+   return 0;
+}
@@ -0,0 +1,222 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    tdoa_bench.c
+ * @brief   throughput and accuracy of the TDoA solver on simulated fixes
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <string.h>
+#include "dwm_tdoa.h"
+#include "dwm_track.h"
+#include "dwm_clk.h"
+#include "dwm_pipe.h"
+
+#define FIX_CNT         100000
+#define SPEED_OF_LIGHT  299702547.0   // m/s in air
+#define NOISE_NS        1.5
+#define COURT_X         28.65         // m, the court of the Simulator+Localizer
+#define COURT_Y         15.24
+#define TRACK_TAG_CNT   1000
+#define TRACK_TICK_CNT  200
+#define TRACK_DT        0.1          // s
+#define PIPE_TAG_CNT    1000
+#define PIPE_EPOCH_CNT  100
+
+static double gauss(void)
+{
+   double u = (rand() + 1.0) / (RAND_MAX + 2.0), v = (rand() + 1.0) / (RAND_MAX + 2.0);
+   return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+static double now_s(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief tags walking across the court at 1 m/s, tracked by dwm_track
+ */
+static void bench_track(const dwm_tdoa_t* t, int cnt, double noise_m)
+{
+   static double pos[TRACK_TAG_CNT][2], vel[TRACK_TAG_CNT][2];
+   static uint32_t handle[TRACK_TAG_CNT];
+   dwm_track_noise_t n = {.p0_pos = 1, .p0_vel = 1, .q_pos = 0.01, .q_vel = 0.5, .r_rd = 2 * noise_m * noise_m, .r_vel = 1};
+   double rd[DWM_TDOA_ANCHOR_CNT_MAX], r0, st[DWM_TRACK_STATE_NUM], se = 0, t_step = 0, t0;
+   dwm_track_t tr;
+   int i, j, k, se_cnt = 0;
+
+   if(dwm_track_init(&tr, t, &n, TRACK_TAG_CNT) != RV_OK)
+   {
+      return;
+   }
+   for(i = 0; i < TRACK_TAG_CNT; i++)
+   {
+      pos[i][0] = COURT_X * rand() / RAND_MAX;
+      pos[i][1] = COURT_Y * rand() / RAND_MAX;
+      vel[i][0] = cos(i);
+      vel[i][1] = sin(i);
+      dwm_track_add(&tr, pos[i], &handle[i]);
+   }
+   for(k = 0; k < TRACK_TICK_CNT; k++)
+   {
+      for(i = 0; i < TRACK_TAG_CNT; i++)
+      {
+         for(j = 0; j < 2; j++)
+         {
+            pos[i][j] += vel[i][j] * TRACK_DT;
+         }
+         // bounce on the sides
+         if((pos[i][0] < 0) || (pos[i][0] > COURT_X)) vel[i][0] = -vel[i][0];
+         if((pos[i][1] < 0) || (pos[i][1] > COURT_Y)) vel[i][1] = -vel[i][1];
+         r0 = hypot(pos[i][0] - t->a[0][0], pos[i][1] - t->a[0][1]) + noise_m * gauss();
+         for(j = 1; j < cnt; j++)
+         {
+            rd[j] = hypot(pos[i][0] - t->a[j][0], pos[i][1] - t->a[j][1]) + noise_m * gauss() - r0;
+         }
+         dwm_track_meas(&tr, handle[i], rd, NULL);
+      }
+      t0 = now_s();
+      dwm_track_step(&tr, TRACK_DT);
+      t_step += now_s() - t0;
+      // after the first second
+      for(i = 0; (k >= 10) && (i < TRACK_TAG_CNT); i++)
+      {
+         dwm_track_get(&tr, handle[i], st);
+         se += pow(st[0] - pos[i][0], 2) + pow(st[1] - pos[i][1], 2);
+         se_cnt++;
+      }
+   }
+   printf("tracker:       %9.0f tag updates/s, %d tags, rmse %.3f m\n",
+         (double)TRACK_TAG_CNT * TRACK_TICK_CNT / t_step, TRACK_TAG_CNT, sqrt(se / se_cnt));
+   dwm_track_free(&tr);
+}
+
+static uint32_t pipe_next_seq[PIPE_TAG_CNT];
+static int pipe_order_err, pipe_fail;
+
+static void pipe_cb(void* arg, uint64_t tag_id, uint32_t seq, const double* p, int rv)
+{
+   (void)arg;
+   (void)p;
+   // a tag runs on one worker at a time, its counters need no lock, a gap is a dropped epoch
+   if(seq < pipe_next_seq[tag_id])
+   {
+      __sync_fetch_and_add(&pipe_order_err, 1);
+   }
+   pipe_next_seq[tag_id] = seq + 1;
+   if(rv != RV_OK)
+   {
+      __sync_fetch_and_add(&pipe_fail, 1);
+   }
+}
+
+/**
+ * @brief all the epochs of PIPE_TAG_CNT tags solved by 1 to worker_cnt threads
+ */
+static void bench_pipe(const dwm_tdoa_t* t, int cnt, double noise_m, int worker_cnt)
+{
+   static uint64_t ts[PIPE_TAG_CNT][DWM_TDOA_ANCHOR_CNT_MAX];
+   double x, y, t0;
+   dwm_pipe_t *pipe;
+   int i, j, k, w;
+
+   for(i = 0; i < PIPE_TAG_CNT; i++)
+   {
+      x = COURT_X * rand() / RAND_MAX;
+      y = COURT_Y * rand() / RAND_MAX;
+      for(j = 0; j < cnt; j++)
+      {
+         ts[i][j] = (uint64_t)((hypot(x - t->a[j][0], y - t->a[j][1]) + noise_m * gauss())
+               / DWM_CLK_SPEED_OF_LIGHT * DWM_CLK_TICK_HZ);
+      }
+   }
+   for(w = 1; w <= worker_cnt; w *= 2)
+   {
+      memset(pipe_next_seq, 0, sizeof(pipe_next_seq));
+      pipe_order_err = pipe_fail = 0;
+      if(dwm_pipe_init(&pipe, t, w, pipe_cb, NULL) != RV_OK)
+      {
+         return;
+      }
+      t0 = now_s();
+      for(k = 0; k < PIPE_EPOCH_CNT; k++)
+      {
+         for(i = 0; i < PIPE_TAG_CNT; i++)
+         {
+            for(j = 0; j < cnt; j++)
+            {
+               dwm_pipe_blink(pipe, i, k, j, ts[i][j] + k * 1000000ULL);
+            }
+         }
+         // the blinks come faster than live, keep the tag queues from overflowing
+         if(k % (DWM_PIPE_EPOCH_Q / 2) == 0)
+         {
+            dwm_pipe_flush(pipe);
+         }
+      }
+      dwm_pipe_flush(pipe);
+      t0 = now_s() - t0;
+      printf("pipe %2d thr:   %9.0f fixes/s, %d dropped, %d out of order, %d failed\n",
+            w, PIPE_TAG_CNT * PIPE_EPOCH_CNT / t0, dwm_pipe_drop_cnt(pipe), pipe_order_err, pipe_fail);
+      dwm_pipe_deinit(pipe);
+   }
+}
+
+int main(int argc, char * argv[])
+{
+   const double anchors[] = {0, 0,  0, COURT_Y,  COURT_X, 0,  COURT_X, COURT_Y,  COURT_X/2, 0,  COURT_X/2, COURT_Y};
+   static double rd[FIX_CNT][DWM_TDOA_ANCHOR_CNT_MAX], real[FIX_CNT][2];
+   double noise = (argc > 1) ? atof(argv[1]) : NOISE_NS;
+   double p[2], r0, se_lin = 0, se = 0, t0, t_lin, t_solve;
+   dwm_tdoa_t t;
+   int i, j, fail = 0, cnt = sizeof(anchors) / sizeof(anchors[0]) / 2;
+
+   dwm_tdoa_init(&t, 2, cnt, anchors);
+   srand(1);
+   for(i = 0; i < FIX_CNT; i++)
+   {
+      real[i][0] = COURT_X * rand() / RAND_MAX;
+      real[i][1] = COURT_Y * rand() / RAND_MAX;
+      r0 = hypot(real[i][0] - anchors[0], real[i][1] - anchors[1]) + noise * 1e-9 * SPEED_OF_LIGHT * gauss();
+      for(j = 1; j < cnt; j++)
+      {
+         rd[i][j] = hypot(real[i][0] - anchors[2*j], real[i][1] - anchors[2*j+1])
+               + noise * 1e-9 * SPEED_OF_LIGHT * gauss() - r0;
+      }
+   }
+
+   t0 = now_s();
+   for(i = 0; i < FIX_CNT; i++)
+   {
+      fail += dwm_tdoa_linear(&t, rd[i], p) != RV_OK;
+      se_lin += pow(p[0] - real[i][0], 2) + pow(p[1] - real[i][1], 2);
+   }
+   t_lin = now_s() - t0;
+
+   t0 = now_s();
+   for(i = 0; i < FIX_CNT; i++)
+   {
+      fail += dwm_tdoa_solve(&t, rd[i], NULL, p, NULL) != RV_OK;
+      se += pow(p[0] - real[i][0], 2) + pow(p[1] - real[i][1], 2);
+   }
+   t_solve = now_s() - t0;
+
+   printf("%d fixes, %d anchors, %.2f ns noise, %d failed\n", FIX_CNT, cnt, noise, fail);
+   printf("linear:        %9.0f fixes/s, rmse %.3f m\n", FIX_CNT / t_lin, sqrt(se_lin / FIX_CNT));
+   printf("linear + LM:   %9.0f fixes/s, rmse %.3f m\n", FIX_CNT / t_solve, sqrt(se / FIX_CNT));
+
+   bench_track(&t, cnt, noise * 1e-9 * SPEED_OF_LIGHT);
+   bench_pipe(&t, cnt, noise * 1e-9 * SPEED_OF_LIGHT, (argc > 2) ? atoi(argv[2]) : 4);
+   return 0;
+}
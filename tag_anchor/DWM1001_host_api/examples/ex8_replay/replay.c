@@ -0,0 +1,528 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    replay.c
+ * @brief   replay of the Simulator+Localizer logs through the native localization
+ *
+ *          The logs only hold the ground truth of the tag, so the blinks are
+ *          simulated as by the Python simulators: the anchors of the court,
+ *          their count and the timestamp noise are taken from the log name
+ *          ("6Anch", "1.5nsNoise"), the timestamps are the master clock
+ *          ticks of dwm_clk.h.
+ *
+ *          Each log is replayed through three stages:
+ *             solve: per fix on one thread, cold from the linear solve, then
+ *                    dwm_tdoa_solve_warm() from the last fix
+ *             pipe:  dwm_pipe on -w workers, blink to fix latency
+ *             track: dwm_track, one step per sample for the -r replicas, and
+ *                    dwm_tdoa_solve_warm() from the prediction of the tracker
+ *          With -g the solve and pipe stages solve on the best subset of -g
+ *          anchors of the GDOP grid of dwm_gdop.h at the last fix.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "dwm_tdoa.h"
+#include "dwm_track.h"
+#include "dwm_clk.h"
+#include "dwm_pipe.h"
+#include "dwm_gdop.h"
+
+#define FEET_TO_M       0.3048
+#define COURT_X         (94 * FEET_TO_M)
+#define COURT_Y         (50 * FEET_TO_M)
+#define ANCHOR_CNT_MAX  6
+#define LINE_LEN        1024
+#define COL_MAX         32
+#define TRACK_GAP_S     1.0         // the player left the court, the tracks restart
+#define GDOP_CELL_M     0.5
+
+/**
+ * @brief ground truth of a log
+ */
+typedef struct {
+   const char *name;
+   int cnt;
+   double *t;              // s
+   double *x, *y;          // m
+   double py_rmse[3];      // lin, hyp, filt RMSE of the Python localizer, -1 if not in the log
+   int an_cnt;
+   double noise_ns;
+} replay_log_t;
+
+/**
+ * @brief results of the pipe stage, written by the workers
+ */
+typedef struct {
+   int rep;
+   uint64_t *sub_ns;       // [sample][replica] time of the last blink
+   double *lat_ns;
+   double *fx, *fy;
+   int *rv;
+} replay_pipe_t;
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static double rng_uniform(void)
+{
+   rng_state ^= rng_state << 13;
+   rng_state ^= rng_state >> 7;
+   rng_state ^= rng_state << 17;
+   return ((rng_state >> 11) + 0.5) / 9007199254740992.0;
+}
+
+static double rng_gauss(void)
+{
+   return sqrt(-2 * log(rng_uniform())) * cos(2 * M_PI * rng_uniform());
+}
+
+static uint64_t now_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmp_double(const void* a, const void* b)
+{
+   double d = *(const double*)a - *(const double*)b;
+   return (d > 0) - (d < 0);
+}
+
+/**
+ * @brief prints the percentiles of n latencies in ns, sorts them
+ */
+static void print_lat(double* v, int n)
+{
+   if(n == 0)
+   {
+      printf("no sample");
+      return;
+   }
+   qsort(v, n, sizeof(double), cmp_double);
+   printf("p50 %.1f p90 %.1f p99 %.1f p99.9 %.1f max %.1f us",
+         v[n/2] / 1e3, v[(int)(n*0.9)] / 1e3, v[(int)(n*0.99)] / 1e3, v[(int)(n*0.999)] / 1e3, v[n-1] / 1e3);
+}
+
+/**
+ * @brief anchors of the Simulator+Localizer, the first cnt of 6
+ */
+static void court_anchors(double* a)
+{
+   const double an[ANCHOR_CNT_MAX][2] = {{0, 0}, {0, COURT_Y}, {COURT_X, 0}, {COURT_X, COURT_Y},
+         {47 * FEET_TO_M, 0}, {47 * FEET_TO_M, COURT_Y}};
+   memcpy(a, an, sizeof(an));
+}
+
+/**
+ * @brief loads a log, the time is sample_time or timestamp_ms, both in s: the NBA
+ *        samples are 0.12 s apart, as in the velocity estimate of the localizer
+ */
+static int log_load(replay_log_t* log, const char* name)
+{
+   char line[LINE_LEN], *tok, *save;
+   int col_t = -1, col_x = -1, col_y = -1, col_py[3] = {-1, -1, -1}, i, cap = 1024;
+   double v[COL_MAX];
+   const char *py_cols[3] = {"linRMSE", "hypRMSE", "filtRMSE"};
+   const char *p;
+   FILE *f;
+
+   memset(log, 0, sizeof(replay_log_t));
+   log->name = name;
+   f = fopen(name, "r");
+   if((f == NULL) || (fgets(line, sizeof(line), f) == NULL))
+   {
+      fprintf(stderr, "%s: cannot read\n", name);
+      if(f != NULL)
+      {
+         fclose(f);
+      }
+      return -1;
+   }
+   for(i = 0, tok = strtok_r(line, ",\r\n", &save); tok != NULL; i++, tok = strtok_r(NULL, ",\r\n", &save))
+   {
+      if((strcmp(tok, "timestamp_ms") == 0) || (strcmp(tok, "sample_time") == 0))
+      {
+         col_t = i;
+      }
+      else if(strcmp(tok, "realX") == 0)
+      {
+         col_x = i;
+      }
+      else if(strcmp(tok, "realY") == 0)
+      {
+         col_y = i;
+      }
+      else
+      {
+         for(int k = 0; k < 3; k++)
+         {
+            col_py[k] = (strcmp(tok, py_cols[k]) == 0) ? i : col_py[k];
+         }
+      }
+   }
+   if((col_t < 0) || (col_x < 0) || (col_y < 0) || (i > COL_MAX))
+   {
+      fprintf(stderr, "%s: no time, realX or realY column\n", name);
+      fclose(f);
+      return -1;
+   }
+
+   log->t = malloc(cap * sizeof(double));
+   log->x = malloc(cap * sizeof(double));
+   log->y = malloc(cap * sizeof(double));
+   log->py_rmse[0] = log->py_rmse[1] = log->py_rmse[2] = -1;
+   while(fgets(line, sizeof(line), f) != NULL)
+   {
+      for(i = 0, tok = strtok_r(line, ",\r\n", &save); (tok != NULL) && (i < COL_MAX); i++, tok = strtok_r(NULL, ",\r\n", &save))
+      {
+         v[i] = atof(tok);
+      }
+      if(i <= col_y || i <= col_x || i <= col_t)
+      {
+         continue;
+      }
+      if(log->cnt == cap)
+      {
+         cap *= 2;
+         log->t = realloc(log->t, cap * sizeof(double));
+         log->x = realloc(log->x, cap * sizeof(double));
+         log->y = realloc(log->y, cap * sizeof(double));
+      }
+      log->t[log->cnt] = v[col_t];
+      log->x[log->cnt] = v[col_x];
+      log->y[log->cnt] = v[col_y];
+      log->cnt++;
+      for(int k = 0; k < 3; k++)
+      {
+         log->py_rmse[k] = ((col_py[k] >= 0) && (col_py[k] < i)) ? v[col_py[k]] : log->py_rmse[k];
+      }
+   }
+   fclose(f);
+
+   // the simulation parameters are in the name
+   log->an_cnt = ANCHOR_CNT_MAX;
+   p = strstr(name, "Anch");
+   if((p != NULL) && (p > name) && (p[-1] >= '3') && (p[-1] <= '6'))
+   {
+      log->an_cnt = p[-1] - '0';
+   }
+   p = strstr(name, "nsNoise");
+   if(p != NULL)
+   {
+      while((p > name) && ((p[-1] == '.') || ((p[-1] >= '0') && (p[-1] <= '9'))))
+      {
+         p--;
+      }
+      log->noise_ns = atof(p);
+   }
+   return 0;
+}
+
+static void pipe_cb(void* arg, uint64_t tag_id, uint32_t seq, const double* p, int rv)
+{
+   replay_pipe_t *rp = arg;
+   int i = seq * rp->rep + (int)tag_id;
+
+   rp->lat_ns[i] = (double)(now_ns() - rp->sub_ns[i]);
+   rp->fx[i] = p[0];
+   rp->fy[i] = p[1];
+   rp->rv[i] = rv;
+}
+
+/**
+ * @brief replays a log through the three stages
+ */
+static void replay(const replay_log_t* log, int rep, int worker_cnt, double speed, int sub_cnt)
+{
+   int n = log->cnt * rep, ac = log->an_cnt, i, k, r, j, fail, it;
+   double a[ANCHOR_CNT_MAX * 2], noise_m = log->noise_ns * 1e-9 * DWM_CLK_SPEED_OF_LIGHT;
+   double *rd = malloc(n * ac * sizeof(double)), *lat = malloc(n * sizeof(double));
+   uint64_t *ts = malloc(n * ac * sizeof(uint64_t)), t0, t1, t2, t_deadline, iters;
+   double p[2], q[2], dx, dy, se, se_pred, dt, st[DWM_TRACK_STATE_NUM];
+   dwm_track_noise_t tn = {.p0_pos = 1, .p0_vel = 4, .q_pos = 0.01, .q_vel = 4,
+         .r_rd = 2 * noise_m * noise_m + 1e-4, .r_vel = 1};
+   replay_pipe_t rp = {.rep = rep};
+   uint32_t *handle = malloc(rep * sizeof(uint32_t)), all, mask;
+   double lo[2] = {0, 0}, hi[2] = {COURT_X, COURT_Y};
+   dwm_gdop_t gdop;
+   int use_gdop;
+   struct timespec rts;
+   dwm_tdoa_t an;
+   dwm_track_t tr;
+   dwm_pipe_t *pipe;
+
+   court_anchors(a);
+   dwm_tdoa_init(&an, 2, ac, a);
+   all = (1U << ac) - 1;
+   use_gdop = (sub_cnt > 0) && (dwm_gdop_init(&gdop, &an, sub_cnt, lo, hi, GDOP_CELL_M) == RV_OK);
+   printf("%s: %d samples x %d, %d anchors, %.2f ns noise", log->name, log->cnt, rep, ac, log->noise_ns);
+   if(use_gdop)
+   {
+      printf(", gdop subsets of %d", sub_cnt);
+   }
+   printf("\n");
+
+   // blinks of the replicas, master clock ticks
+   for(k = 0; k < log->cnt; k++)
+   {
+      for(r = 0; r < rep; r++)
+      {
+         i = k * rep + r;
+         for(j = 0; j < ac; j++)
+         {
+            dx = log->x[k] - a[2*j];
+            dy = log->y[k] - a[2*j+1];
+            ts[i*ac + j] = (uint64_t)llround((log->t[k] + (sqrt(dx*dx + dy*dy) + noise_m * rng_gauss())
+                  / DWM_CLK_SPEED_OF_LIGHT) * DWM_CLK_TICK_HZ) + (1ULL << 32);
+            rd[i*ac + j] = (double)(int64_t)(ts[i*ac + j] - ts[i*ac]) / DWM_CLK_TICK_HZ * DWM_CLK_SPEED_OF_LIGHT;
+         }
+      }
+   }
+
+   // solve, cold
+   se = 0;
+   fail = 0;
+   t1 = 0;
+   iters = 0;
+   for(i = 0; i < n; i++)
+   {
+      t0 = now_ns();
+      fail += dwm_tdoa_solve_warm(&an, &rd[i*ac], NULL, DWM_TDOA_WARM_RMS, p, NULL, &it) != RV_OK;
+      lat[i] = (double)(now_ns() - t0);
+      t1 += now_ns() - t0;
+      iters += it;
+      se += pow(p[0] - log->x[i / rep], 2) + pow(p[1] - log->y[i / rep], 2);
+   }
+   printf("   cold:   %9.0f fixes/s, rmse %.4f m, %d failed, %.2f iterations, ", n / (t1 * 1e-9), sqrt(se / n), fail,
+         (double)iters / n);
+   print_lat(lat, n);
+   printf("\n");
+
+   // solve, warm from the last fix
+   se = 0;
+   fail = 0;
+   t1 = 0;
+   iters = 0;
+   for(r = 0; r < rep; r++)
+   {
+      for(k = 0; k < log->cnt; k++)
+      {
+         i = k * rep + r;
+         t0 = now_ns();
+         if(use_gdop && (k > 0))
+         {
+            mask = dwm_gdop_select(&gdop, p, all);
+            fail += dwm_gdop_solve(&an, mask, &rd[i*ac], p, p, NULL) != RV_OK;
+            it = 0;
+         }
+         else
+         {
+            memcpy(q, p, sizeof(q));
+            fail += dwm_tdoa_solve_warm(&an, &rd[i*ac], (k > 0) ? q : NULL, DWM_TDOA_WARM_RMS, p, NULL, &it) != RV_OK;
+         }
+         lat[i] = (double)(now_ns() - t0);
+         t1 += now_ns() - t0;
+         iters += it;
+         se += pow(p[0] - log->x[k], 2) + pow(p[1] - log->y[k], 2);
+      }
+   }
+   printf("   solve:  %9.0f fixes/s, rmse %.4f m, %d failed, %.2f iterations, ", n / (t1 * 1e-9), sqrt(se / n), fail,
+         (double)iters / n);
+   print_lat(lat, n);
+   printf("\n");
+
+   // pipe, paced at speed times real time, or as fast as possible in bursts the tag queues hold
+   rp.sub_ns = calloc(n, sizeof(uint64_t));
+   rp.lat_ns = calloc(n, sizeof(double));
+   rp.fx = calloc(n, sizeof(double));
+   rp.fy = calloc(n, sizeof(double));
+   rp.rv = calloc(n, sizeof(int));
+   if((rep <= DWM_PIPE_TAG_MAX) && (dwm_pipe_init(&pipe, &an, worker_cnt, pipe_cb, &rp) == RV_OK))
+   {
+      if(use_gdop)
+      {
+         dwm_pipe_gdop_set(pipe, &gdop);
+      }
+      t0 = now_ns();
+      for(k = 0; k < log->cnt; k++)
+      {
+         if(speed > 0)
+         {
+            t_deadline = t0 + (uint64_t)((log->t[k] - log->t[0]) / speed * 1e9);
+            rts.tv_sec = t_deadline / 1000000000ULL;
+            rts.tv_nsec = t_deadline % 1000000000ULL;
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &rts, NULL);
+         }
+         for(r = 0; r < rep; r++)
+         {
+            i = k * rep + r;
+            for(j = 0; j < ac; j++)
+            {
+               if(j == ac - 1)
+               {
+                  rp.sub_ns[i] = now_ns();
+               }
+               dwm_pipe_blink(pipe, r, k, j, ts[i*ac + j]);
+            }
+         }
+         if((speed <= 0) && (k % (DWM_PIPE_EPOCH_Q / 2) == DWM_PIPE_EPOCH_Q / 2 - 1))
+         {
+            dwm_pipe_flush(pipe);
+         }
+      }
+      dwm_pipe_flush(pipe);
+      t1 = now_ns() - t0;
+      se = 0;
+      fail = 0;
+      for(i = 0; i < n; i++)
+      {
+         fail += rp.rv[i] != RV_OK;
+         se += pow(rp.fx[i] - log->x[i / rep], 2) + pow(rp.fy[i] - log->y[i / rep], 2);
+      }
+      printf("   pipe:   %9.0f fixes/s, rmse %.4f m, %d failed, %u dropped, %d workers, ",
+            n / (t1 * 1e-9), sqrt(se / n), fail, dwm_pipe_drop_cnt(pipe), worker_cnt);
+      print_lat(rp.lat_ns, n);
+      printf("\n");
+      dwm_pipe_deinit(pipe);
+   }
+
+   // track, the replicas step together
+   if(dwm_track_init(&tr, &an, &tn, rep) == RV_OK)
+   {
+      for(r = 0; r < rep; r++)
+      {
+         dwm_tdoa_solve(&an, &rd[r*ac], NULL, p, NULL);
+         dwm_track_add(&tr, p, &handle[r]);
+      }
+      se = 0;
+      se_pred = 0;
+      t1 = 0;
+      t2 = 0;
+      iters = 0;
+      for(k = 0; k < log->cnt; k++)
+      {
+         dt = (k > 0) ? log->t[k] - log->t[k-1] : 0;
+         if((dt < 0) || (dt > TRACK_GAP_S))
+         {
+            for(r = 0; r < rep; r++)
+            {
+               dwm_track_remove(&tr, handle[r]);
+               dwm_tdoa_solve(&an, &rd[(k*rep + r)*ac], NULL, p, NULL);
+               dwm_track_add(&tr, p, &handle[r]);
+            }
+            dt = 0;
+         }
+         t0 = now_ns();
+         for(r = 0; r < rep; r++)
+         {
+            dwm_track_predict(&tr, handle[r], dt, q);
+            dwm_tdoa_solve_warm(&an, &rd[(k*rep + r)*ac], q, DWM_TDOA_WARM_RMS, p, NULL, &it);
+            iters += it;
+            se_pred += pow(p[0] - log->x[k], 2) + pow(p[1] - log->y[k], 2);
+         }
+         t2 += now_ns() - t0;
+         t0 = now_ns();
+         for(r = 0; r < rep; r++)
+         {
+            dwm_track_meas(&tr, handle[r], &rd[(k*rep + r)*ac], NULL);
+         }
+         dwm_track_step(&tr, dt);
+         lat[k] = (double)(now_ns() - t0);
+         t1 += now_ns() - t0;
+         for(r = 0; r < rep; r++)
+         {
+            dwm_track_get(&tr, handle[r], st);
+            se += pow(st[0] - log->x[k], 2) + pow(st[1] - log->y[k], 2);
+         }
+      }
+      printf("   track:  %9.0f tag updates/s, rmse %.4f m, step ", n / (t1 * 1e-9), sqrt(se / n));
+      print_lat(lat, log->cnt);
+      printf("\n");
+      printf("   pred:   %9.0f fixes/s, rmse %.4f m, %.2f iterations\n", n / (t2 * 1e-9), sqrt(se_pred / n),
+            (double)iters / n);
+      dwm_track_free(&tr);
+   }
+
+   if(log->py_rmse[2] >= 0)
+   {
+      printf("   python: rmse lin %.4f hyp %.4f filt %.4f m\n", log->py_rmse[0], log->py_rmse[1], log->py_rmse[2]);
+   }
+   if(use_gdop)
+   {
+      dwm_gdop_free(&gdop);
+   }
+   free(rp.sub_ns);
+   free(rp.lat_ns);
+   free(rp.fx);
+   free(rp.fy);
+   free(rp.rv);
+   free(handle);
+   free(rd);
+   free(ts);
+   free(lat);
+}
+
+int main(int argc, char * argv[])
+{
+   int opt, rep = 1, worker_cnt = (int)sysconf(_SC_NPROCESSORS_ONLN), an_cnt = 0, sub_cnt = 0;
+   double speed = 0, noise_ns = -1;
+   replay_log_t log;
+
+   while((opt = getopt(argc, argv, "x:r:w:a:n:g:s:")) != -1)
+   {
+      switch(opt)
+      {
+         case 'x': speed = atof(optarg); break;
+         case 'r': rep = atoi(optarg); break;
+         case 'w': worker_cnt = atoi(optarg); break;
+         case 'a': an_cnt = atoi(optarg); break;
+         case 'n': noise_ns = atof(optarg); break;
+         case 'g': sub_cnt = atoi(optarg); break;
+         case 's': rng_state = strtoull(optarg, NULL, 0) | 1; break;
+         default:
+            fprintf(stderr, "usage: %s [-x speed] [-r replicas] [-w workers] [-a anchors] [-n noise_ns] [-g subset] [-s seed] log.csv...\n", argv[0]);
+            return 1;
+      }
+   }
+   if((optind == argc) || (rep < 1))
+   {
+      fprintf(stderr, "usage: %s [-x speed] [-r replicas] [-w workers] [-a anchors] [-n noise_ns] [-g subset] [-s seed] log.csv...\n", argv[0]);
+      return 1;
+   }
+   worker_cnt = (worker_cnt < 1) ? 1 : (worker_cnt > DWM_PIPE_WORKER_MAX) ? DWM_PIPE_WORKER_MAX : worker_cnt;
+
+   for(; optind < argc; optind++)
+   {
+      if(log_load(&log, argv[optind]) != 0)
+      {
+         continue;
+      }
+      if((an_cnt >= 3) && (an_cnt <= ANCHOR_CNT_MAX))
+      {
+         log.an_cnt = an_cnt;
+      }
+      if(noise_ns >= 0)
+      {
+         log.noise_ns = noise_ns;
+      }
+      if(log.cnt > 0)
+      {
+         replay(&log, rep, worker_cnt, speed, sub_cnt);
+      }
+      free(log.t);
+      free(log.x);
+      free(log.y);
+   }
+   return 0;
+}
@@ -0,0 +1,579 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    blink_gen.c
+ * @brief   synthetic TDoA blink load generator, in place of the Tkinter
+ *          simulators, to find the saturation points of the host ingestion,
+ *          the clock synchronisation and the solvers before a game
+ *
+ *          usage: blink_gen [-t tags] [-a anchors] [-f blink_hz] [-d s] [-n noise_ns]
+ *                           [-p drift_ppm] [-l loss_%] [-b baud] [-x speed]
+ *                           [-u host:port | -o prefix] [-s seed]
+ *
+ *          The tags move about the court and blink at blink_hz, with a 10%
+ *          jitter, plus a reference tag at the centre for dwm_clk.h. Each
+ *          anchor has its own 40 bit counter, at a random offset and a drift
+ *          of up to drift_ppm, the RX timestamps have noise_ns of noise. A
+ *          blink is lost by an anchor with the loss probability, and by all
+ *          of them when it overlaps another blink on the air.
+ *
+ *          Each anchor is modelled as the tdoa_anchor firmware: the blinks
+ *          go into a ring of BLINK_RING_SIZE records, dropped when full, and
+ *          are sent in cmd_bin.h frames of up to GEN_BATCH_MAX blink_rec_t
+ *          records once the batch is full or GEN_BATCH_MS after it started,
+ *          with a CMD_BIN_DROPS TLV when the drop counter changed. A frame
+ *          holds the link for its length at baud bit/s, 10 bits per byte, so
+ *          the frames come at the rate of the anchor UART, -b 0 for no limit.
+ *
+ *          The frames of anchor i go to UDP port+i, default 127.0.0.1:1240,
+ *          or to the file <prefix>i.bin, as read from its serial port. The
+ *          time is simulated, -x paces it at speed times real time, -x 0 as
+ *          fast as possible.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "dwm_clk.h"
+#include "dwm_tlv.h"
+
+#define FEET_TO_M          0.3048
+#define COURT_X            (94 * FEET_TO_M)
+#define COURT_Y            (50 * FEET_TO_M)
+#define GEN_HOST           "127.0.0.1"
+#define GEN_PORT           1240
+#define GEN_TAG_MAX        4096
+#define GEN_STEP_US        1000     // simulation step, the anchor main loop period
+#define GEN_SPEED_MAX      7.0      // m/s of the players
+#define GEN_ACCEL          3.0      // m/s^2 rms of the players
+#define GEN_AIR_US         150      // blink on the air, 6.8 Mbps, 128 symbol preamble
+#define GEN_REF_HZ         10       // reference tag blink rate
+#define GEN_REF_ID         0xDECA0000FFFFFFFFULL
+#define GEN_TAG_ID         0xDECA000000000000ULL    // + tag number from 1
+
+/* tdoa_anchor firmware, blink_ring.h, cmd_bin.h and anchor.c */
+#define BLINK_RING_SIZE    64
+#define BLINK_REC_LEN      18
+#define CMD_BIN_SOF        0xA5
+#define CMD_BIN_HDR_LEN    3
+#define CMD_BIN_CRC_LEN    2
+#define CMD_BIN_BLINKS     0x10
+#define CMD_BIN_DROPS      0x11
+#define GEN_BATCH_MAX      (255 / BLINK_REC_LEN)
+#define GEN_BATCH_MS       10
+#define GEN_DROPS_LEN      8
+#define GEN_FRAME_MAX      (CMD_BIN_HDR_LEN + 2 + GEN_BATCH_MAX*BLINK_REC_LEN + 2 + GEN_DROPS_LEN + CMD_BIN_CRC_LEN)
+
+/**
+ * @brief tag, the reference tag is the last one
+ */
+typedef struct {
+   uint64_t id;
+   uint8_t seq;
+   double x, y, vx, vy;    // m, m/s
+   double t_move;          // s, time of x, y
+   double t_next;          // s, next blink
+   double period;          // s
+} gen_tag_t;
+
+/**
+ * @brief anchor, its counter is off + t*(1 + drift) s
+ */
+typedef struct {
+   double x, y;
+   double off;             // s
+   double drift;
+   uint8_t ring[BLINK_RING_SIZE][BLINK_REC_LEN];
+   uint32_t head, tail;    // free running
+   uint32_t dropped, rep_dropped;
+   int batch_wait;
+   double batch_t;
+   double link_free;       // s, end of the frame on the link
+   uint64_t frames, bytes, recs;
+   double busy;            // s of the link used
+   FILE *f;
+} gen_anchor_t;
+
+/**
+ * @brief blink on the air, delivered once the next one shows it did not collide
+ */
+typedef struct {
+   int valid;
+   int tag;
+   double t, x, y;
+   uint8_t seq;
+   int collided;
+} gen_blink_t;
+
+static volatile sig_atomic_t running = 1;
+static uint64_t rng_state = 88172645463325252ULL;
+static gen_tag_t tags[GEN_TAG_MAX + 1];
+static int heap[GEN_TAG_MAX + 1];
+static gen_anchor_t anchors[DWM_CLK_ANCHOR_CNT_MAX];
+static int tag_cnt = 20, an_cnt = 6;
+static double noise_s, loss;
+static long baud = 115200;
+static int udp_fd = -1, udp_port = GEN_PORT;
+static struct sockaddr_in udp_addr;
+static uint64_t blinks, lost, collided;
+
+static void stop(int sig)
+{
+   (void)sig;
+   running = 0;
+}
+
+static double rng_uniform(void)
+{
+   rng_state ^= rng_state << 13;
+   rng_state ^= rng_state >> 7;
+   rng_state ^= rng_state << 17;
+   return ((rng_state >> 11) + 0.5) / 9007199254740992.0;
+}
+
+static double rng_gauss(void)
+{
+   return sqrt(-2 * log(rng_uniform())) * cos(2 * M_PI * rng_uniform());
+}
+
+static uint64_t now_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief anchors on the court: the corners, then the half court line, then
+ *        along the side lines
+ */
+static void court_anchors(void)
+{
+   const double an[6][2] = {{0, 0}, {0, COURT_Y}, {COURT_X, 0}, {COURT_X, COURT_Y},
+         {47 * FEET_TO_M, 0}, {47 * FEET_TO_M, COURT_Y}};
+   int i;
+
+   for(i = 0; i < an_cnt; i++)
+   {
+      if(i < 6)
+      {
+         anchors[i].x = an[i][0];
+         anchors[i].y = an[i][1];
+      }
+      else
+      {
+         anchors[i].x = COURT_X * ((i - 6) / 2 + 1) / ((an_cnt - 6 + 1) / 2 + 1);
+         anchors[i].y = ((i - 6) & 1) ? COURT_Y : 0;
+      }
+   }
+}
+
+/**
+ * @brief min heap of the tags by next blink
+ */
+static void heap_down(int i, int n)
+{
+   int c, t;
+
+   for(;;)
+   {
+      c = 2*i + 1;
+      if(c >= n)
+      {
+         return;
+      }
+      if((c + 1 < n) && (tags[heap[c+1]].t_next < tags[heap[c]].t_next))
+      {
+         c++;
+      }
+      if(tags[heap[i]].t_next <= tags[heap[c]].t_next)
+      {
+         return;
+      }
+      t = heap[i]; heap[i] = heap[c]; heap[c] = t;
+      i = c;
+   }
+}
+
+/**
+ * @brief moves a tag to time t: random acceleration, bounded speed, bouncing
+ *        off the court lines
+ */
+static void tag_move(gen_tag_t* g, double t)
+{
+   double dt = t - g->t_move, s, a = GEN_ACCEL * sqrt(dt);
+
+   if(g->id == GEN_REF_ID)
+   {
+      return;
+   }
+   g->vx += a * rng_gauss();
+   g->vy += a * rng_gauss();
+   s = sqrt(g->vx*g->vx + g->vy*g->vy);
+   if(s > GEN_SPEED_MAX)
+   {
+      g->vx *= GEN_SPEED_MAX / s;
+      g->vy *= GEN_SPEED_MAX / s;
+   }
+   g->x += g->vx * dt;
+   g->y += g->vy * dt;
+   if((g->x < 0) || (g->x > COURT_X))
+   {
+      g->vx = -g->vx;
+      g->x = (g->x < 0) ? -g->x : 2*COURT_X - g->x;
+   }
+   if((g->y < 0) || (g->y > COURT_Y))
+   {
+      g->vy = -g->vy;
+      g->y = (g->y < 0) ? -g->y : 2*COURT_Y - g->y;
+   }
+   g->t_move = t;
+}
+
+/**
+ * @brief reception of a blink by the anchors, as anchor_rx_record()
+ */
+static void blink_rx(const gen_blink_t* b)
+{
+   gen_anchor_t *a;
+   uint8_t *r;
+   double dx, dy, ts;
+   uint64_t ticks;
+   int i;
+
+   if(b->collided)
+   {
+      collided++;
+      lost += an_cnt;
+      return;
+   }
+   for(i = 0; i < an_cnt; i++)
+   {
+      a = &anchors[i];
+      if(rng_uniform() < loss)
+      {
+         lost++;
+         continue;
+      }
+      if(a->head - a->tail == BLINK_RING_SIZE)
+      {
+         a->dropped++;
+         continue;
+      }
+      dx = b->x - a->x;
+      dy = b->y - a->y;
+      ts = a->off + (b->t + sqrt(dx*dx + dy*dy) / DWM_CLK_SPEED_OF_LIGHT) * (1 + a->drift) + noise_s * rng_gauss();
+      ticks = (uint64_t)llround(ts * DWM_CLK_TICK_HZ) & ((1ULL << DWM_CLK_TS_BITS) - 1);
+      r = a->ring[a->head++ % BLINK_RING_SIZE];
+      dwm_tlv_put(r, ticks, 5);
+      dwm_tlv_put(r + 5, tags[b->tag].id, 8);
+      r[13] = b->seq;
+      dwm_tlv_put(r + 14, (uint16_t)((740 + (int)(4 * rng_uniform())) << 6), 2);   // first path index, 10.6
+      dwm_tlv_put(r + 16, (uint16_t)(6000 + 2000 * rng_uniform()), 2);             // first path amplitude
+   }
+}
+
+/**
+ * @brief sends a frame of an anchor
+ */
+static void frame_send(int i, const uint8_t* frame, uint16_t len)
+{
+   struct sockaddr_in addr = udp_addr;
+
+   if(anchors[i].f != NULL)
+   {
+      fwrite(frame, 1, len, anchors[i].f);
+   }
+   else
+   {
+      addr.sin_port = htons(udp_port + i);
+      sendto(udp_fd, frame, len, 0, (struct sockaddr*)&addr, sizeof(addr));
+   }
+}
+
+/**
+ * @brief main loop of an anchor at time t, as anchor_run(), called until the
+ *        link is busy or the batch waits
+ */
+static int anchor_run(int i, double t)
+{
+   gen_anchor_t *a = &anchors[i];
+   uint8_t frame[GEN_FRAME_MAX], *tlv = frame + CMD_BIN_HDR_LEN;
+   uint32_t n = a->head - a->tail, k;
+   uint16_t len, crc;
+
+   if((n == 0) || (a->link_free > t))
+   {
+      return 0;
+   }
+   if(n < GEN_BATCH_MAX)
+   {
+      if(!a->batch_wait)
+      {
+         a->batch_wait = 1;
+         a->batch_t = t;
+         return 0;
+      }
+      if(t - a->batch_t < GEN_BATCH_MS * 1e-3)
+      {
+         return 0;
+      }
+   }
+   a->batch_wait = 0;
+   n = (n < GEN_BATCH_MAX) ? n : GEN_BATCH_MAX;
+
+   tlv[0] = CMD_BIN_BLINKS;
+   tlv[1] = (uint8_t)(n * BLINK_REC_LEN);
+   for(k = 0; k < n; k++)
+   {
+      memcpy(tlv + 2 + k*BLINK_REC_LEN, a->ring[a->tail++ % BLINK_RING_SIZE], BLINK_REC_LEN);
+   }
+   len = 2 + tlv[1];
+   if(a->dropped != a->rep_dropped)
+   {
+      tlv[len] = CMD_BIN_DROPS;
+      tlv[len + 1] = GEN_DROPS_LEN;
+      dwm_tlv_put(tlv + len + 2, a->dropped, 4);
+      dwm_tlv_put(tlv + len + 6, 0, 4);
+      len += 2 + GEN_DROPS_LEN;
+      a->rep_dropped = a->dropped;
+   }
+   frame[0] = CMD_BIN_SOF;
+   dwm_tlv_put(frame + 1, len, 2);
+   crc = dwm_tlv_crc16(0xFFFF, frame + 1, len + 2);
+   dwm_tlv_put(frame + CMD_BIN_HDR_LEN + len, crc, 2);
+   len += CMD_BIN_HDR_LEN + CMD_BIN_CRC_LEN;
+
+   frame_send(i, frame, len);
+   if(baud > 0)
+   {
+      a->link_free = t + len * 10.0 / baud;
+      a->busy += len * 10.0 / baud;
+   }
+   a->frames++;
+   a->bytes += len;
+   a->recs += n;
+   return 1;
+}
+
+/**
+ * @brief prints the load of the last second
+ */
+static void print_load(double t, double wall_s)
+{
+   static uint64_t blinks0, lost0, recs0, bytes0;
+   static uint32_t dropped0;
+   static double busy0[DWM_CLK_ANCHOR_CNT_MAX];
+   uint64_t recs = 0, bytes = 0;
+   uint32_t dropped = 0;
+   double busy_max = 0;
+   int i;
+
+   for(i = 0; i < an_cnt; i++)
+   {
+      recs += anchors[i].recs;
+      bytes += anchors[i].bytes;
+      dropped += anchors[i].dropped;
+      if(anchors[i].busy - busy0[i] > busy_max)
+      {
+         busy_max = anchors[i].busy - busy0[i];
+      }
+      busy0[i] = anchors[i].busy;
+   }
+   printf("%6.1f s (%.2f s): %llu blinks, %llu records, %llu lost, %u ring drops, %llu bytes, link %.0f%%\n",
+         t, wall_s, (unsigned long long)(blinks - blinks0), (unsigned long long)(recs - recs0),
+         (unsigned long long)(lost - lost0), dropped - dropped0, (unsigned long long)(bytes - bytes0), 100 * busy_max);
+   blinks0 = blinks;
+   lost0 = lost;
+   recs0 = recs;
+   bytes0 = bytes;
+   dropped0 = dropped;
+}
+
+int main(int argc, char*argv[])
+{
+   char host[64] = GEN_HOST, name[256], *prefix = NULL, *colon;
+   double dur = 10, hz = 10, drift_ppm = 20, speed = 1, t, t_end, t_print = 1;
+   gen_blink_t prev = {0}, cur;
+   uint64_t wall0, recs = 0, bytes = 0, frames = 0;
+   uint32_t dropped = 0;
+   gen_tag_t *g;
+   int opt, i, n, step;
+
+   noise_s = 0.5e-9;
+   loss = 0.02;
+   while((opt = getopt(argc, argv, "t:a:f:d:n:p:l:b:x:u:o:s:")) != -1)
+   {
+      switch(opt)
+      {
+         case 't': tag_cnt = atoi(optarg); break;
+         case 'a': an_cnt = atoi(optarg); break;
+         case 'f': hz = atof(optarg); break;
+         case 'd': dur = atof(optarg); break;
+         case 'n': noise_s = atof(optarg) * 1e-9; break;
+         case 'p': drift_ppm = atof(optarg); break;
+         case 'l': loss = atof(optarg) / 100; break;
+         case 'b': baud = atol(optarg); break;
+         case 'x': speed = atof(optarg); break;
+         case 'u':
+            snprintf(host, sizeof(host), "%s", optarg);
+            colon = strchr(host, ':');
+            if(colon != NULL)
+            {
+               *colon = 0;
+               udp_port = atoi(colon+1);
+            }
+            break;
+         case 'o': prefix = optarg; break;
+         case 's': rng_state = strtoull(optarg, NULL, 0) | 1; break;
+         default:
+            fprintf(stderr, "usage: %s [-t tags] [-a anchors] [-f blink_hz] [-d s] [-n noise_ns] [-p drift_ppm] "
+                  "[-l loss_%%] [-b baud] [-x speed] [-u host:port | -o prefix] [-s seed]\n", argv[0]);
+            return 1;
+      }
+   }
+   if((tag_cnt < 1) || (tag_cnt > GEN_TAG_MAX) || (an_cnt < 3) || (an_cnt > DWM_CLK_ANCHOR_CNT_MAX) || (hz <= 0))
+   {
+      fprintf(stderr, "blink_gen: 1 to %d tags, 3 to %d anchors, blink_hz > 0\n", GEN_TAG_MAX, DWM_CLK_ANCHOR_CNT_MAX);
+      return 1;
+   }
+   if(prefix == NULL)
+   {
+      memset(&udp_addr, 0, sizeof(udp_addr));
+      udp_addr.sin_family = AF_INET;
+      udp_fd = socket(AF_INET, SOCK_DGRAM, 0);
+      if((inet_pton(AF_INET, host, &udp_addr.sin_addr) != 1) || (udp_fd < 0))
+      {
+         fprintf(stderr, "blink_gen: cannot send to %s\n", host);
+         return 1;
+      }
+   }
+   signal(SIGINT, stop);
+   signal(SIGTERM, stop);
+
+   court_anchors();
+   for(i = 0; i < an_cnt; i++)
+   {
+      anchors[i].off = rng_uniform() * (1ULL << DWM_CLK_TS_BITS) / DWM_CLK_TICK_HZ;
+      anchors[i].drift = (2 * rng_uniform() - 1) * drift_ppm * 1e-6;
+      if(prefix != NULL)
+      {
+         snprintf(name, sizeof(name), "%s%d.bin", prefix, i);
+         anchors[i].f = fopen(name, "wb");
+         if(anchors[i].f == NULL)
+         {
+            fprintf(stderr, "blink_gen: cannot write %s\n", name);
+            return 1;
+         }
+      }
+      if(prefix != NULL)
+      {
+         snprintf(name, sizeof(name), "%s%d.bin", prefix, i);
+      }
+      else
+      {
+         snprintf(name, sizeof(name), "%s:%d", host, udp_port + i);
+      }
+      printf("anchor %d: %.3f %.3f m, drift %+.3f ppm, %s\n", i, anchors[i].x, anchors[i].y, anchors[i].drift * 1e6, name);
+   }
+   for(i = 0; i <= tag_cnt; i++)
+   {
+      g = &tags[i];
+      g->id = (i < tag_cnt) ? GEN_TAG_ID + i + 1 : GEN_REF_ID;
+      g->x = (i < tag_cnt) ? COURT_X * rng_uniform() : COURT_X / 2;
+      g->y = (i < tag_cnt) ? COURT_Y * rng_uniform() : COURT_Y / 2;
+      g->period = (i < tag_cnt) ? 1 / hz : 1.0 / GEN_REF_HZ;
+      g->t_next = g->period * rng_uniform();
+      heap[i] = i;
+   }
+   n = tag_cnt + 1;
+   for(i = n/2 - 1; i >= 0; i--)
+   {
+      heap_down(i, n);
+   }
+   printf("reference tag 0x%016llx at %.3f %.3f m, %d tags 0x%016llx.. at %.1f Hz\n", (unsigned long long)GEN_REF_ID,
+         COURT_X / 2, COURT_Y / 2, tag_cnt, (unsigned long long)GEN_TAG_ID + 1, hz);
+
+   wall0 = now_ns();
+   t_end = (dur > 0) ? dur : INFINITY;
+   for(step = 1; running && (step * GEN_STEP_US * 1e-6 <= t_end); step++)
+   {
+      t = step * GEN_STEP_US * 1e-6;
+      // the blinks of the step, in time order: each one is delivered once the
+      // next shows whether they overlapped on the air
+      while(tags[heap[0]].t_next < t)
+      {
+         g = &tags[heap[0]];
+         tag_move(g, g->t_next);
+         cur.valid = 1;
+         cur.tag = heap[0];
+         cur.t = g->t_next;
+         cur.x = g->x;
+         cur.y = g->y;
+         cur.seq = g->seq++;
+         cur.collided = 0;
+         if(prev.valid && (cur.t - prev.t < GEN_AIR_US * 1e-6))
+         {
+            prev.collided = cur.collided = 1;
+         }
+         if(prev.valid)
+         {
+            blink_rx(&prev);
+         }
+         prev = cur;
+         blinks++;
+         g->t_next += g->period * (0.9 + 0.2 * rng_uniform());
+         heap_down(0, n);
+      }
+      for(i = 0; i < an_cnt; i++)
+      {
+         while(anchor_run(i, t))
+         {
+         }
+      }
+      if(speed > 0)
+      {
+         int64_t wait_ns = (int64_t)(t / speed * 1e9) - (int64_t)(now_ns() - wall0);
+         if(wait_ns > 0)
+         {
+            struct timespec ts = { wait_ns / 1000000000, wait_ns % 1000000000 };
+            nanosleep(&ts, NULL);
+         }
+      }
+      if(t >= t_print - 1e-9)
+      {
+         print_load(t, (now_ns() - wall0) * 1e-9);
+         t_print += 1;
+      }
+   }
+
+   for(i = 0; i < an_cnt; i++)
+   {
+      recs += anchors[i].recs;
+      bytes += anchors[i].bytes;
+      frames += anchors[i].frames;
+      dropped += anchors[i].dropped;
+      if(anchors[i].f != NULL)
+      {
+         fclose(anchors[i].f);
+      }
+   }
+   t = (now_ns() - wall0) * 1e-9;
+   printf("blink_gen: %llu blinks (%llu collided), %llu records in %llu frames, %llu bytes, %llu lost, %u ring drops, "
+         "%.0f records/s\n", (unsigned long long)blinks, (unsigned long long)collided, (unsigned long long)recs,
+         (unsigned long long)frames, (unsigned long long)bytes, (unsigned long long)lost, dropped, recs / t);
+   return 0;
+}
@@ -0,0 +1,120 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    loc_frame.c
+ * @brief   binary location frames of the publisher and the aggregator
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "dwm_tlv.h"
+#include "loc_frame.h"
+
+void LocFrame_Init(loc_frame_t* f, uint64_t node_id)
+{
+   f->node_id = node_id;
+   f->seq = 0;
+   LocFrame_Reset(f);
+}
+
+void LocFrame_Reset(loc_frame_t* f)
+{
+   f->len = LOC_FRAME_HDR_LEN;
+   f->cnt = 0;
+}
+
+int LocFrame_Add(loc_frame_t* f, const loc_frame_loc_t* loc)
+{
+   uint8_t *p = f->data + f->len;
+   uint8_t i, cnt = (loc->cnt < DWM_RANGING_ANCHOR_CNT_MAX) ? loc->cnt : DWM_RANGING_ANCHOR_CNT_MAX;
+
+   if((f->len + LOC_FRAME_LOC_LEN + cnt*LOC_FRAME_DIST_LEN > LOC_FRAME_MAX) || (f->cnt == 255))
+   {
+      return -1;
+   }
+   dwm_tlv_put(p, loc->ts, 8); p += 8;
+   dwm_tlv_put(p, loc->node_id, 8); p += 8;
+   dwm_tlv_put(p, loc->seq, 4); p += 4;
+   dwm_tlv_put(p, (uint32_t)loc->x, 4); p += 4;
+   dwm_tlv_put(p, (uint32_t)loc->y, 4); p += 4;
+   dwm_tlv_put(p, (uint32_t)loc->z, 4); p += 4;
+   *p++ = loc->qf;
+   *p++ = cnt;
+   for(i = 0; i < cnt; i++)
+   {
+      dwm_tlv_put(p, loc->addr[i], 2); p += 2;
+      dwm_tlv_put(p, loc->dist[i], 4); p += 4;
+      *p++ = loc->dist_qf[i];
+   }
+   f->len = p - f->data;
+   f->cnt++;
+   return 0;
+}
+
+uint16_t LocFrame_Close(loc_frame_t* f)
+{
+   if(f->cnt == 0)
+   {
+      return 0;
+   }
+   memcpy(f->data, LOC_FRAME_MAGIC, 4);
+   f->data[4] = LOC_FRAME_VERSION;
+   f->data[5] = f->cnt;
+   dwm_tlv_put(f->data+6, f->len, 2);
+   dwm_tlv_put(f->data+8, f->seq++, 4);
+   dwm_tlv_put(f->data+12, f->node_id, 8);
+   return f->len;
+}
+
+int LocFrame_ParseHdr(const uint8_t* buf, uint16_t len, uint8_t* cnt, uint16_t* flen, uint32_t* seq, uint64_t* node_id)
+{
+   if((len < LOC_FRAME_HDR_LEN) || (memcmp(buf, LOC_FRAME_MAGIC, 4) != 0) || (buf[4] != LOC_FRAME_VERSION))
+   {
+      return -1;
+   }
+   *cnt = buf[5];
+   *flen = (uint16_t)dwm_tlv_get(buf+6, 2);
+   *seq = (uint32_t)dwm_tlv_get(buf+8, 4);
+   *node_id = dwm_tlv_get(buf+12, 8);
+   if((*flen < LOC_FRAME_HDR_LEN) || (*flen > LOC_FRAME_MAX))
+   {
+      return -1;
+   }
+   return 0;
+}
+
+int LocFrame_Get(const uint8_t* buf, uint16_t len, uint16_t* off, loc_frame_loc_t* loc)
+{
+   const uint8_t *p = buf + *off;
+   uint8_t i;
+
+   if(*off + LOC_FRAME_LOC_LEN > len)
+   {
+      return -1;
+   }
+   loc->ts = dwm_tlv_get(p, 8); p += 8;
+   loc->node_id = dwm_tlv_get(p, 8); p += 8;
+   loc->seq = (uint32_t)dwm_tlv_get(p, 4); p += 4;
+   loc->x = (int32_t)dwm_tlv_get(p, 4); p += 4;
+   loc->y = (int32_t)dwm_tlv_get(p, 4); p += 4;
+   loc->z = (int32_t)dwm_tlv_get(p, 4); p += 4;
+   loc->qf = *p++;
+   loc->cnt = *p++;
+   if((loc->cnt > DWM_RANGING_ANCHOR_CNT_MAX) || (*off + LOC_FRAME_LOC_LEN + loc->cnt*LOC_FRAME_DIST_LEN > len))
+   {
+      return -1;
+   }
+   for(i = 0; i < loc->cnt; i++)
+   {
+      loc->addr[i] = (uint16_t)dwm_tlv_get(p, 2); p += 2;
+      loc->dist[i] = (uint32_t)dwm_tlv_get(p, 4); p += 4;
+      loc->dist_qf[i] = *p++;
+   }
+   *off = p - buf;
+   return 0;
+}
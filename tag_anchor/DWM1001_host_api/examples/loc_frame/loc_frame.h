@@ -0,0 +1,107 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    loc_frame.h
+ * @brief   binary location frames of the publisher and the aggregator
+ *
+ *          Frame, little endian, no padding:
+ *          header, LOC_FRAME_HDR_LEN bytes:
+ *             magic "DWMP", version u8, cnt u8 locations, len u16 frame bytes,
+ *             seq u32 frame number, node_id u64 of the sender
+ *          then cnt locations, LOC_FRAME_LOC_LEN bytes + LOC_FRAME_DIST_LEN
+ *          bytes per anchor:
+ *             ts u64 wall clock us since the epoch, node_id u64, seq u32
+ *             location number, x i32, y i32, z i32 mm, qf u8, an_cnt u8,
+ *             an_cnt times: addr u16, dist u32 mm, qf u8
+ *          A gap in the frame seq is a lost frame, a gap in the location seq
+ *          a location dropped before the frame.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _LOC_FRAME_H_
+#define _LOC_FRAME_H_
+
+#include <stdint.h>
+#include "dwm_api.h"
+
+#define LOC_FRAME_MAGIC       "DWMP"
+#define LOC_FRAME_VERSION     1
+#define LOC_FRAME_HDR_LEN     20
+#define LOC_FRAME_LOC_LEN     34
+#define LOC_FRAME_DIST_LEN    7
+#define LOC_FRAME_MAX         1400     // bytes, below the Ethernet MTU so the frames are not fragmented
+
+/**
+ * @brief location of a frame
+ */
+typedef struct {
+   uint64_t ts;            // wall clock us since the epoch
+   uint64_t node_id;
+   uint32_t seq;
+   int32_t x, y, z;        // mm
+   uint8_t qf;
+   uint8_t cnt;            // anchors
+   uint16_t addr[DWM_RANGING_ANCHOR_CNT_MAX];
+   uint32_t dist[DWM_RANGING_ANCHOR_CNT_MAX];
+   uint8_t dist_qf[DWM_RANGING_ANCHOR_CNT_MAX];
+} loc_frame_loc_t;
+
+/**
+ * @brief frame being filled
+ */
+typedef struct {
+   uint8_t data[LOC_FRAME_MAX];
+   uint16_t len;
+   uint8_t cnt;
+   uint32_t seq;           // of the next frame
+   uint64_t node_id;
+} loc_frame_t;
+
+/**
+ * @brief starts the frames of a sender, seq from 0
+ */
+void LocFrame_Init(loc_frame_t* f, uint64_t node_id);
+
+/**
+ * @brief appends a location
+ *
+ * @return 0, -1 if the frame is full, it must be sent first
+ */
+int LocFrame_Add(loc_frame_t* f, const loc_frame_loc_t* loc);
+
+/**
+ * @brief writes the header of a frame holding locations, to be sent,
+ *        LocFrame_Reset() starts the next one
+ *
+ * @return frame length, 0 if the frame is empty
+ */
+uint16_t LocFrame_Close(loc_frame_t* f);
+
+/**
+ * @brief empties a frame, keeping its seq
+ */
+void LocFrame_Reset(loc_frame_t* f);
+
+/**
+ * @brief checks the header of a received frame
+ *
+ * @param[in] buf, len: received bytes, at least the header
+ * @param[out] cnt, flen, seq, node_id: header fields, flen is the frame length
+ *
+ * @return 0, -1 if buf does not start with a frame header
+ */
+int LocFrame_ParseHdr(const uint8_t* buf, uint16_t len, uint8_t* cnt, uint16_t* flen, uint32_t* seq, uint64_t* node_id);
+
+/**
+ * @brief decodes the location at *off of a frame and moves *off to the next,
+ *        the first is at LOC_FRAME_HDR_LEN
+ *
+ * @return 0, -1 if the location is cut or broken
+ */
+int LocFrame_Get(const uint8_t* buf, uint16_t len, uint16_t* off, loc_frame_loc_t* loc);
+
+#endif //_LOC_FRAME_H_
@@ -0,0 +1,100 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    loc_shm.c
+ * @brief   shared memory ring of the locations, see loc_shm.h
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "loc_shm.h"
+
+_Static_assert(sizeof(loc_shm_hdr_t) == LOC_SHM_HDR_LEN, "loc_shm header length");
+_Static_assert(sizeof(loc_shm_slot_t) == LOC_SHM_SLOT_LEN, "loc_shm slot length");
+
+int LocShm_Open(loc_shm_t* r, const char* name, uint32_t slot_cnt)
+{
+   struct timeval tv;
+
+   memset(r, 0, sizeof(*r));
+   if((slot_cnt == 0) || ((slot_cnt & (slot_cnt - 1)) != 0))
+   {
+      return -1;
+   }
+   snprintf(r->name, sizeof(r->name), "/%s", name);
+   r->size = LOC_SHM_HDR_LEN + (size_t)slot_cnt*LOC_SHM_SLOT_LEN;
+   r->fd = shm_open(r->name, O_CREAT | O_RDWR, 0644);
+   if(r->fd < 0)
+   {
+      return -1;
+   }
+   if(ftruncate(r->fd, r->size) != 0)
+   {
+      close(r->fd);
+      return -1;
+   }
+   r->hdr = mmap(NULL, r->size, PROT_READ | PROT_WRITE, MAP_SHARED, r->fd, 0);
+   if(r->hdr == MAP_FAILED)
+   {
+      close(r->fd);
+      return -1;
+   }
+   r->slot = (loc_shm_slot_t*)((uint8_t*)r->hdr + LOC_SHM_HDR_LEN);
+
+   // the readers check the magic first, it is written last
+   memset(r->hdr->magic, 0, sizeof(r->hdr->magic));
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+   memset(r->slot, 0, (size_t)slot_cnt*LOC_SHM_SLOT_LEN);
+   gettimeofday(&tv, NULL);
+   r->hdr->version = LOC_SHM_VERSION;
+   r->hdr->slot_len = LOC_SHM_SLOT_LEN;
+   r->hdr->slot_cnt = slot_cnt;
+   __atomic_store_n(&r->hdr->head, 0, __ATOMIC_RELAXED);
+   __atomic_store_n(&r->hdr->epoch, (uint64_t)tv.tv_sec*1000000 + tv.tv_usec, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+   memcpy(r->hdr->magic, LOC_SHM_MAGIC, sizeof(r->hdr->magic));
+   return 0;
+}
+
+void LocShm_Write(loc_shm_t* r, const loc_frame_loc_t* loc)
+{
+   loc_shm_slot_t* s = &r->slot[r->head & (r->hdr->slot_cnt - 1)];
+
+   __atomic_store_n(&s->seq, 2*r->head + 1, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+   s->ts = loc->ts;
+   s->node_id = loc->node_id;
+   s->loc_seq = loc->seq;
+   s->x = loc->x;
+   s->y = loc->y;
+   s->z = loc->z;
+   s->qf = loc->qf;
+   s->cnt = loc->cnt;
+   __atomic_store_n(&s->seq, 2*r->head + 2, __ATOMIC_RELEASE);
+   r->head++;
+   __atomic_store_n(&r->hdr->head, r->head, __ATOMIC_RELEASE);
+}
+
+void LocShm_Close(loc_shm_t* r, bool unlink)
+{
+   if(r->hdr != NULL)
+   {
+      munmap(r->hdr, r->size);
+      close(r->fd);
+      r->hdr = NULL;
+   }
+   if(unlink)
+   {
+      shm_unlink(r->name);
+   }
+}
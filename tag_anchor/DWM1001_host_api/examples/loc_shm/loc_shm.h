@@ -0,0 +1,109 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    loc_shm.h
+ * @brief   shared memory ring of the locations, one writer and any number
+ *          of readers
+ *
+ *          The ring is a POSIX shared memory object, /dev/shm/<name>, mapped
+ *          by the writer and by the readers, loc_shm.py for Python. Host
+ *          byte order, no padding:
+ *          header, LOC_SHM_HDR_LEN bytes:
+ *             magic "DWMS", version u32, slot_len u32, slot_cnt u32 (power
+ *             of 2), head u64 locations written, epoch u64 wall clock us of
+ *             the creation, reserved up to LOC_SHM_HDR_LEN
+ *          then slot_cnt slots, location n in slot n & (slot_cnt - 1):
+ *             seq u64, ts u64 wall clock us since the epoch, node_id u64,
+ *             loc_seq u32, x i32, y i32, z i32 mm, qf u8, an_cnt u8, 6 bytes
+ *             padding
+ *
+ *          The slots are seqlocks: the writer sets seq to 2n+1, writes the
+ *          location n, sets seq to 2n+2 and then head to n+1. A reader
+ *          keeps its own next location, reads it while next < head and
+ *          keeps it if seq is 2n+2 before and after the copy, else the
+ *          writer went round the ring over it and it is lost. The writer is
+ *          never held by the readers. A new epoch is a restarted writer, the
+ *          readers start again from head.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _LOC_SHM_H_
+#define _LOC_SHM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "../loc_frame/loc_frame.h"
+
+#define LOC_SHM_MAGIC         "DWMS"
+#define LOC_SHM_VERSION       1
+#define LOC_SHM_HDR_LEN       64
+#define LOC_SHM_SLOT_LEN      48
+#define LOC_SHM_SLOT_CNT      4096     // default, 4 s of 1000 locations/s
+
+/**
+ * @brief header of the ring, in the shared memory
+ */
+typedef struct {
+   char magic[4];
+   uint32_t version;
+   uint32_t slot_len;
+   uint32_t slot_cnt;
+   uint64_t head;
+   uint64_t epoch;
+   uint8_t reserved[LOC_SHM_HDR_LEN - 32];
+} loc_shm_hdr_t;
+
+/**
+ * @brief slot of the ring, in the shared memory
+ */
+typedef struct {
+   uint64_t seq;
+   uint64_t ts;
+   uint64_t node_id;
+   uint32_t loc_seq;
+   int32_t x, y, z;
+   uint8_t qf;
+   uint8_t cnt;
+   uint8_t pad[6];
+} loc_shm_slot_t;
+
+/**
+ * @brief writer of a ring
+ */
+typedef struct {
+   char name[64];
+   int fd;
+   size_t size;
+   loc_shm_hdr_t* hdr;
+   loc_shm_slot_t* slot;
+   uint64_t head;
+} loc_shm_t;
+
+/**
+ * @brief creates the ring, or takes over the one of a previous writer of
+ *        the same name
+ *
+ * @param[in] name, of the shared memory object, without the leading '/'
+ * @param[in] slot_cnt, power of 2
+ *
+ * @return 0, -1 if the object cannot be created or mapped
+ */
+int LocShm_Open(loc_shm_t* r, const char* name, uint32_t slot_cnt);
+
+/**
+ * @brief writes a location, the anchors are not kept
+ */
+void LocShm_Write(loc_shm_t* r, const loc_frame_loc_t* loc);
+
+/**
+ * @brief unmaps the ring, and removes it if unlink, the readers mapping it
+ *        keep their mapping
+ */
+void LocShm_Close(loc_shm_t* r, bool unlink);
+
+#endif //_LOC_SHM_H_
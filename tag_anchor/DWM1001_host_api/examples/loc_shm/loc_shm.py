@@ -0,0 +1,81 @@
+# Reads the locations of the shared memory ring of loc_agg -m, see loc_shm.h for the layout.
+# usage: python3 loc_shm.py [name]
+# as a module, for the visualizers:
+#     ring = LocShm("dwm_loc")
+#     for ts, node_id, seq, x, y, z, qf, an_cnt in ring.read(): ...
+# The slots are read in place from the mapping, without a copy of the ring.
+import mmap
+import os
+import struct
+import sys
+import time
+
+NAME = "dwm_loc"
+HDR = struct.Struct("<4sIIIQQ")      # magic, version, slot_len, slot_cnt, head, epoch
+HDR_LEN = 64
+HEAD_OFF = 16
+SEQ = struct.Struct("<Q")
+SLOT = struct.Struct("<QQQIiiiBB6x") # seq, ts, node_id, loc_seq, x, y, z, qf, an_cnt
+
+class LocShm:
+    def __init__(self, name=NAME, from_start=False):
+        fd = os.open("/dev/shm/" + name, os.O_RDONLY)
+        try:
+            self.m = mmap.mmap(fd, 0, mmap.MAP_SHARED, mmap.PROT_READ)
+        finally:
+            os.close(fd)
+        magic, version, self.slot_len, self.cnt, head, self.epoch = HDR.unpack_from(self.m)
+        if magic != b"DWMS" or version != 1 or self.slot_len != SLOT.size:
+            raise ValueError(f"{name}: not a location ring")
+        self.mask = self.cnt - 1
+        self.next = max(head - self.cnt, 0) if from_start else head
+        self.lost = 0
+        self.from_start = from_start
+
+    def read(self, max_cnt=None):
+        """new locations since the last read, (ts us, node_id, seq, x, y, z mm, qf, an_cnt)"""
+        m = self.m
+        head, epoch = HDR.unpack_from(m)[4:]
+        if epoch != self.epoch:
+            # restarted writer
+            self.epoch = epoch
+            self.next = 0 if self.from_start else head
+        if head - self.next > self.cnt:
+            self.lost += head - self.next - self.cnt
+            self.next = head - self.cnt
+        if max_cnt is not None and head - self.next > max_cnt:
+            head = self.next + max_cnt
+        locs = []
+        while self.next < head:
+            off = HDR_LEN + (self.next & self.mask)*self.slot_len
+            want = 2*self.next + 2
+            slot = SLOT.unpack_from(m, off)
+            if slot[0] == want and SEQ.unpack_from(m, off)[0] == want:
+                locs.append(slot[1:])
+            else:
+                self.lost += 1   # written over while read
+            self.next += 1
+        return locs
+
+    def follow(self, poll_s=0.001):
+        """yields the locations as they are written"""
+        while True:
+            locs = self.read()
+            if not locs:
+                time.sleep(poll_s)
+            yield from locs
+
+    def close(self):
+        self.m.close()
+
+def main():
+    ring = LocShm(sys.argv[1] if len(sys.argv) > 1 else NAME)
+    lost = 0
+    for ts, node_id, seq, x, y, z, qf, an_cnt in ring.follow():
+        if ring.lost != lost:
+            print(f"{ring.lost - lost} locations lost")
+            lost = ring.lost
+        print(f"{ts/1e6:.6f} {node_id:#x} #{seq} [{x/1000:.3f},{y/1000:.3f},{z/1000:.3f},{qf}] {an_cnt} anchors")
+
+if __name__ == "__main__":
+    main()
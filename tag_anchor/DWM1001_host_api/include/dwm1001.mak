@@ -14,6 +14,7 @@ LIBS=bcm2835
 
 CFLAGS+=-pthread
 CFLAGS+=-lwiringPi  
+CFLAGS+=-lm
 # Expand defines
 # CFLAGS += $(addprefix -D,$(DEFINES))
 # PROJ_DIR = $(shell pwd)
@@ -43,6 +44,38 @@ SOURCEDIRS += $(API_DIR)
 INCLUDES += $(INC_DIR)/dwm1001_tlv.h
 INCLUDES += $(INC_DIR)/dwm_api.h
 SOURCES += $(API_DIR)/dwm_api.c
+INCLUDES += $(INC_DIR)/dwm_api_async.h
+SOURCES += $(API_DIR)/dwm_api_async.c
+INCLUDES += $(INC_DIR)/dwm_api_batch.h
+SOURCES += $(API_DIR)/dwm_api_batch.c
+INCLUDES += $(INC_DIR)/dwm_api_cache.h
+SOURCES += $(API_DIR)/dwm_api_cache.c
+INCLUDES += $(INC_DIR)/dwm_frag.h
+SOURCES += $(API_DIR)/dwm_frag.c
+INCLUDES += $(INC_DIR)/dwm_scan.h
+SOURCES += $(API_DIR)/dwm_scan.c
+INCLUDES += $(INC_DIR)/dwm_api_stream.h
+SOURCES += $(API_DIR)/dwm_api_stream.c
+INCLUDES += $(INC_DIR)/dwm_rec.h
+SOURCES += $(API_DIR)/dwm_rec.c
+INCLUDES += $(INC_DIR)/dwm_clk.h
+SOURCES += $(API_DIR)/dwm_clk.c
+INCLUDES += $(INC_DIR)/dwm_tdoa.h
+SOURCES += $(API_DIR)/dwm_tdoa.c
+INCLUDES += $(INC_DIR)/dwm_track.h
+SOURCES += $(API_DIR)/dwm_track.c
+INCLUDES += $(INC_DIR)/dwm_pipe.h
+SOURCES += $(API_DIR)/dwm_pipe.c
+INCLUDES += $(INC_DIR)/dwm_ingest.h
+SOURCES += $(API_DIR)/dwm_ingest.c
+INCLUDES += $(INC_DIR)/dwm_trace.h
+SOURCES += $(API_DIR)/dwm_trace.c
+INCLUDES += $(INC_DIR)/dwm_gdop.h
+SOURCES += $(API_DIR)/dwm_gdop.c
+INCLUDES += $(INC_DIR)/dwm_radio_stats.h
+SOURCES += $(API_DIR)/dwm_radio_stats.c
+INCLUDES += $(API_DIR)/dwm_tlv.h
+SOURCES += $(API_DIR)/dwm_tlv.c
 
 INCLUDES += $(HAL_DIR)/hal.h
 SOURCES += $(HAL_DIR)/hal.c
@@ -51,6 +84,8 @@ SOURCES += $(HAL_DIR)/hal_log.c
 INCLUDES += $(HAL_DIR)/hal_interface.h
 INCLUDES += $(HAL_DIR)/hal_gpio.h
 SOURCES += $(HAL_DIR)/hal_gpio.c
+INCLUDES += $(HAL_DIR)/hal_stat.h
+SOURCES += $(HAL_DIR)/hal_stat.c
 LOGFILES += log.txt
 
 INCLUDES += $(LMH_DIR)/lmh.h
@@ -61,6 +96,7 @@ SOURCES += $(LMH_DIR)/lmh.c
 #  USE_UART           0
 #  USE_SPI            1
 #  USE_SPI_DRDY       2
+#  USE_AUTO           3, all built, probed at run time
 ifndef INTERFACE_NUMBER
 INTERFACE_NUMBER=0
 endif
@@ -89,8 +125,28 @@ INCLUDES += $(LMH_DIR)/lmh_spirx_drdy.h
 SOURCES += $(LMH_DIR)/lmh_spirx_drdy.c
 endif 
 
+ifeq ($(INTERFACE_NUMBER),3)
+INCLUDES += $(HAL_DIR)/hal_uart.h
+SOURCES += $(HAL_DIR)/hal_uart.c
+INCLUDES += $(HAL_DIR)/hal_spi.h
+SOURCES += $(HAL_DIR)/hal_spi.c
+INCLUDES += $(LMH_DIR)/lmh_uartrx.h
+SOURCES += $(LMH_DIR)/lmh_uartrx.c
+INCLUDES += $(LMH_DIR)/lmh_spirx.h
+SOURCES += $(LMH_DIR)/lmh_spirx.c
+INCLUDES += $(LMH_DIR)/lmh_spirx_drdy.h
+SOURCES += $(LMH_DIR)/lmh_spirx_drdy.c
+endif 
+
 ifeq ($(HAL_LOG_ENABLED),1)
 DEFINES += HAL_LOG_ENABLED=$(HAL_LOG_ENABLED)
+ifdef HAL_LOG_LEVEL
+DEFINES += HAL_LOG_LEVEL=$(HAL_LOG_LEVEL)
+endif 
+endif 
+
+ifeq ($(HAL_STAT_ENABLED),1)
+DEFINES += HAL_STAT_ENABLED=$(HAL_STAT_ENABLED)
 endif 
 
 # Expand defines
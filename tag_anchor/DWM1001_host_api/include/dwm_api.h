@@ -66,6 +66,27 @@ void dwm_init(void);
  */
 void dwm_deinit(void);
 
+/**
+ * @brief Selects the module driven by the calling thread, before dwm_init().
+ *        The selection is kept per thread, so that the modules on SPI dev0 
+ *        and dev1 can be driven concurrently, each from its own thread. 
+ *        A thread not calling it drives dev0. 
+ *
+ * @param[in] dev, module device number, 0 or 1 over SPI, 0 over UART
+ *
+ * @return Error code
+ */
+int dwm_dev_sel(int dev);
+
+/**
+ * @brief Gets the module driven by the calling thread
+ *
+ * @param[in] none
+ *
+ * @return module device number
+ */
+int dwm_dev_num(void);
+
 /**
  * @brief Position coordinates in millimeters + quality factor
  */
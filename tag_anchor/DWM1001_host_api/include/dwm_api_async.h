@@ -0,0 +1,150 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_api_async.h
+ * @brief   DWM1001 host API, asynchronous requests header
+ *
+ *          The requests are queued and run one after the other by a single
+ *          I/O thread, which owns the interface: once dwm_async_init() is
+ *          called, the synchronous dwm_* functions must only be called from
+ *          the completion callbacks or through dwm_async_call().
+ *
+ *          A request completes either with its callback, called from the I/O
+ *          thread, or with dwm_async_wait() when it is submitted without a
+ *          callback. The output buffers given to a request must stay valid
+ *          until it completes.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DWM_API_ASYNC_H_
+#define _DWM_API_ASYNC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "dwm_api.h"
+
+#define DWM_ASYNC_QUEUE_LEN      16    /* requests queued or in progress */
+
+/**
+ * @brief handle of a request
+ */
+typedef struct dwm_async_req dwm_async_req_t;
+
+/**
+ * @brief completion callback, called from the I/O thread
+ *
+ * @param[in] rv, return value of the dwm_* function
+ * @param[in] user, user pointer given at submission
+ */
+typedef void (*dwm_async_cb_t)(int rv, void *user);
+
+/**
+ * @brief Starts the I/O thread, after dwm_init(). The I/O thread drives the 
+ *        module selected by the calling thread, see dwm_dev_sel().
+ *
+ * @param[in] none
+ *
+ * @return Error code
+ */
+int dwm_async_init(void);
+
+/**
+ * @brief Runs the requests already queued, then stops the I/O thread.
+ *
+ * @param[in] none
+ *
+ * @return none
+ */
+void dwm_async_deinit(void);
+
+/**
+ * @brief Queues a call of any function using the dwm_* API.
+ *
+ * @param[in] fn, function run by the I/O thread, its return value is the
+ *            return value of the request
+ * @param[in] arg, argument of fn
+ * @param[in] cb, completion callback, NULL to complete with dwm_async_wait()
+ * @param[in] user, user pointer given to cb
+ *
+ * @return the request handle, NULL if the queue is full or the I/O thread
+ *         is not running
+ */
+dwm_async_req_t *dwm_async_call(int (*fn)(void *arg), void *arg, dwm_async_cb_t cb, void *user);
+
+/**
+ * @brief Waits for a request submitted without callback, then releases it.
+ *
+ * @param[in] req, request handle
+ * @param[in] timeout_ms, longest wait in ms, -1 to wait until completion
+ * @param[out] rv, return value of the request, may be NULL
+ *
+ * @return Error code, RV_ERR on timeout: the request is then still pending
+ *         and can be waited for again
+ */
+int dwm_async_wait(dwm_async_req_t *req, int timeout_ms, int *rv);
+
+/**
+ * @brief Asynchronous dwm_loc_get(), see dwm_async_call() for cb and user
+ *
+ * @param[out] loc Pointer to location data
+ *
+ * @return the request handle, NULL if the request could not be queued
+ */
+dwm_async_req_t *dwm_loc_get_async(dwm_loc_data_t* loc, dwm_async_cb_t cb, void *user);
+
+/**
+ * @brief Asynchronous dwm_status_get(), see dwm_async_call() for cb and user
+ *
+ * @param[out] p_status Pointer to the status
+ *
+ * @return the request handle, NULL if the request could not be queued
+ */
+dwm_async_req_t *dwm_status_get_async(dwm_status_t* p_status, dwm_async_cb_t cb, void *user);
+
+/**
+ * @brief Asynchronous dwm_usr_data_read(), see dwm_async_call() for cb and user
+ *
+ * @param[out] p_data Pointer to a receive buffer
+ * @param[in, out] p_len Pointer to number of bytes to be received
+ *
+ * @return the request handle, NULL if the request could not be queued
+ */
+dwm_async_req_t *dwm_usr_data_read_async(uint8_t* p_data, uint8_t* p_len, dwm_async_cb_t cb, void *user);
+
+/**
+ * @brief Asynchronous dwm_usr_data_write(), see dwm_async_call() for cb and
+ *        user. The data is copied at submission.
+ *
+ * @param[in] p_data Pointer to the user data
+ * @param[in] len Number of bytes to be written
+ * @param[in] overwrite If true, might overwrite recent data
+ *
+ * @return the request handle, NULL if the request could not be queued
+ */
+dwm_async_req_t *dwm_usr_data_write_async(uint8_t* p_data, uint8_t len, bool overwrite, dwm_async_cb_t cb, void *user);
+
+/**
+ * @brief Asynchronous dwm_gpio_value_set(), see dwm_async_call() for cb and user
+ *
+ * @param[in] idx, Pin index (see dwm_gpio_idx_t)
+ * @param[in] value, Pin value (0, 1)
+ *
+ * @return the request handle, NULL if the request could not be queued
+ */
+dwm_async_req_t *dwm_gpio_value_set_async(dwm_gpio_idx_t idx, bool value, dwm_async_cb_t cb, void *user);
+
+/**
+ * @brief Asynchronous dwm_gpio_value_get(), see dwm_async_call() for cb and user
+ *
+ * @param[in] idx, Pin index (see dwm_gpio_idx_t)
+ * @param[out] value, Pointer to the pin value
+ *
+ * @return the request handle, NULL if the request could not be queued
+ */
+dwm_async_req_t *dwm_gpio_value_get_async(dwm_gpio_idx_t idx, bool* value, dwm_async_cb_t cb, void *user);
+
+#endif //_DWM_API_ASYNC_H_
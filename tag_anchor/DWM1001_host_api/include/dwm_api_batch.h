@@ -0,0 +1,114 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_api_batch.h
+ * @brief   DWM1001 host API, batched requests header
+ *
+ *          A batch concatenates several TLV requests into one transfer and
+ *          splits the response at each RET_VAL, so a polling cycle such as
+ *          loc_get + status_get + usr_data_read is one round trip.
+ *
+ *          The requests of a batch whose response is missing or broken are
+ *          sent again one by one by dwm_batch_run(), so a batch also works
+ *          with a firmware answering only the first request of a transfer.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DWM_API_BATCH_H_
+#define _DWM_API_BATCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "dwm1001_tlv.h"
+#include "dwm_api.h"
+
+#define DWM_BATCH_CNT_MAX        8     /* requests in a batch */
+
+/**
+ * @brief decoder of the response of a request, see dwm_tlv.h
+ */
+typedef int (*dwm_batch_decode_t)(const uint8_t* rsp, uint16_t len, void* out0, void* out1);
+
+/**
+ * @brief request of a batch
+ */
+typedef struct {
+   dwm_batch_decode_t decode;
+   void* out[2];
+   uint8_t tx_offset;            /* request position in tx_data */
+   uint8_t tx_len;
+   uint16_t exp_len;             /* response length, DWM1001_TLV_MAX_SIZE if variable */
+   int rv;
+} dwm_batch_entry_t;
+
+/**
+ * @brief batch of requests, filled with the dwm_batch_*_get() functions
+ */
+typedef struct {
+   uint8_t tx_data[DWM1001_TLV_MAX_SIZE];
+   uint8_t tx_len;
+   uint8_t cnt;
+   dwm_batch_entry_t entry[DWM_BATCH_CNT_MAX];
+} dwm_batch_t;
+
+/**
+ * @brief Empties a batch
+ *
+ * @param[out] batch
+ *
+ * @return none
+ */
+void dwm_batch_init(dwm_batch_t* batch);
+
+/**
+ * @brief Adds a request to a batch, the outputs are written by dwm_batch_run()
+ *        and must stay valid until it returns.
+ *
+ * @param[in, out] batch
+ * @param[out] outputs of the request, as for the dwm_* function
+ *
+ * @return Error code, RV_ERR if the batch is full
+ */
+int dwm_batch_pos_get(dwm_batch_t* batch, dwm_pos_t* p_pos);
+int dwm_batch_loc_get(dwm_batch_t* batch, dwm_loc_data_t* loc);
+int dwm_batch_node_id_get(dwm_batch_t* batch, uint64_t* p_node_id);
+int dwm_batch_status_get(dwm_batch_t* batch, dwm_status_t* p_status);
+int dwm_batch_usr_data_read(dwm_batch_t* batch, uint8_t* p_data, uint8_t* p_len);
+
+/**
+ * @brief Adds a dwm_usr_data_write() to a batch, the data is copied. A write
+ *        whose response is lost is sent again by dwm_batch_run().
+ *
+ * @param[in, out] batch
+ * @param[in] p_data, len, overwrite, as for dwm_usr_data_write()
+ *
+ * @return Error code, RV_ERR if the batch is full or len is over 
+ *         DWM_API_USR_DATA_LEN_MAX
+ */
+int dwm_batch_usr_data_write(dwm_batch_t* batch, const uint8_t* p_data, uint8_t len, bool overwrite);
+
+/**
+ * @brief Sends the requests of a batch in one transfer and decodes the
+ *        responses. The batch can be run again as is.
+ *
+ * @param[in, out] batch
+ *
+ * @return Error code, RV_OK if all the requests succeeded, see dwm_batch_rv()
+ */
+int dwm_batch_run(dwm_batch_t* batch);
+
+/**
+ * @brief Gets the result of a request of the last dwm_batch_run()
+ *
+ * @param[in] batch
+ * @param[in] idx, index of the request, in the order it was added
+ *
+ * @return Error code of the request
+ */
+int dwm_batch_rv(const dwm_batch_t* batch, uint8_t idx);
+
+#endif //_DWM_API_BATCH_H_
@@ -0,0 +1,106 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_api_cache.h
+ * @brief   DWM1001 host API, cache of the slowly changing module values
+ *
+ *          The anchor list, configuration, node ID and firmware versions
+ *          are read once and then served from memory, per device, until
+ *          their time to live expires or an event invalidates them:
+ *
+ *          - dwm_status_get() and dwm_batch_status_get(): a change of
+ *            uwbmac_joined invalidates the anchor list and the configuration,
+ *            bh_data_ready and bh_status_changed the anchor list,
+ *            fwup_in_progress everything
+ *          - the dwm_* setters of the values, dwm_reset() and
+ *            dwm_factory_reset()
+ *          - dwm_cache_invalidate()
+ *
+ *          A value read while an invalidation happens is returned but not
+ *          cached.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DWM_API_CACHE_H_
+#define _DWM_API_CACHE_H_
+
+#include <stdint.h>
+#include "dwm_api.h"
+
+#define DWM_CACHE_DEV_NUM        2     /* devices, see dwm_dev_sel() */
+
+/* cached values */
+enum {
+   DWM_CACHE_ANCHOR_LIST = 0,
+   DWM_CACHE_CFG,
+   DWM_CACHE_NODE_ID,
+   DWM_CACHE_VER,
+   DWM_CACHE_NUM
+};
+
+#define DWM_CACHE_MASK(item)     (1u << (item))
+#define DWM_CACHE_ALL            (DWM_CACHE_MASK(DWM_CACHE_NUM) - 1)
+
+/* default time to live, ms, 0 for no expiry */
+#define DWM_CACHE_TTL_ANCHOR_LIST   1000
+#define DWM_CACHE_TTL_CFG           10000
+#define DWM_CACHE_TTL_NODE_ID       0
+#define DWM_CACHE_TTL_VER           0
+
+/**
+ * @brief Cached dwm_anchor_list_get(), dwm_cfg_get(), dwm_node_id_get() and
+ *        dwm_ver_get(), of the device of the calling thread
+ *
+ * @param[out] as for the dwm_* function
+ *
+ * @return Error code, of the dwm_* function when the value is read
+ */
+int dwm_cache_anchor_list_get(dwm_anchor_list_t* p_list);
+int dwm_cache_cfg_get(dwm_cfg_t* cfg);
+int dwm_cache_node_id_get(uint64_t* p_node_id);
+int dwm_cache_ver_get(dwm_ver_t* ver);
+
+/**
+ * @brief Sets the time to live of a value, on all devices
+ *
+ * @param[in] item, DWM_CACHE_ANCHOR_LIST, ...
+ * @param[in] ttl_ms, 0 for no expiry, -1 to read the value each time
+ *
+ * @return Error code
+ */
+int dwm_cache_ttl_set(int item, int ttl_ms);
+
+/**
+ * @brief Drops values of the device of the calling thread
+ *
+ * @param[in] mask, DWM_CACHE_MASK() of the values, DWM_CACHE_ALL
+ *
+ * @return none
+ */
+void dwm_cache_invalidate(uint32_t mask);
+
+/**
+ * @brief Applies the invalidations of a status read on the device of the
+ *        calling thread, called by dwm_status_get() and the batches
+ *
+ * @param[in] p_status
+ *
+ * @return none
+ */
+void dwm_cache_status_update(const dwm_status_t* p_status);
+
+/**
+ * @brief Gets the calls served from memory and the calls read from the
+ *        module, since the start
+ *
+ * @param[out] hit, miss, may be NULL
+ *
+ * @return none
+ */
+void dwm_cache_stats_get(uint32_t* hit, uint32_t* miss);
+
+#endif //_DWM_API_CACHE_H_
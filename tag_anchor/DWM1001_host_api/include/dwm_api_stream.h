@@ -0,0 +1,83 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_api_stream.h
+ * @brief   DWM1001 host API, location streaming header
+ *
+ *          The stream enables the location ready interrupt of the module and
+ *          reads the location only when the interrupt pin rises, with one
+ *          batched status + location request. The new locations are pushed
+ *          into a bounded ring, timestamped at the interrupt, and the oldest
+ *          is overwritten when the ring is full.
+ *
+ *          Like the async I/O thread, the stream thread owns the interface
+ *          of its module while it runs: the other dwm_* calls on the same
+ *          module must wait for dwm_stream_deinit().
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DWM_API_STREAM_H_
+#define _DWM_API_STREAM_H_
+
+#include <stdint.h>
+#include "dwm_api.h"
+
+#define DWM_STREAM_RING_LEN      32    /* locations kept for the consumers */
+#define DWM_STREAM_POLL_MS       1000  /* status check without interrupt, in case an edge is missed */
+
+/**
+ * @brief location record of the stream
+ */
+typedef struct {
+   uint64_t ts;            /* HAL_GetTime64() time of the interrupt, in us */
+   uint32_t seq;           /* record number, a gap counts the records overwritten */
+   dwm_pos_t pos;
+   dwm_loc_data_t loc;     /* loc.p_pos points to pos */
+} dwm_stream_rec_t;
+
+/**
+ * @brief Enables the location ready interrupt and starts the stream thread,
+ *        after dwm_init(). The stream drives the module selected by the
+ *        calling thread, see dwm_dev_sel().
+ *
+ * @param[in] none
+ *
+ * @return Error code
+ */
+int dwm_stream_init(void);
+
+/**
+ * @brief Stops the stream thread and restores the interrupt configuration.
+ *        The records still in the ring are discarded.
+ *
+ * @param[in] none
+ *
+ * @return none
+ */
+void dwm_stream_deinit(void);
+
+/**
+ * @brief Takes the oldest location of the ring, waiting for one if empty.
+ *
+ * @param[out] rec, location record, rec->loc.p_pos is set to &rec->pos
+ * @param[in] timeout_ms, longest wait in ms, 0 to return at once, -1 to wait
+ *            until a location is streamed
+ *
+ * @return Error code, RV_ERR on timeout or if the stream is not running
+ */
+int dwm_stream_read(dwm_stream_rec_t* rec, int timeout_ms);
+
+/**
+ * @brief Gets the number of locations overwritten before being read
+ *
+ * @param[in] none
+ *
+ * @return number of locations dropped since dwm_stream_init()
+ */
+uint32_t dwm_stream_dropped(void);
+
+#endif //_DWM_API_STREAM_H_
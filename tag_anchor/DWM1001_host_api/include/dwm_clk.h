@@ -0,0 +1,147 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_clk.h
+ * @brief   DWM1001 host API, anchor clock synchronisation for TDoA header
+ *
+ *          The RX timestamps of the anchors are mapped onto the clock of a
+ *          master anchor with the blinks of a reference tag at a known
+ *          position: for a blink k received at t_a by anchor a and at t_m by
+ *          the master, the master time of its arrival at a is
+ *          t_m - d_m/c + d_a/c, d being the distances to the reference tag.
+ *          The difference to t_a is tracked per anchor by a Kalman filter of
+ *          its offset and drift, updated in O(1) per blink. With no process
+ *          noise the filter is the linear regression of the offsets.
+ *
+ *          The timestamps are the 40 bit DW1000 counters, in DWM_CLK_TICK_HZ
+ *          ticks, unwrapped per anchor to 64 bits.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DWM_CLK_H_
+#define _DWM_CLK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "dwm_api.h"
+
+#define DWM_CLK_TICK_HZ          63897600000.0  /* 499.2 MHz * 128 */
+#define DWM_CLK_TS_BITS          40
+#define DWM_CLK_SPEED_OF_LIGHT   299702547.0    /* m/s in air */
+#define DWM_CLK_ANCHOR_CNT_MAX   16
+#define DWM_CLK_SEQ_WIN          8        /* blinks kept per anchor to pair the timestamps */
+#define DWM_CLK_SYNC_MIN         3        /* blinks before an anchor is synchronised */
+#define DWM_CLK_STALE_S          2.0      /* anchor not synchronised without a blink for this long */
+
+#define DWM_CLK_Q_OFFSET         1e2      /* offset process noise, ticks^2 per s */
+#define DWM_CLK_Q_DRIFT          1e-16    /* drift process noise, per s */
+#define DWM_CLK_R                1e2      /* timestamp noise, ticks^2, about 10 ticks = 15 cm rms */
+#define DWM_CLK_GATE             5.0      /* blinks further than this many sigma are rejected, 0 for none */
+
+/**
+ * @brief clock model of an anchor
+ */
+typedef struct {
+   bool used;
+   dwm_pos_t pos;
+   double dist_ticks;      /* propagation time from the reference tag */
+   /* unwrapping of the 40 bit counter */
+   bool ts_seen;
+   uint64_t ts_last;
+   /* timestamps of the last reference blinks, to pair with the master */
+   uint32_t ref_seq[DWM_CLK_SEQ_WIN];
+   uint64_t ref_ts[DWM_CLK_SEQ_WIN];
+   uint8_t ref_cnt;
+   uint8_t ref_next;
+   /* model: master = ts + off0 + off + drift*(ts - ts_upd) */
+   int64_t off0;           /* integer part, set at the first blink */
+   double off;             /* ticks */
+   double drift;           /* ticks per tick */
+   double p[2][2];         /* covariance of off, drift */
+   uint64_t ts_upd;        /* anchor time of the last update */
+   uint32_t upd_cnt;
+   uint32_t rej_cnt;       /* blinks rejected by the gate */
+} dwm_clk_anchor_t;
+
+/**
+ * @brief clock synchronisation of a set of anchors
+ */
+typedef struct {
+   dwm_clk_anchor_t an[DWM_CLK_ANCHOR_CNT_MAX];
+   int master;
+   dwm_pos_t ref_pos;
+   double q_off, q_drift, r, gate;
+} dwm_clk_t;
+
+/**
+ * @brief Initializes the synchronisation with the default noises
+ *
+ * @param[out] clk
+ * @param[in] ref_pos, position of the reference tag, mm
+ *
+ * @return none
+ */
+void dwm_clk_init(dwm_clk_t* clk, const dwm_pos_t* ref_pos);
+
+/**
+ * @brief Sets the noises of the filters, see DWM_CLK_Q_OFFSET to DWM_CLK_GATE
+ *
+ * @return none
+ */
+void dwm_clk_noise_set(dwm_clk_t* clk, double q_off, double q_drift, double r, double gate);
+
+/**
+ * @brief Adds an anchor, the first one added is the master
+ *
+ * @param[in, out] clk
+ * @param[in] idx, anchor index, below DWM_CLK_ANCHOR_CNT_MAX
+ * @param[in] pos, anchor position, mm
+ *
+ * @return Error code
+ */
+int dwm_clk_anchor_set(dwm_clk_t* clk, int idx, const dwm_pos_t* pos);
+
+/**
+ * @brief Feeds the RX timestamp of a reference tag blink, the model of the
+ *        anchor, or of the anchors waiting for this master blink, is updated
+ *        once the master and the anchor timestamps of the blink are known.
+ *
+ * @param[in, out] clk
+ * @param[in] idx, anchor index
+ * @param[in] seq, blink sequence number of the reference tag
+ * @param[in] ts, 40 bit RX timestamp
+ *
+ * @return Error code
+ */
+int dwm_clk_ref_rx(dwm_clk_t* clk, int idx, uint32_t seq, uint64_t ts);
+
+/**
+ * @brief Maps an RX timestamp of an anchor onto the master clock
+ *
+ * @param[in, out] clk
+ * @param[in] idx, anchor index
+ * @param[in] ts, 40 bit RX timestamp
+ * @param[out] master_ts, master time in ticks, unwrapped
+ *
+ * @return Error code, RV_ERR if the anchor is not synchronised, master_ts
+ *         is then the prediction of the last model
+ */
+int dwm_clk_correct(dwm_clk_t* clk, int idx, uint64_t ts, uint64_t* master_ts);
+
+/**
+ * @brief Gets the model of an anchor
+ *
+ * @param[in] clk
+ * @param[in] idx, anchor index
+ * @param[out] drift_ppb, drift to the master, ppb
+ * @param[out] sigma_ticks, standard deviation of the offset, ticks
+ *
+ * @return Error code, RV_ERR if the anchor is not synchronised
+ */
+int dwm_clk_get(const dwm_clk_t* clk, int idx, double* drift_ppb, double* sigma_ticks);
+
+#endif //_DWM_CLK_H_
@@ -0,0 +1,158 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_frag.h
+ * @brief   DWM1001 host API, message stream over the user data of the
+ *          backhaul header
+ *
+ *          Messages up to DWM_FRAG_MSG_MAX bytes are cut into fragments of
+ *          one dwm_usr_data_write() each, sent in a sliding window of
+ *          sequence numbers and put together again by the peer, which runs
+ *          the same layer. A fragment is 34 bytes at most:
+ *
+ *             flags (1) | seq (1) | ack (1) | payload (0 to 31)
+ *
+ *          flags: DWM_FRAG_F_DATA if seq and the payload are set,
+ *          DWM_FRAG_F_ACK if ack, the next seq expected from the peer, is
+ *          set, DWM_FRAG_F_FIRST, DWM_FRAG_F_LAST for the fragments which
+ *          start and end a message. The acknowledgements ride on the data
+ *          fragments and are sent alone when none is due.
+ *
+ *          The peer takes the fragments in order only, the oldest fragment
+ *          not acknowledged within rto_ms is sent again with all those after
+ *          it (go-back-N).
+ *
+ *          Each dwm_frag_poll() reads one fragment and writes one, in one
+ *          transfer when batched. The module holds one fragment until the
+ *          backhaul sends it: a write refused as busy is tried again at the
+ *          next poll. The layer is not thread safe, it is polled by the
+ *          thread driving the module.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DWM_FRAG_H_
+#define _DWM_FRAG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "dwm_api.h"
+
+#define DWM_FRAG_HDR_LEN         3
+#define DWM_FRAG_PAYLOAD_MAX     (DWM_API_USR_DATA_LEN_MAX - DWM_FRAG_HDR_LEN)
+#define DWM_FRAG_SLOT_NUM        64    /* fragments queued for TX, divides 256 */
+#define DWM_FRAG_WINDOW_MAX      32    /* fragments sent and not acknowledged */
+#define DWM_FRAG_MSG_MAX         1024  /* bytes of a message */
+
+#define DWM_FRAG_F_DATA          0x80
+#define DWM_FRAG_F_ACK           0x40
+#define DWM_FRAG_F_FIRST         0x02
+#define DWM_FRAG_F_LAST          0x01
+
+/**
+ * @brief message callback, called from dwm_frag_poll()
+ *
+ * @param[in] arg, dwm_frag_init() argument
+ * @param[in] msg, len, message, valid during the call
+ */
+typedef void (*dwm_frag_cb_t)(void* arg, const uint8_t* msg, uint16_t len);
+
+typedef struct {
+   uint8_t window;               /* fragments in flight, 1 to DWM_FRAG_WINDOW_MAX, 1 is stop and wait */
+   uint16_t rto_ms;              /* retransmission timeout */
+   uint8_t ack_every;            /* fragments received before an acknowledgement is sent alone */
+   uint16_t ack_delay_ms;        /* or after this delay without a data fragment to ride on */
+   bool batch;                   /* read and write of a poll in one transfer, see dwm_api_batch.h */
+} dwm_frag_cfg_t;
+
+typedef struct {
+   uint32_t tx_frag;             /* data fragments written, with the retransmissions */
+   uint32_t tx_retry;            /* data fragments written again */
+   uint32_t tx_ack;              /* acknowledgements written alone */
+   uint32_t tx_busy;             /* writes refused by the module */
+   uint32_t tx_msg;              /* messages acknowledged */
+   uint32_t rx_frag;             /* data fragments taken */
+   uint32_t rx_drop;             /* duplicated, out of order or broken fragments */
+   uint32_t rx_msg;              /* messages delivered */
+   uint32_t rx_msg_drop;         /* messages over DWM_FRAG_MSG_MAX or missing their start */
+} dwm_frag_stats_t;
+
+/**
+ * @brief stream state, the fields other than stats are internal
+ */
+typedef struct {
+   dwm_frag_cfg_t cfg;
+   dwm_frag_cb_t cb;
+   void* arg;
+   /* TX: base <= next <= tail, sequence numbers modulo 256 */
+   uint8_t slot[DWM_FRAG_SLOT_NUM][DWM_API_USR_DATA_LEN_MAX];
+   uint8_t slot_len[DWM_FRAG_SLOT_NUM];
+   uint8_t base;                 /* oldest fragment not acknowledged */
+   uint8_t next;                 /* next fragment to write */
+   uint8_t sent;                 /* first fragment never written */
+   uint8_t tail;                 /* next fragment to queue */
+   uint64_t rto_deadline;        /* HAL_GetTime64(), 0 if nothing in flight */
+   /* RX */
+   uint8_t rx_next;              /* next seq expected */
+   uint8_t rx_unacked;           /* fragments taken since the last acknowledgement */
+   uint64_t ack_deadline;        /* HAL_GetTime64(), 0 if no acknowledgement is due */
+   uint8_t msg[DWM_FRAG_MSG_MAX];
+   uint16_t msg_len;
+   bool msg_open;                /* a message is being put together */
+   dwm_frag_stats_t stats;
+} dwm_frag_t;
+
+/**
+ * @brief Gets the default configuration: window of 8, rto of 500 ms,
+ *        acknowledgement every 4 fragments or 100 ms, batched
+ *
+ * @param[out] cfg
+ *
+ * @return none
+ */
+void dwm_frag_cfg_default(dwm_frag_cfg_t* cfg);
+
+/**
+ * @brief Resets a stream, both peers start at sequence number 0
+ *
+ * @param[out] f
+ * @param[in] cfg, NULL for the default
+ * @param[in] cb, arg, message callback
+ *
+ * @return Error code, RV_ERR if cfg is out of range
+ */
+int dwm_frag_init(dwm_frag_t* f, const dwm_frag_cfg_t* cfg, dwm_frag_cb_t cb, void* arg);
+
+/**
+ * @brief Queues a message, the data is copied
+ *
+ * @param[in, out] f
+ * @param[in] msg, len, up to DWM_FRAG_MSG_MAX bytes
+ *
+ * @return Error code, RV_ERR_BUSY if the fragments do not fit in the queue
+ *         yet, RV_ERR_PARAM if len is over DWM_FRAG_MSG_MAX
+ */
+int dwm_frag_send(dwm_frag_t* f, const uint8_t* msg, uint16_t len);
+
+/**
+ * @brief Reads a fragment from the module, then writes the next fragment
+ *        or acknowledgement due, on the device of the calling thread
+ *
+ * @param[in, out] f
+ *
+ * @return Error code, RV_ERR if the module did not answer
+ */
+int dwm_frag_poll(dwm_frag_t* f);
+
+/**
+ * @brief Gets the fragments queued or in flight
+ *
+ * @return fragments not acknowledged yet, 0 once all the messages are
+ *         delivered
+ */
+int dwm_frag_pending(const dwm_frag_t* f);
+
+#endif //_DWM_FRAG_H_
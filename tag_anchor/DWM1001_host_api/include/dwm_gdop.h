@@ -0,0 +1,117 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_gdop.h
+ * @brief   DWM1001 host API, GDOP grid of the TDoA anchor subsets header
+ *
+ *          With many anchors the solve costs O(anchors), and the far anchors
+ *          with a poor geometry add more noise than they remove. The area of
+ *          the tags is cut into square cells, and for each cell the anchor
+ *          subsets of sub_cnt anchors are ranked at init by the geometric
+ *          dilution of precision at the cell centre, for independent noises
+ *          of the RX timestamps:
+ *             GDOP = sqrt(trace((U' (I - 11'/n) U)^-1))
+ *          U being the n unit vectors from the anchors of the subset to the
+ *          tag, it does not depend on the reference anchor. The solver looks
+ *          the subset up from the last fix of the tag in O(1).
+ *
+ *          With dim 3 anchors the cells are at the height lo[2] of the tags.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DWM_GDOP_H_
+#define _DWM_GDOP_H_
+
+#include <stdint.h>
+#include "dwm_api.h"
+#include "dwm_tdoa.h"
+
+#define DWM_GDOP_RANK            4        /* subsets kept per cell, the next ones when an anchor missed the blink */
+
+/**
+ * @brief ranked subsets of a cell, mask bit i is anchor i, 0 past the last
+ */
+typedef struct {
+   uint16_t mask[DWM_GDOP_RANK];
+   float gdop[DWM_GDOP_RANK];
+} dwm_gdop_cell_t;
+
+/**
+ * @brief grid, cells[row*cols + col], row along y
+ */
+typedef struct {
+   double x0, y0, cell;       /* m */
+   int cols, rows;
+   int sub_cnt;
+   dwm_gdop_cell_t *cells;
+} dwm_gdop_t;
+
+/**
+ * @brief Computes the grid
+ *
+ * @param[out] g
+ * @param[in] an, anchors
+ * @param[in] sub_cnt, anchors per subset, dim + 1 to an->cnt
+ * @param[in] lo, hi, corners of the area of the tags, dim coordinates, m
+ * @param[in] cell, cell side, m
+ *
+ * @return Error code
+ */
+int dwm_gdop_init(dwm_gdop_t* g, const dwm_tdoa_t* an, int sub_cnt, const double* lo, const double* hi, double cell);
+
+/**
+ * @brief Frees the cells
+ *
+ * @return none
+ */
+void dwm_gdop_free(dwm_gdop_t* g);
+
+/**
+ * @brief Computes the GDOP of an anchor subset
+ *
+ * @param[in] an, anchors
+ * @param[in] mask, subset, bit i is anchor i
+ * @param[in] p, dim coordinates, m
+ *
+ * @return GDOP, INFINITY if the subset does not give a fix at p
+ */
+double dwm_gdop_eval(const dwm_tdoa_t* an, uint32_t mask, const double* p);
+
+/**
+ * @brief Gets the cell of a position, positions out of the grid get the
+ *        nearest cell
+ *
+ * @return cell
+ */
+const dwm_gdop_cell_t* dwm_gdop_cell(const dwm_gdop_t* g, const double* p);
+
+/**
+ * @brief Selects the best subset of the cell of p among the anchors which
+ *        received the blink
+ *
+ * @param[in] g
+ * @param[in] p, last fix of the tag, dim coordinates, m
+ * @param[in] avail, anchors which received the blink
+ *
+ * @return subset, avail if no ranked subset of the cell is in avail
+ */
+uint32_t dwm_gdop_select(const dwm_gdop_t* g, const double* p, uint32_t avail);
+
+/**
+ * @brief Solves a fix on a subset of the anchors, see dwm_tdoa_solve()
+ *
+ * @param[in] an, anchors
+ * @param[in] mask, subset, at least dim + 1 anchors
+ * @param[in] rd, an->cnt range differences r_i - r_0, m, only those of the
+ *            subset are used, rd[0] is not used
+ * @param[in] guess, p, rms, see dwm_tdoa_solve()
+ *
+ * @return Error code
+ */
+int dwm_gdop_solve(const dwm_tdoa_t* an, uint32_t mask, const double* rd, const double* guess, double* p, double* rms);
+
+#endif //_DWM_GDOP_H_
@@ -0,0 +1,193 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_ingest.h
+ * @brief   DWM1001 host API, TDoA blink ingestion header
+ *
+ *          The blink_rec_t records that the tdoa_anchor firmware streams in
+ *          its cmd_bin.h frames are grouped per tag epoch before the solve:
+ *          the timestamps of the anchors for one blink share the EUI-64 of
+ *          the tag and the 8 bit sequence number of the blink.
+ *
+ *          The sequence number wraps every 256 blinks. It is extended to
+ *          32 bits per tag, to the nearest of the last extended number, so
+ *          the anchors may deliver a blink up to 127 blinks apart. A tag
+ *          silent for DWM_INGEST_RESYNC_S is taken forward whatever its
+ *          number, the blinks skipped are counted lost.
+ *
+ *          A tag keeps a sliding window of DWM_INGEST_WIN epochs. An epoch
+ *          is emitted as soon as quorum anchors reported it, or at its
+ *          deadline, deadline_s after its first timestamp, if min_cnt
+ *          anchors did. The epochs of a tag are emitted in order: an epoch
+ *          emitted, or pushed out of the window, first resolves the older
+ *          ones. A timestamp of an anchor already in its epoch is a
+ *          duplicate, one for an epoch already emitted is late, both are
+ *          dropped and counted.
+ *
+ *          The time is given by the caller, in seconds of any monotonic
+ *          clock, a replay uses its own. The module is not thread safe, it
+ *          is fed by the thread reading the anchors.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DWM_INGEST_H_
+#define _DWM_INGEST_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "dwm_api.h"
+#include "dwm_trace.h"
+
+#define DWM_INGEST_ANCHOR_MAX    16
+#define DWM_INGEST_TAG_MAX       1024
+#define DWM_INGEST_WIN           8        /* epochs open per tag, power of 2 */
+#define DWM_INGEST_DEADLINE_S    0.05     /* default, above the 10 ms batching of the anchors */
+#define DWM_INGEST_RESYNC_S      2.0      /* tag silent for this long: its next blink is taken forward */
+#define DWM_INGEST_FRAME_MAX     512      /* cmd_bin.h frame, dwm_ingest_rx() */
+
+#define DWM_INGEST_SOF           0xA5
+#define DWM_INGEST_TLV_BLINKS    0x10     /* CMD_BIN_BLINKS, blink_rec_t records */
+#define DWM_INGEST_TLV_DROPS     0x11     /* CMD_BIN_DROPS, ring drops of the anchor */
+#define DWM_INGEST_REC_LEN       18       /* ts (5), EUI-64 (8), seq (1), fp index (2), fp amplitude (2) */
+
+/**
+ * @brief epoch of a tag, the timestamps of the anchors of mask
+ */
+typedef struct {
+   uint64_t tag_id;
+   uint32_t seq;              /* extended sequence number, the low 8 bits are those of the blink */
+   uint32_t mask;             /* anchors which reported the blink */
+   uint8_t cnt;               /* anchors in mask */
+   uint16_t lost;             /* blinks of the tag not emitted since its last epoch */
+   double first_s;            /* time of the first timestamp */
+   double emit_s;             /* time of the emission */
+   uint64_t ts[DWM_INGEST_ANCHOR_MAX];
+} dwm_ingest_epoch_t;
+
+/**
+ * @brief counters since dwm_ingest_init()
+ */
+typedef struct {
+   uint32_t recs;             /* timestamps given */
+   uint32_t epochs;           /* epochs emitted */
+   uint32_t quorum;           /* of which as soon as quorum anchors reported */
+   uint32_t deadline;         /* of which at their deadline, or pushed by a newer epoch */
+   uint32_t short_cnt;        /* epochs dropped with fewer than min_cnt anchors */
+   uint32_t gap;              /* blinks no anchor reported, from the sequence numbers */
+   uint32_t dup;              /* timestamps of an anchor already in the epoch */
+   uint32_t late;             /* timestamps of an epoch already emitted */
+   uint32_t resync;           /* tags taken forward after a silence */
+   uint32_t tag_full;         /* timestamps dropped, the tag table is full */
+   uint32_t crc_err;          /* frames of dwm_ingest_rx() with a bad CRC or TLV */
+   uint32_t ring_drops[DWM_INGEST_ANCHOR_MAX];  /* last CMD_BIN_DROPS of each anchor */
+   double latency_max_s;      /* of the emitted epochs, emit_s - first_s */
+   double latency_sum_s;
+} dwm_ingest_stats_t;
+
+typedef struct dwm_ingest dwm_ingest_t;
+
+/**
+ * @brief epoch callback, called from dwm_ingest_blink(), dwm_ingest_rx(),
+ *        dwm_ingest_poll() and dwm_ingest_flush(), in order for each tag
+ *
+ * @param[in] arg, dwm_ingest_init() argument
+ * @param[in] e, epoch, valid during the call
+ */
+typedef void (*dwm_ingest_cb_t)(void* arg, const dwm_ingest_epoch_t* e);
+
+/**
+ * @brief Starts the ingestion
+ *
+ * @param[out] ing
+ * @param[in] anchor_cnt, anchors, up to DWM_INGEST_ANCHOR_MAX
+ * @param[in] quorum, anchors to emit an epoch before its deadline, 0 for all
+ * @param[in] min_cnt, anchors to emit an epoch at its deadline, fewer are dropped
+ * @param[in] deadline_s, s, 0 for DWM_INGEST_DEADLINE_S
+ * @param[in] cb, arg, epoch callback
+ *
+ * @return Error code
+ */
+int dwm_ingest_init(dwm_ingest_t** ing, int anchor_cnt, int quorum, int min_cnt, double deadline_s,
+      dwm_ingest_cb_t cb, void* arg);
+
+/**
+ * @brief Frees the ingestion, the open epochs are dropped
+ *
+ * @return none
+ */
+void dwm_ingest_deinit(dwm_ingest_t* ing);
+
+/**
+ * @brief Adds the RX timestamp of a blink, after the epochs past their
+ *        deadline are emitted
+ *
+ * @param[in, out] ing
+ * @param[in] tag_id, EUI-64
+ * @param[in] seq, 8 bit sequence number of the blink
+ * @param[in] anchor, anchor index
+ * @param[in] ts, timestamp, passed through to the epoch
+ * @param[in] now_s, time, s
+ *
+ * @return Error code, RV_ERR if the timestamp is a duplicate, late, or the
+ *         tag table is full
+ */
+int dwm_ingest_blink(dwm_ingest_t* ing, uint64_t tag_id, uint8_t seq, int anchor, uint64_t ts, double now_s);
+
+/**
+ * @brief Adds the bytes read from an anchor, as many or as few as there
+ *        are: the cmd_bin.h frames are reassembled per anchor, checked, and
+ *        their blink_rec_t records given to dwm_ingest_blink() with the 40
+ *        bit RX timestamp. A bad frame is skipped up to the next SOF.
+ *
+ * @param[in, out] ing
+ * @param[in] anchor, anchor index
+ * @param[in] data, len, bytes of the serial port or of a datagram
+ * @param[in] now_s, time, s
+ *
+ * @return Error code, RV_ERR if the anchor index is not valid
+ */
+int dwm_ingest_rx(dwm_ingest_t* ing, int anchor, const uint8_t* data, int len, double now_s);
+
+/**
+ * @brief Emits the epochs past their deadline, to be called at least every
+ *        deadline when the anchors are quiet
+ *
+ * @return none
+ */
+void dwm_ingest_poll(dwm_ingest_t* ing, double now_s);
+
+/**
+ * @brief Resolves all the open epochs, emitted if min_cnt anchors reported
+ *        them
+ *
+ * @return none
+ */
+void dwm_ingest_flush(dwm_ingest_t* ing, double now_s);
+
+/**
+ * @brief Stamps the RX and READ stages of the records of dwm_ingest_rx(),
+ *        and the GROUP stage of the epochs, trace seq is the 8 bit blink
+ *        number
+ *
+ * @param[in, out] ing
+ * @param[in] tr, tracing, NULL for none
+ *
+ * @return none
+ */
+void dwm_ingest_trace_set(dwm_ingest_t* ing, dwm_trace_t* tr);
+
+/**
+ * @brief Gets the counters
+ *
+ * @param[in] ing
+ * @param[out] stats
+ *
+ * @return none
+ */
+void dwm_ingest_stats(const dwm_ingest_t* ing, dwm_ingest_stats_t* stats);
+
+#endif //_DWM_INGEST_H_
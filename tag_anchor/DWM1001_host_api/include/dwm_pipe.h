@@ -0,0 +1,141 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_pipe.h
+ * @brief   DWM1001 host API, parallel TDoA solve pipeline header
+ *
+ *          The blink timestamps of the anchors, on the master clock of
+ *          dwm_clk.h, are grouped per tag epoch (blink sequence number) and
+ *          the epochs are solved by a pool of worker threads with
+ *          dwm_tdoa_solve_warm(), each from the last fix of its tag.
+ *
+ *          A tag is scheduled on one worker at a time, so its epochs are
+ *          solved and reported in order. The tags ready to run are queued on
+ *          per worker deques: a worker takes the newest tag of its own deque
+ *          and an idle worker steals the oldest tag of another deque, so a
+ *          slow solve only delays its own tag. A worker solves one epoch per
+ *          turn and queues its tag again behind the others.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DWM_PIPE_H_
+#define _DWM_PIPE_H_
+
+#include <stdint.h>
+#include "dwm_api.h"
+#include "dwm_tdoa.h"
+#include "dwm_gdop.h"
+#include "dwm_trace.h"
+
+#define DWM_PIPE_WORKER_MAX      16
+#define DWM_PIPE_TAG_MAX         1024
+#define DWM_PIPE_EPOCH_Q         16       /* epochs queued per tag, the oldest is dropped when full */
+
+typedef struct dwm_pipe dwm_pipe_t;
+
+/**
+ * @brief result callback, called by the worker threads, in epoch order
+ *        for each tag, and concurrently for different tags
+ *
+ * @param[in] arg, dwm_pipe_init() argument
+ * @param[in] tag_id, seq, epoch of the fix
+ * @param[in] p, dim coordinates of the fix, m
+ * @param[in] rv, dwm_tdoa_solve() error code, RV_ERR as well when fewer than
+ *            dim + 1 anchors received the blink
+ */
+typedef void (*dwm_pipe_cb_t)(void* arg, uint64_t tag_id, uint32_t seq, const double* p, int rv);
+
+/**
+ * @brief Starts the pipeline
+ *
+ * @param[out] pipe
+ * @param[in] an, anchors, the anchor indexes of dwm_pipe_blink()
+ * @param[in] worker_cnt, threads, up to DWM_PIPE_WORKER_MAX
+ * @param[in] cb, arg, result callback
+ *
+ * @return Error code
+ */
+int dwm_pipe_init(dwm_pipe_t** pipe, const dwm_tdoa_t* an, int worker_cnt, dwm_pipe_cb_t cb, void* arg);
+
+/**
+ * @brief Stops the workers, the epochs not solved yet are dropped
+ *
+ * @return none
+ */
+void dwm_pipe_deinit(dwm_pipe_t* pipe);
+
+/**
+ * @brief Adds the RX timestamp of a blink. The epoch of the tag is queued
+ *        once all the anchors received it, or when a later epoch of the tag
+ *        starts. Blinks of older epochs are dropped.
+ *
+ * @param[in, out] pipe
+ * @param[in] tag_id
+ * @param[in] seq, blink sequence number
+ * @param[in] anchor, anchor index
+ * @param[in] ts, master time, DWM_CLK_TICK_HZ ticks, see dwm_clk_correct()
+ *
+ * @return Error code, RV_ERR if the tag table is full or the blink is late
+ */
+int dwm_pipe_blink(dwm_pipe_t* pipe, uint64_t tag_id, uint32_t seq, int anchor, uint64_t ts);
+
+/**
+ * @brief Adds a whole epoch of a tag, as grouped by dwm_ingest.h, queued at
+ *        once. An epoch of the tag open from dwm_pipe_blink() is queued
+ *        first.
+ *
+ * @param[in, out] pipe
+ * @param[in] tag_id
+ * @param[in] seq, blink sequence number
+ * @param[in] mask, anchors which received the blink
+ * @param[in] ts, master time per anchor index, see dwm_pipe_blink()
+ *
+ * @return Error code, RV_ERR if the tag table is full or the epoch is not
+ *         newer than the last one of the tag
+ */
+int dwm_pipe_epoch(dwm_pipe_t* pipe, uint64_t tag_id, uint32_t seq, uint32_t mask, const uint64_t* ts);
+
+/**
+ * @brief Queues the incomplete epochs and waits for all the epochs to be
+ *        solved
+ *
+ * @return none
+ */
+void dwm_pipe_flush(dwm_pipe_t* pipe);
+
+/**
+ * @brief Solves the epochs of a tag with a fix on the best anchor subset of
+ *        its cell, to be set before the first blink
+ *
+ * @param[in, out] pipe
+ * @param[in] gdop, grid of the anchors of dwm_pipe_init(), kept until
+ *            dwm_pipe_deinit(), NULL to solve on all the anchors
+ *
+ * @return none
+ */
+void dwm_pipe_gdop_set(dwm_pipe_t* pipe, const dwm_gdop_t* gdop);
+
+/**
+ * @brief Stamps the SOLVE stage of the fixes before the result callback,
+ *        trace seq is the 8 bit blink number, to be set before the first
+ *        blink
+ *
+ * @param[in, out] pipe
+ * @param[in] tr, tracing, NULL for none
+ *
+ * @return none
+ */
+void dwm_pipe_trace_set(dwm_pipe_t* pipe, dwm_trace_t* tr);
+
+/**
+ * @brief Gets the number of epochs dropped because their tag queue was full
+ *
+ * @return dropped epochs since dwm_pipe_init()
+ */
+uint32_t dwm_pipe_drop_cnt(dwm_pipe_t* pipe);
+
+#endif //_DWM_PIPE_H_
@@ -0,0 +1,108 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_radio_stats.h
+ * @brief   DWM1001 host API, radio counters of the TDoA tag and anchor firmware header
+ *
+ *          The TTK1000 TDoA firmware (radio_stats.h) keeps the DW1000 event
+ *          counters and its own frame counters as 32 bit totals. The host
+ *          asks for them with a CMD_BIN_STATS TLV in a binary frame:
+ *
+ *          | SOF 0xA5 | LEN (2) | TLV ... | CRC-16/CCITT (2) |
+ *
+ *          and gets them back in the answer frame. The difference of two
+ *          reports tells whether the frames are lost on the air or in the
+ *          firmware, see dwm_radio_stats_loss().
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DWM_RADIO_STATS_H_
+#define _DWM_RADIO_STATS_H_
+
+#include <stdint.h>
+#include "dwm_api.h"
+
+#define DWM_RADIO_STATS_SOF      0xA5
+#define DWM_RADIO_STATS_TLV      0x14     /* CMD_BIN_STATS */
+#define DWM_RADIO_STATS_TIMEOUT  500      /* ms, dwm_radio_stats_get() */
+
+/* counters, in the order of the firmware report */
+enum {
+   DWM_RADIO_STATS_PHE = 0,               /* PHY header errors */
+   DWM_RADIO_STATS_RSL,                   /* Reed Solomon (frame sync) losses */
+   DWM_RADIO_STATS_CRCG,                  /* frames with a good CRC */
+   DWM_RADIO_STATS_CRCB,                  /* frames with a bad CRC */
+   DWM_RADIO_STATS_ARFE,                  /* frames rejected by the frame filter */
+   DWM_RADIO_STATS_OVER,                  /* receiver overruns */
+   DWM_RADIO_STATS_SFDTO,                 /* SFD timeouts */
+   DWM_RADIO_STATS_PTO,                   /* preamble detection timeouts */
+   DWM_RADIO_STATS_RTO,                   /* frame wait timeouts */
+   DWM_RADIO_STATS_TXF,                   /* frames sent */
+   DWM_RADIO_STATS_HPW,                   /* half period warnings */
+   DWM_RADIO_STATS_TXW,                   /* TX power up warnings */
+   DWM_RADIO_STATS_APP_TX,                /* frames the firmware started */
+   DWM_RADIO_STATS_APP_TXLOST,            /* TX confirmations lost */
+   DWM_RADIO_STATS_APP_RX,                /* good frames passed to the firmware */
+   DWM_RADIO_STATS_APP_RXERR,             /* RX errors, the receiver was reset */
+   DWM_RADIO_STATS_APP_DROP,              /* good frames the firmware had no room for */
+   DWM_RADIO_STATS_NUM
+};
+
+#define DWM_RADIO_STATS_LEN      (4 + 4*DWM_RADIO_STATS_NUM)
+
+/**
+ * @brief report of the firmware
+ */
+typedef struct {
+   uint32_t tick_ms;                      /* firmware ms of the DW1000 counter snapshot */
+   uint32_t cnt[DWM_RADIO_STATS_NUM];     /* totals since the firmware started */
+} dwm_radio_stats_t;
+
+/**
+ * @brief frames lost between two reports
+ */
+typedef struct {
+   uint32_t rx;                           /* frames passed to the firmware */
+   uint32_t rf;                           /* lost on the air: header, sync, CRC errors and SFD timeouts */
+   uint32_t fw;                           /* lost in the firmware: overruns, drops, good frames not handled */
+   uint32_t tx_lost;                      /* TX confirmations lost */
+} dwm_radio_loss_t;
+
+/**
+ * @brief Asks the firmware on the UART for its counters. The frames which
+ *        are not the answer, e.g. the blink reports of an anchor, are
+ *        skipped, nothing else may read the UART meanwhile.
+ *
+ * @param[out] s, report
+ *
+ * @return Error code, RV_ERR on a timeout of DWM_RADIO_STATS_TIMEOUT or
+ *         when the current device is not on the UART
+ */
+int dwm_radio_stats_get(dwm_radio_stats_t* s);
+
+/**
+ * @brief Gets the report from a binary frame read by the application, e.g.
+ *        from the stream of an anchor
+ *
+ * @param[in] frame, len, whole frame, SOF to CRC
+ * @param[out] s, report
+ *
+ * @return Error code, RV_ERR if the frame is broken or has no report
+ */
+int dwm_radio_stats_parse(const uint8_t* frame, int len, dwm_radio_stats_t* s);
+
+/**
+ * @brief Frames lost between two reports of the same device
+ *
+ * @param[in] prev, now, reports
+ * @param[out] loss
+ *
+ * @return none
+ */
+void dwm_radio_stats_loss(const dwm_radio_stats_t* prev, const dwm_radio_stats_t* now, dwm_radio_loss_t* loss);
+
+#endif //_DWM_RADIO_STATS_H_
@@ -0,0 +1,163 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_rec.h
+ * @brief   DWM1001 host API, binary location record files header
+ *
+ *          A record file is a dwm_rec_hdr_t followed by fixed size
+ *          dwm_rec_t records, in the byte order of the host (little endian
+ *          on the Raspberry-Pi and x86). The records are appended through a
+ *          buffer, and a file is read by mapping it in memory: record i is
+ *          at hdr_size + i*rec_size, a record cut by a crash is ignored.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DWM_REC_H_
+#define _DWM_REC_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "dwm_api.h"
+
+#define DWM_REC_MAGIC            "DWMR"
+#define DWM_REC_VERSION          1
+#define DWM_REC_BUF_CNT          256   /* records buffered before a write */
+
+/**
+ * @brief file header, 64 bytes
+ */
+typedef struct {
+   char magic[4];          /* DWM_REC_MAGIC */
+   uint16_t version;       /* DWM_REC_VERSION */
+   uint16_t hdr_size;      /* offset of the first record */
+   uint16_t rec_size;      /* sizeof(dwm_rec_t) */
+   uint8_t an_cnt_max;     /* DWM_RANGING_ANCHOR_CNT_MAX */
+   uint8_t reserved0;
+   uint32_t reserved1;
+   uint64_t start_ts;      /* HAL_GetTime64() time at the file creation, in us */
+   uint64_t start_wall;    /* wall clock time at the file creation, in us since the epoch */
+   uint8_t reserved[32];
+} dwm_rec_hdr_t;
+
+/**
+ * @brief distance to a ranging anchor, 8 bytes
+ */
+typedef struct {
+   uint16_t addr;
+   uint8_t qf;
+   uint8_t reserved;
+   uint32_t dist;          /* mm */
+} dwm_rec_dist_t;
+
+/**
+ * @brief location record, 152 bytes
+ */
+typedef struct {
+   uint64_t ts;            /* HAL_GetTime64() time of the location, in us */
+   uint64_t node_id;
+   uint32_t seq;
+   int32_t x;              /* mm */
+   int32_t y;
+   int32_t z;
+   uint8_t qf;
+   uint8_t cnt;            /* anchors in an */
+   uint16_t reserved0;
+   dwm_rec_dist_t an[DWM_RANGING_ANCHOR_CNT_MAX];
+   uint32_t reserved1;
+} dwm_rec_t;
+
+/**
+ * @brief record file being written
+ */
+typedef struct {
+   FILE* fp;
+   dwm_rec_t buf[DWM_REC_BUF_CNT];
+   int cnt;                /* records in buf */
+} dwm_rec_writer_t;
+
+/**
+ * @brief record file mapped in memory
+ */
+typedef struct {
+   const uint8_t* base;
+   size_t size;
+   const dwm_rec_hdr_t* hdr;
+   uint32_t cnt;           /* whole records in the file */
+} dwm_rec_reader_t;
+
+/**
+ * @brief Creates a record file and writes its header
+ *
+ * @param[out] w, writer
+ * @param[in] path, file name, an existing file is truncated
+ *
+ * @return Error code
+ */
+int dwm_rec_open(dwm_rec_writer_t* w, const char* path);
+
+/**
+ * @brief Appends a location, written to the file once the buffer is full
+ *
+ * @param[in, out] w, writer
+ * @param[in] ts, time of the location, in us of HAL_GetTime64()
+ * @param[in] seq, sequence number of the location, dwm_stream_rec_t.seq
+ * @param[in] node_id, node of the location
+ * @param[in] loc, location, loc->p_pos must be set
+ *
+ * @return Error code
+ */
+int dwm_rec_append(dwm_rec_writer_t* w, uint64_t ts, uint32_t seq, uint64_t node_id, const dwm_loc_data_t* loc);
+
+/**
+ * @brief Writes the buffered records to the file
+ *
+ * @param[in, out] w, writer
+ *
+ * @return Error code
+ */
+int dwm_rec_flush(dwm_rec_writer_t* w);
+
+/**
+ * @brief Writes the buffered records and closes the file
+ *
+ * @param[in, out] w, writer
+ *
+ * @return Error code
+ */
+int dwm_rec_close(dwm_rec_writer_t* w);
+
+/**
+ * @brief Maps a record file in memory and checks its header
+ *
+ * @param[out] r, reader
+ * @param[in] path, file name
+ *
+ * @return Error code
+ */
+int dwm_rec_map(dwm_rec_reader_t* r, const char* path);
+
+/**
+ * @brief Gets a record of a mapped file
+ *
+ * @param[in] r, reader
+ * @param[in] idx, record index, below r->cnt
+ *
+ * @return pointer to the record in the mapping, NULL if idx is out of range
+ */
+const dwm_rec_t* dwm_rec_at(const dwm_rec_reader_t* r, uint32_t idx);
+
+/**
+ * @brief Unmaps a record file
+ *
+ * @param[in, out] r, reader
+ *
+ * @return none
+ */
+void dwm_rec_unmap(dwm_rec_reader_t* r);
+
+#endif //_DWM_REC_H_
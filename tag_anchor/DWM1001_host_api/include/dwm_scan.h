@@ -0,0 +1,169 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_scan.h
+ * @brief   DWM1001 host API, background UWB scan and preamble code choice
+ *
+ *          dwm_scan_step() is called by the host loop in its idle windows.
+ *          Every period_ms it sweeps the preamble codes 9 to 12: the module
+ *          is moved to each code, dwm_uwb_scan_start() is run and the
+ *          networks heard are kept in a history per code. The module is
+ *          back on its code at the end of the sweep, it does not range with
+ *          its network during the sweep. Each step is one or two requests.
+ *
+ *          The congestion of a code is the mean power heard per scan,
+ *          sum of 10^(rssi/10) over the networks, in dB. On the code of the
+ *          node the anchors of its own network, from dwm_anchor_list_get()
+ *          on an anchor, are taken out.
+ *
+ *          A switch is coordinated with a message on the backhaul user
+ *          data, sent up to announce_cnt times until the switch:
+ *
+ *             DWM_SCAN_MSG_ID (1) | code (1) | ms left (2, LE) | seq (1)
+ *
+ *          The nodes receiving it, given by the application to
+ *          dwm_scan_msg_rx(), switch at the same time. The first byte never
+ *          starts a dwm_frag.h fragment.
+ *
+ *          The service is not thread safe, it is stepped by the thread
+ *          driving the module.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DWM_SCAN_H_
+#define _DWM_SCAN_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "dwm_api.h"
+
+#define DWM_SCAN_CODE_MIN        DWM_UWB_PRAMBLE_CODE_9
+#define DWM_SCAN_CODE_NUM        4
+#define DWM_SCAN_HIST_LEN        16    /* scans kept per code */
+#define DWM_SCAN_MSG_ID          0xC5
+#define DWM_SCAN_MSG_LEN         5
+#define DWM_SCAN_FLOOR_DB        (-100.0)
+
+typedef struct {
+   uint32_t period_ms;           /* from the end of a sweep to the next one */
+   uint16_t result_ms;           /* longest wait of a scan result */
+   bool sweep;                   /* all the codes, else only the code of the node */
+   uint8_t min_scans;            /* scans of each code before a recommendation */
+   float margin_db;              /* congestion drop of a recommended code */
+   bool auto_apply;              /* switches to the recommended code after a sweep */
+   uint16_t switch_delay_ms;     /* from the announcement to the switch */
+   uint8_t announce_cnt;         /* messages of a switch */
+} dwm_scan_cfg_t;
+
+typedef struct {
+   uint8_t scans;                /* in the history */
+   float nets;                   /* networks heard per scan */
+   int8_t rssi_max;              /* strongest network heard, -128 if none */
+   float congestion_db;          /* mean power heard, own network out */
+} dwm_scan_code_stat_t;
+
+/**
+ * @brief service state, internal
+ */
+typedef struct {
+   dwm_scan_cfg_t cfg;
+   uint8_t home;                 /* code of the network */
+   uint8_t cur;                  /* code the module is on */
+   uint8_t idx;                  /* code of the sweep, index from DWM_SCAN_CODE_MIN */
+   bool wait;                    /* scan started, result not read */
+   uint64_t next_ts;             /* HAL_GetTime64(), next scan or result deadline */
+   uint8_t hist_nets[DWM_SCAN_CODE_NUM][DWM_SCAN_HIST_LEN];
+   int8_t hist_rssi[DWM_SCAN_CODE_NUM][DWM_SCAN_HIST_LEN];
+   float hist_pwr[DWM_SCAN_CODE_NUM][DWM_SCAN_HIST_LEN];
+   uint8_t hist_len[DWM_SCAN_CODE_NUM];
+   uint8_t hist_pos[DWM_SCAN_CODE_NUM];
+   uint8_t sw_code;              /* switch scheduled */
+   uint64_t sw_ts;               /* HAL_GetTime64(), 0 if none */
+   uint8_t sw_seq;
+   uint8_t sw_announce;          /* messages left */
+   bool rx_seq_known;
+   uint8_t rx_seq;
+   uint32_t scans;
+   uint32_t switches;
+} dwm_scan_t;
+
+/**
+ * @brief Gets the default configuration: sweep every 60 s, 3 scans of each
+ *        code and 3 dB before a recommendation, not applied, switch 2 s
+ *        after the first of 5 announcements
+ *
+ * @param[out] cfg
+ *
+ * @return none
+ */
+void dwm_scan_cfg_default(dwm_scan_cfg_t* cfg);
+
+/**
+ * @brief Starts the service on the device of the calling thread, reads the
+ *        code of the node
+ *
+ * @param[out] s
+ * @param[in] cfg, NULL for the default
+ *
+ * @return Error code
+ */
+int dwm_scan_init(dwm_scan_t* s, const dwm_scan_cfg_t* cfg);
+
+/**
+ * @brief Runs the next request of the service: switch announcement or
+ *        switch, scan start, result read, return to the code of the node
+ *
+ * @param[in, out] s
+ *
+ * @return Error code of the request, RV_OK if none was due
+ */
+int dwm_scan_step(dwm_scan_t* s);
+
+/**
+ * @brief Gets the history of a code
+ *
+ * @param[in] s
+ * @param[in] code, 9 to 12
+ * @param[out] stat
+ *
+ * @return Error code, RV_ERR_PARAM if the code is not valid
+ */
+int dwm_scan_code_stat_get(const dwm_scan_t* s, dwm_uwb_preamble_code_t code, dwm_scan_code_stat_t* stat);
+
+/**
+ * @brief Gets the least congested code, if it beats the code of the node
+ *        by margin_db and all the codes have min_scans scans
+ *
+ * @param[in] s
+ * @param[out] code
+ *
+ * @return Error code, RV_ERR if the node should stay on its code
+ */
+int dwm_scan_recommend(const dwm_scan_t* s, dwm_uwb_preamble_code_t* code);
+
+/**
+ * @brief Schedules a coordinated switch switch_delay_ms from now, announced
+ *        by the next steps
+ *
+ * @param[in, out] s
+ * @param[in] code, 9 to 12
+ *
+ * @return Error code, RV_ERR_PARAM if the code is not valid
+ */
+int dwm_scan_switch(dwm_scan_t* s, dwm_uwb_preamble_code_t code);
+
+/**
+ * @brief Takes a switch announcement read from the backhaul user data
+ *
+ * @param[in, out] s
+ * @param[in] data, len, user data read
+ *
+ * @return Error code, RV_OK if the data is an announcement
+ */
+int dwm_scan_msg_rx(dwm_scan_t* s, const uint8_t* data, uint8_t len);
+
+#endif //_DWM_SCAN_H_
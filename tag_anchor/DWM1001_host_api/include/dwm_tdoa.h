@@ -0,0 +1,105 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_tdoa.h
+ * @brief   DWM1001 host API, TDoA multilateration header
+ *
+ *          A fix is solved from the range differences d_i = r_i - r_0 of the
+ *          anchors to anchor 0, c times the TDoA: a closed form linear solve
+ *          of 2(a_i - a_0).(p - a_0) + 2 d_i r_0 = |a_i - a_0|^2 - d_i^2 in
+ *          p and r_0, refined by Levenberg-Marquardt iterations on the
+ *          hyperbolas |p - a_i| - |p - a_0| - d_i with their analytic
+ *          Jacobian. The matrices are fixed size on the stack, nothing is
+ *          allocated, and the solver does not use the HAL, so it links into
+ *          the host tools as well.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DWM_TDOA_H_
+#define _DWM_TDOA_H_
+
+#include <stdint.h>
+#include "dwm_api.h"
+
+#define DWM_TDOA_ANCHOR_CNT_MAX  16
+#define DWM_TDOA_DIM_MAX         3
+#define DWM_TDOA_ITER_MAX        10
+#define DWM_TDOA_STEP_MIN        1e-6     /* m, iterations stop below this step */
+#define DWM_TDOA_WARM_STEP       1e-4     /* m, same from a prediction, far below the fix noise */
+#define DWM_TDOA_WARM_RMS        1.0      /* m, default rms above which a warm fix is solved again from the linear solve */
+
+/**
+ * @brief anchor set of the solver
+ */
+typedef struct {
+   int dim;                                           /* 2 or 3 */
+   int cnt;
+   double a[DWM_TDOA_ANCHOR_CNT_MAX][DWM_TDOA_DIM_MAX];  /* m */
+   double k[DWM_TDOA_ANCHOR_CNT_MAX];                 /* |a_i - a_0|^2 */
+} dwm_tdoa_t;
+
+/**
+ * @brief Sets the anchors
+ *
+ * @param[out] t
+ * @param[in] dim, 2 or 3
+ * @param[in] cnt, anchors, at least dim + 1
+ * @param[in] anchors, cnt positions of dim coordinates, m
+ *
+ * @return Error code
+ */
+int dwm_tdoa_init(dwm_tdoa_t* t, int dim, int cnt, const double* anchors);
+
+/**
+ * @brief Closed form linear solve, needs at least dim + 2 anchors
+ *
+ * @param[in] t
+ * @param[in] rd, cnt range differences r_i - r_0, m, rd[0] is not used
+ * @param[out] p, dim coordinates, m
+ *
+ * @return Error code
+ */
+int dwm_tdoa_linear(const dwm_tdoa_t* t, const double* rd, double* p);
+
+/**
+ * @brief Solves a fix, the linear solve, or the guess, refined by
+ *        Levenberg-Marquardt
+ *
+ * @param[in] t
+ * @param[in] rd, cnt range differences r_i - r_0, m, rd[0] is not used
+ * @param[in] guess, dim coordinates, e.g. the last fix, NULL for the linear
+ *            solve, or the centroid of the anchors if there are too few
+ * @param[out] p, dim coordinates, m
+ * @param[out] rms, rms of the hyperbola residuals, m, may be NULL
+ *
+ * @return Error code, RV_ERR if the iterations ran away from the anchors,
+ *         p is then the starting point
+ */
+int dwm_tdoa_solve(const dwm_tdoa_t* t, const double* rd, const double* guess, double* p, double* rms);
+
+/**
+ * @brief Solves a fix from a prediction, e.g. the tracker prediction or the
+ *        last fix of a tag: Levenberg-Marquardt from pred, stopped once a
+ *        step is below DWM_TDOA_WARM_STEP. If it runs away or its rms is
+ *        above rms_max, e.g. a wrong prediction converging to a wrong
+ *        minimum, the fix is solved again as dwm_tdoa_solve() without guess.
+ *
+ * @param[in] t
+ * @param[in] rd, cnt range differences r_i - r_0, m, rd[0] is not used
+ * @param[in] pred, dim coordinates, NULL for the full solve
+ * @param[in] rms_max, m, e.g. DWM_TDOA_WARM_RMS, a few times the range
+ *            difference noise
+ * @param[out] p, dim coordinates, m
+ * @param[out] rms, rms of the hyperbola residuals, m, may be NULL
+ * @param[out] iter, iterations of both solves, may be NULL
+ *
+ * @return Error code, see dwm_tdoa_solve()
+ */
+int dwm_tdoa_solve_warm(const dwm_tdoa_t* t, const double* rd, const double* pred, double rms_max,
+      double* p, double* rms, int* iter);
+
+#endif //_DWM_TDOA_H_
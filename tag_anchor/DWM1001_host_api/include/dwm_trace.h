@@ -0,0 +1,147 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_trace.h
+ * @brief   DWM1001 host API, latency tracing of the blinks and locations header
+ *
+ *          A trace is a blink or a location, identified by the EUI-64 of its
+ *          tag and its sequence number, stamped with the wall clock at each
+ *          stage it goes through:
+ *
+ *          RX     anchor RX timestamp, on the host clock, see dwm_trace_anchor_rx()
+ *          READ   host read of the anchor frame, or location ready interrupt of the stream
+ *          GROUP  epoch emitted by dwm_ingest.h
+ *          SOLVE  fix reported by dwm_pipe.h
+ *          PUB    location frame sent by loc_pub
+ *          MERGE  location merged by loc_agg
+ *
+ *          The blink is on the air for less than a microsecond, its RX
+ *          timestamp stands for the TX of the tag. A stage is stamped once
+ *          per trace, the first time. Each stamp adds its step, the time
+ *          since the last earlier stage of the trace, and its total, the
+ *          time since the first stage, to the histograms of its stage. An
+ *          earlier stage stamped in another process comes with the frame,
+ *          see dwm_trace_stamp_from(), across hosts the wall clocks must be
+ *          synchronised.
+ *
+ *          The histograms have 8 buckets per octave of microseconds, the
+ *          quantiles are within 12.5%. They are written as JSON by
+ *          dwm_trace_dump(), replaced in one rename for the readers. The
+ *          functions are thread safe.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DWM_TRACE_H_
+#define _DWM_TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "dwm_api.h"
+
+#define DWM_TRACE_OPEN           4096     /* traces kept per process, direct mapped, power of 2 */
+#define DWM_TRACE_LIVE_US        1000000  /* a trace not stamped for this long is over, its id may come again */
+#define DWM_TRACE_BUCKET_CNT     256      /* up to 2^33 us */
+#define DWM_TRACE_ANCHOR_MAX     16
+#define DWM_TRACE_RELAX_PPM      50.0     /* anchor offset followed up, above the drift of the anchors */
+
+/* stages, in pipeline order */
+enum {
+   DWM_TRACE_RX = 0,
+   DWM_TRACE_READ,
+   DWM_TRACE_GROUP,
+   DWM_TRACE_SOLVE,
+   DWM_TRACE_PUB,
+   DWM_TRACE_MERGE,
+   DWM_TRACE_STAGE_CNT
+};
+
+typedef struct dwm_trace dwm_trace_t;
+
+/**
+ * @brief Starts the tracing
+ *
+ * @param[out] tr
+ *
+ * @return Error code
+ */
+int dwm_trace_init(dwm_trace_t** tr);
+
+/**
+ * @brief Frees the tracing
+ *
+ * @return none
+ */
+void dwm_trace_deinit(dwm_trace_t* tr);
+
+/**
+ * @brief Gets the wall clock
+ *
+ * @return us since the epoch
+ */
+uint64_t dwm_trace_now_us(void);
+
+/**
+ * @brief Stamps a stage of a trace
+ *
+ * @param[in, out] tr
+ * @param[in] stage, DWM_TRACE_RX..
+ * @param[in] tag_id, seq, trace
+ * @param[in] t_us, wall clock of the stage
+ *
+ * @return none
+ */
+void dwm_trace_stamp(dwm_trace_t* tr, int stage, uint64_t tag_id, uint32_t seq, uint64_t t_us);
+
+/**
+ * @brief Stamps a stage of a trace whose earlier stage was stamped in
+ *        another process, at prev_us of the frame. prev_stage is only set,
+ *        it is counted in the other process.
+ *
+ * @param[in, out] tr
+ * @param[in] stage, tag_id, seq, t_us, see dwm_trace_stamp()
+ * @param[in] prev_stage, prev_us, earlier stage and its wall clock
+ *
+ * @return none
+ */
+void dwm_trace_stamp_from(dwm_trace_t* tr, int stage, uint64_t tag_id, uint32_t seq, int prev_stage, uint64_t prev_us,
+      uint64_t t_us);
+
+/**
+ * @brief Maps the 40 bit RX timestamp of an anchor onto the wall clock. The
+ *        offset of the anchor clock is the smallest read_us - ts seen, let
+ *        up at DWM_TRACE_RELAX_PPM to follow the drift, so the RX to READ
+ *        step is measured above the fastest record of the anchor.
+ *
+ * @param[in, out] tr
+ * @param[in] anchor, index
+ * @param[in] ts, RX timestamp
+ * @param[in] read_us, wall clock of the read of the record
+ *
+ * @return wall clock of the RX
+ */
+uint64_t dwm_trace_anchor_rx(dwm_trace_t* tr, int anchor, uint64_t ts, uint64_t read_us);
+
+/**
+ * @brief Gets a quantile of a stage
+ *
+ * @param[in] tr
+ * @param[in] stage
+ * @param[in] q, 0 to 1
+ * @param[in] total, of the total rather than of the step
+ *
+ * @return us, the upper bound of the bucket
+ */
+uint64_t dwm_trace_quantile(dwm_trace_t* tr, int stage, double q, bool total);
+
+/**
+ * @brief Writes the histograms as JSON to path, through path.tmp
+ *
+ * @return Error code
+ */
+int dwm_trace_dump(dwm_trace_t* tr, const char* path);
+
+#endif //_DWM_TRACE_H_
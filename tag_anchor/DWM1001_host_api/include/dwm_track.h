@@ -0,0 +1,150 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    dwm_track.h
+ * @brief   DWM1001 host API, batched TDoA EKF tracker header
+ *
+ *          Tracks many tags on the same anchors with a constant velocity EKF,
+ *          state x, y, vx, vy in m and m/s, measuring the range differences
+ *          r_i - r_0 of dwm_tdoa.h and optionally the velocity. The states
+ *          and the covariances are kept in structure of arrays layout in one
+ *          pool allocated at init: a tick predicts all the tags and updates
+ *          those with a measurement in loops over the tags, with no branch
+ *          per tag, so they vectorise. The measurements are applied as
+ *          sequential scalar updates linearised at the prediction, which is
+ *          the vector EKF update for the diagonal measurement noise.
+ *
+ *          A tag is known by a handle, slots are kept dense so add and
+ *          remove are O(1) and the loops only cover the tags in use.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DWM_TRACK_H_
+#define _DWM_TRACK_H_
+
+#include <stdint.h>
+#include "dwm_api.h"
+#include "dwm_tdoa.h"
+
+#define DWM_TRACK_STATE_NUM      4
+#define DWM_TRACK_COV_NUM        10       /* upper triangle of the covariance */
+#define DWM_TRACK_HANDLE_NONE    UINT32_MAX
+
+/**
+ * @brief noises of the tracker
+ */
+typedef struct {
+   double p0_pos, p0_vel;     /* initial variances, m^2, (m/s)^2 */
+   double q_pos, q_vel;       /* process noise, per s */
+   double r_rd;               /* range difference variance, m^2 */
+   double r_vel;              /* velocity variance, (m/s)^2 */
+} dwm_track_noise_t;
+
+/**
+ * @brief tracker, the arrays are indexed by slot, 0 to cnt - 1
+ */
+typedef struct {
+   dwm_tdoa_t an;
+   dwm_track_noise_t n;
+   uint32_t cap;
+   uint32_t cnt;
+   double *s[DWM_TRACK_STATE_NUM];   /* x, y, vx, vy */
+   double *p[DWM_TRACK_COV_NUM];     /* p00 p01 p02 p03 p11 p12 p13 p22 p23 p33 */
+   double *z;                        /* range differences, [anchor][slot], anchor 0 is not used */
+   double *zv[2];                    /* velocity */
+   double *w, *wv;                   /* 1 if the slot has a measurement this tick, else 0 */
+   double *h, *hx, *hy;              /* scratch, [anchor][slot] */
+   double *sp[2];                    /* scratch, predicted position */
+   uint32_t *slot_handle;
+   uint32_t *handle_slot;            /* DWM_TRACK_HANDLE_NONE if free */
+   uint32_t *free_handle;            /* stack of the free handles */
+   uint32_t free_cnt;
+   void *pool;
+} dwm_track_t;
+
+/**
+ * @brief Allocates a tracker
+ *
+ * @param[out] t
+ * @param[in] an, anchors, 2D
+ * @param[in] n, noises
+ * @param[in] cap, tags
+ *
+ * @return Error code
+ */
+int dwm_track_init(dwm_track_t* t, const dwm_tdoa_t* an, const dwm_track_noise_t* n, uint32_t cap);
+
+/**
+ * @brief Frees a tracker
+ *
+ * @return none
+ */
+void dwm_track_free(dwm_track_t* t);
+
+/**
+ * @brief Adds a tag, O(1)
+ *
+ * @param[in, out] t
+ * @param[in] pos, x, y initial position, m, e.g. dwm_tdoa_solve()
+ * @param[out] handle
+ *
+ * @return Error code, RV_ERR if the tracker is full
+ */
+int dwm_track_add(dwm_track_t* t, const double* pos, uint32_t* handle);
+
+/**
+ * @brief Removes a tag, O(1), the last slot moves into its slot
+ *
+ * @return Error code
+ */
+int dwm_track_remove(dwm_track_t* t, uint32_t handle);
+
+/**
+ * @brief Sets the measurement of a tag for the next dwm_track_step()
+ *
+ * @param[in, out] t
+ * @param[in] handle
+ * @param[in] rd, an.cnt range differences r_i - r_0, m, rd[0] is not used
+ * @param[in] vel, vx, vy, m/s, NULL for none
+ *
+ * @return Error code
+ */
+int dwm_track_meas(dwm_track_t* t, uint32_t handle, const double* rd, const double* vel);
+
+/**
+ * @brief Predicts all the tags by dt and updates those with a measurement,
+ *        the measurements are then cleared
+ *
+ * @return none
+ */
+void dwm_track_step(dwm_track_t* t, double dt);
+
+/**
+ * @brief Gets the state of a tag
+ *
+ * @param[in] t
+ * @param[in] handle
+ * @param[out] state, x, y, vx, vy
+ *
+ * @return Error code
+ */
+int dwm_track_get(const dwm_track_t* t, uint32_t handle, double* state);
+
+/**
+ * @brief Predicts the position of a tag dt after the last step, the warm
+ *        start of dwm_tdoa_solve_warm()
+ *
+ * @param[in] t
+ * @param[in] handle
+ * @param[in] dt, s
+ * @param[out] pos, x, y
+ *
+ * @return Error code
+ */
+int dwm_track_predict(const dwm_track_t* t, uint32_t handle, double dt, double* pos);
+
+#endif //_DWM_TRACK_H_
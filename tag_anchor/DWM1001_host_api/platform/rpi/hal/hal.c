@@ -37,22 +37,55 @@ void HAL_Delay(int msec)
 }
 
 /** 
- * @brief get the current sys time in microsecond
+ * @brief Wait specified time in microsecond
  *
- * @param[in] msec in milisecond
+ * @param[in] usec in microsecond
+ *
+ * @return none
+ */
+void HAL_DelayUs(int usec)
+{
+    struct timespec tim;
+
+    tim.tv_sec = usec / 1000000;
+    tim.tv_nsec = (usec - tim.tv_sec * 1000000) * 1000;
+
+    while (nanosleep(&tim, &tim) < 0);
+}
+
+/** 
+ * @brief get the current sys time in microsecond, from the monotonic clock so 
+ *        that the deadlines computed with it do not jump with the wall clock
+ *
+ * @param none
  *
  * @return current sys time, 64-bit
  */
 uint64_t HAL_GetTime64(void)
 {
-   struct timeval time;
+   struct timespec time;
    uint64_t time_output;
    
-   gettimeofday(&time,NULL);
-   time_output = (uint64_t)time.tv_usec + ((uint64_t)time.tv_sec)*1000000;
+   clock_gettime(CLOCK_MONOTONIC, &time);
+   time_output = (uint64_t)(time.tv_nsec / 1000) + ((uint64_t)time.tv_sec)*1000000;
    return time_output;   
 }
 
+/** 
+ * @brief get the current sys time in nanosecond, from the raw monotonic clock 
+ *
+ * @param none
+ *
+ * @return current sys time in ns, 64-bit
+ */
+uint64_t HAL_GetTimeNs(void)
+{
+   struct timespec time;
+   
+   clock_gettime(CLOCK_MONOTONIC_RAW, &time);
+   return (uint64_t)time.tv_nsec + ((uint64_t)time.tv_sec)*1000000000;   
+}
+
 /** 
  * @brief no operation
  *
@@ -65,6 +98,27 @@ void HAL_Nop(void)
    //no operation
 }
 
+/** 
+ * @brief select the current device number of the calling thread
+ *
+ * @param [in] dev: device number
+ *
+ * @return Error code
+ */
+int HAL_DevSel(int dev)
+{   
+#if (INTERFACE_NUMBER == 1) || (INTERFACE_NUMBER == 2) || (INTERFACE_NUMBER == 3)
+   if((dev < 0) || (dev >= HAL_SPI_DEV_NUM))
+   {
+      return HAL_ERR;
+   }
+   HAL_SPI_Sel(dev);
+   return HAL_OK;
+#else
+   return (dev == 0) ? HAL_OK : HAL_ERR; // UART has only DEV0
+#endif
+}
+
 /** 
  * @brief acquire current device number
  *
@@ -80,11 +134,62 @@ int HAL_DevNum()
    return HAL_SPI_Which();
 #elif INTERFACE_NUMBER == 2
    return HAL_SPI_Which();
+#elif INTERFACE_NUMBER == 3
+   return HAL_SPI_Which();
 #else
    return 0;
 #endif
 }
 
+#if INTERFACE_NUMBER == 3
+// interface of each device, set by the probe of LMH_Init()
+static volatile int hal_if[HAL_SPI_DEV_NUM] = {HAL_IF_SPI, HAL_IF_SPI};
+static const char* const hal_if_str[HAL_IF_NUM] = {"HAL_UART", "HAL_SPI", "HAL_SPI_DRDY"};
+
+/** 
+ * @brief set the interface of a device, the UART is on device 0 only
+ *
+ * @param [in] dev: device number
+ * @param [in] interface: HAL_IF_UART, HAL_IF_SPI or HAL_IF_SPI_DRDY
+ *
+ * @return Error code
+ */
+int HAL_IF_Set(int dev, int interface)
+{
+   if((dev < 0) || (dev >= HAL_SPI_DEV_NUM) || (interface < 0) || (interface >= HAL_IF_NUM)
+      || ((interface == HAL_IF_UART) && (dev != 0)))
+   {
+      return HAL_ERR;
+   }
+   hal_if[dev] = interface;
+   return HAL_OK;
+}
+
+/** 
+ * @brief acquire the interface of a device
+ *
+ * @param [in] dev: device number
+ *
+ * @return HAL_IF_UART, HAL_IF_SPI or HAL_IF_SPI_DRDY
+ */
+int HAL_IF_Get(int dev)
+{
+   return ((dev < 0) || (dev >= HAL_SPI_DEV_NUM)) ? HAL_IF_SPI : hal_if[dev];
+}
+
+/** 
+ * @brief name of the interface of the current device
+ *
+ * @param none
+ *
+ * @return "HAL_UART", "HAL_SPI" or "HAL_SPI_DRDY"
+ */
+const char* HAL_IF_Str(void)
+{
+   return hal_if_str[HAL_IF_Get(HAL_DevNum())];
+}
+#endif
+
 /** 
  * @brief HAL_Print redefines printf
  */
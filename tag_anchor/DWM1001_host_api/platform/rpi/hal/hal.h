@@ -33,14 +33,35 @@ void HAL_Print(const char* format, ... );
 void HAL_Delay(int msec);
 
 /** 
- * @brief get the current sys time in microsecond
+ * @brief Wait specified time in microsecond
  *
- * @param[in] msec in milisecond
+ * @param[in] usec in microsecond
+ *
+ * @return none
+ */
+void HAL_DelayUs(int usec);
+
+/** 
+ * @brief get the current sys time in microsecond, from the monotonic clock so 
+ *        that the deadlines computed with it do not jump with the wall clock
+ *
+ * @param none
  *
  * @return current sys time, 64-bit
  */
 uint64_t HAL_GetTime64(void);
 
+/** 
+ * @brief get the current sys time in nanosecond, from the raw monotonic clock 
+ *        which is not slewed by NTP, to measure latencies. The waits use 
+ *        HAL_GetTime64(), on the clock of the condition variables. 
+ *
+ * @param none
+ *
+ * @return current sys time in ns, 64-bit
+ */
+uint64_t HAL_GetTimeNs(void);
+
 /** 
  * @brief no operation
  *
@@ -50,6 +71,16 @@ uint64_t HAL_GetTime64(void);
  */
 void HAL_Nop(void);
 
+/** 
+ * @brief select the current device number of the calling thread, each 
+ *        device is then driven from the thread that selected it
+ *
+ * @param [in] dev: device number
+ *
+ * @return Error code
+ */
+int HAL_DevSel(int dev);
+
 /** 
  * @brief acquire current device number
  *
@@ -20,7 +20,8 @@
 #define HAL_GPIO_INT_EDGE_BOTH      INT_EDGE_BOTH   
 #define HAL_GPIO_INT_EDGE_SETUP     INT_EDGE_SETUP
 
-#define HAL_GPIO_DRDY  3
+#define HAL_GPIO_DRDY  3     // DRDY pin of the module on SPI dev0
+#define HAL_GPIO_DRDY1 4     // DRDY pin of the module on SPI dev1
 
 /** 
  * @brief initializes the GPIO utilities
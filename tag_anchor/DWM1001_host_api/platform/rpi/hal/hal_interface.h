@@ -7,6 +7,9 @@
  *          0: INTERFACE_USE_UART (default)
  *          1: INTERFACE_USE_SPI    
  *          2: INTERFACE_USE_SPI_DRDY
+ *          3: INTERFACE_USE_AUTO, the three interfaces are built and the
+ *             one of each device is selected at run time by LMH_Init(),
+ *             see HAL_IF_Set()
  *          note: if INTERFACE_NUMBER is not defined in makefile, the default
  *                value 0 will be used (in dwm1001.mak file)
  *
@@ -20,6 +23,47 @@
 #ifndef _HAL_IF_H_
 #define _HAL_IF_H_
 
+// interfaces, the values of INTERFACE_NUMBER
+#define HAL_IF_UART        0
+#define HAL_IF_SPI         1
+#define HAL_IF_SPI_DRDY    2
+#define HAL_IF_NUM         3
+#define HAL_IF_AUTO        3
+
+#if INTERFACE_NUMBER == 3
+#include "hal_uart.h"
+#include "hal_spi.h"
+#define HAL_IF_STR         HAL_IF_Str()
+
+/** 
+ * @brief set the interface of a device, the UART is on device 0 only
+ *
+ * @param [in] dev: device number
+ * @param [in] interface: HAL_IF_UART, HAL_IF_SPI or HAL_IF_SPI_DRDY
+ *
+ * @return Error code
+ */
+int HAL_IF_Set(int dev, int interface);
+
+/** 
+ * @brief acquire the interface of a device
+ *
+ * @param [in] dev: device number
+ *
+ * @return HAL_IF_UART, HAL_IF_SPI or HAL_IF_SPI_DRDY
+ */
+int HAL_IF_Get(int dev);
+
+/** 
+ * @brief name of the interface of the current device
+ *
+ * @param none
+ *
+ * @return "HAL_UART", "HAL_SPI" or "HAL_SPI_DRDY"
+ */
+const char* HAL_IF_Str(void);
+#else
+#define HAL_IF_Get(dev)    ((void)(dev), INTERFACE_NUMBER)
 #if INTERFACE_NUMBER == 0
 #include "hal_uart.h"
 #define HAL_IF_Tx          HAL_UART_Tx
@@ -36,6 +80,7 @@
 #define HAL_IF_STR         "HAL_SPI_DRDY"
 #endif   
 #endif   
+#endif   
 
 #endif //_HAL_IF_H_
 
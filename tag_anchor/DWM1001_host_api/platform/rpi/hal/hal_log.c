@@ -2,6 +2,14 @@
  * @file    hal_log.c
  * @brief   utility print to log file
  *
+ *          Each HAL_Log_Write() call takes a slot of the ring, formats its line
+ *          in it and publishes it. The ring is a bounded multi-producer queue:
+ *          the slots are taken with a compare-and-swap on the head, the GPIO
+ *          interrupt thread may log as well as the main thread, and each slot
+ *          carries a sequence number telling whether it is free or written.
+ *          The background thread writes the lines in order and flushes the
+ *          file once the ring is empty.
+ *
  * @attention
  *
  * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
@@ -9,34 +17,152 @@
  * All rights reserved.
  *
  */
- 
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include "hal_log.h"
+
+#define HAL_LOG_RING_SIZE     256   // lines, power of 2
+#define HAL_LOG_RING_MASK     (HAL_LOG_RING_SIZE-1)
+
+typedef struct
+{
+   atomic_uint seq;                 // position + 1 once written, position + HAL_LOG_RING_SIZE once free
+   char line[HAL_LOG_LINE_MAX];
+} hal_log_slot_t;
 
 static char log_file_name[]="log.txt";
-static FILE * fp = NULL;   
+static FILE * fp = NULL;
+
+static pthread_once_t log_once = PTHREAD_ONCE_INIT;
+
+int hal_log_level = HAL_LOG_LEVEL_DEFAULT;
+
+#if HAL_LOG_LEVEL > HAL_LOG_LVL_NONE
+// the ring and its thread, not built in with the logs off
+static hal_log_slot_t log_ring[HAL_LOG_RING_SIZE];
+static atomic_uint log_head;        // next slot taken by a writer of lines
+static unsigned int log_tail;       // next slot written to the file, log thread only
+static atomic_uint log_dropped;
+static atomic_bool log_running;
+static sem_t log_sem;
+static pthread_t log_thread;
+
+/**
+ * @brief write the lines of the ring to the log file, log thread only.
+ *
+ * @param none
+ *
+ * @return none
+ */
+static void HAL_Log_Drain(void)
+{
+   hal_log_slot_t *slot;
+   unsigned int dropped;
+
+   for(;;)
+   {
+      slot = &log_ring[log_tail & HAL_LOG_RING_MASK];
+      if(atomic_load_explicit(&slot->seq, memory_order_acquire) != log_tail + 1)
+      {
+         break;
+      }
+      if(fp != NULL)
+      {
+         fputs(slot->line, fp);
+      }
+      atomic_store_explicit(&slot->seq, log_tail + HAL_LOG_RING_SIZE, memory_order_release);
+      log_tail++;
+   }
+
+   dropped = atomic_exchange_explicit(&log_dropped, 0, memory_order_relaxed);
+   if(fp != NULL)
+   {
+      if(dropped > 0)
+      {
+         fprintf(fp, "hal: *** ERROR *** LOG: %u lines dropped, ring full\n", dropped);
+      }
+      fflush(fp);
+   }
+}
+
+/**
+ * @brief log thread, waits for lines and writes them.
+ *
+ * @param none
+ *
+ * @return none
+ */
+static void *HAL_Log_Thread(void *arg)
+{
+   (void)arg;
+   while(atomic_load(&log_running))
+   {
+      while((sem_wait(&log_sem) < 0) && (errno == EINTR));
+      HAL_Log_Drain();
+   }
+   HAL_Log_Drain();
+   return NULL;
+}
+#endif
 
-/** 
- * @brief get log file pointer. 
+/**
+ * @brief opens the log file and starts the log thread, once.
+ *
+ * @param none
+ *
+ * @return none
+ */
+static void HAL_Log_Start(void)
+{
+   unsigned int i;
+
+   fp = fopen (log_file_name, "w");
+#if HAL_LOG_LEVEL > HAL_LOG_LVL_NONE
+   for(i = 0; i < HAL_LOG_RING_SIZE; i++)
+   {
+      atomic_init(&log_ring[i].seq, i);
+   }
+   sem_init(&log_sem, 0, 0);
+   atomic_store(&log_running, true);
+   if(pthread_create(&log_thread, NULL, HAL_Log_Thread, NULL) != 0)
+   {
+      atomic_store(&log_running, false);
+      return;
+   }
+   atexit(HAL_Log_DeInit);
+#else
+   (void)i;
+#endif
+}
+
+/**
+ * @brief get log file pointer.
  *
  * @param none
  *
  * @return log file pointer
  */
 FILE * HAL_Log_GetFile(void)
-{  
+{
+   pthread_once(&log_once, HAL_Log_Start);
    if(fp != NULL)
    {
       return fp;
    }
    fp = fopen (log_file_name, "w");
-   
+
    return fp;
 }
 
-/** 
- * @brief de-initializes the log file. 
+/**
+ * @brief de-initializes the log file.
  *
  * @param none
  *
@@ -44,27 +170,87 @@ FILE * HAL_Log_GetFile(void)
  */
 void HAL_Log_DeInit(void)
 {
+#if HAL_LOG_LEVEL > HAL_LOG_LVL_NONE
+   if(atomic_exchange(&log_running, false))
+   {
+      sem_post(&log_sem);
+      pthread_join(log_thread, NULL);
+   }
+#endif
    if(fp != NULL)
    {
-      fclose(fp);  
+      fclose(fp);
       fp = NULL;
    }
 }
 
-/** 
- * @brief print log to log.txt file. 
+/**
+ * @brief set the level logged at runtime.
+ *
+ * @param[in] level, HAL_LOG_LVL_NONE to HAL_LOG_LVL_TRACE
+ *
+ * @return none
+ */
+void HAL_Log_SetLevel(int level)
+{
+   hal_log_level = level;
+}
+
+/**
+ * @brief print log to log.txt file, through the ring.
  *
+ * @param level, log level of the line
  * @param formated strings
  *
  * @return none
  */
-void HAL_Log(const char* format, ... )
+void HAL_Log_Write(int level, const char* format, ... )
 {
-#if defined(HAL_LOG_ENABLED) && (HAL_LOG_ENABLED==1)
+#if HAL_LOG_LEVEL > HAL_LOG_LVL_NONE
    va_list args;
+   hal_log_slot_t *slot;
+   unsigned int pos;
+   int diff;
+
+   (void)level;
+   pthread_once(&log_once, HAL_Log_Start);
+   if(!atomic_load_explicit(&log_running, memory_order_relaxed))
+   {
+      return;
+   }
+
+   // take a free slot, the head moves on only once it is ours
+   pos = atomic_load_explicit(&log_head, memory_order_relaxed);
+   for(;;)
+   {
+      slot = &log_ring[pos & HAL_LOG_RING_MASK];
+      diff = (int)(atomic_load_explicit(&slot->seq, memory_order_acquire) - pos);
+      if(diff == 0)
+      {
+         if(atomic_compare_exchange_weak_explicit(&log_head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+         {
+            break;
+         }
+      }
+      else if(diff < 0)
+      {
+         atomic_fetch_add_explicit(&log_dropped, 1, memory_order_relaxed);
+         return;
+      }
+      else
+      {
+         pos = atomic_load_explicit(&log_head, memory_order_relaxed);
+      }
+   }
+
    va_start( args, format );
-   vfprintf( HAL_Log_GetFile(), format, args );
+   vsnprintf( slot->line, HAL_LOG_LINE_MAX, format, args );
    va_end( args );
-   fflush(HAL_Log_GetFile()); 
-#endif  
+
+   atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+   sem_post(&log_sem);
+#else
+   (void)level;
+   (void)format;
+#endif
 }
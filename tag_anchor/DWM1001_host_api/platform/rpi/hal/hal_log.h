@@ -2,6 +2,16 @@
  * @file    hal_fprint.h
  * @brief   utility print to log file
  *
+ *          The log lines are formatted by the caller into a lock-free ring and
+ *          written to log.txt by a background thread, the caller never waits
+ *          on the file.
+ *
+ *          in makefile, define the log configuration using:
+ *          HAL_LOG_ENABLED = 1 to build the logs in
+ *          HAL_LOG_LEVEL = highest level built in, HAL_LOG_LVL_TRACE by default
+ *          The level logged at runtime is set with HAL_Log_SetLevel(),
+ *          HAL_LOG_LVL_INFO by default.
+ *
  * @attention
  *
  * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
@@ -9,16 +19,56 @@
  * All rights reserved.
  *
  */
- 
+
 #ifndef _HAL_LOG_H_
 #define _HAL_LOG_H_
 
 #include <stdio.h>
 #include <stdlib.h>
 
-/** 
- * @brief get log file pointer. 
- *        If log file not open yet, initializes the log file. 
+#define HAL_LOG_LVL_NONE      0
+#define HAL_LOG_LVL_ERR       1     // errors
+#define HAL_LOG_LVL_INFO      2     // init, results of the transactions
+#define HAL_LOG_LVL_DEBUG     3     // steps of the transactions
+#define HAL_LOG_LVL_TRACE     4     // bytes of the transfers
+
+#if defined(HAL_LOG_ENABLED) && (HAL_LOG_ENABLED==1)
+#ifndef HAL_LOG_LEVEL
+#define HAL_LOG_LEVEL         HAL_LOG_LVL_TRACE
+#endif
+#else
+#undef  HAL_LOG_LEVEL
+#define HAL_LOG_LEVEL         HAL_LOG_LVL_NONE
+#endif
+
+#ifndef HAL_LOG_LEVEL_DEFAULT
+#define HAL_LOG_LEVEL_DEFAULT HAL_LOG_LVL_INFO
+#endif
+
+#define HAL_LOG_LINE_MAX      800   // longest line, a 255 bytes dump fits
+
+extern int hal_log_level;
+
+/**
+ * @brief true if lines of level lvl are logged. The test is a constant false
+ *        for the levels not built in, so the code it guards is removed.
+ */
+#define HAL_LOG_ON(lvl)       (((lvl) <= HAL_LOG_LEVEL) && ((lvl) <= hal_log_level))
+
+/**
+ * @brief prints formated args into log file at a level, the args are not
+ *        evaluated if the level is not logged.
+ */
+#define HAL_LogLvl(lvl, ...)  do { if(HAL_LOG_ON(lvl)) HAL_Log_Write(lvl, __VA_ARGS__); } while(0)
+
+#define HAL_LogErr(...)       HAL_LogLvl(HAL_LOG_LVL_ERR, __VA_ARGS__)
+#define HAL_Log(...)          HAL_LogLvl(HAL_LOG_LVL_INFO, __VA_ARGS__)
+#define HAL_LogDbg(...)       HAL_LogLvl(HAL_LOG_LVL_DEBUG, __VA_ARGS__)
+#define HAL_LogTrace(...)     HAL_LogLvl(HAL_LOG_LVL_TRACE, __VA_ARGS__)
+
+/**
+ * @brief get log file pointer.
+ *        If log file not open yet, initializes the log file.
  *
  * @param none
  *
@@ -26,8 +76,9 @@
  */
 FILE * HAL_Log_GetFile(void);
 
-/** 
- * @brief de-initializes the log file. 
+/**
+ * @brief de-initializes the log file, after the background thread has
+ *        written all the pending lines.
  *
  * @param none
  *
@@ -35,13 +86,24 @@ FILE * HAL_Log_GetFile(void);
  */
 void HAL_Log_DeInit(void);
 
-/** 
- * @brief prints formated args into log file. 
+/**
+ * @brief set the level logged at runtime, up to HAL_LOG_LEVEL.
+ *
+ * @param[in] level, HAL_LOG_LVL_NONE to HAL_LOG_LVL_TRACE
+ *
+ * @return none
+ */
+void HAL_Log_SetLevel(int level);
+
+/**
+ * @brief formats args into the log ring, use the HAL_Log macros instead.
+ *        The line is dropped if the ring is full.
  *
+ * @param[in] level, log level of the line
  * @param[in] formated args
  *
  * @return none
  */
-void HAL_Log(const char* format, ... );
+void HAL_Log_Write(int level, const char* format, ... );
 
 #endif //_HAL_FPRINT_H_
@@ -1,284 +1,371 @@
-/*! ------------------------------------------------------------------------------------------------------------------
- * @file    hal_spi.c
- * @brief   utility to operate spi device based on Linux system
- *
- * @attention
- *
- * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
- *
- * All rights reserved.
- *
- */
-#include <stdbool.h>
-#include <fcntl.h>   // for open
-#include <unistd.h>  // for close
-#include <string.h>
-#include <linux/spi/spidev.h>
-#include <sys/ioctl.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <stdint.h> 
-#include "hal_spi.h"
-#include "hal_log.h"
-#include "hal.h"
-
-#define HAL_SPI_BITS                 8
-#define HAL_SPI_SPEED                2000000
-#define HAL_SPI_DELAY                0
-
-static const char *device0 = "/dev/spidev0.0";
-static const char *device1 = "/dev/spidev0.1";
-static struct spi_ioc_transfer tr_data;
-static unsigned char spi_tx; 
-static unsigned char spi_rx;
-
-static int curr_dev = 0;
-static int curr_dev_fd = 0;
-static int spi_dev0_fd = 0;
-static int spi_dev1_fd = 0;
-
-/** 
- * @brief initializes the current SPI device, default /dev/spidev0.0
- *        use HAL_SPI_Sel to set current spi device
- *        use HAL_SPI_Which to get current spi device
- *
- * @param none
- *
- * @return Error code
- */
-int HAL_SPI_Init(void)
-{	      
-	int ret = 0;   
-   uint8_t mode = 0;
-   uint8_t bits = HAL_SPI_BITS;
-   uint32_t speed = HAL_SPI_SPEED;
-   uint16_t delay = HAL_SPI_DELAY;
-   int fd;
-   const char *device_str;   
-   
-   device_str = curr_dev ? device1 : device0;
-   
-	fd = open(device_str, O_RDWR);
-	if (fd < 0){
-		HAL_Log("hal: *** ERROR *** SPI%d: Can't open device.\n", HAL_SPI_Which()); 
-      return fd;
-   }
-   
-   curr_dev_fd = fd;
-   if(curr_dev == 0){
-      spi_dev0_fd = fd;
-   }else{      
-      spi_dev1_fd = fd;
-   }
-	/*
-	 * spi mode
-	 */
-	ret = ioctl(curr_dev_fd, SPI_IOC_WR_MODE, &mode);
-	if (ret == -1){
-		HAL_Log("hal: *** ERROR *** SPI%d: can't set spi mode.\n", HAL_SPI_Which());
-      return ret;
-   }
- 
-	ret = ioctl(curr_dev_fd, SPI_IOC_RD_MODE, &mode);
-	if (ret == -1){
-		HAL_Log("hal: *** ERROR *** SPI%d: can't get spi mode.\n", HAL_SPI_Which());
-      return ret;
-   }
-
-	/*
-	 * bits per word
-	 */
-	ret = ioctl(curr_dev_fd, SPI_IOC_WR_BITS_PER_WORD, &bits);
-	if (ret == -1){
-		HAL_Log("hal: *** ERROR *** SPI%d: can't set bits per word.\n", HAL_SPI_Which());
-      return ret;
-   }
- 
-	ret = ioctl(curr_dev_fd, SPI_IOC_RD_BITS_PER_WORD, &bits);
-	if (ret == -1){
-		HAL_Log("hal: *** ERROR *** SPI%d: can't get bits per word. \n", HAL_SPI_Which());
-      return ret;
-   }
- 
-	/*
-	 * max speed hz
-	 */
-	ret = ioctl(curr_dev_fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed);
-	if (ret == -1){
-		HAL_Log("hal: *** ERROR *** SPI%d: can't set max speed hz.\n", HAL_SPI_Which());
-      return ret;
-   }
- 
-	ret = ioctl(curr_dev_fd, SPI_IOC_RD_MAX_SPEED_HZ, &speed);
-	if (ret == -1){
-		HAL_Log("hal: *** ERROR *** SPI%d: can't get max speed hz. \n", HAL_SPI_Which());
-      return ret;
-   }
- 
-	tr_data.tx_buf = (unsigned long)&spi_tx;
-	tr_data.rx_buf = (unsigned long)&spi_rx;
-	tr_data.len = 1;
-	tr_data.delay_usecs = delay;
-	tr_data.speed_hz = speed;
-	tr_data.bits_per_word = bits;
-	tr_data.cs_change = 0;
-
-	HAL_Log("hal:     SPI%d: spi mode: %d\n", HAL_SPI_Which(), mode);
-	HAL_Log("hal:     SPI%d: bits per word: %d\n", HAL_SPI_Which(), bits);
-	HAL_Log("hal:     SPI%d: max speed: %d Hz (%d KHz)\n", HAL_SPI_Which(), speed, speed/1000);
-   
-   return curr_dev_fd;
-}
-
-/** 
- * @brief de-initializes the current SPI device
- *
- * @param none
- *
- * @return none
- */
-void HAL_SPI_DeInit(void)
-{
-   close(curr_dev_fd);   
-}
-
-
-/** 
- * @brief set current spi device
- *
- * @param [in] spi dev number, 0 or 1
- *
- * @return none
- */
-void HAL_SPI_Sel(int dev)
-{
-   const char *device_str;
-   curr_dev = dev;
-   device_str = dev ? device1 : device0;
-   curr_dev_fd = dev==0 ? spi_dev0_fd : spi_dev1_fd;
-   HAL_Log("hal:     SPI%d: >>>>>>>>>>>>>>>>>>>>>>>>>>>>>> Device select: %s\n", HAL_SPI_Which(), device_str);
-}
-
-/** 
- * @brief acquire current spi device
- *
- * @param none
- *
- * @return current spi device
- */
-int HAL_SPI_Which(void)
-{
-   return curr_dev;
-}
-
-/** 
- * @brief transmit data of length over the current SPI device
- *
- * @param [in] data: pointer to the TX data
- * @param [in] length: length of data to be transmitted
- *
- * @return Error code
- */
-int HAL_SPI_Tx(uint8_t* tx_data, uint8_t* length)
-{
-	uint16_t i;   
-   uint8_t rx_data[HAL_SPI_MAX_LENGTH];
-   uint8_t tx_length = *length;
-   uint16_t str_len = 0;
-   int errno; 
-	char print_str[HAL_SPI_MAX_PRINT_LENGTH];
-   
-   if(tx_length == 0){
-      return HAL_OK;
-   } 
-   if(tx_length > HAL_SPI_MAX_LENGTH){
-      HAL_Log("hal: *** ERROR *** SPI%d: Tx length exceeds the limit: %d\n", HAL_SPI_Which(), (uint16_t)HAL_SPI_MAX_LENGTH);
-      return HAL_ERR;
-   }      
-   
-   errno = snprintf(print_str, HAL_SPI_MAX_PRINT_LENGTH, "hal:     SPI: Tx %d bytes: 0x", tx_length);   
-   str_len = (errno >= 0)? strlen(print_str):0;
-   for(i = 0; i <tx_length; i++){
-      errno = snprintf(print_str+str_len, HAL_SPI_MAX_PRINT_LENGTH-str_len, "%02x", tx_data[i]);
-      str_len += (errno >= 0)? 2:0;
-   }
-   errno = snprintf(print_str+str_len, HAL_SPI_MAX_PRINT_LENGTH-str_len, "\n");
-   str_len += (errno >= 0)? 1:0;
-   HAL_Log("%s", print_str); 
-   
-	tr_data.tx_buf = (unsigned long)tx_data;
-	tr_data.rx_buf = (unsigned long)rx_data;
-	tr_data.len = tx_length;
-      
-	errno = ioctl(curr_dev_fd, SPI_IOC_MESSAGE(1), &tr_data);
-	if (errno == -1){
-		HAL_Log("hal: *** ERROR *** SPI%d: Error in %s\n", HAL_SPI_Which(), __func__);
-      return HAL_ERR;
-   }
-   
-   //set back values to protect   
-	tr_data.tx_buf = (unsigned long)&spi_tx;
-	tr_data.rx_buf = (unsigned long)&spi_rx;
-   
-   return HAL_OK;
-}
-
-/** 
- * @brief receive data of length over the current SPI device
- *
- * @param [in] data: pointer to the RX data buffer
- * @param [in] length: length of data to be received
- *
- * @return Error code
- */
-int HAL_SPI_Rx(uint8_t* rx_data, uint8_t* length)
-{
-	uint16_t i;
-   uint8_t tx_data[HAL_SPI_MAX_LENGTH];
-   uint8_t rx_length = *length;
-   uint16_t str_len = 0;
-   int errno; 
-	char print_str[HAL_SPI_MAX_PRINT_LENGTH];
-   
-   if(rx_length == 0){
-      return HAL_OK;
-   } 
-   
-   if(rx_length > HAL_SPI_MAX_LENGTH){
-      HAL_Log("hal: *** ERROR *** SPI%d: Rx length exceeds the limit: %d.\n", HAL_SPI_Which(), (uint16_t)HAL_SPI_MAX_LENGTH);
-      return HAL_ERR;
-   }
-   
-   memset(tx_data, 0xFF, rx_length);//dont care. can be any byte not only 0xFF
-   
-	tr_data.tx_buf = (unsigned long)tx_data;
-	tr_data.rx_buf = (unsigned long)rx_data;
-	tr_data.len = rx_length;
-   
-	errno = ioctl(curr_dev_fd, SPI_IOC_MESSAGE(1), &tr_data);
-	if (errno == -1){
-		HAL_Log("hal: *** ERROR *** SPI%d: Error in %s\n", HAL_SPI_Which(), __func__);
-      return HAL_ERR;
-   }
-   
-   //set back values to protect   
-	tr_data.tx_buf = (unsigned long)&spi_tx;
-	tr_data.rx_buf = (unsigned long)&spi_rx;
-   
-   errno = snprintf(print_str, HAL_SPI_MAX_PRINT_LENGTH, "hal:     SPI: Rx %d bytes: 0x", rx_length);   
-   str_len = (errno >= 0)? strlen(print_str):0;
-   for(i = 0; i <rx_length; i++){
-      errno = snprintf(print_str+str_len, HAL_SPI_MAX_PRINT_LENGTH-str_len, "%02x", rx_data[i]);
-      str_len += (errno >= 0)? 2:0;
-   }
-   errno = snprintf(print_str+str_len, HAL_SPI_MAX_PRINT_LENGTH-str_len, "\n");
-   str_len += (errno >= 0)? 1:0;
-   HAL_Log("%s", print_str); 
-   
-   return HAL_OK;
-}
-
-
-
-
-
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    hal_spi.c
+ * @brief   utility to operate spi device based on Linux system
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+#include <stdbool.h>
+#include <fcntl.h>   // for open
+#include <unistd.h>  // for close
+#include <string.h>
+#include <linux/spi/spidev.h>
+#include <sys/ioctl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h> 
+#include "hal_spi.h"
+#include "hal_log.h"
+#include "hal.h"
+
+#define HAL_SPI_BITS                 8
+#define HAL_SPI_SPEED                2000000
+#define HAL_SPI_DELAY                0
+
+static const char *device_str_tab[HAL_SPI_DEV_NUM] = {"/dev/spidev0.0", "/dev/spidev0.1"};
+
+// the transfer settings of each device, the buffers are set per transfer
+static struct spi_ioc_transfer tr_data[HAL_SPI_DEV_NUM];
+static int spi_dev_fd[HAL_SPI_DEV_NUM] = {-1, -1};
+static uint32_t spi_speed[HAL_SPI_DEV_NUM] = {HAL_SPI_SPEED, HAL_SPI_SPEED};
+static uint16_t spi_delay[HAL_SPI_DEV_NUM] = {HAL_SPI_DELAY, HAL_SPI_DELAY};
+
+// sent while receiving, dont care. can be any byte not only 0xFF
+static const uint8_t spi_dummy[HAL_SPI_MAX_LENGTH] = {[0 ... HAL_SPI_MAX_LENGTH-1] = 0xFF};
+
+// the current device is selected per thread, so that each device can be
+// driven from its own thread
+static __thread int curr_dev = 0;
+
+/** 
+ * @brief logs the bytes of a transfer at the trace level
+ *
+ * @param [in] dir: "Tx" or "Rx"
+ * @param [in] data: bytes
+ * @param [in] length: number of bytes
+ *
+ * @return none
+ */
+static void HAL_SPI_Dump(const char* dir, const uint8_t* data, uint8_t length)
+{
+	uint16_t i;
+   uint16_t str_len = 0;
+   int errno; 
+	char print_str[HAL_SPI_MAX_PRINT_LENGTH];
+   
+   // the byte dump is only formatted at the trace level
+   if(!HAL_LOG_ON(HAL_LOG_LVL_TRACE))
+   {
+      return;
+   }
+   errno = snprintf(print_str, HAL_SPI_MAX_PRINT_LENGTH, "hal:     SPI: %s %d bytes: 0x", dir, length);   
+   str_len = (errno >= 0)? strlen(print_str):0;
+   for(i = 0; i <length; i++){
+      errno = snprintf(print_str+str_len, HAL_SPI_MAX_PRINT_LENGTH-str_len, "%02x", data[i]);
+      str_len += (errno >= 0)? 2:0;
+   }
+   errno = snprintf(print_str+str_len, HAL_SPI_MAX_PRINT_LENGTH-str_len, "\n");
+   str_len += (errno >= 0)? 1:0;
+   HAL_LogTrace("%s", print_str);
+}
+
+/** 
+ * @brief initializes the current SPI device, default /dev/spidev0.0
+ *        use HAL_SPI_Sel to set current spi device
+ *        use HAL_SPI_Which to get current spi device
+ *
+ * @param none
+ *
+ * @return Error code
+ */
+int HAL_SPI_Init(void)
+{	      
+	int ret = 0;   
+   uint8_t mode = 0;
+   uint8_t bits = HAL_SPI_BITS;
+   uint32_t speed = spi_speed[curr_dev];
+   uint16_t delay = spi_delay[curr_dev];
+   int fd;
+   
+	fd = open(device_str_tab[curr_dev], O_RDWR);
+	if (fd < 0){
+		HAL_LogErr("hal: *** ERROR *** SPI%d: Can't open device.\n", HAL_SPI_Which()); 
+      return fd;
+   }
+   
+   spi_dev_fd[curr_dev] = fd;
+	/*
+	 * spi mode
+	 */
+	ret = ioctl(fd, SPI_IOC_WR_MODE, &mode);
+	if (ret == -1){
+		HAL_LogErr("hal: *** ERROR *** SPI%d: can't set spi mode.\n", HAL_SPI_Which());
+      return ret;
+   }
+ 
+	ret = ioctl(fd, SPI_IOC_RD_MODE, &mode);
+	if (ret == -1){
+		HAL_LogErr("hal: *** ERROR *** SPI%d: can't get spi mode.\n", HAL_SPI_Which());
+      return ret;
+   }
+
+	/*
+	 * bits per word
+	 */
+	ret = ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &bits);
+	if (ret == -1){
+		HAL_LogErr("hal: *** ERROR *** SPI%d: can't set bits per word.\n", HAL_SPI_Which());
+      return ret;
+   }
+ 
+	ret = ioctl(fd, SPI_IOC_RD_BITS_PER_WORD, &bits);
+	if (ret == -1){
+		HAL_LogErr("hal: *** ERROR *** SPI%d: can't get bits per word. \n", HAL_SPI_Which());
+      return ret;
+   }
+ 
+	/*
+	 * max speed hz
+	 */
+	ret = ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed);
+	if (ret == -1){
+		HAL_LogErr("hal: *** ERROR *** SPI%d: can't set max speed hz.\n", HAL_SPI_Which());
+      return ret;
+   }
+ 
+	ret = ioctl(fd, SPI_IOC_RD_MAX_SPEED_HZ, &speed);
+	if (ret == -1){
+		HAL_LogErr("hal: *** ERROR *** SPI%d: can't get max speed hz. \n", HAL_SPI_Which());
+      return ret;
+   }
+ 
+	memset(&tr_data[curr_dev], 0, sizeof(tr_data[curr_dev]));
+	tr_data[curr_dev].delay_usecs = delay;
+	tr_data[curr_dev].speed_hz = speed;
+	tr_data[curr_dev].bits_per_word = bits;
+	tr_data[curr_dev].cs_change = 0;
+
+	HAL_Log("hal:     SPI%d: spi mode: %d\n", HAL_SPI_Which(), mode);
+	HAL_Log("hal:     SPI%d: bits per word: %d\n", HAL_SPI_Which(), bits);
+	HAL_Log("hal:     SPI%d: max speed: %d Hz (%d KHz)\n", HAL_SPI_Which(), speed, speed/1000);
+   
+   return fd;
+}
+
+/** 
+ * @brief de-initializes the current SPI device
+ *
+ * @param none
+ *
+ * @return none
+ */
+void HAL_SPI_DeInit(void)
+{
+   close(spi_dev_fd[curr_dev]);   
+   spi_dev_fd[curr_dev] = -1;
+}
+
+
+/** 
+ * @brief set current spi device of the calling thread
+ *
+ * @param [in] spi dev number, 0 or 1
+ *
+ * @return none
+ */
+void HAL_SPI_Sel(int dev)
+{
+   if((dev < 0) || (dev >= HAL_SPI_DEV_NUM))
+   {
+      HAL_LogErr("hal: *** ERROR *** SPI%d: no such device.\n", dev);
+      return;
+   }
+   curr_dev = dev;
+   HAL_Log("hal:     SPI%d: >>>>>>>>>>>>>>>>>>>>>>>>>>>>>> Device select: %s\n", HAL_SPI_Which(), device_str_tab[dev]);
+}
+
+/** 
+ * @brief acquire current spi device of the calling thread
+ *
+ * @param none
+ *
+ * @return current spi device
+ */
+int HAL_SPI_Which(void)
+{
+   return curr_dev;
+}
+
+/** 
+ * @brief transmit data of length over the current SPI device
+ *
+ * @param [in] data: pointer to the TX data
+ * @param [in] length: length of data to be transmitted
+ *
+ * @return Error code
+ */
+int HAL_SPI_Tx(uint8_t* tx_data, uint8_t* length)
+{
+   uint8_t tx_length = *length;
+   int errno; 
+   struct spi_ioc_transfer tr = tr_data[curr_dev];
+   
+   if(tx_length == 0){
+      return HAL_OK;
+   } 
+   if(tx_length > HAL_SPI_MAX_LENGTH){
+      HAL_LogErr("hal: *** ERROR *** SPI%d: Tx length exceeds the limit: %d\n", HAL_SPI_Which(), (uint16_t)HAL_SPI_MAX_LENGTH);
+      return HAL_ERR;
+   }      
+   
+   HAL_SPI_Dump("Tx", tx_data, tx_length);
+   
+   // the received bytes are dropped by spidev
+	tr.tx_buf = (unsigned long)tx_data;
+	tr.rx_buf = 0;
+	tr.len = tx_length;
+      
+	errno = ioctl(spi_dev_fd[curr_dev], SPI_IOC_MESSAGE(1), &tr);
+	if (errno == -1){
+		HAL_LogErr("hal: *** ERROR *** SPI%d: Error in %s\n", HAL_SPI_Which(), __func__);
+      return HAL_ERR;
+   }
+   
+   return HAL_OK;
+}
+
+/** 
+ * @brief receive data of length over the current SPI device
+ *
+ * @param [in] data: pointer to the RX data buffer
+ * @param [in] length: length of data to be received
+ *
+ * @return Error code
+ */
+int HAL_SPI_Rx(uint8_t* rx_data, uint8_t* length)
+{
+   uint8_t rx_length = *length;
+   int errno; 
+   struct spi_ioc_transfer tr = tr_data[curr_dev];
+   
+   if(rx_length == 0){
+      return HAL_OK;
+   } 
+   
+   if(rx_length > HAL_SPI_MAX_LENGTH){
+      HAL_LogErr("hal: *** ERROR *** SPI%d: Rx length exceeds the limit: %d.\n", HAL_SPI_Which(), (uint16_t)HAL_SPI_MAX_LENGTH);
+      return HAL_ERR;
+   }
+   
+	tr.tx_buf = (unsigned long)spi_dummy;
+	tr.rx_buf = (unsigned long)rx_data;
+	tr.len = rx_length;
+   
+	errno = ioctl(spi_dev_fd[curr_dev], SPI_IOC_MESSAGE(1), &tr);
+	if (errno == -1){
+		HAL_LogErr("hal: *** ERROR *** SPI%d: Error in %s\n", HAL_SPI_Which(), __func__);
+      return HAL_ERR;
+   }
+   
+   HAL_SPI_Dump("Rx", rx_data, rx_length);
+   
+   return HAL_OK;
+}
+
+/** 
+ * @brief submits transfers over the current SPI device as one chained 
+ *        message, each in its own chip select cycle
+ *
+ * @param [in, out] xfer: transfers, their rx_data are filled
+ * @param [in] num: number of transfers, up to HAL_SPI_XFER_MAX
+ *
+ * @return Error code
+ */
+int HAL_SPI_Xfer(const hal_spi_xfer_t* xfer, int num)
+{
+   struct spi_ioc_transfer tr[HAL_SPI_XFER_MAX];
+   int i, errno;
+   
+   if((num <= 0) || (num > HAL_SPI_XFER_MAX)){
+      HAL_LogErr("hal: *** ERROR *** SPI%d: %d transfers, the limit is %d\n", HAL_SPI_Which(), num, HAL_SPI_XFER_MAX);
+      return HAL_ERR;
+   }
+   
+   for(i = 0; i < num; i++){
+      tr[i] = tr_data[curr_dev];
+      tr[i].tx_buf = (unsigned long)((xfer[i].tx_data != NULL)? xfer[i].tx_data : spi_dummy);
+      tr[i].rx_buf = (unsigned long)xfer[i].rx_data;
+      tr[i].len = xfer[i].length;
+      if(xfer[i].delay_us > tr[i].delay_usecs){
+         tr[i].delay_usecs = xfer[i].delay_us;
+      }
+      // the last transfer releases the chip select at the end of the message
+      tr[i].cs_change = (i < num - 1)? 1 : 0;
+      if(xfer[i].tx_data != NULL){
+         HAL_SPI_Dump("Tx", xfer[i].tx_data, xfer[i].length);
+      }
+   }
+   
+	errno = ioctl(spi_dev_fd[curr_dev], SPI_IOC_MESSAGE(num), tr);
+	if (errno == -1){
+		HAL_LogErr("hal: *** ERROR *** SPI%d: Error in %s\n", HAL_SPI_Which(), __func__);
+      return HAL_ERR;
+   }
+   
+   for(i = 0; i < num; i++){
+      if(xfer[i].rx_data != NULL){
+         HAL_SPI_Dump("Rx", xfer[i].rx_data, xfer[i].length);
+      }
+   }
+   return HAL_OK;
+}
+
+/** 
+ * @brief sets the clock of the current SPI device, applied at once if the 
+ *        device is open, else by HAL_SPI_Init()
+ *
+ * @param [in] speed_hz: SPI clock, Hz
+ *
+ * @return Error code
+ */
+int HAL_SPI_SetSpeed(uint32_t speed_hz)
+{
+   int fd = spi_dev_fd[curr_dev];
+   
+   if(speed_hz == 0){
+      return HAL_ERR;
+   }
+   if(fd >= 0){
+      if(ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed_hz) == -1){
+         HAL_LogErr("hal: *** ERROR *** SPI%d: can't set max speed hz.\n", HAL_SPI_Which());
+         return HAL_ERR;
+      }
+      tr_data[curr_dev].speed_hz = speed_hz;
+   }
+   spi_speed[curr_dev] = speed_hz;
+	HAL_Log("hal:     SPI%d: max speed: %d Hz (%d KHz)\n", HAL_SPI_Which(), speed_hz, speed_hz/1000);
+   return HAL_OK;
+}
+
+/** 
+ * @brief sets the wait after each transfer of the current SPI device, 
+ *        before the chip select is released
+ *
+ * @param [in] delay_us: wait, us
+ *
+ * @return none
+ */
+void HAL_SPI_SetDelay(uint16_t delay_us)
+{
+   spi_delay[curr_dev] = delay_us;
+   tr_data[curr_dev].delay_usecs = delay_us;
+}
+
+
+
+
+
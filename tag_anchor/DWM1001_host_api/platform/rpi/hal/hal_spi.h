@@ -20,12 +20,28 @@
 
 #define HAL_SPI_DEV0 0
 #define HAL_SPI_DEV1 1
+#define HAL_SPI_DEV_NUM 2
 
+#define HAL_SPI_XFER_MAX             8     // transfers chained in one HAL_SPI_Xfer()
+
+/**
+ * @brief one transfer of a chained message, in its own chip select cycle
+ */
+typedef struct
+{
+   const uint8_t* tx_data;    // NULL to send 0xFF dummy bytes
+   uint8_t* rx_data;          // NULL if the received bytes are not needed
+   uint8_t length;
+   uint16_t delay_us;         // wait before the chip select is released, at
+                              // least the delay of HAL_SPI_SetDelay()
+} hal_spi_xfer_t;
 
 /** 
  * @brief initializes the current SPI device, default /dev/spidev0.0
  *        use HAL_SPI_Sel to set current spi device
  *        use HAL_SPI_Which to get current spi device
+ *        The current device is kept per thread: a thread selects its device
+ *        once, then each device can be driven from its own thread.
  *
  * @param none
  *
@@ -43,7 +59,7 @@ int HAL_SPI_Init(void);
 void HAL_SPI_DeInit(void);
 
 /** 
- * @brief set current spi device
+ * @brief set current spi device of the calling thread
  *
  * @param [in] spi dev number, 0 or 1
  *
@@ -52,7 +68,7 @@ void HAL_SPI_DeInit(void);
 void HAL_SPI_Sel(int dev);
 
 /** 
- * @brief set current spi device
+ * @brief acquire current spi device of the calling thread
  *
  * @param none
  *
@@ -80,5 +96,40 @@ int HAL_SPI_Tx(uint8_t* data, uint8_t* length);
  */
 int HAL_SPI_Rx(uint8_t* data, uint8_t* length);
 
+/** 
+ * @brief submits transfers over the current SPI device as one chained 
+ *        message, one system call for all of them. The chip select is 
+ *        released after each transfer, after its delay_us, and asserted again 
+ *        for the next about 10 us later (the spidev chip select gap), so the 
+ *        chain only fits the transfers which the device does not have to 
+ *        prepare for. 
+ *
+ * @param [in, out] xfer: transfers, their rx_data are filled
+ * @param [in] num: number of transfers, up to HAL_SPI_XFER_MAX
+ *
+ * @return Error code
+ */
+int HAL_SPI_Xfer(const hal_spi_xfer_t* xfer, int num);
+
+/** 
+ * @brief sets the clock of the current SPI device, applied at once if the 
+ *        device is open, else by HAL_SPI_Init(), default 2 MHz
+ *
+ * @param [in] speed_hz: SPI clock, Hz
+ *
+ * @return Error code
+ */
+int HAL_SPI_SetSpeed(uint32_t speed_hz);
+
+/** 
+ * @brief sets the wait after each transfer of the current SPI device, 
+ *        before the chip select is released (spidev delay_usecs), default 0
+ *
+ * @param [in] delay_us: wait, us
+ *
+ * @return none
+ */
+void HAL_SPI_SetDelay(uint16_t delay_us);
+
 #endif //_HAL_SPI_H_
 
@@ -0,0 +1,270 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    hal_stat.c
+ * @brief   latency histograms of the host API
+ *
+ *          A value v is counted in the bucket shift*S + (v >> shift), where S
+ *          is the number of sub-buckets and shift keeps v >> shift between S
+ *          and 2*S: the values below 2*S have their own bucket, the others
+ *          share one with the values of the same HAL_STAT_SUB_BITS top bits.
+ *          The histograms are allocated at their first latency, only the
+ *          commands used take memory.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "hal.h"
+#include "hal_log.h"
+#include "hal_stat.h"
+
+#define HAL_STAT_SUB_NUM      (1 << HAL_STAT_SUB_BITS)
+#define HAL_STAT_VALUE_BITS   34    // HAL_STAT_VALUE_MAX as bits
+#define HAL_STAT_BUCKET_NUM   ((HAL_STAT_VALUE_BITS + 1 - HAL_STAT_SUB_BITS) << HAL_STAT_SUB_BITS)
+
+typedef struct
+{
+   uint64_t count;
+   uint64_t sum;
+   uint64_t min;
+   uint64_t max;
+   uint32_t bucket[HAL_STAT_BUCKET_NUM];
+} hal_stat_hist_t;
+
+static hal_stat_hist_t *stat_hist[HAL_STAT_NUM];
+static pthread_mutex_t stat_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t stat_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief bucket of a value
+ */
+static int HAL_Stat_Bucket(uint64_t v)
+{
+   int shift = 0;
+
+   if(v >= HAL_STAT_VALUE_MAX)
+   {
+      v = HAL_STAT_VALUE_MAX - 1;
+   }
+   if(v >= 2*HAL_STAT_SUB_NUM)
+   {
+      shift = 63 - __builtin_clzll(v) - HAL_STAT_SUB_BITS;
+   }
+   return (shift << HAL_STAT_SUB_BITS) + (int)(v >> shift);
+}
+
+/**
+ * @brief highest value of a bucket
+ */
+static uint64_t HAL_Stat_BucketMax(int idx)
+{
+   int shift;
+   uint64_t mant;
+
+   if(idx < 2*HAL_STAT_SUB_NUM)
+   {
+      return idx;
+   }
+   shift = (idx >> HAL_STAT_SUB_BITS) - 1;
+   mant = idx - (shift << HAL_STAT_SUB_BITS);
+   return ((mant + 1) << shift) - 1;
+}
+
+/**
+ * @brief percentile of a histogram, stat_mutex held
+ */
+static uint64_t HAL_Stat_HistPercentile(const hal_stat_hist_t *h, double q)
+{
+   uint64_t target, cnt = 0, value;
+   int i;
+
+   if((h == NULL) || (h->count == 0))
+   {
+      return 0;
+   }
+   if(q < 0)
+   {
+      q = 0;
+   }
+   target = (uint64_t)(q * h->count / 100 + 0.5);
+   if(target < 1)
+   {
+      target = 1;
+   }
+   if(target > h->count)
+   {
+      target = h->count;
+   }
+   for(i = 0; i < HAL_STAT_BUCKET_NUM; i++)
+   {
+      cnt += h->bucket[i];
+      if(cnt >= target)
+      {
+         break;
+      }
+   }
+   value = HAL_Stat_BucketMax(i);
+   // the bucket bounds are wider than the values seen
+   if(value > h->max)
+   {
+      value = h->max;
+   }
+   if(value < h->min)
+   {
+      value = h->min;
+   }
+   return value;
+}
+
+/**
+ * @brief dumps the histograms into the log on exit
+ */
+static void HAL_Stat_Exit(void)
+{
+   HAL_Stat_Dump(NULL);
+}
+
+/**
+ * @brief registers the exit dump after the log exit, so it runs before the
+ *        log thread is stopped
+ */
+static void HAL_Stat_Once(void)
+{
+   HAL_Log_GetFile();
+   atexit(HAL_Stat_Exit);
+}
+
+void HAL_Stat_Add(int id, uint64_t ns)
+{
+   hal_stat_hist_t *h;
+
+   if((id < 0) || (id >= HAL_STAT_NUM))
+   {
+      return;
+   }
+   pthread_once(&stat_once, HAL_Stat_Once);
+   pthread_mutex_lock(&stat_mutex);
+   h = stat_hist[id];
+   if(h == NULL)
+   {
+      h = stat_hist[id] = calloc(1, sizeof(hal_stat_hist_t));
+      if(h == NULL)
+      {
+         pthread_mutex_unlock(&stat_mutex);
+         return;
+      }
+      h->min = UINT64_MAX;
+   }
+   h->bucket[HAL_Stat_Bucket(ns)]++;
+   h->count++;
+   h->sum += ns;
+   if(ns < h->min)
+   {
+      h->min = ns;
+   }
+   if(ns > h->max)
+   {
+      h->max = ns;
+   }
+   pthread_mutex_unlock(&stat_mutex);
+}
+
+int HAL_Stat_Get(int id, hal_stat_t *stat)
+{
+   hal_stat_hist_t *h;
+
+   if((id < 0) || (id >= HAL_STAT_NUM))
+   {
+      return HAL_ERR;
+   }
+   memset(stat, 0, sizeof(hal_stat_t));
+   pthread_mutex_lock(&stat_mutex);
+   h = stat_hist[id];
+   if((h != NULL) && (h->count > 0))
+   {
+      stat->count = h->count;
+      stat->min = h->min;
+      stat->max = h->max;
+      stat->mean = h->sum / h->count;
+      stat->p50 = HAL_Stat_HistPercentile(h, 50);
+      stat->p90 = HAL_Stat_HistPercentile(h, 90);
+      stat->p99 = HAL_Stat_HistPercentile(h, 99);
+      stat->p999 = HAL_Stat_HistPercentile(h, 99.9);
+   }
+   pthread_mutex_unlock(&stat_mutex);
+   return HAL_OK;
+}
+
+uint64_t HAL_Stat_Percentile(int id, double q)
+{
+   uint64_t value;
+
+   if((id < 0) || (id >= HAL_STAT_NUM))
+   {
+      return 0;
+   }
+   pthread_mutex_lock(&stat_mutex);
+   value = HAL_Stat_HistPercentile(stat_hist[id], q);
+   pthread_mutex_unlock(&stat_mutex);
+   return value;
+}
+
+void HAL_Stat_Reset(void)
+{
+   int id;
+
+   pthread_mutex_lock(&stat_mutex);
+   for(id = 0; id < HAL_STAT_NUM; id++)
+   {
+      free(stat_hist[id]);
+      stat_hist[id] = NULL;
+   }
+   pthread_mutex_unlock(&stat_mutex);
+}
+
+void HAL_Stat_Dump(FILE *f)
+{
+   static const char *phase_str[HAL_STAT_CMD] = {"tx", "wait_size", "wait_data"};
+   char name[16];
+   hal_stat_t s;
+   int id;
+
+   for(id = 0; id < HAL_STAT_NUM; id++)
+   {
+      HAL_Stat_Get(id, &s);
+      if(s.count == 0)
+      {
+         continue;
+      }
+      if(id < HAL_STAT_CMD)
+      {
+         snprintf(name, sizeof(name), "%s", phase_str[id]);
+      }
+      else
+      {
+         snprintf(name, sizeof(name), "cmd 0x%02x", id - HAL_STAT_CMD);
+      }
+      if(f == NULL)
+      {
+         HAL_Log("hal:     stat: %-10s n=%llu min=%llu mean=%llu p50=%llu p90=%llu p99=%llu p99.9=%llu max=%llu us\n", \
+         name, (unsigned long long)s.count, (unsigned long long)s.min/1000, (unsigned long long)s.mean/1000, \
+         (unsigned long long)s.p50/1000, (unsigned long long)s.p90/1000, (unsigned long long)s.p99/1000, \
+         (unsigned long long)s.p999/1000, (unsigned long long)s.max/1000);
+      }
+      else
+      {
+         fprintf(f, "%-10s n=%llu min=%llu mean=%llu p50=%llu p90=%llu p99=%llu p99.9=%llu max=%llu us\n", \
+         name, (unsigned long long)s.count, (unsigned long long)s.min/1000, (unsigned long long)s.mean/1000, \
+         (unsigned long long)s.p50/1000, (unsigned long long)s.p90/1000, (unsigned long long)s.p99/1000, \
+         (unsigned long long)s.p999/1000, (unsigned long long)s.max/1000);
+      }
+   }
+}
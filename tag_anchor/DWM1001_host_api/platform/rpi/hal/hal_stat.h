@@ -0,0 +1,116 @@
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @file    hal_stat.h
+ * @brief   latency histograms of the host API
+ *
+ *          Each histogram counts latencies in ns in log-linear buckets, as an
+ *          HDR histogram with HAL_STAT_SUB_BITS bits of precision: the bucket
+ *          width is 1/32 of the value, so the percentiles are within 3 %.
+ *          There is one histogram per transport phase and one per command
+ *          TLV type, the command latency is from LMH_Tx() to the end of
+ *          LMH_WaitForRx().
+ *
+ *          in makefile, define the statistics configuration using:
+ *          HAL_STAT_ENABLED = 1 to record the latencies, the histograms are
+ *          then dumped into the log on exit.
+ *
+ * @attention
+ *
+ * Copyright 2017 (c) Decawave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _HAL_STAT_H_
+#define _HAL_STAT_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define HAL_STAT_SUB_BITS     5     // sub-buckets per power of 2, as bits
+#define HAL_STAT_VALUE_MAX    (1ULL << 34) // ns, about 17 s, the longer latencies are counted there
+#define HAL_STAT_CMD_NUM      0x40  // command TLV types, the others are counted in HAL_STAT_CMD+0
+
+enum {
+   HAL_STAT_TX = 0,                 // request written to the module
+   HAL_STAT_WAIT_SIZE,              // end of the request to SIZE read, or first byte on UART
+   HAL_STAT_WAIT_DATA,              // SIZE to end of the response
+   HAL_STAT_CMD,                    // first of the HAL_STAT_CMD_NUM commands, HAL_STAT_CMD + type
+   HAL_STAT_NUM = HAL_STAT_CMD + HAL_STAT_CMD_NUM
+};
+
+/**
+ * @brief summary of a histogram, in ns
+ */
+typedef struct {
+   uint64_t count;
+   uint64_t min;
+   uint64_t max;
+   uint64_t mean;
+   uint64_t p50;
+   uint64_t p90;
+   uint64_t p99;
+   uint64_t p999;
+} hal_stat_t;
+
+#if defined(HAL_STAT_ENABLED) && (HAL_STAT_ENABLED==1)
+#define HAL_STAT_ADD(id, ns)  HAL_Stat_Add(id, ns)
+#else
+#define HAL_STAT_ADD(id, ns)  do { (void)sizeof(ns); } while(0) // ns is not evaluated
+#endif
+
+/**
+ * @brief histogram of a command TLV type
+ */
+#define HAL_STAT_CMD_ID(type) (HAL_STAT_CMD + (((type) < HAL_STAT_CMD_NUM) ? (type) : 0))
+
+/**
+ * @brief counts a latency, use HAL_STAT_ADD() so that it is built out when
+ *        HAL_STAT_ENABLED is not set
+ *
+ * @param[in] id, histogram, HAL_STAT_TX to HAL_STAT_NUM-1
+ * @param[in] ns, latency in ns, from HAL_GetTimeNs()
+ *
+ * @return none
+ */
+void HAL_Stat_Add(int id, uint64_t ns);
+
+/**
+ * @brief gets the summary of a histogram
+ *
+ * @param[in] id, histogram
+ * @param[out] stat, summary, all 0 if no latency was counted
+ *
+ * @return HAL_OK, HAL_ERR if id is out of range
+ */
+int HAL_Stat_Get(int id, hal_stat_t *stat);
+
+/**
+ * @brief gets a percentile of a histogram, the highest value of its bucket
+ *
+ * @param[in] id, histogram
+ * @param[in] q, percentile, from 0 to 100
+ *
+ * @return latency in ns, 0 if no latency was counted
+ */
+uint64_t HAL_Stat_Percentile(int id, double q);
+
+/**
+ * @brief empties all the histograms
+ *
+ * @param none
+ *
+ * @return none
+ */
+void HAL_Stat_Reset(void);
+
+/**
+ * @brief prints the summary of the histograms holding latencies, in us
+ *
+ * @param[in] f, output file, NULL for the log
+ *
+ * @return none
+ */
+void HAL_Stat_Dump(FILE *f);
+
+#endif //_HAL_STAT_H_
@@ -16,13 +16,12 @@
 #include <termios.h>		   //Used for UART
 #include <stdio.h>
 #include <stdint.h>
-#include <sys/signal.h>
+#include <errno.h>
+#include <sys/select.h>
 #include "hal_uart.h"
 #include "hal_log.h"
 #include "hal.h"
 
-static void HAL_UART_RxCb(int status);
-
 static bool uart_initialized = false;
 static int uart0_filestream = -1;
 static void (*rx_cb)(int status) = NULL;
@@ -51,20 +50,14 @@ int HAL_UART_Init(void)
    if (uart0_filestream == -1)
    {
       //ERROR - CAN'T OPEN SERIAL PORT
-      HAL_Log("hal: *** ERROR *** UART: Unable to open UART. \n");
-      HAL_Log("hal: *** ERROR *** UART: Ensure it is not in use by another application\n");
+      HAL_LogErr("hal: *** ERROR *** UART: Unable to open UART. \n");
+      HAL_LogErr("hal: *** ERROR *** UART: Ensure it is not in use by another application\n");
       return HAL_ERR;
    }
    
-   //More info about sigaction in: http://pubs.opengroup.org/onlinepubs/7908799/xsh/sigaction.html
-   struct sigaction saio;
-   saio.sa_handler = HAL_UART_RxCb;
-   saio.sa_flags = 0;
-   saio.sa_restorer = NULL; 
-   sigaction(SIGIO,&saio,NULL);
-
-   fcntl(uart0_filestream, F_SETFL, FNDELAY|FASYNC);
-   fcntl(uart0_filestream, F_SETOWN, getpid());
+   // Reception is waited for with select() in HAL_UART_WaitRx(), no SIGIO: 
+   // the reads never block, they only take what select() reported. 
+   fcntl(uart0_filestream, F_SETFL, FNDELAY);
    
    //CONFIGURE THE UART
    struct termios options;   
@@ -73,6 +66,8 @@ int HAL_UART_Init(void)
    options.c_iflag = IGNPAR;
    options.c_oflag = 0;
    options.c_lflag = 0;
+   options.c_cc[VMIN] = 0;    // raw mode, a read returns the bytes already received
+   options.c_cc[VTIME] = 0;   // without an inter-byte timer
    tcflush(uart0_filestream, TCIFLUSH);
    tcsetattr(uart0_filestream, TCSANOW, &options);
       
@@ -127,7 +122,7 @@ void HAL_UART_Flush(void)
  */
 int HAL_UART_Tx(uint8_t* data, uint8_t* length)
 {
-   int errno = 0;
+   int err_no = 0;
    uint8_t i;
    uint8_t tx_length = *length;
    uint16_t str_len = 0;
@@ -135,38 +130,42 @@ int HAL_UART_Tx(uint8_t* data, uint8_t* length)
      
    if(!uart_initialized)
    {
-      HAL_Log("hal: *** ERROR *** UART: not initialized. \n");
+      HAL_LogErr("hal: *** ERROR *** UART: not initialized. \n");
       return HAL_ERR;
    }
    if(tx_length == 0)
    {
-      HAL_Log("hal: *** ERROR *** UART: Tx length is 0. \n");
+      HAL_LogErr("hal: *** ERROR *** UART: Tx length is 0. \n");
       return HAL_ERR;
    }   
    if(tx_length > HAL_UART_MAX_LENGTH)
    {
-      HAL_Log("hal: *** ERROR *** UART: Tx length %d exceeds max %d \n", tx_length, HAL_UART_MAX_LENGTH);
+      HAL_LogErr("hal: *** ERROR *** UART: Tx length %d exceeds max %d \n", tx_length, HAL_UART_MAX_LENGTH);
       return HAL_ERR;
    }    
    
    HAL_UART_Flush();
 
-   errno = write(uart0_filestream, data, tx_length);		//Filestream, data pointer, number of bytes to write
-   if (errno < 0)
+   err_no = write(uart0_filestream, data, tx_length);		//Filestream, data pointer, number of bytes to write
+   if (err_no < 0)
    {
-      HAL_Log("hal: *** ERROR *** UART: %s err_no: %d\n", __func__, errno);
+      HAL_LogErr("hal: *** ERROR *** UART: %s err_no: %d\n", __func__, err_no);
       return HAL_ERR;
    }
    
-   errno = snprintf(print_str, HAL_UART_MAX_PRINT_LENGTH, "hal:     UART: Tx %d bytes: 0x", tx_length);   
-   str_len = (errno >= 0)? strlen(print_str):0;
-   for(i = 0; i <tx_length; i++){
-      errno = snprintf(print_str+str_len, HAL_UART_MAX_PRINT_LENGTH-str_len, "%02x", data[i]);
-      str_len += (errno >= 0)? 2:0;
+   // the byte dump is only formatted at the trace level
+   if(HAL_LOG_ON(HAL_LOG_LVL_TRACE))
+   {
+      err_no = snprintf(print_str, HAL_UART_MAX_PRINT_LENGTH, "hal:     UART: Tx %d bytes: 0x", tx_length);   
+      str_len = (err_no >= 0)? strlen(print_str):0;
+      for(i = 0; i <tx_length; i++){
+         err_no = snprintf(print_str+str_len, HAL_UART_MAX_PRINT_LENGTH-str_len, "%02x", data[i]);
+         str_len += (err_no >= 0)? 2:0;
+      }
+      err_no = snprintf(print_str+str_len, HAL_UART_MAX_PRINT_LENGTH-str_len, "\n");
+      str_len += (err_no >= 0)? 1:0;
+      HAL_LogTrace("%s", print_str);
    }
-   errno = snprintf(print_str+str_len, HAL_UART_MAX_PRINT_LENGTH-str_len, "\n");
-   str_len += (errno >= 0)? 1:0;
-   HAL_Log("%s", print_str); 
    
    return HAL_OK;
 }
@@ -184,14 +183,14 @@ int HAL_UART_Tx(uint8_t* data, uint8_t* length)
  */
 int HAL_UART_Rx(uint8_t* data, uint8_t* length)
 {
-   int errno = 0;
+   int err_no = 0;
 	uint16_t i;
    uint16_t str_len = 0;
 	char print_str[HAL_UART_MAX_PRINT_LENGTH];
    
    if(!uart_initialized)
    {
-      HAL_Log("hal: *** ERROR *** UART: not initialized.\n");
+      HAL_LogErr("hal: *** ERROR *** UART: not initialized.\n");
       return HAL_ERR;
    }   
    if(*length == 0)
@@ -205,7 +204,7 @@ int HAL_UART_Rx(uint8_t* data, uint8_t* length)
    if (rx_length < 0)
    {
       //An error occured (will occur if there are no bytes)
-      HAL_Log("hal: *** ERROR *** UART: %s err_no: %d\n", __func__, rx_length);
+      HAL_LogErr("hal: *** ERROR *** UART: %s err_no: %d\n", __func__, rx_length);
       *length = 0;
       return HAL_ERR;
    }
@@ -217,15 +216,19 @@ int HAL_UART_Rx(uint8_t* data, uint8_t* length)
    else
    {
       //Bytes received      
-      errno = snprintf(print_str, HAL_UART_MAX_PRINT_LENGTH, "hal:     UART: Rx %d bytes: 0x", rx_length);   
-      str_len = (errno >= 0)? strlen(print_str):0;
-      for(i = 0; i <rx_length; i++){
-         errno = snprintf(print_str+str_len, HAL_UART_MAX_PRINT_LENGTH-str_len, "%02x", data[i]);
-         str_len += (errno >= 0)? 2:0;
+      // the byte dump is only formatted at the trace level
+      if(HAL_LOG_ON(HAL_LOG_LVL_TRACE))
+      {
+         err_no = snprintf(print_str, HAL_UART_MAX_PRINT_LENGTH, "hal:     UART: Rx %d bytes: 0x", rx_length);   
+         str_len = (err_no >= 0)? strlen(print_str):0;
+         for(i = 0; i <rx_length; i++){
+            err_no = snprintf(print_str+str_len, HAL_UART_MAX_PRINT_LENGTH-str_len, "%02x", data[i]);
+            str_len += (err_no >= 0)? 2:0;
+         }
+         err_no = snprintf(print_str+str_len, HAL_UART_MAX_PRINT_LENGTH-str_len, "\n");
+         str_len += (err_no >= 0)? 1:0;
+         HAL_LogTrace("%s", print_str);
       }
-      errno = snprintf(print_str+str_len, HAL_UART_MAX_PRINT_LENGTH-str_len, "\n");
-      str_len += (errno >= 0)? 1:0;
-      HAL_Log("%s", print_str); 
       
       *length = rx_length;
    }
@@ -233,31 +236,65 @@ int HAL_UART_Rx(uint8_t* data, uint8_t* length)
 }
 
 /** 
- * @brief setup the UART receive callback function. 
+ * @brief wait until received data is available on the UART, or the timeout
+ *        expires. The calling thread sleeps in select() until then. 
  *
- * @param [in] cb_func: callback function pointer. 
+ * @param [in] timeout_us: maximum waiting time in microsecond
  *
- * @return none
+ * @return HAL_OK if data is available; HAL_ERR on timeout or error
  */
-void HAL_UART_SetRxCb(void (*cb_func)(int))
+int HAL_UART_WaitRx(uint64_t timeout_us)
 {
-   rx_cb = cb_func;
+   fd_set rx_set;
+   struct timeval tv;
+   int ret;
+   
+   if(!uart_initialized)
+   {
+      HAL_LogErr("hal: *** ERROR *** UART: not initialized.\n");
+      return HAL_ERR;
+   }
+   
+   do
+   {
+      FD_ZERO(&rx_set);
+      FD_SET(uart0_filestream, &rx_set);
+      // Linux select() updates tv with the time not slept, so a retry after a 
+      // signal keeps the same deadline. 
+      tv.tv_sec = timeout_us / 1000000;
+      tv.tv_usec = timeout_us % 1000000;
+      ret = select(uart0_filestream + 1, &rx_set, NULL, NULL, &tv);
+      timeout_us = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+   } while((ret < 0) && (errno == EINTR));
+   
+   if(ret < 0)
+   {
+      HAL_LogErr("hal: *** ERROR *** UART: %s err_no: %d\n", __func__, errno);
+      return HAL_ERR;
+   }
+   if(ret == 0)
+   {
+      return HAL_ERR;
+   }
+   
+   if(rx_cb != NULL)
+   {
+      (*rx_cb)(0);
+   }
+   return HAL_OK;
 }
 
 /** 
- * @brief UART receive callback function. This function will be called when 
- *        there is incoming data available. 
+ * @brief setup the UART receive callback function, called by HAL_UART_WaitRx()
+ *        when incoming data is available. 
  *
- * @param [in] status: signal status. 
+ * @param [in] cb_func: callback function pointer. 
  *
  * @return none
  */
-static void HAL_UART_RxCb(int status)
+void HAL_UART_SetRxCb(void (*cb_func)(int))
 {
-   if(rx_cb != NULL)
-   {
-      (*rx_cb)(status);
-   }
+   rx_cb = cb_func;
 }
 
 
@@ -68,7 +68,18 @@ int HAL_UART_Tx(uint8_t* data, uint8_t* length);
 int HAL_UART_Rx(uint8_t* data, uint8_t* length);
 
 /** 
- * @brief setup the UART receive callback function. 
+ * @brief wait until received data is available on the UART, or the timeout
+ *        expires. The calling thread sleeps in select() until then. 
+ *
+ * @param [in] timeout_us: maximum waiting time in microsecond
+ *
+ * @return HAL_OK if data is available; HAL_ERR on timeout or error
+ */
+int HAL_UART_WaitRx(uint64_t timeout_us);
+
+/** 
+ * @brief setup the UART receive callback function, called by HAL_UART_WaitRx()
+ *        when incoming data is available. 
  *
  * @param [in] cb_func: callback function pointer. 
  *